@@ -0,0 +1,348 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Using hardware provided CRC32 instruction to accelerate the CRC32 disposal.
+ * CRC32C polynomial:0x1EDC6F41(BE)/0x82F63B78(LE)
+ * CRC32 is a new instruction in Intel SSE4.2, the reference can be found at:
+ * http://www.intel.com/products/processor/manuals/
+ * Intel(R) 64 and IA-32 Architectures Software Developer's Manual
+ * Volume 2A: Instruction Set Reference, A-M
+ *
+ * Copyright (C) 2008 Intel Corporation
+ * Authors: Austin Zhang <austin_zhang@linux.intel.com>
+ *          Kent Liu <kent.liu@intel.com>
+ */
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/string.h>
+#include <linux/kernel.h>
+#include <crypto/internal/hash.h>
+#include <crypto/internal/simd.h>
+
+#include <asm/cpufeatures.h>
+#include <asm/cpu_device_id.h>
+#include <asm/simd.h>
+#include <asm/unaligned.h>
+
+#define CHKSUM_BLOCK_SIZE	1
+#define CHKSUM_DIGEST_SIZE	4
+
+#define SCALE_F	sizeof(unsigned long)
+
+#ifdef CONFIG_X86_64
+#define REX_PRE "0x48, "
+#else
+#define REX_PRE
+#endif
+
+#ifdef CONFIG_X86_64
+/*
+ * use carryless multiply version of crc32c when buffer
+ * size is >= 512 to account
+ * for fpu state save/restore overhead.
+ */
+#define CRC32C_PCL_BREAKEVEN	512
+#endif /* CONFIG_X86_64 */
+
+static u32 crc32c_intel_le_hw_byte(u32 crc, unsigned char const *data, size_t length)
+{
+	while (length--) {
+		__asm__ __volatile__(
+			".byte 0xf2, 0xf, 0x38, 0xf0, 0xf1"
+			:"=S"(crc)
+			:"0"(crc), "c"(*data)
+		);
+		data++;
+	}
+
+	return crc;
+}
+
+static u32 __pure crc32c_intel_le_hw(u32 crc, unsigned char const *p, size_t len)
+{
+	unsigned int iquotient = len / SCALE_F;
+	unsigned int iremainder = len % SCALE_F;
+	unsigned long *ptmp = (unsigned long *)p;
+
+	while (iquotient--) {
+		__asm__ __volatile__(
+			".byte 0xf2, " REX_PRE "0xf, 0x38, 0xf1, 0xf1;"
+			:"=S"(crc)
+			:"0"(crc), "c"(*ptmp)
+		);
+		ptmp++;
+	}
+
+	if (iremainder)
+		crc = crc32c_intel_le_hw_byte(crc, (unsigned char *)ptmp,
+				 iremainder);
+
+	return crc;
+}
+
+#ifdef CONFIG_X86_64
+/*
+ * The crc32 instruction has a latency of three cycles but a throughput of
+ * one, so a single dependency chain leaves it two thirds idle. crc_pcl()
+ * runs three chains over adjacent blocks of the buffer and merges them with
+ * carry-less multiplies: shifting a CRC state over n zero bytes multiplies it
+ * by x^8n mod P, and
+ *
+ *	crc32q(0, clmul(s, x^(8n - 33) mod P)) = s * x^8n mod P
+ *
+ * since the reflected clmul contributes one and crc32q 32 more powers of x.
+ * Large blocks keep the merge cost low, small ones pick up what is left.
+ */
+static const unsigned int crc_pcl_block[] = { 1024, 128 };
+
+/* x^(8 * block - 33) and x^(16 * block - 33) mod P for each block size */
+static u32 crc_pcl_k[ARRAY_SIZE(crc_pcl_block)][2] __ro_after_init;
+
+static u32 __init crc32c_xpow(unsigned int n)
+{
+	u32 v = 0x80000000;	/* x^0, reflected */
+
+	while (n--)
+		v = (v >> 1) ^ ((v & 1) ? 0x82F63B78 : 0);
+
+	return v;
+}
+
+static void __init crc_pcl_init(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(crc_pcl_block); i++) {
+		crc_pcl_k[i][0] = crc32c_xpow(8 * crc_pcl_block[i] - 33);
+		crc_pcl_k[i][1] = crc32c_xpow(16 * crc_pcl_block[i] - 33);
+	}
+}
+
+static inline u32 crc32c_u64(u32 crc, u64 data)
+{
+	asm("crc32q %1, %q0" : "+r" (crc) : "rm" (data));
+	return crc;
+}
+
+/* Carry-less product of two 32-bit values, needs kernel_fpu_begin() */
+static inline u64 crc_pcl_clmul(u32 a, u32 b)
+{
+	u64 r;
+
+	asm("movq %1, %%xmm0\n\t"
+	    "movq %2, %%xmm1\n\t"
+	    "pclmulqdq $0x00, %%xmm1, %%xmm0\n\t"
+	    "movq %%xmm0, %0"
+	    : "=r" (r) : "r" ((u64)a), "r" ((u64)b));
+	return r;
+}
+
+static u32 crc_pcl(const u8 *p, unsigned int len, u32 crc)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(crc_pcl_block); i++) {
+		unsigned int block = crc_pcl_block[i];
+
+		while (len >= 3 * block) {
+			u32 crc1 = 0, crc2 = 0;
+			unsigned int j;
+			u64 t;
+
+			for (j = 0; j < block; j += 8) {
+				crc = crc32c_u64(crc, get_unaligned((u64 *)(p + j)));
+				crc1 = crc32c_u64(crc1, get_unaligned(
+						  (u64 *)(p + block + j)));
+				crc2 = crc32c_u64(crc2, get_unaligned(
+						  (u64 *)(p + 2 * block + j)));
+			}
+
+			t = crc_pcl_clmul(crc, crc_pcl_k[i][1]) ^
+			    crc_pcl_clmul(crc1, crc_pcl_k[i][0]);
+			crc = crc32c_u64(0, t) ^ crc2;
+
+			p += 3 * block;
+			len -= 3 * block;
+		}
+	}
+
+	return crc32c_intel_le_hw(crc, p, len);
+}
+#endif /* CONFIG_X86_64 */
+
+/*
+ * Setting the seed allows arbitrary accumulators and flexible XOR policy
+ * If your algorithm starts with ~0, then XOR with ~0 before you set
+ * the seed.
+ */
+static int crc32c_intel_setkey(struct crypto_shash *hash, const u8 *key,
+			unsigned int keylen)
+{
+	u32 *mctx = crypto_shash_ctx(hash);
+
+	if (keylen != sizeof(u32)) {
+		crypto_shash_set_flags(hash, CRYPTO_TFM_RES_BAD_KEY_LEN);
+		return -EINVAL;
+	}
+	*mctx = le32_to_cpup((__le32 *)key);
+	return 0;
+}
+
+static int crc32c_intel_init(struct shash_desc *desc)
+{
+	u32 *mctx = crypto_shash_ctx(desc->tfm);
+	u32 *crcp = shash_desc_ctx(desc);
+
+	*crcp = *mctx;
+
+	return 0;
+}
+
+static int crc32c_intel_update(struct shash_desc *desc, const u8 *data,
+			       unsigned int len)
+{
+	u32 *crcp = shash_desc_ctx(desc);
+
+	*crcp = crc32c_intel_le_hw(*crcp, data, len);
+	return 0;
+}
+
+static int __crc32c_intel_finup(u32 *crcp, const u8 *data, unsigned int len,
+				u8 *out)
+{
+	*(__le32 *)out = ~cpu_to_le32(crc32c_intel_le_hw(*crcp, data, len));
+	return 0;
+}
+
+static int crc32c_intel_finup(struct shash_desc *desc, const u8 *data,
+			      unsigned int len, u8 *out)
+{
+	return __crc32c_intel_finup(shash_desc_ctx(desc), data, len, out);
+}
+
+static int crc32c_intel_final(struct shash_desc *desc, u8 *out)
+{
+	u32 *crcp = shash_desc_ctx(desc);
+
+	*(__le32 *)out = ~cpu_to_le32p(crcp);
+	return 0;
+}
+
+static int crc32c_intel_digest(struct shash_desc *desc, const u8 *data,
+			       unsigned int len, u8 *out)
+{
+	return __crc32c_intel_finup(crypto_shash_ctx(desc->tfm), data, len,
+				    out);
+}
+
+static int crc32c_intel_cra_init(struct crypto_tfm *tfm)
+{
+	u32 *key = crypto_tfm_ctx(tfm);
+
+	*key = ~0;
+
+	return 0;
+}
+
+#ifdef CONFIG_X86_64
+static u32 crc32c_pcl_intel_le(u32 crc, const u8 *data, unsigned int len)
+{
+	/*
+	 * use faster PCL version if datasize is large enough to
+	 * overcome kernel fpu state save/restore overhead
+	 */
+	if (len >= CRC32C_PCL_BREAKEVEN && crypto_simd_usable()) {
+		kernel_fpu_begin();
+		crc = crc_pcl(data, len, crc);
+		kernel_fpu_end();
+		return crc;
+	}
+
+	return crc32c_intel_le_hw(crc, data, len);
+}
+
+static int crc32c_pcl_intel_update(struct shash_desc *desc, const u8 *data,
+			       unsigned int len)
+{
+	u32 *crcp = shash_desc_ctx(desc);
+
+	*crcp = crc32c_pcl_intel_le(*crcp, data, len);
+	return 0;
+}
+
+static int __crc32c_pcl_intel_finup(u32 *crcp, const u8 *data, unsigned int len,
+				u8 *out)
+{
+	*(__le32 *)out = ~cpu_to_le32(crc32c_pcl_intel_le(*crcp, data, len));
+	return 0;
+}
+
+static int crc32c_pcl_intel_finup(struct shash_desc *desc, const u8 *data,
+			      unsigned int len, u8 *out)
+{
+	return __crc32c_pcl_intel_finup(shash_desc_ctx(desc), data, len, out);
+}
+
+static int crc32c_pcl_intel_digest(struct shash_desc *desc, const u8 *data,
+			       unsigned int len, u8 *out)
+{
+	return __crc32c_pcl_intel_finup(crypto_shash_ctx(desc->tfm), data, len,
+				    out);
+}
+#endif /* CONFIG_X86_64 */
+
+static struct shash_alg alg = {
+	.setkey			=	crc32c_intel_setkey,
+	.init			=	crc32c_intel_init,
+	.update			=	crc32c_intel_update,
+	.final			=	crc32c_intel_final,
+	.finup			=	crc32c_intel_finup,
+	.digest			=	crc32c_intel_digest,
+	.descsize		=	sizeof(u32),
+	.digestsize		=	CHKSUM_DIGEST_SIZE,
+	.base			=	{
+		.cra_name		=	"crc32c",
+		.cra_driver_name	=	"crc32c-intel",
+		.cra_priority		=	200,
+		.cra_flags		=	CRYPTO_ALG_OPTIONAL_KEY,
+		.cra_blocksize		=	CHKSUM_BLOCK_SIZE,
+		.cra_ctxsize		=	sizeof(u32),
+		.cra_module		=	THIS_MODULE,
+		.cra_init		=	crc32c_intel_cra_init,
+	}
+};
+
+static const struct x86_cpu_id crc32c_cpu_id[] = {
+	X86_FEATURE_MATCH(X86_FEATURE_XMM4_2),
+	{}
+};
+MODULE_DEVICE_TABLE(x86cpu, crc32c_cpu_id);
+
+static int __init crc32c_intel_mod_init(void)
+{
+	if (!x86_match_cpu(crc32c_cpu_id))
+		return -ENODEV;
+#ifdef CONFIG_X86_64
+	if (boot_cpu_has(X86_FEATURE_PCLMULQDQ)) {
+		crc_pcl_init();
+		alg.update = crc32c_pcl_intel_update;
+		alg.finup = crc32c_pcl_intel_finup;
+		alg.digest = crc32c_pcl_intel_digest;
+	}
+#endif
+	return crypto_register_shash(&alg);
+}
+
+static void __exit crc32c_intel_mod_fini(void)
+{
+	crypto_unregister_shash(&alg);
+}
+
+module_init(crc32c_intel_mod_init);
+module_exit(crc32c_intel_mod_fini);
+
+MODULE_AUTHOR("Austin Zhang <austin.zhang@intel.com>, Kent Liu <kent.liu@intel.com>");
+MODULE_DESCRIPTION("CRC32c (Castagnoli) optimization using Intel Hardware.");
+MODULE_LICENSE("GPL");
+
+MODULE_ALIAS_CRYPTO("crc32c");
+MODULE_ALIAS_CRYPTO("crc32c-intel");
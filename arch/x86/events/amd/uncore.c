@@ -295,6 +295,74 @@ AMD_FORMAT_ATTR(event, _l3, "config:0-7");
 AMD_ATTRIBUTE(df);
 AMD_ATTRIBUTE(l3);
 
+/*
+ * Named events for family 16h (Jaguar). The L2 is shared by the four cores
+ * of a compute unit, so the amd_l2 PMU counts per module; NB probes are
+ * the snoops other modules (and coherent "Onion" GPU/IO traffic) send into
+ * it. Upstream requests are the ones the GPU and IO issue through the NB;
+ * non-coherent "Garlic" traffic bypasses the NB and only shows up as DRAM
+ * accesses.
+ */
+PMU_EVENT_ATTR_STRING(l2_requests,	 f16_l2_requests,	"event=0x7d,umask=0x47");
+PMU_EVENT_ATTR_STRING(l2_misses,	 f16_l2_misses,		"event=0x7e,umask=0x17");
+PMU_EVENT_ATTR_STRING(l2_misses_ic,	 f16_l2_misses_ic,	"event=0x7e,umask=0x01");
+PMU_EVENT_ATTR_STRING(l2_misses_dc,	 f16_l2_misses_dc,	"event=0x7e,umask=0x02");
+PMU_EVENT_ATTR_STRING(l2_misses_tlb,	 f16_l2_misses_tlb,	"event=0x7e,umask=0x04");
+PMU_EVENT_ATTR_STRING(l2_snoops,	 f16_l2_snoops,		"event=0x7d,umask=0x08");
+PMU_EVENT_ATTR_STRING(l2_writebacks,	 f16_l2_writebacks,	"event=0x7f,umask=0x02");
+
+PMU_EVENT_ATTR_STRING(dram_accesses,	 f16_nb_dram,		"event=0xe0,umask=0x07");
+PMU_EVENT_ATTR_STRING(probe_misses,	 f16_nb_probe_miss,	"event=0xec,umask=0x01");
+PMU_EVENT_ATTR_STRING(probe_hits,	 f16_nb_probe_hit,	"event=0xec,umask=0x0e");
+PMU_EVENT_ATTR_STRING(probe_hits_dirty,	 f16_nb_probe_dirty,	"event=0xec,umask=0x0c");
+PMU_EVENT_ATTR_STRING(upstream_reads,	 f16_nb_up_reads,	"event=0xec,umask=0x30");
+PMU_EVENT_ATTR_STRING(upstream_writes,	 f16_nb_up_writes,	"event=0xec,umask=0xc0");
+
+static struct attribute *amd_uncore_events_attr_l2_f16[] = {
+	&f16_l2_requests.attr.attr,
+	&f16_l2_misses.attr.attr,
+	&f16_l2_misses_ic.attr.attr,
+	&f16_l2_misses_dc.attr.attr,
+	&f16_l2_misses_tlb.attr.attr,
+	&f16_l2_snoops.attr.attr,
+	&f16_l2_writebacks.attr.attr,
+	NULL,
+};
+
+static struct attribute *amd_uncore_events_attr_nb_f16[] = {
+	&f16_nb_dram.attr.attr,
+	&f16_nb_probe_miss.attr.attr,
+	&f16_nb_probe_hit.attr.attr,
+	&f16_nb_probe_dirty.attr.attr,
+	&f16_nb_up_reads.attr.attr,
+	&f16_nb_up_writes.attr.attr,
+	NULL,
+};
+
+static struct attribute_group amd_uncore_events_group_l2_f16 = {
+	.name = "events",
+	.attrs = amd_uncore_events_attr_l2_f16,
+};
+
+static struct attribute_group amd_uncore_events_group_nb_f16 = {
+	.name = "events",
+	.attrs = amd_uncore_events_attr_nb_f16,
+};
+
+static const struct attribute_group *amd_uncore_attr_groups_l2_f16[] = {
+	&amd_uncore_attr_group,
+	&amd_uncore_format_group_l3,
+	&amd_uncore_events_group_l2_f16,
+	NULL,
+};
+
+static const struct attribute_group *amd_uncore_attr_groups_nb_f16[] = {
+	&amd_uncore_attr_group,
+	&amd_uncore_format_group_df,
+	&amd_uncore_events_group_nb_f16,
+	NULL,
+};
+
 static struct pmu amd_nb_pmu = {
 	.task_ctx_nr	= perf_invalid_context,
 	.event_init	= amd_uncore_event_init,
@@ -547,6 +615,11 @@ static int __init amd_uncore_init(void)
 	amd_nb_pmu.attr_groups	= amd_uncore_attr_groups_df;
 	amd_llc_pmu.attr_groups = amd_uncore_attr_groups_l3;
 
+	if (boot_cpu_data.x86 == 0x16) {
+		amd_nb_pmu.attr_groups	= amd_uncore_attr_groups_nb_f16;
+		amd_llc_pmu.attr_groups = amd_uncore_attr_groups_l2_f16;
+	}
+
 	if (boot_cpu_has(X86_FEATURE_PERFCTR_NB)) {
 		amd_uncore_nb = alloc_percpu(struct amd_uncore *);
 		if (!amd_uncore_nb) {
@@ -12,6 +12,7 @@
 #ifdef CONFIG_X86_PS4
 
 #include <linux/irqdomain.h>
+#include <linux/list.h>
 
 #define PS4_DEFAULT_TSC_FREQ 1594000000
 
@@ -29,6 +30,39 @@
 
 extern unsigned long ps4_calibrate_tsc(void);
 
+/*
+ * Completion callback for asynchronous ICC requests. Called from interrupt or
+ * timer context with the reply length, or a negative error (e.g. -ETIMEDOUT).
+ * Must not sleep, so follow-up requests have to be queued to process context.
+ */
+typedef void (*icc_done_t)(void *ctx, int ret);
+
+/* One request of a batch passed to apcie_icc_cmdv */
+struct icc_cmdv {
+	u8 major;
+	u16 minor;
+	const void *data;
+	u16 length;
+	void *reply;
+	u16 reply_length;
+	int ret;	/* reply length or negative error */
+};
+
+/*
+ * Subscriber for unsolicited ICC events. handler() is called in process
+ * context for every event with the given major and a minor (including the
+ * 0x8000 event flag) in [minor_first, minor_last]. data holds at most
+ * ICC_EVENT_MAX_DATA bytes of the event payload.
+ */
+struct icc_event_listener {
+	struct list_head list;
+	u8 major;
+	u16 minor_first;
+	u16 minor_last;
+	void (*handler)(struct icc_event_listener *l, u8 major, u16 minor,
+			const void *data, u16 length);
+};
+
 /*
  * The PS4 Aeolia southbridge device is a composite device containing some
  * standard-ish, some not-so-standard, and some completely custom functions,
@@ -45,6 +79,26 @@ extern int apcie_status(void);
 
 extern int apcie_icc_cmd(u8 major, u16 minor, const void *data,
 			 u16 length, void *reply, u16 reply_length);
+/*
+ * Like apcie_icc_cmd, but returns once the request has been handed to the
+ * southbridge. The request data may be reused right away; the reply buffer
+ * must stay valid until done() has been called. May sleep.
+ */
+extern int apcie_icc_cmd_async(u8 major, u16 minor, const void *data,
+			       u16 length, void *reply, u16 reply_length,
+			       icc_done_t done, void *ctx);
+/*
+ * Issue several independent requests at once and wait for all of them.
+ * Returns 0 or the first submission error; per-request results are stored
+ * in cmds[i].ret.
+ */
+extern int apcie_icc_cmdv(struct icc_cmdv *cmds, int count);
+/*
+ * Listeners may be registered before the southbridge has been probed.
+ * Once apcie_icc_unregister_event returns, handler() is no longer running.
+ */
+extern int apcie_icc_register_event(struct icc_event_listener *l);
+extern void apcie_icc_unregister_event(struct icc_event_listener *l);
 
 //Baikal		 
 extern int bpcie_assign_irqs(struct pci_dev *dev, int nvec);
@@ -53,10 +107,18 @@ extern void bpcie_free_irqs(unsigned int virq, unsigned int nr_irqs);
 extern int bpcie_status(void);
 extern int bpcie_icc_cmd(u8 major, u16 minor, const void *data,
 			 u16 length, void *reply, u16 reply_length);
+extern int bpcie_icc_cmd_async(u8 major, u16 minor, const void *data,
+			       u16 length, void *reply, u16 reply_length,
+			       icc_done_t done, void *ctx);
+extern int bpcie_icc_cmdv(struct icc_cmdv *cmds, int count);
 
 
 #else
 
+typedef void (*icc_done_t)(void *ctx, int ret);
+struct icc_cmdv;
+struct icc_event_listener;
+
 //Aeolia
 static inline int apcie_assign_irqs(struct pci_dev *dev, int nvec)
 {
@@ -74,6 +136,24 @@ static inline int apcie_icc_cmd(u8 major, u16 minor, const void *data,
 {
 	return -ENODEV;
 }
+static inline int apcie_icc_cmd_async(u8 major, u16 minor, const void *data,
+				      u16 length, void *reply,
+				      u16 reply_length, icc_done_t done,
+				      void *ctx)
+{
+	return -ENODEV;
+}
+static inline int apcie_icc_cmdv(struct icc_cmdv *cmds, int count)
+{
+	return -ENODEV;
+}
+static inline int apcie_icc_register_event(struct icc_event_listener *l)
+{
+	return -ENODEV;
+}
+static inline void apcie_icc_unregister_event(struct icc_event_listener *l)
+{
+}
 
 //Baikal
 static inline int bpcie_assign_irqs(struct pci_dev *dev, int nvec)
@@ -94,6 +174,17 @@ static inline int bpcie_icc_cmd(u8 major, u16 minor, const void *data,
 {
 	return -ENODEV;
 }
+static inline int bpcie_icc_cmd_async(u8 major, u16 minor, const void *data,
+				      u16 length, void *reply,
+				      u16 reply_length, icc_done_t done,
+				      void *ctx)
+{
+	return -ENODEV;
+}
+static inline int bpcie_icc_cmdv(struct icc_cmdv *cmds, int count)
+{
+	return -ENODEV;
+}
 
 #endif
 #endif
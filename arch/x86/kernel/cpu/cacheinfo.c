@@ -646,14 +646,42 @@ static int find_num_cache_leaves(struct cpuinfo_x86 *c)
 	return i;
 }
 
+/*
+ * LLC ID is calculated from the number of threads sharing the last
+ * cache leaf.
+ */
+static void amd_init_llc_id_from_leaf(struct cpuinfo_x86 *c, int cpu)
+{
+	u32 eax, ebx, ecx, edx, num_sharing_cache = 0;
+	u32 llc_index = find_num_cache_leaves(c) - 1;
+
+	cpuid_count(0x8000001d, llc_index, &eax, &ebx, &ecx, &edx);
+	if (eax)
+		num_sharing_cache = ((eax >> 14) & 0xfff) + 1;
+
+	if (num_sharing_cache) {
+		int bits = get_count_order(num_sharing_cache);
+
+		per_cpu(cpu_llc_id, cpu) = c->apicid >> bits;
+	}
+}
+
 void cacheinfo_amd_init_llc_id(struct cpuinfo_x86 *c, int cpu)
 {
 	/*
 	 * We may have multiple LLCs if L3 caches exist, so check if we
 	 * have an L3 cache by looking at the L3 cache CPUID leaf.
 	 */
-	if (!cpuid_edx(0x80000006))
+	if (!cpuid_edx(0x80000006)) {
+		/*
+		 * Family 16h has no L3 and the L2 is shared per compute
+		 * unit. Parts with more than one unit, like the two Jaguar
+		 * modules of the PS4 APU, have one LLC per unit.
+		 */
+		if (c->x86 == 0x16)
+			amd_init_llc_id_from_leaf(c, cpu);
 		return;
+	}
 
 	if (c->x86 < 0x17) {
 		/* LLC is at the node level. */
@@ -665,22 +693,7 @@ void cacheinfo_amd_init_llc_id(struct cpuinfo_x86 *c, int cpu)
 		 */
 		per_cpu(cpu_llc_id, cpu) = c->apicid >> 3;
 	} else {
-		/*
-		 * LLC ID is calculated from the number of threads sharing the
-		 * cache.
-		 * */
-		u32 eax, ebx, ecx, edx, num_sharing_cache = 0;
-		u32 llc_index = find_num_cache_leaves(c) - 1;
-
-		cpuid_count(0x8000001d, llc_index, &eax, &ebx, &ecx, &edx);
-		if (eax)
-			num_sharing_cache = ((eax >> 14) & 0xfff) + 1;
-
-		if (num_sharing_cache) {
-			int bits = get_count_order(num_sharing_cache);
-
-			per_cpu(cpu_llc_id, cpu) = c->apicid >> bits;
-		}
+		amd_init_llc_id_from_leaf(c, cpu);
 	}
 }
 
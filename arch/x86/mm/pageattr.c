@@ -17,6 +17,7 @@
 #include <linux/vmalloc.h>
 
 #include <asm/e820/api.h>
+#include <asm/mtrr.h>
 #include <asm/processor.h>
 #include <asm/tlbflush.h>
 #include <asm/sections.h>
@@ -67,6 +68,7 @@ static DEFINE_SPINLOCK(cpa_lock);
 #define CPA_ARRAY 2
 #define CPA_PAGES_ARRAY 4
 #define CPA_NO_CHECK_ALIAS 8 /* Do not search for aliases */
+#define CPA_COLLAPSE 16 /* Try to restore large pages afterwards */
 
 #ifdef CONFIG_PROC_FS
 static unsigned long direct_pages_count[PG_LEVEL_NUM];
@@ -85,9 +87,25 @@ static void split_page_count(int level)
 		return;
 
 	direct_pages_count[level]--;
+	if (system_state == SYSTEM_RUNNING) {
+		if (level == PG_LEVEL_2M)
+			count_vm_event(DIRECT_MAP_LEVEL2_SPLIT);
+		else if (level == PG_LEVEL_1G)
+			count_vm_event(DIRECT_MAP_LEVEL3_SPLIT);
+	}
 	direct_pages_count[level - 1] += PTRS_PER_PTE;
 }
 
+static void collapse_page_count(int level)
+{
+	direct_pages_count[level]++;
+	if (level == PG_LEVEL_2M)
+		count_vm_event(DIRECT_MAP_LEVEL2_COLLAPSE);
+	else if (level == PG_LEVEL_1G)
+		count_vm_event(DIRECT_MAP_LEVEL3_COLLAPSE);
+	direct_pages_count[level - 1] -= PTRS_PER_PTE;
+}
+
 void arch_report_meminfo(struct seq_file *m)
 {
 	seq_printf(m, "DirectMap4k:    %8lu kB\n",
@@ -105,6 +123,7 @@ void arch_report_meminfo(struct seq_file *m)
 }
 #else
 static inline void split_page_count(int level) { }
+static inline void collapse_page_count(int level) { }
 #endif
 
 #ifdef CONFIG_X86_CPA_STATISTICS
@@ -1061,6 +1080,192 @@ static int split_large_page(struct cpa_data *cpa, pte_t *kpte,
 	return 0;
 }
 
+/*
+ * Like pmd_set_huge(), never map a range whose MTRR type is not uniform
+ * with a large page. The AMD TSEG and MTRR-UC quirks split such ranges of
+ * the direct map on purpose.
+ */
+static bool collapse_mtrr_uniform(unsigned long pfn, unsigned long size)
+{
+	u64 start = PFN_PHYS(pfn);
+	u8 uniform;
+	u8 mtrr;
+
+	mtrr = mtrr_type_lookup(start, start + size, &uniform);
+	return mtrr == MTRR_TYPE_INVALID || uniform;
+}
+
+/*
+ * Undo the split of a direct map large page once all its small entries map
+ * contiguous memory with identical attributes again, e.g. after GPU pages
+ * went back from WC to WB. Page tables allocated at boot are reserved and
+ * are left alone, as they were 4k for a reason.
+ */
+static int collapse_pmd_page(pmd_t *pmd, unsigned long addr,
+			     struct list_head *pgtables)
+{
+	struct page *ptpage;
+	pte_t *pte, first;
+	unsigned long pfn;
+	pgprot_t pgprot;
+	int i;
+
+	if (pmd_none(*pmd) || pmd_large(*pmd))
+		return 0;
+
+	ptpage = pmd_page(*pmd);
+	if (PageReserved(ptpage))
+		return 0;
+
+	pte = pte_offset_kernel(pmd, addr);
+	first = *pte;
+	pfn = pte_pfn(first);
+	if (!pte_present(first) || (PFN_PHYS(pfn) & ~PMD_MASK))
+		return 0;
+	if (!collapse_mtrr_uniform(pfn, PMD_SIZE))
+		return 0;
+
+	for (i = 1; i < PTRS_PER_PTE; i++) {
+		pte_t entry = pte[i];
+
+		if (!pte_present(entry) ||
+		    pte_flags(entry) != pte_flags(first) ||
+		    pte_pfn(entry) != pfn + i)
+			return 0;
+	}
+
+	pgprot = pgprot_4k_2_large(pte_pgprot(first));
+	if (pgprot_val(static_protections(pgprot, addr, pfn, PTRS_PER_PTE,
+					  PMD_SIZE, CPA_DETECT)) !=
+	    pgprot_val(pgprot))
+		return 0;
+
+	pgprot_val(pgprot) |= _PAGE_PSE;
+	set_pmd(pmd, pfn_pmd(pfn, pgprot));
+	paravirt_release_pte(page_to_pfn(ptpage));
+	list_add(&ptpage->lru, pgtables);
+
+	if (pfn_range_is_mapped(pfn, pfn + 1))
+		collapse_page_count(PG_LEVEL_2M);
+
+	return 1;
+}
+
+static int collapse_pud_page(pud_t *pud, unsigned long addr,
+			     struct list_head *pgtables)
+{
+	struct page *pmdpage;
+	pmd_t *pmd, first;
+	unsigned long pfn;
+	int i;
+
+	if (!direct_gbpages || pud_none(*pud) || pud_large(*pud))
+		return 0;
+
+	pmdpage = pud_page(*pud);
+	if (PageReserved(pmdpage))
+		return 0;
+
+	pmd = pmd_offset(pud, addr);
+	first = *pmd;
+	pfn = pmd_pfn(first);
+	if (!pmd_large(first) || (PFN_PHYS(pfn) & ~PUD_MASK))
+		return 0;
+	if (!collapse_mtrr_uniform(pfn, PUD_SIZE))
+		return 0;
+
+	for (i = 1; i < PTRS_PER_PMD; i++) {
+		pmd_t entry = pmd[i];
+
+		if (!pmd_large(entry) ||
+		    pmd_flags(entry) != pmd_flags(first) ||
+		    pmd_pfn(entry) != pfn + i * PTRS_PER_PTE)
+			return 0;
+	}
+
+	if (pgprot_val(static_protections(pmd_pgprot(first), addr, pfn,
+					  PTRS_PER_PMD * PTRS_PER_PTE,
+					  PUD_SIZE, CPA_DETECT)) !=
+	    pgprot_val(pmd_pgprot(first)))
+		return 0;
+
+	set_pud(pud, pfn_pud(pfn, pmd_pgprot(first)));
+	paravirt_release_pmd(page_to_pfn(pmdpage));
+	list_add(&pmdpage->lru, pgtables);
+
+	if (pfn_range_is_mapped(pfn, pfn + 1))
+		collapse_page_count(PG_LEVEL_1G);
+
+	return 1;
+}
+
+static int collapse_large_pages(unsigned long addr, struct list_head *pgtables)
+{
+	int collapsed = 0;
+	pgd_t *pgd;
+	p4d_t *p4d;
+	pud_t *pud;
+	pmd_t *pmd;
+
+	spin_lock(&pgd_lock);
+
+	pgd = pgd_offset_k(addr);
+	if (pgd_none(*pgd))
+		goto out;
+	p4d = p4d_offset(pgd, addr);
+	if (p4d_none(*p4d) || p4d_large(*p4d))
+		goto out;
+	pud = pud_offset(p4d, addr);
+	if (pud_none(*pud) || pud_large(*pud))
+		goto out;
+	pmd = pmd_offset(pud, addr);
+
+	collapsed = collapse_pmd_page(pmd, addr & PMD_MASK, pgtables);
+	if (collapsed)
+		collapsed += collapse_pud_page(pud, addr & PUD_MASK, pgtables);
+out:
+	spin_unlock(&pgd_lock);
+	return collapsed;
+}
+
+static void cpa_collapse_large_pages(struct cpa_data *cpa)
+{
+	unsigned long addr, last = 0;
+	struct page *page, *tmp;
+	LIST_HEAD(pgtables);
+	int collapsed = 0;
+	unsigned long i;
+
+	if (!IS_ENABLED(CONFIG_X86_64) || debug_pagealloc_enabled())
+		return;
+
+	spin_lock(&cpa_lock);
+	for (i = 0; i < cpa->numpages; i++) {
+		addr = __cpa_addr(cpa, i) & PMD_MASK;
+		if (addr == last)
+			continue;
+		last = addr;
+
+		if (!within(addr, PAGE_OFFSET,
+			    PAGE_OFFSET + (max_pfn_mapped << PAGE_SHIFT)))
+			continue;
+
+		collapsed += collapse_large_pages(addr, &pgtables);
+	}
+	spin_unlock(&cpa_lock);
+
+	if (!collapsed)
+		return;
+
+	/* Paging structure caches may still point at the old tables */
+	flush_tlb_all();
+
+	list_for_each_entry_safe(page, tmp, &pgtables, lru) {
+		list_del(&page->lru);
+		__free_page(page);
+	}
+}
+
 static bool try_to_free_pte_page(pte_t *pte)
 {
 	int i;
@@ -1753,6 +1958,9 @@ static int change_page_attr_set_clr(unsigned long *addr, int numpages,
 	}
 
 	cpa_flush(&cpa, cache);
+
+	if (in_flag & CPA_COLLAPSE)
+		cpa_collapse_large_pages(&cpa);
 out:
 	return ret;
 }
@@ -1865,8 +2073,9 @@ int _set_memory_wt(unsigned long addr, int numpages)
 int _set_memory_wb(unsigned long addr, int numpages)
 {
 	/* WB cache mode is hard wired to all cache attribute bits being 0 */
-	return change_page_attr_clear(&addr, numpages,
-				      __pgprot(_PAGE_CACHE_MASK), 0);
+	return change_page_attr_set_clr(&addr, numpages, __pgprot(0),
+					__pgprot(_PAGE_CACHE_MASK), 0,
+					CPA_COLLAPSE, NULL);
 }
 
 int set_memory_wb(unsigned long addr, int numpages)
@@ -2083,8 +2292,10 @@ int set_pages_array_wb(struct page **pages, int numpages)
 	int i;
 
 	/* WB cache mode is hard wired to all cache attribute bits being 0 */
-	retval = cpa_clear_pages_array(pages, numpages,
-			__pgprot(_PAGE_CACHE_MASK));
+	retval = change_page_attr_set_clr(NULL, numpages, __pgprot(0),
+					  __pgprot(_PAGE_CACHE_MASK), 0,
+					  CPA_PAGES_ARRAY | CPA_COLLAPSE,
+					  pages);
 	if (retval)
 		return retval;
 
@@ -5506,21 +5506,26 @@ static inline void bfq_update_insert_stats(struct request_queue *q,
 
 static struct bfq_queue *bfq_init_rq(struct request *rq);
 
-static void bfq_insert_request(struct blk_mq_hw_ctx *hctx, struct request *rq,
-			       bool at_head)
+/*
+ * Must be called under spin_lock_irq(&bfqd->lock). The caller updates the
+ * insert stats with the returned queue only after dropping that lock, as
+ * bfq_update_insert_stats() takes q->queue_lock. Returns NULL if rq was
+ * merged into another request, in which case *cmd_flags is left alone,
+ * and the bfq_queue associated with rq (which may itself be NULL for
+ * requests put on the dispatch list) otherwise.
+ */
+static struct bfq_queue *bfq_insert_request_locked(struct request_queue *q,
+						   struct request *rq,
+						   bool at_head,
+						   bool *idle_timer_disabled,
+						   unsigned int *cmd_flags)
 {
-	struct request_queue *q = hctx->queue;
 	struct bfq_data *bfqd = q->elevator->elevator_data;
 	struct bfq_queue *bfqq;
-	bool idle_timer_disabled = false;
-	unsigned int cmd_flags;
 
-	spin_lock_irq(&bfqd->lock);
 	bfqq = bfq_init_rq(rq);
-	if (blk_mq_sched_try_insert_merge(q, rq)) {
-		spin_unlock_irq(&bfqd->lock);
-		return;
-	}
+	if (blk_mq_sched_try_insert_merge(q, rq))
+		return NULL;
 
 	blk_mq_sched_request_inserted(rq);
 
@@ -5530,7 +5535,7 @@ static void bfq_insert_request(struct blk_mq_hw_ctx *hctx, struct request *rq,
 		else
 			list_add_tail(&rq->queuelist, &bfqd->dispatch);
 	} else {
-		idle_timer_disabled = __bfq_insert_request(bfqd, rq);
+		*idle_timer_disabled = __bfq_insert_request(bfqd, rq);
 		/*
 		 * Update bfqq, because, if a queue merge has occurred
 		 * in __bfq_insert_request, then rq has been
@@ -5550,8 +5555,23 @@ static void bfq_insert_request(struct blk_mq_hw_ctx *hctx, struct request *rq,
 	 * may disappear afterwards (for example, because of a request
 	 * merge).
 	 */
-	cmd_flags = rq->cmd_flags;
+	*cmd_flags = rq->cmd_flags;
+
+	return bfqq;
+}
+
+static void bfq_insert_request(struct blk_mq_hw_ctx *hctx, struct request *rq,
+			       bool at_head)
+{
+	struct request_queue *q = hctx->queue;
+	struct bfq_data *bfqd = q->elevator->elevator_data;
+	struct bfq_queue *bfqq;
+	bool idle_timer_disabled = false;
+	unsigned int cmd_flags = 0;
 
+	spin_lock_irq(&bfqd->lock);
+	bfqq = bfq_insert_request_locked(q, rq, at_head, &idle_timer_disabled,
+					 &cmd_flags);
 	spin_unlock_irq(&bfqd->lock);
 
 	bfq_update_insert_stats(q, bfqq, idle_timer_disabled,
@@ -5561,6 +5581,31 @@ static void bfq_insert_request(struct blk_mq_hw_ctx *hctx, struct request *rq,
 static void bfq_insert_requests(struct blk_mq_hw_ctx *hctx,
 				struct list_head *list, bool at_head)
 {
+	struct bfq_data *bfqd = hctx->queue->elevator->elevator_data;
+
+	/*
+	 * Without group stats to update outside bfqd->lock, a plug flush
+	 * can insert its whole batch in one lock round trip instead of
+	 * one per request.
+	 */
+	if (!IS_ENABLED(CONFIG_BFQ_CGROUP_DEBUG)) {
+		bool idle_timer_disabled;
+		unsigned int cmd_flags;
+
+		spin_lock_irq(&bfqd->lock);
+		while (!list_empty(list)) {
+			struct request *rq;
+
+			rq = list_first_entry(list, struct request, queuelist);
+			list_del_init(&rq->queuelist);
+			bfq_insert_request_locked(hctx->queue, rq, at_head,
+						  &idle_timer_disabled,
+						  &cmd_flags);
+		}
+		spin_unlock_irq(&bfqd->lock);
+		return;
+	}
+
 	while (!list_empty(list)) {
 		struct request *rq;
 
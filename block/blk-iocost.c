@@ -49,6 +49,14 @@
  * If needed, tools/cgroup/iocost_coef_gen.py can be used to generate
  * device-specific coefficients.
  *
+ * Alternatively, "ctrl=learn" in io.cost.model (or blk_iocost.learn=1 for
+ * all devices) has the coefficients learned from completions.  Starting
+ * from the builtin defaults, each period dominated by one kind of IO - random
+ * 4k, sequential 4k or large sequential, reads or writes - gives a sample of
+ * the matching parameter.  Samples from periods where QoS targets were missed
+ * track the device capacity both ways, others can only raise it.  Learned
+ * parameters are installed every AUTOP_CYCLE_NSEC once they drifted enough.
+ *
  * 2. Control Strategy
  *
  * The device virtual time (vtime) is used as the primary control metric.
@@ -291,6 +299,19 @@ enum {
 	/* switch iff the conditions are met for longer than this */
 	AUTOP_CYCLE_NSEC	= 10LLU * NSEC_PER_SEC,
 
+	/*
+	 * Cost model learning: a period is a sample if at least 90% of its
+	 * IOs are of one kind and there are enough of them.  Samples are
+	 * folded in with 1/8 weight and the model is reinstalled when a
+	 * parameter drifted by more than 1/8.
+	 */
+	LEARN_MIN_IOS		= 32,
+	LEARN_DOMINANT_PCT	= 90,
+	LEARN_SMALL_PAGES	= 2,
+	LEARN_LARGE_PAGES	= 16,
+	LEARN_EWMA_SHIFT	= 3,
+	LEARN_DRIFT_SHIFT	= 3,
+
 	/*
 	 * Count IO size in 4k pages.  The 12bit shift helps keeping
 	 * size-proportional components of cost calculation in closer
@@ -381,8 +402,17 @@ struct ioc_missed {
 	u32				last_missed;
 };
 
+struct ioc_learn_stat {
+	u64				nr_seqio;
+	u64				nr_randio;
+	u64				seq_pages;
+	u64				rand_pages;
+};
+
 struct ioc_pcpu_stat {
 	struct ioc_missed		missed[2];
+	struct ioc_learn_stat		learn[2];
+	struct ioc_learn_stat		last_learn[2];
 
 	u64				rq_wait_ns;
 	u64				last_rq_wait_ns;
@@ -424,6 +454,12 @@ struct ioc {
 	int				autop_idx;
 	bool				user_qos_params:1;
 	bool				user_cost_model:1;
+	bool				learn_cost_model:1;
+
+	/* cost model learning */
+	u64				learn_cursor[2];
+	u64				learned_lcoefs[NR_I_LCOEFS];
+	u64				learn_applied_at;
 };
 
 /* per device-cgroup pair */
@@ -605,6 +641,10 @@ static u32 vrate_adj_pct[] =
 	  2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
 	  4, 4, 4, 4, 4, 4, 4, 4, 8, 8, 8, 8, 8, 8, 8, 8, 16 };
 
+static bool ioc_learn_dfl;
+module_param_named(learn, ioc_learn_dfl, bool, 0644);
+MODULE_PARM_DESC(learn, "Learn the cost model of devices without a user one");
+
 static struct blkcg_policy blkcg_policy_iocost;
 
 /* accessors and helpers */
@@ -736,7 +776,8 @@ static int ioc_autop_idx(struct ioc *ioc)
 		return AUTOP_SSD_DFL;
 
 	/* if user is overriding anything, maintain what was there */
-	if (ioc->user_qos_params || ioc->user_cost_model)
+	if (ioc->user_qos_params || ioc->user_cost_model ||
+	    ioc->learn_cost_model)
 		return idx;
 
 	/* step up/down based on the vrate */
@@ -835,7 +876,7 @@ static bool ioc_refresh_params(struct ioc *ioc, bool force)
 
 	if (!ioc->user_qos_params)
 		memcpy(ioc->params.qos, p->qos, sizeof(p->qos));
-	if (!ioc->user_cost_model)
+	if (!ioc->user_cost_model && !ioc->learn_cost_model)
 		memcpy(ioc->params.i_lcoefs, p->i_lcoefs, sizeof(p->i_lcoefs));
 
 	ioc_refresh_period_us(ioc);
@@ -849,6 +890,142 @@ static bool ioc_refresh_params(struct ioc *ioc, bool force)
 	return true;
 }
 
+/* start learning from the parameters currently in use */
+static void ioc_start_learning(struct ioc *ioc)
+{
+	lockdep_assert_held(&ioc->lock);
+
+	memcpy(ioc->learned_lcoefs, ioc->params.i_lcoefs,
+	       sizeof(ioc->learned_lcoefs));
+	ioc->learn_applied_at = ktime_get_ns();
+	ioc->learn_cost_model = true;
+}
+
+static void ioc_learn_account(struct ioc *ioc, struct request *rq, int rw)
+{
+	u64 sector = blk_rq_pos(rq);
+	u64 pages = max_t(u64, blk_rq_sectors(rq) >> IOC_SECT_TO_PAGE_SHIFT, 1);
+	u64 seek_pages;
+
+	/* completions race with each other, an approximate cursor is fine */
+	seek_pages = abs((s64)(sector - READ_ONCE(ioc->learn_cursor[rw])));
+	seek_pages >>= IOC_SECT_TO_PAGE_SHIFT;
+	WRITE_ONCE(ioc->learn_cursor[rw], sector + blk_rq_sectors(rq));
+
+	if (seek_pages > LCOEF_RANDIO_PAGES) {
+		this_cpu_inc(ioc->pcpu_stat->learn[rw].nr_randio);
+		this_cpu_add(ioc->pcpu_stat->learn[rw].rand_pages, pages);
+	} else {
+		this_cpu_inc(ioc->pcpu_stat->learn[rw].nr_seqio);
+		this_cpu_add(ioc->pcpu_stat->learn[rw].seq_pages, pages);
+	}
+}
+
+/* fold an observed rate into a learned parameter */
+static void ioc_learn_sample(u64 *param, u64 count, u32 period_us,
+			     bool saturated)
+{
+	u64 rate = div64_u64(count * USEC_PER_SEC, period_us);
+
+	/* an unsaturated device may well be capable of more */
+	if (!saturated && rate <= *param)
+		return;
+
+	if (!*param)
+		*param = rate;
+	else
+		*param += (s64)(rate - *param) >> LEARN_EWMA_SHIFT;
+}
+
+static bool ioc_learn_dominant(u64 part, u64 whole)
+{
+	return part * 100 >= whole * LEARN_DOMINANT_PCT;
+}
+
+/*
+ * Collect the completions of the period which just ended and learn from
+ * them.  @saturated tells whether the device missed the QoS targets.
+ */
+static void ioc_learn(struct ioc *ioc, bool saturated)
+{
+	struct ioc_learn_stat st[2] = { };
+	u64 *l = ioc->learned_lcoefs;
+	u64 *u = ioc->params.i_lcoefs;
+	u64 now_ns;
+	int cpu, rw, i;
+
+	lockdep_assert_held(&ioc->lock);
+
+	if (!ioc->learn_cost_model)
+		return;
+
+	for_each_online_cpu(cpu) {
+		struct ioc_pcpu_stat *stat = per_cpu_ptr(ioc->pcpu_stat, cpu);
+
+		for (rw = READ; rw <= WRITE; rw++) {
+			struct ioc_learn_stat *cur = &stat->learn[rw];
+			struct ioc_learn_stat *last = &stat->last_learn[rw];
+			struct ioc_learn_stat this = {
+				.nr_seqio = READ_ONCE(cur->nr_seqio),
+				.nr_randio = READ_ONCE(cur->nr_randio),
+				.seq_pages = READ_ONCE(cur->seq_pages),
+				.rand_pages = READ_ONCE(cur->rand_pages),
+			};
+
+			st[rw].nr_seqio += this.nr_seqio - last->nr_seqio;
+			st[rw].nr_randio += this.nr_randio - last->nr_randio;
+			st[rw].seq_pages += this.seq_pages - last->seq_pages;
+			st[rw].rand_pages += this.rand_pages - last->rand_pages;
+			*last = this;
+		}
+	}
+
+	for (rw = READ; rw <= WRITE; rw++) {
+		struct ioc_learn_stat *s = &st[rw];
+		u64 nr = s->nr_seqio + s->nr_randio;
+		u64 nr_all = nr + st[!rw].nr_seqio + st[!rw].nr_randio;
+		int bps = rw == READ ? I_LCOEF_RBPS : I_LCOEF_WBPS;
+		int seqiops = rw == READ ? I_LCOEF_RSEQIOPS : I_LCOEF_WSEQIOPS;
+		int randiops = rw == READ ? I_LCOEF_RRANDIOPS : I_LCOEF_WRANDIOPS;
+
+		if (nr < LEARN_MIN_IOS || !ioc_learn_dominant(nr, nr_all))
+			continue;
+
+		if (ioc_learn_dominant(s->nr_randio, nr)) {
+			if (s->rand_pages <= s->nr_randio * LEARN_SMALL_PAGES)
+				ioc_learn_sample(&l[randiops], s->nr_randio,
+						 ioc->period_us, saturated);
+		} else if (ioc_learn_dominant(s->nr_seqio, nr)) {
+			if (s->seq_pages >= s->nr_seqio * LEARN_LARGE_PAGES)
+				ioc_learn_sample(&l[bps],
+						 s->seq_pages * IOC_PAGE_SIZE,
+						 ioc->period_us, saturated);
+			else if (s->seq_pages <= s->nr_seqio * LEARN_SMALL_PAGES)
+				ioc_learn_sample(&l[seqiops], s->nr_seqio,
+						 ioc->period_us, saturated);
+		}
+	}
+
+	now_ns = ktime_get_ns();
+	if (now_ns - ioc->learn_applied_at < AUTOP_CYCLE_NSEC)
+		return;
+
+	for (i = 0; i < NR_I_LCOEFS; i++) {
+		u64 delta = abs((s64)(l[i] - u[i]));
+
+		if (delta > u[i] >> LEARN_DRIFT_SHIFT)
+			break;
+	}
+	if (i == NR_I_LCOEFS)
+		return;
+
+	/* vrate was compensating for the old model, start over */
+	memcpy(u, l, sizeof(ioc->learned_lcoefs));
+	ioc_refresh_lcoefs(ioc);
+	atomic64_set(&ioc->vtime_rate, VTIME_PER_USEC);
+	ioc->learn_applied_at = now_ns;
+}
+
 /* take a snapshot of the current [v]time and vrate */
 static void ioc_now(struct ioc *ioc, struct ioc_now *now)
 {
@@ -1355,6 +1532,7 @@ static void ioc_timer_fn(struct timer_list *timer)
 	u32 missed_ppm[2], rq_wait_pct;
 	u64 period_vtime;
 	int prev_busy_level, i;
+	bool saturated;
 
 	/* how were the latencies during the period? */
 	ioc_lat_stat(ioc, missed_ppm, &rq_wait_pct);
@@ -1543,9 +1721,10 @@ static void ioc_timer_fn(struct timer_list *timer)
 	 * and should increase vtime rate.
 	 */
 	prev_busy_level = ioc->busy_level;
-	if (rq_wait_pct > RQ_WAIT_BUSY_PCT ||
-	    missed_ppm[READ] > ppm_rthr ||
-	    missed_ppm[WRITE] > ppm_wthr) {
+	saturated = rq_wait_pct > RQ_WAIT_BUSY_PCT ||
+		    missed_ppm[READ] > ppm_rthr ||
+		    missed_ppm[WRITE] > ppm_wthr;
+	if (saturated) {
 		/* clearly missing QoS targets, slow down vrate */
 		ioc->busy_level = max(ioc->busy_level, 0);
 		ioc->busy_level++;
@@ -1632,6 +1811,7 @@ static void ioc_timer_fn(struct timer_list *timer)
 					   nr_shortages, nr_surpluses);
 	}
 
+	ioc_learn(ioc, saturated);
 	ioc_refresh_params(ioc, false);
 
 	/*
@@ -1910,6 +2090,9 @@ static void ioc_rqos_done(struct rq_qos *rqos, struct request *rq)
 		return;
 	}
 
+	if (ioc->learn_cost_model)
+		ioc_learn_account(ioc, rq, rw);
+
 	on_q_ns = ktime_get_ns() - rq->alloc_time_ns;
 	rq_wait_ns = rq->start_time_ns - rq->alloc_time_ns;
 
@@ -1989,6 +2172,8 @@ static int blk_iocost_init(struct request_queue *q)
 	spin_lock_irq(&ioc->lock);
 	ioc->autop_idx = AUTOP_INVALID;
 	ioc_refresh_params(ioc, true);
+	if (ioc_learn_dfl)
+		ioc_start_learning(ioc);
 	spin_unlock_irq(&ioc->lock);
 
 	rq_qos_add(q, rqos);
@@ -2360,7 +2545,8 @@ static u64 ioc_cost_model_prfill(struct seq_file *sf,
 	seq_printf(sf, "%s ctrl=%s model=linear "
 		   "rbps=%llu rseqiops=%llu rrandiops=%llu "
 		   "wbps=%llu wseqiops=%llu wrandiops=%llu\n",
-		   dname, ioc->user_cost_model ? "user" : "auto",
+		   dname, ioc->user_cost_model ? "user" :
+		   ioc->learn_cost_model ? "learn" : "auto",
 		   u[I_LCOEF_RBPS], u[I_LCOEF_RSEQIOPS], u[I_LCOEF_RRANDIOPS],
 		   u[I_LCOEF_WBPS], u[I_LCOEF_WSEQIOPS], u[I_LCOEF_WRANDIOPS]);
 	return 0;
@@ -2397,7 +2583,7 @@ static ssize_t ioc_cost_model_write(struct kernfs_open_file *of, char *input,
 	struct gendisk *disk;
 	struct ioc *ioc;
 	u64 u[NR_I_LCOEFS];
-	bool user;
+	bool user, learn;
 	char *p;
 	int ret;
 
@@ -2416,6 +2602,7 @@ static ssize_t ioc_cost_model_write(struct kernfs_open_file *of, char *input,
 	spin_lock_irq(&ioc->lock);
 	memcpy(u, ioc->params.i_lcoefs, sizeof(u));
 	user = ioc->user_cost_model;
+	learn = ioc->learn_cost_model;
 	spin_unlock_irq(&ioc->lock);
 
 	while ((p = strsep(&input, " \t\n"))) {
@@ -2430,11 +2617,12 @@ static ssize_t ioc_cost_model_write(struct kernfs_open_file *of, char *input,
 		switch (match_token(p, cost_ctrl_tokens, args)) {
 		case COST_CTRL:
 			match_strlcpy(buf, &args[0], sizeof(buf));
-			if (!strcmp(buf, "auto"))
-				user = false;
-			else if (!strcmp(buf, "user"))
+			user = learn = false;
+			if (!strcmp(buf, "user"))
 				user = true;
-			else
+			else if (!strcmp(buf, "learn"))
+				learn = true;
+			else if (strcmp(buf, "auto"))
 				goto einval;
 			continue;
 		case COST_MODEL:
@@ -2451,6 +2639,7 @@ static ssize_t ioc_cost_model_write(struct kernfs_open_file *of, char *input,
 			goto einval;
 		u[tok] = v;
 		user = true;
+		learn = false;
 	}
 
 	spin_lock_irq(&ioc->lock);
@@ -2460,7 +2649,11 @@ static ssize_t ioc_cost_model_write(struct kernfs_open_file *of, char *input,
 	} else {
 		ioc->user_cost_model = false;
 	}
+	/* learning resumes from the defaults, not the previous model */
+	ioc->learn_cost_model = false;
 	ioc_refresh_params(ioc, true);
+	if (learn)
+		ioc_start_learning(ioc);
 	spin_unlock_irq(&ioc->lock);
 
 	put_disk_and_module(disk);
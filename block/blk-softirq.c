@@ -8,6 +8,7 @@
 #include <linux/bio.h>
 #include <linux/blkdev.h>
 #include <linux/interrupt.h>
+#include <linux/llist.h>
 #include <linux/cpu.h>
 #include <linux/sched.h>
 #include <linux/sched/topology.h>
@@ -39,35 +40,49 @@ static __latent_entropy void blk_done_softirq(struct softirq_action *h)
 }
 
 #ifdef CONFIG_SMP
+/*
+ * Requests completed on behalf of another CPU are collected here, and only
+ * the first one queued sends an IPI: an interrupt completing a batch of
+ * requests for the same CPU costs one IPI instead of one per request.
+ */
+static DEFINE_PER_CPU(struct llist_head, blk_cpu_remote);
+static DEFINE_PER_CPU(call_single_data_t, blk_cpu_csd);
+
+static void blk_splice_remote(struct llist_node *entry)
+{
+	struct list_head *list = this_cpu_ptr(&blk_cpu_done);
+	struct request *rq, *next;
+
+	/* ipi_llist shares storage with ipi_list, so fetch next first */
+	llist_for_each_entry_safe(rq, next, llist_reverse_order(entry),
+				  ipi_llist)
+		list_add_tail(&rq->ipi_list, list);
+}
+
 static void trigger_softirq(void *data)
 {
-	struct request *rq = data;
+	struct llist_node *entry;
 	unsigned long flags;
-	struct list_head *list;
-
-	local_irq_save(flags);
-	list = this_cpu_ptr(&blk_cpu_done);
-	list_add_tail(&rq->ipi_list, list);
 
-	if (list->next == &rq->ipi_list)
-		raise_softirq_irqoff(BLOCK_SOFTIRQ);
+	entry = llist_del_all(this_cpu_ptr(&blk_cpu_remote));
+	if (!entry)
+		return;
 
+	local_irq_save(flags);
+	blk_splice_remote(entry);
+	raise_softirq_irqoff(BLOCK_SOFTIRQ);
 	local_irq_restore(flags);
 }
 
 /*
- * Setup and invoke a run of 'trigger_softirq' on the given cpu.
+ * Queue @rq for completion on the given cpu, kicking it if needed.
  */
 static int raise_blk_irq(int cpu, struct request *rq)
 {
 	if (cpu_online(cpu)) {
-		call_single_data_t *data = &rq->csd;
-
-		data->func = trigger_softirq;
-		data->info = rq;
-		data->flags = 0;
-
-		smp_call_function_single_async(cpu, data);
+		if (llist_add(&rq->ipi_llist, &per_cpu(blk_cpu_remote, cpu)))
+			smp_call_function_single_async(cpu,
+					&per_cpu(blk_cpu_csd, cpu));
 		return 0;
 	}
 
@@ -89,6 +104,9 @@ static int blk_softirq_cpu_dead(unsigned int cpu)
 	local_irq_disable();
 	list_splice_init(&per_cpu(blk_cpu_done, cpu),
 			 this_cpu_ptr(&blk_cpu_done));
+#ifdef CONFIG_SMP
+	blk_splice_remote(llist_del_all(&per_cpu(blk_cpu_remote, cpu)));
+#endif
 	raise_softirq_irqoff(BLOCK_SOFTIRQ);
 	local_irq_enable();
 
@@ -148,8 +166,13 @@ static __init int blk_softirq_init(void)
 {
 	int i;
 
-	for_each_possible_cpu(i)
+	for_each_possible_cpu(i) {
 		INIT_LIST_HEAD(&per_cpu(blk_cpu_done, i));
+#ifdef CONFIG_SMP
+		init_llist_head(&per_cpu(blk_cpu_remote, i));
+		per_cpu(blk_cpu_csd, i).func = trigger_softirq;
+#endif
+	}
 
 	open_softirq(BLOCK_SOFTIRQ, blk_done_softirq);
 	cpuhp_setup_state_nocalls(CPUHP_BLOCK_SOFTIRQ_DEAD,
@@ -112,6 +112,9 @@ enum {
 	KYBER_LATENCY_BUCKETS = 2 << KYBER_LATENCY_SHIFT,
 };
 
+/* Completions needed in a window before an auto-tuned target moves. */
+#define KYBER_AUTO_MIN_SAMPLES	16
+
 /*
  * We measure both the total latency and the I/O latency (i.e., latency after
  * submitting to the device).
@@ -132,6 +135,9 @@ static const char *kyber_latency_type_names[] = {
  */
 struct kyber_cpu_latency {
 	atomic_t buckets[KYBER_OTHER][2][KYBER_LATENCY_BUCKETS];
+	/* raw I/O latency, only sampled for auto-tuned domains */
+	atomic64_t io_lat_sum[KYBER_OTHER];
+	atomic_t io_lat_samples[KYBER_OTHER];
 };
 
 /*
@@ -175,6 +181,13 @@ struct kyber_queue_data {
 
 	/* Target latencies in nanoseconds. */
 	u64 latency_targets[KYBER_OTHER];
+
+	/*
+	 * Domains whose target was set to 0 derive it from the device: the
+	 * baseline follows the lowest mean I/O latency seen over a window.
+	 */
+	bool auto_target[KYBER_OTHER];
+	u64 io_lat_baseline[KYBER_OTHER];
 };
 
 struct kyber_hctx_data {
@@ -273,6 +286,43 @@ static void kyber_resize_domain(struct kyber_queue_data *kqd,
 	}
 }
 
+/*
+ * The baseline drops straight to a lower window mean, which is the device
+ * running uncongested, and creeps up by 1/16 of the difference otherwise, so
+ * that it follows a device that got slower without chasing its own queueing.
+ * The target is then set so that the baseline lands in the first histogram
+ * bucket, leaving the rest of the good buckets as headroom for the p99.
+ */
+static void kyber_update_auto_target(struct kyber_queue_data *kqd,
+				     unsigned int sched_domain)
+{
+	u64 sum = 0, mean, baseline;
+	unsigned int samples = 0;
+	int cpu;
+
+	for_each_online_cpu(cpu) {
+		struct kyber_cpu_latency *cpu_latency;
+
+		cpu_latency = per_cpu_ptr(kqd->cpu_latency, cpu);
+		sum += atomic64_xchg(&cpu_latency->io_lat_sum[sched_domain], 0);
+		samples += atomic_xchg(&cpu_latency->io_lat_samples[sched_domain],
+				       0);
+	}
+	if (samples < KYBER_AUTO_MIN_SAMPLES)
+		return;
+
+	mean = div_u64(sum, samples);
+	baseline = kqd->io_lat_baseline[sched_domain];
+	if (!baseline || mean < baseline)
+		baseline = mean;
+	else
+		baseline += (mean - baseline) >> 4;
+	baseline = max_t(u64, baseline, 1);
+
+	kqd->io_lat_baseline[sched_domain] = baseline;
+	kqd->latency_targets[sched_domain] = baseline << KYBER_LATENCY_SHIFT;
+}
+
 static void kyber_timer_fn(struct timer_list *t)
 {
 	struct kyber_queue_data *kqd = from_timer(kqd, t, timer);
@@ -293,6 +343,11 @@ static void kyber_timer_fn(struct timer_list *t)
 		}
 	}
 
+	for (sched_domain = 0; sched_domain < KYBER_OTHER; sched_domain++) {
+		if (kqd->auto_target[sched_domain])
+			kyber_update_auto_target(kqd, sched_domain);
+	}
+
 	/*
 	 * Check if any domains have a high I/O latency, which might indicate
 	 * congestion in the device. Note that we use the p90; we don't want to
@@ -650,6 +705,11 @@ static void kyber_completed_request(struct request *rq, u64 now)
 			   target, now - rq->start_time_ns);
 	add_latency_sample(cpu_latency, sched_domain, KYBER_IO_LATENCY, target,
 			   now - rq->io_start_time_ns);
+	if (kqd->auto_target[sched_domain]) {
+		atomic64_add(now - rq->io_start_time_ns,
+			     &cpu_latency->io_lat_sum[sched_domain]);
+		atomic_inc(&cpu_latency->io_lat_samples[sched_domain]);
+	}
 	put_cpu_ptr(kqd->cpu_latency);
 
 	timer_reduce(&kqd->timer, jiffies + HZ / 10);
@@ -863,6 +923,8 @@ static ssize_t kyber_##name##_lat_show(struct elevator_queue *e,	\
 {									\
 	struct kyber_queue_data *kqd = e->elevator_data;		\
 									\
+	if (kqd->auto_target[domain])					\
+		return sprintf(page, "0\n");				\
 	return sprintf(page, "%llu\n", kqd->latency_targets[domain]);	\
 }									\
 									\
@@ -877,7 +939,14 @@ static ssize_t kyber_##name##_lat_store(struct elevator_queue *e,	\
 	if (ret)							\
 		return ret;						\
 									\
-	kqd->latency_targets[domain] = nsec;				\
+	/* 0 means derive the target from the device's own latency */	\
+	if (!nsec) {							\
+		kqd->io_lat_baseline[domain] = 0;			\
+		kqd->auto_target[domain] = true;			\
+	} else {							\
+		kqd->auto_target[domain] = false;			\
+		kqd->latency_targets[domain] = nsec;			\
+	}								\
 									\
 	return count;							\
 }
@@ -963,6 +1032,23 @@ static int kyber_async_depth_show(void *data, struct seq_file *m)
 	return 0;
 }
 
+static int kyber_latency_targets_show(void *data, struct seq_file *m)
+{
+	struct request_queue *q = data;
+	struct kyber_queue_data *kqd = q->elevator->elevator_data;
+	unsigned int sched_domain;
+
+	for (sched_domain = 0; sched_domain < KYBER_OTHER; sched_domain++) {
+		seq_printf(m, "%s target=%llu", kyber_domain_names[sched_domain],
+			   kqd->latency_targets[sched_domain]);
+		if (kqd->auto_target[sched_domain])
+			seq_printf(m, " auto baseline=%llu",
+				   kqd->io_lat_baseline[sched_domain]);
+		seq_putc(m, '\n');
+	}
+	return 0;
+}
+
 static int kyber_cur_domain_show(void *data, struct seq_file *m)
 {
 	struct blk_mq_hw_ctx *hctx = data;
@@ -989,6 +1075,7 @@ static const struct blk_mq_debugfs_attr kyber_queue_debugfs_attrs[] = {
 	KYBER_QUEUE_DOMAIN_ATTRS(discard),
 	KYBER_QUEUE_DOMAIN_ATTRS(other),
 	{"async_depth", 0400, kyber_async_depth_show},
+	{"latency_targets", 0400, kyber_latency_targets_show},
 	{},
 };
 #undef KYBER_QUEUE_DOMAIN_ATTRS
@@ -19,13 +19,16 @@
 
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 
+#include <crypto/acompress.h>
 #include <crypto/aead.h>
 #include <crypto/hash.h>
 #include <crypto/skcipher.h>
+#include <linux/cpumask.h>
 #include <linux/err.h>
 #include <linux/fips.h>
 #include <linux/init.h>
 #include <linux/gfp.h>
+#include <linux/kthread.h>
 #include <linux/module.h>
 #include <linux/scatterlist.h>
 #include <linux/string.h>
@@ -1632,6 +1635,572 @@ static void test_cipher_speed(const char *algo, int enc, unsigned int secs,
 				   false);
 }
 
+/*
+ * Parallel speed tests (modes 700-702)
+ *
+ * par_threads kthreads are spread over the CPUs of par_cpus, one CPU each,
+ * and every thread keeps num_mb requests in flight on its own transform for
+ * sec seconds. This is what dm-crypt, zswap and btrfs compression look like
+ * on a multi-core machine; giving par_cpus one cluster at a time shows how
+ * an algorithm scales within and across clusters. The latency of every
+ * request is recorded in a log2 histogram with PAR_HIST_SUB_BITS of linear
+ * resolution per power of two.
+ */
+static char *par_cpus;
+static unsigned int par_threads;
+static unsigned int par_klen = 32;
+
+#define PAR_HIST_SUB_BITS	2
+#define PAR_HIST_BUCKETS	(64 << PAR_HIST_SUB_BITS)
+#define PAR_MAX_IVSIZE		32
+
+static const unsigned int par_sizes[] = { 512, 4096, 16384, 0 };
+
+enum tcrypt_par_op {
+	PAR_ENCRYPT,
+	PAR_DECRYPT,
+	PAR_DIGEST,
+	PAR_COMPRESS,
+	PAR_DECOMPRESS,
+};
+
+struct tcrypt_par_thread;
+
+struct tcrypt_par_slot {
+	struct tcrypt_par_thread *t;
+	union {
+		struct skcipher_request *sk_req;
+		struct acomp_req *ac_req;
+	};
+	struct scatterlist src;
+	struct scatterlist dst;
+	u8 *in;
+	u8 *out;
+	unsigned int clen;
+	u8 iv[PAR_MAX_IVSIZE];
+	ktime_t start;
+	bool busy;
+};
+
+struct tcrypt_par_test {
+	const char *algo;
+	enum tcrypt_par_op op;
+	unsigned int len;
+	unsigned int depth;
+	unsigned long end;
+	struct completion start;
+};
+
+struct tcrypt_par_thread {
+	struct tcrypt_par_test *test;
+	struct task_struct *task;
+	int cpu;
+	union {
+		struct crypto_skcipher *skcipher;
+		struct crypto_shash *shash;
+		struct crypto_acomp *acomp;
+	};
+	struct shash_desc *desc;
+	struct tcrypt_par_slot *slots;
+	spinlock_t lock;
+	wait_queue_head_t wait;
+	unsigned int inflight;
+	u64 ops;
+	ktime_t done_time;
+	struct completion done;
+	int err;
+	u32 hist[PAR_HIST_BUCKETS];
+};
+
+static unsigned int tcrypt_par_bucket(u64 ns)
+{
+	unsigned int msb;
+
+	if (ns < (1 << PAR_HIST_SUB_BITS))
+		return ns;
+
+	msb = fls64(ns) - 1;
+	return ((msb - PAR_HIST_SUB_BITS + 1) << PAR_HIST_SUB_BITS) |
+	       ((ns >> (msb - PAR_HIST_SUB_BITS)) &
+		((1 << PAR_HIST_SUB_BITS) - 1));
+}
+
+/* Largest latency that falls into bucket @b */
+static u64 tcrypt_par_bucket_max(unsigned int b)
+{
+	unsigned int msb;
+
+	if (b < (1 << PAR_HIST_SUB_BITS))
+		return b;
+
+	msb = (b >> PAR_HIST_SUB_BITS) + PAR_HIST_SUB_BITS - 1;
+	return (1ULL << msb) +
+	       ((u64)((b & ((1 << PAR_HIST_SUB_BITS) - 1)) + 1) <<
+		(msb - PAR_HIST_SUB_BITS)) - 1;
+}
+
+static void tcrypt_par_complete(struct tcrypt_par_slot *slot, int err)
+{
+	struct tcrypt_par_thread *t = slot->t;
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), slot->start));
+	unsigned long flags;
+
+	spin_lock_irqsave(&t->lock, flags);
+	t->hist[tcrypt_par_bucket(ns)]++;
+	t->ops++;
+	if (err && !t->err)
+		t->err = err;
+	WRITE_ONCE(slot->busy, false);
+	t->inflight--;
+	spin_unlock_irqrestore(&t->lock, flags);
+
+	wake_up(&t->wait);
+}
+
+static void tcrypt_par_done(struct crypto_async_request *req, int err)
+{
+	if (err == -EINPROGRESS)
+		return;
+
+	tcrypt_par_complete(req->data, err);
+}
+
+static void tcrypt_par_submit(struct tcrypt_par_thread *t,
+			      struct tcrypt_par_slot *slot)
+{
+	struct tcrypt_par_test *test = t->test;
+	int ret;
+
+	spin_lock_irq(&t->lock);
+	slot->busy = true;
+	t->inflight++;
+	spin_unlock_irq(&t->lock);
+
+	slot->start = ktime_get();
+
+	switch (test->op) {
+	case PAR_ENCRYPT:
+	case PAR_DECRYPT:
+		skcipher_request_set_crypt(slot->sk_req, &slot->src, &slot->src,
+					   test->len, slot->iv);
+		if (test->op == PAR_ENCRYPT)
+			ret = crypto_skcipher_encrypt(slot->sk_req);
+		else
+			ret = crypto_skcipher_decrypt(slot->sk_req);
+		break;
+	case PAR_DIGEST:
+		ret = crypto_shash_digest(t->desc, slot->in, test->len,
+					  slot->out);
+		break;
+	case PAR_COMPRESS:
+		acomp_request_set_params(slot->ac_req, &slot->src, &slot->dst,
+					 test->len, 2 * test->len);
+		ret = crypto_acomp_compress(slot->ac_req);
+		break;
+	case PAR_DECOMPRESS:
+		acomp_request_set_params(slot->ac_req, &slot->src, &slot->dst,
+					 slot->clen, test->len);
+		ret = crypto_acomp_decompress(slot->ac_req);
+		break;
+	default:
+		ret = -EINVAL;
+	}
+
+	if (ret != -EINPROGRESS && ret != -EBUSY)
+		tcrypt_par_complete(slot, ret);
+}
+
+static int tcrypt_par_fn(void *data)
+{
+	struct tcrypt_par_thread *t = data;
+	struct tcrypt_par_test *test = t->test;
+	unsigned int i;
+
+	wait_for_completion(&test->start);
+
+	while (time_before(jiffies, test->end) && !READ_ONCE(t->err)) {
+		for (i = 0; i < test->depth; i++)
+			if (!READ_ONCE(t->slots[i].busy))
+				tcrypt_par_submit(t, &t->slots[i]);
+
+		wait_event_timeout(t->wait,
+				   READ_ONCE(t->inflight) < test->depth, HZ);
+		cond_resched();
+	}
+
+	wait_event(t->wait, !READ_ONCE(t->inflight));
+	t->done_time = ktime_get();
+	complete(&t->done);
+
+	/* The task must stay around until kthread_stop() */
+	set_current_state(TASK_INTERRUPTIBLE);
+	while (!kthread_should_stop()) {
+		schedule();
+		set_current_state(TASK_INTERRUPTIBLE);
+	}
+	__set_current_state(TASK_RUNNING);
+
+	return 0;
+}
+
+/* Text-like input, so that compressors see something realistic */
+static void tcrypt_par_fill(u8 *buf, unsigned int len, unsigned int seed)
+{
+	unsigned int off = 0;
+
+	while (off < len) {
+		char line[48];
+		int n;
+
+		n = scnprintf(line, sizeof(line), "tcrypt %u block %u of %u\n",
+			      seed, off / 64, len / 64);
+		n = min_t(unsigned int, n, len - off);
+		memcpy(buf + off, line, n);
+		off += n;
+	}
+}
+
+static int tcrypt_par_prepare_decompress(struct tcrypt_par_thread *t,
+					 struct tcrypt_par_slot *slot)
+{
+	unsigned int len = t->test->len;
+	struct scatterlist dst;
+	struct crypto_wait wait;
+	u8 *buf;
+	int ret;
+
+	buf = kmalloc(2 * len, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	crypto_init_wait(&wait);
+	sg_init_one(&dst, buf, 2 * len);
+	acomp_request_set_callback(slot->ac_req, CRYPTO_TFM_REQ_MAY_BACKLOG,
+				   crypto_req_done, &wait);
+	acomp_request_set_params(slot->ac_req, &slot->src, &dst, len, 2 * len);
+	ret = crypto_wait_req(crypto_acomp_compress(slot->ac_req), &wait);
+	if (!ret) {
+		/* Decompress from the compressed copy into the output */
+		slot->clen = slot->ac_req->dlen;
+		memcpy(slot->in, buf, slot->clen);
+		sg_init_one(&slot->src, slot->in, slot->clen);
+		sg_init_one(&slot->dst, slot->out, len);
+	}
+
+	kfree(buf);
+	return ret;
+}
+
+static void tcrypt_par_free(struct tcrypt_par_thread *t)
+{
+	struct tcrypt_par_test *test = t->test;
+	unsigned int i;
+
+	for (i = 0; t->slots && i < test->depth; i++) {
+		struct tcrypt_par_slot *slot = &t->slots[i];
+
+		if (test->op == PAR_ENCRYPT || test->op == PAR_DECRYPT)
+			skcipher_request_free(slot->sk_req);
+		else if (test->op != PAR_DIGEST && slot->ac_req)
+			acomp_request_free(slot->ac_req);
+		kfree(slot->in);
+		kfree(slot->out);
+	}
+	kfree(t->slots);
+	kfree(t->desc);
+
+	switch (test->op) {
+	case PAR_ENCRYPT:
+	case PAR_DECRYPT:
+		if (!IS_ERR_OR_NULL(t->skcipher))
+			crypto_free_skcipher(t->skcipher);
+		break;
+	case PAR_DIGEST:
+		if (!IS_ERR_OR_NULL(t->shash))
+			crypto_free_shash(t->shash);
+		break;
+	default:
+		if (!IS_ERR_OR_NULL(t->acomp))
+			crypto_free_acomp(t->acomp);
+	}
+}
+
+static int tcrypt_par_setup(struct tcrypt_par_thread *t, unsigned int seed)
+{
+	struct tcrypt_par_test *test = t->test;
+	unsigned int len = test->len;
+	unsigned int i, ivsize = 0;
+	int ret;
+
+	switch (test->op) {
+	case PAR_ENCRYPT:
+	case PAR_DECRYPT: {
+		u8 key[64];
+
+		t->skcipher = crypto_alloc_skcipher(test->algo, 0, 0);
+		if (IS_ERR(t->skcipher))
+			return PTR_ERR(t->skcipher);
+
+		/* Distinct bytes, XTS rejects keys with equal halves */
+		if (par_klen > sizeof(key))
+			return -EINVAL;
+		for (i = 0; i < par_klen; i++)
+			key[i] = i;
+		ret = crypto_skcipher_setkey(t->skcipher, key, par_klen);
+		if (ret)
+			return ret;
+
+		ivsize = crypto_skcipher_ivsize(t->skcipher);
+		if (ivsize > PAR_MAX_IVSIZE)
+			return -EINVAL;
+		break;
+	}
+	case PAR_DIGEST:
+		t->shash = crypto_alloc_shash(test->algo, 0, 0);
+		if (IS_ERR(t->shash))
+			return PTR_ERR(t->shash);
+
+		t->desc = kzalloc(sizeof(*t->desc) +
+				  crypto_shash_descsize(t->shash), GFP_KERNEL);
+		if (!t->desc)
+			return -ENOMEM;
+		t->desc->tfm = t->shash;
+		break;
+	default:
+		t->acomp = crypto_alloc_acomp(test->algo, 0, 0);
+		if (IS_ERR(t->acomp))
+			return PTR_ERR(t->acomp);
+	}
+
+	t->slots = kcalloc(test->depth, sizeof(*t->slots), GFP_KERNEL);
+	if (!t->slots)
+		return -ENOMEM;
+
+	for (i = 0; i < test->depth; i++) {
+		struct tcrypt_par_slot *slot = &t->slots[i];
+
+		slot->t = t;
+		slot->in = kmalloc(2 * len, GFP_KERNEL);
+		slot->out = kmalloc(max_t(unsigned int, 2 * len,
+					  MAX_DIGEST_SIZE), GFP_KERNEL);
+		if (!slot->in || !slot->out)
+			return -ENOMEM;
+		tcrypt_par_fill(slot->in, len, seed + i);
+		sg_init_one(&slot->src, slot->in, len);
+		sg_init_one(&slot->dst, slot->out, 2 * len);
+		memset(slot->iv, 0xff, ivsize);
+
+		switch (test->op) {
+		case PAR_ENCRYPT:
+		case PAR_DECRYPT:
+			slot->sk_req = skcipher_request_alloc(t->skcipher,
+							      GFP_KERNEL);
+			if (!slot->sk_req)
+				return -ENOMEM;
+			skcipher_request_set_callback(slot->sk_req,
+						      CRYPTO_TFM_REQ_MAY_BACKLOG,
+						      tcrypt_par_done, slot);
+			break;
+		case PAR_DIGEST:
+			break;
+		default:
+			slot->ac_req = acomp_request_alloc(t->acomp);
+			if (!slot->ac_req)
+				return -ENOMEM;
+			if (test->op == PAR_DECOMPRESS) {
+				ret = tcrypt_par_prepare_decompress(t, slot);
+				if (ret)
+					return ret;
+			}
+			acomp_request_set_callback(slot->ac_req,
+						   CRYPTO_TFM_REQ_MAY_BACKLOG,
+						   tcrypt_par_done, slot);
+		}
+	}
+
+	return 0;
+}
+
+static const char *tcrypt_par_driver(struct tcrypt_par_thread *t)
+{
+	switch (t->test->op) {
+	case PAR_ENCRYPT:
+	case PAR_DECRYPT:
+		return get_driver_name(crypto_skcipher, t->skcipher);
+	case PAR_DIGEST:
+		return get_driver_name(crypto_shash, t->shash);
+	default:
+		return get_driver_name(crypto_acomp, t->acomp);
+	}
+}
+
+static void tcrypt_par_report(struct tcrypt_par_test *test,
+			      struct tcrypt_par_thread *threads,
+			      unsigned int nr, ktime_t start)
+{
+	static const unsigned int permille[] = { 500, 900, 990, 999 };
+	u64 lat[ARRAY_SIZE(permille)] = { };
+	u64 ops = 0, seen = 0, ns, target;
+	ktime_t end = start;
+	unsigned int i, b, p = 0;
+	u32 *hist;
+	int err = 0;
+
+	hist = kcalloc(PAR_HIST_BUCKETS, sizeof(*hist), GFP_KERNEL);
+	if (!hist)
+		return;
+
+	for (i = 0; i < nr; i++) {
+		ops += threads[i].ops;
+		if (ktime_after(threads[i].done_time, end))
+			end = threads[i].done_time;
+		if (threads[i].err && !err)
+			err = threads[i].err;
+		for (b = 0; b < PAR_HIST_BUCKETS; b++)
+			hist[b] += threads[i].hist[b];
+	}
+
+	if (err)
+		pr_err("%s: request failed: %d\n", test->algo, err);
+
+	for (b = 0; b < PAR_HIST_BUCKETS && p < ARRAY_SIZE(permille); b++) {
+		seen += hist[b];
+		while (p < ARRAY_SIZE(permille)) {
+			target = DIV_ROUND_UP_ULL(ops * permille[p], 1000);
+			if (!target || seen < target)
+				break;
+			lat[p++] = tcrypt_par_bucket_max(b);
+		}
+	}
+
+	ns = max_t(u64, ktime_to_ns(ktime_sub(end, start)), 1);
+	pr_info("%6u byte blocks: %llu ops/s, %llu MB/s, latency ns p50 %llu p90 %llu p99 %llu p99.9 %llu\n",
+		test->len, div64_u64(ops * NSEC_PER_SEC, ns),
+		div64_u64(ops * test->len * (NSEC_PER_SEC / 1000000), ns),
+		lat[0], lat[1], lat[2], lat[3]);
+
+	kfree(hist);
+}
+
+static void test_par_speed(const char *algo, enum tcrypt_par_op op, int secs,
+			   u32 depth)
+{
+	static const char * const op_name[] = {
+		[PAR_ENCRYPT]	 = "encryption",
+		[PAR_DECRYPT]	 = "decryption",
+		[PAR_DIGEST]	 = "digest",
+		[PAR_COMPRESS]	 = "compression",
+		[PAR_DECOMPRESS] = "decompression",
+	};
+	struct tcrypt_par_thread *threads;
+	struct tcrypt_par_test test;
+	cpumask_var_t cpus;
+	unsigned int i, nr;
+	const unsigned int *len;
+	ktime_t start;
+	int cpu, ret;
+
+	if (!zalloc_cpumask_var(&cpus, GFP_KERNEL))
+		return;
+
+	if (par_cpus) {
+		if (cpulist_parse(par_cpus, cpus)) {
+			pr_err("invalid par_cpus: %s\n", par_cpus);
+			goto out_free_mask;
+		}
+		cpumask_and(cpus, cpus, cpu_online_mask);
+	} else {
+		cpumask_copy(cpus, cpu_online_mask);
+	}
+	if (cpumask_empty(cpus)) {
+		pr_err("no online CPU in par_cpus\n");
+		goto out_free_mask;
+	}
+
+	nr = par_threads ?: cpumask_weight(cpus);
+	threads = kcalloc(nr, sizeof(*threads), GFP_KERNEL);
+	if (!threads)
+		goto out_free_mask;
+
+	test.algo = algo;
+	test.op = op;
+	test.depth = depth ?: 1;
+
+	for (len = par_sizes; *len; len++) {
+		test.len = *len;
+		init_completion(&test.start);
+
+		/* Threads go round-robin over the CPUs in the mask */
+		cpu = -1;
+		for (i = 0; i < nr; i++) {
+			struct tcrypt_par_thread *t = &threads[i];
+
+			memset(t, 0, sizeof(*t));
+			cpu = cpumask_next(cpu, cpus);
+			if (cpu >= nr_cpu_ids)
+				cpu = cpumask_first(cpus);
+
+			t->test = &test;
+			t->cpu = cpu;
+			spin_lock_init(&t->lock);
+			init_waitqueue_head(&t->wait);
+			init_completion(&t->done);
+
+			ret = tcrypt_par_setup(t, i * test.depth);
+			if (!ret) {
+				t->task = kthread_create_on_node(tcrypt_par_fn,
+						t, cpu_to_node(cpu),
+						"tcrypt/%u", i);
+				ret = PTR_ERR_OR_ZERO(t->task);
+			}
+			if (ret) {
+				pr_err("failed to set up %s on CPU %d: %d\n",
+				       algo, cpu, ret);
+				t->task = NULL;
+				tcrypt_par_free(t);
+				nr = i;
+				goto out_stop;
+			}
+			kthread_bind(t->task, cpu);
+			wake_up_process(t->task);
+		}
+
+		if (len == par_sizes)
+			pr_info("\ntesting parallel %s %s (%s), %u threads on CPUs %*pbl, depth %u\n",
+				algo, op_name[op], tcrypt_par_driver(&threads[0]),
+				nr, cpumask_pr_args(cpus), test.depth);
+
+		test.end = jiffies + (secs ?: 1) * HZ;
+		start = ktime_get();
+		complete_all(&test.start);
+
+		for (i = 0; i < nr; i++)
+			wait_for_completion(&threads[i].done);
+
+		tcrypt_par_report(&test, threads, nr, start);
+
+		for (i = 0; i < nr; i++) {
+			kthread_stop(threads[i].task);
+			tcrypt_par_free(&threads[i]);
+		}
+	}
+
+	goto out_free_threads;
+
+out_stop:
+	/* The threads set up so far have not started any work yet */
+	test.end = jiffies;
+	complete_all(&test.start);
+	for (i = 0; i < nr; i++) {
+		kthread_stop(threads[i].task);
+		tcrypt_par_free(&threads[i]);
+	}
+out_free_threads:
+	kfree(threads);
+out_free_mask:
+	free_cpumask_var(cpus);
+}
+
 static void test_available(void)
 {
 	char **name = check;
@@ -3013,6 +3582,20 @@ static int do_test(const char *alg, u32 type, u32 mask, int m, u32 num_mb)
 				       speed_template_8_32, num_mb);
 		break;
 
+	case 700:
+		test_par_speed(alg ?: "xts(aes)", PAR_ENCRYPT, sec, num_mb);
+		test_par_speed(alg ?: "xts(aes)", PAR_DECRYPT, sec, num_mb);
+		break;
+
+	case 701:
+		test_par_speed(alg ?: "crc32c", PAR_DIGEST, sec, num_mb);
+		break;
+
+	case 702:
+		test_par_speed(alg ?: "lz4", PAR_COMPRESS, sec, num_mb);
+		test_par_speed(alg ?: "lz4", PAR_DECOMPRESS, sec, num_mb);
+		break;
+
 	case 1000:
 		test_available();
 		break;
@@ -3075,7 +3658,13 @@ module_param(sec, uint, 0);
 MODULE_PARM_DESC(sec, "Length in seconds of speed tests "
 		      "(defaults to zero which uses CPU cycles instead)");
 module_param(num_mb, uint, 0000);
-MODULE_PARM_DESC(num_mb, "Number of concurrent requests to be used in mb speed tests (defaults to 8)");
+MODULE_PARM_DESC(num_mb, "Number of concurrent requests to be used in mb and parallel speed tests (defaults to 8)");
+module_param(par_cpus, charp, 0);
+MODULE_PARM_DESC(par_cpus, "CPU list for parallel speed tests (defaults to all online CPUs)");
+module_param(par_threads, uint, 0);
+MODULE_PARM_DESC(par_threads, "Number of threads in parallel speed tests (defaults to one per CPU)");
+module_param(par_klen, uint, 0);
+MODULE_PARM_DESC(par_klen, "Key length in bytes for parallel skcipher speed tests (defaults to 32)");
 
 MODULE_LICENSE("GPL");
 MODULE_DESCRIPTION("Quick & dirty crypto testing module");
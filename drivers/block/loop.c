@@ -71,6 +71,7 @@
 #include <linux/completion.h>
 #include <linux/highmem.h>
 #include <linux/kthread.h>
+#include <linux/sched/mm.h>
 #include <linux/splice.h>
 #include <linux/sysfs.h>
 #include <linux/miscdevice.h>
@@ -912,24 +913,21 @@ static void loop_config_discard(struct loop_device *lo)
 
 static void loop_unprepare_queue(struct loop_device *lo)
 {
-	kthread_flush_worker(&lo->worker);
-	kthread_stop(lo->worker_task);
-}
-
-static int loop_kthread_worker_fn(void *worker_ptr)
-{
-	current->flags |= PF_LESS_THROTTLE | PF_MEMALLOC_NOIO;
-	return kthread_worker_fn(worker_ptr);
+	destroy_workqueue(lo->workqueue);
 }
 
+/*
+ * Requests are handled by an unbound workqueue rather than a single
+ * kthread, so that IO to one image is spread over all CPUs instead of
+ * serialising on whichever core the worker happens to run on.
+ */
 static int loop_prepare_queue(struct loop_device *lo)
 {
-	kthread_init_worker(&lo->worker);
-	lo->worker_task = kthread_run(loop_kthread_worker_fn,
-			&lo->worker, "loop%d", lo->lo_number);
-	if (IS_ERR(lo->worker_task))
+	lo->workqueue = alloc_workqueue("loop%d",
+					WQ_UNBOUND | WQ_HIGHPRI | WQ_MEM_RECLAIM,
+					0, lo->lo_number);
+	if (!lo->workqueue)
 		return -ENOMEM;
-	set_user_nice(lo->worker_task, MIN_NICE);
 	return 0;
 }
 
@@ -1957,7 +1955,7 @@ static blk_status_t loop_queue_rq(struct blk_mq_hw_ctx *hctx,
 	} else
 #endif
 		cmd->css = NULL;
-	kthread_queue_work(&lo->worker, &cmd->work);
+	queue_work(lo->workqueue, &cmd->work);
 
 	return BLK_STS_OK;
 }
@@ -1983,12 +1981,18 @@ static void loop_handle_cmd(struct loop_cmd *cmd)
 	}
 }
 
-static void loop_queue_work(struct kthread_work *work)
+static void loop_queue_work(struct work_struct *work)
 {
 	struct loop_cmd *cmd =
 		container_of(work, struct loop_cmd, work);
+	unsigned long pflags = current->flags;
+	unsigned int noio_flags;
 
+	current->flags |= PF_LESS_THROTTLE;
+	noio_flags = memalloc_noio_save();
 	loop_handle_cmd(cmd);
+	memalloc_noio_restore(noio_flags);
+	current_restore_flags(pflags, PF_LESS_THROTTLE);
 }
 
 static int loop_init_request(struct blk_mq_tag_set *set, struct request *rq,
@@ -1996,7 +2000,7 @@ static int loop_init_request(struct blk_mq_tag_set *set, struct request *rq,
 {
 	struct loop_cmd *cmd = blk_mq_rq_to_pdu(rq);
 
-	kthread_init_work(&cmd->work, loop_queue_work);
+	INIT_WORK(&cmd->work, loop_queue_work);
 	return 0;
 }
 
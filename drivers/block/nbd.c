@@ -502,6 +502,50 @@ static int sock_xmit(struct nbd_device *nbd, int index, int send,
 	return result;
 }
 
+/*
+ * Send write payload by reference instead of copying it into the socket
+ * buffer.  The request only completes once the server has replied, so the
+ * page has reached the other end by the time its contents may change; slab
+ * pages can't be referenced by the network stack and still go through
+ * sock_xmit().
+ */
+static int sock_send_page(struct nbd_device *nbd, int index,
+			  struct bio_vec *bvec, int msg_flags, int *sent)
+{
+	struct nbd_config *config = nbd->config;
+	struct socket *sock = config->socks[index]->sock;
+	unsigned int offset = bvec->bv_offset;
+	unsigned int len = bvec->bv_len;
+	unsigned int noreclaim_flag;
+	int result;
+
+	if (unlikely(!sock)) {
+		dev_err_ratelimited(disk_to_dev(nbd->disk),
+			"Attempted send on closed socket in sock_send_page\n");
+		return -EINVAL;
+	}
+
+	noreclaim_flag = memalloc_noreclaim_save();
+	do {
+		sock->sk->sk_allocation = GFP_NOIO | __GFP_MEMALLOC;
+		result = kernel_sendpage(sock, bvec->bv_page, offset, len,
+					 msg_flags | MSG_NOSIGNAL);
+		if (result <= 0) {
+			if (result == 0)
+				result = -EPIPE;
+			break;
+		}
+		if (sent)
+			*sent += result;
+		offset += result;
+		len -= result;
+	} while (len);
+
+	memalloc_noreclaim_restore(noreclaim_flag);
+
+	return result;
+}
+
 /*
  * Different settings for sk->sk_sndtimeo can result in different return values
  * if there is a signal pending when we enter sendmsg, because reasons?
@@ -623,7 +667,18 @@ static int nbd_send_cmd(struct nbd_device *nbd, struct nbd_cmd *cmd, int index)
 				iov_iter_advance(&from, skip);
 				skip = 0;
 			}
-			result = sock_xmit(nbd, index, 1, &from, flags, &sent);
+			if (!PageSlab(bvec.bv_page)) {
+				unsigned int done = bvec.bv_len -
+						    iov_iter_count(&from);
+
+				bvec.bv_offset += done;
+				bvec.bv_len -= done;
+				result = sock_send_page(nbd, index, &bvec,
+							flags, &sent);
+			} else {
+				result = sock_xmit(nbd, index, 1, &from, flags,
+						   &sent);
+			}
 			if (result <= 0) {
 				if (was_interrupted(result)) {
 					/* We've already sent the header, we
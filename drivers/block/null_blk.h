@@ -67,6 +67,7 @@ struct nullb_device {
 	bool memory_backed; /* if data is stored in memory */
 	bool discard; /* if support discard */
 	bool zoned; /* if device is zoned */
+	bool bounce; /* if data is DMA mapped through a 31-bit mask */
 };
 
 struct nullb {
@@ -86,6 +87,7 @@ struct nullb {
 	struct nullb_queue *queues;
 	unsigned int nr_queues;
 	char disk_name[DISK_NAME_LEN];
+	struct device *dma_dev; /* 31-bit DMA device for bounce emulation */
 };
 
 #ifdef CONFIG_BLK_DEV_ZONED
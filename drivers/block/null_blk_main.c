@@ -9,6 +9,8 @@
 #include <linux/sched.h>
 #include <linux/fs.h>
 #include <linux/init.h>
+#include <linux/device.h>
+#include <linux/dma-mapping.h>
 #include "null_blk.h"
 
 #define PAGE_SECTORS_SHIFT	(PAGE_SHIFT - SECTOR_SHIFT)
@@ -193,6 +195,10 @@ static unsigned int g_zone_nr_conv;
 module_param_named(zone_nr_conv, g_zone_nr_conv, uint, 0444);
 MODULE_PARM_DESC(zone_nr_conv, "Number of conventional zones when block device is zoned. Default: 0");
 
+static bool g_bounce;
+module_param_named(bounce, g_bounce, bool, 0444);
+MODULE_PARM_DESC(bounce, "DMA map every data segment with a 31-bit mask, bouncing through swiotlb like Aeolia/Baikal devices. Default: false");
+
 static struct nullb_device *null_alloc_dev(void);
 static void null_free_dev(struct nullb_device *dev);
 static void null_del_dev(struct nullb *nullb);
@@ -299,6 +305,7 @@ NULLB_DEVICE_ATTR(cache_size, ulong);
 NULLB_DEVICE_ATTR(zoned, bool);
 NULLB_DEVICE_ATTR(zone_size, ulong);
 NULLB_DEVICE_ATTR(zone_nr_conv, uint);
+NULLB_DEVICE_ATTR(bounce, bool);
 
 static ssize_t nullb_device_power_show(struct config_item *item, char *page)
 {
@@ -415,6 +422,7 @@ static struct configfs_attribute *nullb_device_attrs[] = {
 	&nullb_device_attr_zoned,
 	&nullb_device_attr_zone_size,
 	&nullb_device_attr_zone_nr_conv,
+	&nullb_device_attr_bounce,
 	NULL,
 };
 
@@ -467,7 +475,7 @@ nullb_group_drop_item(struct config_group *group, struct config_item *item)
 
 static ssize_t memb_group_features_show(struct config_item *item, char *page)
 {
-	return snprintf(page, PAGE_SIZE, "memory_backed,discard,bandwidth,cache,badblocks,zoned,zone_size\n");
+	return snprintf(page, PAGE_SIZE, "memory_backed,discard,bandwidth,cache,badblocks,zoned,zone_size,bounce\n");
 }
 
 CONFIGFS_ATTR_RO(memb_group_, features);
@@ -529,6 +537,7 @@ static struct nullb_device *null_alloc_dev(void)
 	dev->zoned = g_zoned;
 	dev->zone_size = g_zone_size;
 	dev->zone_nr_conv = g_zone_nr_conv;
+	dev->bounce = g_bounce;
 	return dev;
 }
 
@@ -1183,6 +1192,59 @@ static inline blk_status_t null_handle_memory_backed(struct nullb_cmd *cmd,
 	return errno_to_blk_status(err);
 }
 
+static int null_bounce_bvec(struct device *ddev, struct bio_vec *bvec,
+			    bool is_write)
+{
+	/*
+	 * Nothing writes the bounce buffer of a read, so unmapping it
+	 * DMA_FROM_DEVICE would copy stale swiotlb contents over the data.
+	 * Map reads bidirectionally instead, the unmap then copies back what
+	 * the map copied in.
+	 */
+	enum dma_data_direction dir = is_write ? DMA_TO_DEVICE :
+						 DMA_BIDIRECTIONAL;
+	dma_addr_t addr;
+
+	addr = dma_map_page(ddev, bvec->bv_page, bvec->bv_offset,
+			    bvec->bv_len, dir);
+	if (dma_mapping_error(ddev, addr))
+		return -ENOMEM;
+	dma_unmap_page(ddev, addr, bvec->bv_len, dir);
+	return 0;
+}
+
+/*
+ * Map and unmap each segment against a device with the southbridge's 31-bit
+ * DMA mask. Pages above 2GB take the swiotlb slot allocation and copy a real
+ * Aeolia/Baikal driver pays, so the cost shows up in per-IO CPU time without
+ * any hardware behind it.
+ */
+static blk_status_t null_handle_bounce(struct nullb_cmd *cmd)
+{
+	struct nullb *nullb = cmd->nq->dev->nullb;
+	struct req_iterator iter;
+	struct bvec_iter bi;
+	struct bio_vec bvec;
+	int err;
+
+	if (cmd->nq->dev->queue_mode == NULL_Q_BIO) {
+		bio_for_each_segment(bvec, cmd->bio, bi) {
+			err = null_bounce_bvec(nullb->dma_dev, &bvec,
+					       op_is_write(bio_op(cmd->bio)));
+			if (err)
+				return BLK_STS_IOERR;
+		}
+	} else {
+		rq_for_each_segment(bvec, cmd->rq, iter) {
+			err = null_bounce_bvec(nullb->dma_dev, &bvec,
+					       op_is_write(req_op(cmd->rq)));
+			if (err)
+				return BLK_STS_IOERR;
+		}
+	}
+	return BLK_STS_OK;
+}
+
 static inline void nullb_complete_cmd(struct nullb_cmd *cmd)
 {
 	/* Complete IO by inline, softirq or timer */
@@ -1233,6 +1295,12 @@ static blk_status_t null_handle_cmd(struct nullb_cmd *cmd, sector_t sector,
 			goto out;
 	}
 
+	if (nullb->dma_dev && (op == REQ_OP_READ || op == REQ_OP_WRITE)) {
+		cmd->error = null_handle_bounce(cmd);
+		if (cmd->error != BLK_STS_OK)
+			goto out;
+	}
+
 	if (dev->memory_backed)
 		cmd->error = null_handle_memory_backed(cmd, op);
 
@@ -1382,6 +1450,36 @@ static void cleanup_queues(struct nullb *nullb)
 	kfree(nullb->queues);
 }
 
+static int null_setup_bounce(struct nullb *nullb)
+{
+	char name[DISK_NAME_LEN + 4];
+	struct device *ddev;
+	int ret;
+
+	snprintf(name, sizeof(name), "%s_dma", nullb->disk_name);
+	ddev = root_device_register(name);
+	if (IS_ERR(ddev))
+		return PTR_ERR(ddev);
+
+	ddev->dma_mask = &ddev->coherent_dma_mask;
+	ret = dma_set_mask_and_coherent(ddev, DMA_BIT_MASK(31));
+	if (ret) {
+		root_device_unregister(ddev);
+		return ret;
+	}
+
+	nullb->dma_dev = ddev;
+	return 0;
+}
+
+static void null_free_bounce(struct nullb *nullb)
+{
+	if (!nullb->dma_dev)
+		return;
+	root_device_unregister(nullb->dma_dev);
+	nullb->dma_dev = NULL;
+}
+
 static void null_del_dev(struct nullb *nullb)
 {
 	struct nullb_device *dev;
@@ -1408,6 +1506,7 @@ static void null_del_dev(struct nullb *nullb)
 	    nullb->tag_set == &nullb->__tag_set)
 		blk_mq_free_tag_set(nullb->tag_set);
 	put_disk(nullb->disk);
+	null_free_bounce(nullb);
 	cleanup_queues(nullb);
 	if (null_cache_active(nullb))
 		null_free_device_storage(nullb->dev, true);
@@ -1727,9 +1826,15 @@ static int null_add_dev(struct nullb_device *dev)
 
 	sprintf(nullb->disk_name, "nullb%d", nullb->index);
 
+	if (dev->bounce) {
+		rv = null_setup_bounce(nullb);
+		if (rv)
+			goto out_ida_free;
+	}
+
 	rv = null_gendisk_register(nullb);
 	if (rv)
-		goto out_ida_free;
+		goto out_free_bounce;
 
 	mutex_lock(&lock);
 	list_add_tail(&nullb->list, &nullb_list);
@@ -1737,6 +1842,8 @@ static int null_add_dev(struct nullb_device *dev)
 
 	return 0;
 
+out_free_bounce:
+	null_free_bounce(nullb);
 out_ida_free:
 	ida_free(&nullb_indexes, nullb->index);
 out_cleanup_zone:
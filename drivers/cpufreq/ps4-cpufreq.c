@@ -0,0 +1,200 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * ps4-cpufreq.c: P-state driver for the PS4's Jaguar cores
+ *
+ * The PS4 firmware has no _PSS objects, so acpi-cpufreq never binds. The
+ * P-states are still described in the family 16h P-state MSRs, and the
+ * cores switch between them on a write to the P-state control MSR, so
+ * this drives them from there directly.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/cpufreq.h>
+#include <linux/slab.h>
+
+#include <asm/msr.h>
+#include <asm/cpu_device_id.h>
+#include <asm/cpufeature.h>
+
+#define MSR_AMD_PSTATE_CUR_LIMIT	0xc0010061
+#define PSTATE_MAX_VAL(x)		(((x) >> 4) & 0x7)
+#define PSTATE_CUR_LIMIT(x)		((x) & 0x7)
+
+#define PSTATE_CMD_MASK			0x7
+#define PSTATE_DEF_EN			BIT_ULL(63)
+#define PSTATE_DEF_DID(x)		(((x) >> 6) & 0x7)
+#define PSTATE_DEF_FID(x)		((x) & 0x3f)
+
+#define PS4_PSTATES_MAX			8
+
+/* BKDG: up to a few tens of microseconds for the PLL and voltage to settle */
+#define PS4_TRANSITION_LATENCY		(30 * NSEC_PER_USEC)
+
+static struct cpufreq_frequency_table *ps4_freq_table;
+
+/* CoreCOF = 100MHz * (CpuFid + 0x10) / 2^CpuDid */
+static unsigned int ps4_pstate_khz(u64 def)
+{
+	if (PSTATE_DEF_DID(def) > 4)
+		return 0;
+	return 100000 * (PSTATE_DEF_FID(def) + 0x10) >> PSTATE_DEF_DID(def);
+}
+
+static unsigned int ps4_cpufreq_get(unsigned int cpu)
+{
+	struct cpufreq_policy *policy = cpufreq_cpu_get_raw(cpu);
+	struct cpufreq_frequency_table *pos;
+	u64 status;
+
+	if (!policy || rdmsrl_on_cpu(cpu, MSR_AMD_PERF_STATUS, &status))
+		return 0;
+
+	cpufreq_for_each_valid_entry(pos, policy->freq_table)
+		if (pos->driver_data == (status & PSTATE_CMD_MASK))
+			return pos->frequency;
+	return 0;
+}
+
+static int ps4_cpufreq_target_index(struct cpufreq_policy *policy,
+				    unsigned int index)
+{
+	return wrmsrl_on_cpu(policy->cpu, MSR_AMD_PERF_CTL,
+			     policy->freq_table[index].driver_data);
+}
+
+/*
+ * schedutil calls this on the CPU whose policy it is updating, so the
+ * request is a local MSR write with no IPI.
+ */
+static unsigned int ps4_cpufreq_fast_switch(struct cpufreq_policy *policy,
+					    unsigned int target_freq)
+{
+	int index = cpufreq_table_find_index_dl(policy, target_freq);
+
+	if (index < 0)
+		return 0;
+	wrmsrl(MSR_AMD_PERF_CTL, policy->freq_table[index].driver_data);
+	return policy->freq_table[index].frequency;
+}
+
+static int ps4_cpufreq_cpu_init(struct cpufreq_policy *policy)
+{
+	/*
+	 * Each core has its own P-state request; the module's clock follows
+	 * the fastest of its cores' requests. One policy per core lets an
+	 * idle core drop its vote without dragging a busy sibling with it.
+	 */
+	policy->freq_table = ps4_freq_table;
+	policy->cpuinfo.transition_latency = PS4_TRANSITION_LATENCY;
+	policy->fast_switch_possible = true;
+	return 0;
+}
+
+static struct cpufreq_driver ps4_cpufreq_driver = {
+	.name		= "ps4-cpufreq",
+	.flags		= CPUFREQ_CONST_LOOPS,
+	.verify		= cpufreq_generic_frequency_table_verify,
+	.target_index	= ps4_cpufreq_target_index,
+	.fast_switch	= ps4_cpufreq_fast_switch,
+	.get		= ps4_cpufreq_get,
+	.init		= ps4_cpufreq_cpu_init,
+	.attr		= cpufreq_generic_attr,
+};
+
+/*
+ * Build the table from the P-states the firmware enabled, restricted to
+ * the range the current-limit MSR allows. Without core performance boost
+ * software and hardware P-state numbers are the same, which is the only
+ * case handled here.
+ */
+static int __init ps4_cpufreq_build_table(void)
+{
+	struct cpufreq_frequency_table *table;
+	unsigned int first, last, i, n = 0;
+	u64 limit, def;
+
+	rdmsrl(MSR_AMD_PSTATE_CUR_LIMIT, limit);
+	first = PSTATE_CUR_LIMIT(limit);
+	last = PSTATE_MAX_VAL(limit);
+	if (last < first)
+		return -ENODEV;
+
+	table = kcalloc(PS4_PSTATES_MAX + 1, sizeof(*table), GFP_KERNEL);
+	if (!table)
+		return -ENOMEM;
+
+	for (i = first; i <= last; i++) {
+		unsigned int khz;
+
+		rdmsrl(MSR_AMD_PSTATE_DEF_BASE + i, def);
+		if (!(def & PSTATE_DEF_EN))
+			continue;
+		khz = ps4_pstate_khz(def);
+		if (!khz)
+			continue;
+
+		table[n].driver_data = i;
+		table[n].frequency = khz;
+		pr_debug("P%u: %u kHz\n", i, khz);
+		n++;
+	}
+	table[n].frequency = CPUFREQ_TABLE_END;
+
+	if (n < 2) {
+		pr_info("firmware enables only one P-state, nothing to scale\n");
+		kfree(table);
+		return -ENODEV;
+	}
+
+	ps4_freq_table = table;
+	return 0;
+}
+
+static const struct x86_cpu_id ps4_cpufreq_ids[] = {
+	X86_MATCH_VENDOR_FAM_MODEL_STEPPINGS_FEATURE(AMD, 0x16, X86_MODEL_ANY,
+						     X86_STEPPING_ANY,
+						     X86_FEATURE_HW_PSTATE,
+						     NULL),
+	{}
+};
+MODULE_DEVICE_TABLE(x86cpu, ps4_cpufreq_ids);
+
+static int __init ps4_cpufreq_init(void)
+{
+	int ret;
+
+	if (!x86_match_cpu(ps4_cpufreq_ids))
+		return -ENODEV;
+
+	if (boot_cpu_has(X86_FEATURE_CPB)) {
+		pr_info("boost P-states not supported\n");
+		return -ENODEV;
+	}
+
+	ret = ps4_cpufreq_build_table();
+	if (ret)
+		return ret;
+
+	ret = cpufreq_register_driver(&ps4_cpufreq_driver);
+	if (ret) {
+		kfree(ps4_freq_table);
+		ps4_freq_table = NULL;
+	}
+	return ret;
+}
+
+static void __exit ps4_cpufreq_exit(void)
+{
+	cpufreq_unregister_driver(&ps4_cpufreq_driver);
+	kfree(ps4_freq_table);
+}
+
+module_init(ps4_cpufreq_init);
+module_exit(ps4_cpufreq_exit);
+
+MODULE_DESCRIPTION("PS4 Jaguar P-state cpufreq driver");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,184 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * cpuidle driver for the PS4's Jaguar cores.
+ *
+ * The PS4 firmware has no _CST, so acpi_idle never registers and idle is
+ * HLT only, which clock-gates a core but never power-gates it. Family 16h
+ * enters its deeper C-states through an IO read from the range set up in
+ * the C-state base address MSR: the offset selects a C-state action, and
+ * the firmware's action table decides whether that means core C6 and, once
+ * every core in the module is there, module C6 with the L2 flushed.
+ */
+
+#include <linux/init.h>
+#include <linux/cpu.h>
+#include <linux/cpuidle.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/sched/idle.h>
+
+#include <asm/cpufeature.h>
+#include <asm/msr.h>
+#include <asm/io.h>
+
+#define MSR_AMD_CSTATE_BASE		0xc0010073
+#define CSTATE_BASE_ADDR(x)		((x) & 0xffff)
+#define CSTATE_ACTIONS			8
+
+/*
+ * Initial estimates for power-gating the core and refilling its caches;
+ * tune from measurements with the parameters below.
+ */
+static unsigned int c6_action = 1;
+module_param(c6_action, uint, 0444);
+MODULE_PARM_DESC(c6_action, "C-state action offset used for C6 (default 1)");
+
+static unsigned int c6_latency = 100;
+module_param(c6_latency, uint, 0444);
+MODULE_PARM_DESC(c6_latency, "C6 exit latency in us (default 100)");
+
+static unsigned int c6_residency = 400;
+module_param(c6_residency, uint, 0444);
+MODULE_PARM_DESC(c6_residency, "C6 target residency in us (default 400)");
+
+static u16 ps4_cstate_io;
+
+static int ps4_enter_c1(struct cpuidle_device *dev,
+			struct cpuidle_driver *drv, int index)
+{
+	if (current_clr_polling_and_test()) {
+		local_irq_enable();
+		return index;
+	}
+	default_idle();
+	return index;
+}
+
+/*
+ * The read doesn't complete until the core wakes again; a pending interrupt
+ * wakes it even with IF clear, as with acpi_idle's SYSTEMIO states.
+ */
+static int ps4_enter_c6(struct cpuidle_device *dev,
+			struct cpuidle_driver *drv, int index)
+{
+	if (current_clr_polling_and_test())
+		return index;
+	inb(ps4_cstate_io + c6_action);
+	return index;
+}
+
+static struct cpuidle_driver ps4_idle_driver = {
+	.name = "ps4_idle",
+	.owner = THIS_MODULE,
+	.states = {
+		{ /* entry 0 is for polling */ },
+		{
+			.enter			= ps4_enter_c1,
+			.exit_latency		= 1,
+			.target_residency	= 1,
+			.power_usage		= -1,
+			.name			= "C1",
+			.desc			= "HLT",
+		},
+		{
+			.enter			= ps4_enter_c6,
+			.power_usage		= -1,
+			.name			= "C6",
+			.desc			= "Jaguar core/module power gating",
+		},
+	},
+	.safe_state_index = 1,
+	.state_count = 3,
+};
+
+static struct cpuidle_device __percpu *ps4_idle_devices;
+static enum cpuhp_state ps4_idle_hp_state;
+
+static int ps4_idle_cpu_online(unsigned int cpu)
+{
+	struct cpuidle_device *dev;
+
+	dev = per_cpu_ptr(ps4_idle_devices, cpu);
+	if (!dev->registered) {
+		dev->cpu = cpu;
+		if (cpuidle_register_device(dev)) {
+			pr_notice("cpuidle_register_device %d failed!\n", cpu);
+			return -EIO;
+		}
+	}
+
+	return 0;
+}
+
+static int ps4_idle_cpu_offline(unsigned int cpu)
+{
+	struct cpuidle_device *dev;
+
+	dev = per_cpu_ptr(ps4_idle_devices, cpu);
+	if (dev->registered)
+		cpuidle_unregister_device(dev);
+
+	return 0;
+}
+
+static void ps4_idle_uninit(void)
+{
+	if (ps4_idle_hp_state)
+		cpuhp_remove_state(ps4_idle_hp_state);
+	cpuidle_unregister_driver(&ps4_idle_driver);
+
+	free_percpu(ps4_idle_devices);
+	ps4_idle_devices = NULL;
+}
+
+static int __init ps4_idle_init(void)
+{
+	struct cpuidle_driver *drv = &ps4_idle_driver;
+	struct cpuidle_state *c6 = &drv->states[2];
+	u64 base;
+	int ret;
+
+	if (boot_option_idle_override != IDLE_NO_OVERRIDE)
+		return -ENODEV;
+
+	if (boot_cpu_data.x86_vendor != X86_VENDOR_AMD ||
+	    boot_cpu_data.x86 != 0x16 || c6_action >= CSTATE_ACTIONS)
+		return -ENODEV;
+
+	/* No IO range means the firmware set up no C-state actions */
+	if (rdmsrl_safe(MSR_AMD_CSTATE_BASE, &base) ||
+	    !CSTATE_BASE_ADDR(base))
+		return -ENODEV;
+	ps4_cstate_io = CSTATE_BASE_ADDR(base);
+
+	c6->exit_latency = c6_latency;
+	c6->target_residency = max(c6_residency, c6_latency);
+	/* Without ARAT the local APIC timer dies with the core */
+	if (!boot_cpu_has(X86_FEATURE_ARAT))
+		c6->flags |= CPUIDLE_FLAG_TIMER_STOP;
+
+	cpuidle_poll_state_init(drv);
+
+	ret = cpuidle_register_driver(drv);
+	if (ret < 0)
+		return ret;
+
+	ps4_idle_devices = alloc_percpu(struct cpuidle_device);
+	if (ps4_idle_devices == NULL) {
+		cpuidle_unregister_driver(drv);
+		return -ENOMEM;
+	}
+
+	ret = cpuhp_setup_state(CPUHP_AP_ONLINE_DYN, "cpuidle/ps4:online",
+				ps4_idle_cpu_online, ps4_idle_cpu_offline);
+	if (ret < 0) {
+		ps4_idle_uninit();
+	} else {
+		ps4_idle_hp_state = ret;
+		ret = 0;
+	}
+
+	return ret;
+}
+
+device_initcall(ps4_idle_init);
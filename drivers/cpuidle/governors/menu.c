@@ -14,6 +14,7 @@
 #include <linux/ktime.h>
 #include <linux/hrtimer.h>
 #include <linux/tick.h>
+#include <linux/interrupt.h>
 #include <linux/sched.h>
 #include <linux/sched/loadavg.h>
 #include <linux/sched/stat.h>
@@ -266,6 +267,31 @@ static unsigned int get_typical_interval(struct menu_device *data,
 	goto again;
 }
 
+#ifdef CONFIG_CPU_IDLE_GOV_MENU_IRQ_TIMINGS
+/*
+ * Time until the next device interrupt predicted from the interval pattern
+ * of each interrupt on this CPU, or UINT_MAX if none of them is regular.
+ * Must be called with interrupts disabled.
+ */
+static unsigned int menu_next_irq_us(void)
+{
+	u64 now = local_clock();
+	u64 next = irq_timings_next_event(now);
+
+	if (next == U64_MAX)
+		return UINT_MAX;
+	if (next <= now)
+		return 0;
+
+	return min_t(u64, div_u64(next - now, NSEC_PER_USEC), UINT_MAX - 1);
+}
+#else
+static inline unsigned int menu_next_irq_us(void)
+{
+	return UINT_MAX;
+}
+#endif
+
 /**
  * menu_select - selects the next idle state to enter
  * @drv: cpuidle driver containing state data
@@ -280,7 +306,7 @@ static int menu_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
 	int i;
 	int idx;
 	unsigned int interactivity_req;
-	unsigned int predicted_us;
+	unsigned int predicted_us, next_irq_us;
 	unsigned long nr_iowaiters;
 	ktime_t delta_next;
 
@@ -318,8 +344,12 @@ static int menu_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
 					 RESOLUTION * DECAY);
 	/*
 	 * Use the lowest expected idle interval to pick the idle state.
+	 * The interrupt timings only cover device interrupts, so the
+	 * repeating pattern of past idle durations still applies on top.
 	 */
-	predicted_us = min(predicted_us, get_typical_interval(data, predicted_us));
+	next_irq_us = menu_next_irq_us();
+	predicted_us = min3(predicted_us, next_irq_us,
+			    get_typical_interval(data, predicted_us));
 
 	if (tick_nohz_tick_stopped()) {
 		/*
@@ -583,6 +613,9 @@ static struct cpuidle_governor menu_governor = {
  */
 static int __init init_menu(void)
 {
+#ifdef CONFIG_CPU_IDLE_GOV_MENU_IRQ_TIMINGS
+	irq_timings_enable();
+#endif
 	return cpuidle_register_governor(&menu_governor);
 }
 
@@ -112,6 +112,8 @@ struct amdgpu_mgpu_info
 extern int amdgpu_modeset;
 extern int amdgpu_vram_limit;
 extern int amdgpu_vis_vram_limit;
+extern int amdgpu_ps4_vram_reclaim;
+extern int amdgpu_ps4_cgcg;
 extern int amdgpu_gart_size;
 extern int amdgpu_gtt_size;
 extern int amdgpu_moverate;
@@ -122,6 +124,7 @@ extern int amdgpu_disp_priority;
 extern int amdgpu_hw_i2c;
 extern int amdgpu_pcie_gen2;
 extern int amdgpu_msi;
+extern int amdgpu_irq_thread;
 extern int amdgpu_dpm;
 extern int amdgpu_fw_load_type;
 extern int amdgpu_aspm;
@@ -167,6 +170,9 @@ extern int amdgpu_mcbp;
 extern int amdgpu_discovery;
 extern int amdgpu_mes;
 extern int amdgpu_noretry;
+extern int amdgpu_deferred_display;
+extern uint amdgpu_vramblk_size;
+extern int amdgpu_direct_submit;
 
 #ifdef CONFIG_DRM_AMDGPU_SI
 extern int amdgpu_si_support;
@@ -300,6 +306,8 @@ amdgpu_device_ip_get_ip_block(struct amdgpu_device *adev,
 int amdgpu_device_ip_block_add(struct amdgpu_device *adev,
 			       const struct amdgpu_ip_block_version *ip_block_version);
 
+int amdgpu_device_display_bringup(struct amdgpu_device *adev);
+
 /*
  * BIOS.
  */
@@ -323,6 +331,8 @@ struct amdgpu_clock {
 	uint32_t current_dispclk;
 	uint32_t dp_extclk;
 	uint32_t max_pixel_clock;
+	/* DENTIST VCO, the DCE8 audio DTO reference */
+	uint32_t vco_freq;
 };
 
 /* sub-allocation manager, it has to be protected by another lock.
@@ -485,6 +495,9 @@ struct amdgpu_cs_parser {
 
 	unsigned			num_post_deps;
 	struct amdgpu_cs_post_dep	*post_deps;
+
+	/* scheduling deadline, 0 if none was given */
+	ktime_t				deadline;
 };
 
 static inline u32 amdgpu_get_ib_value(struct amdgpu_cs_parser *p,
@@ -519,6 +532,7 @@ void amdgpu_device_wb_free(struct amdgpu_device *adev, u32 wb);
 /*
  * Benchmarking
  */
+extern const char *amdgpu_asic_name[];
 void amdgpu_benchmark(struct amdgpu_device *adev, int test_number);
 
 
@@ -874,6 +888,10 @@ struct amdgpu_device {
 
 	/* memory management */
 	struct amdgpu_mman		mman;
+	/* dmaengine memcpy channel on the mman ring */
+	struct amdgpu_dma_chan		*dma_chan;
+	/* swap-friendly block device on spare VRAM */
+	struct amdgpu_vramblk		*vramblk;
 	struct amdgpu_vram_scratch	vram_scratch;
 	struct amdgpu_wb		wb;
 	atomic64_t			num_bytes_moved;
@@ -893,6 +911,8 @@ struct amdgpu_device {
 
 	/* display */
 	bool				enable_virtual_display;
+	/* display hw left down until the first KMS client */
+	bool				display_deferred;
 	struct amdgpu_mode_info		mode_info;
 	/* For pre-DCE11. DCE11 and later are in "struct amdgpu_device->dm" */
 	struct work_struct		hotplug_work;
@@ -1157,6 +1177,7 @@ int emu_soc_asic_init(struct amdgpu_device *adev);
 
 /* Common functions */
 bool amdgpu_device_should_recover_gpu(struct amdgpu_device *adev);
+bool amdgpu_device_ring_can_soft_reset(struct amdgpu_ring *ring);
 int amdgpu_device_gpu_recover(struct amdgpu_device *adev,
 			      struct amdgpu_job* job);
 void amdgpu_device_pci_config_reset(struct amdgpu_device *adev);
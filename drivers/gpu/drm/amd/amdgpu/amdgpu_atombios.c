@@ -696,6 +696,14 @@ int amdgpu_atombios_get_clock_info(struct amdgpu_device *adev)
 		adev->mode_info.firmware_flags =
 			le16_to_cpu(firmware_info->info.usFirmwareCapability.susAccess);
 
+		if (crev >= 2)
+			adev->clock.vco_freq =
+				le32_to_cpu(firmware_info->info_22.ulGPUPLL_OutputFreq);
+		else
+			adev->clock.vco_freq = adev->clock.current_dispclk;
+		if (adev->clock.vco_freq == 0)
+			adev->clock.vco_freq = 360000;	/* 3.6 GHz */
+
 		ret = 0;
 	}
 
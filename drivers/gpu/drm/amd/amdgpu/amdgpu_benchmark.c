@@ -22,11 +22,18 @@
  * Authors: Jerome Glisse
  */
 
+#include <linux/ktime.h>
+#include <linux/vmalloc.h>
 #include <drm/amdgpu_drm.h>
 #include "amdgpu.h"
+#include "cikd.h"
 
 #define AMDGPU_BENCHMARK_ITERATIONS 1024
 #define AMDGPU_BENCHMARK_COMMON_MODES_N 17
+#define AMDGPU_BENCHMARK_CPU_ITERATIONS 64
+#define AMDGPU_BENCHMARK_GART_ITERATIONS 256
+/* BYTE_COUNT of a CP DMA_DATA packet is 21 bits */
+#define AMDGPU_BENCHMARK_CP_DMA_MAX_BYTES (1 << 20)
 
 static int amdgpu_benchmark_do_move(struct amdgpu_device *adev, unsigned size,
 				    uint64_t saddr, uint64_t daddr, int n)
@@ -58,16 +65,17 @@ static int amdgpu_benchmark_do_move(struct amdgpu_device *adev, unsigned size,
 }
 
 
-static void amdgpu_benchmark_log_results(int n, unsigned size,
+static void amdgpu_benchmark_log_results(struct amdgpu_device *adev,
+					 int n, unsigned size,
 					 unsigned int time,
 					 unsigned sdomain, unsigned ddomain,
 					 char *kind)
 {
 	unsigned int throughput = (n * (size >> 10)) / time;
-	DRM_INFO("amdgpu: %s %u bo moves of %u kB from"
+	DRM_INFO("amdgpu: [%s] %s %u bo moves of %u kB from"
 		 " %d to %d in %u ms, throughput: %u Mb/s or %u MB/s\n",
-		 kind, n, size >> 10, sdomain, ddomain, time,
-		 throughput * 8, throughput);
+		 amdgpu_asic_name[adev->asic_type], kind, n, size >> 10,
+		 sdomain, ddomain, time, throughput * 8, throughput);
 }
 
 static void amdgpu_benchmark_move(struct amdgpu_device *adev, unsigned size,
@@ -131,7 +139,7 @@ static void amdgpu_benchmark_move(struct amdgpu_device *adev, unsigned size,
 		if (time < 0)
 			goto out_cleanup;
 		if (time > 0)
-			amdgpu_benchmark_log_results(n, size, time,
+			amdgpu_benchmark_log_results(adev, n, size, time,
 						     sdomain, ddomain, "dma");
 	}
 
@@ -159,6 +167,289 @@ static void amdgpu_benchmark_move(struct amdgpu_device *adev, unsigned size,
 	}
 }
 
+static int amdgpu_benchmark_create_bo(struct amdgpu_device *adev,
+				      unsigned size, unsigned domain,
+				      u64 flags, struct amdgpu_bo **bo)
+{
+	struct amdgpu_bo_param bp;
+	int r;
+
+	memset(&bp, 0, sizeof(bp));
+	bp.size = size;
+	bp.byte_align = PAGE_SIZE;
+	bp.domain = domain;
+	bp.flags = flags;
+	bp.type = ttm_bo_type_kernel;
+	bp.resv = NULL;
+	r = amdgpu_bo_create(adev, &bp, bo);
+	if (r)
+		return r;
+
+	r = amdgpu_bo_reserve(*bo, false);
+	if (unlikely(r != 0))
+		goto error_unref;
+	r = amdgpu_bo_pin(*bo, domain);
+	if (r)
+		goto error_unreserve;
+	r = amdgpu_ttm_alloc_gart(&(*bo)->tbo);
+	if (r)
+		goto error_unpin;
+	amdgpu_bo_unreserve(*bo);
+	return 0;
+
+error_unpin:
+	amdgpu_bo_unpin(*bo);
+error_unreserve:
+	amdgpu_bo_unreserve(*bo);
+error_unref:
+	amdgpu_bo_unref(bo);
+	return r;
+}
+
+static void amdgpu_benchmark_free_bo(struct amdgpu_bo **bo)
+{
+	if (!*bo)
+		return;
+
+	if (likely(amdgpu_bo_reserve(*bo, true) == 0)) {
+		amdgpu_bo_unpin(*bo);
+		amdgpu_bo_unreserve(*bo);
+	}
+	amdgpu_bo_unref(bo);
+}
+
+static unsigned int amdgpu_benchmark_mbps(u64 bytes, s64 us)
+{
+	return us > 0 ? div64_u64(bytes, us) : 0;
+}
+
+/*
+ * Copy with the CP's DMA engine on the GFX ring, to compare against the
+ * SDMA copies the rest of the driver uses. CIK packet format.
+ */
+static int amdgpu_benchmark_cp_dma_copy(struct amdgpu_ring *ring,
+					uint64_t saddr, uint64_t daddr,
+					unsigned size, struct dma_fence **fence)
+{
+	struct amdgpu_device *adev = ring->adev;
+	unsigned num_loops = DIV_ROUND_UP(size, AMDGPU_BENCHMARK_CP_DMA_MAX_BYTES);
+	unsigned num_dw = ALIGN(num_loops * 7, 8);
+	struct amdgpu_job *job;
+	struct amdgpu_ib *ib;
+	unsigned i;
+	int r;
+
+	r = amdgpu_job_alloc_with_ib(adev, num_dw * 4, &job);
+	if (r)
+		return r;
+
+	ib = &job->ibs[0];
+	for (i = 0; i < num_loops; i++) {
+		unsigned cur = min(size, (unsigned)AMDGPU_BENCHMARK_CP_DMA_MAX_BYTES);
+
+		ib->ptr[ib->length_dw++] = PACKET3(PACKET3_DMA_DATA, 5);
+		/* make the CP wait for the last chunk before the fence */
+		ib->ptr[ib->length_dw++] = (i == num_loops - 1) ?
+			PACKET3_DMA_DATA_CP_SYNC : 0;
+		ib->ptr[ib->length_dw++] = lower_32_bits(saddr);
+		ib->ptr[ib->length_dw++] = upper_32_bits(saddr);
+		ib->ptr[ib->length_dw++] = lower_32_bits(daddr);
+		ib->ptr[ib->length_dw++] = upper_32_bits(daddr);
+		ib->ptr[ib->length_dw++] = cur;
+
+		saddr += cur;
+		daddr += cur;
+		size -= cur;
+	}
+
+	amdgpu_ring_pad_ib(ring, ib);
+	WARN_ON(ib->length_dw > num_dw);
+	r = amdgpu_job_submit_direct(job, ring, fence);
+	if (r)
+		amdgpu_job_free(job);
+	return r;
+}
+
+static int amdgpu_benchmark_do_cp_dma(struct amdgpu_device *adev,
+				      unsigned size, uint64_t saddr,
+				      uint64_t daddr, int n)
+{
+	struct amdgpu_ring *ring = &adev->gfx.gfx_ring[0];
+	struct dma_fence *fence = NULL;
+	unsigned long start_jiffies;
+	int i, r;
+
+	start_jiffies = jiffies;
+	for (i = 0; i < n; i++) {
+		r = amdgpu_benchmark_cp_dma_copy(ring, saddr, daddr, size,
+						 &fence);
+		if (r)
+			return r;
+		r = dma_fence_wait(fence, false);
+		dma_fence_put(fence);
+		if (r)
+			return r;
+	}
+	return jiffies_to_msecs(jiffies - start_jiffies);
+}
+
+/* Same BO pair copied by SDMA and by the CP */
+static void amdgpu_benchmark_engines(struct amdgpu_device *adev,
+				     unsigned size, unsigned sdomain,
+				     unsigned ddomain)
+{
+	struct amdgpu_bo *sobj = NULL, *dobj = NULL;
+	int n = AMDGPU_BENCHMARK_ITERATIONS;
+	uint64_t saddr, daddr;
+	int time, r;
+
+	r = amdgpu_benchmark_create_bo(adev, size, sdomain, 0, &sobj);
+	if (r)
+		goto out_cleanup;
+	r = amdgpu_benchmark_create_bo(adev, size, ddomain, 0, &dobj);
+	if (r)
+		goto out_cleanup;
+	saddr = amdgpu_bo_gpu_offset(sobj);
+	daddr = amdgpu_bo_gpu_offset(dobj);
+
+	if (adev->mman.buffer_funcs) {
+		time = amdgpu_benchmark_do_move(adev, size, saddr, daddr, n);
+		if (time < 0) {
+			r = time;
+			goto out_cleanup;
+		}
+		if (time > 0)
+			amdgpu_benchmark_log_results(adev, n, size, time,
+						     sdomain, ddomain, "sdma");
+	}
+
+	if ((adev->family == AMDGPU_FAMILY_CI ||
+	     adev->family == AMDGPU_FAMILY_KV) &&
+	    adev->gfx.num_gfx_rings && adev->gfx.gfx_ring[0].sched.ready) {
+		time = amdgpu_benchmark_do_cp_dma(adev, size, saddr, daddr, n);
+		if (time < 0) {
+			r = time;
+			goto out_cleanup;
+		}
+		if (time > 0)
+			amdgpu_benchmark_log_results(adev, n, size, time,
+						     sdomain, ddomain, "cp dma");
+	}
+
+out_cleanup:
+	if (r)
+		DRM_ERROR("Error while benchmarking copy engines.\n");
+	amdgpu_benchmark_free_bo(&sobj);
+	amdgpu_benchmark_free_bo(&dobj);
+}
+
+/*
+ * CPU write and read bandwidth through a kernel mapping of a BO. VRAM is
+ * mapped write-combined through the BAR; GTT is either cached or USWC
+ * depending on flags.
+ */
+static void amdgpu_benchmark_cpu_access(struct amdgpu_device *adev,
+					unsigned size, unsigned domain,
+					u64 flags, const char *kind)
+{
+	int n = AMDGPU_BENCHMARK_CPU_ITERATIONS;
+	struct amdgpu_bo *bo = NULL;
+	void *ptr, *scratch;
+	s64 write_us, read_us;
+	ktime_t start;
+	int i, r;
+
+	scratch = vmalloc(size);
+	if (!scratch)
+		return;
+
+	r = amdgpu_benchmark_create_bo(adev, size, domain,
+				       flags | AMDGPU_GEM_CREATE_CPU_ACCESS_REQUIRED,
+				       &bo);
+	if (r)
+		goto out_cleanup;
+	r = amdgpu_bo_reserve(bo, false);
+	if (unlikely(r != 0))
+		goto out_cleanup;
+	r = amdgpu_bo_kmap(bo, &ptr);
+	amdgpu_bo_unreserve(bo);
+	if (r)
+		goto out_cleanup;
+
+	start = ktime_get();
+	for (i = 0; i < n; i++)
+		memset(ptr, i, size);
+	write_us = ktime_us_delta(ktime_get(), start);
+
+	start = ktime_get();
+	for (i = 0; i < n; i++)
+		memcpy(scratch, ptr, size);
+	read_us = ktime_us_delta(ktime_get(), start);
+
+	DRM_INFO("amdgpu: [%s] cpu %s %u kB x %d: write %u MB/s, read %u MB/s\n",
+		 amdgpu_asic_name[adev->asic_type], kind, size >> 10, n,
+		 amdgpu_benchmark_mbps((u64)size * n, write_us),
+		 amdgpu_benchmark_mbps((u64)size * n, read_us));
+
+	if (likely(amdgpu_bo_reserve(bo, true) == 0)) {
+		amdgpu_bo_kunmap(bo);
+		amdgpu_bo_unreserve(bo);
+	}
+
+out_cleanup:
+	if (r)
+		DRM_ERROR("Error while benchmarking CPU access.\n");
+	amdgpu_benchmark_free_bo(&bo);
+	vfree(scratch);
+}
+
+/*
+ * Rate of rewriting the GART entries of a bound GTT BO, including the
+ * HDP and TLB flushes that come with every bind and unbind. The BO is
+ * left bound to its original pages.
+ */
+static void amdgpu_benchmark_gart(struct amdgpu_device *adev, unsigned size)
+{
+	int n = AMDGPU_BENCHMARK_GART_ITERATIONS;
+	int pages = size >> PAGE_SHIFT;
+	struct amdgpu_bo *bo = NULL;
+	struct ttm_dma_tt *dma_tt;
+	uint64_t offset, flags;
+	ktime_t start;
+	s64 us;
+	int i, r;
+
+	r = amdgpu_benchmark_create_bo(adev, size, AMDGPU_GEM_DOMAIN_GTT, 0,
+				       &bo);
+	if (r)
+		goto out_cleanup;
+
+	dma_tt = container_of(bo->tbo.ttm, struct ttm_dma_tt, ttm);
+	offset = amdgpu_bo_gpu_offset(bo) - adev->gmc.gart_start;
+	flags = amdgpu_ttm_tt_pte_flags(adev, bo->tbo.ttm, &bo->tbo.mem);
+
+	start = ktime_get();
+	for (i = 0; i < n; i++) {
+		r = amdgpu_gart_unbind(adev, offset, pages);
+		if (!r)
+			r = amdgpu_gart_bind(adev, offset, pages,
+					     bo->tbo.ttm->pages,
+					     dma_tt->dma_address, flags);
+		if (r)
+			goto out_cleanup;
+	}
+	us = ktime_us_delta(ktime_get(), start);
+
+	DRM_INFO("amdgpu: [%s] gart %d unmap/map cycles of %d pages in %lld us, %llu pages/s\n",
+		 amdgpu_asic_name[adev->asic_type], n, pages, us,
+		 us > 0 ? div64_u64((u64)pages * n * USEC_PER_SEC, us) : 0);
+
+out_cleanup:
+	if (r)
+		DRM_ERROR("Error while benchmarking GART.\n");
+	amdgpu_benchmark_free_bo(&bo);
+}
+
 void amdgpu_benchmark(struct amdgpu_device *adev, int test_number)
 {
 	int i;
@@ -237,6 +528,39 @@ void amdgpu_benchmark(struct amdgpu_device *adev, int test_number)
 					      AMDGPU_GEM_DOMAIN_VRAM,
 					      AMDGPU_GEM_DOMAIN_VRAM);
 		break;
+	case 9:
+		/* SDMA vs CP DMA copies */
+		amdgpu_benchmark_engines(adev, 1024*1024, AMDGPU_GEM_DOMAIN_VRAM,
+					 AMDGPU_GEM_DOMAIN_VRAM);
+		amdgpu_benchmark_engines(adev, 1024*1024, AMDGPU_GEM_DOMAIN_GTT,
+					 AMDGPU_GEM_DOMAIN_VRAM);
+		amdgpu_benchmark_engines(adev, 1024*1024, AMDGPU_GEM_DOMAIN_VRAM,
+					 AMDGPU_GEM_DOMAIN_GTT);
+		break;
+	case 10:
+		/* CPU access through WC and cached mappings */
+		amdgpu_benchmark_cpu_access(adev, 1920 * 1080 * 4,
+					    AMDGPU_GEM_DOMAIN_VRAM, 0,
+					    "vram wc");
+		amdgpu_benchmark_cpu_access(adev, 1920 * 1080 * 4,
+					    AMDGPU_GEM_DOMAIN_GTT,
+					    AMDGPU_GEM_CREATE_CPU_GTT_USWC,
+					    "gtt uswc");
+		amdgpu_benchmark_cpu_access(adev, 1920 * 1080 * 4,
+					    AMDGPU_GEM_DOMAIN_GTT, 0,
+					    "gtt cached");
+		break;
+	case 11:
+		/* GART unmap/map, buffer size sweep, powers of 2 */
+		for (i = 1; i <= 4096; i <<= 2)
+			amdgpu_benchmark_gart(adev, i * PAGE_SIZE);
+		break;
+	case 12:
+		/* all of the memory path benchmarks above */
+		amdgpu_benchmark(adev, 9);
+		amdgpu_benchmark(adev, 10);
+		amdgpu_benchmark(adev, 11);
+		break;
 
 	default:
 		DRM_ERROR("Unknown benchmark\n");
@@ -102,6 +102,12 @@ static int amdgpu_cs_bo_handles_chunk(struct amdgpu_cs_parser *p,
 	return r;
 }
 
+static void amdgpu_cs_deadline_chunk(struct amdgpu_cs_parser *p,
+				     struct drm_amdgpu_cs_chunk_deadline *data)
+{
+	p->deadline = ns_to_ktime(data->deadline_ns);
+}
+
 static int amdgpu_cs_parser_init(struct amdgpu_cs_parser *p, union drm_amdgpu_cs *cs)
 {
 	struct amdgpu_fpriv *fpriv = p->filp->driver_priv;
@@ -212,6 +218,16 @@ static int amdgpu_cs_parser_init(struct amdgpu_cs_parser *p, union drm_amdgpu_cs
 
 			break;
 
+		case AMDGPU_CHUNK_ID_DEADLINE:
+			size = sizeof(struct drm_amdgpu_cs_chunk_deadline);
+			if (p->chunks[i].length_dw * sizeof(uint32_t) < size) {
+				ret = -EINVAL;
+				goto free_partial_kdata;
+			}
+
+			amdgpu_cs_deadline_chunk(p, p->chunks[i].kdata);
+			break;
+
 		case AMDGPU_CHUNK_ID_DEPENDENCIES:
 		case AMDGPU_CHUNK_ID_SYNCOBJ_IN:
 		case AMDGPU_CHUNK_ID_SYNCOBJ_OUT:
@@ -413,8 +429,14 @@ static int amdgpu_cs_bo_validate(struct amdgpu_cs_parser *p,
 
 	/* Don't move this buffer if we have depleted our allowance
 	 * to move it. Don't move anything if the threshold is zero.
+	 * With unified memory don't move it if it is already placed
+	 * somewhere it is allowed to be.
 	 */
-	if (p->bytes_moved < p->bytes_moved_threshold) {
+	if (amdgpu_gmc_bo_move_pointless(&adev->gmc,
+			amdgpu_mem_type_to_domain(bo->tbo.mem.mem_type),
+			bo->allowed_domains)) {
+		domain = bo->allowed_domains;
+	} else if (p->bytes_moved < p->bytes_moved_threshold) {
 		if (!amdgpu_gmc_vram_full_visible(&adev->gmc) &&
 		    (bo->flags & AMDGPU_GEM_CREATE_CPU_ACCESS_REQUIRED)) {
 			/* And don't move a CPU_ACCESS_REQUIRED BO to limited
@@ -432,6 +454,17 @@ static int amdgpu_cs_bo_validate(struct amdgpu_cs_parser *p,
 		domain = bo->allowed_domains;
 	}
 
+	/* Steady state resubmission: nothing moved the BO since an earlier
+	 * submission validated it for the same placement, so TTM would find
+	 * it compatible anyway. Pipeline gutting doesn't call move_notify,
+	 * hence the memory type check.
+	 */
+	if (bo->cs_valid_seq == bo->move_seq &&
+	    bo->cs_valid_domain == domain &&
+	    bo->cs_valid_flags == bo->flags &&
+	    bo->cs_valid_mem_type == bo->tbo.mem.mem_type)
+		return 0;
+
 retry:
 	amdgpu_bo_placement_from_domain(bo, domain);
 	r = ttm_bo_validate(&bo->tbo, &bo->placement, &ctx);
@@ -446,6 +479,13 @@ static int amdgpu_cs_bo_validate(struct amdgpu_cs_parser *p,
 		goto retry;
 	}
 
+	if (!r) {
+		bo->cs_valid_seq = bo->move_seq;
+		bo->cs_valid_domain = domain;
+		bo->cs_valid_flags = bo->flags;
+		bo->cs_valid_mem_type = bo->tbo.mem.mem_type;
+	}
+
 	return r;
 }
 
@@ -1277,6 +1317,7 @@ static int amdgpu_cs_submit(struct amdgpu_cs_parser *p,
 	struct amdgpu_ring *ring;
 	struct amdgpu_bo_list_entry *e;
 	struct amdgpu_job *job;
+	bool direct = READ_ONCE(amdgpu_direct_submit);
 	uint64_t seq;
 	int r;
 
@@ -1287,6 +1328,9 @@ static int amdgpu_cs_submit(struct amdgpu_cs_parser *p,
 	if (r)
 		goto error_unlock;
 
+	if (p->deadline)
+		drm_sched_job_set_deadline(&job->base, p->deadline);
+
 	/* No memory allocation is allowed while holding the mn lock.
 	 * p->mn is hold until amdgpu_cs_submit is finished and fence is added
 	 * to BOs.
@@ -1326,7 +1370,9 @@ static int amdgpu_cs_submit(struct amdgpu_cs_parser *p,
 	trace_amdgpu_cs_ioctl(job);
 	amdgpu_vm_bo_trace_cs(&fpriv->vm, &p->ticket);
 	priority = job->base.s_priority;
-	drm_sched_entity_push_job(&job->base, entity);
+	job->push_time = ktime_get();
+	if (!direct)
+		drm_sched_entity_push_job(&job->base, entity);
 
 	ring = to_amdgpu_ring(entity->rq->sched);
 	amdgpu_ring_priority_get(ring, priority);
@@ -1336,6 +1382,14 @@ static int amdgpu_cs_submit(struct amdgpu_cs_parser *p,
 	ttm_eu_fence_buffer_objects(&p->ticket, &p->validated, p->fence);
 	amdgpu_mn_unlock(p->mn);
 
+	/*
+	 * Running the job allocates memory, so it has to wait for the mn
+	 * lock to be dropped. The BOs are already fenced, the ctx lock
+	 * still keeps the jobs of the entity in order.
+	 */
+	if (direct)
+		drm_sched_entity_push_job_direct(&job->base, entity);
+
 	return 0;
 
 error_abort:
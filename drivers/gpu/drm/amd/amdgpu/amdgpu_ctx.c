@@ -109,6 +109,10 @@ static int amdgpu_ctx_init(struct amdgpu_device *adev,
 	for (i = 1; i < AMDGPU_HW_IP_NUM; ++i)
 		ctx->entities[i] = ctx->entities[i - 1] +
 			amdgpu_ctx_num_entities[i - 1];
+	for (i = 0; i < AMDGPU_HW_IP_NUM; ++i)
+		for (j = 0; j < amdgpu_ctx_num_entities[i]; ++j)
+			ctx->entities[i][j].seqno_slot =
+				AMDGPU_CTX_SEQNO_SLOT(i, j);
 
 	kref_init(&ctx->refcount);
 	spin_lock_init(&ctx->ring_lock);
@@ -214,12 +218,29 @@ static void amdgpu_ctx_fini(struct kref *ref)
 	if (!adev)
 		return;
 
-	for (i = 0; i < num_entities; ++i)
-		for (j = 0; j < amdgpu_sched_jobs; ++j)
-			dma_fence_put(ctx->entities[0][i].fences[j]);
+	for (i = 0; i < num_entities; ++i) {
+		struct amdgpu_ctx_entity *centity = &ctx->entities[0][i];
+
+		for (j = 0; j < amdgpu_sched_jobs; ++j) {
+			if (centity->seqno_cbs && centity->fences[j])
+				dma_fence_remove_callback(centity->fences[j],
+						&centity->seqno_cbs[j].cb);
+			dma_fence_put(centity->fences[j]);
+		}
+	}
 	kfree(ctx->fences);
 	kfree(ctx->entities[0]);
 
+	if (ctx->seqno_bo) {
+		if (likely(amdgpu_bo_reserve(ctx->seqno_bo, true) == 0)) {
+			amdgpu_bo_kunmap(ctx->seqno_bo);
+			amdgpu_bo_unpin(ctx->seqno_bo);
+			amdgpu_bo_unreserve(ctx->seqno_bo);
+		}
+		drm_gem_object_put_unlocked(&ctx->seqno_bo->tbo.base);
+	}
+	kfree(ctx->seqno_cbs);
+
 	mutex_destroy(&ctx->lock);
 
 	kfree(ctx);
@@ -379,6 +400,145 @@ static int amdgpu_ctx_query2(struct amdgpu_device *adev,
 	return 0;
 }
 
+static void amdgpu_ctx_seqno_update(uint64_t *cpu_addr, uint64_t seq)
+{
+	uint64_t old = READ_ONCE(*cpu_addr);
+
+	/* Fences of one entity may signal out of order across rings */
+	while (old < seq) {
+		uint64_t prev = cmpxchg64(cpu_addr, old, seq);
+
+		if (prev == old)
+			break;
+		old = prev;
+	}
+}
+
+static void amdgpu_ctx_seqno_func(struct dma_fence *fence,
+				  struct dma_fence_cb *cb)
+{
+	struct amdgpu_ctx_seqno_cb *scb =
+		container_of(cb, struct amdgpu_ctx_seqno_cb, cb);
+
+	amdgpu_ctx_seqno_update(scb->cpu_addr, scb->seq);
+}
+
+static void amdgpu_ctx_seqno_arm(struct amdgpu_ctx *ctx,
+				 struct amdgpu_ctx_entity *centity,
+				 struct dma_fence *fence, uint64_t seq)
+{
+	struct amdgpu_ctx_seqno_cb *scb =
+		&centity->seqno_cbs[seq & (amdgpu_sched_jobs - 1)];
+
+	scb->cpu_addr = &ctx->seqno_cpu_addr[centity->seqno_slot];
+	scb->seq = seq;
+	if (dma_fence_add_callback(fence, &scb->cb, amdgpu_ctx_seqno_func))
+		amdgpu_ctx_seqno_update(scb->cpu_addr, seq);
+}
+
+static int amdgpu_ctx_seqno_page_init(struct amdgpu_ctx *ctx)
+{
+	unsigned num_entities = amdgpu_ctx_total_num_entities();
+	struct amdgpu_device *adev = ctx->adev;
+	struct drm_gem_object *gobj;
+	struct amdgpu_bo *bo;
+	void *cpu_addr;
+	unsigned i, j;
+	int r;
+
+	BUILD_BUG_ON(AMDGPU_CTX_SEQNO_SLOT(AMDGPU_HW_IP_NUM, 0) *
+		     sizeof(uint64_t) > PAGE_SIZE);
+
+	ctx->seqno_cbs = kcalloc(amdgpu_sched_jobs * num_entities,
+				 sizeof(*ctx->seqno_cbs), GFP_KERNEL);
+	if (!ctx->seqno_cbs)
+		return -ENOMEM;
+	for (i = 0; i < amdgpu_sched_jobs * num_entities; ++i)
+		INIT_LIST_HEAD(&ctx->seqno_cbs[i].cb.node);
+
+	/* A device BO so that it gets an mmap offset, pinned for the CPU */
+	r = amdgpu_gem_object_create(adev, PAGE_SIZE, PAGE_SIZE,
+				     AMDGPU_GEM_DOMAIN_GTT, 0,
+				     ttm_bo_type_device, NULL, &gobj);
+	if (r)
+		goto error_free_cbs;
+	bo = gem_to_amdgpu_bo(gobj);
+
+	r = amdgpu_bo_reserve(bo, false);
+	if (r)
+		goto error_put;
+
+	r = amdgpu_bo_pin(bo, AMDGPU_GEM_DOMAIN_GTT);
+	if (r)
+		goto error_unreserve;
+
+	r = amdgpu_bo_kmap(bo, &cpu_addr);
+	if (r)
+		goto error_unpin;
+	amdgpu_bo_unreserve(bo);
+
+	memset(cpu_addr, 0, PAGE_SIZE);
+	ctx->seqno_bo = bo;
+	ctx->seqno_cpu_addr = cpu_addr;
+
+	/* Catch up with the submissions made before the page existed */
+	for (i = 0; i < num_entities; ++i) {
+		struct amdgpu_ctx_entity *centity = &ctx->entities[0][i];
+		uint64_t seq;
+
+		centity->seqno_cbs = &ctx->seqno_cbs[amdgpu_sched_jobs * i];
+		seq = centity->sequence > amdgpu_sched_jobs ?
+			centity->sequence - amdgpu_sched_jobs : 1;
+		for (; seq < centity->sequence; ++seq) {
+			j = seq & (amdgpu_sched_jobs - 1);
+			if (centity->fences[j])
+				amdgpu_ctx_seqno_arm(ctx, centity,
+						     centity->fences[j], seq);
+		}
+	}
+
+	return 0;
+
+error_unpin:
+	amdgpu_bo_unpin(bo);
+error_unreserve:
+	amdgpu_bo_unreserve(bo);
+error_put:
+	drm_gem_object_put_unlocked(gobj);
+error_free_cbs:
+	kfree(ctx->seqno_cbs);
+	ctx->seqno_cbs = NULL;
+	return r;
+}
+
+static int amdgpu_ctx_get_seqno_page(struct amdgpu_fpriv *fpriv,
+				     struct drm_file *filp, uint32_t id,
+				     union drm_amdgpu_ctx_out *out)
+{
+	struct amdgpu_ctx *ctx;
+	u32 handle;
+	int r = 0;
+
+	ctx = amdgpu_ctx_get(fpriv, id);
+	if (!ctx)
+		return -EINVAL;
+
+	mutex_lock(&ctx->lock);
+	if (!ctx->seqno_bo)
+		r = amdgpu_ctx_seqno_page_init(ctx);
+	if (!r)
+		r = drm_gem_handle_create(filp, &ctx->seqno_bo->tbo.base,
+					  &handle);
+	mutex_unlock(&ctx->lock);
+	amdgpu_ctx_put(ctx);
+	if (r)
+		return r;
+
+	out->seqno_page.handle = handle;
+	out->seqno_page._pad = 0;
+	return 0;
+}
+
 int amdgpu_ctx_ioctl(struct drm_device *dev, void *data,
 		     struct drm_file *filp)
 {
@@ -413,6 +573,9 @@ int amdgpu_ctx_ioctl(struct drm_device *dev, void *data,
 	case AMDGPU_CTX_OP_QUERY_STATE2:
 		r = amdgpu_ctx_query2(adev, fpriv, id, &args->out);
 		break;
+	case AMDGPU_CTX_OP_GET_SEQNO_PAGE:
+		r = amdgpu_ctx_get_seqno_page(fpriv, filp, id, &args->out);
+		break;
 	default:
 		return -EINVAL;
 	}
@@ -468,6 +631,14 @@ void amdgpu_ctx_add_fence(struct amdgpu_ctx *ctx,
 	centity->sequence++;
 	spin_unlock(&ctx->ring_lock);
 
+	if (centity->seqno_cbs) {
+		/* Synchronizes with a callback still running on other */
+		if (other)
+			dma_fence_remove_callback(other,
+						  &centity->seqno_cbs[idx].cb);
+		amdgpu_ctx_seqno_arm(ctx, centity, fence, seq);
+	}
+
 	dma_fence_put(other);
 	if (handle)
 		*handle = seq;
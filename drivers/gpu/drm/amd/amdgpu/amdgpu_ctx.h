@@ -29,9 +29,18 @@ struct drm_device;
 struct drm_file;
 struct amdgpu_fpriv;
 
+struct amdgpu_ctx_seqno_cb {
+	struct dma_fence_cb	cb;
+	uint64_t		*cpu_addr;
+	uint64_t		seq;
+};
+
 struct amdgpu_ctx_entity {
 	uint64_t		sequence;
 	struct dma_fence	**fences;
+	/* protected by amdgpu_ctx::lock, NULL until the seqno page exists */
+	struct amdgpu_ctx_seqno_cb	*seqno_cbs;
+	unsigned		seqno_slot;
 	struct drm_sched_entity	entity;
 };
 
@@ -51,6 +60,9 @@ struct amdgpu_ctx {
 	atomic_t			guilty;
 	unsigned long			ras_counter_ce;
 	unsigned long			ras_counter_ue;
+	struct amdgpu_bo		*seqno_bo;
+	uint64_t			*seqno_cpu_addr;
+	struct amdgpu_ctx_seqno_cb	*seqno_cbs;
 };
 
 struct amdgpu_ctx_mgr {
@@ -1025,6 +1025,9 @@ static void amdgpu_ib_preempt_mark_partial_job(struct amdgpu_ring *ring)
 			job->preemption_status |= AMDGPU_IB_PREEMPTED;
 	}
 	spin_unlock(&sched->job_list_lock);
+
+	if (preempted)
+		atomic64_inc(&ring->stats.preemptions);
 }
 
 static int amdgpu_debugfs_ib_preempt(void *data, u64 val)
@@ -1106,8 +1109,31 @@ static int amdgpu_debugfs_ib_preempt(void *data, u64 val)
 DEFINE_SIMPLE_ATTRIBUTE(fops_ib_preempt, NULL,
 			amdgpu_debugfs_ib_preempt, "%llu\n");
 
+/*
+ * Writing 0 ungates and 1 gates the GFX clocks at runtime, within the
+ * limits of adev->cg_flags. The current state is in amdgpu_pm_info.
+ */
+static int amdgpu_debugfs_gfx_cg_set(void *data, u64 val)
+{
+	struct amdgpu_device *adev = (struct amdgpu_device *)data;
+
+	if (val > 1)
+		return -EINVAL;
+
+	return amdgpu_device_ip_set_clockgating_state(adev,
+			AMD_IP_BLOCK_TYPE_GFX,
+			val ? AMD_CG_STATE_GATE : AMD_CG_STATE_UNGATE);
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(fops_gfx_cg, NULL,
+			amdgpu_debugfs_gfx_cg_set, "%llu\n");
+
 int amdgpu_debugfs_init(struct amdgpu_device *adev)
 {
+	debugfs_create_file("amdgpu_gfx_cg", 0200,
+			    adev->ddev->primary->debugfs_root,
+			    (void *)adev, &fops_gfx_cg);
+
 	adev->debugfs_preempt =
 		debugfs_create_file("amdgpu_preempt_ib", 0600,
 				    adev->ddev->primary->debugfs_root,
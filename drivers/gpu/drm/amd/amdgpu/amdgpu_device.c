@@ -64,6 +64,8 @@
 #include "amdgpu_xgmi.h"
 #include "amdgpu_ras.h"
 #include "amdgpu_pmu.h"
+#include "amdgpu_dmaengine.h"
+#include "amdgpu_vramblk.h"
 
 MODULE_FIRMWARE("amdgpu/vega10_gpu_info.bin");
 MODULE_FIRMWARE("amdgpu/vega12_gpu_info.bin");
@@ -78,7 +80,7 @@ MODULE_FIRMWARE("amdgpu/navi12_gpu_info.bin");
 
 #define AMDGPU_RESUME_MS		2000
 
-static const char *amdgpu_asic_name[] = {
+const char *amdgpu_asic_name[] = {
 	"TAHITI",
 	"PITCAIRN",
 	"VERDE",
@@ -1707,6 +1709,10 @@ static int amdgpu_device_ip_hw_init_phase2(struct amdgpu_device *adev)
 			continue;
 		if (adev->ip_blocks[i].status.hw)
 			continue;
+		/* brought up later by amdgpu_device_display_bringup() */
+		if (adev->display_deferred &&
+		    adev->ip_blocks[i].version->type == AMD_IP_BLOCK_TYPE_DCE)
+			continue;
 		r = adev->ip_blocks[i].version->funcs->hw_init(adev);
 		if (r) {
 			DRM_ERROR("hw_init of IP block <%s> failed %d\n",
@@ -2043,6 +2049,68 @@ static int amdgpu_device_ip_late_init(struct amdgpu_device *adev)
 	return 0;
 }
 
+/**
+ * amdgpu_device_display_bringup - bring up deferred display blocks
+ *
+ * @adev: amdgpu_device pointer
+ *
+ * With amdgpu.deferred_display the display blocks are only software
+ * initialized at probe time, so the KMS objects exist but the display
+ * hardware is left alone.  Run hw_init and late_init for those blocks
+ * the first time a client needs them, then start connector polling and
+ * report the current connector state.
+ * Returns 0 on success, negative error code on failure.
+ */
+int amdgpu_device_display_bringup(struct amdgpu_device *adev)
+{
+	bool brought_up = false;
+	int i, r = 0;
+
+	if (!READ_ONCE(adev->display_deferred))
+		return 0;
+
+	/* keep GPU recovery from walking the blocks under us */
+	mutex_lock(&adev->lock_reset);
+	if (!adev->display_deferred)
+		goto unlock;
+
+	for (i = 0; i < adev->num_ip_blocks; i++) {
+		if (!adev->ip_blocks[i].status.sw ||
+		    adev->ip_blocks[i].status.hw)
+			continue;
+		if (adev->ip_blocks[i].version->type != AMD_IP_BLOCK_TYPE_DCE)
+			continue;
+		r = adev->ip_blocks[i].version->funcs->hw_init(adev);
+		if (r) {
+			DRM_ERROR("hw_init of IP block <%s> failed %d\n",
+				  adev->ip_blocks[i].version->funcs->name, r);
+			goto unlock;
+		}
+		adev->ip_blocks[i].status.hw = true;
+		if (adev->ip_blocks[i].version->funcs->late_init) {
+			r = adev->ip_blocks[i].version->funcs->late_init(adev);
+			if (r) {
+				DRM_ERROR("late_init of IP block <%s> failed %d\n",
+					  adev->ip_blocks[i].version->funcs->name, r);
+				goto unlock;
+			}
+		}
+		adev->ip_blocks[i].status.late_initialized = true;
+	}
+	WRITE_ONCE(adev->display_deferred, false);
+	brought_up = true;
+unlock:
+	mutex_unlock(&adev->lock_reset);
+	if (!brought_up)
+		return r;
+
+	DRM_INFO("display brought up on demand\n");
+	drm_kms_helper_poll_enable(adev->ddev);
+	drm_helper_hpd_irq_event(adev->ddev);
+
+	return 0;
+}
+
 /**
  * amdgpu_device_ip_fini - run fini for hardware IPs
  *
@@ -2190,6 +2258,9 @@ static int amdgpu_device_ip_suspend_phase1(struct amdgpu_device *adev)
 			continue;
 		/* displays are handled separately */
 		if (adev->ip_blocks[i].version->type == AMD_IP_BLOCK_TYPE_DCE) {
+			/* never brought up, nothing to suspend */
+			if (adev->display_deferred)
+				continue;
 			/* XXX handle errors */
 			r = adev->ip_blocks[i].version->funcs->suspend(adev);
 			/* XXX handle errors */
@@ -2417,6 +2488,9 @@ static int amdgpu_device_ip_resume_phase2(struct amdgpu_device *adev)
 		    adev->ip_blocks[i].version->type == AMD_IP_BLOCK_TYPE_IH ||
 		    adev->ip_blocks[i].version->type == AMD_IP_BLOCK_TYPE_PSP)
 			continue;
+		if (adev->display_deferred &&
+		    adev->ip_blocks[i].version->type == AMD_IP_BLOCK_TYPE_DCE)
+			continue;
 		r = adev->ip_blocks[i].version->funcs->resume(adev);
 		if (r) {
 			DRM_ERROR("resume of IP block <%s> failed %d\n",
@@ -2849,7 +2923,11 @@ int amdgpu_device_init(struct amdgpu_device *adev,
 	/* Get a log2 for easy divisions. */
 	adev->mm_stats.log2_max_MBps = ilog2(max(1u, max_MBps));
 
-	amdgpu_fbdev_init(adev);
+	/* no connector polling or console until the display is up */
+	if (adev->display_deferred)
+		drm_kms_helper_poll_disable(adev->ddev);
+	else
+		amdgpu_fbdev_init(adev);
 
 	if (amdgpu_sriov_vf(adev) && amdgim_is_hwperf(adev))
 		amdgpu_pm_virt_sysfs_init(adev);
@@ -2925,6 +3003,10 @@ int amdgpu_device_init(struct amdgpu_device *adev,
 	if (r)
 		dev_err(adev->dev, "amdgpu_pmu_init failed\n");
 
+	/* Not fatal, the ring keeps serving buffer moves */
+	amdgpu_dmaengine_init(adev);
+	amdgpu_vramblk_init(adev);
+
 	return 0;
 
 failed:
@@ -2948,6 +3030,12 @@ void amdgpu_device_fini(struct amdgpu_device *adev)
 	int r;
 
 	DRM_INFO("amdgpu: finishing device.\n");
+	/* clients must be gone before the SDMA ring goes down */
+	amdgpu_vramblk_fini(adev);
+	amdgpu_dmaengine_fini(adev);
+	/* and perf must stop polling counters before the gfx block does */
+	if (IS_ENABLED(CONFIG_PERF_EVENTS))
+		amdgpu_pmu_fini(adev);
 	adev->shutdown = true;
 	/* disable all interrupts */
 	amdgpu_irq_disable_all(adev);
@@ -2993,8 +3081,6 @@ void amdgpu_device_fini(struct amdgpu_device *adev)
 	amdgpu_debugfs_regs_cleanup(adev);
 	device_remove_file(adev->dev, &dev_attr_pcie_replay_count);
 	amdgpu_ucode_sysfs_fini(adev);
-	if (IS_ENABLED(CONFIG_PERF_EVENTS))
-		amdgpu_pmu_fini(adev);
 	amdgpu_debugfs_preempt_cleanup(adev);
 	if (amdgpu_discovery && adev->asic_type >= CHIP_NAVI10)
 		amdgpu_discovery_fini(adev);
@@ -3076,6 +3162,8 @@ int amdgpu_device_suspend(struct drm_device *dev, bool suspend, bool fbcon)
 		}
 	}
 
+	amdgpu_vramblk_suspend(adev);
+
 	amdgpu_ras_suspend(adev);
 
 	r = amdgpu_device_ip_suspend_phase1(adev);
@@ -3178,6 +3266,8 @@ int amdgpu_device_resume(struct drm_device *dev, bool resume, bool fbcon)
 			}
 		}
 	}
+	amdgpu_vramblk_resume(adev);
+
 	r = amdgpu_amdkfd_resume(adev);
 	if (r)
 		return r;
@@ -3201,7 +3291,8 @@ int amdgpu_device_resume(struct drm_device *dev, bool resume, bool fbcon)
 		amdgpu_fbdev_set_suspend(adev, 0);
 	}
 
-	drm_kms_helper_poll_enable(dev);
+	if (!adev->display_deferred)
+		drm_kms_helper_poll_enable(dev);
 
 	amdgpu_ras_resume(adev);
 
@@ -3217,10 +3308,12 @@ int amdgpu_device_resume(struct drm_device *dev, bool resume, bool fbcon)
 #ifdef CONFIG_PM
 	dev->dev->power.disable_depth++;
 #endif
-	if (!amdgpu_device_has_dc_support(adev))
-		drm_helper_hpd_irq_event(dev);
-	else
-		drm_kms_helper_hotplug_event(dev);
+	if (!adev->display_deferred) {
+		if (!amdgpu_device_has_dc_support(adev))
+			drm_helper_hpd_irq_event(dev);
+		else
+			drm_kms_helper_hotplug_event(dev);
+	}
 #ifdef CONFIG_PM
 	dev->dev->power.disable_depth--;
 #endif
@@ -3264,6 +3357,43 @@ static bool amdgpu_device_ip_check_soft_reset(struct amdgpu_device *adev)
 	return asic_hang;
 }
 
+/**
+ * amdgpu_device_ring_can_soft_reset - can a hang on this ring be soft reset
+ *
+ * @ring: amdgpu_ring pointer
+ *
+ * Returns true if the IP block driving @ring implements check_soft_reset,
+ * false if a hang on it can only be recovered with a full reset.
+ */
+bool amdgpu_device_ring_can_soft_reset(struct amdgpu_ring *ring)
+{
+	struct amdgpu_ip_block *ip_block;
+	enum amd_ip_block_type type;
+
+	switch (ring->funcs->type) {
+	case AMDGPU_RING_TYPE_GFX:
+	case AMDGPU_RING_TYPE_COMPUTE:
+	case AMDGPU_RING_TYPE_KIQ:
+		type = AMD_IP_BLOCK_TYPE_GFX;
+		break;
+	case AMDGPU_RING_TYPE_SDMA:
+		type = AMD_IP_BLOCK_TYPE_SDMA;
+		break;
+	case AMDGPU_RING_TYPE_UVD:
+	case AMDGPU_RING_TYPE_UVD_ENC:
+		type = AMD_IP_BLOCK_TYPE_UVD;
+		break;
+	case AMDGPU_RING_TYPE_VCE:
+		type = AMD_IP_BLOCK_TYPE_VCE;
+		break;
+	default:
+		return false;
+	}
+
+	ip_block = amdgpu_device_ip_get_ip_block(ring->adev, type);
+	return ip_block && ip_block->version->funcs->check_soft_reset;
+}
+
 /**
  * amdgpu_device_ip_pre_soft_reset - prepare for soft reset
  *
@@ -3531,6 +3661,8 @@ bool amdgpu_device_should_recover_gpu(struct amdgpu_device *adev)
 		switch (adev->asic_type) {
 		case CHIP_BONAIRE:
 		case CHIP_HAWAII:
+		case CHIP_LIVERPOOL:
+		case CHIP_GLADIUS:
 		case CHIP_TOPAZ:
 		case CHIP_TONGA:
 		case CHIP_FIJI:
@@ -3583,10 +3715,19 @@ static int amdgpu_device_pre_asic_reset(struct amdgpu_device *adev,
 		if (!need_full_reset)
 			need_full_reset = amdgpu_device_ip_need_full_reset(adev);
 
+		/* Nothing would notice a hang on this ring after a soft reset */
+		if (!need_full_reset && job &&
+		    !amdgpu_device_ring_can_soft_reset(to_amdgpu_ring(job->base.sched)))
+			need_full_reset = true;
+
 		if (!need_full_reset) {
 			amdgpu_device_ip_pre_soft_reset(adev);
 			r = amdgpu_device_ip_soft_reset(adev);
-			amdgpu_device_ip_post_soft_reset(adev);
+			/* A ring that fails its test on restart is dead too */
+			if (!r)
+				r = amdgpu_device_ip_post_soft_reset(adev);
+			else
+				amdgpu_device_ip_post_soft_reset(adev);
 			if (r || amdgpu_device_ip_check_soft_reset(adev)) {
 				DRM_INFO("soft reset failed, will fallback to full reset!\n");
 				need_full_reset = true;
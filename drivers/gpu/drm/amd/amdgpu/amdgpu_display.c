@@ -90,9 +90,10 @@ static void amdgpu_display_flip_work_func(struct work_struct *__work)
 			return;
 
 	/* Wait until we're out of the vertical blank period before the one
-	 * targeted by the flip
+	 * targeted by the flip. Async flips latch at the next hsync and have
+	 * no target to wait for.
 	 */
-	if (amdgpu_crtc->enabled &&
+	if (!work->async && amdgpu_crtc->enabled &&
 	    (amdgpu_display_get_crtc_scanoutpos(adev->ddev, work->crtc_id, 0,
 						&vpos, &hpos, NULL, NULL,
 						&crtc->hwmode)
@@ -544,10 +545,27 @@ amdgpu_display_user_framebuffer_create(struct drm_device *dev,
 				       struct drm_file *file_priv,
 				       const struct drm_mode_fb_cmd2 *mode_cmd)
 {
+	struct amdgpu_device *adev = dev->dev_private;
+	const struct drm_format_info *info;
+	struct drm_format_name_buf format_name;
 	struct drm_gem_object *obj;
 	struct amdgpu_framebuffer *amdgpu_fb;
 	int ret;
 
+	/*
+	 * The legacy DCE paths only drive the RGB graphics pipe, there is no
+	 * video overlay or underlay to feed YUV surfaces to.  Refuse them at
+	 * AddFB2 so compositors fall back to a blit before the modeset fails.
+	 */
+	info = drm_get_format_info(dev, mode_cmd);
+	if (!amdgpu_device_has_dc_support(adev) && info &&
+	    (info->is_yuv || info->num_planes > 1)) {
+		DRM_DEBUG_KMS("Format %s can't be scanned out without DC\n",
+			      drm_get_format_name(mode_cmd->pixel_format,
+						  &format_name));
+		return ERR_PTR(-EINVAL);
+	}
+
 	obj = drm_gem_object_lookup(file_priv, mode_cmd->handles[0]);
 	if (obj ==  NULL) {
 		dev_err(&dev->pdev->dev, "No GEM object associated to handle 0x%08X, "
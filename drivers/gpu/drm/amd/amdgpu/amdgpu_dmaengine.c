@@ -0,0 +1,343 @@
+// SPDX-License-Identifier: MIT
+/*
+ * dmaengine memcpy channel backed by the buffer-move SDMA ring
+ *
+ * Kernel clients get a public DMA_MEMCPY channel whose copies run on the same
+ * ring and scheduler entity TTM uses for buffer moves. Both ends of a copy are
+ * system memory mapped for adev->dev; they are reached through the GTT
+ * transfer windows, see amdgpu_ttm_copy_dma().
+ *
+ * Submitting to the ring sleeps, so issued descriptors are handed to a work
+ * item. Completion is signalled by the job fences from interrupt context and
+ * the client callbacks run from a tasklet, like with other dmaengine drivers.
+ * Descriptors complete strictly in cookie order: one that failed to reach
+ * the ring is only completed, with an error, once all the ones submitted
+ * before it have.
+ */
+#include <linux/dmaengine.h>
+#include <linux/interrupt.h>
+#include <linux/slab.h>
+
+#include "amdgpu.h"
+#include "amdgpu_dmaengine.h"
+#include "dmaengine.h"
+
+struct amdgpu_dma_desc {
+	struct dma_async_tx_descriptor	tx;
+	struct list_head		node;
+	struct amdgpu_dma_chan		*chan;
+	dma_addr_t			src;
+	dma_addr_t			dst;
+	size_t				len;
+	struct dma_fence		*fence;
+	struct dma_fence_cb		cb;
+	int				error;
+	bool				finished;
+};
+
+struct amdgpu_dma_chan {
+	struct dma_device		ddev;
+	struct dma_chan			chan;
+	struct amdgpu_device		*adev;
+
+	spinlock_t			lock;
+	struct list_head		submitted;	/* tx_submit()ed */
+	struct list_head		issued;		/* waiting for the work */
+	struct list_head		running;	/* in cookie order */
+	struct work_struct		issue_work;
+	struct tasklet_struct		tasklet;
+	/* Last cookie that completed with an error */
+	dma_cookie_t			error_cookie;
+};
+
+static inline struct amdgpu_dma_chan *to_amdgpu_dma_chan(struct dma_chan *c)
+{
+	return container_of(c, struct amdgpu_dma_chan, chan);
+}
+
+static inline struct amdgpu_dma_desc *
+to_amdgpu_dma_desc(struct dma_async_tx_descriptor *tx)
+{
+	return container_of(tx, struct amdgpu_dma_desc, tx);
+}
+
+static dma_cookie_t amdgpu_dma_tx_submit(struct dma_async_tx_descriptor *tx)
+{
+	struct amdgpu_dma_desc *desc = to_amdgpu_dma_desc(tx);
+	struct amdgpu_dma_chan *ac = desc->chan;
+	unsigned long flags;
+	dma_cookie_t cookie;
+
+	spin_lock_irqsave(&ac->lock, flags);
+	cookie = dma_cookie_assign(tx);
+	list_add_tail(&desc->node, &ac->submitted);
+	spin_unlock_irqrestore(&ac->lock, flags);
+
+	return cookie;
+}
+
+static struct dma_async_tx_descriptor *
+amdgpu_dma_prep_memcpy(struct dma_chan *chan, dma_addr_t dst, dma_addr_t src,
+		       size_t len, unsigned long flags)
+{
+	struct amdgpu_dma_chan *ac = to_amdgpu_dma_chan(chan);
+	struct amdgpu_dma_desc *desc;
+
+	if (!len || !ac->adev->mman.buffer_funcs_enabled)
+		return NULL;
+
+	desc = kzalloc(sizeof(*desc), GFP_NOWAIT);
+	if (!desc)
+		return NULL;
+
+	dma_async_tx_descriptor_init(&desc->tx, chan);
+	desc->tx.tx_submit = amdgpu_dma_tx_submit;
+	desc->tx.flags = flags;
+	desc->chan = ac;
+	desc->src = src;
+	desc->dst = dst;
+	desc->len = len;
+
+	return &desc->tx;
+}
+
+/* Fence callback, from interrupt context */
+static void amdgpu_dma_fence_cb(struct dma_fence *fence, struct dma_fence_cb *cb)
+{
+	struct amdgpu_dma_desc *desc = container_of(cb, struct amdgpu_dma_desc,
+						    cb);
+	struct amdgpu_dma_chan *ac = desc->chan;
+	unsigned long flags;
+
+	spin_lock_irqsave(&ac->lock, flags);
+	desc->error = fence->error;
+	desc->finished = true;
+	spin_unlock_irqrestore(&ac->lock, flags);
+
+	tasklet_schedule(&ac->tasklet);
+}
+
+static void amdgpu_dma_issue_work(struct work_struct *work)
+{
+	struct amdgpu_dma_chan *ac = container_of(work, struct amdgpu_dma_chan,
+						  issue_work);
+	struct amdgpu_dma_desc *desc;
+	struct dma_fence *fence;
+	int r;
+
+	for (;;) {
+		spin_lock_irq(&ac->lock);
+		desc = list_first_entry_or_null(&ac->issued,
+						struct amdgpu_dma_desc, node);
+		if (desc)
+			list_move_tail(&desc->node, &ac->running);
+		spin_unlock_irq(&ac->lock);
+		if (!desc)
+			break;
+
+		fence = NULL;
+		r = amdgpu_ttm_copy_dma(ac->adev, desc->src, desc->dst,
+					desc->len, &fence);
+		if (!r && fence) {
+			desc->fence = fence;
+			r = dma_fence_add_callback(fence, &desc->cb,
+						   amdgpu_dma_fence_cb);
+			if (!r)
+				continue;
+			/* already signalled */
+			amdgpu_dma_fence_cb(fence, &desc->cb);
+			continue;
+		}
+
+		/* Stays in line behind the jobs still on the ring */
+		dma_fence_put(fence);
+		spin_lock_irq(&ac->lock);
+		desc->error = r ?: -EIO;
+		desc->finished = true;
+		spin_unlock_irq(&ac->lock);
+		tasklet_schedule(&ac->tasklet);
+	}
+}
+
+static void amdgpu_dma_issue_pending(struct dma_chan *chan)
+{
+	struct amdgpu_dma_chan *ac = to_amdgpu_dma_chan(chan);
+	unsigned long flags;
+
+	spin_lock_irqsave(&ac->lock, flags);
+	list_splice_tail_init(&ac->submitted, &ac->issued);
+	spin_unlock_irqrestore(&ac->lock, flags);
+
+	schedule_work(&ac->issue_work);
+}
+
+static void amdgpu_dma_tasklet(unsigned long data)
+{
+	struct amdgpu_dma_chan *ac = (struct amdgpu_dma_chan *)data;
+	struct dmaengine_result res;
+	struct dma_async_tx_descriptor *tx;
+	struct amdgpu_dma_desc *desc;
+
+	for (;;) {
+		/* Jobs on one entity signal in order, complete them so too */
+		spin_lock_irq(&ac->lock);
+		desc = list_first_entry_or_null(&ac->running,
+						struct amdgpu_dma_desc, node);
+		if (desc && desc->finished) {
+			list_del(&desc->node);
+			if (desc->error)
+				ac->error_cookie = desc->tx.cookie;
+			dma_cookie_complete(&desc->tx);
+		} else {
+			desc = NULL;
+		}
+		spin_unlock_irq(&ac->lock);
+		if (!desc)
+			break;
+
+		tx = &desc->tx;
+		if (desc->error)
+			dev_err_ratelimited(ac->adev->dev,
+					    "dma: copy failed (%d)\n",
+					    desc->error);
+		dma_descriptor_unmap(tx);
+		res.result = desc->error ? DMA_TRANS_ABORTED :
+					   DMA_TRANS_NOERROR;
+		res.residue = desc->error ? desc->len : 0;
+		dmaengine_desc_get_callback_invoke(tx, &res);
+		dma_run_dependencies(tx);
+
+		dma_fence_put(desc->fence);
+		kfree(desc);
+	}
+}
+
+static enum dma_status amdgpu_dma_tx_status(struct dma_chan *chan,
+					    dma_cookie_t cookie,
+					    struct dma_tx_state *txstate)
+{
+	struct amdgpu_dma_chan *ac = to_amdgpu_dma_chan(chan);
+	enum dma_status status;
+
+	status = dma_cookie_status(chan, cookie, txstate);
+	if (status == DMA_COMPLETE && cookie == READ_ONCE(ac->error_cookie))
+		status = DMA_ERROR;
+
+	return status;
+}
+
+static int amdgpu_dma_terminate_all(struct dma_chan *chan)
+{
+	struct amdgpu_dma_chan *ac = to_amdgpu_dma_chan(chan);
+	struct amdgpu_dma_desc *desc, *tmp;
+	unsigned long flags;
+	LIST_HEAD(head);
+
+	/* Whatever already went to the ring cannot be taken back */
+	spin_lock_irqsave(&ac->lock, flags);
+	list_splice_tail_init(&ac->submitted, &head);
+	list_splice_tail_init(&ac->issued, &head);
+	spin_unlock_irqrestore(&ac->lock, flags);
+
+	list_for_each_entry_safe(desc, tmp, &head, node) {
+		dma_descriptor_unmap(&desc->tx);
+		kfree(desc);
+	}
+	return 0;
+}
+
+static void amdgpu_dma_synchronize(struct dma_chan *chan)
+{
+	struct amdgpu_dma_chan *ac = to_amdgpu_dma_chan(chan);
+	struct amdgpu_dma_desc *desc;
+	struct dma_fence *fence = NULL;
+
+	flush_work(&ac->issue_work);
+
+	/* The last job on the ring completes last */
+	spin_lock_irq(&ac->lock);
+	list_for_each_entry_reverse(desc, &ac->running, node) {
+		if (desc->fence) {
+			fence = dma_fence_get(desc->fence);
+			break;
+		}
+	}
+	spin_unlock_irq(&ac->lock);
+	if (fence) {
+		dma_fence_wait(fence, false);
+		dma_fence_put(fence);
+	}
+
+	tasklet_kill(&ac->tasklet);
+	amdgpu_dma_tasklet((unsigned long)ac);
+}
+
+static void amdgpu_dma_free_chan_resources(struct dma_chan *chan)
+{
+	amdgpu_dma_terminate_all(chan);
+	amdgpu_dma_synchronize(chan);
+}
+
+int amdgpu_dmaengine_init(struct amdgpu_device *adev)
+{
+	struct amdgpu_dma_chan *ac;
+	struct dma_device *dd;
+	int r;
+
+	if (!adev->mman.buffer_funcs_ring || amdgpu_sriov_vf(adev))
+		return 0;
+
+	ac = kzalloc(sizeof(*ac), GFP_KERNEL);
+	if (!ac)
+		return -ENOMEM;
+
+	ac->adev = adev;
+	spin_lock_init(&ac->lock);
+	INIT_LIST_HEAD(&ac->submitted);
+	INIT_LIST_HEAD(&ac->issued);
+	INIT_LIST_HEAD(&ac->running);
+	INIT_WORK(&ac->issue_work, amdgpu_dma_issue_work);
+	tasklet_init(&ac->tasklet, amdgpu_dma_tasklet, (unsigned long)ac);
+
+	dd = &ac->ddev;
+	dd->dev = adev->dev;
+	INIT_LIST_HEAD(&dd->channels);
+	dma_cap_set(DMA_MEMCPY, dd->cap_mask);
+	dd->copy_align = DMAENGINE_ALIGN_1_BYTE;
+	dd->device_prep_dma_memcpy = amdgpu_dma_prep_memcpy;
+	dd->device_issue_pending = amdgpu_dma_issue_pending;
+	dd->device_tx_status = amdgpu_dma_tx_status;
+	dd->device_terminate_all = amdgpu_dma_terminate_all;
+	dd->device_synchronize = amdgpu_dma_synchronize;
+	dd->device_free_chan_resources = amdgpu_dma_free_chan_resources;
+
+	ac->chan.device = dd;
+	dma_cookie_init(&ac->chan);
+	list_add_tail(&ac->chan.device_node, &dd->channels);
+
+	r = dma_async_device_register(dd);
+	if (r) {
+		dev_err(adev->dev, "dma: could not register memcpy channel (%d)\n",
+			r);
+		kfree(ac);
+		return r;
+	}
+	adev->dma_chan = ac;
+	dev_info(adev->dev, "dma: SDMA memcpy channel registered\n");
+
+	return 0;
+}
+
+void amdgpu_dmaengine_fini(struct amdgpu_device *adev)
+{
+	struct amdgpu_dma_chan *ac = adev->dma_chan;
+
+	if (!ac)
+		return;
+
+	dma_async_device_unregister(&ac->ddev);
+	amdgpu_dma_terminate_all(&ac->chan);
+	amdgpu_dma_synchronize(&ac->chan);
+	adev->dma_chan = NULL;
+	kfree(ac);
+}
@@ -0,0 +1,17 @@
+/* SPDX-License-Identifier: MIT */
+#ifndef _AMDGPU_DMAENGINE_H_
+#define _AMDGPU_DMAENGINE_H_
+
+#if IS_ENABLED(CONFIG_DRM_AMDGPU_DMAENGINE)
+int amdgpu_dmaengine_init(struct amdgpu_device *adev);
+void amdgpu_dmaengine_fini(struct amdgpu_device *adev);
+#else
+static inline int amdgpu_dmaengine_init(struct amdgpu_device *adev)
+{
+	return 0;
+}
+
+static inline void amdgpu_dmaengine_fini(struct amdgpu_device *adev) {}
+#endif
+
+#endif /* _AMDGPU_DMAENGINE_H_ */
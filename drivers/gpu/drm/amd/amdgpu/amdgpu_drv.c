@@ -30,6 +30,7 @@
 
 #include <drm/drm_pciids.h>
 #include <linux/console.h>
+#include <linux/kexec.h>
 #include <linux/module.h>
 #include <linux/pci.h>
 #include <linux/pm_runtime.h>
@@ -94,6 +95,8 @@
 
 int amdgpu_vram_limit = 0;
 int amdgpu_vis_vram_limit = 0;
+int amdgpu_ps4_vram_reclaim = 0;
+int amdgpu_ps4_cgcg = 0;
 int amdgpu_gart_size = -1; /* auto */
 int amdgpu_gtt_size = -1; /* auto */
 int amdgpu_moverate = -1; /* auto */
@@ -104,6 +107,7 @@ int amdgpu_disp_priority = 0;
 int amdgpu_hw_i2c = 0;
 int amdgpu_pcie_gen2 = -1;
 int amdgpu_msi = -1;
+int amdgpu_irq_thread = -1;
 char amdgpu_lockup_timeout[AMDGPU_MAX_TIMEOUT_PARAM_LENTH];
 int amdgpu_dpm = -1;
 int amdgpu_fw_load_type = -1;
@@ -149,6 +153,9 @@ int amdgpu_mcbp = 0;
 int amdgpu_discovery = -1;
 int amdgpu_mes = 0;
 int amdgpu_noretry;
+int amdgpu_deferred_display;
+uint amdgpu_vramblk_size;
+int amdgpu_direct_submit = 1;
 
 struct amdgpu_mgpu_info mgpu_info = {
 	.mutex = __MUTEX_INITIALIZER(mgpu_info.mutex),
@@ -170,6 +177,22 @@ module_param_named(vramlimit, amdgpu_vram_limit, int, 0600);
 MODULE_PARM_DESC(vis_vramlimit, "Restrict visible VRAM for testing, in megabytes");
 module_param_named(vis_vramlimit, amdgpu_vis_vram_limit, int, 0444);
 
+/**
+ * DOC: ps4_vram_reclaim (int)
+ * Hand the top N MiB of the PS4 VRAM carve-out back to the kernel as hotplugged system memory.
+ * Rounded down to the memory block size. Only used on Liverpool/Gladius; the default is 0 (keep the full carve-out).
+ */
+MODULE_PARM_DESC(ps4_vram_reclaim, "Return part of the PS4 VRAM carve-out to system RAM, in megabytes (0 = off)");
+module_param_named(ps4_vram_reclaim, amdgpu_ps4_vram_reclaim, int, 0444);
+
+/**
+ * DOC: ps4_cgcg (int)
+ * Enable GFX coarse grain clock gating on Liverpool/Gladius. It has not been validated on
+ * PS4 hardware yet, so the default is 0 (disabled). amdgpu.cg_mask still applies on top.
+ */
+MODULE_PARM_DESC(ps4_cgcg, "Enable GFX coarse grain clock gating on PS4 (1 = enable, 0 = disable (default))");
+module_param_named(ps4_cgcg, amdgpu_ps4_cgcg, int, 0444);
+
 /**
  * DOC: gartsize (uint)
  * Restrict the size of GART in Mib (32, 64, etc.) for testing. The default is -1 (The size depends on asic).
@@ -194,7 +217,10 @@ module_param_named(moverate, amdgpu_moverate, int, 0600);
 
 /**
  * DOC: benchmark (int)
- * Run benchmarks. The default is 0 (Skip benchmarks).
+ * Run benchmarks. The default is 0 (Skip benchmarks). 1-8 time BO moves
+ * between domains, 9 compares SDMA with CP DMA copies, 10 measures CPU
+ * access through write-combined and cached mappings, 11 measures GART
+ * unmap/map and 12 runs 9-11.
  */
 MODULE_PARM_DESC(benchmark, "Run benchmark");
 module_param_named(benchmark, amdgpu_benchmarking, int, 0444);
@@ -241,6 +267,14 @@ module_param_named(pcie_gen2, amdgpu_pcie_gen2, int, 0444);
 MODULE_PARM_DESC(msi, "MSI support (1 = enable, 0 = disable, -1 = auto)");
 module_param_named(msi, amdgpu_msi, int, 0444);
 
+/**
+ * DOC: irq_thread (int)
+ * Drain the IH ring from an interrupt thread instead of the hard interrupt handler (1 = enable, 0 = disable).
+ * Only used with MSI. The default is -1 (auto, enabled on Liverpool/Gladius).
+ */
+MODULE_PARM_DESC(irq_thread, "Process the IH ring in an IRQ thread (1 = enable, 0 = disable, -1 = auto)");
+module_param_named(irq_thread, amdgpu_irq_thread, int, 0444);
+
 /**
  * DOC: lockup_timeout (string)
  * Set GPU scheduler timeout value in ms.
@@ -354,8 +388,9 @@ module_param_named(vm_debug, amdgpu_vm_debug, int, 0644);
  * DOC: vm_update_mode (int)
  * Override VM update mode. VM updated by using CPU (0 = never, 1 = Graphics only, 2 = Compute only, 3 = Both). The default
  * is -1 (Only in large BAR(LB) systems Compute VM tables will be updated by CPU, otherwise 0, never).
+ * On unified memory APUs like the PS4 the default is 3, with bulk updates still done by SDMA.
  */
-MODULE_PARM_DESC(vm_update_mode, "VM update using CPU (0 = never (default except for large BAR(LB)), 1 = Graphics only, 2 = Compute only (default for LB), 3 = Both");
+MODULE_PARM_DESC(vm_update_mode, "VM update using CPU (0 = never (default except for large BAR(LB)), 1 = Graphics only, 2 = Compute only (default for LB), 3 = Both (default for unified memory)");
 module_param_named(vm_update_mode, amdgpu_vm_update_mode, int, 0444);
 
 /**
@@ -619,6 +654,37 @@ MODULE_PARM_DESC(noretry,
 	"Disable retry faults (0 = retry enabled (default), 1 = retry disabled)");
 module_param_named(noretry, amdgpu_noretry, int, 0644);
 
+/**
+ * DOC: deferred_display (int)
+ * Leave the display hardware (and on the PS4 the HDMI bridge behind it) powered down
+ * until the first client opens the primary DRM node. Meant for headless PS4 units; no
+ * fbdev console is created. Only honoured on Liverpool and Gladius with the non-DC
+ * display path. (0 = disabled (default), 1 = enabled)
+ */
+MODULE_PARM_DESC(deferred_display,
+	"Defer display bring-up until the first KMS client (0 = disabled (default), 1 = enabled)");
+module_param_named(deferred_display, amdgpu_deferred_display, int, 0444);
+
+/**
+ * DOC: vramblk_size (uint)
+ * Export this many MiB of VRAM as the block device /dev/amdgpu_vram<N>, e.g. to swap to ahead of
+ * slower storage. The memory is pinned and only goes back to the GPU when the driver unloads.
+ * At most half of VRAM. Needs CONFIG_DRM_AMDGPU_VRAMBLK. (0 = disabled (default))
+ */
+MODULE_PARM_DESC(vramblk_size,
+	"Size in MiB of the VRAM block device (0 = disabled (default))");
+module_param_named(vramblk_size, amdgpu_vramblk_size, uint, 0444);
+
+/**
+ * DOC: direct_submit (int)
+ * Let command submissions go to the ring from the submitting thread when the GPU scheduler has
+ * nothing queued and the job has no pending dependencies, instead of waking the scheduler thread.
+ * (0 = disabled, 1 = enabled (default))
+ */
+MODULE_PARM_DESC(direct_submit,
+	"Submit idle-ring jobs without the scheduler thread (0 = disabled, 1 = enabled (default))");
+module_param_named(direct_submit, amdgpu_direct_submit, int, 0644);
+
 #ifdef CONFIG_HSA_AMD
 /**
  * DOC: sched_policy (int)
@@ -1104,10 +1170,11 @@ static int amdgpu_pci_probe(struct pci_dev *pdev,
 #ifdef CONFIG_X86_PS4
 	/* On the PS4 (Liverpool graphics) we have a hard dependency on the
 	 * Aeolia driver to set up the HDMI encoder which is connected to it,
-	 * so defer probe until it is ready. This test passes if this isn't
-	 * a PS4 (returns -ENODEV).
+	 * so defer probe until it is ready. Newer boards have a Baikal
+	 * southbridge instead, which we wait for the same way. These tests
+	 * pass if this isn't a PS4 (returns -ENODEV).
 	 */
-	if (apcie_status() == 0)
+	if (apcie_status() == 0 || bpcie_status() == 0)
 		return -EPROBE_DEFER;
 #endif
 	dev = drm_dev_alloc(&kms_driver, &pdev->dev);
@@ -1169,6 +1236,14 @@ amdgpu_pci_shutdown(struct pci_dev *pdev)
 	 
 	adev->mp1_state = PP_MP1_STATE_UNLOAD;
 	amdgpu_device_ip_suspend(adev);*/
+
+	/* A kexec'd kernel reuses the memory our rings, IBs and fences live
+	 * in, so the CP and SDMA must not keep fetching from it. The ASIC
+	 * stays posted and the new kernel skips the VBIOS post. */
+	if (kexec_in_progress) {
+		adev->mp1_state = PP_MP1_STATE_UNLOAD;
+		amdgpu_device_ip_suspend(adev);
+	}
 	adev->mp1_state = PP_MP1_STATE_NONE;
 }
 
@@ -1489,6 +1564,11 @@ static struct pci_driver amdgpu_kms_pci_driver = {
 	.remove = amdgpu_pci_remove,
 	.shutdown = amdgpu_pci_shutdown,
 	.driver.pm = &amdgpu_pm_ops,
+#ifdef CONFIG_X86_PS4
+	/* Firmware loading and the HDMI bridge dominate PS4 boot, let the
+	 * southbridge drivers probe in the meantime */
+	.driver.probe_type = PROBE_PREFER_ASYNCHRONOUS,
+#endif
 };
 
 
@@ -46,6 +46,9 @@
    the helper contains a pointer to amdgpu framebuffer baseclass.
 */
 
+/* upper bound on the rate the shadow buffer is copied to VRAM */
+#define AMDGPUFB_FLUSH_DELAY	(HZ / 30)
+
 static int
 amdgpufb_open(struct fb_info *info, int user)
 {
@@ -79,6 +82,167 @@ static struct fb_ops amdgpufb_ops = {
 	.fb_imageblit = drm_fb_helper_cfb_imageblit,
 };
 
+/*
+ * On the PS4 APUs CPU writes to the VRAM carveout are uncached and
+ * scrolling reads it back, so the console draws into a GTT shadow instead
+ * and the damaged lines are copied over with SDMA.
+ */
+static bool amdgpufb_use_shadow(struct amdgpu_device *adev)
+{
+	return adev->asic_type == CHIP_LIVERPOOL ||
+	       adev->asic_type == CHIP_GLADIUS;
+}
+
+static void amdgpufb_flush_cpu(struct amdgpu_fbdev *rfbdev, u32 y1, u32 y2)
+{
+	struct amdgpu_bo *abo = gem_to_amdgpu_bo(rfbdev->rfb.base.obj[0]);
+	u32 pitch = rfbdev->rfb.base.pitches[0];
+
+	memcpy_toio((u8 __iomem *)amdgpu_bo_kptr(abo) + y1 * pitch,
+		    (u8 *)rfbdev->shadow_ptr + y1 * pitch, (y2 - y1) * pitch);
+}
+
+static void amdgpufb_flush_work_func(struct work_struct *work)
+{
+	struct amdgpu_fbdev *rfbdev =
+		container_of(work, struct amdgpu_fbdev, flush_work.work);
+	struct amdgpu_device *adev = rfbdev->adev;
+	struct amdgpu_bo *abo = gem_to_amdgpu_bo(rfbdev->rfb.base.obj[0]);
+	u32 pitch = rfbdev->rfb.base.pitches[0];
+	struct dma_fence *fence = NULL;
+	unsigned long flags;
+	u32 y1, y2;
+	int r = -EINVAL;
+
+	spin_lock_irqsave(&rfbdev->damage_lock, flags);
+	y1 = rfbdev->damage_y1;
+	y2 = rfbdev->damage_y2;
+	rfbdev->damage_y1 = U32_MAX;
+	rfbdev->damage_y2 = 0;
+	spin_unlock_irqrestore(&rfbdev->damage_lock, flags);
+
+	if (y1 >= y2)
+		return;
+
+	if (adev->mman.buffer_funcs_enabled)
+		r = amdgpu_copy_buffer(adev->mman.buffer_funcs_ring,
+				       rfbdev->shadow_gpu_addr + y1 * pitch,
+				       amdgpu_bo_gpu_offset(abo) + y1 * pitch,
+				       (y2 - y1) * pitch, NULL, &fence,
+				       false, false);
+	if (r) {
+		amdgpufb_flush_cpu(rfbdev, y1, y2);
+		return;
+	}
+
+	dma_fence_put(rfbdev->flush_fence);
+	rfbdev->flush_fence = fence;
+}
+
+static void amdgpufb_damage(struct fb_info *info, u32 y, u32 height)
+{
+	struct amdgpu_fbdev *rfbdev = info->par;
+	u32 y2 = min(y + height, info->var.yres_virtual);
+	unsigned long flags;
+
+	if (y >= y2)
+		return;
+
+	/* nothing may run after a panic, so copy the damage right away */
+	if (oops_in_progress) {
+		amdgpufb_flush_cpu(rfbdev, y, y2);
+		return;
+	}
+
+	spin_lock_irqsave(&rfbdev->damage_lock, flags);
+	rfbdev->damage_y1 = min(rfbdev->damage_y1, y);
+	rfbdev->damage_y2 = max(rfbdev->damage_y2, y2);
+	spin_unlock_irqrestore(&rfbdev->damage_lock, flags);
+
+	schedule_delayed_work(&rfbdev->flush_work, AMDGPUFB_FLUSH_DELAY);
+}
+
+static void amdgpufb_shadow_fillrect(struct fb_info *info,
+				     const struct fb_fillrect *rect)
+{
+	sys_fillrect(info, rect);
+	amdgpufb_damage(info, rect->dy, rect->height);
+}
+
+static void amdgpufb_shadow_copyarea(struct fb_info *info,
+				     const struct fb_copyarea *area)
+{
+	sys_copyarea(info, area);
+	amdgpufb_damage(info, area->dy, area->height);
+}
+
+static void amdgpufb_shadow_imageblit(struct fb_info *info,
+				      const struct fb_image *image)
+{
+	sys_imageblit(info, image);
+	amdgpufb_damage(info, image->dy, image->height);
+}
+
+static ssize_t amdgpufb_shadow_write(struct fb_info *info,
+				     const char __user *buf,
+				     size_t count, loff_t *ppos)
+{
+	ssize_t ret;
+
+	ret = fb_sys_write(info, buf, count, ppos);
+	if (ret > 0)
+		amdgpufb_damage(info, 0, info->var.yres_virtual);
+
+	return ret;
+}
+
+static struct fb_ops amdgpufb_shadow_ops = {
+	.owner = THIS_MODULE,
+	DRM_FB_HELPER_DEFAULT_OPS,
+	.fb_open = amdgpufb_open,
+	.fb_release = amdgpufb_release,
+	.fb_read = fb_sys_read,
+	.fb_write = amdgpufb_shadow_write,
+	.fb_fillrect = amdgpufb_shadow_fillrect,
+	.fb_copyarea = amdgpufb_shadow_copyarea,
+	.fb_imageblit = amdgpufb_shadow_imageblit,
+};
+
+static int amdgpufb_create_shadow(struct amdgpu_fbdev *rfbdev,
+				  unsigned long size)
+{
+	int r;
+
+	r = amdgpu_bo_create_kernel(rfbdev->adev, size, PAGE_SIZE,
+				    AMDGPU_GEM_DOMAIN_GTT, &rfbdev->shadow,
+				    &rfbdev->shadow_gpu_addr,
+				    &rfbdev->shadow_ptr);
+	if (r)
+		return r;
+
+	memset(rfbdev->shadow_ptr, 0, size);
+	spin_lock_init(&rfbdev->damage_lock);
+	rfbdev->damage_y1 = U32_MAX;
+	rfbdev->damage_y2 = 0;
+	INIT_DELAYED_WORK(&rfbdev->flush_work, amdgpufb_flush_work_func);
+	return 0;
+}
+
+static void amdgpufb_destroy_shadow(struct amdgpu_fbdev *rfbdev)
+{
+	if (!rfbdev->shadow)
+		return;
+
+	cancel_delayed_work_sync(&rfbdev->flush_work);
+	if (rfbdev->flush_fence) {
+		dma_fence_wait(rfbdev->flush_fence, false);
+		dma_fence_put(rfbdev->flush_fence);
+		rfbdev->flush_fence = NULL;
+	}
+	amdgpu_bo_free_kernel(&rfbdev->shadow, &rfbdev->shadow_gpu_addr,
+			      &rfbdev->shadow_ptr);
+}
+
 
 int amdgpu_align_pitch(struct amdgpu_device *adev, int width, int cpp, bool tiled)
 {
@@ -251,6 +415,13 @@ static int amdgpufb_create(struct drm_fb_helper *helper,
 	info->screen_base = amdgpu_bo_kptr(abo);
 	info->screen_size = amdgpu_bo_size(abo);
 
+	/* mmap keeps going straight to VRAM through smem_start */
+	if (amdgpufb_use_shadow(adev) &&
+	    !amdgpufb_create_shadow(rfbdev, amdgpu_bo_size(abo))) {
+		info->fbops = &amdgpufb_shadow_ops;
+		info->screen_buffer = rfbdev->shadow_ptr;
+	}
+
 	drm_fb_helper_fill_info(info, &rfbdev->helper, sizes);
 
 	/* setup aperture base/size for vesafb takeover */
@@ -292,6 +463,7 @@ static int amdgpu_fbdev_destroy(struct drm_device *dev, struct amdgpu_fbdev *rfb
 	int i;
 
 	drm_fb_helper_unregister_fbi(&rfbdev->helper);
+	amdgpufb_destroy_shadow(rfbdev);
 
 	if (rfb->base.obj[0]) {
 		for (i = 0; i < rfb->base.format->num_planes; i++)
@@ -367,9 +539,14 @@ void amdgpu_fbdev_fini(struct amdgpu_device *adev)
 
 void amdgpu_fbdev_set_suspend(struct amdgpu_device *adev, int state)
 {
-	if (adev->mode_info.rfbdev)
-		drm_fb_helper_set_suspend_unlocked(&adev->mode_info.rfbdev->helper,
-						   state);
+	struct amdgpu_fbdev *rfbdev = adev->mode_info.rfbdev;
+
+	if (!rfbdev)
+		return;
+
+	drm_fb_helper_set_suspend_unlocked(&rfbdev->helper, state);
+	if (state && rfbdev->shadow)
+		flush_delayed_work(&rfbdev->flush_work);
 }
 
 int amdgpu_fbdev_total_size(struct amdgpu_device *adev)
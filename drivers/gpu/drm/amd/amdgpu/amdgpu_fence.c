@@ -54,6 +54,8 @@ struct amdgpu_fence {
 
 	/* RB, DMA, etc. */
 	struct amdgpu_ring		*ring;
+	/* start of the latency accounted in ring->stats */
+	ktime_t				queued;
 };
 
 static struct kmem_cache *amdgpu_fence_slab;
@@ -124,6 +126,42 @@ static u32 amdgpu_fence_read(struct amdgpu_ring *ring)
 	return seq;
 }
 
+static void amdgpu_fence_stats_emit(struct amdgpu_ring *ring, uint32_t seq)
+{
+	struct amdgpu_ring_stats *stats = &ring->stats;
+	int inflight = seq - 1 - atomic_read(&ring->fence_drv.last_seq);
+	int max = atomic_read(&stats->inflight_max);
+
+	atomic64_inc(&stats->submissions);
+	atomic64_add(inflight, &stats->inflight_sum);
+	while (inflight > max) {
+		int old = atomic_cmpxchg(&stats->inflight_max, max, inflight);
+
+		if (old == max)
+			break;
+		max = old;
+	}
+}
+
+static void amdgpu_fence_stats_signal(struct amdgpu_ring *ring,
+				      struct dma_fence *f, ktime_t now)
+{
+	struct amdgpu_ring_stats *stats = &ring->stats;
+	struct amdgpu_fence *fence = to_amdgpu_fence(f);
+	s64 ns;
+	u64 us;
+
+	if (!fence)
+		return;
+
+	ns = max_t(s64, ktime_to_ns(ktime_sub(now, fence->queued)), 0);
+	us = div_u64(ns, NSEC_PER_USEC);
+	atomic64_inc(&stats->signaled);
+	atomic64_add(ns, &stats->latency_ns);
+	atomic_long_inc(&stats->latency_hist[min_t(unsigned,
+		us ? ilog2(us) + 1 : 0, AMDGPU_RING_STATS_BUCKETS - 1)]);
+}
+
 /**
  * amdgpu_fence_emit - emit a fence on the requested ring
  *
@@ -148,6 +186,8 @@ int amdgpu_fence_emit(struct amdgpu_ring *ring, struct dma_fence **f,
 
 	seq = ++ring->fence_drv.sync_seq;
 	fence->ring = ring;
+	fence->queued = ktime_get();
+	amdgpu_fence_stats_emit(ring, seq);
 	dma_fence_init(&fence->base, &amdgpu_fence_ops,
 		       &ring->fence_drv.lock,
 		       adev->fence_context + ring->idx,
@@ -181,6 +221,20 @@ int amdgpu_fence_emit(struct amdgpu_ring *ring, struct dma_fence **f,
 	return 0;
 }
 
+/**
+ * amdgpu_fence_set_queued - account a fence's latency from an earlier point
+ *
+ * @f: fence returned by amdgpu_fence_emit()
+ * @queued: time the work was queued, typically the drm_sched push
+ */
+void amdgpu_fence_set_queued(struct dma_fence *f, ktime_t queued)
+{
+	struct amdgpu_fence *fence = to_amdgpu_fence(f);
+
+	if (fence)
+		fence->queued = queued;
+}
+
 /**
  * amdgpu_fence_emit_polling - emit a fence on the requeste ring
  *
@@ -235,6 +289,7 @@ bool amdgpu_fence_process(struct amdgpu_ring *ring)
 {
 	struct amdgpu_fence_driver *drv = &ring->fence_drv;
 	uint32_t seq, last_seq;
+	ktime_t now;
 	int r;
 
 	do {
@@ -252,6 +307,7 @@ bool amdgpu_fence_process(struct amdgpu_ring *ring)
 
 	last_seq &= drv->num_fences_mask;
 	seq &= drv->num_fences_mask;
+	now = ktime_get();
 
 	do {
 		struct dma_fence *fence, **ptr;
@@ -267,6 +323,7 @@ bool amdgpu_fence_process(struct amdgpu_ring *ring)
 		if (!fence)
 			continue;
 
+		amdgpu_fence_stats_signal(ring, fence, now);
 		r = dma_fence_signal(fence);
 		if (!r)
 			DMA_FENCE_TRACE(fence, "signaled from irq context\n");
@@ -743,6 +800,73 @@ static int amdgpu_debugfs_fence_info(struct seq_file *m, void *data)
 	return 0;
 }
 
+/* upper bound in us of the histogram bucket holding the pct percentile */
+static u64 amdgpu_ring_stats_percentile(const unsigned long *hist, u64 total,
+					unsigned pct)
+{
+	u64 want = div_u64(total * pct + 99, 100), sum = 0;
+	unsigned i;
+
+	for (i = 0; i < AMDGPU_RING_STATS_BUCKETS; i++) {
+		sum += hist[i];
+		if (sum >= want)
+			break;
+	}
+
+	return 1ULL << min_t(unsigned, i, AMDGPU_RING_STATS_BUCKETS - 1);
+}
+
+static int amdgpu_debugfs_ring_stats(struct seq_file *m, void *data)
+{
+	struct drm_info_node *node = (struct drm_info_node *)m->private;
+	struct drm_device *dev = node->minor->dev;
+	struct amdgpu_device *adev = dev->dev_private;
+	unsigned long hist[AMDGPU_RING_STATS_BUCKETS];
+	int i, j;
+
+	seq_printf(m, "%-12s %10s %10s %10s %8s %8s %8s %8s %7s %7s %8s %8s\n",
+		   "ring", "submitted", "signaled", "pending", "avg_us",
+		   "p50_us", "p90_us", "p99_us", "avg_inf", "max_inf",
+		   "preempt", "soft_rec");
+
+	for (i = 0; i < AMDGPU_MAX_RINGS; ++i) {
+		struct amdgpu_ring *ring = adev->rings[i];
+		struct amdgpu_ring_stats *stats;
+		u64 submitted, signaled;
+
+		if (!ring || !ring->fence_drv.initialized)
+			continue;
+
+		stats = &ring->stats;
+		submitted = atomic64_read(&stats->submissions);
+		signaled = atomic64_read(&stats->signaled);
+		for (j = 0; j < AMDGPU_RING_STATS_BUCKETS; j++)
+			hist[j] = atomic_long_read(&stats->latency_hist[j]);
+
+		seq_printf(m, "%-12s %10llu %10llu %10u",
+			   ring->name, submitted, signaled,
+			   ring->fence_drv.sync_seq -
+			   atomic_read(&ring->fence_drv.last_seq));
+		if (signaled)
+			seq_printf(m, " %8llu %8llu %8llu %8llu",
+				   div64_u64(atomic64_read(&stats->latency_ns),
+					     signaled * NSEC_PER_USEC),
+				   amdgpu_ring_stats_percentile(hist, signaled, 50),
+				   amdgpu_ring_stats_percentile(hist, signaled, 90),
+				   amdgpu_ring_stats_percentile(hist, signaled, 99));
+		else
+			seq_printf(m, " %8s %8s %8s %8s", "-", "-", "-", "-");
+		seq_printf(m, " %7llu %7d %8llu %8llu\n",
+			   submitted ?
+			   div64_u64(atomic64_read(&stats->inflight_sum),
+				     submitted) : 0,
+			   atomic_read(&stats->inflight_max),
+			   (u64)atomic64_read(&stats->preemptions),
+			   (u64)atomic64_read(&stats->soft_recoveries));
+	}
+	return 0;
+}
+
 /**
  * amdgpu_debugfs_gpu_recover - manually trigger a gpu reset & recover
  *
@@ -762,11 +886,13 @@ static int amdgpu_debugfs_gpu_recover(struct seq_file *m, void *data)
 
 static const struct drm_info_list amdgpu_debugfs_fence_list[] = {
 	{"amdgpu_fence_info", &amdgpu_debugfs_fence_info, 0, NULL},
+	{"amdgpu_ring_stats", &amdgpu_debugfs_ring_stats, 0, NULL},
 	{"amdgpu_gpu_recover", &amdgpu_debugfs_gpu_recover, 0, NULL}
 };
 
 static const struct drm_info_list amdgpu_debugfs_fence_list_sriov[] = {
 	{"amdgpu_fence_info", &amdgpu_debugfs_fence_info, 0, NULL},
+	{"amdgpu_ring_stats", &amdgpu_debugfs_ring_stats, 0, NULL},
 };
 #endif
 
@@ -774,8 +900,8 @@ int amdgpu_debugfs_fence_init(struct amdgpu_device *adev)
 {
 #if defined(CONFIG_DEBUG_FS)
 	if (amdgpu_sriov_vf(adev))
-		return amdgpu_debugfs_add_files(adev, amdgpu_debugfs_fence_list_sriov, 1);
-	return amdgpu_debugfs_add_files(adev, amdgpu_debugfs_fence_list, 2);
+		return amdgpu_debugfs_add_files(adev, amdgpu_debugfs_fence_list_sriov, 2);
+	return amdgpu_debugfs_add_files(adev, amdgpu_debugfs_fence_list, 3);
 #else
 	return 0;
 #endif
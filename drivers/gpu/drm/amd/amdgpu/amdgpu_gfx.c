@@ -208,7 +208,14 @@ void amdgpu_gfx_compute_queue_acquire(struct amdgpu_device *adev)
 		if (mec >= adev->gfx.mec.num_mec)
 			break;
 
-		if (multipipe_policy) {
+		if (adev->asic_type == CHIP_LIVERPOOL ||
+		    adev->asic_type == CHIP_GLADIUS) {
+			/* policy: amdgpu owns the first queue of every pipe,
+			 * KFD only uses the first MEC so MEC2 is ours alone
+			 */
+			if (queue == 0)
+				set_bit(i, adev->gfx.mec.queue_bitmap);
+		} else if (multipipe_policy) {
 			/* policy: amdgpu owns the first two queues of the first MEC */
 			if (mec == 0 && queue < 2)
 				set_bit(i, adev->gfx.mec.queue_bitmap);
@@ -182,6 +182,42 @@ struct amdgpu_cu_info {
 	uint32_t bitmap[4][4];
 };
 
+/* gfx performance counters, block is in bits 16-19 of the perf config */
+#define AMDGPU_GFX_PMC_MAX_COUNTERS	8
+#define AMDGPU_GFX_PMC_GET_EVENT(x)	((x) & 0x3ffULL)
+#define AMDGPU_GFX_PMC_GET_BLOCK(x)	(((x) >> 16) & 0xfULL)
+
+enum amdgpu_gfx_pmc_block {
+	AMDGPU_GFX_PMC_GRBM = 0,
+	AMDGPU_GFX_PMC_SQ,
+	AMDGPU_GFX_PMC_TA,
+	AMDGPU_GFX_PMC_TCC,
+	AMDGPU_GFX_PMC_NUM_BLOCKS
+};
+
+struct amdgpu_gfx_pmc_cntr {
+	uint64_t	config;		/* perf config + 1, 0 when free */
+	unsigned	refs;
+	unsigned	running;
+	bool		programmed;
+	uint64_t	last;		/* raw hw value at the last poll */
+	uint64_t	count;
+};
+
+/*
+ * Counters are owned by perf but only ever touched from poll_work, which
+ * runs in process context so it can take grbm_idx_mutex and walk the
+ * SE/SH/instance indexed blocks.
+ */
+struct amdgpu_gfx_pmc {
+	spinlock_t			lock;
+	struct delayed_work		poll_work;
+	unsigned			active;
+	bool				hw_stale;
+	struct amdgpu_gfx_pmc_cntr
+		cntr[AMDGPU_GFX_PMC_NUM_BLOCKS][AMDGPU_GFX_PMC_MAX_COUNTERS];
+};
+
 struct amdgpu_gfx_funcs {
 	/* get the gpu clock counter */
 	uint64_t (*get_gpu_clock_counter)(struct amdgpu_device *adev);
@@ -199,6 +235,12 @@ struct amdgpu_gfx_funcs {
 				 u32 queue, u32 vmid);
 	int (*ras_error_inject)(struct amdgpu_device *adev, void *inject_if);
 	int (*query_ras_error_count) (struct amdgpu_device *adev, void *ras_error_status);
+	int (*pmc_start)(struct amdgpu_device *adev, uint64_t config,
+			 int is_enable);
+	int (*pmc_stop)(struct amdgpu_device *adev, uint64_t config,
+			int is_disable);
+	void (*pmc_get_count)(struct amdgpu_device *adev, uint64_t config,
+			      uint64_t *count);
 };
 
 struct amdgpu_ngg_buf {
@@ -327,6 +369,9 @@ struct amdgpu_gfx {
 
 	/*ras */
 	struct ras_common_if		*ras_if;
+
+	/* perf counters */
+	struct amdgpu_gfx_pmc		pmc;
 };
 
 #define amdgpu_gfx_get_gpu_clock_counter(adev) (adev)->gfx.funcs->get_gpu_clock_counter((adev))
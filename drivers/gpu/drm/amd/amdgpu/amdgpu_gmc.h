@@ -156,6 +156,8 @@ struct amdgpu_gmc {
 	uint32_t		vram_type;
 	uint32_t                srbm_soft_reset;
 	bool			prt_warning;
+	/* VRAM is a carve-out of system memory with the same bandwidth */
+	bool			unified_memory;
 	uint64_t		stolen_size;
 	uint32_t		sdpif_register;
 	/* apertures */
@@ -204,6 +206,24 @@ static inline bool amdgpu_gmc_vram_full_visible(struct amdgpu_gmc *gmc)
 	return (gmc->real_vram_size == gmc->visible_vram_size);
 }
 
+/**
+ * amdgpu_gmc_bo_move_pointless - Check if moving a BO buys nothing
+ *
+ * @gmc: amdgpu_gmc structure
+ * @bo_domain: domain the BO currently lives in
+ * @allowed_domains: domains the BO may be placed in
+ *
+ * Returns:
+ * True if memory is unified and the BO already sits in an allowed
+ * domain, so migrating it would only cost a copy.
+ */
+static inline bool amdgpu_gmc_bo_move_pointless(struct amdgpu_gmc *gmc,
+						u32 bo_domain,
+						u32 allowed_domains)
+{
+	return gmc->unified_memory && (bo_domain & allowed_domains);
+}
+
 /**
  * amdgpu_gmc_sign_extend - sign extend the given gmc address
  *
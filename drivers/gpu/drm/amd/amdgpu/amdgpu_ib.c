@@ -257,6 +257,9 @@ int amdgpu_ib_schedule(struct amdgpu_ring *ring, unsigned num_ibs,
 		return r;
 	}
 
+	if (job && job->push_time)
+		amdgpu_fence_set_queued(*f, job->push_time);
+
 	if (ring->funcs->insert_end)
 		ring->funcs->insert_end(ring);
 
@@ -273,10 +273,13 @@ static int amdgpu_vmid_grab_reserved(struct amdgpu_vm *vm,
 	unsigned vmhub = ring->funcs->vmhub;
 	uint64_t fence_context = adev->fence_context + ring->idx;
 	struct dma_fence *updates = sync->last_vm_update;
-	bool needs_flush = vm->use_cpu_for_update;
+	u64 cpu_seq = atomic64_read(&vm->cpu_update_seq);
+	bool needs_flush;
 	int r = 0;
 
 	*id = vm->reserved_vmid[vmhub];
+	needs_flush = vm->use_cpu_for_update &&
+		      (*id)->flushed_cpu_seq != cpu_seq;
 	if (updates && (*id)->flushed_updates &&
 	    updates->context == (*id)->flushed_updates->context &&
 	    !dma_fence_is_later(updates, (*id)->flushed_updates))
@@ -311,6 +314,7 @@ static int amdgpu_vmid_grab_reserved(struct amdgpu_vm *vm,
 		dma_fence_put((*id)->flushed_updates);
 		(*id)->flushed_updates = dma_fence_get(updates);
 	}
+	(*id)->flushed_cpu_seq = cpu_seq;
 	job->vm_needs_flush = needs_flush;
 	return 0;
 }
@@ -339,14 +343,13 @@ static int amdgpu_vmid_grab_used(struct amdgpu_vm *vm,
 	struct amdgpu_vmid_mgr *id_mgr = &adev->vm_manager.id_mgr[vmhub];
 	uint64_t fence_context = adev->fence_context + ring->idx;
 	struct dma_fence *updates = sync->last_vm_update;
+	u64 cpu_seq = atomic64_read(&vm->cpu_update_seq);
 	int r;
 
-	job->vm_needs_flush = vm->use_cpu_for_update;
-
 	/* Check if we can use a VMID already assigned to this VM */
 	list_for_each_entry_reverse((*id), &id_mgr->ids_lru, list) {
-		bool needs_flush = vm->use_cpu_for_update;
 		struct dma_fence *flushed;
+		bool needs_flush;
 
 		/* Check all the prerequisites to using this VMID */
 		if ((*id)->owner != vm->entity.fence_context)
@@ -355,6 +358,9 @@ static int amdgpu_vmid_grab_used(struct amdgpu_vm *vm,
 		if ((*id)->pd_gpu_addr != job->vm_pd_addr)
 			continue;
 
+		needs_flush = vm->use_cpu_for_update &&
+			      (*id)->flushed_cpu_seq != cpu_seq;
+
 		if (!(*id)->last_flush ||
 		    ((*id)->last_flush->context != fence_context &&
 		     !dma_fence_is_signaled((*id)->last_flush)))
@@ -383,6 +389,7 @@ static int amdgpu_vmid_grab_used(struct amdgpu_vm *vm,
 			dma_fence_put((*id)->flushed_updates);
 			(*id)->flushed_updates = dma_fence_get(updates);
 		}
+		(*id)->flushed_cpu_seq = cpu_seq;
 
 		job->vm_needs_flush |= needs_flush;
 		return 0;
@@ -442,6 +449,8 @@ int amdgpu_vmid_grab(struct amdgpu_vm *vm, struct amdgpu_ring *ring,
 
 			dma_fence_put(id->flushed_updates);
 			id->flushed_updates = dma_fence_get(updates);
+			id->flushed_cpu_seq =
+				atomic64_read(&vm->cpu_update_seq);
 			job->vm_needs_flush = true;
 		}
 
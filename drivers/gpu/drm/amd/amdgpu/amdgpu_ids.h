@@ -48,6 +48,8 @@ struct amdgpu_vmid {
 	uint64_t		pd_gpu_addr;
 	/* last flushed PD/PT update */
 	struct dma_fence	*flushed_updates;
+	/* vm->cpu_update_seq of the owner at the last flush */
+	uint64_t		flushed_cpu_seq;
 
 	uint32_t                current_gpu_reset_count;
 
@@ -132,6 +132,26 @@ void amdgpu_ih_ring_fini(struct amdgpu_device *adev, struct amdgpu_ih_ring *ih)
 	}
 }
 
+/**
+ * amdgpu_ih_pending - check for unprocessed IVs
+ *
+ * @ih: ih ring to check
+ *
+ * Only looks at the write back wptr, so it is safe to call from the hard
+ * interrupt handler while another context drains the ring. An overflow
+ * flag in the low bits also reads as pending.
+ */
+bool amdgpu_ih_pending(struct amdgpu_ih_ring *ih)
+{
+	u32 wptr;
+
+	if (!ih->enabled)
+		return false;
+
+	wptr = le32_to_cpu(*ih->wptr_cpu);
+	return (wptr & ih->ptr_mask) != READ_ONCE(ih->rptr);
+}
+
 /**
  * amdgpu_ih_process - interrupt handler
  *
@@ -143,7 +163,7 @@ void amdgpu_ih_ring_fini(struct amdgpu_device *adev, struct amdgpu_ih_ring *ih)
  */
 int amdgpu_ih_process(struct amdgpu_device *adev, struct amdgpu_ih_ring *ih)
 {
-	unsigned int count = AMDGPU_IH_MAX_NUM_IVS;
+	unsigned int count;
 	u32 wptr;
 
 	if (!ih->enabled || adev->shutdown)
@@ -161,7 +181,9 @@ int amdgpu_ih_process(struct amdgpu_device *adev, struct amdgpu_ih_ring *ih)
 	/* Order reading of wptr vs. reading of IH ring data */
 	rmb();
 
-	while (ih->rptr != wptr && --count) {
+	/* hand ring space back to the IH after every batch */
+	count = AMDGPU_IH_MAX_NUM_IVS;
+	while (ih->rptr != wptr && count--) {
 		amdgpu_irq_dispatch(adev, ih);
 		ih->rptr &= ih->ptr_mask;
 	}
@@ -42,6 +42,7 @@
  * support is used (with mapping between virtual and hardware IRQs).
  */
 
+#include <linux/interrupt.h>
 #include <linux/irq.h>
 #include <linux/pci.h>
 
@@ -150,6 +151,35 @@ irqreturn_t amdgpu_irq_handler(int irq, void *arg)
 	struct amdgpu_device *adev = dev->dev_private;
 	irqreturn_t ret;
 
+	if (adev->irq.threaded)
+		return amdgpu_ih_pending(&adev->irq.ih) ?
+			IRQ_WAKE_THREAD : IRQ_NONE;
+
+	ret = amdgpu_ih_process(adev, &adev->irq.ih);
+	if (ret == IRQ_HANDLED)
+		pm_runtime_mark_last_busy(dev->dev);
+	return ret;
+}
+
+/**
+ * amdgpu_irq_thread_fn - threaded IRQ handler
+ *
+ * @irq: IRQ number (unused)
+ * @arg: pointer to DRM device
+ *
+ * Drains the IH ring on behalf of amdgpu_irq_handler() when the interrupt
+ * is threaded. A burst of VM faults or fences then no longer holds off
+ * the other interrupts on the CPU that takes the GPU interrupt.
+ *
+ * Returns:
+ * result of handling the IRQ, as defined by &irqreturn_t
+ */
+static irqreturn_t amdgpu_irq_thread_fn(int irq, void *arg)
+{
+	struct drm_device *dev = (struct drm_device *) arg;
+	struct amdgpu_device *adev = dev->dev_private;
+	irqreturn_t ret;
+
 	ret = amdgpu_ih_process(adev, &adev->irq.ih);
 	if (ret == IRQ_HANDLED)
 		pm_runtime_mark_last_busy(dev->dev);
@@ -207,6 +237,60 @@ static bool amdgpu_msi_ok(struct amdgpu_device *adev)
 	return true;
 }
 
+/**
+ * amdgpu_irq_thread_ok - check whether the IH ring should be threaded
+ *
+ * @adev: amdgpu device pointer
+ *
+ * Threading needs an exclusive interrupt, so it is only used with MSI.
+ *
+ * Returns:
+ * *true* if the IH ring should be drained by an IRQ thread
+ */
+static bool amdgpu_irq_thread_ok(struct amdgpu_device *adev)
+{
+	if (!adev->irq.msi_enabled || amdgpu_irq_thread == 0)
+		return false;
+	if (amdgpu_irq_thread == 1)
+		return true;
+
+	return adev->asic_type == CHIP_LIVERPOOL ||
+	       adev->asic_type == CHIP_GLADIUS;
+}
+
+/**
+ * amdgpu_irq_install_threaded - install a threaded IRQ handler
+ *
+ * @adev: amdgpu device pointer
+ *
+ * Does what drm_irq_install() does, but with amdgpu_irq_handler() as the
+ * primary handler and amdgpu_irq_thread_fn() as the thread.
+ *
+ * Returns:
+ * 0 on success or error code on failure
+ */
+static int amdgpu_irq_install_threaded(struct amdgpu_device *adev)
+{
+	struct drm_device *dev = adev->ddev;
+	int irq = dev->pdev->irq;
+	int r;
+
+	if (dev->irq_enabled)
+		return -EBUSY;
+
+	adev->irq.threaded = true;
+	r = request_threaded_irq(irq, amdgpu_irq_handler, amdgpu_irq_thread_fn,
+				 0, dev->driver->name, dev);
+	if (r) {
+		adev->irq.threaded = false;
+		return r;
+	}
+
+	dev->irq = irq;
+	dev->irq_enabled = true;
+	return 0;
+}
+
 /**
  * amdgpu_irq_init - initialize interrupt handling
  *
@@ -254,7 +338,13 @@ int amdgpu_irq_init(struct amdgpu_device *adev)
 	INIT_WORK(&adev->irq.ih2_work, amdgpu_irq_handle_ih2);
 
 	adev->irq.installed = true;
-	r = drm_irq_install(adev->ddev, adev->ddev->pdev->irq);
+	if (amdgpu_irq_thread_ok(adev)) {
+		r = amdgpu_irq_install_threaded(adev);
+		if (!r)
+			dev_info(adev->dev, "amdgpu: IH ring is threaded.\n");
+	} else {
+		r = drm_irq_install(adev->ddev, adev->ddev->pdev->irq);
+	}
 	if (r) {
 		adev->irq.installed = false;
 		if (!amdgpu_device_has_dc_support(adev))
@@ -281,7 +371,13 @@ void amdgpu_irq_fini(struct amdgpu_device *adev)
 	unsigned i, j;
 
 	if (adev->irq.installed) {
-		drm_irq_uninstall(adev->ddev);
+		if (adev->irq.threaded) {
+			adev->ddev->irq_enabled = false;
+			free_irq(adev->ddev->irq, adev->ddev);
+			adev->irq.threaded = false;
+		} else {
+			drm_irq_uninstall(adev->ddev);
+		}
 		adev->irq.installed = false;
 		if (adev->irq.msi_enabled)
 			pci_disable_msi(adev->pdev);
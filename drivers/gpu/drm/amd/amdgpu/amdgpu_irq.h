@@ -86,6 +86,7 @@ struct amdgpu_irq {
 
 	/* status, etc. */
 	bool				msi_enabled; /* msi enabled */
+	bool				threaded; /* IH drained by the irq thread */
 
 	/* interrupt rings */
 	struct amdgpu_ih_ring		ih, ih1, ih2;
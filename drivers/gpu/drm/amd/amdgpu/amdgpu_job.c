@@ -158,6 +158,7 @@ int amdgpu_job_submit(struct amdgpu_job *job, struct drm_sched_entity *entity,
 	*f = dma_fence_get(&job->base.s_fence->finished);
 	amdgpu_job_free_resources(job);
 	priority = job->base.s_priority;
+	job->push_time = ktime_get();
 	drm_sched_entity_push_job(&job->base, entity);
 
 	ring = to_amdgpu_ring(entity->rq->sched);
@@ -982,6 +982,13 @@ int amdgpu_driver_open_kms(struct drm_device *dev, struct drm_file *file_priv)
 	if (r < 0)
 		goto pm_put;
 
+	/* render node clients (compute) never need the display */
+	if (!drm_is_render_client(file_priv)) {
+		r = amdgpu_device_display_bringup(adev);
+		if (r)
+			goto out_suspend;
+	}
+
 	fpriv = kzalloc(sizeof(*fpriv), GFP_KERNEL);
 	if (unlikely(!fpriv)) {
 		r = -ENOMEM;
@@ -41,6 +41,13 @@
  * New command submissions using the userptrs in question are delayed until all
  * page table invalidation are completed and we once more see a coherent process
  * address space.
+ *
+ * Invalidations never touch the GPU page tables directly, so there is no
+ * per-range VM flush to batch. The core mm already sends a single notifier
+ * range per unmap. For gfx we only wait for the fences of the affected BOs,
+ * and their mappings get updated on the next validation. For HSA the first
+ * evicted BO quiesces the process queues and arms one delayed restore, and
+ * later BOs of the same batch only bump the eviction counter.
  */
 
 #include <linux/firmware.h>
@@ -234,6 +241,55 @@ amdgpu_mn_sync_pagetables_gfx(struct hmm_mirror *mirror,
 	return 0;
 }
 
+/**
+ * amdgpu_mn_range_busy_gfx - check for GPU work on a range
+ *
+ * @mirror: the hmm_mirror (mm) about to be updated
+ * @start: start of address range
+ * @end: end of address range (exclusive)
+ *
+ * Returns true if any userptr BO in the range still has unsignaled fences,
+ * i.e. amdgpu_mn_sync_pagetables_gfx() would block on it. Lets khugepaged
+ * wait for the GPU to be done before collapsing the range into a huge page;
+ * the BO then picks up the new pages on its next validation.
+ */
+static bool amdgpu_mn_range_busy_gfx(struct hmm_mirror *mirror,
+				     unsigned long start, unsigned long end)
+{
+	struct amdgpu_mn *amn = container_of(mirror, struct amdgpu_mn, mirror);
+	struct interval_tree_node *it;
+	bool busy = false;
+
+	/* notification is exclusive, but interval is inclusive */
+	end -= 1;
+
+	if (amdgpu_mn_read_lock(amn, false))
+		return false;
+
+	it = interval_tree_iter_first(&amn->objects, start, end);
+	while (it && !busy) {
+		struct amdgpu_mn_node *node;
+		struct amdgpu_bo *bo;
+
+		node = container_of(it, struct amdgpu_mn_node, it);
+		it = interval_tree_iter_next(it, start, end);
+
+		list_for_each_entry(bo, &node->bos, mn_list) {
+			if (amdgpu_ttm_tt_affect_userptr(bo->tbo.ttm,
+							 start, end) &&
+			    !dma_resv_test_signaled_rcu(bo->tbo.base.resv,
+							true)) {
+				busy = true;
+				break;
+			}
+		}
+	}
+
+	amdgpu_mn_read_unlock(amn);
+
+	return busy;
+}
+
 /**
  * amdgpu_mn_sync_pagetables_hsa - callback to notify about mm change
  *
@@ -296,6 +352,7 @@ amdgpu_mn_sync_pagetables_hsa(struct hmm_mirror *mirror,
 static struct hmm_mirror_ops amdgpu_hmm_mirror_ops[] = {
 	[AMDGPU_MN_TYPE_GFX] = {
 		.sync_cpu_device_pagetables = amdgpu_mn_sync_pagetables_gfx,
+		.range_busy = amdgpu_mn_range_busy_gfx,
 		.release = amdgpu_hmm_mirror_release
 	},
 	[AMDGPU_MN_TYPE_HSA] = {
@@ -310,6 +310,15 @@ struct amdgpu_fbdev {
 	struct amdgpu_framebuffer rfb;
 	struct list_head fbdev_list;
 	struct amdgpu_device *adev;
+
+	/* system memory copy the console draws into, NULL if unused */
+	struct amdgpu_bo *shadow;
+	void *shadow_ptr;
+	u64 shadow_gpu_addr;
+	struct delayed_work flush_work;
+	struct dma_fence *flush_fence;
+	spinlock_t damage_lock;
+	u32 damage_y1, damage_y2;
 };
 
 struct amdgpu_mode_info {
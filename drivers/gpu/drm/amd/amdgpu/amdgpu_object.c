@@ -557,6 +557,13 @@ static int amdgpu_bo_do_create(struct amdgpu_device *adev,
 	if (bp->type != ttm_bo_type_kernel &&
 	    bo->allowed_domains == AMDGPU_GEM_DOMAIN_VRAM)
 		bo->allowed_domains |= AMDGPU_GEM_DOMAIN_GTT;
+	/* With unified memory GTT is as fast as VRAM for CPU visible BOs,
+	 * let them fall back there instead of evicting other BOs.
+	 */
+	if (adev->gmc.unified_memory &&
+	    (bp->flags & AMDGPU_GEM_CREATE_CPU_ACCESS_REQUIRED) &&
+	    (bo->allowed_domains & AMDGPU_GEM_DOMAIN_VRAM))
+		bo->allowed_domains |= AMDGPU_GEM_DOMAIN_GTT;
 
 	bo->flags = bp->flags;
 
@@ -1268,6 +1275,7 @@ void amdgpu_bo_move_notify(struct ttm_buffer_object *bo,
 		return;
 
 	abo = ttm_to_amdgpu_bo(bo);
+	abo->move_seq++;
 	amdgpu_vm_bo_invalidate(adev, abo, evict);
 
 	amdgpu_bo_kunmap(abo);
@@ -91,6 +91,14 @@ struct amdgpu_bo {
 	void				*metadata;
 	u32				metadata_size;
 	unsigned			prime_shared_count;
+	/* bumped by every move, so CS can tell the BO is still where it
+	 * put it and skip validating it again
+	 */
+	u32				move_seq;
+	u32				cs_valid_seq;
+	u32				cs_valid_domain;
+	u32				cs_valid_mem_type;
+	u64				cs_valid_flags;
 	/* per VM structure for page tables and with virtual addresses */
 	struct amdgpu_vm_bo_base	*vm_bo;
 	/* Constant after initialization */
@@ -28,6 +28,7 @@
 #include "amdgpu.h"
 #include "amdgpu_pmu.h"
 #include "df_v3_6.h"
+#include "gfx_v7_0.h"
 
 #define PMU_NAME_SIZE 32
 
@@ -46,11 +47,19 @@ static LIST_HEAD(amdgpu_pmu_list);
 static int amdgpu_perf_event_init(struct perf_event *event)
 {
 	struct hw_perf_event *hwc = &event->hw;
+	struct amdgpu_pmu_entry *pe = container_of(event->pmu,
+						  struct amdgpu_pmu_entry,
+						  pmu);
 
 	/* test the event attr type check for PMU enumeration */
 	if (event->attr.type != event->pmu->type)
 		return -ENOENT;
 
+	/* gfx counters are polled, they cannot raise an overflow interrupt */
+	if (pe->pmu_perf_type == PERF_TYPE_AMDGPU_GFX &&
+	    is_sampling_event(event))
+		return -EINVAL;
+
 	/* update the hw_perf_event struct with config data */
 	hwc->conf = event->attr.config;
 
@@ -78,6 +87,9 @@ static void amdgpu_perf_start(struct perf_event *event, int flags)
 
 		pe->adev->df_funcs->pmc_start(pe->adev, hwc->conf, 0);
 		break;
+	case PERF_TYPE_AMDGPU_GFX:
+		pe->adev->gfx.funcs->pmc_start(pe->adev, hwc->conf, 0);
+		break;
 	default:
 		break;
 	}
@@ -104,6 +116,10 @@ static void amdgpu_perf_read(struct perf_event *event)
 			pe->adev->df_funcs->pmc_get_count(pe->adev, hwc->conf,
 							  &count);
 			break;
+		case PERF_TYPE_AMDGPU_GFX:
+			pe->adev->gfx.funcs->pmc_get_count(pe->adev, hwc->conf,
+							   &count);
+			break;
 		default:
 			count = 0;
 			break;
@@ -128,6 +144,9 @@ static void amdgpu_perf_stop(struct perf_event *event, int flags)
 	case PERF_TYPE_AMDGPU_DF:
 		pe->adev->df_funcs->pmc_stop(pe->adev, hwc->conf, 0);
 		break;
+	case PERF_TYPE_AMDGPU_GFX:
+		pe->adev->gfx.funcs->pmc_stop(pe->adev, hwc->conf, 0);
+		break;
 	default:
 		break;
 	};
@@ -158,6 +177,9 @@ static int amdgpu_perf_add(struct perf_event *event, int flags)
 	case PERF_TYPE_AMDGPU_DF:
 		retval = pe->adev->df_funcs->pmc_start(pe->adev, hwc->conf, 1);
 		break;
+	case PERF_TYPE_AMDGPU_GFX:
+		retval = pe->adev->gfx.funcs->pmc_start(pe->adev, hwc->conf, 1);
+		break;
 	default:
 		return 0;
 	};
@@ -186,6 +208,9 @@ static void amdgpu_perf_del(struct perf_event *event, int flags)
 	case PERF_TYPE_AMDGPU_DF:
 		pe->adev->df_funcs->pmc_stop(pe->adev, hwc->conf, 1);
 		break;
+	case PERF_TYPE_AMDGPU_GFX:
+		pe->adev->gfx.funcs->pmc_stop(pe->adev, hwc->conf, 1);
+		break;
 	default:
 		break;
 	};
@@ -257,6 +282,13 @@ int amdgpu_pmu_init(struct amdgpu_device *adev)
 
 		/* other pmu types go here*/
 		break;
+	case CHIP_LIVERPOOL:
+	case CHIP_GLADIUS:
+		/* GRBM/SQ/TA/TCC counters of the CIK gfx block */
+		ret = init_pmu_by_type(adev, gfx_v7_0_attr_groups,
+				       "GFX", "amdgpu_gfx", PERF_TYPE_AMDGPU_GFX,
+				       AMDGPU_GFX_PMC_MAX_COUNTERS);
+		break;
 	default:
 		return 0;
 	}
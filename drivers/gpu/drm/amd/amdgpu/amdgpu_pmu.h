@@ -28,6 +28,7 @@
 
 enum amdgpu_pmu_perf_type {
 	PERF_TYPE_AMDGPU_DF = 0,
+	PERF_TYPE_AMDGPU_GFX,
 	PERF_TYPE_AMDGPU_MAX
 };
 
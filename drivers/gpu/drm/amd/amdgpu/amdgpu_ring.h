@@ -65,6 +65,25 @@ struct amdgpu_ib;
 struct amdgpu_cs_parser;
 struct amdgpu_job;
 
+/*
+ * Ring statistics, cheap enough to keep on in production.  Latency is
+ * measured from drm_sched push (or fence emit for kernel submissions)
+ * to fence signal and binned by log2 of microseconds.
+ */
+#define AMDGPU_RING_STATS_BUCKETS	24
+
+struct amdgpu_ring_stats {
+	atomic64_t			submissions;
+	atomic64_t			signaled;
+	atomic64_t			latency_ns;
+	atomic_long_t			latency_hist[AMDGPU_RING_STATS_BUCKETS];
+	/* fences in flight when a new one is emitted */
+	atomic64_t			inflight_sum;
+	atomic_t			inflight_max;
+	atomic64_t			preemptions;
+	atomic64_t			soft_recoveries;
+};
+
 /*
  * Fences.
  */
@@ -97,6 +116,7 @@ void amdgpu_fence_driver_resume(struct amdgpu_device *adev);
 int amdgpu_fence_emit(struct amdgpu_ring *ring, struct dma_fence **fence,
 		      unsigned flags);
 int amdgpu_fence_emit_polling(struct amdgpu_ring *ring, uint32_t *s);
+void amdgpu_fence_set_queued(struct dma_fence *f, ktime_t queued);
 bool amdgpu_fence_process(struct amdgpu_ring *ring);
 int amdgpu_fence_wait_empty(struct amdgpu_ring *ring);
 signed long amdgpu_fence_wait_polling(struct amdgpu_ring *ring,
@@ -223,6 +243,8 @@ struct amdgpu_ring {
 	/* protected by priority_mutex */
 	int			priority;
 
+	struct amdgpu_ring_stats	stats;
+
 #if defined(CONFIG_DEBUG_FS)
 	struct dentry *ent;
 #endif
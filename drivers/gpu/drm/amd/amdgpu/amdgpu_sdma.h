@@ -58,6 +58,8 @@ struct amdgpu_sdma {
 	int			num_instances;
 	uint32_t                    srbm_soft_reset;
 	bool			has_page_queue;
+	/* SDMA_OPCODE_WRITE does not land in memory, avoid it (Liverpool) */
+	bool			write_linear_broken;
 	struct ras_common_if	*ras_if;
 };
 
@@ -62,6 +62,10 @@ static int amdgpu_map_buffer(struct ttm_buffer_object *bo,
 			     uint64_t offset, unsigned window,
 			     struct amdgpu_ring *ring,
 			     uint64_t *addr);
+static int amdgpu_map_dma_window(struct amdgpu_device *adev,
+				 dma_addr_t *dma_address, unsigned num_pages,
+				 uint64_t flags, unsigned window,
+				 struct amdgpu_ring *ring, uint64_t *addr);
 
 static int amdgpu_ttm_debugfs_init(struct amdgpu_device *adev);
 static void amdgpu_ttm_debugfs_fini(struct amdgpu_device *adev);
@@ -193,6 +197,14 @@ static void amdgpu_evict_flags(struct ttm_buffer_object *bo,
 			abo->placements[0].lpfn = 0;
 			abo->placement.busy_placement = &abo->placements[1];
 			abo->placement.num_busy_placement = 1;
+		} else if (adev->gmc.unified_memory) {
+			/* Prefer GTT, but don't evict other BOs out of the
+			 * GART to make room; system memory is just as good.
+			 */
+			amdgpu_bo_placement_from_domain(abo, AMDGPU_GEM_DOMAIN_GTT |
+							 AMDGPU_GEM_DOMAIN_CPU);
+			abo->placement.busy_placement = &abo->placements[1];
+			abo->placement.num_busy_placement = 1;
 		} else {
 			/* Move to GTT memory */
 			amdgpu_bo_placement_from_domain(abo, AMDGPU_GEM_DOMAIN_GTT);
@@ -416,6 +428,137 @@ int amdgpu_ttm_copy_mem_to_mem(struct amdgpu_device *adev,
 	return r;
 }
 
+/*
+ * Copy with the buffer ring. The system memory sides are contiguous in DMA
+ * address space and get mapped piecewise through the GTT transfer windows,
+ * window 0 for @src and window 1 for @dst. A side flagged as VRAM is an MC
+ * address and is used as is.
+ */
+static int amdgpu_ttm_copy_windowed(struct amdgpu_device *adev,
+				    uint64_t src, bool src_vram,
+				    uint64_t dst, bool dst_vram,
+				    uint64_t size, struct dma_fence **f)
+{
+	struct amdgpu_ring *ring = adev->mman.buffer_funcs_ring;
+	const uint64_t GTT_MAX_BYTES = (AMDGPU_GTT_MAX_TRANSFER_SIZE *
+					AMDGPU_GPU_PAGE_SIZE);
+	uint64_t flags = AMDGPU_PTE_VALID | AMDGPU_PTE_SYSTEM |
+			 AMDGPU_PTE_SNOOPED | AMDGPU_PTE_READABLE |
+			 AMDGPU_PTE_WRITEABLE | adev->gart.gart_pte_flags;
+	struct dma_fence *fence = NULL;
+	dma_addr_t *pages;
+	int r = 0;
+
+	if (!adev->mman.buffer_funcs_enabled) {
+		DRM_ERROR("Trying to move memory with ring turned off.\n");
+		return -EINVAL;
+	}
+
+	pages = kmalloc_array(AMDGPU_GTT_MAX_TRANSFER_SIZE, sizeof(*pages),
+			      GFP_KERNEL);
+	if (!pages)
+		return -ENOMEM;
+
+	mutex_lock(&adev->mman.gtt_window_lock);
+
+	while (size) {
+		uint64_t src_page_offset = src_vram ? 0 : src & ~PAGE_MASK;
+		uint64_t dst_page_offset = dst_vram ? 0 : dst & ~PAGE_MASK;
+		uint64_t cur_size, from = src, to = dst;
+		struct dma_fence *next;
+		unsigned i, num_pages;
+
+		cur_size = min(size, GTT_MAX_BYTES -
+			       max(src_page_offset, dst_page_offset));
+
+		if (!src_vram) {
+			num_pages = PFN_UP(cur_size + src_page_offset);
+			for (i = 0; i < num_pages; i++)
+				pages[i] = (src & PAGE_MASK) +
+					   ((dma_addr_t)i << PAGE_SHIFT);
+			r = amdgpu_map_dma_window(adev, pages, num_pages, flags,
+						  0, ring, &from);
+			if (r)
+				goto error;
+			from += src_page_offset;
+		}
+
+		if (!dst_vram) {
+			num_pages = PFN_UP(cur_size + dst_page_offset);
+			for (i = 0; i < num_pages; i++)
+				pages[i] = (dst & PAGE_MASK) +
+					   ((dma_addr_t)i << PAGE_SHIFT);
+			r = amdgpu_map_dma_window(adev, pages, num_pages, flags,
+						  1, ring, &to);
+			if (r)
+				goto error;
+			to += dst_page_offset;
+		}
+
+		r = amdgpu_copy_buffer(ring, from, to, cur_size, NULL, &next,
+				       false, true);
+		if (r)
+			goto error;
+
+		dma_fence_put(fence);
+		fence = next;
+
+		src += cur_size;
+		dst += cur_size;
+		size -= cur_size;
+	}
+error:
+	mutex_unlock(&adev->mman.gtt_window_lock);
+	kfree(pages);
+	if (f)
+		*f = dma_fence_get(fence);
+	dma_fence_put(fence);
+	return r;
+}
+
+/**
+ * amdgpu_ttm_copy_dma - copy between two DMA addresses with the buffer ring
+ *
+ * @adev: amdgpu device
+ * @src: DMA address of the source, mapped for adev->dev
+ * @dst: DMA address of the destination, mapped for adev->dev
+ * @size: number of bytes to copy
+ * @f: Returns the last fence if multiple jobs are submitted.
+ *
+ * Both ranges are system memory that is contiguous in DMA address space.
+ * They are mapped piecewise through the GTT transfer windows, so nothing
+ * needs to be bound to the GART up front.
+ */
+int amdgpu_ttm_copy_dma(struct amdgpu_device *adev, dma_addr_t src,
+			dma_addr_t dst, uint64_t size, struct dma_fence **f)
+{
+	return amdgpu_ttm_copy_windowed(adev, src, false, dst, false, size, f);
+}
+
+/**
+ * amdgpu_ttm_copy_vram_dma - copy between VRAM and a DMA address
+ *
+ * @adev: amdgpu device
+ * @vram: MC address of the VRAM side
+ * @dma: DMA address of the system memory side, mapped for adev->dev
+ * @size: number of bytes to copy
+ * @to_vram: copy from @dma to @vram if true, the other way round otherwise
+ * @f: Returns the last fence if multiple jobs are submitted.
+ *
+ * Like amdgpu_ttm_copy_dma(), but only the system memory side goes through
+ * a GTT transfer window. The caller makes sure that whatever lives at @vram
+ * doesn't move until the fence signals.
+ */
+int amdgpu_ttm_copy_vram_dma(struct amdgpu_device *adev, uint64_t vram,
+			     dma_addr_t dma, uint64_t size, bool to_vram,
+			     struct dma_fence **f)
+{
+	if (to_vram)
+		return amdgpu_ttm_copy_windowed(adev, dma, false, vram, true,
+						size, f);
+	return amdgpu_ttm_copy_windowed(adev, vram, true, dma, false, size, f);
+}
+
 /**
  * amdgpu_move_blit - Copy an entire buffer to another buffer
  *
@@ -1905,12 +2048,26 @@ static int amdgpu_map_buffer(struct ttm_buffer_object *bo,
 	struct amdgpu_ttm_tt *gtt = (void *)bo->ttm;
 	struct amdgpu_device *adev = ring->adev;
 	struct ttm_tt *ttm = bo->ttm;
+	dma_addr_t *dma_address;
+	uint64_t flags;
+
+	dma_address = &gtt->ttm.dma_address[offset >> PAGE_SHIFT];
+	flags = amdgpu_ttm_tt_pte_flags(adev, ttm, mem);
+	return amdgpu_map_dma_window(adev, dma_address, num_pages, flags,
+				     window, ring, addr);
+}
+
+/* Point GTT transfer window @window at @dma_address, from the ring itself so
+ * that the update is ordered with the copies using it */
+static int amdgpu_map_dma_window(struct amdgpu_device *adev,
+				 dma_addr_t *dma_address, unsigned num_pages,
+				 uint64_t flags, unsigned window,
+				 struct amdgpu_ring *ring, uint64_t *addr)
+{
 	struct amdgpu_job *job;
 	unsigned num_dw, num_bytes;
-	dma_addr_t *dma_address;
 	struct dma_fence *fence;
 	uint64_t src_addr, dst_addr;
-	uint64_t flags;
 	int r;
 
 	BUG_ON(adev->mman.buffer_funcs->copy_max_bytes <
@@ -1941,8 +2098,6 @@ static int amdgpu_map_buffer(struct ttm_buffer_object *bo,
 	amdgpu_ring_pad_ib(ring, &job->ibs[0]);
 	WARN_ON(job->ibs[0].length_dw > num_dw);
 
-	dma_address = &gtt->ttm.dma_address[offset >> PAGE_SHIFT];
-	flags = amdgpu_ttm_tt_pte_flags(adev, ttm, mem);
 	r = amdgpu_gart_map(adev, 0, num_pages, dma_address, flags,
 			    &job->ibs[0].ptr[num_dw]);
 	if (r)
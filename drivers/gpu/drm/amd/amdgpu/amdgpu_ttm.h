@@ -94,6 +94,11 @@ int amdgpu_ttm_copy_mem_to_mem(struct amdgpu_device *adev,
 			       uint64_t size,
 			       struct dma_resv *resv,
 			       struct dma_fence **f);
+int amdgpu_ttm_copy_dma(struct amdgpu_device *adev, dma_addr_t src,
+			dma_addr_t dst, uint64_t size, struct dma_fence **f);
+int amdgpu_ttm_copy_vram_dma(struct amdgpu_device *adev, uint64_t vram,
+			     dma_addr_t dma, uint64_t size, bool to_vram,
+			     struct dma_fence **f);
 int amdgpu_fill_buffer(struct amdgpu_bo *bo,
 			uint32_t src_data,
 			struct dma_resv *resv,
@@ -58,6 +58,8 @@
 #define FIRMWARE_KAVERI	"amdgpu/kaveri_uvd.bin"
 #define FIRMWARE_HAWAII	"amdgpu/hawaii_uvd.bin"
 #define FIRMWARE_MULLINS	"amdgpu/mullins_uvd.bin"
+#define FIRMWARE_LIVERPOOL	"amdgpu/liverpool_uvd.bin"
+#define FIRMWARE_GLADIUS	"amdgpu/gladius_uvd.bin"
 #endif
 #define FIRMWARE_TONGA		"amdgpu/tonga_uvd.bin"
 #define FIRMWARE_CARRIZO	"amdgpu/carrizo_uvd.bin"
@@ -104,6 +106,8 @@ MODULE_FIRMWARE(FIRMWARE_KABINI);
 MODULE_FIRMWARE(FIRMWARE_KAVERI);
 MODULE_FIRMWARE(FIRMWARE_HAWAII);
 MODULE_FIRMWARE(FIRMWARE_MULLINS);
+MODULE_FIRMWARE(FIRMWARE_LIVERPOOL);
+MODULE_FIRMWARE(FIRMWARE_GLADIUS);
 #endif
 MODULE_FIRMWARE(FIRMWARE_TONGA);
 MODULE_FIRMWARE(FIRMWARE_CARRIZO);
@@ -147,6 +151,12 @@ int amdgpu_uvd_sw_init(struct amdgpu_device *adev)
 	case CHIP_MULLINS:
 		fw_name = FIRMWARE_MULLINS;
 		break;
+	case CHIP_LIVERPOOL:
+		fw_name = FIRMWARE_LIVERPOOL;
+		break;
+	case CHIP_GLADIUS:
+		fw_name = FIRMWARE_GLADIUS;
+		break;
 #endif
 	case CHIP_TONGA:
 		fw_name = FIRMWARE_TONGA;
@@ -45,6 +45,8 @@
 #define FIRMWARE_KAVERI	"amdgpu/kaveri_vce.bin"
 #define FIRMWARE_HAWAII	"amdgpu/hawaii_vce.bin"
 #define FIRMWARE_MULLINS	"amdgpu/mullins_vce.bin"
+#define FIRMWARE_LIVERPOOL	"amdgpu/liverpool_vce.bin"
+#define FIRMWARE_GLADIUS	"amdgpu/gladius_vce.bin"
 #endif
 #define FIRMWARE_TONGA		"amdgpu/tonga_vce.bin"
 #define FIRMWARE_CARRIZO	"amdgpu/carrizo_vce.bin"
@@ -65,6 +67,8 @@ MODULE_FIRMWARE(FIRMWARE_KABINI);
 MODULE_FIRMWARE(FIRMWARE_KAVERI);
 MODULE_FIRMWARE(FIRMWARE_HAWAII);
 MODULE_FIRMWARE(FIRMWARE_MULLINS);
+MODULE_FIRMWARE(FIRMWARE_LIVERPOOL);
+MODULE_FIRMWARE(FIRMWARE_GLADIUS);
 #endif
 MODULE_FIRMWARE(FIRMWARE_TONGA);
 MODULE_FIRMWARE(FIRMWARE_CARRIZO);
@@ -112,6 +116,12 @@ int amdgpu_vce_sw_init(struct amdgpu_device *adev, unsigned long size)
 	case CHIP_MULLINS:
 		fw_name = FIRMWARE_MULLINS;
 		break;
+	case CHIP_LIVERPOOL:
+		fw_name = FIRMWARE_LIVERPOOL;
+		break;
+	case CHIP_GLADIUS:
+		fw_name = FIRMWARE_GLADIUS;
+		break;
 #endif
 	case CHIP_TONGA:
 		fw_name = FIRMWARE_TONGA;
@@ -1298,8 +1298,7 @@ static void amdgpu_vm_update_flags(struct amdgpu_vm_update_params *params,
 		flags |= AMDGPU_PTE_EXECUTABLE;
 	}
 
-	params->vm->update_funcs->update(params, bo, pe, addr, count, incr,
-					 flags);
+	params->funcs->update(params, bo, pe, addr, count, incr, flags);
 }
 
 /**
@@ -1512,18 +1511,40 @@ static int amdgpu_vm_bo_update_mapping(struct amdgpu_device *adev,
 {
 	struct amdgpu_vm_update_params params;
 	void *owner = AMDGPU_FENCE_OWNER_VM;
+	struct dma_fence *f = NULL;
 	int r;
 
 	memset(&params, 0, sizeof(params));
 	params.adev = adev;
 	params.vm = vm;
 	params.pages_addr = pages_addr;
+	params.funcs = vm->update_funcs;
 
 	/* sync to everything except eviction fences on unmapping */
 	if (!(flags & AMDGPU_PTE_VALID))
 		owner = AMDGPU_FENCE_OWNER_KFD;
 
-	r = vm->update_funcs->prepare(&params, owner, exclusive);
+	/* Writing a large range through the CPU costs more than one
+	 * SDMA submission, so hand bulk updates to the DMA engine.
+	 */
+	if (vm->use_cpu_for_update &&
+	    adev->vm_manager.vm_update_max_cpu_ptes &&
+	    last - start + 1 > adev->vm_manager.vm_update_max_cpu_ptes)
+		params.funcs = &amdgpu_vm_sdma_funcs;
+
+	/* VM updates on the same entity don't sync to each other, so wait
+	 * for the last bulk update before the CPU touches the tables again.
+	 */
+	if (params.funcs == &amdgpu_vm_cpu_funcs && vm->last_bulk_update) {
+		r = dma_fence_wait(vm->last_bulk_update, true);
+		if (r)
+			return r;
+
+		dma_fence_put(vm->last_bulk_update);
+		vm->last_bulk_update = NULL;
+	}
+
+	r = params.funcs->prepare(&params, owner, exclusive);
 	if (r)
 		return r;
 
@@ -1531,7 +1552,19 @@ static int amdgpu_vm_bo_update_mapping(struct amdgpu_device *adev,
 	if (r)
 		return r;
 
-	return vm->update_funcs->commit(&params, fence);
+	if (params.funcs == vm->update_funcs)
+		return params.funcs->commit(&params, fence);
+
+	r = params.funcs->commit(&params, &f);
+	if (r)
+		return r;
+
+	dma_fence_put(vm->last_bulk_update);
+	vm->last_bulk_update = dma_fence_get(f);
+	if (fence)
+		swap(*fence, f);
+	dma_fence_put(f);
+	return 0;
 }
 
 /**
@@ -1567,6 +1600,15 @@ static int amdgpu_vm_bo_split_mapping(struct amdgpu_device *adev,
 	uint64_t pfn, start = mapping->start;
 	int r;
 
+	/*
+	 * With unified memory GTT is the same memory as VRAM and holds most
+	 * BOs, so map every contiguous run that can take a 64KB fragment
+	 * linearly instead of only full sized fragments.
+	 */
+	if (adev->gmc.unified_memory)
+		min_linear_pages = min_t(unsigned, min_linear_pages,
+					 AMDGPU_VM_UNIFIED_MIN_LINEAR_PAGES);
+
 	/* normally,bo_va->flags only contians READABLE and WIRTEABLE bit go here
 	 * but in case of something, we filter the flags in first place
 	 */
@@ -2716,6 +2758,8 @@ int amdgpu_vm_init(struct amdgpu_device *adev, struct amdgpu_vm *vm,
 	else
 		vm->update_funcs = &amdgpu_vm_sdma_funcs;
 	vm->last_update = NULL;
+	vm->last_bulk_update = NULL;
+	atomic64_set(&vm->cpu_update_seq, 0);
 
 	amdgpu_vm_bo_param(adev, vm, adev->vm_manager.root_level, &bp);
 	if (vm_context == AMDGPU_VM_CONTEXT_COMPUTE)
@@ -2996,6 +3040,7 @@ void amdgpu_vm_fini(struct amdgpu_device *adev, struct amdgpu_vm *vm)
 	amdgpu_bo_unref(&root);
 	WARN_ON(vm->root.base.bo);
 	dma_fence_put(vm->last_update);
+	dma_fence_put(vm->last_bulk_update);
 	for (i = 0; i < AMDGPU_MAX_VMHUBS; i++)
 		amdgpu_vmid_free_reserved(adev, vm, i);
 }
@@ -3022,15 +3067,25 @@ void amdgpu_vm_manager_init(struct amdgpu_device *adev)
 	atomic_set(&adev->vm_manager.num_prt_users, 0);
 
 	/* If not overridden by the user, by default, only in large BAR systems
-	 * Compute VM tables will be updated by CPU
+	 * Compute VM tables will be updated by CPU. On unified memory parts
+	 * all tables are updated by CPU and only bulk updates use SDMA.
 	 */
+	adev->vm_manager.vm_update_max_cpu_ptes = 0;
 #ifdef CONFIG_X86_64
 	if (amdgpu_vm_update_mode == -1) {
-		if (amdgpu_gmc_vram_full_visible(&adev->gmc))
+		if (adev->gmc.unified_memory &&
+		    amdgpu_gmc_vram_full_visible(&adev->gmc)) {
 			adev->vm_manager.vm_update_mode =
+				AMDGPU_VM_USE_CPU_FOR_GFX |
 				AMDGPU_VM_USE_CPU_FOR_COMPUTE;
-		else
+			adev->vm_manager.vm_update_max_cpu_ptes =
+				AMDGPU_VM_CPU_UPDATE_MAX_PTES;
+		} else if (amdgpu_gmc_vram_full_visible(&adev->gmc)) {
+			adev->vm_manager.vm_update_mode =
+				AMDGPU_VM_USE_CPU_FOR_COMPUTE;
+		} else {
 			adev->vm_manager.vm_update_mode = 0;
+		}
 	} else
 		adev->vm_manager.vm_update_mode = amdgpu_vm_update_mode;
 #else
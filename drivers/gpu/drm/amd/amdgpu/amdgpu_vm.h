@@ -49,6 +49,9 @@ struct amdgpu_bo_list_entry;
 /* number of entries in page table */
 #define AMDGPU_VM_PTE_COUNT(adev) (1 << (adev)->vm_manager.block_size)
 
+/* smallest contiguous GTT run mapped linearly on unified memory parts */
+#define AMDGPU_VM_UNIFIED_MIN_LINEAR_PAGES	16
+
 #define AMDGPU_PTE_VALID	(1ULL << 0)
 #define AMDGPU_PTE_SYSTEM	(1ULL << 1)
 #define AMDGPU_PTE_SNOOPED	(1ULL << 2)
@@ -118,6 +121,9 @@ struct amdgpu_bo_list_entry;
 #define AMDGPU_VM_USE_CPU_FOR_GFX (1 << 0)
 #define AMDGPU_VM_USE_CPU_FOR_COMPUTE (1 << 1)
 
+/* mappings with more PTEs than this go through SDMA on unified memory parts */
+#define AMDGPU_VM_CPU_UPDATE_MAX_PTES	4096
+
 /* VMPT level enumerate, and the hiberachy is:
  * PDB2->PDB1->PDB0->PTB
  */
@@ -214,6 +220,11 @@ struct amdgpu_vm_update_params {
 	 * @num_dw_left: number of dw left for the IB
 	 */
 	unsigned int num_dw_left;
+
+	/**
+	 * @funcs: backend used for the PTE writes of this update
+	 */
+	const struct amdgpu_vm_update_funcs *funcs;
 };
 
 struct amdgpu_vm_update_funcs {
@@ -267,6 +278,12 @@ struct amdgpu_vm {
 	/* Functions to use for VM table updates */
 	const struct amdgpu_vm_update_funcs	*update_funcs;
 
+	/* Last bulk SDMA update of a CPU updated VM */
+	struct dma_fence			*last_bulk_update;
+
+	/* Bumped by every CPU update, there is no fence to flush against */
+	atomic64_t				cpu_update_seq;
+
 	/* Flag to indicate ATS support from PTE for GFX9 */
 	bool			pte_support_ats;
 
@@ -322,6 +339,11 @@ struct amdgpu_vm_manager {
 	 */
 	int					vm_update_mode;
 
+	/* CPU updated VMs hand mappings above this many PTEs to SDMA,
+	 * 0 for no limit
+	 */
+	unsigned int				vm_update_max_cpu_ptes;
+
 	/* PASID to VM mapping, will be used in interrupt context to
 	 * look up VM of a page fault
 	 */
@@ -116,6 +116,8 @@ static int amdgpu_vm_cpu_commit(struct amdgpu_vm_update_params *p,
 	/* Flush HDP */
 	mb();
 	amdgpu_asic_flush_hdp(p->adev, NULL);
+	/* The next job of this VM has to flush the TLB */
+	atomic64_inc(&p->vm->cpu_update_seq);
 	return 0;
 }
 
@@ -342,10 +342,26 @@ static int amdgpu_vram_mgr_new(struct ttm_mem_type_manager *man,
 		if (pages == pages_per_node)
 			alignment = pages_per_node;
 
-		r = drm_mm_insert_node_in_range(mm, &nodes[i],
-						pages, alignment, 0,
-						place->fpfn, lpfn,
-						mode);
+		/*
+		 * On unified memory parts also align the tail to its own
+		 * size if possible, so it can be mapped with VM fragments.
+		 */
+		r = -ENOSPC;
+		if (adev->gmc.unified_memory && pages < pages_per_node) {
+			uint32_t frag_align = rounddown_pow_of_two(pages);
+
+			if (!alignment || (frag_align > alignment &&
+					   !(frag_align % alignment)))
+				r = drm_mm_insert_node_in_range(mm, &nodes[i],
+								pages, frag_align, 0,
+								place->fpfn, lpfn,
+								mode);
+		}
+		if (r)
+			r = drm_mm_insert_node_in_range(mm, &nodes[i],
+							pages, alignment, 0,
+							place->fpfn, lpfn,
+							mode);
 		if (unlikely(r))
 			goto error;
 
@@ -0,0 +1,375 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Block device on spare VRAM
+ *
+ * amdgpu.vramblk_size MiB of VRAM are exported as /dev/amdgpu_vram<N>, meant
+ * to be used as a high priority swap device ahead of slower storage. The
+ * backing BO is pinned for the lifetime of the device, so the I/O path never
+ * takes its reservation: an evictor holding it could otherwise reclaim into
+ * swap on this very device and wait on itself. The VRAM only goes back to
+ * the GPU when the device is torn down.
+ *
+ * Bios are copied on the buffer-move SDMA ring, see
+ * amdgpu_ttm_copy_vram_dma(), or through the CPU mapping when the ring is
+ * not up. I/O may be issued for reclaim, so everything below runs with
+ * memalloc_noio.
+ *
+ * Across suspend the BO is unpinned and evicted with the rest of VRAM, like
+ * the cursors are; the GFP mask is restricted to NOIO by then, and any bio
+ * that still comes in waits for resume to pin it back.
+ *
+ * A GPU reset that loses VRAM takes the contents of the device with it, so
+ * from then on all I/O fails rather than returning garbage.
+ */
+#include <linux/blkdev.h>
+#include <linux/highmem.h>
+#include <linux/sched/mm.h>
+
+#include "amdgpu.h"
+#include "amdgpu_vramblk.h"
+
+/* Bounded so that a bio's DMA mappings fit on the stack */
+#define AMDGPU_VRAMBLK_MAX_PAGES	32
+
+struct amdgpu_vramblk {
+	struct amdgpu_device	*adev;
+	struct amdgpu_bo	*bo;
+	struct request_queue	*queue;
+	struct gendisk		*disk;
+	int			major;
+	u32			vram_lost_counter;
+
+	/* Held for read by I/O, for write to unpin and pin across suspend */
+	struct rw_semaphore	lock;
+	wait_queue_head_t	resume_wq;
+	bool			suspended;
+	/* Repinning on resume failed, all I/O fails */
+	bool			broken;
+	u64			gpu_addr;
+	void			*cpu_addr;
+};
+
+static int amdgpu_vramblk_sdma_copy(struct amdgpu_vramblk *vb,
+				    struct bio *bio)
+{
+	struct amdgpu_device *adev = vb->adev;
+	bool write = op_is_write(bio_op(bio));
+	enum dma_data_direction dir = write ? DMA_TO_DEVICE : DMA_FROM_DEVICE;
+	dma_addr_t dma[AMDGPU_VRAMBLK_MAX_PAGES];
+	unsigned int len[AMDGPU_VRAMBLK_MAX_PAGES];
+	struct dma_fence *fence = NULL;
+	struct bio_vec bvec;
+	struct bvec_iter iter;
+	unsigned int i, n = 0;
+	u64 vram;
+	int r = 0;
+
+	vram = vb->gpu_addr + (bio->bi_iter.bi_sector << SECTOR_SHIFT);
+
+	bio_for_each_segment(bvec, bio, iter) {
+		struct dma_fence *next = NULL;
+
+		if (WARN_ON_ONCE(n == AMDGPU_VRAMBLK_MAX_PAGES)) {
+			r = -EIO;
+			break;
+		}
+
+		dma[n] = dma_map_page(adev->dev, bvec.bv_page, bvec.bv_offset,
+				      bvec.bv_len, dir);
+		if (dma_mapping_error(adev->dev, dma[n])) {
+			r = -EIO;
+			break;
+		}
+		len[n++] = bvec.bv_len;
+
+		r = amdgpu_ttm_copy_vram_dma(adev, vram, dma[n - 1],
+					     bvec.bv_len, write, &next);
+		/* Jobs on the ring complete in order, keep the last one */
+		if (next) {
+			dma_fence_put(fence);
+			fence = next;
+		}
+		if (r)
+			break;
+		vram += bvec.bv_len;
+	}
+
+	if (fence) {
+		long t = dma_fence_wait(fence, false);
+
+		if (!r && t < 0)
+			r = t;
+		if (!r && fence->error)
+			r = fence->error;
+		dma_fence_put(fence);
+	}
+
+	for (i = 0; i < n; i++)
+		dma_unmap_page(adev->dev, dma[i], len[i], dir);
+
+	return r;
+}
+
+static int amdgpu_vramblk_cpu_copy(struct amdgpu_vramblk *vb, struct bio *bio)
+{
+	bool write = op_is_write(bio_op(bio));
+	u64 pos = bio->bi_iter.bi_sector << SECTOR_SHIFT;
+	struct bio_vec bvec;
+	struct bvec_iter iter;
+	void *base = vb->cpu_addr;
+
+	bio_for_each_segment(bvec, bio, iter) {
+		void *mem = kmap_atomic(bvec.bv_page);
+
+		if (write) {
+			memcpy(base + pos, mem + bvec.bv_offset, bvec.bv_len);
+		} else {
+			memcpy(mem + bvec.bv_offset, base + pos, bvec.bv_len);
+			flush_dcache_page(bvec.bv_page);
+		}
+		kunmap_atomic(mem);
+		pos += bvec.bv_len;
+	}
+
+	return 0;
+}
+
+static blk_qc_t amdgpu_vramblk_make_request(struct request_queue *q,
+					    struct bio *bio)
+{
+	struct amdgpu_vramblk *vb = bio->bi_disk->private_data;
+	unsigned int noio_flags;
+	int r;
+
+	blk_queue_split(q, &bio);
+
+	if (bio_end_sector(bio) > get_capacity(bio->bi_disk))
+		goto io_error;
+
+	if (vb->vram_lost_counter != atomic_read(&vb->adev->vram_lost_counter))
+		goto io_error;
+
+	switch (bio_op(bio)) {
+	case REQ_OP_READ:
+	case REQ_OP_WRITE:
+		break;
+	default:
+		goto io_error;
+	}
+
+	/* An empty flush; there is no write cache to flush */
+	if (!bio->bi_iter.bi_size)
+		goto done;
+
+	noio_flags = memalloc_noio_save();
+	down_read(&vb->lock);
+	while (vb->suspended) {
+		up_read(&vb->lock);
+		/* Uninterruptible, a signal must not fail swap I/O */
+		wait_event(vb->resume_wq, !READ_ONCE(vb->suspended));
+		down_read(&vb->lock);
+	}
+	if (vb->broken)
+		r = -EIO;
+	else if (vb->adev->mman.buffer_funcs_enabled)
+		r = amdgpu_vramblk_sdma_copy(vb, bio);
+	else
+		r = amdgpu_vramblk_cpu_copy(vb, bio);
+	up_read(&vb->lock);
+	memalloc_noio_restore(noio_flags);
+	if (r)
+		goto io_error;
+
+done:
+	bio_endio(bio);
+	return BLK_QC_T_NONE;
+
+io_error:
+	bio_io_error(bio);
+	return BLK_QC_T_NONE;
+}
+
+static const struct block_device_operations amdgpu_vramblk_fops = {
+	.owner = THIS_MODULE,
+};
+
+static int amdgpu_vramblk_pin(struct amdgpu_vramblk *vb)
+{
+	struct amdgpu_bo *bo = vb->bo;
+	int r;
+
+	r = amdgpu_bo_reserve(bo, true);
+	if (r)
+		return r;
+
+	r = amdgpu_bo_pin(bo, AMDGPU_GEM_DOMAIN_VRAM);
+	if (r)
+		goto unreserve;
+
+	r = amdgpu_bo_kmap(bo, &vb->cpu_addr);
+	if (r) {
+		amdgpu_bo_unpin(bo);
+		goto unreserve;
+	}
+	vb->gpu_addr = amdgpu_bo_gpu_offset(bo);
+
+unreserve:
+	amdgpu_bo_unreserve(bo);
+	return r;
+}
+
+static void amdgpu_vramblk_unpin(struct amdgpu_vramblk *vb)
+{
+	struct amdgpu_bo *bo = vb->bo;
+
+	if (amdgpu_bo_reserve(bo, true))
+		return;
+
+	amdgpu_bo_kunmap(bo);
+	amdgpu_bo_unpin(bo);
+	amdgpu_bo_unreserve(bo);
+	vb->cpu_addr = NULL;
+}
+
+void amdgpu_vramblk_suspend(struct amdgpu_device *adev)
+{
+	struct amdgpu_vramblk *vb = adev->vramblk;
+
+	if (!vb)
+		return;
+
+	down_write(&vb->lock);
+	if (!vb->broken)
+		amdgpu_vramblk_unpin(vb);
+	vb->suspended = true;
+	up_write(&vb->lock);
+}
+
+void amdgpu_vramblk_resume(struct amdgpu_device *adev)
+{
+	struct amdgpu_vramblk *vb = adev->vramblk;
+
+	if (!vb)
+		return;
+
+	down_write(&vb->lock);
+	if (!vb->broken && amdgpu_vramblk_pin(vb)) {
+		dev_err(adev->dev, "vramblk: failed to pin back, I/O will fail\n");
+		vb->broken = true;
+	}
+	vb->suspended = false;
+	up_write(&vb->lock);
+	wake_up_all(&vb->resume_wq);
+}
+
+int amdgpu_vramblk_init(struct amdgpu_device *adev)
+{
+	u64 size = (u64)amdgpu_vramblk_size << 20;
+	struct amdgpu_vramblk *vb;
+	struct amdgpu_bo_param bp;
+	struct gendisk *disk;
+	int r;
+
+	if (!size)
+		return 0;
+
+	/* Leave the GPU at least half of its memory */
+	if (size > adev->gmc.real_vram_size / 2) {
+		dev_warn(adev->dev, "vramblk: %u MiB is more than half of VRAM\n",
+			 amdgpu_vramblk_size);
+		return -EINVAL;
+	}
+
+	vb = kzalloc(sizeof(*vb), GFP_KERNEL);
+	if (!vb)
+		return -ENOMEM;
+	vb->adev = adev;
+	vb->vram_lost_counter = atomic_read(&adev->vram_lost_counter);
+	init_rwsem(&vb->lock);
+	init_waitqueue_head(&vb->resume_wq);
+
+	memset(&bp, 0, sizeof(bp));
+	bp.size = size;
+	bp.byte_align = PAGE_SIZE;
+	bp.domain = AMDGPU_GEM_DOMAIN_VRAM;
+	bp.flags = AMDGPU_GEM_CREATE_CPU_ACCESS_REQUIRED |
+		AMDGPU_GEM_CREATE_VRAM_CONTIGUOUS |
+		AMDGPU_GEM_CREATE_VRAM_CLEARED;
+	bp.type = ttm_bo_type_kernel;
+	bp.resv = NULL;
+	r = amdgpu_bo_create(adev, &bp, &vb->bo);
+	if (r)
+		goto free_vb;
+
+	r = amdgpu_vramblk_pin(vb);
+	if (r)
+		goto unref_bo;
+
+	vb->major = register_blkdev(0, "amdgpu_vram");
+	if (vb->major < 0) {
+		r = vb->major;
+		goto unpin;
+	}
+
+	vb->queue = blk_alloc_queue(GFP_KERNEL);
+	if (!vb->queue) {
+		r = -ENOMEM;
+		goto unregister;
+	}
+	blk_queue_make_request(vb->queue, amdgpu_vramblk_make_request);
+	blk_queue_max_hw_sectors(vb->queue, (AMDGPU_VRAMBLK_MAX_PAGES - 1) *
+				 (PAGE_SIZE >> SECTOR_SHIFT));
+	blk_queue_physical_block_size(vb->queue, PAGE_SIZE);
+	blk_queue_flag_set(QUEUE_FLAG_NONROT, vb->queue);
+	blk_queue_flag_clear(QUEUE_FLAG_ADD_RANDOM, vb->queue);
+
+	disk = vb->disk = alloc_disk(1);
+	if (!disk) {
+		r = -ENOMEM;
+		goto cleanup_queue;
+	}
+	disk->major = vb->major;
+	disk->first_minor = 0;
+	disk->fops = &amdgpu_vramblk_fops;
+	disk->private_data = vb;
+	disk->queue = vb->queue;
+	snprintf(disk->disk_name, sizeof(disk->disk_name), "amdgpu_vram%d",
+		 adev->ddev->primary->index);
+	set_capacity(disk, size >> SECTOR_SHIFT);
+	add_disk(disk);
+
+	adev->vramblk = vb;
+	DRM_INFO("%u MiB of VRAM exported as /dev/%s\n",
+		 amdgpu_vramblk_size, disk->disk_name);
+	return 0;
+
+cleanup_queue:
+	blk_cleanup_queue(vb->queue);
+unregister:
+	unregister_blkdev(vb->major, "amdgpu_vram");
+unpin:
+	amdgpu_vramblk_unpin(vb);
+unref_bo:
+	amdgpu_bo_unref(&vb->bo);
+free_vb:
+	kfree(vb);
+	return r;
+}
+
+void amdgpu_vramblk_fini(struct amdgpu_device *adev)
+{
+	struct amdgpu_vramblk *vb = adev->vramblk;
+
+	if (!vb)
+		return;
+
+	del_gendisk(vb->disk);
+	blk_cleanup_queue(vb->queue);
+	put_disk(vb->disk);
+	unregister_blkdev(vb->major, "amdgpu_vram");
+	if (!vb->suspended && !vb->broken)
+		amdgpu_vramblk_unpin(vb);
+	amdgpu_bo_unref(&vb->bo);
+	kfree(vb);
+	adev->vramblk = NULL;
+}
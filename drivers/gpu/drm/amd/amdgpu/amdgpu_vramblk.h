@@ -0,0 +1,21 @@
+/* SPDX-License-Identifier: MIT */
+#ifndef _AMDGPU_VRAMBLK_H_
+#define _AMDGPU_VRAMBLK_H_
+
+#if IS_ENABLED(CONFIG_DRM_AMDGPU_VRAMBLK)
+int amdgpu_vramblk_init(struct amdgpu_device *adev);
+void amdgpu_vramblk_fini(struct amdgpu_device *adev);
+void amdgpu_vramblk_suspend(struct amdgpu_device *adev);
+void amdgpu_vramblk_resume(struct amdgpu_device *adev);
+#else
+static inline int amdgpu_vramblk_init(struct amdgpu_device *adev)
+{
+	return 0;
+}
+
+static inline void amdgpu_vramblk_fini(struct amdgpu_device *adev) {}
+static inline void amdgpu_vramblk_suspend(struct amdgpu_device *adev) {}
+static inline void amdgpu_vramblk_resume(struct amdgpu_device *adev) {}
+#endif
+
+#endif /* _AMDGPU_VRAMBLK_H_ */
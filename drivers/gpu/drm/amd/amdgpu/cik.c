@@ -948,6 +948,18 @@ static const u32 gladius_mgcg_cgcg_init[] =
 	0x0000313a, 0xffffffff, 0x00000001,
 };
 
+static const u32 liverpool_mgcg_cgcg_init[] =
+{
+	0x0000313a, 0xffffffff, 0x00000003,
+	0x00003079, 0xffffffff, 0x00020201,
+	0x00003108, 0xffffffff, 0xfffffffd,
+	0x0000c200, 0xffffffff, 0xe0000000,
+	0x0000311d, 0xffffffff, 0xffffffff,
+	0x0000311e, 0xffffffff, 0xffffffff,
+	0x0000311f, 0xffffffff, 0x004000ff,
+	0x0000313a, 0xffffffff, 0x00000001,
+};
+
 static void cik_init_golden_registers(struct amdgpu_device *adev)
 {
 	/* Some of the registers might be dependent on GRBM_GFX_INDEX */
@@ -1025,12 +1037,14 @@ static void cik_init_golden_registers(struct amdgpu_device *adev)
 							ARRAY_SIZE(hawaii_golden_spm_registers));
 		break;
 	case CHIP_LIVERPOOL:
-		/*amdgpu_device_program_register_sequence(adev,
-						 liverpool_mgcg_cgcg_init,
-						 ARRAY_SIZE(liverpool_mgcg_cgcg_init));*/
+		/* The golden list sets RLC_CGTT_MGCG_OVERRIDE, so the CG init
+		 * has to come after it or every block ends up ungated again. */
 		amdgpu_device_program_register_sequence(adev,
 						 liverpool_golden_registers,
 						 ARRAY_SIZE(liverpool_golden_registers));
+		amdgpu_device_program_register_sequence(adev,
+						 liverpool_mgcg_cgcg_init,
+						 ARRAY_SIZE(liverpool_mgcg_cgcg_init));
 		amdgpu_device_program_register_sequence(adev,
 						 liverpool_golden_common_registers,
 						 ARRAY_SIZE(liverpool_golden_common_registers));
@@ -1561,6 +1575,12 @@ static int cik_set_uvd_clocks(struct amdgpu_device *adev, u32 vclk, u32 dclk)
 {
 	int r = 0;
 
+	/* No SMU on the PS4, the southbridge firmware sets up VCLK/DCLK and
+	 * the VBIOS has no divider tables to change them. */
+	if (adev->asic_type == CHIP_LIVERPOOL ||
+	    adev->asic_type == CHIP_GLADIUS)
+		return 0;
+
 	r = cik_set_uvd_clock(adev, vclk, ixCG_VCLK_CNTL, ixCG_VCLK_STATUS);
 	if (r)
 		return r;
@@ -1575,6 +1595,11 @@ static int cik_set_vce_clocks(struct amdgpu_device *adev, u32 evclk, u32 ecclk)
 	struct atom_clock_dividers dividers;
 	u32 tmp;
 
+	/* Same as for UVD, ECLK is owned by the southbridge firmware */
+	if (adev->asic_type == CHIP_LIVERPOOL ||
+	    adev->asic_type == CHIP_GLADIUS)
+		return 0;
+
 	r = amdgpu_atombios_get_clock_dividers(adev,
 					       COMPUTE_GPUCLK_INPUT_FLAG_DEFAULT_GPUCLK,
 					       ecclk, false, &dividers);
@@ -1969,7 +1994,28 @@ static void cik_invalidate_hdp(struct amdgpu_device *adev,
 
 static bool cik_need_full_reset(struct amdgpu_device *adev)
 {
-	/* change this when we support soft reset */
+	int i;
+
+	/*
+	 * A full reset on the PS4 APUs also takes down the display bridge, so
+	 * try a soft reset of the hung GFX/SDMA engines first there. UVD and
+	 * VCE can't tell whether they are hung, so work outstanding on them
+	 * still needs a full reset.
+	 */
+	if (adev->asic_type == CHIP_LIVERPOOL ||
+	    adev->asic_type == CHIP_GLADIUS) {
+		for (i = 0; i < AMDGPU_MAX_RINGS; i++) {
+			struct amdgpu_ring *ring = adev->rings[i];
+
+			if (ring && ring->sched.ready &&
+			    amdgpu_fence_count_emitted(ring) &&
+			    !amdgpu_device_ring_can_soft_reset(ring))
+				return true;
+		}
+		return false;
+	}
+
+	/* change this when we support soft reset on the other parts */
 	return true;
 }
 
@@ -2216,9 +2262,13 @@ static int cik_common_early_init(void *handle)
 				AMD_CG_SUPPORT_UVD_MGCG |
 				AMD_CG_SUPPORT_HDP_LS |
 				AMD_CG_SUPPORT_HDP_MGCG;
+			/* CGCG is not validated on PS4 yet, opt in only */
+			if (amdgpu_ps4_cgcg)
+				adev->cg_flags |= AMD_CG_SUPPORT_GFX_CGCG;
 			adev->pg_flags =
-				/*AMD_PG_SUPPORT_GFX_PG |
-				  AMD_PG_SUPPORT_GFX_SMG | */
+				/*AMD_PG_SUPPORT_GFX_PG | */
+				AMD_PG_SUPPORT_GFX_SMG |
+				AMD_PG_SUPPORT_GFX_DMG |
 				/*AMD_PG_SUPPORT_UVD | */
 				/*AMD_PG_SUPPORT_VCE |
 				  AMD_PG_SUPPORT_CP |
@@ -2233,7 +2283,7 @@ static int cik_common_early_init(void *handle)
 			adev->cg_flags =
 				AMD_CG_SUPPORT_GFX_MGCG |
 				AMD_CG_SUPPORT_GFX_MGLS |
-				AMD_CG_SUPPORT_GFX_CGCG |
+				/*AMD_CG_SUPPORT_GFX_CGCG |*/
 				AMD_CG_SUPPORT_GFX_CGLS |
 				AMD_CG_SUPPORT_GFX_CGTS |
 				AMD_CG_SUPPORT_GFX_CGTS_LS |
@@ -2245,9 +2295,13 @@ static int cik_common_early_init(void *handle)
 				AMD_CG_SUPPORT_UVD_MGCG |
 				AMD_CG_SUPPORT_HDP_LS |
 				AMD_CG_SUPPORT_HDP_MGCG;
+			/* CGCG is not validated on PS4 yet, opt in only */
+			if (amdgpu_ps4_cgcg)
+				adev->cg_flags |= AMD_CG_SUPPORT_GFX_CGCG;
 			adev->pg_flags =
-				/*AMD_PG_SUPPORT_GFX_PG |
-					AMD_PG_SUPPORT_GFX_SMG | */
+				/*AMD_PG_SUPPORT_GFX_PG | */
+				AMD_PG_SUPPORT_GFX_SMG |
+				AMD_PG_SUPPORT_GFX_DMG |
 				/*AMD_PG_SUPPORT_UVD | */
 				/*AMD_PG_SUPPORT_VCE |
 					AMD_PG_SUPPORT_CP |
@@ -2362,6 +2416,23 @@ static const struct amdgpu_ip_block_version cik_common_ip_block =
 	.funcs = &cik_common_ip_funcs,
 };
 
+/*
+ * Not every PS4 firmware set carries the multimedia engine images, and a
+ * block whose sw_init fails takes down the whole device, so those blocks
+ * are only added when their firmware is there.
+ */
+static bool cik_ps4_fw_present(struct amdgpu_device *adev, const char *name)
+{
+	const struct firmware *fw;
+
+	if (firmware_request_nowarn(&fw, name, adev->dev)) {
+		dev_info(adev->dev, "%s not found, block disabled\n", name);
+		return false;
+	}
+	release_firmware(fw);
+	return true;
+}
+
 int cik_set_ip_blocks(struct amdgpu_device *adev)
 {
 	cik_detect_hw_virtualization(adev);
@@ -2445,37 +2516,49 @@ int cik_set_ip_blocks(struct amdgpu_device *adev)
 		amdgpu_device_ip_block_add(adev, &cik_common_ip_block);
 		amdgpu_device_ip_block_add(adev, &gmc_v7_0_ip_block);
 		amdgpu_device_ip_block_add(adev, &cik_ih_ip_block);
-		//amdgpu_device_ip_block_add(adev, &pp_smu_ip_block);
+		/* The SMU tables are not validated on every board yet */
+		if (amdgpu_dpm == 1)
+			amdgpu_device_ip_block_add(adev, &kv_smu_ip_block);
 		if (adev->enable_virtual_display)
 			amdgpu_device_ip_block_add(adev, &dce_virtual_ip_block);
 #if defined(CONFIG_DRM_AMD_DC)
 		else if (amdgpu_device_has_dc_support(adev))
 			amdgpu_device_ip_block_add(adev, &dm_ip_block);
 #endif
-		else
+		else {
 			amdgpu_device_ip_block_add(adev, &dce_v8_1_ip_block);
+			adev->display_deferred = amdgpu_deferred_display == 1;
+		}
 		amdgpu_device_ip_block_add(adev, &gfx_v7_1_ip_block);
 		amdgpu_device_ip_block_add(adev, &cik_sdma_ip_block);
-		/*amdgpu_device_ip_block_add(adev, &uvd_v4_2_ip_block)*/;
-		/*amdgpu_device_ip_block_add(adev, &vce_v2_0_ip_block)*/;
+		if (cik_ps4_fw_present(adev, "amdgpu/liverpool_uvd.bin"))
+			amdgpu_device_ip_block_add(adev, &uvd_v4_2_ip_block);
+		if (cik_ps4_fw_present(adev, "amdgpu/liverpool_vce.bin"))
+			amdgpu_device_ip_block_add(adev, &vce_v2_0_ip_block);
 		break;
 	case CHIP_GLADIUS:
 		amdgpu_device_ip_block_add(adev, &cik_common_ip_block);
 		amdgpu_device_ip_block_add(adev, &gmc_v7_0_ip_block);
 		amdgpu_device_ip_block_add(adev, &cik_ih_ip_block);
-		//amdgpu_device_ip_block_add(adev, &pp_smu_ip_block);
+		/* The SMU tables are not validated on every board yet */
+		if (amdgpu_dpm == 1)
+			amdgpu_device_ip_block_add(adev, &kv_smu_ip_block);
 		if (adev->enable_virtual_display)
 			amdgpu_device_ip_block_add(adev, &dce_virtual_ip_block);
 #if defined(CONFIG_DRM_AMD_DC)
 		else if (amdgpu_device_has_dc_support(adev))
 			amdgpu_device_ip_block_add(adev, &dm_ip_block);
 #endif
-		else
+		else {
 			amdgpu_device_ip_block_add(adev, &dce_v8_1_ip_block);
+			adev->display_deferred = amdgpu_deferred_display == 1;
+		}
 		amdgpu_device_ip_block_add(adev, &gfx_v7_1_ip_block);
 		amdgpu_device_ip_block_add(adev, &cik_sdma_ip_block);
-		/*amdgpu_device_ip_block_add(adev, &uvd_v4_2_ip_block)*/;
-		/*amdgpu_device_ip_block_add(adev, &vce_v2_0_ip_block)*/;
+		if (cik_ps4_fw_present(adev, "amdgpu/gladius_uvd.bin"))
+			amdgpu_device_ip_block_add(adev, &uvd_v4_2_ip_block);
+		if (cik_ps4_fw_present(adev, "amdgpu/gladius_vce.bin"))
+			amdgpu_device_ip_block_add(adev, &vce_v2_0_ip_block);
 		break;
 	default:
 		/* FIXME: not supported yet */
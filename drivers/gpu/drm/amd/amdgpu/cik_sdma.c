@@ -54,7 +54,8 @@ static void cik_sdma_set_ring_funcs(struct amdgpu_device *adev);
 static void cik_sdma_set_irq_funcs(struct amdgpu_device *adev);
 static void cik_sdma_set_buffer_funcs(struct amdgpu_device *adev);
 static void cik_sdma_set_vm_pte_funcs(struct amdgpu_device *adev);
-static int cik_sdma_soft_reset(void *handle);
+static void cik_sdma_reset_engines(struct amdgpu_device *adev,
+				   u32 srbm_soft_reset);
 
 MODULE_FIRMWARE("amdgpu/bonaire_sdma.bin");
 MODULE_FIRMWARE("amdgpu/bonaire_sdma1.bin");
@@ -640,13 +641,7 @@ static int cik_sdma_ring_test_ring(struct amdgpu_ring *ring)
 	if (r)
 		goto error_free_wb;
 
-	amdgpu_ring_write(ring, SDMA_PACKET(SDMA_OPCODE_WRITE, SDMA_WRITE_SUB_OPCODE_LINEAR, 0));
-	amdgpu_ring_write(ring, lower_32_bits(gpu_addr));
-	amdgpu_ring_write(ring, upper_32_bits(gpu_addr));
-	amdgpu_ring_write(ring, 1); /* number of DWs to follow */
-	amdgpu_ring_write(ring, 0xDEADBEEF);
-	/* The SDMA_OPCODE_WRITE opcode is broken in the ring on Liverpool */
-	if (adev->asic_type == CHIP_LIVERPOOL) {
+	if (adev->sdma.write_linear_broken) {
 		amdgpu_ring_write(ring, SDMA_PACKET(SDMA_OPCODE_CONSTANT_FILL, 0, SDMA_CONSTANT_FILL_EXTRA_SIZE(2)));
 		amdgpu_ring_write(ring, lower_32_bits(gpu_addr));
 		amdgpu_ring_write(ring, upper_32_bits(gpu_addr));
@@ -706,12 +701,21 @@ static int cik_sdma_ring_test_ib(struct amdgpu_ring *ring, long timeout)
 	if (r)
 		goto err0;
 
-	ib.ptr[0] = SDMA_PACKET(SDMA_OPCODE_WRITE,
-				SDMA_WRITE_SUB_OPCODE_LINEAR, 0);
-	ib.ptr[1] = lower_32_bits(gpu_addr);
-	ib.ptr[2] = upper_32_bits(gpu_addr);
-	ib.ptr[3] = 1;
-	ib.ptr[4] = 0xDEADBEEF;
+	if (adev->sdma.write_linear_broken) {
+		ib.ptr[0] = SDMA_PACKET(SDMA_OPCODE_CONSTANT_FILL, 0,
+					SDMA_CONSTANT_FILL_EXTRA_SIZE(2));
+		ib.ptr[1] = lower_32_bits(gpu_addr);
+		ib.ptr[2] = upper_32_bits(gpu_addr);
+		ib.ptr[3] = 0xDEADBEEF;
+		ib.ptr[4] = 4; /* number of bytes */
+	} else {
+		ib.ptr[0] = SDMA_PACKET(SDMA_OPCODE_WRITE,
+					SDMA_WRITE_SUB_OPCODE_LINEAR, 0);
+		ib.ptr[1] = lower_32_bits(gpu_addr);
+		ib.ptr[2] = upper_32_bits(gpu_addr);
+		ib.ptr[3] = 1;
+		ib.ptr[4] = 0xDEADBEEF;
+	}
 	ib.length_dw = 5;
 	r = amdgpu_ib_schedule(ring, 1, &ib, NULL, &f);
 	if (r)
@@ -821,6 +825,25 @@ static void cik_sdma_vm_set_pte_pde(struct amdgpu_ib *ib, uint64_t pe,
 	ib->ptr[ib->length_dw++] = count; /* number of entries */
 }
 
+/**
+ * cik_sdma_vm_write_pte_no_linear - update PTEs without SDMA_OPCODE_WRITE
+ *
+ * @ib: indirect buffer to fill with commands
+ * @pe: addr of the page entry
+ * @value: dst addr to write into pe
+ * @count: number of page entries to update
+ * @incr: increase next addr by incr bytes
+ *
+ * Same result as cik_sdma_vm_write_pte(), generated with a PTE_PDE
+ * packet and an empty flags mask, for parts where WRITE is broken.
+ */
+static void cik_sdma_vm_write_pte_no_linear(struct amdgpu_ib *ib, uint64_t pe,
+					    uint64_t value, unsigned count,
+					    uint32_t incr)
+{
+	cik_sdma_vm_set_pte_pde(ib, pe, value, count, incr, 0);
+}
+
 /**
  * cik_sdma_vm_pad_ib - pad the IB to the required number of dw
  *
@@ -955,6 +978,7 @@ static int cik_sdma_early_init(void *handle)
 	struct amdgpu_device *adev = (struct amdgpu_device *)handle;
 
 	adev->sdma.num_instances = SDMA_MAX_INSTANCE;
+	adev->sdma.write_linear_broken = adev->asic_type == CHIP_LIVERPOOL;
 
 	cik_sdma_set_ring_funcs(adev);
 	cik_sdma_set_irq_funcs(adev);
@@ -1055,7 +1079,8 @@ static int cik_sdma_resume(void *handle)
 {
 	struct amdgpu_device *adev = (struct amdgpu_device *)handle;
 
-	cik_sdma_soft_reset(handle);
+	cik_sdma_reset_engines(adev, SRBM_SOFT_RESET__SOFT_RESET_SDMA_MASK |
+			       SRBM_SOFT_RESET__SOFT_RESET_SDMA1_MASK);
 
 	return cik_sdma_hw_init(adev);
 }
@@ -1089,23 +1114,24 @@ static int cik_sdma_wait_for_idle(void *handle)
 	return -ETIMEDOUT;
 }
 
-static int cik_sdma_soft_reset(void *handle)
+static void cik_sdma_reset_engines(struct amdgpu_device *adev,
+				   u32 srbm_soft_reset)
 {
-	u32 srbm_soft_reset = 0;
-	struct amdgpu_device *adev = (struct amdgpu_device *)handle;
 	u32 tmp;
 
 	/* sdma0 */
-	tmp = RREG32(mmSDMA0_F32_CNTL + SDMA0_REGISTER_OFFSET);
-	tmp |= SDMA0_F32_CNTL__HALT_MASK;
-	WREG32(mmSDMA0_F32_CNTL + SDMA0_REGISTER_OFFSET, tmp);
-	srbm_soft_reset |= SRBM_SOFT_RESET__SOFT_RESET_SDMA_MASK;
+	if (srbm_soft_reset & SRBM_SOFT_RESET__SOFT_RESET_SDMA_MASK) {
+		tmp = RREG32(mmSDMA0_F32_CNTL + SDMA0_REGISTER_OFFSET);
+		tmp |= SDMA0_F32_CNTL__HALT_MASK;
+		WREG32(mmSDMA0_F32_CNTL + SDMA0_REGISTER_OFFSET, tmp);
+	}
 
 	/* sdma1 */
-	tmp = RREG32(mmSDMA0_F32_CNTL + SDMA1_REGISTER_OFFSET);
-	tmp |= SDMA0_F32_CNTL__HALT_MASK;
-	WREG32(mmSDMA0_F32_CNTL + SDMA1_REGISTER_OFFSET, tmp);
-	srbm_soft_reset |= SRBM_SOFT_RESET__SOFT_RESET_SDMA1_MASK;
+	if (srbm_soft_reset & SRBM_SOFT_RESET__SOFT_RESET_SDMA1_MASK) {
+		tmp = RREG32(mmSDMA0_F32_CNTL + SDMA1_REGISTER_OFFSET);
+		tmp |= SDMA0_F32_CNTL__HALT_MASK;
+		WREG32(mmSDMA0_F32_CNTL + SDMA1_REGISTER_OFFSET, tmp);
+	}
 
 	if (srbm_soft_reset) {
 		tmp = RREG32(mmSRBM_SOFT_RESET);
@@ -1123,10 +1149,74 @@ static int cik_sdma_soft_reset(void *handle)
 		/* Wait a little for things to settle down */
 		udelay(50);
 	}
+}
+
+/*
+ * Only an engine that is busy with work outstanding on its ring is reset,
+ * the other one keeps its state and just has its ring restarted. The check
+ * after a soft reset runs once all fences were force completed, so there an
+ * engine that was reset and is still busy counts as hung on its own.
+ */
+static bool cik_sdma_check_soft_reset(void *handle)
+{
+	struct amdgpu_device *adev = (struct amdgpu_device *)handle;
+	static const u32 busy[] = {
+		SRBM_STATUS2__SDMA_BUSY_MASK, SRBM_STATUS2__SDMA1_BUSY_MASK
+	};
+	static const u32 reset[] = {
+		SRBM_SOFT_RESET__SOFT_RESET_SDMA_MASK,
+		SRBM_SOFT_RESET__SOFT_RESET_SDMA1_MASK
+	};
+	u32 srbm_soft_reset = 0;
+	u32 tmp = RREG32(mmSRBM_STATUS2);
+	int i;
+
+	for (i = 0; i < adev->sdma.num_instances; i++) {
+		struct amdgpu_ring *ring = &adev->sdma.instance[i].ring;
+
+		if ((tmp & busy[i]) &&
+		    (amdgpu_fence_count_emitted(ring) ||
+		     (adev->sdma.srbm_soft_reset & reset[i])))
+			srbm_soft_reset |= reset[i];
+	}
+
+	adev->sdma.srbm_soft_reset = srbm_soft_reset;
+
+	return srbm_soft_reset;
+}
+
+static int cik_sdma_pre_soft_reset(void *handle)
+{
+	struct amdgpu_device *adev = (struct amdgpu_device *)handle;
+
+	if (!adev->sdma.srbm_soft_reset)
+		return 0;
+
+	/* cik_sdma_gfx_resume() restarts both rings */
+	cik_sdma_enable(adev, false);
 
 	return 0;
 }
 
+static int cik_sdma_soft_reset(void *handle)
+{
+	struct amdgpu_device *adev = (struct amdgpu_device *)handle;
+
+	cik_sdma_reset_engines(adev, adev->sdma.srbm_soft_reset);
+
+	return 0;
+}
+
+static int cik_sdma_post_soft_reset(void *handle)
+{
+	struct amdgpu_device *adev = (struct amdgpu_device *)handle;
+
+	if (!adev->sdma.srbm_soft_reset)
+		return 0;
+
+	return cik_sdma_gfx_resume(adev);
+}
+
 static int cik_sdma_set_trap_irq_state(struct amdgpu_device *adev,
 				       struct amdgpu_irq_src *src,
 				       unsigned type,
@@ -1259,7 +1349,10 @@ static const struct amd_ip_funcs cik_sdma_ip_funcs = {
 	.resume = cik_sdma_resume,
 	.is_idle = cik_sdma_is_idle,
 	.wait_for_idle = cik_sdma_wait_for_idle,
+	.check_soft_reset = cik_sdma_check_soft_reset,
+	.pre_soft_reset = cik_sdma_pre_soft_reset,
 	.soft_reset = cik_sdma_soft_reset,
+	.post_soft_reset = cik_sdma_post_soft_reset,
 	.set_clockgating_state = cik_sdma_set_clockgating_state,
 	.set_powergating_state = cik_sdma_set_powergating_state,
 };
@@ -1389,12 +1482,23 @@ static const struct amdgpu_vm_pte_funcs cik_sdma_vm_pte_funcs = {
 	.set_pte_pde = cik_sdma_vm_set_pte_pde,
 };
 
+static const struct amdgpu_vm_pte_funcs cik_sdma_vm_pte_funcs_no_linear = {
+	.copy_pte_num_dw = 7,
+	.copy_pte = cik_sdma_vm_copy_pte,
+
+	.write_pte = cik_sdma_vm_write_pte_no_linear,
+	.set_pte_pde = cik_sdma_vm_set_pte_pde,
+};
+
 static void cik_sdma_set_vm_pte_funcs(struct amdgpu_device *adev)
 {
 	struct drm_gpu_scheduler *sched;
 	unsigned i;
 
-	adev->vm_manager.vm_pte_funcs = &cik_sdma_vm_pte_funcs;
+	if (adev->sdma.write_linear_broken)
+		adev->vm_manager.vm_pte_funcs = &cik_sdma_vm_pte_funcs_no_linear;
+	else
+		adev->vm_manager.vm_pte_funcs = &cik_sdma_vm_pte_funcs;
 	for (i = 0; i < adev->sdma.num_instances; i++) {
 		sched = &adev->sdma.instance[i].ring.sched;
 		adev->vm_manager.vm_pte_rqs[i] =
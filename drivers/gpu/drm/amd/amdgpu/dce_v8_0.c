@@ -1502,6 +1502,47 @@ static void dce_v8_0_audio_set_dto(struct drm_encoder *encoder, u32 clock)
 	WREG32(mmDCCG_AUDIO_DTO0_MODULE, dto_modulo);
 }
 
+static unsigned int dce_v8_0_audio_decode_dfs_div(unsigned int div)
+{
+	if (div >= 8 && div < 64)
+		return (div - 8) * 25 + 200;
+	else if (div >= 64 && div < 96)
+		return (div - 64) * 50 + 1600;
+	else if (div >= 96 && div < 128)
+		return (div - 96) * 100 + 3200;
+	else
+		return 0;
+}
+
+static void dce_v8_0_dp_audio_set_dto(struct drm_encoder *encoder)
+{
+	struct drm_device *dev = encoder->dev;
+	struct amdgpu_device *adev = dev->dev_private;
+	struct amdgpu_encoder *amdgpu_encoder = to_amdgpu_encoder(encoder);
+	struct amdgpu_encoder_atom_dig *dig = amdgpu_encoder->enc_priv;
+	struct amdgpu_crtc *amdgpu_crtc = to_amdgpu_crtc(encoder->crtc);
+	u32 clock = adev->clock.vco_freq * 10;
+	u32 div;
+
+	if (!dig || !dig->afmt)
+		return;
+
+	/* Two dtos; generally use dto1 for DP, clocked from DPREFCLK */
+	WREG32(mmDCCG_AUDIO_DTO_SOURCE,
+	       DCCG_AUDIO_DTO_SOURCE__DCCG_AUDIO_DTO_SEL_MASK |
+	       (amdgpu_crtc->crtc_id << DCCG_AUDIO_DTO_SOURCE__DCCG_AUDIO_DTO0_SOURCE_SEL__SHIFT));
+
+	div = (RREG32(mmDENTIST_DISPCLK_CNTL) &
+	       DENTIST_DISPCLK_CNTL__DENTIST_DPREFCLK_WDIVIDER_MASK) >>
+		DENTIST_DISPCLK_CNTL__DENTIST_DPREFCLK_WDIVIDER__SHIFT;
+	div = dce_v8_0_audio_decode_dfs_div(div);
+	if (div)
+		clock = clock * 100 / div;
+
+	WREG32(mmDCCG_AUDIO_DTO1_PHASE, 24 * 1000);
+	WREG32(mmDCCG_AUDIO_DTO1_MODULE, clock);
+}
+
 /*
  * update the info frames with the data from the current display mode
  */
@@ -1668,6 +1709,83 @@ static void dce_v8_0_afmt_setmode(struct drm_encoder *encoder,
 	dce_v8_0_audio_enable(adev, dig->afmt->pin, true);
 }
 
+/*
+ * The PS4 HDMI bridges sit behind a DP link and turn the DP secondary data
+ * stream back into HDMI audio, so the audio endpoint is fed over DP here.
+ */
+static void dce_v8_0_dp_afmt_setmode(struct drm_encoder *encoder,
+				     struct drm_display_mode *mode)
+{
+	struct drm_device *dev = encoder->dev;
+	struct amdgpu_device *adev = dev->dev_private;
+	struct amdgpu_encoder *amdgpu_encoder = to_amdgpu_encoder(encoder);
+	struct amdgpu_encoder_atom_dig *dig = amdgpu_encoder->enc_priv;
+	struct drm_connector *connector = amdgpu_get_connector_for_encoder(encoder);
+	uint32_t offset;
+
+	if (!dig || !dig->afmt || !connector)
+		return;
+
+	if (!dig->afmt->enabled)
+		return;
+
+	offset = dig->afmt->offset;
+
+	/* disable audio prior to setting up hw */
+	dig->afmt->pin = dce_v8_0_audio_get_pin(adev);
+	dce_v8_0_audio_enable(adev, dig->afmt->pin, false);
+	WREG32(mmDP_SEC_CNTL + offset, 0);
+
+	if (!drm_detect_monitor_audio(amdgpu_connector_edid(connector)))
+		return;
+
+	dce_v8_0_audio_write_speaker_allocation(encoder);
+	dce_v8_0_audio_write_sad_regs(encoder);
+	dce_v8_0_audio_write_latency_fields(encoder, mode);
+	dce_v8_0_dp_audio_set_dto(encoder);
+
+	WREG32(mmAFMT_INFOFRAME_CONTROL0 + offset,
+	       AFMT_INFOFRAME_CONTROL0__AFMT_AUDIO_INFO_UPDATE_MASK); /* required for audio info values to be updated */
+
+	WREG32(mmAFMT_60958_0 + offset,
+	       (1 << AFMT_60958_0__AFMT_60958_CS_CHANNEL_NUMBER_L__SHIFT));
+
+	WREG32(mmAFMT_60958_1 + offset,
+	       (2 << AFMT_60958_1__AFMT_60958_CS_CHANNEL_NUMBER_R__SHIFT));
+
+	WREG32(mmAFMT_60958_2 + offset,
+	       (3 << AFMT_60958_2__AFMT_60958_CS_CHANNEL_NUMBER_2__SHIFT) |
+	       (4 << AFMT_60958_2__AFMT_60958_CS_CHANNEL_NUMBER_3__SHIFT) |
+	       (5 << AFMT_60958_2__AFMT_60958_CS_CHANNEL_NUMBER_4__SHIFT) |
+	       (6 << AFMT_60958_2__AFMT_60958_CS_CHANNEL_NUMBER_5__SHIFT) |
+	       (7 << AFMT_60958_2__AFMT_60958_CS_CHANNEL_NUMBER_6__SHIFT) |
+	       (8 << AFMT_60958_2__AFMT_60958_CS_CHANNEL_NUMBER_7__SHIFT));
+
+	WREG32(mmAFMT_AUDIO_PACKET_CONTROL2 + offset,
+	       (0xff << AFMT_AUDIO_PACKET_CONTROL2__AFMT_AUDIO_CHANNEL_ENABLE__SHIFT));
+
+	WREG32_OR(mmAFMT_AUDIO_PACKET_CONTROL + offset,
+		  AFMT_AUDIO_PACKET_CONTROL__AFMT_RESET_FIFO_WHEN_AUDIO_DIS_MASK | /* flush stale samples on a restart */
+		  AFMT_AUDIO_PACKET_CONTROL__AFMT_60958_CS_UPDATE_MASK); /* allow 60958 channel status fields to be updated */
+
+	dce_v8_0_afmt_audio_select_pin(encoder);
+
+	WREG32_OR(mmAFMT_AUDIO_PACKET_CONTROL + offset,
+		  AFMT_AUDIO_PACKET_CONTROL__AFMT_AUDIO_SAMPLE_SEND_MASK); /* send audio packets */
+
+	WREG32(mmDP_SEC_TIMESTAMP + offset,
+	       (1 << DP_SEC_TIMESTAMP__DP_SEC_TIMESTAMP_MODE__SHIFT));
+
+	WREG32(mmDP_SEC_CNTL + offset,
+	       DP_SEC_CNTL__DP_SEC_ASP_ENABLE_MASK | /* audio packet transmission */
+	       DP_SEC_CNTL__DP_SEC_ATP_ENABLE_MASK | /* audio timestamp packet transmission */
+	       DP_SEC_CNTL__DP_SEC_AIP_ENABLE_MASK | /* audio infoframe packet transmission */
+	       DP_SEC_CNTL__DP_SEC_STREAM_ENABLE_MASK); /* master enable for secondary stream engine */
+
+	/* enable audio after setting up hw */
+	dce_v8_0_audio_enable(adev, dig->afmt->pin, true);
+}
+
 static void dce_v8_0_afmt_enable(struct drm_encoder *encoder, bool enable)
 {
 	struct drm_device *dev = encoder->dev;
@@ -1689,6 +1807,12 @@ static void dce_v8_0_afmt_enable(struct drm_encoder *encoder, bool enable)
 		dig->afmt->pin = NULL;
 	}
 
+	if (!enable && ENCODER_MODE_IS_DP(amdgpu_atombios_encoder_get_encoder_mode(encoder))) {
+		WREG32(mmDP_SEC_CNTL + dig->afmt->offset, 0);
+		WREG32_AND(mmAFMT_AUDIO_PACKET_CONTROL + dig->afmt->offset,
+			   ~AFMT_AUDIO_PACKET_CONTROL__AFMT_AUDIO_SAMPLE_SEND_MASK);
+	}
+
 	dig->afmt->enabled = enable;
 
 	DRM_DEBUG("%sabling AFMT interface @ 0x%04X for encoder 0x%x\n",
@@ -3211,6 +3335,16 @@ static const struct amd_ip_funcs dce_v8_0_ip_funcs = {
 	.set_powergating_state = dce_v8_0_set_powergating_state,
 };
 
+/* The PS4 HDMI port is a DP encoder feeding an external HDMI bridge */
+static bool dce_v8_0_encoder_is_ps4_bridge(struct drm_encoder *encoder)
+{
+	struct amdgpu_device *adev = encoder->dev->dev_private;
+
+	if (adev->asic_type != CHIP_LIVERPOOL && adev->asic_type != CHIP_GLADIUS)
+		return false;
+	return amdgpu_atombios_encoder_get_encoder_mode(encoder) == ATOM_ENCODER_MODE_DP;
+}
+
 static void
 dce_v8_0_encoder_mode_set(struct drm_encoder *encoder,
 			  struct drm_display_mode *mode,
@@ -3229,6 +3363,9 @@ dce_v8_0_encoder_mode_set(struct drm_encoder *encoder,
 	if (amdgpu_atombios_encoder_get_encoder_mode(encoder) == ATOM_ENCODER_MODE_HDMI) {
 		dce_v8_0_afmt_enable(encoder, true);
 		dce_v8_0_afmt_setmode(encoder, adjusted_mode);
+	} else if (dce_v8_0_encoder_is_ps4_bridge(encoder)) {
+		dce_v8_0_afmt_enable(encoder, true);
+		dce_v8_0_dp_afmt_setmode(encoder, adjusted_mode);
 	}
 }
 
@@ -3289,7 +3426,8 @@ static void dce_v8_0_encoder_disable(struct drm_encoder *encoder)
 	amdgpu_atombios_encoder_dpms(encoder, DRM_MODE_DPMS_OFF);
 
 	if (amdgpu_atombios_encoder_is_digital(encoder)) {
-		if (amdgpu_atombios_encoder_get_encoder_mode(encoder) == ATOM_ENCODER_MODE_HDMI)
+		if (amdgpu_atombios_encoder_get_encoder_mode(encoder) == ATOM_ENCODER_MODE_HDMI ||
+		    dce_v8_0_encoder_is_ps4_bridge(encoder))
 			dce_v8_0_afmt_enable(encoder, false);
 		dig = amdgpu_encoder->enc_priv;
 		dig->dig_encoder = -1;
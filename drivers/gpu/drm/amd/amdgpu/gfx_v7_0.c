@@ -27,6 +27,7 @@
 #include "amdgpu.h"
 #include "amdgpu_ih.h"
 #include "amdgpu_gfx.h"
+#include "gfx_v7_0.h"
 #include "cikd.h"
 #include "cik.h"
 #include "cik_structs.h"
@@ -3633,6 +3634,13 @@ static void gfx_v7_0_mqd_init(struct amdgpu_device *adev,
 	mqd->cp_hqd_atomic1_preop_hi = RREG32(mmCP_HQD_ATOMIC1_PREOP_HI);
 	mqd->cp_hqd_pq_rptr = RREG32(mmCP_HQD_PQ_RPTR);
 	mqd->cp_hqd_quantum = RREG32(mmCP_HQD_QUANTUM);
+	/* time slice queues sharing a pipe so async compute can't starve */
+	if (adev->asic_type == CHIP_LIVERPOOL ||
+	    adev->asic_type == CHIP_GLADIUS)
+		mqd->cp_hqd_quantum =
+			1 << CP_HQD_QUANTUM__QUANTUM_EN__SHIFT |
+			1 << CP_HQD_QUANTUM__QUANTUM_SCALE__SHIFT |
+			10 << CP_HQD_QUANTUM__QUANTUM_DURATION__SHIFT;
 	mqd->cp_hqd_pipe_priority = RREG32(mmCP_HQD_PIPE_PRIORITY);
 	mqd->cp_hqd_queue_priority = RREG32(mmCP_HQD_QUEUE_PRIORITY);
 	mqd->cp_hqd_iq_rptr = RREG32(mmCP_HQD_IQ_RPTR);
@@ -4813,12 +4821,375 @@ static void gfx_v7_0_select_me_pipe_q(struct amdgpu_device *adev,
 	cik_srbm_select(adev, me, pipe, q, vm);
 }
 
+/* gfx perf counters, exported through amdgpu_pmu */
+AMDGPU_PMU_ATTR(gfx_event,	"config:0-9");
+AMDGPU_PMU_ATTR(gfx_block,	"config:16-19");
+
+static struct attribute *gfx_v7_0_format_attrs[] = {
+	&pmu_attr_gfx_event.attr,
+	&pmu_attr_gfx_block.attr,
+	NULL
+};
+
+static struct attribute_group gfx_v7_0_format_attr_group = {
+	.name = "format",
+	.attrs = gfx_v7_0_format_attrs,
+};
+
+AMDGPU_PMU_ATTR(grbm_count,		"gfx_event=0x0,gfx_block=0x0");
+AMDGPU_PMU_ATTR(grbm_gui_active,	"gfx_event=0x2,gfx_block=0x0");
+AMDGPU_PMU_ATTR(grbm_ta_busy,		"gfx_event=0xd,gfx_block=0x0");
+AMDGPU_PMU_ATTR(sq_busy_cycles,		"gfx_event=0x3,gfx_block=0x1");
+AMDGPU_PMU_ATTR(sq_waves,		"gfx_event=0x4,gfx_block=0x1");
+AMDGPU_PMU_ATTR(sq_insts_valu,		"gfx_event=0x1a,gfx_block=0x1");
+AMDGPU_PMU_ATTR(sq_insts_vmem,		"gfx_event=0x1d,gfx_block=0x1");
+AMDGPU_PMU_ATTR(sq_insts_smem,		"gfx_event=0x1f,gfx_block=0x1");
+AMDGPU_PMU_ATTR(sq_insts_lds,		"gfx_event=0x22,gfx_block=0x1");
+AMDGPU_PMU_ATTR(sq_wave_cycles,		"gfx_event=0x2e,gfx_block=0x1");
+AMDGPU_PMU_ATTR(ta_busy,		"gfx_event=0x0,gfx_block=0x2");
+AMDGPU_PMU_ATTR(ta_buffer_wavefronts,	"gfx_event=0x2c,gfx_block=0x2");
+AMDGPU_PMU_ATTR(tcc_cycle,		"gfx_event=0x1,gfx_block=0x3");
+AMDGPU_PMU_ATTR(tcc_busy,		"gfx_event=0x2,gfx_block=0x3");
+AMDGPU_PMU_ATTR(tcc_req,		"gfx_event=0x3,gfx_block=0x3");
+AMDGPU_PMU_ATTR(tcc_hit,		"gfx_event=0xa,gfx_block=0x3");
+AMDGPU_PMU_ATTR(tcc_miss,		"gfx_event=0xb,gfx_block=0x3");
+
+static struct attribute *gfx_v7_0_event_attrs[] = {
+	&pmu_attr_grbm_count.attr,
+	&pmu_attr_grbm_gui_active.attr,
+	&pmu_attr_grbm_ta_busy.attr,
+	&pmu_attr_sq_busy_cycles.attr,
+	&pmu_attr_sq_waves.attr,
+	&pmu_attr_sq_insts_valu.attr,
+	&pmu_attr_sq_insts_vmem.attr,
+	&pmu_attr_sq_insts_smem.attr,
+	&pmu_attr_sq_insts_lds.attr,
+	&pmu_attr_sq_wave_cycles.attr,
+	&pmu_attr_ta_busy.attr,
+	&pmu_attr_ta_buffer_wavefronts.attr,
+	&pmu_attr_tcc_cycle.attr,
+	&pmu_attr_tcc_busy.attr,
+	&pmu_attr_tcc_req.attr,
+	&pmu_attr_tcc_hit.attr,
+	&pmu_attr_tcc_miss.attr,
+	NULL
+};
+
+static struct attribute_group gfx_v7_0_event_attr_group = {
+	.name = "events",
+	.attrs = gfx_v7_0_event_attrs,
+};
+
+const struct attribute_group *gfx_v7_0_attr_groups[] = {
+	&gfx_v7_0_format_attr_group,
+	&gfx_v7_0_event_attr_group,
+	NULL
+};
+
+#define GFX_V7_0_PMC_POLL_MS	10
+
+struct gfx_v7_0_pmc_block {
+	unsigned num_counters;
+	u32 sel_mask;
+	u32 sel_bits;
+	const u32 *sel;
+	const u32 *lo;		/* _HI is always _LO + 1 */
+};
+
+static const u32 gfx_v7_0_grbm_pmc_sel[] = {
+	mmGRBM_PERFCOUNTER0_SELECT, mmGRBM_PERFCOUNTER1_SELECT,
+};
+static const u32 gfx_v7_0_grbm_pmc_lo[] = {
+	mmGRBM_PERFCOUNTER0_LO, mmGRBM_PERFCOUNTER1_LO,
+};
+static const u32 gfx_v7_0_sq_pmc_sel[] = {
+	mmSQ_PERFCOUNTER0_SELECT, mmSQ_PERFCOUNTER1_SELECT,
+	mmSQ_PERFCOUNTER2_SELECT, mmSQ_PERFCOUNTER3_SELECT,
+	mmSQ_PERFCOUNTER4_SELECT, mmSQ_PERFCOUNTER5_SELECT,
+	mmSQ_PERFCOUNTER6_SELECT, mmSQ_PERFCOUNTER7_SELECT,
+};
+static const u32 gfx_v7_0_sq_pmc_lo[] = {
+	mmSQ_PERFCOUNTER0_LO, mmSQ_PERFCOUNTER1_LO,
+	mmSQ_PERFCOUNTER2_LO, mmSQ_PERFCOUNTER3_LO,
+	mmSQ_PERFCOUNTER4_LO, mmSQ_PERFCOUNTER5_LO,
+	mmSQ_PERFCOUNTER6_LO, mmSQ_PERFCOUNTER7_LO,
+};
+static const u32 gfx_v7_0_ta_pmc_sel[] = {
+	mmTA_PERFCOUNTER0_SELECT, mmTA_PERFCOUNTER1_SELECT,
+};
+static const u32 gfx_v7_0_ta_pmc_lo[] = {
+	mmTA_PERFCOUNTER0_LO, mmTA_PERFCOUNTER1_LO,
+};
+static const u32 gfx_v7_0_tcc_pmc_sel[] = {
+	mmTCC_PERFCOUNTER0_SELECT, mmTCC_PERFCOUNTER1_SELECT,
+	mmTCC_PERFCOUNTER2_SELECT, mmTCC_PERFCOUNTER3_SELECT,
+};
+static const u32 gfx_v7_0_tcc_pmc_lo[] = {
+	mmTCC_PERFCOUNTER0_LO, mmTCC_PERFCOUNTER1_LO,
+	mmTCC_PERFCOUNTER2_LO, mmTCC_PERFCOUNTER3_LO,
+};
+
+static const struct gfx_v7_0_pmc_block
+gfx_v7_0_pmc_blocks[AMDGPU_GFX_PMC_NUM_BLOCKS] = {
+	[AMDGPU_GFX_PMC_GRBM] = {
+		.num_counters = ARRAY_SIZE(gfx_v7_0_grbm_pmc_sel),
+		.sel_mask = GRBM_PERFCOUNTER0_SELECT__PERF_SEL_MASK,
+		.sel = gfx_v7_0_grbm_pmc_sel,
+		.lo = gfx_v7_0_grbm_pmc_lo,
+	},
+	[AMDGPU_GFX_PMC_SQ] = {
+		.num_counters = ARRAY_SIZE(gfx_v7_0_sq_pmc_sel),
+		.sel_mask = SQ_PERFCOUNTER0_SELECT__PERF_SEL_MASK,
+		/* count on every SIMD and SQC bank/client */
+		.sel_bits = SQ_PERFCOUNTER0_SELECT__SQC_BANK_MASK_MASK |
+			    SQ_PERFCOUNTER0_SELECT__SQC_CLIENT_MASK_MASK |
+			    SQ_PERFCOUNTER0_SELECT__SIMD_MASK_MASK,
+		.sel = gfx_v7_0_sq_pmc_sel,
+		.lo = gfx_v7_0_sq_pmc_lo,
+	},
+	[AMDGPU_GFX_PMC_TA] = {
+		.num_counters = ARRAY_SIZE(gfx_v7_0_ta_pmc_sel),
+		.sel_mask = TA_PERFCOUNTER0_SELECT__PERF_SEL_MASK,
+		.sel = gfx_v7_0_ta_pmc_sel,
+		.lo = gfx_v7_0_ta_pmc_lo,
+	},
+	[AMDGPU_GFX_PMC_TCC] = {
+		.num_counters = ARRAY_SIZE(gfx_v7_0_tcc_pmc_sel),
+		.sel_mask = TCC_PERFCOUNTER0_SELECT__PERF_SEL_MASK,
+		.sel = gfx_v7_0_tcc_pmc_sel,
+		.lo = gfx_v7_0_tcc_pmc_lo,
+	},
+};
+
+static struct amdgpu_gfx_pmc_cntr *
+gfx_v7_0_pmc_find(struct amdgpu_device *adev, uint64_t config)
+{
+	unsigned block = AMDGPU_GFX_PMC_GET_BLOCK(config);
+	unsigned i;
+
+	for (i = 0; i < gfx_v7_0_pmc_blocks[block].num_counters; i++)
+		if (adev->gfx.pmc.cntr[block][i].config == config + 1)
+			return &adev->gfx.pmc.cntr[block][i];
+
+	return NULL;
+}
+
+static uint64_t gfx_v7_0_pmc_rreg(struct amdgpu_device *adev, u32 lo)
+{
+	u32 hi, val;
+
+	do {
+		hi = RREG32(lo + 1);
+		val = RREG32(lo);
+	} while (hi != RREG32(lo + 1));
+
+	return ((uint64_t)hi << 32) | val;
+}
+
+/* sum a counter over every instance of its block, caller holds grbm_idx_mutex */
+static uint64_t gfx_v7_0_pmc_read(struct amdgpu_device *adev,
+				  unsigned block, unsigned idx)
+{
+	u32 lo = gfx_v7_0_pmc_blocks[block].lo[idx];
+	uint64_t sum = 0;
+	unsigned se, sh, i;
+
+	switch (block) {
+	case AMDGPU_GFX_PMC_SQ:
+		for (se = 0; se < adev->gfx.config.max_shader_engines; se++) {
+			gfx_v7_0_select_se_sh(adev, se, 0xffffffff, 0xffffffff);
+			sum += gfx_v7_0_pmc_rreg(adev, lo);
+		}
+		break;
+	case AMDGPU_GFX_PMC_TA:
+		for (se = 0; se < adev->gfx.config.max_shader_engines; se++)
+			for (sh = 0; sh < adev->gfx.config.max_sh_per_se; sh++)
+				for (i = 0; i < adev->gfx.config.max_cu_per_sh; i++) {
+					gfx_v7_0_select_se_sh(adev, se, sh, i);
+					sum += gfx_v7_0_pmc_rreg(adev, lo);
+				}
+		break;
+	case AMDGPU_GFX_PMC_TCC:
+		for (i = 0; i < adev->gfx.config.max_texture_channel_caches; i++) {
+			gfx_v7_0_select_se_sh(adev, 0xffffffff, 0xffffffff, i);
+			sum += gfx_v7_0_pmc_rreg(adev, lo);
+		}
+		break;
+	default:
+		sum = gfx_v7_0_pmc_rreg(adev, lo);
+		break;
+	}
+	gfx_v7_0_select_se_sh(adev, 0xffffffff, 0xffffffff, 0xffffffff);
+
+	return sum;
+}
+
+static void gfx_v7_0_pmc_poll(struct work_struct *work)
+{
+	struct amdgpu_device *adev =
+		container_of(work, struct amdgpu_device, gfx.pmc.poll_work.work);
+	struct amdgpu_gfx_pmc *pmc = &adev->gfx.pmc;
+	const struct gfx_v7_0_pmc_block *blk;
+	struct amdgpu_gfx_pmc_cntr *c;
+	unsigned long flags;
+	unsigned block, i;
+	uint64_t raw;
+	bool active;
+
+	if (adev->in_suspend || adev->in_gpu_reset || adev->shutdown)
+		goto out;
+
+	mutex_lock(&adev->grbm_idx_mutex);
+	spin_lock_irqsave(&pmc->lock, flags);
+
+	gfx_v7_0_select_se_sh(adev, 0xffffffff, 0xffffffff, 0xffffffff);
+	active = pmc->active != 0;
+	if (pmc->hw_stale) {
+		for (block = 0; block < AMDGPU_GFX_PMC_NUM_BLOCKS; block++)
+			for (i = 0; i < AMDGPU_GFX_PMC_MAX_COUNTERS; i++)
+				pmc->cntr[block][i].programmed = false;
+		WREG32(mmCP_PERFMON_CNTL, 0);
+		if (active) {
+			WREG32(mmSQ_PERFCOUNTER_CTRL, 0x7f);
+			WREG32(mmCP_PERFMON_CNTL,
+			       REG_SET_FIELD(0, CP_PERFMON_CNTL, PERFMON_STATE, 1));
+		}
+		pmc->hw_stale = false;
+	}
+
+	for (block = 0; block < AMDGPU_GFX_PMC_NUM_BLOCKS; block++) {
+		blk = &gfx_v7_0_pmc_blocks[block];
+		for (i = 0; i < blk->num_counters; i++) {
+			c = &pmc->cntr[block][i];
+			if (!c->config)
+				continue;
+
+			if (!c->programmed) {
+				WREG32(blk->sel[i], blk->sel_bits |
+				       (AMDGPU_GFX_PMC_GET_EVENT(c->config - 1) &
+					blk->sel_mask));
+				c->last = gfx_v7_0_pmc_read(adev, block, i);
+				c->programmed = true;
+				continue;
+			}
+
+			raw = gfx_v7_0_pmc_read(adev, block, i);
+			if (c->running)
+				c->count += raw - c->last;
+			c->last = raw;
+		}
+	}
+
+	spin_unlock_irqrestore(&pmc->lock, flags);
+	mutex_unlock(&adev->grbm_idx_mutex);
+
+out:
+	if (READ_ONCE(pmc->active))
+		schedule_delayed_work(&pmc->poll_work,
+				      msecs_to_jiffies(GFX_V7_0_PMC_POLL_MS));
+}
+
+static int gfx_v7_0_pmc_start(struct amdgpu_device *adev, uint64_t config,
+			      int is_enable)
+{
+	struct amdgpu_gfx_pmc *pmc = &adev->gfx.pmc;
+	unsigned block = AMDGPU_GFX_PMC_GET_BLOCK(config);
+	struct amdgpu_gfx_pmc_cntr *c;
+	unsigned long flags;
+	int i, ret = 0;
+
+	if (block >= AMDGPU_GFX_PMC_NUM_BLOCKS)
+		return -EINVAL;
+
+	spin_lock_irqsave(&pmc->lock, flags);
+	c = gfx_v7_0_pmc_find(adev, config);
+	if (is_enable) {
+		if (!c) {
+			for (i = 0; i < gfx_v7_0_pmc_blocks[block].num_counters; i++) {
+				if (!pmc->cntr[block][i].config) {
+					c = &pmc->cntr[block][i];
+					break;
+				}
+			}
+			if (!c) {
+				ret = -ENOSPC;
+				goto out;
+			}
+			memset(c, 0, sizeof(*c));
+			c->config = config + 1;
+			/* first user: reset and start the global perfmon */
+			if (!pmc->active++)
+				pmc->hw_stale = true;
+		}
+		c->refs++;
+	} else if (c) {
+		c->running++;
+	} else {
+		ret = -EINVAL;
+	}
+out:
+	spin_unlock_irqrestore(&pmc->lock, flags);
+
+	if (!ret)
+		mod_delayed_work(system_wq, &pmc->poll_work, 0);
+
+	return ret;
+}
+
+static int gfx_v7_0_pmc_stop(struct amdgpu_device *adev, uint64_t config,
+			     int is_disable)
+{
+	struct amdgpu_gfx_pmc *pmc = &adev->gfx.pmc;
+	struct amdgpu_gfx_pmc_cntr *c;
+	unsigned long flags;
+
+	if (AMDGPU_GFX_PMC_GET_BLOCK(config) >= AMDGPU_GFX_PMC_NUM_BLOCKS)
+		return -EINVAL;
+
+	spin_lock_irqsave(&pmc->lock, flags);
+	c = gfx_v7_0_pmc_find(adev, config);
+	if (c) {
+		if (!is_disable) {
+			if (c->running)
+				c->running--;
+		} else if (!--c->refs) {
+			c->config = 0;
+			pmc->active--;
+		}
+	}
+	spin_unlock_irqrestore(&pmc->lock, flags);
+
+	return c ? 0 : -EINVAL;
+}
+
+/* counts lag the hardware by up to one poll period */
+static void gfx_v7_0_pmc_get_count(struct amdgpu_device *adev,
+				   uint64_t config, uint64_t *count)
+{
+	struct amdgpu_gfx_pmc *pmc = &adev->gfx.pmc;
+	struct amdgpu_gfx_pmc_cntr *c;
+	unsigned long flags;
+
+	*count = 0;
+	if (AMDGPU_GFX_PMC_GET_BLOCK(config) >= AMDGPU_GFX_PMC_NUM_BLOCKS)
+		return;
+
+	spin_lock_irqsave(&pmc->lock, flags);
+	c = gfx_v7_0_pmc_find(adev, config);
+	if (c)
+		*count = c->count;
+	spin_unlock_irqrestore(&pmc->lock, flags);
+}
+
 static const struct amdgpu_gfx_funcs gfx_v7_0_gfx_funcs = {
 	.get_gpu_clock_counter = &gfx_v7_0_get_gpu_clock_counter,
 	.select_se_sh = &gfx_v7_0_select_se_sh,
 	.read_wave_data = &gfx_v7_0_read_wave_data,
 	.read_wave_sgprs = &gfx_v7_0_read_wave_sgprs,
-	.select_me_pipe_q = &gfx_v7_0_select_me_pipe_q
+	.select_me_pipe_q = &gfx_v7_0_select_me_pipe_q,
+	.pmc_start = &gfx_v7_0_pmc_start,
+	.pmc_stop = &gfx_v7_0_pmc_stop,
+	.pmc_get_count = &gfx_v7_0_pmc_get_count
 };
 
 static const struct amdgpu_rlc_funcs gfx_v7_0_rlc_funcs = {
@@ -5166,6 +5537,9 @@ static int gfx_v7_0_sw_init(void *handle)
 
 	gfx_v7_0_gpu_early_init(adev);
 
+	spin_lock_init(&adev->gfx.pmc.lock);
+	INIT_DELAYED_WORK(&adev->gfx.pmc.poll_work, gfx_v7_0_pmc_poll);
+
 	return r;
 }
 
@@ -5174,6 +5548,7 @@ static int gfx_v7_0_sw_fini(void *handle)
 	struct amdgpu_device *adev = (struct amdgpu_device *)handle;
 	int i;
 
+	cancel_delayed_work_sync(&adev->gfx.pmc.poll_work);
 	for (i = 0; i < adev->gfx.num_gfx_rings; i++)
 		amdgpu_ring_fini(&adev->gfx.gfx_ring[i]);
 	for (i = 0; i < adev->gfx.num_compute_rings; i++)
@@ -5213,6 +5588,9 @@ static int gfx_v7_0_hw_init(void *handle)
 	if (r)
 		return r;
 
+	/* perfmon state does not survive reset or suspend */
+	adev->gfx.pmc.hw_stale = true;
+
 	return r;
 }
 
@@ -5270,82 +5648,204 @@ static int gfx_v7_0_wait_for_idle(void *handle)
 	return -ETIMEDOUT;
 }
 
-static int gfx_v7_0_soft_reset(void *handle)
+static bool gfx_v7_0_ring_busy(struct amdgpu_ring *ring)
+{
+	return ring->sched.ready && amdgpu_fence_count_emitted(ring);
+}
+
+/*
+ * Work out which side of the CP is stuck, so that a hung compute dispatch
+ * doesn't take the gfx ring down with it and vice versa. The CPF fetches
+ * for both sides, so it is only reset together with the whole CP.
+ */
+static bool gfx_v7_0_check_soft_reset(void *handle)
 {
-	u32 grbm_soft_reset = 0, srbm_soft_reset = 0;
-	u32 tmp;
 	struct amdgpu_device *adev = (struct amdgpu_device *)handle;
+	u32 grbm_soft_reset = 0, srbm_soft_reset = 0;
+	bool gfx = false, compute = false;
+	u32 tmp, tmp2;
+	int i;
 
-	/* GRBM_STATUS */
 	tmp = RREG32(mmGRBM_STATUS);
+	tmp2 = RREG32(mmGRBM_STATUS2);
 	if (tmp & (GRBM_STATUS__PA_BUSY_MASK | GRBM_STATUS__SC_BUSY_MASK |
 		   GRBM_STATUS__BCI_BUSY_MASK | GRBM_STATUS__SX_BUSY_MASK |
 		   GRBM_STATUS__TA_BUSY_MASK | GRBM_STATUS__VGT_BUSY_MASK |
 		   GRBM_STATUS__DB_BUSY_MASK | GRBM_STATUS__CB_BUSY_MASK |
 		   GRBM_STATUS__GDS_BUSY_MASK | GRBM_STATUS__SPI_BUSY_MASK |
-		   GRBM_STATUS__IA_BUSY_MASK | GRBM_STATUS__IA_BUSY_NO_DMA_MASK))
-		grbm_soft_reset |= GRBM_SOFT_RESET__SOFT_RESET_CP_MASK |
-			GRBM_SOFT_RESET__SOFT_RESET_GFX_MASK;
-
-	if (tmp & (GRBM_STATUS__CP_BUSY_MASK | GRBM_STATUS__CP_COHERENCY_BUSY_MASK)) {
-		grbm_soft_reset |= GRBM_SOFT_RESET__SOFT_RESET_CP_MASK;
-		srbm_soft_reset |= SRBM_SOFT_RESET__SOFT_RESET_GRBM_MASK;
+		   GRBM_STATUS__IA_BUSY_MASK | GRBM_STATUS__IA_BUSY_NO_DMA_MASK |
+		   GRBM_STATUS__CP_BUSY_MASK |
+		   GRBM_STATUS__CP_COHERENCY_BUSY_MASK) ||
+	    (tmp2 & (GRBM_STATUS2__CPF_BUSY_MASK | GRBM_STATUS2__CPC_BUSY_MASK |
+		     GRBM_STATUS2__CPG_BUSY_MASK))) {
+		for (i = 0; i < adev->gfx.num_gfx_rings; i++)
+			gfx |= gfx_v7_0_ring_busy(&adev->gfx.gfx_ring[i]);
+		for (i = 0; i < adev->gfx.num_compute_rings; i++)
+			compute |= gfx_v7_0_ring_busy(&adev->gfx.compute_ring[i]);
+
+		if (gfx == compute) {
+			/* Both or neither; don't guess */
+			grbm_soft_reset |= GRBM_SOFT_RESET__SOFT_RESET_CP_MASK |
+				GRBM_SOFT_RESET__SOFT_RESET_GFX_MASK;
+			srbm_soft_reset |= SRBM_SOFT_RESET__SOFT_RESET_GRBM_MASK;
+		} else if (gfx) {
+			grbm_soft_reset |= GRBM_SOFT_RESET__SOFT_RESET_CPG_MASK |
+				GRBM_SOFT_RESET__SOFT_RESET_GFX_MASK;
+		} else {
+			grbm_soft_reset |= GRBM_SOFT_RESET__SOFT_RESET_CPC_MASK;
+		}
 	}
 
-	/* GRBM_STATUS2 */
-	tmp = RREG32(mmGRBM_STATUS2);
-	if (tmp & GRBM_STATUS2__RLC_BUSY_MASK)
+	if (tmp2 & GRBM_STATUS2__RLC_BUSY_MASK)
 		grbm_soft_reset |= GRBM_SOFT_RESET__SOFT_RESET_RLC_MASK;
 
-	/* SRBM_STATUS */
 	tmp = RREG32(mmSRBM_STATUS);
 	if (tmp & SRBM_STATUS__GRBM_RQ_PENDING_MASK)
 		srbm_soft_reset |= SRBM_SOFT_RESET__SOFT_RESET_GRBM_MASK;
+	if (tmp & SRBM_STATUS__SEM_BUSY_MASK)
+		srbm_soft_reset |= SRBM_SOFT_RESET__SOFT_RESET_SEM_MASK;
 
-	if (grbm_soft_reset || srbm_soft_reset) {
-		/* disable CG/PG */
-		gfx_v7_0_fini_pg(adev);
-		gfx_v7_0_update_cg(adev, false);
+	adev->gfx.grbm_soft_reset = grbm_soft_reset;
+	adev->gfx.srbm_soft_reset = srbm_soft_reset;
 
-		/* stop the rlc */
+	return grbm_soft_reset || srbm_soft_reset;
+}
+
+static bool gfx_v7_0_soft_reset_gfx(struct amdgpu_device *adev)
+{
+	return adev->gfx.grbm_soft_reset &
+		(GRBM_SOFT_RESET__SOFT_RESET_CP_MASK |
+		 GRBM_SOFT_RESET__SOFT_RESET_CPG_MASK);
+}
+
+static bool gfx_v7_0_soft_reset_compute(struct amdgpu_device *adev)
+{
+	return adev->gfx.grbm_soft_reset &
+		(GRBM_SOFT_RESET__SOFT_RESET_CP_MASK |
+		 GRBM_SOFT_RESET__SOFT_RESET_CPC_MASK);
+}
+
+static int gfx_v7_0_pre_soft_reset(void *handle)
+{
+	struct amdgpu_device *adev = (struct amdgpu_device *)handle;
+	int i;
+
+	if (!adev->gfx.grbm_soft_reset && !adev->gfx.srbm_soft_reset)
+		return 0;
+
+	/* disable CG/PG */
+	gfx_v7_0_fini_pg(adev);
+	gfx_v7_0_update_cg(adev, false);
+
+	if (adev->gfx.grbm_soft_reset & GRBM_SOFT_RESET__SOFT_RESET_RLC_MASK)
 		adev->gfx.rlc.funcs->stop(adev);
 
-		/* Disable GFX parsing/prefetching */
-		WREG32(mmCP_ME_CNTL, CP_ME_CNTL__ME_HALT_MASK | CP_ME_CNTL__PFP_HALT_MASK | CP_ME_CNTL__CE_HALT_MASK);
+	/* Disable GFX parsing/prefetching */
+	if (gfx_v7_0_soft_reset_gfx(adev))
+		gfx_v7_0_cp_gfx_enable(adev, false);
 
+	if (gfx_v7_0_soft_reset_compute(adev)) {
+		for (i = 0; i < adev->gfx.num_compute_rings; i++) {
+			struct amdgpu_ring *ring = &adev->gfx.compute_ring[i];
+
+			mutex_lock(&adev->srbm_mutex);
+			cik_srbm_select(adev, ring->me, ring->pipe, ring->queue, 0);
+			gfx_v7_0_mqd_deactivate(adev);
+			cik_srbm_select(adev, 0, 0, 0, 0);
+			mutex_unlock(&adev->srbm_mutex);
+		}
 		/* Disable MEC parsing/prefetching */
-		WREG32(mmCP_MEC_CNTL, CP_MEC_CNTL__MEC_ME1_HALT_MASK | CP_MEC_CNTL__MEC_ME2_HALT_MASK);
+		gfx_v7_0_cp_compute_enable(adev, false);
+	}
+
+	return 0;
+}
+
+static int gfx_v7_0_soft_reset(void *handle)
+{
+	struct amdgpu_device *adev = (struct amdgpu_device *)handle;
+	u32 grbm_soft_reset = adev->gfx.grbm_soft_reset;
+	u32 srbm_soft_reset = adev->gfx.srbm_soft_reset;
+	u32 tmp;
+
+	if (!grbm_soft_reset && !srbm_soft_reset)
+		return 0;
 
-		if (grbm_soft_reset) {
-			tmp = RREG32(mmGRBM_SOFT_RESET);
-			tmp |= grbm_soft_reset;
-			dev_info(adev->dev, "GRBM_SOFT_RESET=0x%08X\n", tmp);
-			WREG32(mmGRBM_SOFT_RESET, tmp);
-			tmp = RREG32(mmGRBM_SOFT_RESET);
+	/* Hold off GFX memory requests while the blocks are in reset */
+	tmp = RREG32(mmGMCON_DEBUG);
+	tmp |= GMCON_DEBUG__GFX_STALL_MASK | GMCON_DEBUG__GFX_CLEAR_MASK;
+	WREG32(mmGMCON_DEBUG, tmp);
+	udelay(50);
 
-			udelay(50);
+	if (grbm_soft_reset) {
+		tmp = RREG32(mmGRBM_SOFT_RESET);
+		tmp |= grbm_soft_reset;
+		dev_info(adev->dev, "GRBM_SOFT_RESET=0x%08X\n", tmp);
+		WREG32(mmGRBM_SOFT_RESET, tmp);
+		tmp = RREG32(mmGRBM_SOFT_RESET);
 
-			tmp &= ~grbm_soft_reset;
-			WREG32(mmGRBM_SOFT_RESET, tmp);
-			tmp = RREG32(mmGRBM_SOFT_RESET);
-		}
+		udelay(50);
 
-		if (srbm_soft_reset) {
-			tmp = RREG32(mmSRBM_SOFT_RESET);
-			tmp |= srbm_soft_reset;
-			dev_info(adev->dev, "SRBM_SOFT_RESET=0x%08X\n", tmp);
-			WREG32(mmSRBM_SOFT_RESET, tmp);
-			tmp = RREG32(mmSRBM_SOFT_RESET);
+		tmp &= ~grbm_soft_reset;
+		WREG32(mmGRBM_SOFT_RESET, tmp);
+		tmp = RREG32(mmGRBM_SOFT_RESET);
+	}
 
-			udelay(50);
+	if (srbm_soft_reset) {
+		tmp = RREG32(mmSRBM_SOFT_RESET);
+		tmp |= srbm_soft_reset;
+		dev_info(adev->dev, "SRBM_SOFT_RESET=0x%08X\n", tmp);
+		WREG32(mmSRBM_SOFT_RESET, tmp);
+		tmp = RREG32(mmSRBM_SOFT_RESET);
 
-			tmp &= ~srbm_soft_reset;
-			WREG32(mmSRBM_SOFT_RESET, tmp);
-			tmp = RREG32(mmSRBM_SOFT_RESET);
-		}
-		/* Wait a little for things to settle down */
 		udelay(50);
+
+		tmp &= ~srbm_soft_reset;
+		WREG32(mmSRBM_SOFT_RESET, tmp);
+		tmp = RREG32(mmSRBM_SOFT_RESET);
 	}
+
+	tmp = RREG32(mmGMCON_DEBUG);
+	tmp &= ~(GMCON_DEBUG__GFX_STALL_MASK | GMCON_DEBUG__GFX_CLEAR_MASK);
+	WREG32(mmGMCON_DEBUG, tmp);
+
+	/* Wait a little for things to settle down */
+	udelay(50);
+
+	return 0;
+}
+
+static int gfx_v7_0_post_soft_reset(void *handle)
+{
+	struct amdgpu_device *adev = (struct amdgpu_device *)handle;
+	int r;
+
+	if (!adev->gfx.grbm_soft_reset && !adev->gfx.srbm_soft_reset)
+		return 0;
+
+	if (adev->gfx.grbm_soft_reset & GRBM_SOFT_RESET__SOFT_RESET_RLC_MASK) {
+		r = adev->gfx.rlc.funcs->resume(adev);
+		if (r)
+			return r;
+	} else {
+		gfx_v7_0_init_pg(adev);
+	}
+
+	/* The ME/MEC ucode survives a soft reset, only the rings need setup */
+	if (gfx_v7_0_soft_reset_gfx(adev)) {
+		r = gfx_v7_0_cp_gfx_resume(adev);
+		if (r)
+			return r;
+	}
+
+	if (gfx_v7_0_soft_reset_compute(adev)) {
+		r = gfx_v7_0_cp_compute_resume(adev);
+		if (r)
+			return r;
+	}
+
+	gfx_v7_0_update_cg(adev, true);
+
 	return 0;
 }
 
@@ -5601,6 +6101,40 @@ static int gfx_v7_0_set_clockgating_state(void *handle,
 	return 0;
 }
 
+static void gfx_v7_0_get_clockgating_state(void *handle, u32 *flags)
+{
+	struct amdgpu_device *adev = (struct amdgpu_device *)handle;
+	u32 data;
+
+	/* AMD_CG_SUPPORT_GFX_MGCG, see gfx_v7_0_enable_mgcg() */
+	data = RREG32(mmRLC_CGTT_MGCG_OVERRIDE);
+	if (!(data & 0x00000002))
+		*flags |= AMD_CG_SUPPORT_GFX_MGCG;
+
+	/* AMD_CG_SUPPORT_GFX_CGCG */
+	data = RREG32(mmRLC_CGCG_CGLS_CTRL);
+	if (data & RLC_CGCG_CGLS_CTRL__CGCG_EN_MASK)
+		*flags |= AMD_CG_SUPPORT_GFX_CGCG;
+
+	/* AMD_CG_SUPPORT_GFX_CGLS */
+	if (data & RLC_CGCG_CGLS_CTRL__CGLS_EN_MASK)
+		*flags |= AMD_CG_SUPPORT_GFX_CGLS;
+
+	/* AMD_CG_SUPPORT_GFX_CGTS */
+	data = RREG32(mmCGTS_SM_CTRL_REG);
+	if (!(data & CGTS_SM_CTRL_REG__OVERRIDE_MASK))
+		*flags |= AMD_CG_SUPPORT_GFX_CGTS;
+
+	/* AMD_CG_SUPPORT_GFX_CGTS_LS */
+	if (!(data & CGTS_SM_CTRL_REG__LS_OVERRIDE_MASK))
+		*flags |= AMD_CG_SUPPORT_GFX_CGTS_LS;
+
+	/* AMD_CG_SUPPORT_GFX_CP_LS */
+	data = RREG32(mmCP_MEM_SLP_CNTL);
+	if (data & CP_MEM_SLP_CNTL__CP_MEM_LS_EN_MASK)
+		*flags |= AMD_CG_SUPPORT_GFX_CP_LS | AMD_CG_SUPPORT_GFX_MGLS;
+}
+
 static int gfx_v7_0_set_powergating_state(void *handle,
 					  enum amd_powergating_state state)
 {
@@ -5638,9 +6172,13 @@ static const struct amd_ip_funcs gfx_v7_0_ip_funcs = {
 	.resume = gfx_v7_0_resume,
 	.is_idle = gfx_v7_0_is_idle,
 	.wait_for_idle = gfx_v7_0_wait_for_idle,
+	.check_soft_reset = gfx_v7_0_check_soft_reset,
+	.pre_soft_reset = gfx_v7_0_pre_soft_reset,
 	.soft_reset = gfx_v7_0_soft_reset,
+	.post_soft_reset = gfx_v7_0_post_soft_reset,
 	.set_clockgating_state = gfx_v7_0_set_clockgating_state,
 	.set_powergating_state = gfx_v7_0_set_powergating_state,
+	.get_clockgating_state = gfx_v7_0_get_clockgating_state,
 };
 
 static const struct amdgpu_ring_funcs gfx_v7_0_ring_funcs_gfx = {
@@ -5764,9 +6302,6 @@ static void gfx_v7_0_get_cu_info(struct amdgpu_device *adev)
 	else
 		ao_cu_num = adev->gfx.config.max_cu_per_sh;
 
-	if(adev->asic_type == CHIP_LIVERPOOL || adev->asic_type == CHIP_GLADIUS)
-		ao_cu_num = adev->gfx.config.max_cu_per_sh;
-
 	memset(cu_info, 0, sizeof(*cu_info));
 
 	amdgpu_gfx_parse_disable_cu(disable_masks, 4, 2);
@@ -28,6 +28,7 @@ extern const struct amdgpu_ip_block_version gfx_v7_0_ip_block;
 extern const struct amdgpu_ip_block_version gfx_v7_1_ip_block;
 extern const struct amdgpu_ip_block_version gfx_v7_2_ip_block;
 extern const struct amdgpu_ip_block_version gfx_v7_3_ip_block;
+extern const struct attribute_group *gfx_v7_0_attr_groups[];
 
 struct amdgpu_device;
 struct cik_mqd;
@@ -22,6 +22,8 @@
  */
 
 #include <linux/firmware.h>
+#include <linux/memory.h>
+#include <linux/memory_hotplug.h>
 #include <linux/module.h>
 #include <linux/pci.h>
 
@@ -312,6 +314,62 @@ static void gmc_v7_0_mc_program(struct amdgpu_device *adev)
 	WREG32(mmHDP_HOST_PATH_CNTL, tmp);
 }
 
+#ifdef CONFIG_MEMORY_HOTPLUG
+/* Carve-out already given to the page allocator, survives driver reloads */
+static u64 gmc_v7_0_ps4_reclaimed;
+
+/**
+ * gmc_v7_0_ps4_reclaim_vram - return part of the PS4 carve-out to the system
+ *
+ * @adev: amdgpu_device pointer
+ *
+ * The loader splits the GDDR5 between system RAM and the GPU carve-out.
+ * Hotplug the top amdgpu_ps4_vram_reclaim MiB of the carve-out as system
+ * memory and shrink VRAM accordingly. Memory handed back is never taken
+ * back, a reprobe only shrinks VRAM again.
+ */
+static void gmc_v7_0_ps4_reclaim_vram(struct amdgpu_device *adev)
+{
+	u64 block, size, start;
+	int r;
+
+	if (gmc_v7_0_ps4_reclaimed)
+		goto shrink;
+
+	if (amdgpu_ps4_vram_reclaim <= 0)
+		return;
+
+	block = memory_block_size_bytes();
+	size = round_down((u64)amdgpu_ps4_vram_reclaim << 20, block);
+	start = adev->gmc.aper_base + adev->gmc.real_vram_size - size;
+
+	/* keep enough VRAM around for scanout and the rings */
+	if (!size || size + (256ULL << 20) > adev->gmc.real_vram_size ||
+	    !IS_ALIGNED(start, block)) {
+		DRM_WARN("Can't reclaim %d MB of VRAM (block size %llu MB)\n",
+			 amdgpu_ps4_vram_reclaim, block >> 20);
+		return;
+	}
+
+	r = add_memory(memory_add_physaddr_to_nid(start), start, size);
+	if (r) {
+		DRM_WARN("Failed to return %llu MB of VRAM to the system (%d)\n",
+			 size >> 20, r);
+		return;
+	}
+	gmc_v7_0_ps4_reclaimed = size;
+	DRM_INFO("Returned %lluM of VRAM at 0x%llx to the system\n",
+		 size >> 20, start);
+
+shrink:
+	adev->gmc.real_vram_size -= gmc_v7_0_ps4_reclaimed;
+}
+#else
+static inline void gmc_v7_0_ps4_reclaim_vram(struct amdgpu_device *adev)
+{
+}
+#endif
+
 /**
  * gmc_v7_0_mc_init - initialize the memory controller driver params
  *
@@ -389,6 +447,13 @@ static int gmc_v7_0_mc_init(struct amdgpu_device *adev)
 	}
 #endif
 
+	/* The PS4 "VRAM" is carved out of the same GDDR5 as system RAM */
+	if (adev->asic_type == CHIP_LIVERPOOL ||
+	    adev->asic_type == CHIP_GLADIUS) {
+		adev->gmc.unified_memory = true;
+		gmc_v7_0_ps4_reclaim_vram(adev);
+	}
+
 	/* In case the PCI BAR is larger than the actual amount of vram */
 	adev->gmc.visible_vram_size = adev->gmc.aper_size;
 	if (adev->gmc.visible_vram_size > adev->gmc.real_vram_size)
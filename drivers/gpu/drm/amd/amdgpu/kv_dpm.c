@@ -381,6 +381,20 @@ static struct kv_power_info *kv_get_pi(struct amdgpu_device *adev)
 	return pi;
 }
 
+/* Liverpool and Gladius carry a Kabini-style SMU */
+static bool kv_is_kabini_class(struct amdgpu_device *adev)
+{
+	switch (adev->asic_type) {
+	case CHIP_KABINI:
+	case CHIP_MULLINS:
+	case CHIP_LIVERPOOL:
+	case CHIP_GLADIUS:
+		return true;
+	default:
+		return false;
+	}
+}
+
 #if 0
 static void kv_program_local_cac_table(struct amdgpu_device *adev,
 				       const struct kv_lcac_config_values *local_cac_table,
@@ -771,7 +785,7 @@ static int kv_force_lowest_valid(struct amdgpu_device *adev)
 
 static int kv_unforce_levels(struct amdgpu_device *adev)
 {
-	if (adev->asic_type == CHIP_KABINI || adev->asic_type == CHIP_MULLINS)
+	if (kv_is_kabini_class(adev))
 		return amdgpu_kv_notify_message_to_smu(adev, PPSMC_MSG_NoForcedLevel);
 	else
 		return kv_set_enabled_levels(adev);
@@ -1740,7 +1754,7 @@ static void kv_dpm_powergate_acp(struct amdgpu_device *adev, bool gate)
 	if (pi->acp_power_gated == gate)
 		return;
 
-	if (adev->asic_type == CHIP_KABINI || adev->asic_type == CHIP_MULLINS)
+	if (kv_is_kabini_class(adev))
 		return;
 
 	pi->acp_power_gated = gate;
@@ -1889,6 +1903,62 @@ static int kv_dpm_force_performance_level(void *handle,
 	return 0;
 }
 
+static u32 kv_dpm_get_current_sclk_index(struct amdgpu_device *adev)
+{
+	return (RREG32_SMC(ixTARGET_AND_CURRENT_PROFILE_INDEX) &
+		TARGET_AND_CURRENT_PROFILE_INDEX__CURR_SCLK_INDEX_MASK) >>
+		TARGET_AND_CURRENT_PROFILE_INDEX__CURR_SCLK_INDEX__SHIFT;
+}
+
+static int kv_dpm_print_clock_levels(void *handle, enum pp_clock_type type,
+				     char *buf)
+{
+	struct amdgpu_device *adev = (struct amdgpu_device *)handle;
+	struct kv_power_info *pi = kv_get_pi(adev);
+	u32 i, sclk, current_index;
+	int size = 0;
+
+	if (type != PP_SCLK)
+		return 0;
+
+	current_index = kv_dpm_get_current_sclk_index(adev);
+	for (i = 0; i < pi->graphics_dpm_level_count; i++) {
+		sclk = be32_to_cpu(pi->graphics_level[i].SclkFrequency);
+		size += sprintf(buf + size, "%d: %uMhz %s\n", i, sclk / 100,
+				(i == current_index) ? "*" : "");
+	}
+
+	return size;
+}
+
+static int kv_dpm_force_clock_level(void *handle, enum pp_clock_type type,
+				    uint32_t mask)
+{
+	struct amdgpu_device *adev = (struct amdgpu_device *)handle;
+	struct kv_power_info *pi = kv_get_pi(adev);
+	int ret;
+
+	if (adev->pm.dpm.forced_level != AMD_DPM_FORCED_LEVEL_MANUAL)
+		return -EINVAL;
+
+	if (type != PP_SCLK)
+		return -EINVAL;
+
+	mask &= (1 << pi->graphics_dpm_level_count) - 1;
+	if (!mask)
+		return -EINVAL;
+
+	if (kv_is_kabini_class(adev)) {
+		ret = amdgpu_kv_notify_message_to_smu(adev, PPSMC_MSG_NoForcedLevel);
+		if (ret)
+			return ret;
+	}
+
+	return amdgpu_kv_send_msg_to_smc_with_parameter(adev,
+						 PPSMC_MSG_SCLKDPM_SetEnabledMask,
+						 mask);
+}
+
 static int kv_dpm_pre_set_power_state(void *handle)
 {
 	struct amdgpu_device *adev = (struct amdgpu_device *)handle;
@@ -1921,7 +1991,7 @@ static int kv_dpm_set_power_state(void *handle)
 		}
 	}
 
-	if (adev->asic_type == CHIP_KABINI || adev->asic_type == CHIP_MULLINS) {
+	if (kv_is_kabini_class(adev)) {
 		if (pi->enable_dpm) {
 			kv_set_valid_clock_range(adev, new_ps);
 			kv_update_dfs_bypass_settings(adev, new_ps);
@@ -2001,7 +2071,7 @@ static void kv_dpm_reset_asic(struct amdgpu_device *adev)
 {
 	struct kv_power_info *pi = kv_get_pi(adev);
 
-	if (adev->asic_type == CHIP_KABINI || adev->asic_type == CHIP_MULLINS) {
+	if (kv_is_kabini_class(adev)) {
 		kv_force_lowest_valid(adev);
 		kv_init_graphics_levels(adev);
 		kv_program_bootup_state(adev);
@@ -2106,7 +2176,7 @@ static int kv_force_dpm_highest(struct amdgpu_device *adev)
 			break;
 	}
 
-	if (adev->asic_type == CHIP_KABINI || adev->asic_type == CHIP_MULLINS)
+	if (kv_is_kabini_class(adev))
 		return amdgpu_kv_send_msg_to_smc_with_parameter(adev, PPSMC_MSG_DPM_ForceState, i);
 	else
 		return kv_set_enabled_level(adev, i);
@@ -2126,7 +2196,7 @@ static int kv_force_dpm_lowest(struct amdgpu_device *adev)
 			break;
 	}
 
-	if (adev->asic_type == CHIP_KABINI || adev->asic_type == CHIP_MULLINS)
+	if (kv_is_kabini_class(adev))
 		return amdgpu_kv_send_msg_to_smc_with_parameter(adev, PPSMC_MSG_DPM_ForceState, i);
 	else
 		return kv_set_enabled_level(adev, i);
@@ -2282,7 +2352,7 @@ static void kv_apply_state_adjust_rules(struct amdgpu_device *adev,
 	else
 		pi->battery_state = false;
 
-	if (adev->asic_type == CHIP_KABINI || adev->asic_type == CHIP_MULLINS) {
+	if (kv_is_kabini_class(adev)) {
 		ps->dpm0_pg_nb_ps_lo = 0x1;
 		ps->dpm0_pg_nb_ps_hi = 0x0;
 		ps->dpmx_nb_ps_lo = 0x1;
@@ -2343,7 +2413,7 @@ static int kv_calculate_nbps_level_settings(struct amdgpu_device *adev)
 	if (pi->lowest_valid > pi->highest_valid)
 		return -EINVAL;
 
-	if (adev->asic_type == CHIP_KABINI || adev->asic_type == CHIP_MULLINS) {
+	if (kv_is_kabini_class(adev)) {
 		for (i = pi->lowest_valid; i <= pi->highest_valid; i++) {
 			pi->graphics_level[i].GnbSlow = 1;
 			pi->graphics_level[i].ForceNbPs1 = 0;
@@ -2488,7 +2558,7 @@ static void kv_program_nbps_index_settings(struct amdgpu_device *adev,
 	struct kv_power_info *pi = kv_get_pi(adev);
 	u32 nbdpmconfig1;
 
-	if (adev->asic_type == CHIP_KABINI || adev->asic_type == CHIP_MULLINS)
+	if (kv_is_kabini_class(adev))
 		return;
 
 	if (pi->sys_info.nb_dpm_enable) {
@@ -2854,10 +2924,7 @@ kv_dpm_debugfs_print_current_performance_level(void *handle,
 {
 	struct amdgpu_device *adev = (struct amdgpu_device *)handle;
 	struct kv_power_info *pi = kv_get_pi(adev);
-	u32 current_index =
-		(RREG32_SMC(ixTARGET_AND_CURRENT_PROFILE_INDEX) &
-		TARGET_AND_CURRENT_PROFILE_INDEX__CURR_SCLK_INDEX_MASK) >>
-		TARGET_AND_CURRENT_PROFILE_INDEX__CURR_SCLK_INDEX__SHIFT;
+	u32 current_index = kv_dpm_get_current_sclk_index(adev);
 	u32 sclk, tmp;
 	u16 vddc;
 
@@ -3271,10 +3338,7 @@ static int kv_dpm_read_sensor(void *handle, int idx,
 	struct amdgpu_device *adev = (struct amdgpu_device *)handle;
 	struct kv_power_info *pi = kv_get_pi(adev);
 	uint32_t sclk;
-	u32 pl_index =
-		(RREG32_SMC(ixTARGET_AND_CURRENT_PROFILE_INDEX) &
-		TARGET_AND_CURRENT_PROFILE_INDEX__CURR_SCLK_INDEX_MASK) >>
-		TARGET_AND_CURRENT_PROFILE_INDEX__CURR_SCLK_INDEX__SHIFT;
+	u32 pl_index = kv_dpm_get_current_sclk_index(adev);
 
 	/* size must be at least 4 bytes for all sensors */
 	if (*size < 4)
@@ -3351,6 +3415,8 @@ static const struct amd_pm_funcs kv_dpm_funcs = {
 	.print_power_state = &kv_dpm_print_power_state,
 	.debugfs_print_current_performance_level = &kv_dpm_debugfs_print_current_performance_level,
 	.force_performance_level = &kv_dpm_force_performance_level,
+	.print_clock_levels = &kv_dpm_print_clock_levels,
+	.force_clock_level = &kv_dpm_force_clock_level,
 	.set_powergating_by_smu = kv_set_powergating_by_smu,
 	.enable_bapm = &kv_dpm_enable_bapm,
 	.get_vce_clock_state = amdgpu_get_vce_clock_state,
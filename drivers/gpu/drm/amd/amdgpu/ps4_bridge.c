@@ -17,6 +17,7 @@
 #include <drm/drm_crtc_helper.h>
 #include <drm/drm_atomic_helper.h>
 #include <drm/drm_edid.h>
+#include <drm/drm_probe_helper.h>
 #include <drm/drmP.h>
 
 #include <drm/drm_bridge.h>
@@ -24,6 +25,7 @@
 
 #include <linux/i2c.h>
 #include <linux/i2c-algo-bit.h>
+#include <linux/ktime.h>
 
 
 #include "amdgpu.h"
@@ -93,6 +95,7 @@
 
 #define INFENA 0x7203
 #define INFENA_AVIEN BIT(6)
+#define INFENA_AUDIEN BIT(4)
 
 #define AKESTA 0x7a84
 #define AKESTA_BUSY BIT(0)
@@ -109,6 +112,10 @@
 #define PCI_DEVICE_ID_CUH_2XXX 0x9923
 #define PCI_DEVICE_ID_CUH_7XXX 0x9924
 
+/* Max TMDS clock in kHz. Only the Pro wires the MN864729 for HDMI 2.0 */
+#define PS4_BRIDGE_MAX_CLOCK		148500
+#define PS4_BRIDGE_MAX_CLOCK_HDMI20	594000
+
 struct edid *drm_get_edid(struct drm_connector *connector,
  				 struct i2c_adapter *adapter);
 
@@ -119,13 +126,20 @@ struct i2c_cmd_hdr {
 	u8 count;
 } __packed;
 
+struct i2c_cmdreq {
+	u8 code;
+	u16 length;
+	u8 count;
+	u8 cmdbuf[0x7ec];
+} __packed;
+
+/* Queues are split after every wait so that a wait that times out only
+ * costs a replay of its own segment, not of the whole sequence. */
+#define CQ_MAX_SEGS	16
+#define CQ_SEG_TRIES	3
+
 struct i2c_cmdqueue {
-	struct {
-		u8 code;
-		u16 length;
-		u8 count;
-		u8 cmdbuf[0x7ec];
-	} __packed req;
+	struct i2c_cmdreq req;
 	struct {
 		u8 res1, res2;
 		u8 unk1, unk2;
@@ -135,6 +149,14 @@ struct i2c_cmdqueue {
 
 	u8 *p;
 	struct i2c_cmd_hdr *cmd;
+
+	/* End of each segment in req.cmdbuf and the command count up to it */
+	struct {
+		u8 *end;
+		u8 count;
+	} seg[CQ_MAX_SEGS];
+	int nseg;
+	struct i2c_cmdreq segreq;
 };
 
 struct ps4_bridge {
@@ -145,6 +167,32 @@ struct ps4_bridge {
 	struct mutex mutex;
 
 	int mode;
+
+	/* Last HPD state read from TMONREG. Once the EMC has pushed a bridge
+	 * event we trust it to push the next change too and stop reading
+	 * TMONREG on every connector poll. */
+	bool hpd;
+	bool hpd_valid;
+	bool hpd_events;
+	struct icc_event_listener hpd_listener;
+
+	/* Sink EDID, read once per connection and dropped on HPD changes */
+	struct edid *edid;
+
+	/* Set once a full enable went through, together with the DP link it
+	 * was done on. A modeset on the same link only retimes the bridge. */
+	bool programmed;
+	bool fast_switch;
+	int dp_clock;
+	int dp_lane_count;
+
+	/* Modeset timing, from pre_enable to the end of enable */
+	ktime_t enable_start;
+	u32 modesets;
+	u32 fast_modesets;
+	s64 last_us;
+	s64 max_us;
+	s64 total_us;
 };
 
 /* this should really be taken care of by the connector, but that is currently
@@ -159,6 +207,22 @@ static void cq_init(struct i2c_cmdqueue *q, u8 code)
 	q->req.count = 0;
 	q->p = q->req.cmdbuf;
 	q->cmd = NULL;
+	q->nseg = 0;
+}
+
+/* Close the current command and start a new segment after it */
+static void cq_segment_end(struct i2c_cmdqueue *q)
+{
+	if (q->cmd) {
+		q->cmd->length = q->p - (u8 *)q->cmd;
+		q->cmd = NULL;
+	}
+	/* Out of segments, grow the last one */
+	if (q->nseg == CQ_MAX_SEGS)
+		q->nseg--;
+	q->seg[q->nseg].end = q->p;
+	q->seg[q->nseg].count = q->req.count;
+	q->nseg++;
 }
 
 static void cq_cmd(struct i2c_cmdqueue *q, u8 major, u8 minor)
@@ -178,17 +242,11 @@ static void cq_cmd(struct i2c_cmdqueue *q, u8 major, u8 minor)
 	}
 }
 
-static int cq_exec(struct i2c_cmdqueue *q)
+static int cq_submit(struct i2c_cmdqueue *q, struct i2c_cmdreq *req)
 {
 	int res;
 
-	if (!q->cmd)
-		return 0;
-
-	q->cmd->length = q->p - (u8 *)q->cmd;
-	q->req.length = q->p - (u8 *)&q->req;
-
-	res = apcie_icc_cmd(0x10, 0, &q->req, q->req.length,
+	res = apcie_icc_cmd(0x10, 0, req, req->length,
 		      &q->reply, sizeof(q->reply));
 
 	if (res < 5) {
@@ -204,6 +262,65 @@ static int cq_exec(struct i2c_cmdqueue *q)
 	return res;
 }
 
+/* Run the queue one segment at a time, retrying only the segment that
+ * failed. The reply buffer holds the reply of the last segment, so reads
+ * should go in queues without waits. */
+static int cq_exec_segments(struct i2c_cmdqueue *q)
+{
+	u8 *start = q->req.cmdbuf;
+	u8 count = 0;
+	int i, try, res = 0;
+
+	/* Whatever follows the last wait is a segment of its own */
+	if (q->p != q->seg[q->nseg - 1].end)
+		cq_segment_end(q);
+
+	for (i = 0; i < q->nseg; i++) {
+		size_t len = q->seg[i].end - start;
+		ktime_t t0 = ktime_get();
+
+		q->segreq.code = q->req.code;
+		q->segreq.count = q->seg[i].count - count;
+		q->segreq.length = offsetof(struct i2c_cmdreq, cmdbuf) + len;
+		memcpy(q->segreq.cmdbuf, start, len);
+
+		for (try = 1; try <= CQ_SEG_TRIES; try++) {
+			res = cq_submit(q, &q->segreq);
+			if (res >= 0)
+				break;
+		}
+		DRM_DEBUG_KMS("icc i2c segment %d/%d: %lld us, %d tries\n",
+			      i + 1, q->nseg,
+			      ktime_us_delta(ktime_get(), t0),
+			      min(try, CQ_SEG_TRIES));
+		if (res < 0) {
+			DRM_ERROR("icc i2c segment %d/%d failed\n",
+				  i + 1, q->nseg);
+			return res;
+		}
+
+		start = q->seg[i].end;
+		count = q->seg[i].count;
+	}
+
+	return res;
+}
+
+static int cq_exec(struct i2c_cmdqueue *q)
+{
+	if (q->p == q->req.cmdbuf)
+		return 0;
+
+	if (q->cmd)
+		q->cmd->length = q->p - (u8 *)q->cmd;
+
+	if (q->nseg)
+		return cq_exec_segments(q);
+
+	q->req.length = q->p - (u8 *)&q->req;
+	return cq_submit(q, &q->req);
+}
+
 static void cq_read(struct i2c_cmdqueue *q, u16 addr, u8 count)
 {
 	cq_cmd(q, CMD_READ);
@@ -262,6 +379,7 @@ static void cq_wait_set(struct i2c_cmdqueue *q, u16 addr, u8 mask)
 	*q->p++ = addr >> 8;
 	*q->p++ = addr & 0xff;
 	*q->p++ = mask;
+	cq_segment_end(q);
 }
 
 static void cq_wait_clear(struct i2c_cmdqueue *q, u16 addr, u8 mask)
@@ -271,6 +389,7 @@ static void cq_wait_clear(struct i2c_cmdqueue *q, u16 addr, u8 mask)
 	*q->p++ = addr >> 8;
 	*q->p++ = addr & 0xff;
 	*q->p++ = mask;
+	cq_segment_end(q);
 }
 
 static inline struct ps4_bridge *
@@ -294,12 +413,26 @@ void ps4_bridge_mode_set(struct drm_bridge *bridge,
 	}
 }
 
-static void ps4_bridge_pre_enable(struct drm_bridge *bridge)
+static void __ps4_bridge_pre_enable(struct drm_bridge *bridge)
 {
 	struct ps4_bridge *mn_bridge = bridge_to_ps4_bridge(bridge);
+	struct amdgpu_connector *amdgpu_connector =
+		to_amdgpu_connector(mn_bridge->connector);
+	struct amdgpu_connector_atom_dig *dig = amdgpu_connector->con_priv;
 	DRM_DEBUG_KMS("ps4_bridge_pre_enable\n");
 	DRM_DEBUG("Enable ps4_bridge_pre_enable\n");
 	mutex_lock(&mn_bridge->mutex);
+
+	/* Same sink, same link: leave HDCP/AKE alone and just retime */
+	mn_bridge->fast_switch = mn_bridge->programmed &&
+				 dig->dp_clock == mn_bridge->dp_clock &&
+				 dig->dp_lane_count == mn_bridge->dp_lane_count;
+	if (mn_bridge->fast_switch) {
+		mutex_unlock(&mn_bridge->mutex);
+		return;
+	}
+	mn_bridge->programmed = false;
+
 	cq_init(&mn_bridge->cq, 4);
 
 #if 0
@@ -363,7 +496,55 @@ static void ps4_bridge_pre_enable(struct drm_bridge *bridge)
 	mutex_unlock(&mn_bridge->mutex);
 }
 
-static void ps4_bridge_enable(struct drm_bridge *bridge)
+/* Called with the bridge mutex held, on a bridge that went through a full
+ * enable on the current link. Only the VIC and the AVI InfoFrame change. */
+static int ps4_bridge_switch_mode(struct ps4_bridge *mn_bridge,
+				  struct pci_dev *pdev)
+{
+	cq_init(&mn_bridge->cq, 4);
+
+	if (pdev->device == PCI_DEVICE_ID_CUH_11XX) {
+		/* Panasonic MN86471A */
+		cq_writereg(&mn_bridge->cq, 0x7062, mn_bridge->mode);
+		cq_writereg(&mn_bridge->cq, 0x765a, 0);
+		cq_writereg(&mn_bridge->cq, 0x7062, mn_bridge->mode | 0x80);
+		cq_writereg(&mn_bridge->cq, 0x7217, mn_bridge->mode);
+		cq_writereg(&mn_bridge->cq, 0x7218, 0);
+		cq_writereg(&mn_bridge->cq, 0x7096, 0xff);
+		cq_writereg(&mn_bridge->cq, INFENA, INFENA_AVIEN | INFENA_AUDIEN);
+		cq_writereg(&mn_bridge->cq, UPDCTRL, UPDCTRL_ALLUPD | UPDCTRL_AVIIUPD |
+						     UPDCTRL_CLKUPD | UPDCTRL_VIFUPD |
+						     UPDCTRL_CSCUPD);
+		cq_wait_set(&mn_bridge->cq, 0x7096, 0x80);
+	} else {
+		/* Panasonic MN864729 */
+		cq_writereg(&mn_bridge->cq, 0x7227, mn_bridge->mode);
+		cq_writereg(&mn_bridge->cq, 0x7228, 0x00);
+		cq_writereg(&mn_bridge->cq, 0x7070, mn_bridge->mode);
+		cq_writereg(&mn_bridge->cq, 0x7071, mn_bridge->mode | 0x80);
+		cq_writereg(&mn_bridge->cq, 0x10f6, 0xff);
+		cq_writereg(&mn_bridge->cq, INFENA, 0x60 | INFENA_AUDIEN);
+		cq_writereg(&mn_bridge->cq, 0x7011, 0xd5);
+		cq_wait_set(&mn_bridge->cq, 0x10f6, 0x80);
+	}
+	cq_writereg(&mn_bridge->cq, VMUTECNT, VMUTECNT_LINEWIDTH_90);
+
+	return cq_exec(&mn_bridge->cq) < 0 ? -EIO : 0;
+}
+
+/* Called with the bridge mutex held */
+static void ps4_bridge_set_programmed(struct ps4_bridge *mn_bridge)
+{
+	struct amdgpu_connector *amdgpu_connector =
+		to_amdgpu_connector(mn_bridge->connector);
+	struct amdgpu_connector_atom_dig *dig = amdgpu_connector->con_priv;
+
+	mn_bridge->dp_clock = dig->dp_clock;
+	mn_bridge->dp_lane_count = dig->dp_lane_count;
+	mn_bridge->programmed = true;
+}
+
+static void __ps4_bridge_enable(struct drm_bridge *bridge)
 {
 	struct ps4_bridge *mn_bridge = bridge_to_ps4_bridge(bridge);
 	struct drm_connector *connector = mn_bridge->connector;
@@ -383,6 +564,19 @@ static void ps4_bridge_enable(struct drm_bridge *bridge)
 
 	DRM_DEBUG_KMS("ps4_bridge_enable (mode: %d)\n", mn_bridge->mode);
 
+	if (mn_bridge->fast_switch) {
+		mutex_lock(&mn_bridge->mutex);
+		mn_bridge->fast_switch = false;
+		if (!ps4_bridge_switch_mode(mn_bridge, pdev)) {
+			mutex_unlock(&mn_bridge->mutex);
+			return;
+		}
+		/* Fall back to the full sequence */
+		DRM_ERROR("fast mode switch failed, reinitializing bridge\n");
+		mn_bridge->programmed = false;
+		mutex_unlock(&mn_bridge->mutex);
+	}
+
 	/* Here come the dragons */
 
 	if(pdev->device == PCI_DEVICE_ID_CUH_11XX)
@@ -458,6 +652,8 @@ static void ps4_bridge_enable(struct drm_bridge *bridge)
 		cq_writereg(&mn_bridge->cq, VMUTECNT, VMUTECNT_LINEWIDTH_90);
 		if (cq_exec(&mn_bridge->cq) < 0) {
 			DRM_ERROR("Failed to configure ps4-bridge (MN86471A) mode\n");
+		} else {
+			ps4_bridge_set_programmed(mn_bridge);
 		}
 		#if 1
 		// preinit
@@ -576,6 +772,8 @@ static void ps4_bridge_enable(struct drm_bridge *bridge)
 		cq_writereg(&mn_bridge->cq, HDCPEN, 0x00);
 		if (cq_exec(&mn_bridge->cq) < 0) {
 			DRM_ERROR("Failed to configure ps4-bridge (MN864729) mode\n");
+		} else {
+			ps4_bridge_set_programmed(mn_bridge);
 		}
 		#if 1
 		// AUDIO preinit
@@ -623,6 +821,32 @@ static void ps4_bridge_enable(struct drm_bridge *bridge)
 
 }
 
+static void ps4_bridge_pre_enable(struct drm_bridge *bridge)
+{
+	struct ps4_bridge *mn_bridge = bridge_to_ps4_bridge(bridge);
+
+	mn_bridge->enable_start = ktime_get();
+	__ps4_bridge_pre_enable(bridge);
+}
+
+static void ps4_bridge_enable(struct drm_bridge *bridge)
+{
+	struct ps4_bridge *mn_bridge = bridge_to_ps4_bridge(bridge);
+	s64 us;
+
+	__ps4_bridge_enable(bridge);
+
+	us = ktime_us_delta(ktime_get(), mn_bridge->enable_start);
+	mutex_lock(&mn_bridge->mutex);
+	mn_bridge->modesets++;
+	if (mn_bridge->fast_switch)
+		mn_bridge->fast_modesets++;
+	mn_bridge->last_us = us;
+	mn_bridge->max_us = max(mn_bridge->max_us, us);
+	mn_bridge->total_us += us;
+	mutex_unlock(&mn_bridge->mutex);
+}
+
 static void ps4_bridge_disable(struct drm_bridge *bridge)
 {
 	struct ps4_bridge *mn_bridge = bridge_to_ps4_bridge(bridge);
@@ -669,30 +893,108 @@ static const struct drm_display_mode mode_1080p = {
 	.vrefresh = 60, .picture_aspect_ratio = HDMI_PICTURE_ASPECT_16_9
 };
 
+/* Called with the bridge mutex held */
+static void ps4_bridge_forget_sink(struct ps4_bridge *mn_bridge)
+{
+	kfree(mn_bridge->edid);
+	mn_bridge->edid = NULL;
+	/* A new sink needs the full enable sequence again */
+	mn_bridge->programmed = false;
+}
+
 int ps4_bridge_get_modes(struct drm_connector *connector)
 {
+	struct ps4_bridge *mn_bridge = &g_bridge;
+	struct amdgpu_connector *amdgpu_connector = to_amdgpu_connector(connector);
 	struct drm_device *dev = connector->dev;
 	struct drm_display_mode *newmode;
+	int count = 0;
 	DRM_DEBUG_KMS("ps4_bridge_get_modes\n");
 
-	newmode = drm_mode_duplicate(dev, &mode_1080p);
-	drm_mode_probed_add(connector, newmode);
+	mutex_lock(&mn_bridge->mutex);
+	/* The bridge forwards I2C-over-AUX to the HDMI DDC lines */
+	if (!mn_bridge->edid && amdgpu_connector->ddc_bus &&
+	    amdgpu_connector->ddc_bus->has_aux)
+		mn_bridge->edid = drm_get_edid(connector,
+					&amdgpu_connector->ddc_bus->aux.ddc);
+
+	drm_connector_update_edid_property(connector, mn_bridge->edid);
+	/* The audio SADs/ELD are built from this copy, keep it in sync */
+	kfree(amdgpu_connector->edid);
+	amdgpu_connector->edid = NULL;
+	if (mn_bridge->edid)
+		count = drm_add_edid_modes(connector, mn_bridge->edid);
+	mutex_unlock(&mn_bridge->mutex);
+
+	if (!count) {
+		newmode = drm_mode_duplicate(dev, &mode_1080p);
+		if (newmode) {
+			drm_mode_probed_add(connector, newmode);
+			count = 1;
+		}
+	}
 
 	//newmode = drm_mode_duplicate(dev, &mode_720p);
 	//drm_mode_probed_add(connector, newmode);
 	//newmode = drm_mode_duplicate(dev, &mode_480p);
 	//drm_mode_probed_add(connector, newmode);
 
-	drm_connector_update_edid_property(connector, NULL);
-    
+	return count;
+}
+
+/* Called with the bridge mutex held */
+static int ps4_bridge_read_hpd(struct ps4_bridge *mn_bridge)
+{
+	u8 reg;
+
+	cq_init(&mn_bridge->cq, 4);
+	cq_read(&mn_bridge->cq, TMONREG, 1);
+	if (cq_exec(&mn_bridge->cq) < 9) {
+		DRM_ERROR("could not read TMONREG");
+		mn_bridge->hpd_valid = false;
+		return -EIO;
+	}
+	reg = mn_bridge->cq.reply.databuf[3];
+	DRM_DEBUG_KMS("TMONREG=0x%02x\n", reg);
+
+	mn_bridge->hpd = !!(reg & TMONREG_HPD);
+	mn_bridge->hpd_valid = true;
 	return 0;
 }
 
+/* The EMC event ids for HPD are not documented, so any event of the
+ * bridge's ICC service makes us re-read TMONREG. */
+#define PS4_BRIDGE_ICC_SERVICE 0x10
+
+static void ps4_bridge_hpd_event(struct icc_event_listener *l, u8 major,
+				 u16 minor, const void *data, u16 length)
+{
+	struct ps4_bridge *mn_bridge = container_of(l, struct ps4_bridge,
+						    hpd_listener);
+	bool was_valid, old, changed;
+
+	mutex_lock(&mn_bridge->mutex);
+	was_valid = mn_bridge->hpd_valid;
+	old = mn_bridge->hpd;
+	if (ps4_bridge_read_hpd(mn_bridge)) {
+		mutex_unlock(&mn_bridge->mutex);
+		return;
+	}
+	mn_bridge->hpd_events = true;
+	changed = !was_valid || mn_bridge->hpd != old;
+	if (changed)
+		ps4_bridge_forget_sink(mn_bridge);
+	mutex_unlock(&mn_bridge->mutex);
+
+	if (changed && mn_bridge->connector)
+		drm_kms_helper_hotplug_event(mn_bridge->connector->dev);
+}
+
 enum drm_connector_status ps4_bridge_detect(struct drm_connector *connector,
 		bool force)
 {
 	struct ps4_bridge *mn_bridge = &g_bridge;
-	u8 reg;
+	bool hpd;
 
 	struct amdgpu_connector *amdgpu_connector = to_amdgpu_connector(connector);
 	struct amdgpu_connector_atom_dig *amdgpu_dig_connector = amdgpu_connector->con_priv;
@@ -701,19 +1003,23 @@ enum drm_connector_status ps4_bridge_detect(struct drm_connector *connector,
 	amdgpu_atombios_dp_get_dpcd(amdgpu_connector);
 
 	mutex_lock(&mn_bridge->mutex);
-	cq_init(&mn_bridge->cq, 4);
-	cq_read(&mn_bridge->cq, TMONREG, 1);
-	if (cq_exec(&mn_bridge->cq) < 9) {
-		mutex_unlock(&mn_bridge->mutex);
-		DRM_ERROR("could not read TMONREG");
-		return connector_status_disconnected;
+	if (force || !mn_bridge->hpd_events || !mn_bridge->hpd_valid) {
+		bool old = mn_bridge->hpd;
+
+		if (ps4_bridge_read_hpd(mn_bridge)) {
+			ps4_bridge_forget_sink(mn_bridge);
+			mutex_unlock(&mn_bridge->mutex);
+			return connector_status_disconnected;
+		}
+		if (mn_bridge->hpd != old)
+			ps4_bridge_forget_sink(mn_bridge);
 	}
-	reg = mn_bridge->cq.reply.databuf[3];
+	hpd = mn_bridge->hpd;
+	if (!hpd)
+		ps4_bridge_forget_sink(mn_bridge);
 	mutex_unlock(&mn_bridge->mutex);
 
-	DRM_DEBUG_KMS("TMONREG=0x%02x\n", reg);
-
-	if (reg & TMONREG_HPD)
+	if (hpd)
 		return connector_status_connected;
 	else
 		return connector_status_disconnected;
@@ -722,12 +1028,26 @@ enum drm_connector_status ps4_bridge_detect(struct drm_connector *connector,
 int ps4_bridge_mode_valid(struct drm_connector *connector,
 				  struct drm_display_mode *mode)
 {
+	struct pci_dev *pdev = connector->dev->pdev;
 	int vic = drm_match_cea_mode(mode);
+	int max_clock = PS4_BRIDGE_MAX_CLOCK;
 
-	/* Allow anything that we can match up to a VIC (CEA modes) */
-	if (!vic || (vic != 16 && vic != 4)) {
+	/* The bridge is programmed with a VIC, so only CEA modes work */
+	if (!vic)
 		return MODE_BAD;
-	}
+
+	if (mode->flags & DRM_MODE_FLAG_INTERLACE)
+		return MODE_NO_INTERLACE;
+
+	if (pdev->device == PCI_DEVICE_ID_CUH_7XXX)
+		max_clock = PS4_BRIDGE_MAX_CLOCK_HDMI20;
+	if (mode->clock > max_clock)
+		return MODE_CLOCK_HIGH;
+
+	/* And whatever the sink claims it can take */
+	if (connector->display_info.max_tmds_clock &&
+	    mode->clock > connector->display_info.max_tmds_clock)
+		return MODE_CLOCK_HIGH;
 
 	return MODE_OK;
 }
@@ -748,6 +1068,26 @@ static struct drm_bridge_funcs ps4_bridge_funcs = {
 	.mode_set = ps4_bridge_mode_set,
 };
 
+#if defined(CONFIG_DEBUG_FS)
+static int ps4_bridge_debugfs_modeset(struct seq_file *m, void *data)
+{
+	struct ps4_bridge *mn_bridge = &g_bridge;
+
+	mutex_lock(&mn_bridge->mutex);
+	seq_printf(m, "modesets %u\n", mn_bridge->modesets);
+	seq_printf(m, "fast_modesets %u\n", mn_bridge->fast_modesets);
+	seq_printf(m, "last_us %lld\n", mn_bridge->last_us);
+	seq_printf(m, "max_us %lld\n", mn_bridge->max_us);
+	seq_printf(m, "total_us %lld\n", mn_bridge->total_us);
+	mutex_unlock(&mn_bridge->mutex);
+	return 0;
+}
+
+static const struct drm_info_list ps4_bridge_debugfs_list[] = {
+	{"ps4_bridge_modeset", ps4_bridge_debugfs_modeset, 0, NULL},
+};
+#endif
+
 int ps4_bridge_register(struct drm_connector *connector,
 			     struct drm_encoder *encoder)
 {
@@ -765,5 +1105,20 @@ int ps4_bridge_register(struct drm_connector *connector,
 
 	encoder->bridge = &mn_bridge->bridge;
 
+	if (!mn_bridge->hpd_listener.handler) {
+		mn_bridge->hpd_listener.major = PS4_BRIDGE_ICC_SERVICE;
+		mn_bridge->hpd_listener.minor_first = 0x8000;
+		mn_bridge->hpd_listener.minor_last = 0xffff;
+		mn_bridge->hpd_listener.handler = ps4_bridge_hpd_event;
+		if (apcie_icc_register_event(&mn_bridge->hpd_listener))
+			mn_bridge->hpd_listener.handler = NULL;
+	}
+
+#if defined(CONFIG_DEBUG_FS)
+	amdgpu_debugfs_add_files(connector->dev->dev_private,
+				 ps4_bridge_debugfs_list,
+				 ARRAY_SIZE(ps4_bridge_debugfs_list));
+#endif
+
 	return 0;
 }
@@ -1282,6 +1282,13 @@ static int kfd_ioctl_alloc_memory_of_gpu(struct file *filep,
 			return -ENOMEM;
 	}
 
+	/* Mirrors are userptrs at the same GPU and CPU address */
+	if ((flags & KFD_IOC_ALLOC_MEM_FLAGS_MIRROR) &&
+	    (!(flags & KFD_IOC_ALLOC_MEM_FLAGS_USERPTR) ||
+	     args->va_addr != offset ||
+	     !PAGE_ALIGNED(args->va_addr | args->size)))
+		return -EINVAL;
+
 	mutex_lock(&p->mutex);
 
 	pdd = kfd_bind_process_to_device(dev, p);
@@ -1290,6 +1297,16 @@ static int kfd_ioctl_alloc_memory_of_gpu(struct file *filep,
 		goto err_unlock;
 	}
 
+	if ((flags & KFD_IOC_ALLOC_MEM_FLAGS_MIRROR) &&
+	    (args->va_addr < pdd->gpuvm_base ||
+	     args->va_addr > pdd->gpuvm_limit ||
+	     args->size - 1 > pdd->gpuvm_limit - args->va_addr)) {
+		pr_debug("Mirror 0x%llx-0x%llx outside of the GPUVM aperture\n",
+			 args->va_addr, args->va_addr + args->size - 1);
+		err = -ERANGE;
+		goto err_unlock;
+	}
+
 	err = amdgpu_amdkfd_gpuvm_alloc_memory_of_gpu(
 		dev->kgd, args->va_addr, args->size,
 		pdd->vm, (struct kgd_mem **) &mem, &offset,
@@ -1304,8 +1321,22 @@ static int kfd_ioctl_alloc_memory_of_gpu(struct file *filep,
 		goto err_free;
 	}
 
+	if (flags & KFD_IOC_ALLOC_MEM_FLAGS_MIRROR) {
+		err = amdgpu_amdkfd_gpuvm_map_memory_to_gpu(dev->kgd,
+				(struct kgd_mem *)mem, pdd->vm);
+		if (err)
+			goto err_remove_handle;
+	}
+
 	mutex_unlock(&p->mutex);
 
+	if (flags & KFD_IOC_ALLOC_MEM_FLAGS_MIRROR) {
+		/* Uninterruptible, the handle can't be handed back half done */
+		amdgpu_amdkfd_gpuvm_sync_memory(dev->kgd, (struct kgd_mem *)mem,
+						false);
+		kfd_flush_tlb(pdd);
+	}
+
 	args->handle = MAKE_HANDLE(args->gpu_id, idr_handle);
 	args->mmap_offset = offset;
 
@@ -1319,6 +1350,8 @@ static int kfd_ioctl_alloc_memory_of_gpu(struct file *filep,
 
 	return 0;
 
+err_remove_handle:
+	kfd_process_device_remove_obj_handle(pdd, idr_handle);
 err_free:
 	amdgpu_amdkfd_gpuvm_free_memory_of_gpu(dev->kgd, (struct kgd_mem *)mem);
 err_unlock:
@@ -129,6 +129,7 @@ static struct kfd_gpu_cache_info carrizo_cache_info[] = {
  * the following ASICs may need a separate table.
  */
 #define hawaii_cache_info kaveri_cache_info
+#define liverpool_cache_info kaveri_cache_info
 #define tonga_cache_info carrizo_cache_info
 #define fiji_cache_info  carrizo_cache_info
 #define polaris10_cache_info carrizo_cache_info
@@ -631,6 +632,11 @@ static int kfd_fill_gpu_cache_info(struct kfd_dev *kdev,
 		pcache_info = hawaii_cache_info;
 		num_of_cache_types = ARRAY_SIZE(hawaii_cache_info);
 		break;
+	case CHIP_LIVERPOOL:
+	case CHIP_GLADIUS:
+		pcache_info = liverpool_cache_info;
+		num_of_cache_types = ARRAY_SIZE(liverpool_cache_info);
+		break;
 	case CHIP_CARRIZO:
 		pcache_info = carrizo_cache_info;
 		num_of_cache_types = ARRAY_SIZE(carrizo_cache_info);
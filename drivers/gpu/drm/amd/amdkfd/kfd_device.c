@@ -117,6 +117,43 @@ static const struct kfd_device_info hawaii_device_info = {
 	.num_sdma_queues_per_engine = 2,
 };
 
+/* The PS4 APUs have no IOMMUv2, so they run KFD through GPUVM like Hawaii */
+static const struct kfd_device_info liverpool_device_info = {
+	.asic_family = CHIP_LIVERPOOL,
+	.asic_name = "liverpool",
+	.max_pasid_bits = 16,
+	.max_no_of_hqd	= 24,
+	.doorbell_size  = 4,
+	.ih_ring_entry_size = 4 * sizeof(uint32_t),
+	.event_interrupt_class = &event_interrupt_class_cik,
+	.num_of_watch_points = 4,
+	.mqd_size_aligned = MQD_SIZE_ALIGNED,
+	.supports_cwsr = false,
+	.needs_iommu_device = false,
+	.needs_pci_atomics = false,
+	.num_sdma_engines = 2,
+	.num_xgmi_sdma_engines = 0,
+	.num_sdma_queues_per_engine = 2,
+};
+
+static const struct kfd_device_info gladius_device_info = {
+	.asic_family = CHIP_GLADIUS,
+	.asic_name = "gladius",
+	.max_pasid_bits = 16,
+	.max_no_of_hqd	= 24,
+	.doorbell_size  = 4,
+	.ih_ring_entry_size = 4 * sizeof(uint32_t),
+	.event_interrupt_class = &event_interrupt_class_cik,
+	.num_of_watch_points = 4,
+	.mqd_size_aligned = MQD_SIZE_ALIGNED,
+	.supports_cwsr = false,
+	.needs_iommu_device = false,
+	.needs_pci_atomics = false,
+	.num_sdma_engines = 2,
+	.num_xgmi_sdma_engines = 0,
+	.num_sdma_queues_per_engine = 2,
+};
+
 static const struct kfd_device_info tonga_device_info = {
 	.asic_family = CHIP_TONGA,
 	.asic_name = "tonga",
@@ -407,10 +444,10 @@ static const struct kfd_deviceid supported_devices[] = {
 	{ 0x15DD, &raven_device_info },		/* Raven */
 	{ 0x15D8, &raven_device_info },		/* Raven */
 #endif
-        { 0x9920, &polaris10_device_info },             /* Liverpool */
-        { 0x9922, &polaris10_device_info },             /* Liverpool */
-        { 0x9923, &polaris10_device_info },             /* Liverpool */
-        { 0x9924, &polaris10_device_info },               /* Gladius */
+	{ 0x9920, &liverpool_device_info },	/* Liverpool */
+	{ 0x9922, &liverpool_device_info },	/* Liverpool */
+	{ 0x9923, &liverpool_device_info },	/* Liverpool */
+	{ 0x9924, &gladius_device_info },	/* Gladius */
 	{ 0x67A0, &hawaii_device_info },	/* Hawaii */
 	{ 0x67A1, &hawaii_device_info },	/* Hawaii */
 	{ 0x67A2, &hawaii_device_info },	/* Hawaii */
@@ -251,7 +251,9 @@ static void deallocate_vmid(struct device_queue_manager *dqm,
 	int bit = qpd->vmid - dqm->dev->vm_info.first_vmid_kfd;
 
 	/* On GFX v7, CP doesn't flush TC at dequeue */
-	if (q->device->device_info->asic_family == CHIP_HAWAII)
+	if (q->device->device_info->asic_family == CHIP_HAWAII ||
+	    q->device->device_info->asic_family == CHIP_LIVERPOOL ||
+	    q->device->device_info->asic_family == CHIP_GLADIUS)
 		if (flush_texture_cache_nocpsch(q->device, qpd))
 			pr_err("Failed to flush TC\n");
 
@@ -1720,6 +1722,9 @@ struct device_queue_manager *device_queue_manager_init(struct kfd_dev *dev)
 	switch (dev->device_info->asic_family) {
 	/* HWS is not available on Hawaii. */
 	case CHIP_HAWAII:
+	/* Nor in the PS4 MEC firmware. */
+	case CHIP_LIVERPOOL:
+	case CHIP_GLADIUS:
 	/* HWS depends on CWSR for timely dequeue. CWSR is not
 	 * available on Tonga.
 	 *
@@ -1790,6 +1795,8 @@ struct device_queue_manager *device_queue_manager_init(struct kfd_dev *dev)
 		break;
 
 	case CHIP_HAWAII:
+	case CHIP_LIVERPOOL:
+	case CHIP_GLADIUS:
 		device_queue_manager_init_cik_hawaii(&dqm->asic_ops);
 		break;
 
@@ -392,6 +392,8 @@ int kfd_init_apertures(struct kfd_process *process)
 			switch (dev->device_info->asic_family) {
 			case CHIP_KAVERI:
 			case CHIP_HAWAII:
+			case CHIP_LIVERPOOL:
+			case CHIP_GLADIUS:
 			case CHIP_CARRIZO:
 			case CHIP_TONGA:
 			case CHIP_FIJI:
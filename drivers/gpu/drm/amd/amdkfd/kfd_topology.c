@@ -505,6 +505,8 @@ static ssize_t node_show(struct kobject *kobj, struct attribute *attr,
 				dev->node_props.capability);
 		sysfs_show_32bit_prop(buffer, "sdma_fw_version",
 				dev->gpu->sdma_fw_version);
+		/* KFD_IOC_ALLOC_MEM_FLAGS_MIRROR is accepted */
+		sysfs_show_32bit_prop(buffer, "mirror_alloc", 1);
 	}
 
 	return sysfs_show_32bit_prop(buffer, "max_engine_clk_ccompute",
@@ -1307,6 +1309,8 @@ int kfd_topology_add_device(struct kfd_dev *gpu)
 	switch (dev->gpu->device_info->asic_family) {
 	case CHIP_KAVERI:
 	case CHIP_HAWAII:
+	case CHIP_LIVERPOOL:
+	case CHIP_GLADIUS:
 	case CHIP_TONGA:
 		dev->node_props.capability |= ((HSA_CAP_DOORBELL_TYPE_PRE_1_0 <<
 			HSA_CAP_DOORBELL_TYPE_TOTALBITS_SHIFT) &
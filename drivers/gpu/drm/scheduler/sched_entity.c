@@ -28,6 +28,7 @@
 #include <drm/gpu_scheduler.h>
 
 #include "gpu_scheduler_trace.h"
+#include "sched_internal.h"
 
 #define to_drm_sched_job(sched_job)		\
 		container_of((sched_job), struct drm_sched_job, queue_node)
@@ -241,6 +242,8 @@ static void drm_sched_entity_kill_jobs(struct drm_sched_entity *entity)
 	while ((job = to_drm_sched_job(spsc_queue_pop(&entity->job_queue)))) {
 		struct drm_sched_fence *s_fence = job->s_fence;
 
+		atomic_dec(&job->sched->num_queued);
+
 		/* Wait for all dependencies to avoid data corruptions */
 		while ((f = job->sched->ops->dependency(job, entity)))
 			dma_fence_wait(f, false);
@@ -475,6 +478,7 @@ struct drm_sched_job *drm_sched_entity_pop_job(struct drm_sched_entity *entity)
 	entity->last_scheduled = dma_fence_get(&sched_job->s_fence->finished);
 
 	spsc_queue_pop(&entity->job_queue);
+	atomic_dec(&sched->num_queued);
 	return sched_job;
 }
 
@@ -527,6 +531,7 @@ void drm_sched_entity_push_job(struct drm_sched_job *sched_job,
 
 	trace_drm_sched_job(sched_job, entity);
 	atomic_inc(&entity->rq->sched->num_jobs);
+	atomic_inc(&entity->rq->sched->num_queued);
 	WRITE_ONCE(entity->last_user, current->group_leader);
 	first = spsc_queue_push(&entity->job_queue, &sched_job->queue_node);
 
@@ -546,3 +551,63 @@ void drm_sched_entity_push_job(struct drm_sched_job *sched_job,
 	}
 }
 EXPORT_SYMBOL(drm_sched_entity_push_job);
+
+/**
+ * drm_sched_entity_push_job_direct - Run a job from the submitting thread
+ *
+ * @sched_job: job to submit
+ * @entity: scheduler entity
+ *
+ * Like drm_sched_entity_push_job(), but if the scheduler thread is idle, no
+ * job of any entity is waiting, the hardware ring has room and all of the
+ * job's dependencies have signaled, the job goes to the hardware right away.
+ * That spares the wakeup of and the switch to the scheduler thread. In every
+ * other case the job is queued as usual, and an unsignaled dependency found
+ * here is waited for just as drm_sched_entity_pop_job() would.
+ *
+ * Returns true if the job was run directly.
+ */
+bool drm_sched_entity_push_job_direct(struct drm_sched_job *sched_job,
+				      struct drm_sched_entity *entity)
+{
+	struct drm_gpu_scheduler *sched = entity->rq->sched;
+
+	if (!mutex_trylock(&sched->run_lock))
+		goto queue;
+
+	if (!sched->ready || __kthread_should_park(sched->thread) ||
+	    atomic_read(&sched->hw_rq_count) >= sched->hw_submission_limit ||
+	    atomic_read(&sched->num_queued) ||
+	    spsc_queue_count(&entity->job_queue) || READ_ONCE(entity->stopped))
+		goto unlock;
+
+	while ((entity->dependency =
+			sched->ops->dependency(sched_job, entity))) {
+		trace_drm_sched_job_wait_dep(sched_job, entity->dependency);
+
+		if (drm_sched_entity_add_dependency_cb(entity))
+			goto unlock;
+	}
+
+	trace_drm_sched_job(sched_job, entity);
+	atomic_inc(&sched->num_jobs);
+	WRITE_ONCE(entity->last_user, current->group_leader);
+
+	/* skip jobs from entity that marked guilty */
+	if (entity->guilty && atomic_read(entity->guilty))
+		dma_fence_set_error(&sched_job->s_fence->finished, -ECANCELED);
+
+	dma_fence_put(entity->last_scheduled);
+	entity->last_scheduled = dma_fence_get(&sched_job->s_fence->finished);
+
+	drm_sched_run_job(sched, sched_job);
+	mutex_unlock(&sched->run_lock);
+	return true;
+
+unlock:
+	mutex_unlock(&sched->run_lock);
+queue:
+	drm_sched_entity_push_job(sched_job, entity);
+	return false;
+}
+EXPORT_SYMBOL(drm_sched_entity_push_job_direct);
@@ -0,0 +1,12 @@
+/* SPDX-License-Identifier: MIT */
+
+#ifndef _DRM_GPU_SCHEDULER_INTERNAL_H_
+#define _DRM_GPU_SCHEDULER_INTERNAL_H_
+
+struct drm_gpu_scheduler;
+struct drm_sched_job;
+
+void drm_sched_run_job(struct drm_gpu_scheduler *sched,
+		       struct drm_sched_job *sched_job);
+
+#endif
@@ -42,9 +42,16 @@
  *    the hardware.
  *
  * The jobs in a entity are always scheduled in the order that they were pushed.
+ *
+ * Within a run queue the ready entity whose next job has the earliest deadline
+ * is picked, ties are broken round robin. Jobs without an explicit deadline
+ * get an implicit one of deadline_slack_ms after submission, so that
+ * background work still overtakes frame paced jobs once it has waited long
+ * enough.
  */
 
 #include <linux/kthread.h>
+#include <linux/module.h>
 #include <linux/wait.h>
 #include <linux/sched.h>
 #include <uapi/linux/sched/types.h>
@@ -55,6 +62,12 @@
 
 #define CREATE_TRACE_POINTS
 #include "gpu_scheduler_trace.h"
+#include "sched_internal.h"
+
+static unsigned int drm_sched_deadline_slack_ms = 100;
+module_param_named(deadline_slack_ms, drm_sched_deadline_slack_ms, uint, 0644);
+MODULE_PARM_DESC(deadline_slack_ms,
+		 "Implicit deadline of jobs without one, in ms after submission (default 100)");
 
 #define to_drm_sched_job(sched_job)		\
 		container_of((sched_job), struct drm_sched_job, queue_node)
@@ -115,27 +128,46 @@ void drm_sched_rq_remove_entity(struct drm_sched_rq *rq,
 	spin_unlock(&rq->lock);
 }
 
+/**
+ * drm_sched_entity_deadline - Deadline of the next job of an entity
+ *
+ * @entity: entity known to be ready
+ */
+static ktime_t drm_sched_entity_deadline(struct drm_sched_entity *entity)
+{
+	struct drm_sched_job *job;
+
+	job = to_drm_sched_job(spsc_queue_peek(&entity->job_queue));
+	return job ? job->deadline : KTIME_MAX;
+}
+
 /**
  * drm_sched_rq_select_entity - Select an entity which could provide a job to run
  *
  * @rq: scheduler run queue to check.
  *
- * Try to find a ready entity, returns NULL if none found.
+ * Try to find the ready entity whose next job has the earliest deadline,
+ * starting after the current entity so that ties are served round robin.
+ * Returns NULL if none found.
  */
 static struct drm_sched_entity *
 drm_sched_rq_select_entity(struct drm_sched_rq *rq)
 {
-	struct drm_sched_entity *entity;
+	struct drm_sched_entity *entity, *best = NULL;
+	ktime_t deadline, best_deadline = KTIME_MAX;
 
 	spin_lock(&rq->lock);
 
 	entity = rq->current_entity;
 	if (entity) {
 		list_for_each_entry_continue(entity, &rq->entities, list) {
-			if (drm_sched_entity_is_ready(entity)) {
-				rq->current_entity = entity;
-				spin_unlock(&rq->lock);
-				return entity;
+			if (!drm_sched_entity_is_ready(entity))
+				continue;
+
+			deadline = drm_sched_entity_deadline(entity);
+			if (!best || ktime_before(deadline, best_deadline)) {
+				best = entity;
+				best_deadline = deadline;
 			}
 		}
 	}
@@ -143,18 +175,23 @@ drm_sched_rq_select_entity(struct drm_sched_rq *rq)
 	list_for_each_entry(entity, &rq->entities, list) {
 
 		if (drm_sched_entity_is_ready(entity)) {
-			rq->current_entity = entity;
-			spin_unlock(&rq->lock);
-			return entity;
+			deadline = drm_sched_entity_deadline(entity);
+			if (!best || ktime_before(deadline, best_deadline)) {
+				best = entity;
+				best_deadline = deadline;
+			}
 		}
 
 		if (entity == rq->current_entity)
 			break;
 	}
 
+	if (best)
+		rq->current_entity = best;
+
 	spin_unlock(&rq->lock);
 
-	return NULL;
+	return best;
 }
 
 /**
@@ -381,6 +418,9 @@ void drm_sched_stop(struct drm_gpu_scheduler *sched, struct drm_sched_job *bad)
 	unsigned long flags;
 
 	kthread_park(sched->thread);
+	/* Wait for a direct submission, later ones see the thread parked */
+	mutex_lock(&sched->run_lock);
+	mutex_unlock(&sched->run_lock);
 
 	/*
 	 * Reinsert back the bad job here - now it's safe as
@@ -567,6 +607,8 @@ int drm_sched_job_init(struct drm_sched_job *job,
 	if (!job->s_fence)
 		return -ENOMEM;
 	job->id = atomic64_inc_return(&sched->job_id_count);
+	job->deadline = ktime_add_ms(ktime_get(),
+				     READ_ONCE(drm_sched_deadline_slack_ms));
 
 	INIT_LIST_HEAD(&job->node);
 
@@ -574,6 +616,23 @@ int drm_sched_job_init(struct drm_sched_job *job,
 }
 EXPORT_SYMBOL(drm_sched_job_init);
 
+/**
+ * drm_sched_job_set_deadline - set the completion deadline of a job
+ *
+ * @job: scheduler job initialized with drm_sched_job_init()
+ * @deadline: CLOCK_MONOTONIC time by which the job should have completed
+ *
+ * Deadlines in the past are clamped to the current time, otherwise a client
+ * could keep every other entity of its run queue waiting forever.
+ */
+void drm_sched_job_set_deadline(struct drm_sched_job *job, ktime_t deadline)
+{
+	ktime_t now = ktime_get();
+
+	job->deadline = ktime_before(deadline, now) ? now : deadline;
+}
+EXPORT_SYMBOL(drm_sched_job_set_deadline);
+
 /**
  * drm_sched_job_cleanup - clean up scheduler job resources
  *
@@ -717,6 +776,49 @@ static bool drm_sched_blocked(struct drm_gpu_scheduler *sched)
 	return false;
 }
 
+/**
+ * drm_sched_run_job - hand a job to the hardware
+ *
+ * @sched: scheduler instance
+ * @sched_job: job taken off its entity, or pushed directly
+ *
+ * Called with @sched->run_lock held.
+ */
+void drm_sched_run_job(struct drm_gpu_scheduler *sched,
+		       struct drm_sched_job *sched_job)
+{
+	struct drm_sched_fence *s_fence = sched_job->s_fence;
+	struct dma_fence *fence;
+	int r;
+
+	lockdep_assert_held(&sched->run_lock);
+
+	atomic_inc(&sched->hw_rq_count);
+	drm_sched_job_begin(sched_job);
+
+	fence = sched->ops->run_job(sched_job);
+	drm_sched_fence_scheduled(s_fence);
+
+	if (!IS_ERR_OR_NULL(fence)) {
+		s_fence->parent = dma_fence_get(fence);
+		r = dma_fence_add_callback(fence, &sched_job->cb,
+					   drm_sched_process_job);
+		if (r == -ENOENT)
+			drm_sched_process_job(fence, &sched_job->cb);
+		else if (r)
+			DRM_ERROR("fence add callback failed (%d)\n",
+				  r);
+		dma_fence_put(fence);
+	} else {
+		if (IS_ERR(fence))
+			dma_fence_set_error(&s_fence->finished, PTR_ERR(fence));
+
+		drm_sched_process_job(NULL, &sched_job->cb);
+	}
+
+	wake_up(&sched->job_scheduled);
+}
+
 /**
  * drm_sched_main - main scheduler thread
  *
@@ -728,15 +830,12 @@ static int drm_sched_main(void *param)
 {
 	struct sched_param sparam = {.sched_priority = 1};
 	struct drm_gpu_scheduler *sched = (struct drm_gpu_scheduler *)param;
-	int r;
 
 	sched_setscheduler(current, SCHED_FIFO, &sparam);
 
 	while (!kthread_should_stop()) {
 		struct drm_sched_entity *entity = NULL;
-		struct drm_sched_fence *s_fence;
 		struct drm_sched_job *sched_job;
-		struct dma_fence *fence;
 		struct drm_sched_job *cleanup_job = NULL;
 
 		wait_event_interruptible(sched->wake_up_worker,
@@ -754,36 +853,11 @@ static int drm_sched_main(void *param)
 		if (!entity)
 			continue;
 
+		mutex_lock(&sched->run_lock);
 		sched_job = drm_sched_entity_pop_job(entity);
-		if (!sched_job)
-			continue;
-
-		s_fence = sched_job->s_fence;
-
-		atomic_inc(&sched->hw_rq_count);
-		drm_sched_job_begin(sched_job);
-
-		fence = sched->ops->run_job(sched_job);
-		drm_sched_fence_scheduled(s_fence);
-
-		if (!IS_ERR_OR_NULL(fence)) {
-			s_fence->parent = dma_fence_get(fence);
-			r = dma_fence_add_callback(fence, &sched_job->cb,
-						   drm_sched_process_job);
-			if (r == -ENOENT)
-				drm_sched_process_job(fence, &sched_job->cb);
-			else if (r)
-				DRM_ERROR("fence add callback failed (%d)\n",
-					  r);
-			dma_fence_put(fence);
-		} else {
-			if (IS_ERR(fence))
-				dma_fence_set_error(&s_fence->finished, PTR_ERR(fence));
-
-			drm_sched_process_job(NULL, &sched_job->cb);
-		}
-
-		wake_up(&sched->job_scheduled);
+		if (sched_job)
+			drm_sched_run_job(sched, sched_job);
+		mutex_unlock(&sched->run_lock);
 	}
 	return 0;
 }
@@ -823,6 +897,8 @@ int drm_sched_init(struct drm_gpu_scheduler *sched,
 	atomic_set(&sched->hw_rq_count, 0);
 	INIT_DELAYED_WORK(&sched->work_tdr, drm_sched_job_timedout);
 	atomic_set(&sched->num_jobs, 0);
+	atomic_set(&sched->num_queued, 0);
+	mutex_init(&sched->run_lock);
 	atomic64_set(&sched->job_id_count, 0);
 
 	/* Each scheduler will run on a seperate kernel thread */
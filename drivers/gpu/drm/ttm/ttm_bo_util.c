@@ -577,7 +577,8 @@ static int ttm_bo_ioremap(struct ttm_buffer_object *bo,
 static int ttm_bo_kmap_ttm(struct ttm_buffer_object *bo,
 			   unsigned long start_page,
 			   unsigned long num_pages,
-			   struct ttm_bo_kmap_obj *map)
+			   struct ttm_bo_kmap_obj *map,
+			   bool transient)
 {
 	struct ttm_mem_reg *mem = &bo->mem;
 	struct ttm_operation_ctx ctx = {
@@ -603,6 +604,17 @@ static int ttm_bo_kmap_ttm(struct ttm_buffer_object *bo,
 		map->bo_kmap_type = ttm_bo_map_kmap;
 		map->page = ttm->pages[start_page];
 		map->virtual = kmap(map->page);
+	} else if (transient) {
+		/*
+		 * Short lived mapping: take it from the per-CPU vmap blocks,
+		 * which are unmapped without a global TLB flush. Long lived
+		 * mappings would pin those blocks, so they keep using vmap.
+		 */
+		prot = ttm_io_prot(mem->placement, PAGE_KERNEL);
+		map->bo_kmap_type = ttm_bo_map_vm_ram;
+		map->num_pages = num_pages;
+		map->virtual = vm_map_ram(ttm->pages + start_page, num_pages,
+					  NUMA_NO_NODE, prot);
 	} else {
 		/*
 		 * We need to use vmap to get the desired page protection
@@ -616,9 +628,9 @@ static int ttm_bo_kmap_ttm(struct ttm_buffer_object *bo,
 	return (!map->virtual) ? -ENOMEM : 0;
 }
 
-int ttm_bo_kmap(struct ttm_buffer_object *bo,
-		unsigned long start_page, unsigned long num_pages,
-		struct ttm_bo_kmap_obj *map)
+static int __ttm_bo_kmap(struct ttm_buffer_object *bo,
+			 unsigned long start_page, unsigned long num_pages,
+			 struct ttm_bo_kmap_obj *map, bool transient)
 {
 	struct ttm_mem_type_manager *man =
 		&bo->bdev->man[bo->mem.mem_type];
@@ -638,15 +650,31 @@ int ttm_bo_kmap(struct ttm_buffer_object *bo,
 	if (ret)
 		return ret;
 	if (!bo->mem.bus.is_iomem) {
-		return ttm_bo_kmap_ttm(bo, start_page, num_pages, map);
+		return ttm_bo_kmap_ttm(bo, start_page, num_pages, map,
+				       transient);
 	} else {
 		offset = start_page << PAGE_SHIFT;
 		size = num_pages << PAGE_SHIFT;
 		return ttm_bo_ioremap(bo, offset, size, map);
 	}
 }
+
+int ttm_bo_kmap(struct ttm_buffer_object *bo,
+		unsigned long start_page, unsigned long num_pages,
+		struct ttm_bo_kmap_obj *map)
+{
+	return __ttm_bo_kmap(bo, start_page, num_pages, map, false);
+}
 EXPORT_SYMBOL(ttm_bo_kmap);
 
+int ttm_bo_kmap_transient(struct ttm_buffer_object *bo,
+			  unsigned long start_page, unsigned long num_pages,
+			  struct ttm_bo_kmap_obj *map)
+{
+	return __ttm_bo_kmap(bo, start_page, num_pages, map, true);
+}
+EXPORT_SYMBOL(ttm_bo_kmap_transient);
+
 void ttm_bo_kunmap(struct ttm_bo_kmap_obj *map)
 {
 	struct ttm_buffer_object *bo = map->bo;
@@ -662,6 +690,9 @@ void ttm_bo_kunmap(struct ttm_bo_kmap_obj *map)
 	case ttm_bo_map_vmap:
 		vunmap(map->virtual);
 		break;
+	case ttm_bo_map_vm_ram:
+		vm_unmap_ram(map->virtual, map->num_pages);
+		break;
 	case ttm_bo_map_kmap:
 		kunmap(map->page);
 		break;
@@ -334,7 +334,7 @@ static int ttm_bo_vm_access_kmap(struct ttm_buffer_object *bo,
 		void *ptr;
 		bool is_iomem;
 
-		ret = ttm_bo_kmap(bo, page, 1, &map);
+		ret = ttm_bo_kmap_transient(bo, page, 1, &map);
 		if (ret)
 			return ret;
 
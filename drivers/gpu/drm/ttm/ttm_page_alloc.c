@@ -42,6 +42,7 @@
 #include <linux/seq_file.h> /* for seq_printf */
 #include <linux/slab.h>
 #include <linux/dma-mapping.h>
+#include <linux/workqueue.h>
 
 #include <linux/atomic.h>
 
@@ -51,6 +52,7 @@
 
 #define NUM_PAGES_TO_ALLOC		(PAGE_SIZE/sizeof(struct page *))
 #define SMALL_ALLOCATION		16
+#define REFILL_SIZE			(4 * NUM_PAGES_TO_ALLOC)
 #define FREE_ALL_PAGES			(~0U)
 /* times are in msecs */
 #define PAGE_FREE_INTERVAL		1000
@@ -65,10 +67,13 @@
  * @list: Pool of free uc/wc pages for fast reuse.
  * @gfp_flags: Flags to pass for alloc_page.
  * @npages: Number of pages in pool.
+ * @cstate: Caching state of the pages in the pool.
+ * @refill: Set when the background worker should top the pool up.
  */
 struct ttm_page_pool {
 	spinlock_t		lock;
 	bool			fill_lock;
+	bool			refill;
 	struct list_head	list;
 	gfp_t			gfp_flags;
 	unsigned		npages;
@@ -76,6 +81,7 @@ struct ttm_page_pool {
 	unsigned long		nfrees;
 	unsigned long		nrefills;
 	unsigned int		order;
+	enum ttm_caching_state	cstate;
 };
 
 /**
@@ -88,6 +94,7 @@ struct ttm_pool_opts {
 	unsigned	alloc_size;
 	unsigned	max_size;
 	unsigned	small;
+	unsigned	refill_size;
 };
 
 #define NUM_POOLS 6
@@ -102,6 +109,9 @@ struct ttm_pool_opts {
  * @work: Work that is used to shrink the pool. Work is only run when there is
  * some pages to free.
  * @small_allocation: Limit in number of pages what is small allocation.
+ * @refill_work: Work that tops up pools drained by allocations, so the
+ * caching attribute changes and their TLB flushes happen off the allocation
+ * path.
  *
  * @pools: All pool objects in use.
  **/
@@ -109,6 +119,7 @@ struct ttm_pool_manager {
 	struct kobject		kobj;
 	struct shrinker		mm_shrink;
 	struct ttm_pool_opts	options;
+	struct work_struct	refill_work;
 
 	union {
 		struct ttm_page_pool	pools[NUM_POOLS];
@@ -135,11 +146,16 @@ static struct attribute ttm_page_pool_alloc_size = {
 	.name = "pool_allocation_size",
 	.mode = S_IRUGO | S_IWUSR
 };
+static struct attribute ttm_page_pool_refill_size = {
+	.name = "pool_refill_size",
+	.mode = S_IRUGO | S_IWUSR
+};
 
 static struct attribute *ttm_pool_attrs[] = {
 	&ttm_page_pool_max,
 	&ttm_page_pool_small,
 	&ttm_page_pool_alloc_size,
+	&ttm_page_pool_refill_size,
 	NULL
 };
 
@@ -179,7 +195,8 @@ static ssize_t ttm_pool_store(struct kobject *kobj,
 				NUM_PAGES_TO_ALLOC*(PAGE_SIZE >> 10));
 		}
 		m->options.alloc_size = val;
-	}
+	} else if (attr == &ttm_page_pool_refill_size)
+		m->options.refill_size = val;
 
 	return size;
 }
@@ -197,6 +214,8 @@ static ssize_t ttm_pool_show(struct kobject *kobj,
 		val = m->options.small;
 	else if (attr == &ttm_page_pool_alloc_size)
 		val = m->options.alloc_size;
+	else if (attr == &ttm_page_pool_refill_size)
+		val = m->options.refill_size;
 
 	val = val * (PAGE_SIZE >> 10);
 
@@ -704,6 +723,79 @@ static int ttm_page_pool_get_pages(struct ttm_page_pool *pool,
 	return r;
 }
 
+/**
+ * Top the pool up to the refill size, in batches of the allocation size.
+ * Huge pools count 2MB chunks, so both limits are scaled by the pool order.
+ */
+static void ttm_page_pool_refill(struct ttm_page_pool *pool)
+{
+	unsigned target = min(_manager->options.refill_size,
+			      _manager->options.max_size) >> pool->order;
+	unsigned batch = max(_manager->options.alloc_size >> pool->order, 1u);
+	gfp_t gfp_flags = pool->gfp_flags | __GFP_NORETRY | __GFP_NOWARN;
+	unsigned long irq_flags;
+
+	spin_lock_irqsave(&pool->lock, irq_flags);
+	while (!pool->fill_lock && pool->npages < target) {
+		struct list_head new_pages;
+		unsigned count = min(target - pool->npages, batch);
+		unsigned cpages = 0;
+		struct page *p;
+		int r;
+
+		pool->fill_lock = true;
+		spin_unlock_irqrestore(&pool->lock, irq_flags);
+
+		INIT_LIST_HEAD(&new_pages);
+		r = ttm_alloc_new_pages(&new_pages, gfp_flags, 0, pool->cstate,
+					count, pool->order);
+		spin_lock_irqsave(&pool->lock, irq_flags);
+
+		list_for_each_entry(p, &new_pages, lru) {
+			++cpages;
+		}
+		list_splice(&new_pages, &pool->list);
+		pool->npages += cpages;
+		++pool->nrefills;
+		pool->fill_lock = false;
+
+		if (r)
+			break;
+	}
+	spin_unlock_irqrestore(&pool->lock, irq_flags);
+}
+
+static void ttm_page_pool_refill_work(struct work_struct *work)
+{
+	struct ttm_pool_manager *m =
+		container_of(work, struct ttm_pool_manager, refill_work);
+	unsigned i;
+
+	for (i = 0; i < NUM_POOLS; ++i) {
+		struct ttm_page_pool *pool = &m->pools[i];
+
+		if (READ_ONCE(pool->refill)) {
+			WRITE_ONCE(pool->refill, false);
+			ttm_page_pool_refill(pool);
+		}
+	}
+}
+
+/**
+ * Ask for a background refill once an allocation took the pool below half
+ * of its refill size. The unlocked read of npages is only a heuristic.
+ */
+static void ttm_page_pool_kick_refill(struct ttm_page_pool *pool)
+{
+	unsigned target = _manager->options.refill_size >> pool->order;
+
+	if (READ_ONCE(pool->npages) >= target / 2 || READ_ONCE(pool->refill))
+		return;
+
+	WRITE_ONCE(pool->refill, true);
+	schedule_work(&_manager->refill_work);
+}
+
 /* Put all pages in pages list to correct pool to wait for reuse */
 static void ttm_put_pages(struct page **pages, unsigned npages, int flags,
 			  enum ttm_caching_state cstate)
@@ -903,6 +995,7 @@ static int ttm_get_pages(struct page **pages, unsigned npages, int flags,
 		ttm_page_pool_get_pages(huge, &plist, flags, cstate,
 					npages / HPAGE_PMD_NR,
 					HPAGE_PMD_ORDER);
+		ttm_page_pool_kick_refill(huge);
 
 		list_for_each_entry(p, &plist, lru) {
 			unsigned j;
@@ -916,6 +1009,7 @@ static int ttm_get_pages(struct page **pages, unsigned npages, int flags,
 	INIT_LIST_HEAD(&plist);
 	r = ttm_page_pool_get_pages(pool, &plist, flags, cstate,
 				    npages - count, 0);
+	ttm_page_pool_kick_refill(pool);
 
 	first = count;
 	list_for_each_entry(p, &plist, lru) {
@@ -940,15 +1034,17 @@ static int ttm_get_pages(struct page **pages, unsigned npages, int flags,
 }
 
 static void ttm_page_pool_init_locked(struct ttm_page_pool *pool, gfp_t flags,
-		char *name, unsigned int order)
+		char *name, unsigned int order, enum ttm_caching_state cstate)
 {
 	spin_lock_init(&pool->lock);
 	pool->fill_lock = false;
+	pool->refill = false;
 	INIT_LIST_HEAD(&pool->list);
 	pool->npages = pool->nfrees = 0;
 	pool->gfp_flags = flags;
 	pool->name = name;
 	pool->order = order;
+	pool->cstate = cstate;
 }
 
 int ttm_page_alloc_init(struct ttm_mem_global *glob, unsigned max_pages)
@@ -968,31 +1064,36 @@ int ttm_page_alloc_init(struct ttm_mem_global *glob, unsigned max_pages)
 	if (!_manager)
 		return -ENOMEM;
 
-	ttm_page_pool_init_locked(&_manager->wc_pool, GFP_HIGHUSER, "wc", 0);
+	ttm_page_pool_init_locked(&_manager->wc_pool, GFP_HIGHUSER, "wc", 0,
+				  tt_wc);
 
-	ttm_page_pool_init_locked(&_manager->uc_pool, GFP_HIGHUSER, "uc", 0);
+	ttm_page_pool_init_locked(&_manager->uc_pool, GFP_HIGHUSER, "uc", 0,
+				  tt_uncached);
 
 	ttm_page_pool_init_locked(&_manager->wc_pool_dma32,
-				  GFP_USER | GFP_DMA32, "wc dma", 0);
+				  GFP_USER | GFP_DMA32, "wc dma", 0, tt_wc);
 
 	ttm_page_pool_init_locked(&_manager->uc_pool_dma32,
-				  GFP_USER | GFP_DMA32, "uc dma", 0);
+				  GFP_USER | GFP_DMA32, "uc dma", 0,
+				  tt_uncached);
 
 	ttm_page_pool_init_locked(&_manager->wc_pool_huge,
 				  (GFP_TRANSHUGE_LIGHT | __GFP_NORETRY |
 				   __GFP_KSWAPD_RECLAIM) &
 				  ~(__GFP_MOVABLE | __GFP_COMP),
-				  "wc huge", order);
+				  "wc huge", order, tt_wc);
 
 	ttm_page_pool_init_locked(&_manager->uc_pool_huge,
 				  (GFP_TRANSHUGE_LIGHT | __GFP_NORETRY |
 				   __GFP_KSWAPD_RECLAIM) &
 				  ~(__GFP_MOVABLE | __GFP_COMP)
-				  , "uc huge", order);
+				  , "uc huge", order, tt_uncached);
 
 	_manager->options.max_size = max_pages;
 	_manager->options.small = SMALL_ALLOCATION;
 	_manager->options.alloc_size = NUM_PAGES_TO_ALLOC;
+	_manager->options.refill_size = REFILL_SIZE;
+	INIT_WORK(&_manager->refill_work, ttm_page_pool_refill_work);
 
 	ret = kobject_init_and_add(&_manager->kobj, &ttm_pool_kobj_type,
 				   &glob->kobj, "pool");
@@ -1016,6 +1117,7 @@ void ttm_page_alloc_fini(void)
 
 	pr_info("Finalizing pool allocator\n");
 	ttm_pool_mm_shrink_fini(_manager);
+	cancel_work_sync(&_manager->refill_work);
 
 	/* OK to use static buffer since global mutex is no longer used. */
 	for (i = 0; i < NUM_POOLS; ++i)
@@ -35,6 +35,7 @@
 #include <linux/idr.h>
 #include <linux/input/mt.h>
 #include <linux/crc32.h>
+#include <linux/math64.h>
 #include <asm/unaligned.h>
 
 #include "hid-ids.h"
@@ -501,6 +502,8 @@ struct motion_output_report_02 {
 /* Default to 4ms poll interval, which is same as USB (not adjustable). */
 #define DS4_BT_DEFAULT_POLL_INTERVAL_MS 4
 #define DS4_BT_MAX_POLL_INTERVAL_MS 62
+/* The DS4 reports every 4ms over USB; it can't take output any faster. */
+#define DS4_USB_REPORT_INTERVAL_MS 4
 #define DS4_GYRO_RES_PER_DEG_S 1024
 #define DS4_ACC_RES_PER_G      8192
 
@@ -521,8 +524,12 @@ struct ds4_calibration_data {
 	 */
 	int sens_numer;
 	int sens_denom;
+	/* sens_numer / sens_denom in 16.16 fixed point, used per report */
+	s64 sens;
 };
 
+#define DS4_CALIB_SHIFT 16
+
 enum ds4_dongle_state {
 	DONGLE_DISCONNECTED,
 	DONGLE_CALIBRATING,
@@ -544,8 +551,9 @@ struct sony_sc {
 	struct led_classdev *leds[MAX_LEDS];
 	unsigned long quirks;
 	struct work_struct hotplug_worker;
-	struct work_struct state_worker;
+	struct delayed_work state_worker;
 	void (*send_output_report)(struct sony_sc *);
+	unsigned long output_report_sent;
 	struct power_supply *battery;
 	struct power_supply_desc battery_desc;
 	int device_id;
@@ -582,16 +590,37 @@ struct sony_sc {
 
 static void sony_set_leds(struct sony_sc *sc);
 
+/* Minimum time between two output reports, in jiffies */
+static unsigned long sony_output_report_interval(struct sony_sc *sc)
+{
+	if (sc->quirks & DUALSHOCK4_CONTROLLER_BT)
+		return msecs_to_jiffies(sc->ds4_bt_poll_interval);
+	if (sc->quirks & (DUALSHOCK4_CONTROLLER_USB | DUALSHOCK4_DONGLE))
+		return msecs_to_jiffies(DS4_USB_REPORT_INTERVAL_MS);
+	return 0;
+}
+
 static inline void sony_schedule_work(struct sony_sc *sc,
 				      enum sony_worker which)
 {
-	unsigned long flags;
+	unsigned long flags, interval, next;
 
 	switch (which) {
 	case SONY_WORKER_STATE:
+		/*
+		 * The worker sends whatever rumble/LED state is current when
+		 * it runs, so changes that arrive while it is pending are
+		 * merged into one report. Hold it off until the device's
+		 * report interval has passed since the last one went out.
+		 */
 		spin_lock_irqsave(&sc->lock, flags);
-		if (!sc->defer_initialization && sc->state_worker_initialized)
-			schedule_work(&sc->state_worker);
+		if (!sc->defer_initialization && sc->state_worker_initialized) {
+			interval = sony_output_report_interval(sc);
+			next = sc->output_report_sent + interval;
+			schedule_delayed_work(&sc->state_worker,
+					      time_after(next, jiffies) ?
+					      min(next - jiffies, interval) : 0);
+		}
 		spin_unlock_irqrestore(&sc->lock, flags);
 		break;
 	case SONY_WORKER_HOTPLUG:
@@ -946,6 +975,7 @@ static void dualshock4_parse_report(struct sony_sc *sc, u8 *rd, int size)
 	int n, m, offset, num_touch_data, max_touch_data;
 	u8 cable_state, battery_capacity, battery_charging;
 	u16 timestamp;
+	ktime_t now = ktime_get();
 
 	/* When using Bluetooth the header is 2 bytes longer, so skip these. */
 	int data_offset = (sc->quirks & DUALSHOCK4_CONTROLLER_BT) ? 2 : 0;
@@ -954,6 +984,14 @@ static void dualshock4_parse_report(struct sony_sc *sc, u8 *rd, int size)
 	offset = data_offset + DS4_INPUT_REPORT_BUTTON_OFFSET;
 	input_report_key(sc->touchpad, BTN_LEFT, rd[offset+2] & 0x2);
 
+	/*
+	 * Stamp everything decoded from this report with its arrival time
+	 * rather than the time each device happens to be synced.
+	 */
+	input_set_timestamp(input_dev, now);
+	input_set_timestamp(sc->sensor_dev, now);
+	input_set_timestamp(sc->touchpad, now);
+
 	/*
 	 * The default behavior of the Dualshock 4 is to send reports using
 	 * report type 1 when running over Bluetooth. However, when feature
@@ -1025,18 +1063,12 @@ static void dualshock4_parse_report(struct sony_sc *sc, u8 *rd, int size)
 
 	offset = data_offset + DS4_INPUT_REPORT_GYRO_X_OFFSET;
 	for (n = 0; n < 6; n++) {
-		/* Store data in int for more precision during mult_frac. */
 		int raw_data = (short)((rd[offset+1] << 8) | rd[offset]);
 		struct ds4_calibration_data *calib = &sc->ds4_calib_data[n];
 
-		/* High precision is needed during calibration, but the
-		 * calibrated values are within 32-bit.
-		 * Note: we swap numerator 'x' and 'numer' in mult_frac for
-		 *       precision reasons so we don't need 64-bit.
-		 */
-		int calib_data = mult_frac(calib->sens_numer,
-					   raw_data - calib->bias,
-					   calib->sens_denom);
+		/* The calibrated values are within 32-bit. */
+		int calib_data = ((raw_data - calib->bias) * calib->sens) >>
+				 DS4_CALIB_SHIFT;
 
 		input_report_abs(sc->sensor_dev, calib->abs_code, calib_data);
 		offset += 2;
@@ -1591,6 +1623,7 @@ static int dualshock4_get_calibration_data(struct sony_sc *sc)
 	short acc_z_plus, acc_z_minus;
 	int speed_2x;
 	int range_2g;
+	int i;
 
 	/* For Bluetooth we use a different request, which supports CRC.
 	 * Note: in Bluetooth mode feature report 0x02 also changes the state
@@ -1713,6 +1746,23 @@ static int dualshock4_get_calibration_data(struct sony_sc *sc)
 	sc->ds4_calib_data[5].sens_numer = 2*DS4_ACC_RES_PER_G;
 	sc->ds4_calib_data[5].sens_denom = range_2g;
 
+	/*
+	 * Turn the sensitivity fractions into fixed point once, so the
+	 * report path is a multiply instead of a division per axis.
+	 */
+	for (i = 0; i < ARRAY_SIZE(sc->ds4_calib_data); i++) {
+		struct ds4_calibration_data *calib = &sc->ds4_calib_data[i];
+
+		if (!calib->sens_denom) {
+			hid_warn(sc->hdev, "Invalid DualShock 4 calibration data, axis %d uncalibrated\n", i);
+			calib->bias = 0;
+			calib->sens = 1LL << DS4_CALIB_SHIFT;
+			continue;
+		}
+		calib->sens = div_s64((s64)calib->sens_numer << DS4_CALIB_SHIFT,
+				      calib->sens_denom);
+	}
+
 err_stop:
 	kfree(buf);
 	return ret;
@@ -2218,7 +2268,13 @@ static inline void sony_send_output_report(struct sony_sc *sc)
 
 static void sony_state_worker(struct work_struct *work)
 {
-	struct sony_sc *sc = container_of(work, struct sony_sc, state_worker);
+	struct sony_sc *sc = container_of(work, struct sony_sc,
+					  state_worker.work);
+	unsigned long flags;
+
+	spin_lock_irqsave(&sc->lock, flags);
+	sc->output_report_sent = jiffies;
+	spin_unlock_irqrestore(&sc->lock, flags);
 
 	sc->send_output_report(sc);
 }
@@ -2578,7 +2634,7 @@ static inline void sony_init_output_report(struct sony_sc *sc,
 	sc->send_output_report = send_output_report;
 
 	if (!sc->state_worker_initialized)
-		INIT_WORK(&sc->state_worker, sony_state_worker);
+		INIT_DELAYED_WORK(&sc->state_worker, sony_state_worker);
 
 	sc->state_worker_initialized = 1;
 }
@@ -2593,7 +2649,7 @@ static inline void sony_cancel_work_sync(struct sony_sc *sc)
 		spin_lock_irqsave(&sc->lock, flags);
 		sc->state_worker_initialized = 0;
 		spin_unlock_irqrestore(&sc->lock, flags);
-		cancel_work_sync(&sc->state_worker);
+		cancel_delayed_work_sync(&sc->state_worker);
 	}
 }
 
@@ -1109,7 +1109,7 @@ static int usbhid_start(struct hid_device *hid)
 				hid->name, endpoint->bInterval, interval);
 		}
 
-		/* Change the polling interval of mice, joysticks
+		/* Change the polling interval of mice, joysticks, gamepads
 		 * and keyboards.
 		 */
 		switch (hid->collection->usage) {
@@ -1118,6 +1118,7 @@ static int usbhid_start(struct hid_device *hid)
 				interval = hid_mousepoll_interval;
 			break;
 		case HID_GD_JOYSTICK:
+		case HID_GD_GAMEPAD:
 			if (hid_jspoll_interval > 0)
 				interval = hid_jspoll_interval;
 			break;
@@ -31,6 +31,7 @@
 #include <asm/iommu_table.h>
 #include <asm/io_apic.h>
 #include <asm/irq_remapping.h>
+#include <asm/setup.h>
 
 #include <linux/crash_dump.h>
 #include "amd_iommu.h"
@@ -2438,7 +2439,6 @@ static void __init free_iommu_resources(void)
 	free_iommu_all();
 }
 
-#ifndef CONFIG_X86_PS4 // TODO this should detect ps4-ness at runtime
 /* SB IOAPIC is always on this device in AMD systems */
 #define IOAPIC_SB_DEVID		((0x00 << 8) | PCI_DEVFN(0x14, 0))
 
@@ -2490,7 +2490,17 @@ static bool __init check_ioapic_information(void)
 
 	return ret;
 }
-#endif
+
+/*
+ * The PS4 has no southbridge IOAPIC in its IVRS table; its interrupts all
+ * come in as MSIs through Aeolia/Baikal, so the check above would needlessly
+ * turn interrupt remapping off.
+ */
+static bool __init amd_iommu_is_ps4(void)
+{
+	return boot_params.hdr.hardware_subarch == X86_SUBARCH_PS4;
+}
+
 static void __init free_dma_resources(void)
 {
 	free_pages((unsigned long)amd_iommu_pd_alloc_bitmap,
@@ -2633,10 +2643,9 @@ static int __init early_amd_iommu_init(void)
 	/* Disable any previously enabled IOMMUs */
 	if (!is_kdump_kernel() || amd_iommu_disabled)
 		disable_iommus();
-/*
-	if (amd_iommu_irq_remap)
+	if (amd_iommu_irq_remap && !amd_iommu_is_ps4())
 		amd_iommu_irq_remap = check_ioapic_information();
-*/
+
 	if (amd_iommu_irq_remap) {
 		/*
 		 * Interrupt remapping enabled, create kmem_cache for the
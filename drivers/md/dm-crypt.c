@@ -24,6 +24,8 @@
 #include <linux/atomic.h>
 #include <linux/scatterlist.h>
 #include <linux/rbtree.h>
+#include <linux/llist.h>
+#include <linux/percpu.h>
 #include <linux/ctype.h>
 #include <asm/page.h>
 #include <asm/unaligned.h>
@@ -67,6 +69,8 @@ struct dm_crypt_io {
 	u8 *integrity_metadata;
 	bool integrity_metadata_from_pool;
 	struct work_struct work;
+	struct llist_node crypt_node;
+	int cpu;	/* submitting CPU */
 
 	struct convert_context ctx;
 
@@ -120,13 +124,23 @@ struct iv_tcw_private {
  * and encrypts / decrypts at the same time.
  */
 enum flags { DM_CRYPT_SUSPENDED, DM_CRYPT_KEY_VALID,
-	     DM_CRYPT_SAME_CPU, DM_CRYPT_NO_OFFLOAD };
+	     DM_CRYPT_SAME_CPU, DM_CRYPT_NO_OFFLOAD,
+	     DM_CRYPT_SUBMIT_CPU };
 
 enum cipher_flags {
 	CRYPT_MODE_INTEGRITY_AEAD,	/* Use authenticated mode for cihper */
 	CRYPT_IV_LARGE_SECTORS,		/* Calculate IV from sector_size, not 512B sectors */
 };
 
+/*
+ * submit_cpu_crypt: ios waiting to be crypted on one CPU. A single work
+ * item drains however many piled up while it was queued.
+ */
+struct kcryptd_cpu {
+	struct llist_head list;
+	struct work_struct work;
+};
+
 /*
  * The fields in here must be read only after initialization.
  */
@@ -138,6 +152,7 @@ struct crypt_config {
 
 	struct workqueue_struct *io_queue;
 	struct workqueue_struct *crypt_queue;
+	struct kcryptd_cpu __percpu *crypt_cpu;
 
 	spinlock_t write_thread_lock;
 	struct task_struct *write_thread;
@@ -1364,6 +1379,7 @@ static void crypt_io_init(struct dm_crypt_io *io, struct crypt_config *cc,
 	io->ctx.r.req = NULL;
 	io->integrity_metadata = NULL;
 	io->integrity_metadata_from_pool = false;
+	io->cpu = raw_smp_processor_id();
 	atomic_set(&io->io_pending, 0);
 }
 
@@ -1709,20 +1725,50 @@ static void kcryptd_async_done(struct crypto_async_request *async_req,
 		kcryptd_crypt_write_io_submit(io, 1);
 }
 
-static void kcryptd_crypt(struct work_struct *work)
+static void kcryptd_crypt_io(struct dm_crypt_io *io)
 {
-	struct dm_crypt_io *io = container_of(work, struct dm_crypt_io, work);
-
 	if (bio_data_dir(io->base_bio) == READ)
 		kcryptd_crypt_read_convert(io);
 	else
 		kcryptd_crypt_write_convert(io);
 }
 
+static void kcryptd_crypt(struct work_struct *work)
+{
+	struct dm_crypt_io *io = container_of(work, struct dm_crypt_io, work);
+
+	kcryptd_crypt_io(io);
+}
+
+static void kcryptd_crypt_batch(struct work_struct *work)
+{
+	struct kcryptd_cpu *kc = container_of(work, struct kcryptd_cpu, work);
+	struct llist_node *batch;
+	struct dm_crypt_io *io, *tmp;
+
+	batch = llist_reverse_order(llist_del_all(&kc->list));
+	llist_for_each_entry_safe(io, tmp, batch, crypt_node)
+		kcryptd_crypt_io(io);
+}
+
+/*
+ * With submit_cpu_crypt, reads are decrypted on the CPU that submitted
+ * them rather than the one that took the completion interrupt, so the
+ * plaintext lands in the cache of the cluster that is going to use it.
+ */
 static void kcryptd_queue_crypt(struct dm_crypt_io *io)
 {
 	struct crypt_config *cc = io->cc;
 
+	if (test_bit(DM_CRYPT_SUBMIT_CPU, &cc->flags)) {
+		int cpu = cpu_online(io->cpu) ? io->cpu : raw_smp_processor_id();
+		struct kcryptd_cpu *kc = per_cpu_ptr(cc->crypt_cpu, cpu);
+
+		if (llist_add(&io->crypt_node, &kc->list))
+			queue_work_on(cpu, cc->crypt_queue, &kc->work);
+		return;
+	}
+
 	INIT_WORK(&io->work, kcryptd_crypt);
 	queue_work(cc->crypt_queue, &io->work);
 }
@@ -2132,6 +2178,7 @@ static void crypt_dtr(struct dm_target *ti)
 		destroy_workqueue(cc->io_queue);
 	if (cc->crypt_queue)
 		destroy_workqueue(cc->crypt_queue);
+	free_percpu(cc->crypt_cpu);
 
 	crypt_free_tfms(cc);
 
@@ -2488,7 +2535,7 @@ static int crypt_ctr_optional(struct dm_target *ti, unsigned int argc, char **ar
 	struct crypt_config *cc = ti->private;
 	struct dm_arg_set as;
 	static const struct dm_arg _args[] = {
-		{0, 6, "Invalid number of feature args"},
+		{0, 7, "Invalid number of feature args"},
 	};
 	unsigned int opt_params, val;
 	const char *opt_string, *sval;
@@ -2518,6 +2565,9 @@ static int crypt_ctr_optional(struct dm_target *ti, unsigned int argc, char **ar
 
 		else if (!strcasecmp(opt_string, "submit_from_crypt_cpus"))
 			set_bit(DM_CRYPT_NO_OFFLOAD, &cc->flags);
+
+		else if (!strcasecmp(opt_string, "submit_cpu_crypt"))
+			set_bit(DM_CRYPT_SUBMIT_CPU, &cc->flags);
 		else if (sscanf(opt_string, "integrity:%u:", &val) == 1) {
 			if (val == 0 || val > MAX_TAG_SIZE) {
 				ti->error = "Invalid integrity arguments";
@@ -2717,7 +2767,24 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 		goto bad;
 	}
 
-	if (test_bit(DM_CRYPT_SAME_CPU, &cc->flags))
+	if (test_bit(DM_CRYPT_SUBMIT_CPU, &cc->flags)) {
+		int cpu;
+
+		cc->crypt_cpu = alloc_percpu(struct kcryptd_cpu);
+		if (!cc->crypt_cpu) {
+			ti->error = "Couldn't allocate kcryptd batches";
+			goto bad;
+		}
+		for_each_possible_cpu(cpu) {
+			struct kcryptd_cpu *kc = per_cpu_ptr(cc->crypt_cpu, cpu);
+
+			init_llist_head(&kc->list);
+			INIT_WORK(&kc->work, kcryptd_crypt_batch);
+		}
+	}
+
+	if (test_bit(DM_CRYPT_SAME_CPU, &cc->flags) ||
+	    test_bit(DM_CRYPT_SUBMIT_CPU, &cc->flags))
 		cc->crypt_queue = alloc_workqueue("kcryptd/%s", WQ_CPU_INTENSIVE | WQ_MEM_RECLAIM,
 						  1, devname);
 	else
@@ -2855,6 +2922,7 @@ static void crypt_status(struct dm_target *ti, status_type_t type,
 		num_feature_args += !!ti->num_discard_bios;
 		num_feature_args += test_bit(DM_CRYPT_SAME_CPU, &cc->flags);
 		num_feature_args += test_bit(DM_CRYPT_NO_OFFLOAD, &cc->flags);
+		num_feature_args += test_bit(DM_CRYPT_SUBMIT_CPU, &cc->flags);
 		num_feature_args += cc->sector_size != (1 << SECTOR_SHIFT);
 		num_feature_args += test_bit(CRYPT_IV_LARGE_SECTORS, &cc->cipher_flags);
 		if (cc->on_disk_tag_size)
@@ -2867,6 +2935,8 @@ static void crypt_status(struct dm_target *ti, status_type_t type,
 				DMEMIT(" same_cpu_crypt");
 			if (test_bit(DM_CRYPT_NO_OFFLOAD, &cc->flags))
 				DMEMIT(" submit_from_crypt_cpus");
+			if (test_bit(DM_CRYPT_SUBMIT_CPU, &cc->flags))
+				DMEMIT(" submit_cpu_crypt");
 			if (cc->on_disk_tag_size)
 				DMEMIT(" integrity:%u:%s", cc->on_disk_tag_size, cc->cipher_auth);
 			if (cc->sector_size != (1 << SECTOR_SHIFT))
@@ -2979,7 +3049,7 @@ static void crypt_io_hints(struct dm_target *ti, struct queue_limits *limits)
 
 static struct target_type crypt_target = {
 	.name   = "crypt",
-	.version = {1, 19, 0},
+	.version = {1, 20, 0},
 	.module = THIS_MODULE,
 	.ctr    = crypt_ctr,
 	.dtr    = crypt_dtr,
@@ -24,6 +24,11 @@
 #include <linux/ip.h>
 #include <linux/slab.h>
 #include <net/ip.h>
+#include <net/page_pool.h>
+#include <net/busy_poll.h>
+#include <net/xdp.h>
+#include <linux/bpf.h>
+#include <linux/bpf_trace.h>
 #include <linux/tcp.h>
 #include <linux/in.h>
 #include <linux/delay.h>
@@ -35,12 +40,16 @@
 #include <linux/of_device.h>
 #include <linux/of_net.h>
 #include <linux/dmi.h>
+#include <linux/dim.h>
+#include <linux/dma-direct.h>
+#include <linux/swiotlb.h>
 
 #include <asm/irq.h>
 
 #ifdef CONFIG_X86_PS4
 #include <asm/ps4.h>
 #include "../../../ps4/aeolia.h"
+#include "../../../ps4/baikal.h"
 #endif
 
 #include "sky2.h"
@@ -59,6 +68,9 @@
 #define RX_MAX_PENDING		(RX_LE_SIZE/6 - 2)
 #define RX_DEF_PENDING		RX_MAX_PENDING
 
+/* Smallest MTU for which rx_hdr_split is applied */
+#define SKY2_RX_SPLIT_MIN_MTU	4096
+
 /* This is the worst case number of transmit list elements for a single skb:
    VLAN:GSO + CKSUM + Data + skb_frags * DMA */
 #define MAX_SKB_TX_LE	(2 + (sizeof(dma_addr_t)/sizeof(u32))*(MAX_SKB_FRAGS+1))
@@ -87,6 +99,28 @@ static int copybreak __read_mostly = 128;
 module_param(copybreak, int, 0);
 MODULE_PARM_DESC(copybreak, "Receive copy threshold");
 
+/*
+ * With jumbo frames, receive the first rx_hdr_split bytes of a frame in the
+ * header buffer and the rest in full fragment pages, so that
+ * TCP_ZEROCOPY_RECEIVE can map the payload pages. Receive buffers are a multiple of 8 bytes long,
+ * so the value is rounded up to that. Ethernet + IP + TCP headers come to 2
+ * modulo 8 (66 for IPv4 with timestamps, 86 for IPv6): with 72 or 88, the
+ * first 6 payload bytes land in the header buffer and have to be read
+ * normally, the full pages after them can be mapped.
+ */
+static int rx_hdr_split;
+module_param(rx_hdr_split, int, 0);
+MODULE_PARM_DESC(rx_hdr_split, "Header bytes received apart from page aligned jumbo payload (0 = off)");
+
+/* Every list element is a posted write across the southbridge; a lower
+ * pacing shift lets TCP autosize bigger TSO bursts (and TSQ allow more of
+ * them in flight) so fewer elements move the same data. sch_fq keeps the
+ * bursts paced. 0 leaves the socket default.
+ */
+static int tso_pacing_shift = 8;
+module_param(tso_pacing_shift, int, 0644);
+MODULE_PARM_DESC(tso_pacing_shift, "TCP pacing shift for TSO sockets (0=socket default, 1-10)");
+
 static int disable_msi = -1;
 module_param(disable_msi, int, 0);
 MODULE_PARM_DESC(disable_msi, "Disable Message Signaled Interrupt (MSI)");
@@ -140,7 +174,7 @@ static const struct pci_device_id sky2_id_table[] = {
 	{ PCI_DEVICE(PCI_VENDOR_ID_MARVELL, 0x4382) }, /* 88E8079 */
 	{ PCI_DEVICE(PCI_VENDOR_ID_SONY, PCI_DEVICE_ID_SONY_AEOLIA_GBE) },
 	{ PCI_DEVICE(PCI_VENDOR_ID_SONY, PCI_DEVICE_ID_SONY_BELIZE_GBE) },
-	//{ PCI_DEVICE(PCI_VENDOR_ID_SONY, PCI_DEVICE_ID_SONY_BAIKAL_GBE) },
+	{ PCI_DEVICE(PCI_VENDOR_ID_SONY, PCI_DEVICE_ID_SONY_BAIKAL_GBE) },
 	{ 0 }
 };
 
@@ -217,6 +251,53 @@ static inline u16 gm_phy_read(struct sky2_hw *hw, unsigned port, u16 reg)
 	return v;
 }
 
+#ifdef CONFIG_X86_PS4
+/* Raw SMI read at any address, usable before the net devices exist */
+static int sky2_smi_read(struct sky2_hw *hw, u8 addr, u16 reg, u16 *val)
+{
+	int i;
+
+	gma_write16(hw, 0, GM_SMI_CTRL, GM_SMI_CT_PHY_AD(addr)
+		    | GM_SMI_CT_REG_AD(reg) | GM_SMI_CT_OP_RD);
+
+	for (i = 0; i < PHY_RETRIES; i++) {
+		u16 ctrl = gma_read16(hw, 0, GM_SMI_CTRL);
+		if (ctrl == 0xffff)
+			return -EIO;
+
+		if (ctrl & GM_SMI_CT_RD_VAL) {
+			*val = gma_read16(hw, 0, GM_SMI_DATA);
+			return 0;
+		}
+
+		udelay(10);
+	}
+
+	return -ETIMEDOUT;
+}
+
+/*
+ * Aeolia has its normal phy at SMI address 1 and something that looks
+ * like an l2 switch at address 2. Report what answers there so the
+ * switch can be identified; the driver keeps using the single GMAC.
+ */
+static void sky2_probe_l2_switch(struct sky2_hw *hw)
+{
+	u16 id0, id1;
+
+	if (sky2_smi_read(hw, 2, PHY_MARV_ID0, &id0) ||
+	    sky2_smi_read(hw, 2, PHY_MARV_ID1, &id1) ||
+	    id0 == 0xffff || (id0 == 0 && id1 == 0)) {
+		dev_info(&hw->pdev->dev, "no l2 switch at SMI address 2\n");
+		return;
+	}
+
+	hw->switch_id = (u32) id0 << 16 | id1;
+	dev_info(&hw->pdev->dev, "l2 switch at SMI address 2, id %04x:%04x\n",
+		 id0, id1);
+}
+#endif
+
 
 static void sky2_power_on(struct sky2_hw *hw)
 {
@@ -1158,23 +1239,81 @@ static unsigned sky2_get_rx_threshold(struct sky2_port *sky2)
 	return (size - 8) / sizeof(u32);
 }
 
+/* Headroom in front of the frame in a page pool receive buffer */
+static inline unsigned sky2_rx_headroom(const struct sky2_hw *hw)
+{
+	/*
+	 * Workaround for a bug in FIFO that cause hang
+	 * if the receive buffer is not 64 bit aligned.
+	 * XDP_PACKET_HEADROOM keeps the frame aligned for those chips.
+	 */
+	if (hw->flags & SKY2_HW_RAM_BUFFER)
+		return XDP_PACKET_HEADROOM;
+	return XDP_PACKET_HEADROOM + NET_IP_ALIGN;
+}
+
+/* Account data the DMA layer copied through a swiotlb bounce buffer */
+static inline void sky2_count_bounce(u64 *counter, struct pci_dev *pdev,
+				     dma_addr_t addr, unsigned int len)
+{
+	if (dma_is_direct(get_dma_ops(&pdev->dev)) &&
+	    unlikely(is_swiotlb_buffer(dma_to_phys(&pdev->dev, addr))))
+		*counter += len;
+}
+
+/* Largest header buffer that still leaves room for build_skb() */
+static inline unsigned sky2_rx_max_data_size(const struct sky2_hw *hw)
+{
+	return SKB_WITH_OVERHEAD(PAGE_SIZE - sky2_rx_headroom(hw)) & ~7;
+}
+
+/* Header buffer size for page aligned payload, 0 if not used at this MTU */
+static unsigned sky2_get_rx_split_size(struct sky2_port *sky2, unsigned size)
+{
+	struct rx_ring_info *re;
+	unsigned hdr;
+
+	if (rx_hdr_split <= 0 || sky2->netdev->mtu < SKY2_RX_SPLIT_MIN_MTU)
+		return 0;
+
+	hdr = clamp_t(unsigned, roundup(rx_hdr_split, 8),
+		      roundup(ETH_HLEN, 8), sky2_rx_max_data_size(sky2->hw));
+
+	/* The payload has to fit the fragment pages of a ring element */
+	if (size - hdr > ARRAY_SIZE(re->frag_addr) * PAGE_SIZE)
+		return 0;
+
+	sky2->rx_nfrags = DIV_ROUND_UP(size - hdr, PAGE_SIZE);
+	return hdr;
+}
+
 static unsigned sky2_get_rx_data_size(struct sky2_port *sky2)
 {
 	struct rx_ring_info *re;
-	unsigned size;
+	unsigned size, hdr, max = sky2_rx_max_data_size(sky2->hw);
 
 	/* Space needed for frame data + headers rounded up */
 	size = roundup(sky2->netdev->mtu + ETH_HLEN + VLAN_HLEN, 8);
 
+	hdr = sky2_get_rx_split_size(sky2, size);
+	if (hdr)
+		return hdr;
+
 	sky2->rx_nfrags = size >> PAGE_SHIFT;
-	BUG_ON(sky2->rx_nfrags > ARRAY_SIZE(re->frag_addr));
 
 	/* Compute residue after pages */
 	size -= sky2->rx_nfrags << PAGE_SHIFT;
 
+	/* Residue does not fit in the header page, use one more fragment */
+	if (size > max) {
+		++sky2->rx_nfrags;
+		size = 0;
+	}
+	BUG_ON(sky2->rx_nfrags > ARRAY_SIZE(re->frag_addr));
+
 	/* Optimize to handle small packets and headers */
 	if (size < copybreak)
-		size = copybreak;
+		size = min_t(unsigned, copybreak, max);
 	if (size < ETH_HLEN)
 		size = ETH_HLEN;
 
@@ -1199,7 +1338,7 @@ static void sky2_rx_add(struct sky2_port *sky2, u8 op,
 	le->opcode = op | HW_OWNER;
 }
 
-/* Build description to hardware for one possibly fragmented skb */
+/* Build description to hardware for one possibly fragmented buffer */
 static void sky2_rx_submit(struct sky2_port *sky2,
 			   const struct rx_ring_info *re)
 {
@@ -1207,64 +1346,23 @@ static void sky2_rx_submit(struct sky2_port *sky2,
 
 	sky2_rx_add(sky2, OP_PACKET, re->data_addr, sky2->rx_data_size);
 
-	for (i = 0; i < skb_shinfo(re->skb)->nr_frags; i++)
+	for (i = 0; i < sky2->rx_nfrags; i++)
 		sky2_rx_add(sky2, OP_BUFFER, re->frag_addr[i], PAGE_SIZE);
 }
 
 
-static int sky2_rx_map_skb(struct pci_dev *pdev, struct rx_ring_info *re,
-			    unsigned size)
-{
-	struct sk_buff *skb = re->skb;
-	int i;
-
-	re->data_addr = pci_map_single(pdev, skb->data, size, PCI_DMA_FROMDEVICE);
-	if (pci_dma_mapping_error(pdev, re->data_addr))
-		goto mapping_error;
-
-	dma_unmap_len_set(re, data_size, size);
-
-	for (i = 0; i < skb_shinfo(skb)->nr_frags; i++) {
-		const skb_frag_t *frag = &skb_shinfo(skb)->frags[i];
-
-		re->frag_addr[i] = skb_frag_dma_map(&pdev->dev, frag, 0,
-						    skb_frag_size(frag),
-						    DMA_FROM_DEVICE);
-
-		if (dma_mapping_error(&pdev->dev, re->frag_addr[i]))
-			goto map_page_error;
-	}
-	return 0;
-
-map_page_error:
-	while (--i >= 0) {
-		pci_unmap_page(pdev, re->frag_addr[i],
-			       skb_frag_size(&skb_shinfo(skb)->frags[i]),
-			       PCI_DMA_FROMDEVICE);
-	}
-
-	pci_unmap_single(pdev, re->data_addr, dma_unmap_len(re, data_size),
-			 PCI_DMA_FROMDEVICE);
-
-mapping_error:
-	if (net_ratelimit())
-		dev_warn(&pdev->dev, "%s: rx mapping error\n",
-			 skb->dev->name);
-	return -EIO;
-}
-
-static void sky2_rx_unmap_skb(struct pci_dev *pdev, struct rx_ring_info *re)
+/* Return the pages of a ring element to the page pool */
+static void sky2_rx_put(struct sky2_port *sky2, struct rx_ring_info *re,
+			bool allow_direct)
 {
-	struct sk_buff *skb = re->skb;
 	int i;
 
-	pci_unmap_single(pdev, re->data_addr, dma_unmap_len(re, data_size),
-			 PCI_DMA_FROMDEVICE);
+	for (i = 0; i < sky2->rx_nfrags; i++)
+		page_pool_put_page(sky2->page_pool, re->frag_page[i],
+				   allow_direct);
 
-	for (i = 0; i < skb_shinfo(skb)->nr_frags; i++)
-		pci_unmap_page(pdev, re->frag_addr[i],
-			       skb_frag_size(&skb_shinfo(skb)->frags[i]),
-			       PCI_DMA_FROMDEVICE);
+	page_pool_put_page(sky2->page_pool, re->page, allow_direct);
+	re->page = NULL;
 }
 
 /* Tell chip where to start receive checksum.
@@ -1358,15 +1456,20 @@ static void sky2_rx_clean(struct sky2_port *sky2)
 	if (sky2->rx_le)
 		memset(sky2->rx_le, 0, RX_LE_BYTES);
 
+	if (!sky2->page_pool)
+		return;
+
 	for (i = 0; i < sky2->rx_pending; i++) {
 		struct rx_ring_info *re = sky2->rx_ring + i;
 
-		if (re->skb) {
-			sky2_rx_unmap_skb(sky2->hw->pdev, re);
-			kfree_skb(re->skb);
-			re->skb = NULL;
-		}
+		if (re->page)
+			sky2_rx_put(sky2, re, false);
 	}
+
+	if (xdp_rxq_info_is_reg(&sky2->xdp_rxq))
+		xdp_rxq_info_unreg(&sky2->xdp_rxq);
+	page_pool_destroy(sky2->page_pool);
+	sky2->page_pool = NULL;
 }
 
 /* Basic MII support */
@@ -1435,53 +1538,37 @@ static void sky2_vlan_mode(struct net_device *dev, netdev_features_t features)
 	}
 }
 
-/* Amount of required worst case padding in rx buffer */
-static inline unsigned sky2_rx_pad(const struct sky2_hw *hw)
-{
-	return (hw->flags & SKY2_HW_RAM_BUFFER) ? 8 : 2;
-}
-
 /*
- * Allocate an skb for receiving. If the MTU is large enough
- * make the skb non-linear with a fragment list of pages.
+ * Fill a ring element with receive buffers from the page pool. If the
+ * MTU is large enough the frame continues in a list of fragment pages.
  */
-static struct sk_buff *sky2_rx_alloc(struct sky2_port *sky2, gfp_t gfp)
+static int sky2_rx_alloc(struct sky2_port *sky2, struct rx_ring_info *re,
+			 gfp_t gfp)
 {
-	struct sk_buff *skb;
 	int i;
 
-	skb = __netdev_alloc_skb(sky2->netdev,
-				 sky2->rx_data_size + sky2_rx_pad(sky2->hw),
-				 gfp);
-	if (!skb)
+	re->page = page_pool_alloc_pages(sky2->page_pool, gfp);
+	if (!re->page)
 		goto nomem;
-
-	if (sky2->hw->flags & SKY2_HW_RAM_BUFFER) {
-		unsigned char *start;
-		/*
-		 * Workaround for a bug in FIFO that cause hang
-		 * if the FIFO if the receive buffer is not 64 byte aligned.
-		 * The buffer returned from netdev_alloc_skb is
-		 * aligned except if slab debugging is enabled.
-		 */
-		start = PTR_ALIGN(skb->data, 8);
-		skb_reserve(skb, start - skb->data);
-	} else
-		skb_reserve(skb, NET_IP_ALIGN);
+	re->data_addr = page_pool_get_dma_addr(re->page) +
+			sky2_rx_headroom(sky2->hw);
 
 	for (i = 0; i < sky2->rx_nfrags; i++) {
-		struct page *page = alloc_page(gfp);
-
-		if (!page)
+		re->frag_page[i] = page_pool_alloc_pages(sky2->page_pool, gfp);
+		if (!re->frag_page[i])
 			goto free_partial;
-		skb_fill_page_desc(skb, i, page, 0, PAGE_SIZE);
+		re->frag_addr[i] = page_pool_get_dma_addr(re->frag_page[i]);
 	}
 
-	return skb;
+	re->flags = 0;
+	return 0;
 free_partial:
-	kfree_skb(skb);
+	while (--i >= 0)
+		page_pool_put_page(sky2->page_pool, re->frag_page[i], false);
+	page_pool_put_page(sky2->page_pool, re->page, false);
+	re->page = NULL;
 nomem:
-	return NULL;
+	return -ENOMEM;
 }
 
 static inline void sky2_rx_update(struct sky2_port *sky2, unsigned rxq)
@@ -1489,26 +1576,43 @@ static inline void sky2_rx_update(struct sky2_port *sky2, unsigned rxq)
 	sky2_put_idx(sky2->hw, rxq, sky2->rx_put);
 }
 
-static int sky2_alloc_rx_skbs(struct sky2_port *sky2)
+static int sky2_alloc_rx_pages(struct sky2_port *sky2)
 {
 	struct sky2_hw *hw = sky2->hw;
+	struct page_pool_params pp = { 0 };
 	unsigned i;
+	int err;
 
 	sky2->rx_data_size = sky2_get_rx_data_size(sky2);
 
-	/* Fill Rx ring */
-	for (i = 0; i < sky2->rx_pending; i++) {
-		struct rx_ring_info *re = sky2->rx_ring + i;
+	/* One pool per port, the page pool does the DMA mapping */
+	pp.flags = PP_FLAG_DMA_MAP;
+	pp.order = 0;
+	pp.pool_size = sky2->rx_pending * (sky2->rx_nfrags + 1);
+	pp.nid = dev_to_node(&hw->pdev->dev);
+	pp.dev = &hw->pdev->dev;
+	pp.dma_dir = DMA_FROM_DEVICE;
+
+	sky2->page_pool = page_pool_create(&pp);
+	if (IS_ERR(sky2->page_pool)) {
+		err = PTR_ERR(sky2->page_pool);
+		sky2->page_pool = NULL;
+		return err;
+	}
 
-		re->skb = sky2_rx_alloc(sky2, GFP_KERNEL);
-		if (!re->skb)
-			return -ENOMEM;
+	err = xdp_rxq_info_reg(&sky2->xdp_rxq, sky2->netdev, 0);
+	if (err)
+		return err;
 
-		if (sky2_rx_map_skb(hw->pdev, re, sky2->rx_data_size)) {
-			dev_kfree_skb(re->skb);
-			re->skb = NULL;
+	err = xdp_rxq_info_reg_mem_model(&sky2->xdp_rxq, MEM_TYPE_PAGE_POOL,
+					 sky2->page_pool);
+	if (err)
+		return err;
+
+	/* Fill Rx ring */
+	for (i = 0; i < sky2->rx_pending; i++) {
+		if (sky2_rx_alloc(sky2, sky2->rx_ring + i, GFP_KERNEL))
 			return -ENOMEM;
-		}
 	}
 	return 0;
 }
@@ -1623,7 +1727,7 @@ static int sky2_alloc_buffers(struct sky2_port *sky2)
 	if (!sky2->rx_ring)
 		goto nomem;
 
-	return sky2_alloc_rx_skbs(sky2);
+	return sky2_alloc_rx_pages(sky2);
 nomem:
 	return -ENOMEM;
 }
@@ -1845,14 +1949,18 @@ static netdev_tx_t sky2_xmit_frame(struct sk_buff *skb,
 	u16 mss;
 	u8 ctrl;
 
- 	if (unlikely(tx_avail(sky2) < tx_le_req(skb)))
+ 	if (unlikely(tx_avail(sky2) < tx_le_req(skb))) {
+		/* Don't leave frames deferred by xmit_more behind */
+		sky2_put_idx(hw, txqaddr[sky2->port], sky2->tx_prod);
   		return NETDEV_TX_BUSY;
+	}
 
 	len = skb_headlen(skb);
 	mapping = pci_map_single(hw->pdev, skb->data, len, PCI_DMA_TODEVICE);
 
 	if (pci_dma_mapping_error(hw->pdev, mapping))
 		goto mapping_error;
+	sky2_count_bounce(&sky2->tx_bounced, hw->pdev, mapping, len);
 
 	slot = sky2->tx_prod;
 	netif_printk(sky2, tx_queued, KERN_DEBUG, dev,
@@ -1948,6 +2056,8 @@ static netdev_tx_t sky2_xmit_frame(struct sk_buff *skb,
 
 		if (dma_mapping_error(&hw->pdev->dev, mapping))
 			goto mapping_unwind;
+		sky2_count_bounce(&sky2->tx_bounced, hw->pdev, mapping,
+				  skb_frag_size(frag));
 
 		upper = upper_32_bits(mapping);
 		if (upper != sky2->tx_last_upper) {
@@ -1972,13 +2082,25 @@ static netdev_tx_t sky2_xmit_frame(struct sk_buff *skb,
 	re->skb = skb;
 	le->ctrl |= EOP;
 
+	sky2->tx_frames++;
+	sky2->tx_segs += skb_shinfo(skb)->gso_segs ?: 1;
+	sky2->tx_les += (slot - sky2->tx_prod) & (sky2->tx_ring_size - 1);
+	if (mss) {
+		int shift = READ_ONCE(tso_pacing_shift);
+
+		if (shift > 0 && shift <= 10)
+			sk_pacing_shift_update(skb->sk, shift);
+	}
+
 	sky2->tx_prod = slot;
+	skb_tx_timestamp(skb);
 
 	if (tx_avail(sky2) <= MAX_SKB_TX_LE)
 		netif_stop_queue(dev);
 
-	netdev_sent_queue(dev, skb->len);
-	sky2_put_idx(hw, txqaddr[sky2->port], sky2->tx_prod);
+	/* Defer the prefetch unit doorbell until the end of the burst */
+	if (__netdev_sent_queue(dev, skb->len, netdev_xmit_more()))
+		sky2_put_idx(hw, txqaddr[sky2->port], sky2->tx_prod);
 
 	return NETDEV_TX_OK;
 
@@ -1993,6 +2115,8 @@ static netdev_tx_t sky2_xmit_frame(struct sk_buff *skb,
 	if (net_ratelimit())
 		dev_warn(&hw->pdev->dev, "%s: tx mapping error\n", dev->name);
 	dev_kfree_skb_any(skb);
+	if (!netdev_xmit_more())
+		sky2_put_idx(hw, txqaddr[sky2->port], sky2->tx_prod);
 	return NETDEV_TX_OK;
 }
 
@@ -2011,6 +2135,7 @@ static void sky2_tx_complete(struct sky2_port *sky2, u16 done)
 	struct net_device *dev = sky2->netdev;
 	u16 idx;
 	unsigned int bytes_compl = 0, pkts_compl = 0;
+	unsigned int xdp_bytes = 0, xdp_pkts = 0;
 
 	BUG_ON(done >= sky2->tx_ring_size);
 
@@ -2031,6 +2156,15 @@ static void sky2_tx_complete(struct sky2_port *sky2, u16 done)
 			re->skb = NULL;
 			dev_kfree_skb_any(skb);
 
+			sky2->tx_next = RING_NEXT(idx, sky2->tx_ring_size);
+		} else if (re->xdpf) {
+			/* XDP frames are not accounted in BQL */
+			xdp_pkts++;
+			xdp_bytes += re->xdpf->len;
+
+			xdp_return_frame(re->xdpf);
+			re->xdpf = NULL;
+
 			sky2->tx_next = RING_NEXT(idx, sky2->tx_ring_size);
 		}
 	}
@@ -2041,8 +2175,8 @@ static void sky2_tx_complete(struct sky2_port *sky2, u16 done)
 	netdev_completed_queue(dev, pkts_compl, bytes_compl);
 
 	u64_stats_update_begin(&sky2->tx_stats.syncp);
-	sky2->tx_stats.packets += pkts_compl;
-	sky2->tx_stats.bytes += bytes_compl;
+	sky2->tx_stats.packets += pkts_compl + xdp_pkts;
+	sky2->tx_stats.bytes += bytes_compl + xdp_bytes;
 	u64_stats_update_end(&sky2->tx_stats.syncp);
 }
 
@@ -2383,6 +2517,13 @@ static void sky2_tx_timeout(struct net_device *dev)
 	schedule_work(&hw->restart_work);
 }
 
+/* XDP needs the whole frame in the header page */
+static bool sky2_xdp_mtu_ok(const struct sky2_port *sky2, int mtu)
+{
+	return roundup(mtu + ETH_HLEN + VLAN_HLEN, 8) <=
+		sky2_rx_max_data_size(sky2->hw);
+}
+
 static int sky2_change_mtu(struct net_device *dev, int new_mtu)
 {
 	struct sky2_port *sky2 = netdev_priv(dev);
@@ -2392,6 +2533,11 @@ static int sky2_change_mtu(struct net_device *dev, int new_mtu)
 	u16 ctl, mode;
 	u32 imask;
 
+	if (sky2->xdp_prog && !sky2_xdp_mtu_ok(sky2, new_mtu)) {
+		netdev_warn(dev, "MTU %d too large for XDP\n", new_mtu);
+		return -EINVAL;
+	}
+
 	if (!netif_running(dev)) {
 		dev->mtu = new_mtu;
 		netdev_update_features(dev);
@@ -2432,7 +2578,7 @@ static int sky2_change_mtu(struct net_device *dev, int new_mtu)
 
 	sky2_write8(hw, RB_ADDR(rxqaddr[port], RB_CTRL), RB_ENA_OP_MD);
 
-	err = sky2_alloc_rx_skbs(sky2);
+	err = sky2_alloc_rx_pages(sky2);
 	if (!err)
 		sky2_rx_start(sky2);
 	else
@@ -2453,9 +2599,12 @@ static int sky2_change_mtu(struct net_device *dev, int new_mtu)
 	return err;
 }
 
-static inline bool needs_copy(const struct rx_ring_info *re,
-			      unsigned length)
+static inline bool needs_copy(const struct sky2_port *sky2,
+			      const struct rx_ring_info *re, unsigned length)
 {
+	/* Only the header buffer can be copied from */
+	if (length > sky2->rx_data_size)
+		return false;
 #ifndef CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS
 	/* Some architectures need the IP header to be aligned */
 	if (!IS_ALIGNED(re->data_addr + ETH_HLEN, sizeof(u32)))
@@ -2464,7 +2613,20 @@ static inline bool needs_copy(const struct rx_ring_info *re,
 	return length < copybreak;
 }
 
-/* For small just reuse existing skb for next receive */
+/* Apply the status reported ahead of OP_RXSTAT to the received skb */
+static void sky2_rx_info(struct sk_buff *skb, const struct rx_ring_info *re)
+{
+	if (re->flags & RX_INFO_CSUM) {
+		skb->ip_summed = CHECKSUM_COMPLETE;
+		skb->csum = re->csum;
+	}
+	if (re->flags & RX_INFO_VLAN)
+		__vlan_hwaccel_put_tag(skb, htons(ETH_P_8021Q), re->vlan_tci);
+	if (re->flags & RX_INFO_HASH)
+		skb_set_hash(skb, re->hash, PKT_HASH_TYPE_L3);
+}
+
+/* For small just reuse existing pages for next receive */
 static struct sk_buff *receive_copy(struct sky2_port *sky2,
 				    const struct rx_ring_info *re,
 				    unsigned length)
@@ -2475,85 +2637,221 @@ static struct sk_buff *receive_copy(struct sky2_port *sky2,
 	if (likely(skb)) {
 		pci_dma_sync_single_for_cpu(sky2->hw->pdev, re->data_addr,
 					    length, PCI_DMA_FROMDEVICE);
-		skb_copy_from_linear_data(re->skb, skb->data, length);
-		skb->ip_summed = re->skb->ip_summed;
-		skb->csum = re->skb->csum;
-		skb_copy_hash(skb, re->skb);
-		__vlan_hwaccel_copy_tag(skb, re->skb);
+		sky2_count_bounce(&sky2->rx_bounced, sky2->hw->pdev,
+				  re->data_addr, length);
+		skb_copy_to_linear_data(skb, page_address(re->page) +
+					sky2_rx_headroom(sky2->hw), length);
+		sky2_rx_info(skb, re);
 
 		pci_dma_sync_single_for_device(sky2->hw->pdev, re->data_addr,
 					       length, PCI_DMA_FROMDEVICE);
-		__vlan_hwaccel_clear_tag(re->skb);
-		skb_clear_hash(re->skb);
-		re->skb->ip_summed = CHECKSUM_NONE;
 		skb_put(skb, length);
 	}
 	return skb;
 }
 
-/* Adjust length of skb with fragments to match received data */
-static void skb_put_frags(struct sk_buff *skb, unsigned int hdr_space,
-			  unsigned int length)
+/*
+ * Normal packet - build skb around the ring element pages and refill it.
+ * The caller has synced the header page, the frame starts at offset.
+ */
+static struct sk_buff *receive_new(struct sky2_port *sky2,
+				   struct rx_ring_info *re,
+				   unsigned int offset, unsigned int length)
 {
-	int i, num_frags;
+	struct pci_dev *pdev = sky2->hw->pdev;
+	struct sk_buff *skb;
+	struct rx_ring_info nre;
 	unsigned int size;
+	int i;
+
+	if (unlikely(sky2_rx_alloc(sky2, &nre, GFP_ATOMIC)))
+		return NULL;
+
+	prefetch(page_address(re->page) + offset);
+
+	skb = build_skb(page_address(re->page), PAGE_SIZE);
+	if (unlikely(!skb)) {
+		sky2_rx_put(sky2, &nre, true);
+		return NULL;
+	}
 
-	/* put header into skb */
-	size = min(length, hdr_space);
-	skb->tail += size;
-	skb->len += size;
+	/* Pages handed to the stack leave the pool */
+	page_pool_release_page(sky2->page_pool, re->page);
+	skb_reserve(skb, offset);
+
+	/* Without fragments XDP may have grown the frame into the headroom */
+	size = sky2->rx_nfrags ? min(length, (unsigned int) sky2->rx_data_size)
+			       : length;
+	skb_put(skb, size);
 	length -= size;
+	sky2_rx_info(skb, re);
 
-	num_frags = skb_shinfo(skb)->nr_frags;
-	for (i = 0; i < num_frags; i++) {
-		skb_frag_t *frag = &skb_shinfo(skb)->frags[i];
+	for (i = 0; i < sky2->rx_nfrags; i++) {
+		struct page *page = re->frag_page[i];
 
 		if (length == 0) {
 			/* don't need this page */
-			__skb_frag_unref(frag);
-			--skb_shinfo(skb)->nr_frags;
-		} else {
-			size = min(length, (unsigned) PAGE_SIZE);
-
-			skb_frag_size_set(frag, size);
-			skb->data_len += size;
-			skb->truesize += PAGE_SIZE;
-			skb->len += size;
-			length -= size;
+			page_pool_recycle_direct(sky2->page_pool, page);
+			continue;
 		}
+
+		size = min(length, (unsigned int) PAGE_SIZE);
+		pci_dma_sync_single_for_cpu(pdev, re->frag_addr[i], size,
+					    PCI_DMA_FROMDEVICE);
+		sky2_count_bounce(&sky2->rx_bounced, pdev, re->frag_addr[i],
+				  size);
+		page_pool_release_page(sky2->page_pool, page);
+		skb_add_rx_frag(skb, skb_shinfo(skb)->nr_frags, page, 0,
+				size, PAGE_SIZE);
+		length -= size;
 	}
+
+	*re = nre;
+	return skb;
 }
 
-/* Normal packet - take skb from ring element and put in a new one  */
-static struct sk_buff *receive_new(struct sky2_port *sky2,
-				   struct rx_ring_info *re,
-				   unsigned int length)
+/* Queue an XDP_TX frame, caller holds the tx queue lock */
+static int sky2_xdp_xmit_frame(struct sky2_port *sky2, struct xdp_frame *xdpf)
 {
-	struct sk_buff *skb;
-	struct rx_ring_info nre;
-	unsigned hdr_space = sky2->rx_data_size;
+	struct sky2_hw *hw = sky2->hw;
+	struct tx_ring_info *re;
+	struct sky2_tx_le *le;
+	dma_addr_t mapping;
+	u32 upper;
+	u16 slot;
 
-	nre.skb = sky2_rx_alloc(sky2, GFP_ATOMIC);
-	if (unlikely(!nre.skb))
-		goto nobuf;
+	/* Always leave room for one full skb from sky2_xmit_frame */
+	if (unlikely(tx_avail(sky2) <= MAX_SKB_TX_LE))
+		return -ENOSPC;
 
-	if (sky2_rx_map_skb(sky2->hw->pdev, &nre, hdr_space))
-		goto nomap;
+	mapping = pci_map_single(hw->pdev, xdpf->data, xdpf->len,
+				 PCI_DMA_TODEVICE);
+	if (pci_dma_mapping_error(hw->pdev, mapping))
+		return -ENOMEM;
+	sky2_count_bounce(&sky2->tx_bounced, hw->pdev, mapping, xdpf->len);
 
-	skb = re->skb;
-	sky2_rx_unmap_skb(sky2->hw->pdev, re);
-	prefetch(skb->data);
-	*re = nre;
+	slot = sky2->tx_prod;
 
-	if (skb_shinfo(skb)->nr_frags)
-		skb_put_frags(skb, hdr_space, length);
-	else
-		skb_put(skb, length);
-	return skb;
+	/* Send high bits if needed */
+	upper = upper_32_bits(mapping);
+	if (upper != sky2->tx_last_upper) {
+		le = get_tx_le(sky2, &slot);
+		le->addr = cpu_to_le32(upper);
+		sky2->tx_last_upper = upper;
+		le->opcode = OP_ADDR64 | HW_OWNER;
+	}
+
+	re = sky2->tx_ring + slot;
+	re->flags = TX_MAP_SINGLE;
+	re->xdpf = xdpf;
+	dma_unmap_addr_set(re, mapaddr, mapping);
+	dma_unmap_len_set(re, maplen, xdpf->len);
+
+	le = get_tx_le(sky2, &slot);
+	le->addr = cpu_to_le32(lower_32_bits(mapping));
+	le->length = cpu_to_le16(xdpf->len);
+	le->ctrl = EOP;
+	le->opcode = OP_PACKET | HW_OWNER;
+
+	sky2->tx_prod = slot;
+	return 0;
+}
+
+static int sky2_xdp_tx(struct sky2_port *sky2, struct xdp_buff *xdp)
+{
+	struct netdev_queue *txq = netdev_get_tx_queue(sky2->netdev, 0);
+	struct xdp_frame *xdpf = convert_to_xdp_frame(xdp);
+	int err;
+
+	if (unlikely(!xdpf))
+		return -EOVERFLOW;
+
+	__netif_tx_lock(txq, smp_processor_id());
+	err = sky2_xdp_xmit_frame(sky2, xdpf);
+	__netif_tx_unlock(txq);
+
+	return err;
+}
+
+/* Kick transmit and flush redirects queued during this poll */
+static void sky2_xdp_flush(struct sky2_port *sky2)
+{
+	if (sky2->xdp_flush & SKY2_XDP_TX) {
+		struct netdev_queue *txq = netdev_get_tx_queue(sky2->netdev, 0);
+
+		__netif_tx_lock(txq, smp_processor_id());
+		sky2_put_idx(sky2->hw, txqaddr[sky2->port], sky2->tx_prod);
+		__netif_tx_unlock(txq);
+	}
+
+	if (sky2->xdp_flush & SKY2_XDP_REDIRECT)
+		xdp_do_flush_map();
+
+	sky2->xdp_flush = 0;
+}
+
+/*
+ * Run the XDP program on a received frame.
+ * Returns the skb for XDP_PASS. Dropped frames leave their pages in the
+ * ring element, frames sent or redirected are replaced by new pages.
+ */
+static struct sk_buff *sky2_rx_xdp(struct sky2_port *sky2,
+				   struct bpf_prog *prog,
+				   struct rx_ring_info *re,
+				   unsigned int length)
+{
+	struct net_device *dev = sky2->netdev;
+	struct rx_ring_info nre;
+	struct xdp_buff xdp;
+	u32 act;
+
+	pci_dma_sync_single_for_cpu(sky2->hw->pdev, re->data_addr, length,
+				    PCI_DMA_FROMDEVICE);
+	sky2_count_bounce(&sky2->rx_bounced, sky2->hw->pdev, re->data_addr,
+			  length);
+
+	xdp.data_hard_start = page_address(re->page);
+	xdp.data = xdp.data_hard_start + sky2_rx_headroom(sky2->hw);
+	xdp_set_data_meta_invalid(&xdp);
+	xdp.data_end = xdp.data + length;
+	xdp.rxq = &sky2->xdp_rxq;
+
+	act = bpf_prog_run_xdp(prog, &xdp);
+	switch (act) {
+	case XDP_PASS:
+		return receive_new(sky2, re, xdp.data - xdp.data_hard_start,
+				   xdp.data_end - xdp.data);
+	case XDP_TX:
+		if (unlikely(sky2_rx_alloc(sky2, &nre, GFP_ATOMIC)))
+			break;
+		if (unlikely(sky2_xdp_tx(sky2, &xdp))) {
+			sky2_rx_put(sky2, &nre, true);
+			trace_xdp_exception(dev, prog, act);
+			break;
+		}
+		*re = nre;
+		sky2->xdp_flush |= SKY2_XDP_TX;
+		break;
+	case XDP_REDIRECT:
+		if (unlikely(sky2_rx_alloc(sky2, &nre, GFP_ATOMIC)))
+			break;
+		if (unlikely(xdp_do_redirect(dev, &xdp, prog))) {
+			sky2_rx_put(sky2, &nre, true);
+			break;
+		}
+		*re = nre;
+		sky2->xdp_flush |= SKY2_XDP_REDIRECT;
+		break;
+	default:
+		bpf_warn_invalid_xdp_action(act);
+		/* fall through */
+	case XDP_ABORTED:
+		trace_xdp_exception(dev, prog, act);
+		/* fall through */
+	case XDP_DROP:
+		break;
+	}
 
-nomap:
-	dev_kfree_skb(nre.skb);
-nobuf:
 	return NULL;
 }
 
@@ -2567,6 +2865,7 @@ static struct sk_buff *sky2_receive(struct net_device *dev,
  	struct sky2_port *sky2 = netdev_priv(dev);
 	struct rx_ring_info *re = sky2->rx_ring + sky2->rx_next;
 	struct sk_buff *skb = NULL;
+	struct bpf_prog *prog;
 	u16 count = (status & GMR_FS_LEN) >> 16;
 
 	netif_printk(sky2, rx_status, KERN_DEBUG, dev,
@@ -2576,7 +2875,7 @@ static struct sk_buff *sky2_receive(struct net_device *dev,
 	sky2->rx_next = (sky2->rx_next + 1) % sky2->rx_pending;
 	prefetch(sky2->rx_ring + sky2->rx_next);
 
-	if (skb_vlan_tag_present(re->skb))
+	if (re->flags & RX_INFO_VLAN)
 		count -= VLAN_HLEN;	/* Account for vlan tag */
 
 	/* This chip has hardware problems that generates bogus status.
@@ -2599,14 +2898,27 @@ static struct sk_buff *sky2_receive(struct net_device *dev,
 		goto error;
 
 okay:
-	if (needs_copy(re, length))
+	rcu_read_lock();
+	prog = READ_ONCE(sky2->xdp_prog);
+	if (prog)
+		skb = sky2_rx_xdp(sky2, prog, re, length);
+	else if (needs_copy(sky2, re, length))
 		skb = receive_copy(sky2, re, length);
-	else
-		skb = receive_new(sky2, re, length);
+	else {
+		pci_dma_sync_single_for_cpu(sky2->hw->pdev, re->data_addr,
+					    min(length, sky2->rx_data_size),
+					    PCI_DMA_FROMDEVICE);
+		sky2_count_bounce(&sky2->rx_bounced, sky2->hw->pdev,
+				  re->data_addr, min(length, sky2->rx_data_size));
+		skb = receive_new(sky2, re, sky2_rx_headroom(sky2->hw),
+				  length);
+	}
+	rcu_read_unlock();
 
 	dev->stats.rx_dropped += (skb == NULL);
 
 resubmit:
+	re->flags = 0;
 	sky2_rx_submit(sky2, re);
 
 	return skb;
@@ -2638,9 +2950,11 @@ static inline void sky2_tx_done(struct net_device *dev, u16 last)
 static inline void sky2_skb_rx(const struct sky2_port *sky2,
 			       struct sk_buff *skb)
 {
-	if (skb->ip_summed == CHECKSUM_NONE)
+	if (skb->ip_summed == CHECKSUM_NONE) {
+		/* GRO marks its own; sockets need the id to busy poll us */
+		skb_mark_napi_id(skb, &sky2->hw->napi);
 		netif_receive_skb(skb);
-	else
+	} else
 		napi_gro_receive(&sky2->hw->napi, skb);
 }
 
@@ -2660,6 +2974,9 @@ static inline void sky2_rx_done(struct sky2_hw *hw, unsigned port,
 
 	sky2->last_rx = jiffies;
 	sky2_rx_update(netdev_priv(dev), rxqaddr[port]);
+
+	if (sky2->xdp_flush)
+		sky2_xdp_flush(sky2);
 }
 
 static void sky2_rx_checksum(struct sky2_port *sky2, u32 status)
@@ -2673,9 +2990,10 @@ static void sky2_rx_checksum(struct sky2_port *sky2, u32 status)
 	 * hardware receive checksumming won't work.
 	 */
 	if (likely((u16)(status >> 16) == (u16)status)) {
-		struct sk_buff *skb = sky2->rx_ring[sky2->rx_next].skb;
-		skb->ip_summed = CHECKSUM_COMPLETE;
-		skb->csum = le16_to_cpu(status);
+		struct rx_ring_info *re = sky2->rx_ring + sky2->rx_next;
+
+		re->csum = le16_to_cpu(status);
+		re->flags |= RX_INFO_CSUM;
 	} else {
 		dev_notice(&sky2->hw->pdev->dev,
 			   "%s: receive checksum problem (status = %#x)\n",
@@ -2693,18 +3011,18 @@ static void sky2_rx_checksum(struct sky2_port *sky2, u32 status)
 
 static void sky2_rx_tag(struct sky2_port *sky2, u16 length)
 {
-	struct sk_buff *skb;
+	struct rx_ring_info *re = sky2->rx_ring + sky2->rx_next;
 
-	skb = sky2->rx_ring[sky2->rx_next].skb;
-	__vlan_hwaccel_put_tag(skb, htons(ETH_P_8021Q), be16_to_cpu(length));
+	re->vlan_tci = be16_to_cpu(length);
+	re->flags |= RX_INFO_VLAN;
 }
 
 static void sky2_rx_hash(struct sky2_port *sky2, u32 status)
 {
-	struct sk_buff *skb;
+	struct rx_ring_info *re = sky2->rx_ring + sky2->rx_next;
 
-	skb = sky2->rx_ring[sky2->rx_next].skb;
-	skb_set_hash(skb, le32_to_cpu(status), PKT_HASH_TYPE_L3);
+	re->hash = le32_to_cpu(status);
+	re->flags |= RX_INFO_HASH;
 }
 
 /* Process status response ring */
@@ -2713,6 +3031,8 @@ static int sky2_status_intr(struct sky2_hw *hw, int to_do, u16 idx)
 	int work_done = 0;
 	unsigned int total_bytes[2] = { 0 };
 	unsigned int total_packets[2] = { 0 };
+	bool tx_pending = false;
+	u16 tx_done[2] = { 0 };
 
 	if (to_do <= 0)
 		return work_done;
@@ -2784,12 +3104,14 @@ static int sky2_status_intr(struct sky2_hw *hw, int to_do, u16 idx)
 			break;
 
 		case OP_TXINDEXLE:
-			/* TX index reports status for both ports */
-			sky2_tx_done(hw->dev[0], status & 0xfff);
-			if (hw->dev[1])
-				sky2_tx_done(hw->dev[1],
-				     ((status >> 24) & 0xff)
-					     | (u16)(length & 0xf) << 8);
+			/* TX index reports status for both ports.
+			 * The index is cumulative, so only the last one
+			 * in this pass needs to be processed.
+			 */
+			tx_done[0] = status & 0xfff;
+			tx_done[1] = ((status >> 24) & 0xff)
+				     | (u16)(length & 0xf) << 8;
+			tx_pending = true;
 			break;
 
 		default:
@@ -2802,6 +3124,12 @@ static int sky2_status_intr(struct sky2_hw *hw, int to_do, u16 idx)
 	sky2_write32(hw, STAT_CTRL, SC_STAT_CLR_IRQ);
 
 exit_loop:
+	if (tx_pending) {
+		sky2_tx_done(hw->dev[0], tx_done[0]);
+		if (hw->dev[1])
+			sky2_tx_done(hw->dev[1], tx_done[1]);
+	}
+
 	sky2_rx_done(hw, 0, total_packets[0], total_bytes[0]);
 	sky2_rx_done(hw, 1, total_packets[1], total_bytes[1]);
 
@@ -3026,13 +3354,67 @@ static void sky2_err_intr(struct sky2_hw *hw, u32 status)
 		sky2_le_error(hw, 1, Q_XA2);
 }
 
+static void sky2_poll_time(struct sky2_hw *hw, u64 start)
+{
+	u64 delta = ktime_get_ns() - start;
+
+	hw->lat.polls++;
+	hw->lat.poll_ns += delta;
+	hw->lat.poll_max_ns = max(hw->lat.poll_max_ns, delta);
+}
+
+/* Feed the status ring activity of both ports to net_dim */
+static void sky2_dim_update(struct sky2_hw *hw)
+{
+	struct dim_sample sample = {};
+	u64 rx_packets = 0, rx_bytes = 0;
+	u64 tx_packets = 0, tx_bytes = 0;
+	int i;
+
+	for (i = 0; i < hw->ports; i++) {
+		struct sky2_port *sky2;
+
+		if (!hw->dev[i])
+			continue;
+
+		sky2 = netdev_priv(hw->dev[i]);
+		rx_packets += sky2->rx_stats.packets;
+		rx_bytes += sky2->rx_stats.bytes;
+		tx_packets += sky2->tx_stats.packets;
+		tx_bytes += sky2->tx_stats.bytes;
+	}
+
+	hw->dim_events++;
+
+	if (hw->flags & SKY2_HW_RX_DIM) {
+		dim_update_sample(hw->dim_events, rx_packets, rx_bytes, &sample);
+		net_dim(&hw->rx_dim, sample);
+	}
+
+	if (hw->flags & SKY2_HW_TX_DIM) {
+		dim_update_sample(hw->dim_events, tx_packets, tx_bytes, &sample);
+		net_dim(&hw->tx_dim, sample);
+	}
+}
+
 static int sky2_poll(struct napi_struct *napi, int work_limit)
 {
 	struct sky2_hw *hw = container_of(napi, struct sky2_hw, napi);
+	u64 start = ktime_get_ns();
 	u32 status = sky2_read32(hw, B0_Y2_SP_EISR);
 	int work_done = 0;
 	u16 idx;
 
+	/* Time from the interrupt to its poll */
+	if (hw->lat.irq_stamp) {
+		u64 delta = start - hw->lat.irq_stamp;
+
+		hw->lat.irq_ns += delta;
+		hw->lat.irq_max_ns = max(hw->lat.irq_max_ns, delta);
+		hw->lat.irqs++;
+		hw->lat.irq_stamp = 0;
+	}
+
 	if (unlikely(status & Y2_IS_ERROR))
 		sky2_err_intr(hw, status);
 
@@ -3046,15 +3428,29 @@ static int sky2_poll(struct napi_struct *napi, int work_limit)
 		sky2_qlink_intr(hw);
 
 	while ((idx = sky2_read16(hw, STAT_PUT_IDX)) != hw->st_idx) {
+		u32 pending = (idx - hw->st_idx) & (hw->st_size - 1);
+
+		hw->lat.st_entries += pending;
+		hw->lat.st_max = max(hw->lat.st_max, pending);
+		hw->lat.st_samples++;
+
 		work_done += sky2_status_intr(hw, work_limit - work_done, idx);
 
 		if (work_done >= work_limit)
 			goto done;
 	}
 
-	napi_complete_done(napi, work_done);
-	sky2_read32(hw, B0_Y2_SP_LISR);
+	if (hw->flags & (SKY2_HW_RX_DIM | SKY2_HW_TX_DIM))
+		sky2_dim_update(hw);
+
+	/* A busy-polling socket owns the NAPI context and will call us again;
+	 * leave the interrupt masked (reading EISR above masked it) until the
+	 * final poll when busy polling stops and napi_complete_done succeeds.
+	 */
+	if (napi_complete_done(napi, work_done))
+		sky2_read32(hw, B0_Y2_SP_LISR);
 done:
+	sky2_poll_time(hw, start);
 
 	return work_done;
 }
@@ -3073,6 +3469,8 @@ static irqreturn_t sky2_intr(int irq, void *dev_id)
 
 	prefetch(&hw->st_le[hw->st_idx]);
 
+	if (!hw->lat.irq_stamp)
+		hw->lat.irq_stamp = ktime_get_ns();
 	napi_schedule(&hw->napi);
 
 	return IRQ_HANDLED;
@@ -3125,6 +3523,32 @@ static inline u32 sky2_clk2us(const struct sky2_hw *hw, u32 clk)
 	return clk / sky2_mhz(hw);
 }
 
+static void sky2_rx_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct sky2_hw *hw = container_of(dim, struct sky2_hw, rx_dim);
+	struct dim_cq_moder moder;
+
+	moder = net_dim_get_rx_moderation(dim->mode, dim->profile_ix);
+	sky2_write32(hw, STAT_LEV_TIMER_INI, sky2_us2clk(hw, moder.usec));
+	sky2_write8(hw, STAT_LEV_TIMER_CTRL, TIM_START);
+
+	dim->state = DIM_START_MEASURE;
+}
+
+static void sky2_tx_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct sky2_hw *hw = container_of(dim, struct sky2_hw, tx_dim);
+	struct dim_cq_moder moder;
+
+	moder = net_dim_get_tx_moderation(dim->mode, dim->profile_ix);
+	sky2_write32(hw, STAT_TX_TIMER_INI, sky2_us2clk(hw, moder.usec));
+	sky2_write8(hw, STAT_TX_TIMER_CTRL, TIM_START);
+
+	dim->state = DIM_START_MEASURE;
+}
+
 
 static int sky2_init(struct sky2_hw *hw)
 {
@@ -3322,8 +3746,9 @@ static void sky2_reset(struct sky2_hw *hw)
 	}
 #ifdef CONFIG_X86_PS4
 	if (pdev->vendor == PCI_VENDOR_ID_SONY &&
-	    pdev->device == PCI_DEVICE_ID_SONY_AEOLIA_GBE) {
-		; /* Do not perform phy resets on aeolia, it will hang */
+	    (pdev->device == PCI_DEVICE_ID_SONY_AEOLIA_GBE ||
+	     pdev->device == PCI_DEVICE_ID_SONY_BAIKAL_GBE)) {
+		; /* Do not perform phy resets on aeolia/baikal, it will hang */
 	} else
   #endif
 	if (hw->chip_id == CHIP_ID_YUKON_OPT ||
@@ -3766,6 +4191,24 @@ static const struct sky2_stat {
 	{ "tx_fifo_underrun", GM_TXE_FIFO_UR },
 };
 
+/* Driver probes, the status ring and NAPI ones are shared by both ports */
+static const char sky2_sw_stats[][ETH_GSTRING_LEN] = {
+	"rx_bounced_bytes",
+	"tx_bounced_bytes",
+	"tx_frames",
+	"tx_segments",
+	"tx_list_elements",
+	"napi_polls",
+	"napi_poll_ns",
+	"napi_poll_max_ns",
+	"irq_to_poll_count",
+	"irq_to_poll_ns",
+	"irq_to_poll_max_ns",
+	"status_ring_samples",
+	"status_ring_entries",
+	"status_ring_max",
+};
+
 static u32 sky2_get_msglevel(struct net_device *netdev)
 {
 	struct sky2_port *sky2 = netdev_priv(netdev);
@@ -3808,7 +4251,7 @@ static int sky2_get_sset_count(struct net_device *dev, int sset)
 {
 	switch (sset) {
 	case ETH_SS_STATS:
-		return ARRAY_SIZE(sky2_stats);
+		return ARRAY_SIZE(sky2_stats) + ARRAY_SIZE(sky2_sw_stats);
 	default:
 		return -EOPNOTSUPP;
 	}
@@ -3818,8 +4261,25 @@ static void sky2_get_ethtool_stats(struct net_device *dev,
 				   struct ethtool_stats *stats, u64 * data)
 {
 	struct sky2_port *sky2 = netdev_priv(dev);
+	const struct sky2_hw *hw = sky2->hw;
 
 	sky2_phy_stats(sky2, data, ARRAY_SIZE(sky2_stats));
+
+	data += ARRAY_SIZE(sky2_stats);
+	*data++ = sky2->rx_bounced;
+	*data++ = sky2->tx_bounced;
+	*data++ = sky2->tx_frames;
+	*data++ = sky2->tx_segs;
+	*data++ = sky2->tx_les;
+	*data++ = hw->lat.polls;
+	*data++ = hw->lat.poll_ns;
+	*data++ = hw->lat.poll_max_ns;
+	*data++ = hw->lat.irqs;
+	*data++ = hw->lat.irq_ns;
+	*data++ = hw->lat.irq_max_ns;
+	*data++ = hw->lat.st_samples;
+	*data++ = hw->lat.st_entries;
+	*data++ = hw->lat.st_max;
 }
 
 static void sky2_get_strings(struct net_device *dev, u32 stringset, u8 * data)
@@ -3831,6 +4291,8 @@ static void sky2_get_strings(struct net_device *dev, u32 stringset, u8 * data)
 		for (i = 0; i < ARRAY_SIZE(sky2_stats); i++)
 			memcpy(data + i * ETH_GSTRING_LEN,
 			       sky2_stats[i].name, ETH_GSTRING_LEN);
+		data += ARRAY_SIZE(sky2_stats) * ETH_GSTRING_LEN;
+		memcpy(data, sky2_sw_stats, sizeof(sky2_sw_stats));
 		break;
 	}
 }
@@ -4110,6 +4572,9 @@ static int sky2_get_coalesce(struct net_device *dev,
 
 	ecmd->rx_max_coalesced_frames_irq = sky2_read8(hw, STAT_FIFO_ISR_WM);
 
+	ecmd->use_adaptive_rx_coalesce = !!(hw->flags & SKY2_HW_RX_DIM);
+	ecmd->use_adaptive_tx_coalesce = !!(hw->flags & SKY2_HW_TX_DIM);
+
 	return 0;
 }
 
@@ -4133,21 +4598,36 @@ static int sky2_set_coalesce(struct net_device *dev,
 	if (ecmd->rx_max_coalesced_frames_irq > RX_MAX_PENDING)
 		return -EINVAL;
 
-	if (ecmd->tx_coalesce_usecs == 0)
-		sky2_write8(hw, STAT_TX_TIMER_CTRL, TIM_STOP);
+	/* With adaptive moderation net_dim owns the timer */
+	if (ecmd->use_adaptive_tx_coalesce)
+		hw->flags |= SKY2_HW_TX_DIM;
 	else {
-		sky2_write32(hw, STAT_TX_TIMER_INI,
-			     sky2_us2clk(hw, ecmd->tx_coalesce_usecs));
-		sky2_write8(hw, STAT_TX_TIMER_CTRL, TIM_START);
+		hw->flags &= ~SKY2_HW_TX_DIM;
+		cancel_work_sync(&hw->tx_dim.work);
+
+		if (ecmd->tx_coalesce_usecs == 0)
+			sky2_write8(hw, STAT_TX_TIMER_CTRL, TIM_STOP);
+		else {
+			sky2_write32(hw, STAT_TX_TIMER_INI,
+				     sky2_us2clk(hw, ecmd->tx_coalesce_usecs));
+			sky2_write8(hw, STAT_TX_TIMER_CTRL, TIM_START);
+		}
 	}
 	sky2_write16(hw, STAT_TX_IDX_TH, ecmd->tx_max_coalesced_frames);
 
-	if (ecmd->rx_coalesce_usecs == 0)
-		sky2_write8(hw, STAT_LEV_TIMER_CTRL, TIM_STOP);
+	if (ecmd->use_adaptive_rx_coalesce)
+		hw->flags |= SKY2_HW_RX_DIM;
 	else {
-		sky2_write32(hw, STAT_LEV_TIMER_INI,
-			     sky2_us2clk(hw, ecmd->rx_coalesce_usecs));
-		sky2_write8(hw, STAT_LEV_TIMER_CTRL, TIM_START);
+		hw->flags &= ~SKY2_HW_RX_DIM;
+		cancel_work_sync(&hw->rx_dim.work);
+
+		if (ecmd->rx_coalesce_usecs == 0)
+			sky2_write8(hw, STAT_LEV_TIMER_CTRL, TIM_STOP);
+		else {
+			sky2_write32(hw, STAT_LEV_TIMER_INI,
+				     sky2_us2clk(hw, ecmd->rx_coalesce_usecs));
+			sky2_write8(hw, STAT_LEV_TIMER_CTRL, TIM_START);
+		}
 	}
 	sky2_write8(hw, STAT_FIFO_WM, ecmd->rx_max_coalesced_frames);
 
@@ -4452,6 +4932,7 @@ static const struct ethtool_ops sky2_ethtool_ops = {
 	.set_phys_id	= sky2_set_phys_id,
 	.get_sset_count = sky2_get_sset_count,
 	.get_ethtool_stats = sky2_get_ethtool_stats,
+	.get_ts_info	= ethtool_op_get_ts_info,
 	.get_link_ksettings = sky2_get_link_ksettings,
 	.set_link_ksettings = sky2_set_link_ksettings,
 };
@@ -4709,6 +5190,39 @@ static __exit void sky2_debug_cleanup(void)
 #define sky2_debug_cleanup()
 #endif
 
+static int sky2_xdp_setup(struct net_device *dev, struct bpf_prog *prog,
+			  struct netlink_ext_ack *extack)
+{
+	struct sky2_port *sky2 = netdev_priv(dev);
+	struct bpf_prog *old;
+
+	if (prog && !sky2_xdp_mtu_ok(sky2, dev->mtu)) {
+		NL_SET_ERR_MSG_MOD(extack, "MTU too large for XDP");
+		return -EOPNOTSUPP;
+	}
+
+	old = xchg(&sky2->xdp_prog, prog);
+	if (old)
+		bpf_prog_put(old);
+
+	return 0;
+}
+
+static int sky2_xdp(struct net_device *dev, struct netdev_bpf *xdp)
+{
+	struct sky2_port *sky2 = netdev_priv(dev);
+
+	switch (xdp->command) {
+	case XDP_SETUP_PROG:
+		return sky2_xdp_setup(dev, xdp->prog, xdp->extack);
+	case XDP_QUERY_PROG:
+		xdp->prog_id = sky2->xdp_prog ? sky2->xdp_prog->aux->id : 0;
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
 /* Two copies of network device operations to handle special case of
    not allowing netpoll on second port */
 static const struct net_device_ops sky2_netdev_ops[2] = {
@@ -4725,6 +5239,7 @@ static const struct net_device_ops sky2_netdev_ops[2] = {
 	.ndo_set_features	= sky2_set_features,
 	.ndo_tx_timeout		= sky2_tx_timeout,
 	.ndo_get_stats64	= sky2_get_stats,
+	.ndo_bpf		= sky2_xdp,
 #ifdef CONFIG_NET_POLL_CONTROLLER
 	.ndo_poll_controller	= sky2_netpoll,
 #endif
@@ -4742,14 +5257,18 @@ static const struct net_device_ops sky2_netdev_ops[2] = {
 	.ndo_set_features	= sky2_set_features,
 	.ndo_tx_timeout		= sky2_tx_timeout,
 	.ndo_get_stats64	= sky2_get_stats,
+	.ndo_bpf		= sky2_xdp,
   },
 };
 #ifdef CONFIG_X86_PS4
 /* NOTE: This region is no longer referenced by current ps4 x86 code. */
 /* However it still contains the mac address. */
-static void aeolia_get_mac_address(struct sky2_hw *hw, unsigned char *addr) {
+static void ps4_get_mac_address(struct sky2_hw *hw, unsigned char *addr,
+				unsigned int mem_func, unsigned int bp_offset,
+				unsigned int bp_size)
+{
 	u8 default_addr[ETH_ALEN] = { 0x52, 0x54, 0x00, 0xf0, 0xff, 0x0f };
-	unsigned int mem_devfn = PCI_DEVFN(PCI_SLOT(hw->pdev->devfn), AEOLIA_FUNC_ID_MEM);
+	unsigned int mem_devfn = PCI_DEVFN(PCI_SLOT(hw->pdev->devfn), mem_func);
 	struct pci_dev *mem_dev;
 	phys_addr_t bp_base;
 	void __iomem *bp;
@@ -4762,13 +5281,13 @@ static void aeolia_get_mac_address(struct sky2_hw *hw, unsigned char *addr) {
 		return;
 	}
 
-	bp_base = pci_resource_start(mem_dev, 5) + APCIE_SPM_BP_BASE;
-	if (!request_mem_region(bp_base, APCIE_SPM_BP_SIZE, "spm.bp")) {
+	bp_base = pci_resource_start(mem_dev, 5) + bp_offset;
+	if (!request_mem_region(bp_base, bp_size, "spm.bp")) {
 		dev_err(&hw->pdev->dev, "sky2: failed to request bootparam SPM region\n");
-		return;
+		goto put_mem;
 	}
 
-	bp = ioremap(bp_base, APCIE_SPM_BP_SIZE);
+	bp = ioremap(bp_base, bp_size);
 	if (!bp) {
 		dev_err(&hw->pdev->dev, "sky2: failed to map bootparam portion of SPM\n");
 		goto release_bp;
@@ -4778,7 +5297,22 @@ static void aeolia_get_mac_address(struct sky2_hw *hw, unsigned char *addr) {
 
 	iounmap(bp);
 release_bp:
-	release_mem_region(bp_base, APCIE_SPM_BP_SIZE);
+	release_mem_region(bp_base, bp_size);
+put_mem:
+	pci_dev_put(mem_dev);
+}
+
+static void aeolia_get_mac_address(struct sky2_hw *hw, unsigned char *addr)
+{
+	ps4_get_mac_address(hw, addr, AEOLIA_FUNC_ID_MEM,
+			    APCIE_SPM_BP_BASE, APCIE_SPM_BP_SIZE);
+}
+
+/* Baikal keeps the same bootparam block in the SPM of its MEM function */
+static void baikal_get_mac_address(struct sky2_hw *hw, unsigned char *addr)
+{
+	ps4_get_mac_address(hw, addr, BAIKAL_FUNC_ID_MEM,
+			    BPCIE_SPM_BP_BASE, BPCIE_SPM_BP_SIZE);
 }
 #endif
 /* Initialize network device */
@@ -4853,7 +5387,10 @@ static struct net_device *sky2_init_netdev(struct sky2_hw *hw, unsigned port,
 	else
 		dev->max_mtu = ETH_JUMBO_MTU;
 #ifdef CONFIG_X86_PS4
-	if (hw->pdev->vendor == PCI_VENDOR_ID_SONY) {
+	if (hw->pdev->vendor == PCI_VENDOR_ID_SONY &&
+	    hw->pdev->device == PCI_DEVICE_ID_SONY_BAIKAL_GBE) {
+		baikal_get_mac_address(hw, dev->dev_addr);
+	} else if (hw->pdev->vendor == PCI_VENDOR_ID_SONY) {
 		aeolia_get_mac_address(hw, dev->dev_addr);
 	} else
 #endif
@@ -5020,8 +5557,12 @@ static int sky2_probe(struct pci_dev *pdev, const struct pci_device_id *ent)
 	u32 reg;
 	char buf1[16];
 #ifdef CONFIG_X86_PS4
-	/* This will return negative on non-PS4 platforms */
-	if (apcie_status() == 0)
+	/* These will return negative on non-PS4 platforms */
+	if (pdev->vendor == PCI_VENDOR_ID_SONY &&
+	    pdev->device == PCI_DEVICE_ID_SONY_BAIKAL_GBE) {
+		if (bpcie_status() == 0)
+			return -EPROBE_DEFER;
+	} else if (apcie_status() == 0)
 		return -EPROBE_DEFER;
 #endif
 	err = pci_enable_device(pdev);
@@ -5136,6 +5677,10 @@ static int sky2_probe(struct pci_dev *pdev, const struct pci_device_id *ent)
 		 sky2_name(hw->chip_id, buf1, sizeof(buf1)), hw->chip_rev);
 
 	sky2_reset(hw);
+#ifdef CONFIG_X86_PS4
+	if (hw->phy_addr == 1)
+		sky2_probe_l2_switch(hw);
+#endif
 
 	dev = sky2_init_netdev(hw, 0, using_dac, wol_default);
 	if (!dev) {
@@ -5145,6 +5690,16 @@ static int sky2_probe(struct pci_dev *pdev, const struct pci_device_id *ent)
 
 #ifdef CONFIG_X86_PS4
        if (pdev->vendor == PCI_VENDOR_ID_SONY &&
+           pdev->device == PCI_DEVICE_ID_SONY_BAIKAL_GBE &&
+           bpcie_assign_irqs(pdev, 1) > 0) {
+               err = sky2_test_msi(hw);
+               if (err) {
+                       bpcie_free_irqs(pdev->irq, 1);
+                       /* PS4 requires MSI, so if it fails, bail out. */
+                       goto err_out_free_netdev;
+               }
+               hw->flags |= SKY2_HW_USE_BAIKAL_MSI;
+       } else if (pdev->vendor == PCI_VENDOR_ID_SONY &&
            apcie_assign_irqs(pdev, 1) > 0) {
                err = sky2_test_msi(hw);
                if (err) {
@@ -5200,6 +5755,11 @@ static int sky2_probe(struct pci_dev *pdev, const struct pci_device_id *ent)
 	timer_setup(&hw->watchdog_timer, sky2_watchdog, 0);
 	INIT_WORK(&hw->restart_work, sky2_restart);
 
+	INIT_WORK(&hw->rx_dim.work, sky2_rx_dim_work);
+	hw->rx_dim.mode = DIM_CQ_PERIOD_MODE_START_FROM_EQE;
+	INIT_WORK(&hw->tx_dim.work, sky2_tx_dim_work);
+	hw->tx_dim.mode = DIM_CQ_PERIOD_MODE_START_FROM_EQE;
+
 	pci_set_drvdata(pdev, hw);
 	pdev->d3_delay = 300;
 
@@ -5213,7 +5773,9 @@ static int sky2_probe(struct pci_dev *pdev, const struct pci_device_id *ent)
 	unregister_netdev(dev);
 err_out_free_netdev:
 #ifdef CONFIG_X86_PS4
-	if (hw->flags & SKY2_HW_USE_AEOLIA_MSI)
+	if (hw->flags & SKY2_HW_USE_BAIKAL_MSI)
+		bpcie_free_irqs(pdev->irq, 1);
+	else if (hw->flags & SKY2_HW_USE_AEOLIA_MSI)
 		apcie_free_irqs(pdev->irq, 1);
 	else
 #endif
@@ -5247,6 +5809,8 @@ static void sky2_remove(struct pci_dev *pdev)
 
 	del_timer_sync(&hw->watchdog_timer);
 	cancel_work_sync(&hw->restart_work);
+	cancel_work_sync(&hw->rx_dim.work);
+	cancel_work_sync(&hw->tx_dim.work);
 
 	for (i = hw->ports-1; i >= 0; --i)
 		unregister_netdev(hw->dev[i]);
@@ -5264,7 +5828,9 @@ static void sky2_remove(struct pci_dev *pdev)
 		free_irq(pdev->irq, hw);
 	}
   #ifdef CONFIG_X86_PS4
-  	if (hw->flags & SKY2_HW_USE_AEOLIA_MSI)
+  	if (hw->flags & SKY2_HW_USE_BAIKAL_MSI)
+  		bpcie_free_irqs(pdev->irq, 1);
+  	else if (hw->flags & SKY2_HW_USE_AEOLIA_MSI)
   		apcie_free_irqs(pdev->irq, 1);
   	else
   #endif
@@ -5292,6 +5858,8 @@ static int sky2_suspend(struct device *dev)
 
 	del_timer_sync(&hw->watchdog_timer);
 	cancel_work_sync(&hw->restart_work);
+	cancel_work_sync(&hw->rx_dim.work);
+	cancel_work_sync(&hw->tx_dim.work);
 
 	rtnl_lock();
 
@@ -5375,6 +5943,10 @@ static struct pci_driver sky2_driver = {
 	.remove = sky2_remove,
 	.shutdown = sky2_shutdown,
 	.driver.pm = SKY2_PM_OPS,
+#ifdef CONFIG_X86_PS4
+	/* The southbridge GbE waits for its glue through a device link */
+	.driver.probe_type = PROBE_PREFER_ASYNCHRONOUS,
+#endif
 };
 
 static int __init sky2_init_module(void)
@@ -2190,6 +2190,7 @@ struct sky2_status_le {
 
 struct tx_ring_info {
 	struct sk_buff	*skb;
+	struct xdp_frame *xdpf;
 	unsigned long flags;
 #define TX_MAP_SINGLE   0x0001
 #define TX_MAP_PAGE     0x0002
@@ -2198,10 +2199,19 @@ struct tx_ring_info {
 };
 
 struct rx_ring_info {
-	struct sk_buff	*skb;
+	struct page	*page;
 	dma_addr_t	data_addr;
-	DEFINE_DMA_UNMAP_LEN(data_size);
+	struct page	*frag_page[ETH_JUMBO_MTU >> PAGE_SHIFT];
 	dma_addr_t	frag_addr[ETH_JUMBO_MTU >> PAGE_SHIFT];
+
+	/* Status reported before OP_RXSTAT of the same frame */
+	u32		hash;
+	u16		csum;
+	u16		vlan_tci;
+	u8		flags;
+#define RX_INFO_CSUM	0x01
+#define RX_INFO_VLAN	0x02
+#define RX_INFO_HASH	0x04
 };
 
 enum flow_control {
@@ -2227,6 +2237,10 @@ struct sky2_port {
 	struct tx_ring_info  *tx_ring;
 	struct sky2_tx_le    *tx_le;
 	struct sky2_stats    tx_stats;
+	u64		     tx_bounced;	/* bytes through swiotlb */
+	u64		     tx_frames;		/* skbs queued */
+	u64		     tx_segs;		/* wire packets they make */
+	u64		     tx_les;		/* list elements they took */
 
 	u16		     tx_ring_size;
 	u16		     tx_cons;		/* next le to check */
@@ -2240,6 +2254,13 @@ struct sky2_port {
 
 	struct rx_ring_info  *rx_ring ____cacheline_aligned_in_smp;
 	struct sky2_rx_le    *rx_le;
+	u64		     rx_bounced;	/* bytes through swiotlb */
+	struct page_pool     *page_pool;
+	struct bpf_prog	     *xdp_prog;
+	struct xdp_rxq_info  xdp_rxq;
+	u8		     xdp_flush;
+#define SKY2_XDP_TX		0x01
+#define SKY2_XDP_REDIRECT	0x02
 	struct sky2_stats    rx_stats;
 
 	u16		     rx_next;		/* next re to check */
@@ -2295,6 +2316,9 @@ struct sky2_hw {
 #define SKY2_HW_RSS_CHKSUM	0x00000400	/* RSS requires chksum */
 #define SKY2_HW_IRQ_SETUP	0x00000800
 #define SKY2_HW_USE_AEOLIA_MSI	0x00001000
+#define SKY2_HW_USE_BAIKAL_MSI	0x00002000
+#define SKY2_HW_RX_DIM		0x00004000	/* adaptive rx moderation */
+#define SKY2_HW_TX_DIM		0x00008000	/* adaptive tx moderation */
 	u8	     	     chip_id;
 	u8		     chip_rev;
 	u8		     pmd_type;
@@ -2305,10 +2329,28 @@ struct sky2_hw {
 	u32		     st_idx;
 	dma_addr_t   	     st_dma;
 
+	/* latency probes, updated from irq and sky2_poll() */
+	struct {
+		u64	irq_stamp;
+		u64	irqs;
+		u64	irq_ns;
+		u64	irq_max_ns;
+		u64	polls;
+		u64	poll_ns;
+		u64	poll_max_ns;
+		u64	st_samples;
+		u64	st_entries;
+		u32	st_max;
+	} lat;
+
 	struct timer_list    watchdog_timer;
 	struct work_struct   restart_work;
+	struct dim	     rx_dim;
+	struct dim	     tx_dim;
+	u16		     dim_events;
 	wait_queue_head_t    msi_wait;
 	u8		     phy_addr;
+	u32		     switch_id;	/* Aeolia l2 switch PHY id, 0 if none */
 	char		     irq_name[0];
 };
 
@@ -2282,6 +2282,21 @@ EXPORT_SYMBOL(pci_bus_read_dev_vendor_id);
  * Read the config data for a PCI device, sanity-check it,
  * and fill in the dev structure.
  */
+// It can be arbitrary (above 2). Freebsd uses 20, so use that too.
+#define AEOLIA_SLOT_NUM 20
+
+/*
+ * The PS4 southbridge shows up in every slot of its bus; only the copy at
+ * AEOLIA_SLOT_NUM is real. Decided from the vendor ID we have already read,
+ * so skipping the phantoms costs no extra config cycles.
+ */
+static bool pci_is_phantom_aeolia(int devfn, u32 l)
+{
+	return IS_ENABLED(CONFIG_X86_PS4) &&
+	       PCI_SLOT(devfn) != AEOLIA_SLOT_NUM &&
+	       (l & 0xffff) == PCI_VENDOR_ID_SONY;
+}
+
 static struct pci_dev *pci_scan_device(struct pci_bus *bus, int devfn)
 {
 	struct pci_dev *dev;
@@ -2290,6 +2305,9 @@ static struct pci_dev *pci_scan_device(struct pci_bus *bus, int devfn)
 	if (!pci_bus_read_dev_vendor_id(bus, devfn, &l, 60*1000))
 		return NULL;
 
+	if (pci_is_phantom_aeolia(devfn, l))
+		return NULL;
+
 	dev = pci_alloc_dev(bus);
 	if (!dev)
 		return NULL;
@@ -2533,9 +2551,6 @@ static int only_one_child(struct pci_bus *bus)
 	return 0;
 }
 
-// It can be arbitrary (above 2). Freebsd uses 20, so use that too.
-#define AEOLIA_SLOT_NUM 20
-
 /**
  * pci_scan_slot - Scan a PCI slot on a bus for devices
  * @bus: PCI bus to scan
@@ -2551,15 +2566,11 @@ int pci_scan_slot(struct pci_bus *bus, int devfn)
 {
 	unsigned fn, nr = 0;
 	struct pci_dev *dev;
-	u32 l;
+
 	if (only_one_child(bus) && (devfn > 0))
 		return 0; /* Already scanned the entire slot */
-	// skip phantom Aeolia devices that bleed through the PCI space
-	if (PCI_SLOT(devfn) != AEOLIA_SLOT_NUM &&
-		pci_bus_read_dev_vendor_id(bus, devfn, &l, 60*1000) &&
-		(l & 0xffff) == PCI_VENDOR_ID_SONY) {
-		return 0;
-	}
+
+	/* Phantom Aeolia devices are dropped by pci_scan_device() */
 	dev = pci_scan_single_device(bus, devfn);
 	if (!dev)
 		return 0;
@@ -2567,11 +2578,6 @@ int pci_scan_slot(struct pci_bus *bus, int devfn)
 		nr++;
 
 	for (fn = next_fn(bus, dev, 0); fn > 0; fn = next_fn(bus, dev, fn)) {
-		if (PCI_SLOT(devfn) != AEOLIA_SLOT_NUM &&
-			pci_bus_read_dev_vendor_id(bus, devfn + fn, &l, 60*1000) &&
-			(l & 0xffff) == PCI_VENDOR_ID_SONY) {
-			continue;
-		}
 		dev = pci_scan_single_device(bus, devfn + fn);
 		if (dev) {
 			if (!pci_dev_is_added(dev))
@@ -1,9 +1,15 @@
 #ifndef _AEOLIA_BAIKAL_H
 #define _AEOLIA_BAIKAL_H
 
+#include <linux/init.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
 #include <linux/pci.h>
 #include <linux/i2c.h>
+#include <linux/timer.h>
+#include <linux/kfifo.h>
+#include <linux/workqueue.h>
+#include <asm/ps4.h>
 
 #define ICC_REPLY 0x4000
 #define ICC_EVENT 0x8000
@@ -28,7 +34,11 @@ struct icc_message_hdr {
 #define ICC_MAX_PAYLOAD (ICC_MAX_SIZE - ICC_HDR_SIZE)
 
 /* Seconds. Yes, some ICC requests can be slow. */
-#define ICC_TIMEOUT 15;
+#define ICC_TIMEOUT 15
+
+/* Number of requests that may be outstanding on the mailbox at once. Must be
+ * a power of two: a request lives in slot (cookie % ICC_MAX_INFLIGHT). */
+#define ICC_MAX_INFLIGHT 8
 
 #define sc_err(...) dev_err(&sc->pdev->dev, __VA_ARGS__)
 #define sc_warn(...) dev_warn(&sc->pdev->dev, __VA_ARGS__)
@@ -36,22 +46,116 @@ struct icc_message_hdr {
 #define sc_info(...) dev_info(&sc->pdev->dev, __VA_ARGS__)
 #define sc_dbg(...) dev_dbg(&sc->pdev->dev, __VA_ARGS__)
 
-struct abpcie_icc_dev {
-	phys_addr_t spm_base;
-	void __iomem *spm;
+/* Run one bring-up step of the southbridge probe and, with initcall_debug,
+ * report how long it took in the same format as the initcall tracer */
+#define sc_probe_step(step) ({						\
+	ktime_t __t0 = ktime_get();					\
+	int __ret = (step);						\
+									\
+	if (initcall_debug)						\
+		sc_info("%s returned %d after %lld usecs\n", #step,	\
+			__ret, ktime_us_delta(ktime_get(), __t0));	\
+	__ret;								\
+})
+
+struct abpcie_dev;
+struct icc_hwmon;
+
+/* Unsolicited events are queued from the IRQ handler and dispatched to
+ * listeners from a work item. Longer payloads are truncated. */
+#define ICC_EVENT_MAX_DATA	0x40
+#define ICC_EVENT_QUEUE		16
+
+struct icc_event {
+	struct icc_message_hdr hdr;
+	u8 data[ICC_EVENT_MAX_DATA];
+};
+
+#ifdef CONFIG_DEBUG_FS
+#define ICC_STATS_CMDS		64
+/* Bucket n counts round trips under 2^n us, the last one everything else */
+#define ICC_STATS_BUCKETS	16
 
-	spinlock_t reply_lock;
-	bool reply_pending;
+struct icc_cmd_stats {
+	u8 major;
+	u16 minor;
+	u32 count;
+	u32 timeouts;
+	u32 csum_errors;
+	u32 latency[ICC_STATS_BUCKETS];
+};
+#endif
+
+/*
+ * Slot states. A request moves FREE -> RESERVED -> WAITING -> DONE -> FREE;
+ * whoever moves it from WAITING to DONE (reply IRQ, timeout or cancel) owns
+ * the reply buffer and completes the request. The cookie is part of the
+ * state word so that a late reply can never claim a reused slot.
+ */
+#define ICC_SLOT_FREE			0
+#define ICC_SLOT_RESERVED		1
+#define ICC_SLOT_WAITING		2
+#define ICC_SLOT_DONE			3
+#define ICC_SLOT_STATE(cookie, st)	(((u32)(cookie) << 2) | (st))
+
+/* One outstanding request, looked up by the cookie of its reply */
+struct icc_slot {
+	struct abpcie_dev *sc;
+	atomic_t state;
+	u16 cookie;
+	u8 major;
+	u16 minor;
 
-	struct icc_message_hdr request;
 	struct icc_message_hdr reply;
-	u16 reply_extra_checksum;
+	u16 reply_payload_checksum;
 	void *reply_buffer;
 	int reply_length;
+
+	icc_done_t done;
+	void *ctx;
+	unsigned long deadline;
+	struct timer_list timer;
+#ifdef CONFIG_DEBUG_FS
+	struct icc_cmd_stats *stats;
+	ktime_t sent;
+#endif
+};
+
+struct abpcie_icc_dev {
+	phys_addr_t spm_base;
+	void __iomem *spm;
+	/* ICC register block, at a different BAR/offset per southbridge */
+	void __iomem *regs;
+
+	/* Serializes slot allocation; never taken from IRQ context */
+	spinlock_t slot_lock;
+	/* Serializes writers of the SPM request buffer */
+	struct mutex tx_mutex;
+	u16 cookie;
+	struct icc_slot slots[ICC_MAX_INFLIGHT];
 	wait_queue_head_t wq;
 
+#ifdef CONFIG_DEBUG_FS
+	struct dentry *debugfs;
+	spinlock_t stats_lock;
+	int nr_stats;
+	struct icc_cmd_stats stats[ICC_STATS_CMDS];
+#endif
+
+	DECLARE_KFIFO(events, struct icc_event, ICC_EVENT_QUEUE);
+	struct work_struct event_work;
+
+	int irq;
+	/* enable_irq_wake() succeeded at suspend and must be undone */
+	bool irq_wake;
+	/* Between icc_core_suspend() and icc_core_resume(); new requests
+	 * are refused. Written under tx_mutex. */
+	bool suspended;
+
 	struct i2c_adapter i2c;
 	struct input_dev *pwrbutton_dev;
+	struct icc_event_listener pwrbutton_listener;
+	struct icc_hwmon *hwmon;
 };
 
 struct abpcie_dev {
@@ -66,6 +170,20 @@ struct abpcie_dev {
 	struct abpcie_icc_dev icc;
 };
 
+/* The ICC register block has the same layout on both southbridges.
+ * Relative to icc.regs */
+#define ICC_REG_DOORBELL		0x804
+#define ICC_REG_STATUS			0x814
+#define ICC_REG_IRQ_MASK		0x824
+
+/* Apply to both DOORBELL and STATUS */
+#define ICC_SEND			0x01
+#define ICC_ACK				0x02
+
+/* Relative to the ICC portion of SPM */
+#define ICC_SPM_REQUEST			0x0
+#define ICC_SPM_REPLY			0x800
+
 #define BUF_FULL 0x7f0
 #define BUF_EMPTY 0x7f4
 #define HDR(x) (offsetof(struct icc_message_hdr, x))
@@ -83,4 +201,56 @@ struct abpcie_dev {
 
 #define ICC_IOCTL_CMD _IOWR(ICC_MAJOR, 1, struct icc_cmd)
 
+/*
+ * Per-open-file ICC ring. mmap() ICC_RING_SIZE bytes at offset 0: a header
+ * at offset 0 and ICC_RING_ENTRIES entries from ICC_RING_ENTRIES_OFF on.
+ *
+ * Userspace fills entries[sq_tail % ICC_RING_ENTRIES], bumps sq_tail and
+ * calls ICC_IOCTL_RING_ENTER, whose argument is the number of completions
+ * to wait for (0 to only submit). Each request is answered in place: data
+ * holds the reply payload and result the reply length (which may exceed
+ * reply_length) or a negative error. The index of every completed entry is
+ * appended to cq[]; poll() reports POLLIN while cq_head != cq_tail. An
+ * entry must not be reused before its completion has been consumed.
+ */
+#define ICC_RING_ENTRIES	64
+#define ICC_RING_ENTRY_SIZE	2048
+#define ICC_RING_DATA		(ICC_RING_ENTRY_SIZE - 24)
+#define ICC_RING_ENTRIES_OFF	4096
+#define ICC_RING_SIZE		(ICC_RING_ENTRIES_OFF + \
+				 ICC_RING_ENTRIES * ICC_RING_ENTRY_SIZE)
+
+struct icc_ring_hdr {
+	u32 sq_head;		/* kernel: next entry to be submitted */
+	u32 sq_tail;		/* user: one past the last queued entry */
+	u32 cq_head;		/* user: next completion to be consumed */
+	u32 cq_tail;		/* kernel: one past the last completion */
+	u32 entries;		/* ICC_RING_ENTRIES */
+	u32 cq[ICC_RING_ENTRIES];
+};
+
+struct icc_ring_entry {
+	u64 user_data;		/* untouched by the kernel */
+	s32 result;		/* out: reply length or -errno */
+	u16 minor;
+	u8 major;
+	u8 pad;
+	u16 length;		/* in: request payload length */
+	u16 reply_length;	/* in: room for the reply in data */
+	u32 reserved;
+	u8 data[ICC_RING_DATA];	/* request payload in, reply payload out */
+};
+
+#define ICC_IOCTL_RING_ENTER _IO(ICC_MAJOR, 2)
+
+/* drivers/ps4/icc/core.c */
+int icc_core_init(struct abpcie_dev *sc, int irq);
+void icc_core_remove(struct abpcie_dev *sc, int irq);
+void icc_core_shutdown(struct abpcie_dev *sc);
+#ifdef CONFIG_PM
+void icc_core_suspend(struct abpcie_dev *sc);
+void icc_core_resume(struct abpcie_dev *sc);
+#endif
+void icc_chrdev_init(struct abpcie_dev *sc);
+
 #endif
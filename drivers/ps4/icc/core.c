@@ -0,0 +1,1184 @@
+/*
+ * ICC (EMC mailbox) transport shared by the Aeolia and Baikal southbridges
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ * of the License.
+ */
+#define DEBUG
+
+#include <linux/kernel.h>
+#include <linux/sched.h>
+#include <linux/wait.h>
+#include <linux/pci.h>
+#include <linux/interrupt.h>
+#include <linux/fs.h>
+#include <linux/uaccess.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include <linux/poll.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
+#include <asm/unaligned.h>
+#include <asm/ps4.h>
+#include "../aeolia-baikal.h"
+
+#define CREATE_TRACE_POINTS
+#include "trace.h"
+
+/* There should normally be only one Aeolia or Baikal device in a system. This
+ * allows other kernel code in unrelated subsystems to issue icc requests
+ * without having to get a reference to the device. */
+static struct abpcie_dev *icc_sc;
+
+static DEFINE_MUTEX(icc_mutex);
+/* The ICC message passing interface supports multiple outstanding requests:
+ * the request buffer is handed back to us (ACK) as soon as the EMC has
+ * consumed it, and replies are matched up by cookie. The original PS4 OS never
+ * does this, but it lets slow requests overlap with unrelated ones. */
+
+#define REQUEST (sc->icc.spm + ICC_SPM_REQUEST)
+#define REPLY (sc->icc.spm + ICC_SPM_REPLY)
+
+/* Event listeners outlive any particular southbridge device */
+static LIST_HEAD(icc_listeners);
+static DEFINE_MUTEX(icc_listeners_lock);
+
+/* Sum of the four bytes of a word. The byte order does not matter. */
+static inline u16 checksum_word(u32 w)
+{
+	w = (w & 0x00ff00ff) + ((w >> 8) & 0x00ff00ff);
+	return (w & 0xffff) + (w >> 16);
+}
+
+static u16 checksum(const void *p, int length)
+{
+	const u8 *pp = p;
+	u16 sum = 0;
+
+	for (; length >= 4; length -= 4, pp += 4)
+		sum += checksum_word(get_unaligned((const u32 *)pp));
+	while (length--)
+		sum += *pp++;
+	return sum;
+}
+
+/* Copy the first copy_size bytes of a reply payload out of SPM and return the
+ * checksum of all length bytes of it. SPM is uncached, so this reads whole
+ * words only and folds the checksum in the same pass. The payload starts
+ * word aligned and never runs past BUF_FULL, so the tail word is safe to read;
+ * bytes past length are masked off. */
+static u16 icc_read_payload(struct abpcie_dev *sc, void *dst, int copy_size,
+			    int length)
+{
+	void __iomem *src = REPLY + ICC_HDR_SIZE;
+	u8 *d = dst;
+	u16 sum = 0;
+	int off, i;
+	u32 w;
+
+	for (off = 0; off < length; off += 4) {
+		w = ioread32(src + off);
+		if (length - off < 4)
+			w &= (1U << (8 * (length - off))) - 1;
+		sum += checksum_word(w);
+
+		if (off + 4 <= copy_size) {
+			put_unaligned_le32(w, d + off);
+		} else {
+			for (i = 0; off + i < copy_size; i++)
+				d[off + i] = w >> (8 * i);
+		}
+	}
+	return sum;
+}
+
+static void dump_message(struct abpcie_dev *sc, int offset)
+{
+	int len;
+	struct icc_message_hdr hdr;
+	memcpy_fromio(&hdr, sc->icc.spm + offset, ICC_HDR_SIZE);
+
+	sc_err("icc: hdr: [%02x] %02x:%04x unk %x #%d len %d cksum 0x%x\n",
+	       hdr.magic, hdr.major, hdr.minor, hdr.unknown, hdr.cookie,
+	       hdr.length, hdr.checksum);
+	len = min(hdr.length - ICC_HDR_SIZE, ICC_MAX_PAYLOAD);
+	if (len > 0) {
+		sc_err("icc: data:");
+		while (len--)
+			printk(" %02x", ioread8(sc->icc.spm + (offset++) +
+			                         ICC_HDR_SIZE));
+		printk("\n");
+	}
+}
+
+/* Called from the IRQ handler. The reply buffer is handed back to the EMC
+ * right after, so copy the event out and leave the rest to icc_event_work. */
+static void handle_event(struct abpcie_dev *sc, struct icc_message_hdr *msg)
+{
+	struct icc_event ev;
+	int len;
+
+	trace_icc_event(msg->major, msg->minor, msg->cookie, msg->length);
+
+	len = msg->length - ICC_HDR_SIZE;
+	if (len < 0 || msg->length > ICC_MAX_SIZE) {
+		sc_err("icc: event has bad length %d\n", msg->length);
+		dump_message(sc, ICC_SPM_REPLY);
+		return;
+	}
+	if (len > ICC_EVENT_MAX_DATA) {
+		sc_warn("icc: event %02x:%04x truncated (%d bytes)\n",
+			msg->major, msg->minor, len);
+		len = ICC_EVENT_MAX_DATA;
+	}
+
+	ev.hdr = *msg;
+	ev.hdr.length = len;
+	memcpy_fromio(ev.data, REPLY + ICC_HDR_SIZE, len);
+
+	if (!kfifo_put(&sc->icc.events, ev)) {
+		sc_err("icc: event queue full, dropping %02x:%04x\n",
+		       msg->major, msg->minor);
+		return;
+	}
+	schedule_work(&sc->icc.event_work);
+}
+
+static void icc_event_work(struct work_struct *work)
+{
+	struct abpcie_dev *sc = container_of(work, struct abpcie_dev,
+					     icc.event_work);
+	struct icc_event_listener *l;
+	struct icc_event ev;
+	bool handled;
+
+	while (kfifo_get(&sc->icc.events, &ev)) {
+		handled = false;
+		mutex_lock(&icc_listeners_lock);
+		list_for_each_entry(l, &icc_listeners, list) {
+			if (l->major != ev.hdr.major ||
+			    ev.hdr.minor < l->minor_first ||
+			    ev.hdr.minor > l->minor_last)
+				continue;
+			l->handler(l, ev.hdr.major, ev.hdr.minor, ev.data,
+				   ev.hdr.length);
+			handled = true;
+		}
+		mutex_unlock(&icc_listeners_lock);
+
+		if (!handled) {
+			sc_notice("icc: unhandled event %02x:%04x len %d\n",
+				  ev.hdr.major, ev.hdr.minor, ev.hdr.length);
+			print_hex_dump_debug("icc: data: ", DUMP_PREFIX_NONE,
+					     16, 1, ev.data, ev.hdr.length,
+					     false);
+		}
+	}
+}
+
+int apcie_icc_register_event(struct icc_event_listener *l)
+{
+	if (!l->handler || l->minor_first > l->minor_last)
+		return -EINVAL;
+
+	mutex_lock(&icc_listeners_lock);
+	list_add_tail(&l->list, &icc_listeners);
+	mutex_unlock(&icc_listeners_lock);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(apcie_icc_register_event);
+
+void apcie_icc_unregister_event(struct icc_event_listener *l)
+{
+	mutex_lock(&icc_listeners_lock);
+	list_del(&l->list);
+	mutex_unlock(&icc_listeners_lock);
+}
+EXPORT_SYMBOL_GPL(apcie_icc_unregister_event);
+
+#ifdef CONFIG_DEBUG_FS
+/* Per-command statistics, looked up once at submission so that the IRQ path
+ * only has to bump counters. Commands beyond ICC_STATS_CMDS are not counted. */
+static struct icc_cmd_stats *icc_stats_get(struct abpcie_dev *sc, u8 major,
+					   u16 minor)
+{
+	struct icc_cmd_stats *st = NULL;
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&sc->icc.stats_lock, flags);
+	for (i = 0; i < sc->icc.nr_stats; i++) {
+		if (sc->icc.stats[i].major == major &&
+		    sc->icc.stats[i].minor == minor) {
+			st = &sc->icc.stats[i];
+			goto out;
+		}
+	}
+	if (sc->icc.nr_stats < ICC_STATS_CMDS) {
+		st = &sc->icc.stats[sc->icc.nr_stats++];
+		st->major = major;
+		st->minor = minor;
+	}
+out:
+	spin_unlock_irqrestore(&sc->icc.stats_lock, flags);
+	return st;
+}
+
+static void icc_stats_submit(struct abpcie_dev *sc, struct icc_slot *slot)
+{
+	slot->stats = icc_stats_get(sc, slot->major, slot->minor);
+	slot->sent = ktime_get();
+}
+
+static void icc_stats_csum_error(struct abpcie_dev *sc, struct icc_slot *slot)
+{
+	unsigned long flags;
+
+	if (!slot->stats)
+		return;
+	spin_lock_irqsave(&sc->icc.stats_lock, flags);
+	slot->stats->csum_errors++;
+	spin_unlock_irqrestore(&sc->icc.stats_lock, flags);
+}
+
+static void icc_stats_complete(struct abpcie_dev *sc, struct icc_slot *slot,
+			       int ret)
+{
+	struct icc_cmd_stats *st = slot->stats;
+	unsigned long flags;
+	s64 us;
+
+	if (!st)
+		return;
+	us = ktime_us_delta(ktime_get(), slot->sent);
+
+	spin_lock_irqsave(&sc->icc.stats_lock, flags);
+	st->count++;
+	if (ret == -ETIMEDOUT)
+		st->timeouts++;
+	else if (ret >= 0)
+		st->latency[min_t(int, fls64(us), ICC_STATS_BUCKETS - 1)]++;
+	spin_unlock_irqrestore(&sc->icc.stats_lock, flags);
+}
+
+static int icc_stats_show(struct seq_file *m, void *unused)
+{
+	struct abpcie_dev *sc = m->private;
+	struct icc_cmd_stats st;
+	int i, j, n;
+
+	seq_puts(m, "cmd        count timeouts csum  latency (us, <1 <2 <4 ...)\n");
+	spin_lock_irq(&sc->icc.stats_lock);
+	n = sc->icc.nr_stats;
+	spin_unlock_irq(&sc->icc.stats_lock);
+
+	for (i = 0; i < n; i++) {
+		spin_lock_irq(&sc->icc.stats_lock);
+		st = sc->icc.stats[i];
+		spin_unlock_irq(&sc->icc.stats_lock);
+
+		seq_printf(m, "%02x:%04x %8u %8u %4u ", st.major, st.minor,
+			   st.count, st.timeouts, st.csum_errors);
+		for (j = 0; j < ICC_STATS_BUCKETS; j++)
+			seq_printf(m, " %u", st.latency[j]);
+		seq_putc(m, '\n');
+	}
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(icc_stats);
+
+static void icc_debugfs_init(struct abpcie_dev *sc)
+{
+	spin_lock_init(&sc->icc.stats_lock);
+	sc->icc.debugfs = debugfs_create_dir("ps4-icc", NULL);
+	debugfs_create_file("stats", 0444, sc->icc.debugfs, sc,
+			    &icc_stats_fops);
+}
+
+static void icc_debugfs_remove(struct abpcie_dev *sc)
+{
+	debugfs_remove_recursive(sc->icc.debugfs);
+	sc->icc.debugfs = NULL;
+}
+#else
+static inline void icc_stats_submit(struct abpcie_dev *sc,
+				    struct icc_slot *slot) {}
+static inline void icc_stats_csum_error(struct abpcie_dev *sc,
+					struct icc_slot *slot) {}
+static inline void icc_stats_complete(struct abpcie_dev *sc,
+				      struct icc_slot *slot, int ret) {}
+static inline void icc_debugfs_init(struct abpcie_dev *sc) {}
+static inline void icc_debugfs_remove(struct abpcie_dev *sc) {}
+#endif
+
+/* Grab the first free slot, skipping cookies whose slot is still in use so
+ * that cookies stay monotonic. */
+static struct icc_slot *icc_get_slot(struct abpcie_dev *sc)
+{
+	struct icc_slot *slot;
+	u16 cookie;
+	int i;
+
+	spin_lock(&sc->icc.slot_lock);
+	for (i = 1; i <= ICC_MAX_INFLIGHT; i++) {
+		cookie = sc->icc.cookie + i;
+		slot = &sc->icc.slots[cookie % ICC_MAX_INFLIGHT];
+		if (atomic_read(&slot->state) == ICC_SLOT_FREE) {
+			atomic_set(&slot->state,
+				   ICC_SLOT_STATE(cookie, ICC_SLOT_RESERVED));
+			slot->cookie = cookie;
+			sc->icc.cookie = cookie;
+			spin_unlock(&sc->icc.slot_lock);
+			return slot;
+		}
+	}
+	spin_unlock(&sc->icc.slot_lock);
+	return NULL;
+}
+
+static void icc_put_slot(struct abpcie_dev *sc, struct icc_slot *slot)
+{
+	slot->reply_buffer = NULL;
+	atomic_set_release(&slot->state, ICC_SLOT_FREE);
+	wake_up(&sc->icc.wq);
+}
+
+/* Move a request that is waiting for its reply to DONE. Only one of the
+ * reply IRQ, the timeout and icc_cancel() can win. */
+static bool icc_claim_slot(struct icc_slot *slot, u16 cookie)
+{
+	return atomic_cmpxchg(&slot->state,
+			      ICC_SLOT_STATE(cookie, ICC_SLOT_WAITING),
+			      ICC_SLOT_STATE(cookie, ICC_SLOT_DONE)) ==
+	       ICC_SLOT_STATE(cookie, ICC_SLOT_WAITING);
+}
+
+/* Validate a reply that has been copied into the slot's reply buffer. Returns
+ * the reply payload length or a negative error. */
+static int icc_check_reply(struct abpcie_dev *sc, struct icc_slot *slot)
+{
+	u16 rep_checksum;
+
+	rep_checksum = slot->reply.checksum;
+	slot->reply.checksum = 0;
+	rep_checksum -= checksum(&slot->reply, ICC_HDR_SIZE);
+	rep_checksum -= slot->reply_payload_checksum;
+
+	if (rep_checksum) {
+		sc_err("icc: checksum mismatch (diff: %x)\n", rep_checksum);
+		icc_stats_csum_error(sc, slot);
+		return -EIO;
+	}
+	if (slot->reply.major != slot->major) {
+		sc_err("icc: major mismatch\n");
+		return -EIO;
+	}
+	if (slot->reply.minor != (slot->minor | ICC_REPLY)) {
+		sc_err("icc: minor mismatch\n");
+		return -EIO;
+	}
+
+	return slot->reply.length - ICC_HDR_SIZE;
+}
+
+/* Called by whoever claimed the slot, from the reply IRQ or the timeout
+ * timer. Frees the slot before running the callback so that a
+ * submitter waiting for a slot can go ahead. The callback runs in atomic
+ * context and cannot submit a follow-up request itself; it has to defer
+ * that to process context, e.g. with a work item. */
+static void icc_complete(struct abpcie_dev *sc, struct icc_slot *slot, int ret)
+{
+	icc_done_t done = slot->done;
+	void *ctx = slot->ctx;
+
+	del_timer(&slot->timer);
+	trace_icc_complete(slot->major, slot->minor, slot->cookie, ret);
+	icc_stats_complete(sc, slot, ret);
+	icc_put_slot(sc, slot);
+	done(ctx, ret);
+}
+
+static void icc_timeout(struct timer_list *t)
+{
+	struct icc_slot *slot = from_timer(slot, t, timer);
+	struct abpcie_dev *sc = slot->sc;
+	u16 cookie = slot->cookie;
+
+	/* A stale timer of a slot that has since been reused must not
+	 * time out the new request. */
+	if (atomic_read_acquire(&slot->state) !=
+	    ICC_SLOT_STATE(cookie, ICC_SLOT_WAITING) ||
+	    time_before(jiffies, slot->deadline))
+		return;
+	if (!icc_claim_slot(slot, cookie))
+		return;
+
+	sc_err("icc: timeout: %02x:%04x #%d\n", slot->major, slot->minor,
+	       cookie);
+	icc_complete(sc, slot, -ETIMEDOUT);
+}
+
+/* Take back a request that has not been answered yet. Returns false if the
+ * reply or timeout beat us to it, in which case the callback still runs. */
+static bool icc_cancel(struct abpcie_dev *sc, struct icc_slot *slot, u16 cookie)
+{
+	if (!icc_claim_slot(slot, cookie))
+		return false;
+
+	del_timer_sync(&slot->timer);
+	icc_put_slot(sc, slot);
+	return true;
+}
+
+static void handle_message(struct abpcie_dev *sc)
+{
+	u32 rep_empty, rep_full;
+	int len, copy_size;
+	struct icc_message_hdr msg;
+	struct icc_slot *slot;
+
+	rep_empty = ioread32(REPLY + BUF_EMPTY);
+	rep_full = ioread32(REPLY + BUF_FULL);
+
+	if (rep_empty != 0 || rep_full != 1) {
+		sc_err("icc: reply buffer in bad state (%d, %d)\n",
+			rep_empty, rep_full);
+		return;
+	}
+
+	memcpy_fromio(&msg, REPLY, ICC_HDR_SIZE);
+
+	if (msg.minor & ICC_EVENT) {
+		if (msg.magic != ICC_EVENT_MAGIC) {
+			sc_err("icc: event has bad magic\n");
+			dump_message(sc, ICC_SPM_REPLY);
+			return;
+		}
+		handle_event(sc, &msg);
+	} else if (msg.minor & ICC_REPLY) {
+		if (msg.magic != ICC_MAGIC) {
+			sc_err("icc: reply has bad magic\n");
+			dump_message(sc, ICC_SPM_REPLY);
+			return;
+		}
+		if (msg.length < ICC_HDR_SIZE || msg.length > ICC_MAX_SIZE) {
+			sc_err("icc: reply has bad length %d\n", msg.length);
+			dump_message(sc, ICC_SPM_REPLY);
+			return;
+		}
+		/* Once claimed, the slot and its reply buffer are ours until
+		 * icc_complete(), so the copy out of SPM needs no lock. */
+		slot = &sc->icc.slots[msg.cookie % ICC_MAX_INFLIGHT];
+		if (!icc_claim_slot(slot, msg.cookie)) {
+			sc_err("icc: unexpected reply (cookie %d)\n", msg.cookie);
+			dump_message(sc, ICC_SPM_REPLY);
+			return;
+		}
+		trace_icc_reply(msg.major, msg.minor, msg.cookie, msg.length);
+		len = msg.length - ICC_HDR_SIZE;
+		copy_size = min(slot->reply_length, len);
+		slot->reply_payload_checksum =
+			icc_read_payload(sc, slot->reply_buffer, copy_size, len);
+		slot->reply_length = copy_size;
+		slot->reply = msg;
+		icc_complete(sc, slot, icc_check_reply(sc, slot));
+		//stop_hpet_timers(sc);
+	} else {
+		sc_err("icc: unknown message arrived\n");
+		dump_message(sc, ICC_SPM_REPLY);
+	}
+}
+
+static irqreturn_t icc_interrupt(int irq, void *arg)
+{
+	struct abpcie_dev *sc = arg;
+	u32 status;
+	u32 ret = IRQ_NONE;
+
+	do {
+		status = ioread32(sc->icc.regs + ICC_REG_STATUS);
+		trace_icc_irq(status);
+
+		if (status & ICC_ACK) {
+			iowrite32(ICC_ACK,
+				  sc->icc.regs + ICC_REG_STATUS);
+			/* Request buffer is free again */
+			wake_up(&sc->icc.wq);
+			ret = IRQ_HANDLED;
+		}
+
+		if (status & ICC_SEND) {
+			iowrite32(ICC_SEND,
+				  sc->icc.regs + ICC_REG_STATUS);
+			handle_message(sc);
+			iowrite32(0, REPLY + BUF_FULL);
+			iowrite32(1, REPLY + BUF_EMPTY);
+			iowrite32(ICC_ACK,
+				  sc->icc.regs + ICC_REG_DOORBELL);
+			ret = IRQ_HANDLED;
+		}
+	} while (status);
+
+	return ret;
+}
+
+static bool icc_request_buffer_free(struct abpcie_dev *sc)
+{
+	return ioread32(REQUEST + BUF_EMPTY) == 1 &&
+	       ioread32(REQUEST + BUF_FULL) == 0;
+}
+
+/* Hand a request to the EMC. Sleeps until a slot and the request buffer are
+ * available, but not for the reply: done() is called from interrupt or timer
+ * context with the reply length or a negative error. */
+static int _icc_submit(struct abpcie_dev *sc, u8 major, u16 minor,
+		       const void *data, u16 length, void *reply,
+		       u16 reply_length, icc_done_t done, void *ctx,
+		       u16 *cookie)
+{
+	struct icc_message_hdr request;
+	struct icc_slot *slot = NULL;
+
+	/* Catch done() callbacks that try to resubmit from atomic context */
+	might_sleep();
+
+	if (length > ICC_MAX_PAYLOAD)
+		return -E2BIG;
+
+	wait_event_timeout(sc->icc.wq, (slot = icc_get_slot(sc)) != NULL,
+			   HZ * ICC_TIMEOUT);
+	if (!slot) {
+		sc_err("icc: no free request slot\n");
+		return -EBUSY;
+	}
+	slot->major = major;
+	slot->minor = minor;
+	slot->reply_buffer = reply;
+	slot->reply_length = reply_length;
+	slot->done = done;
+	slot->ctx = ctx;
+
+	request.magic = ICC_MAGIC;
+	request.major = major;
+	request.minor = minor;
+	request.unknown = 0;
+	request.cookie = slot->cookie;
+	request.length = ICC_HDR_SIZE + length;
+	request.checksum = 0;
+	if (request.length < ICC_MIN_SIZE)
+		request.length = ICC_MIN_SIZE;
+
+	request.checksum = checksum(&request, ICC_HDR_SIZE);
+	request.checksum += checksum(data, length);
+
+	/* The EMC hands the request buffer back before it replies, so only
+	 * the copy into SPM is serialized, not the whole round trip. */
+	mutex_lock(&sc->icc.tx_mutex);
+	if (sc->icc.suspended) {
+		mutex_unlock(&sc->icc.tx_mutex);
+		icc_put_slot(sc, slot);
+		return -EAGAIN;
+	}
+	if (!wait_event_timeout(sc->icc.wq, icc_request_buffer_free(sc),
+				HZ * ICC_TIMEOUT)) {
+		mutex_unlock(&sc->icc.tx_mutex);
+		sc_err("icc: request buffer is busy: empty=%d full=%d\n",
+		       ioread32(REQUEST + BUF_EMPTY),
+		       ioread32(REQUEST + BUF_FULL));
+		icc_put_slot(sc, slot);
+		return -EIO;
+	}
+
+	iowrite32(0, REQUEST + BUF_EMPTY);
+
+	memcpy_toio(REQUEST, &request, ICC_HDR_SIZE);
+	memcpy_toio(REQUEST + ICC_HDR_SIZE, data, length);
+	if (length < ICC_MIN_PAYLOAD)
+		memset_io(REQUEST + ICC_HDR_SIZE + length, 0,
+			  ICC_MIN_PAYLOAD - length);
+
+	iowrite32(1, REQUEST + BUF_FULL);
+
+	if (cookie)
+		*cookie = slot->cookie;
+
+	icc_stats_submit(sc, slot);
+	trace_icc_send(major, minor, slot->cookie, request.length);
+
+	slot->deadline = jiffies + HZ * ICC_TIMEOUT;
+	atomic_set_release(&slot->state,
+			   ICC_SLOT_STATE(slot->cookie, ICC_SLOT_WAITING));
+	mod_timer(&slot->timer, slot->deadline);
+
+	iowrite32(ICC_SEND, sc->icc.regs + ICC_REG_DOORBELL);
+	mutex_unlock(&sc->icc.tx_mutex);
+
+	return 0;
+}
+
+struct icc_sync_ctx {
+	struct completion done;
+	int ret;
+};
+
+static void icc_sync_done(void *ctx, int ret)
+{
+	struct icc_sync_ctx *sync = ctx;
+
+	sync->ret = ret;
+	complete(&sync->done);
+}
+
+static int _icc_cmd(struct abpcie_dev *sc, u8 major, u16 minor,
+		    const void *data, u16 length, void *reply,
+		    u16 reply_length, bool intr)
+{
+	struct icc_sync_ctx sync;
+	u16 cookie;
+	int ret;
+
+	init_completion(&sync.done);
+	ret = _icc_submit(sc, major, minor, data, length, reply,
+			  reply_length, icc_sync_done, &sync, &cookie);
+	if (ret)
+		return ret;
+
+	/* The slot timer bounds the wait, so only interruption needs undoing */
+	if (intr && wait_for_completion_interruptible(&sync.done) &&
+	    icc_cancel(sc, &sc->icc.slots[cookie % ICC_MAX_INFLIGHT], cookie)) {
+		sc_err("icc: interrupted\n");
+		return -EINTR;
+	}
+	wait_for_completion(&sync.done);
+
+	return sync.ret;
+}
+
+static struct abpcie_dev *icc_get_sc(void)
+{
+	struct abpcie_dev *sc;
+
+	mutex_lock(&icc_mutex);
+	sc = icc_sc;
+	mutex_unlock(&icc_mutex);
+	if (!sc)
+		pr_err("icc: not ready\n");
+	return sc;
+}
+
+int apcie_icc_cmd(u8 major, u16 minor, const void *data, u16 length,
+		   void *reply, u16 reply_length)
+{
+	struct abpcie_dev *sc = icc_get_sc();
+
+	if (!sc)
+		return -EAGAIN;
+	return _icc_cmd(sc, major, minor, data, length, reply,
+			reply_length, false);
+}
+EXPORT_SYMBOL_GPL(apcie_icc_cmd);
+
+int apcie_icc_cmd_async(u8 major, u16 minor, const void *data, u16 length,
+			void *reply, u16 reply_length, icc_done_t done,
+			void *ctx)
+{
+	struct abpcie_dev *sc = icc_get_sc();
+
+	if (!sc)
+		return -EAGAIN;
+	return _icc_submit(sc, major, minor, data, length, reply,
+			   reply_length, done, ctx, NULL);
+}
+EXPORT_SYMBOL_GPL(apcie_icc_cmd_async);
+
+struct icc_cmdv_ctx {
+	atomic_t remaining;
+	struct completion done;
+};
+
+struct icc_cmdv_entry {
+	struct icc_cmdv *cmd;
+	struct icc_cmdv_ctx *v;
+};
+
+static void icc_cmdv_done(void *ctx, int ret)
+{
+	struct icc_cmdv_entry *e = ctx;
+
+	e->cmd->ret = ret;
+	if (atomic_dec_and_test(&e->v->remaining))
+		complete(&e->v->done);
+}
+
+/* Issue a series of independent requests back to back and wait for all of
+ * them. The SPM request buffer holds one message, so every request still
+ * gets its own doorbell, but their round trips overlap instead of adding up.
+ * Per-request results are left in cmds[i].ret. */
+int apcie_icc_cmdv(struct icc_cmdv *cmds, int count)
+{
+	struct abpcie_dev *sc = icc_get_sc();
+	struct icc_cmdv_entry *entries;
+	struct icc_cmdv_ctx v;
+	int i, ret = 0;
+
+	if (!sc)
+		return -EAGAIN;
+
+	entries = kmalloc_array(count, sizeof(*entries), GFP_KERNEL);
+	if (!entries)
+		return -ENOMEM;
+
+	/* One extra reference, dropped once everything has been submitted */
+	atomic_set(&v.remaining, count + 1);
+	init_completion(&v.done);
+
+	for (i = 0; i < count; i++) {
+		entries[i].cmd = &cmds[i];
+		entries[i].v = &v;
+		cmds[i].ret = _icc_submit(sc, cmds[i].major,
+				cmds[i].minor, cmds[i].data, cmds[i].length,
+				cmds[i].reply, cmds[i].reply_length,
+				icc_cmdv_done, &entries[i], NULL);
+		if (cmds[i].ret) {
+			if (!ret)
+				ret = cmds[i].ret;
+			atomic_dec(&v.remaining);
+		}
+	}
+
+	if (!atomic_dec_and_test(&v.remaining))
+		wait_for_completion(&v.done);
+
+	kfree(entries);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(apcie_icc_cmdv);
+
+
+/* The Baikal names predate the shared core; they reach the same device. */
+int bpcie_icc_cmd(u8 major, u16 minor, const void *data, u16 length,
+		   void *reply, u16 reply_length)
+{
+	return apcie_icc_cmd(major, minor, data, length, reply, reply_length);
+}
+EXPORT_SYMBOL_GPL(bpcie_icc_cmd);
+
+int bpcie_icc_cmd_async(u8 major, u16 minor, const void *data, u16 length,
+			void *reply, u16 reply_length, icc_done_t done,
+			void *ctx)
+{
+	return apcie_icc_cmd_async(major, minor, data, length, reply,
+				   reply_length, done, ctx);
+}
+EXPORT_SYMBOL_GPL(bpcie_icc_cmd_async);
+
+int bpcie_icc_cmdv(struct icc_cmdv *cmds, int count)
+{
+	return apcie_icc_cmdv(cmds, count);
+}
+EXPORT_SYMBOL_GPL(bpcie_icc_cmdv);
+
+/* One open /dev/icc. The ring is only allocated once it is mmap'd, plain
+ * ICC_IOCTL_CMD users never pay for it. */
+struct icc_ring_req {
+	struct icc_file *f;
+	u32 idx;
+	bool busy;
+};
+
+struct icc_file {
+	struct mutex sq_mutex;	/* submitters and ring setup */
+	spinlock_t cq_lock;	/* completions */
+	wait_queue_head_t wq;
+	atomic_t inflight;
+	void *mem;
+	struct icc_ring_hdr *hdr;
+	struct icc_ring_entry *entries;
+	u32 sq_head;
+	u32 cq_tail;
+	struct icc_ring_req reqs[ICC_RING_ENTRIES];
+};
+
+static long icc_ioctl_cmd(void __user *uap)
+{
+	struct icc_cmd cmd;
+	void *buf;
+	int reply_len;
+	long ret;
+
+	if (copy_from_user(&cmd, uap, sizeof(cmd)))
+		return -EFAULT;
+	if (cmd.length > ICC_MAX_PAYLOAD)
+		return -E2BIG;
+
+	buf = kzalloc(max(cmd.length, cmd.reply_length), GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	ret = -EFAULT;
+	if (copy_from_user(buf, cmd.data, cmd.length))
+		goto out;
+	reply_len = apcie_icc_cmd(cmd.major, cmd.minor, buf, cmd.length,
+				  buf, cmd.reply_length);
+	if (reply_len < 0) {
+		ret = reply_len;
+		goto out;
+	}
+	if (copy_to_user(cmd.reply, buf, cmd.reply_length))
+		goto out;
+	ret = reply_len;
+out:
+	kfree(buf);
+	return ret;
+}
+
+/* Completion of a ring request, from interrupt or timer context */
+static void icc_ring_done(void *ctx, int ret)
+{
+	struct icc_ring_req *req = ctx;
+	struct icc_file *f = req->f;
+	unsigned long flags;
+
+	WRITE_ONCE(f->entries[req->idx].result, ret);
+
+	spin_lock_irqsave(&f->cq_lock, flags);
+	f->hdr->cq[f->cq_tail % ICC_RING_ENTRIES] = req->idx;
+	smp_store_release(&f->hdr->cq_tail, ++f->cq_tail);
+	req->busy = false;
+	/* release() syncs on cq_lock before freeing f */
+	atomic_dec(&f->inflight);
+	wake_up_all(&f->wq);
+	spin_unlock_irqrestore(&f->cq_lock, flags);
+}
+
+static u32 icc_ring_ready(struct icc_file *f)
+{
+	return smp_load_acquire(&f->hdr->cq_tail) - READ_ONCE(f->hdr->cq_head);
+}
+
+/* Submit everything queued between sq_head and sq_tail. Only sizes are
+ * validated: the ring belongs to this file alone, so a misbehaving caller can
+ * only garble its own requests. */
+static long icc_ring_submit(struct icc_file *f, struct abpcie_dev *sc)
+{
+	struct icc_ring_entry *e;
+	struct icc_ring_req *req;
+	u16 length, reply_length;
+	u32 tail, idx;
+	long submitted = 0;
+	int ret;
+
+	tail = smp_load_acquire(&f->hdr->sq_tail);
+	while (f->sq_head != tail) {
+		idx = f->sq_head % ICC_RING_ENTRIES;
+		req = &f->reqs[idx];
+		/* Queued past an entry that is still in flight */
+		if (READ_ONCE(req->busy))
+			break;
+
+		e = &f->entries[idx];
+		length = READ_ONCE(e->length);
+		reply_length = min_t(u16, READ_ONCE(e->reply_length),
+				     ICC_RING_DATA);
+
+		req->busy = true;
+		atomic_inc(&f->inflight);
+		if (length > ICC_MAX_PAYLOAD)
+			ret = -E2BIG;
+		else
+			ret = _icc_submit(sc, READ_ONCE(e->major),
+					  READ_ONCE(e->minor), e->data, length,
+					  e->data, reply_length, icc_ring_done,
+					  req, NULL);
+		if (ret)
+			icc_ring_done(req, ret);
+
+		f->sq_head++;
+		submitted++;
+	}
+	smp_store_release(&f->hdr->sq_head, f->sq_head);
+
+	return submitted ?: (f->sq_head != tail ? -EBUSY : 0);
+}
+
+static long icc_ring_enter(struct icc_file *f, unsigned long min_complete)
+{
+	struct abpcie_dev *sc;
+	long ret;
+
+	if (min_complete > ICC_RING_ENTRIES)
+		return -EINVAL;
+
+	mutex_lock(&f->sq_mutex);
+	if (!f->mem) {
+		mutex_unlock(&f->sq_mutex);
+		return -ENXIO;
+	}
+	sc = icc_get_sc();
+	ret = sc ? icc_ring_submit(f, sc) : -EAGAIN;
+	mutex_unlock(&f->sq_mutex);
+	if (ret < 0 || !min_complete)
+		return ret;
+
+	if (wait_event_interruptible(f->wq, icc_ring_ready(f) >= min_complete ||
+				     !atomic_read(&f->inflight)))
+		return ret ?: -ERESTARTSYS;
+	return ret;
+}
+
+static long icc_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+	struct icc_file *f = file->private_data;
+
+	switch (cmd) {
+	case ICC_IOCTL_CMD:
+		return icc_ioctl_cmd((void __user *)arg);
+	case ICC_IOCTL_RING_ENTER:
+		return icc_ring_enter(f, arg);
+	default:
+		return -ENOENT;
+	}
+}
+
+static int icc_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct icc_file *f = file->private_data;
+	void *mem;
+	int i, ret = 0;
+
+	if (vma->vm_pgoff || vma->vm_end - vma->vm_start != ICC_RING_SIZE)
+		return -EINVAL;
+
+	mutex_lock(&f->sq_mutex);
+	if (!f->mem) {
+		mem = vmalloc_user(ICC_RING_SIZE);
+		if (!mem) {
+			ret = -ENOMEM;
+			goto out;
+		}
+		f->hdr = mem;
+		f->hdr->entries = ICC_RING_ENTRIES;
+		f->entries = mem + ICC_RING_ENTRIES_OFF;
+		for (i = 0; i < ICC_RING_ENTRIES; i++) {
+			f->reqs[i].f = f;
+			f->reqs[i].idx = i;
+		}
+		smp_store_release(&f->mem, mem);
+	}
+	ret = remap_vmalloc_range(vma, f->mem, 0);
+out:
+	mutex_unlock(&f->sq_mutex);
+	return ret;
+}
+
+static __poll_t icc_poll(struct file *file, poll_table *wait)
+{
+	struct icc_file *f = file->private_data;
+
+	poll_wait(file, &f->wq, wait);
+	if (smp_load_acquire(&f->mem) && icc_ring_ready(f))
+		return EPOLLIN | EPOLLRDNORM;
+	return 0;
+}
+
+static int icc_open(struct inode *inode, struct file *file)
+{
+	struct icc_file *f;
+
+	BUILD_BUG_ON(sizeof(struct icc_ring_entry) != ICC_RING_ENTRY_SIZE);
+	BUILD_BUG_ON(sizeof(struct icc_ring_hdr) > ICC_RING_ENTRIES_OFF);
+	BUILD_BUG_ON(ICC_RING_DATA < ICC_MAX_PAYLOAD);
+
+	f = kzalloc(sizeof(*f), GFP_KERNEL);
+	if (!f)
+		return -ENOMEM;
+	mutex_init(&f->sq_mutex);
+	spin_lock_init(&f->cq_lock);
+	init_waitqueue_head(&f->wq);
+	atomic_set(&f->inflight, 0);
+	file->private_data = f;
+
+	return 0;
+}
+
+static int icc_release(struct inode *inode, struct file *file)
+{
+	struct icc_file *f = file->private_data;
+
+	/* Replies land in the ring; every request ends by its timeout */
+	wait_event(f->wq, !atomic_read(&f->inflight));
+	spin_lock_irq(&f->cq_lock);
+	spin_unlock_irq(&f->cq_lock);
+
+	vfree(f->mem);
+	kfree(f);
+	return 0;
+}
+
+static const struct file_operations icc_fops = {
+	.owner = THIS_MODULE,
+	.open = icc_open,
+	.release = icc_release,
+	.unlocked_ioctl = icc_ioctl,
+	.mmap = icc_mmap,
+	.poll = icc_poll,
+};
+
+/* Not fatal if this fails, the in-kernel interface keeps working */
+void icc_chrdev_init(struct abpcie_dev *sc)
+{
+	int ret;
+
+	ret = register_chrdev(ICC_MAJOR, "icc", &icc_fops);
+	if (ret)
+		sc_err("icc: register_chrdev failed: %d\n", ret);
+}
+
+/* Start the transport once sc->icc.regs and sc->icc.spm have been mapped by
+ * the southbridge driver. On success sc becomes the global ICC device. */
+int icc_core_init(struct abpcie_dev *sc, int irq)
+{
+	int i, ret;
+	u32 req_empty, req_full;
+
+	spin_lock_init(&sc->icc.slot_lock);
+	mutex_init(&sc->icc.tx_mutex);
+	init_waitqueue_head(&sc->icc.wq);
+	for (i = 0; i < ICC_MAX_INFLIGHT; i++) {
+		sc->icc.slots[i].sc = sc;
+		atomic_set(&sc->icc.slots[i].state, ICC_SLOT_FREE);
+		timer_setup(&sc->icc.slots[i].timer, icc_timeout, 0);
+	}
+	INIT_KFIFO(sc->icc.events);
+	INIT_WORK(&sc->icc.event_work, icc_event_work);
+	icc_debugfs_init(sc);
+
+	/* Clear flags */
+	iowrite32(ICC_SEND | ICC_ACK, sc->icc.regs + ICC_REG_STATUS);
+
+	ret = request_irq(irq, icc_interrupt, IRQF_SHARED, "icc", sc);
+	if (ret) {
+		sc_err("icc: could not request IRQ: %d\n", ret);
+		icc_debugfs_remove(sc);
+		return ret;
+	}
+
+	req_empty = ioread32(REQUEST + BUF_EMPTY);
+	req_full = ioread32(REQUEST + BUF_FULL);
+
+	if (req_empty != 1 || req_full != 0) {
+		sc_err("icc: request buffer is busy: empty=%d full=%d\n",
+		       req_empty, req_full);
+		free_irq(irq, sc);
+		icc_debugfs_remove(sc);
+		return -EIO;
+	}
+
+	sc->icc.irq = irq;
+
+	mutex_lock(&icc_mutex);
+	icc_sc = sc;
+
+	/* Enable IRQs */
+	iowrite32(ICC_SEND | ICC_ACK, sc->icc.regs + ICC_REG_IRQ_MASK);
+	mutex_unlock(&icc_mutex);
+
+	return 0;
+}
+
+void icc_core_remove(struct abpcie_dev *sc, int irq)
+{
+	int i;
+
+	mutex_lock(&icc_mutex);
+	iowrite32(0, sc->icc.regs + ICC_REG_IRQ_MASK);
+	icc_sc = NULL;
+	mutex_unlock(&icc_mutex);
+	free_irq(irq, sc);
+	for (i = 0; i < ICC_MAX_INFLIGHT; i++)
+		del_timer_sync(&sc->icc.slots[i].timer);
+	cancel_work_sync(&sc->icc.event_work);
+	icc_debugfs_remove(sc);
+}
+
+static bool icc_idle(struct abpcie_dev *sc)
+{
+	int i;
+
+	for (i = 0; i < ICC_MAX_INFLIGHT; i++)
+		if (atomic_read(&sc->icc.slots[i].state) != ICC_SLOT_FREE)
+			return false;
+	return true;
+}
+
+/* Leave the mailbox idle for a kexec'd kernel: no request of ours still
+ * owed a reply and the ICC IRQ masked, so icc_core_init() over there finds
+ * the request buffer free and no stale reply pending. */
+void icc_core_shutdown(struct abpcie_dev *sc)
+{
+	mutex_lock(&sc->icc.tx_mutex);
+	sc->icc.suspended = true;
+	mutex_unlock(&sc->icc.tx_mutex);
+
+	if (!wait_event_timeout(sc->icc.wq, icc_idle(sc), HZ * ICC_TIMEOUT))
+		sc_err("icc: requests still in flight at shutdown\n");
+
+	iowrite32(0, sc->icc.regs + ICC_REG_IRQ_MASK);
+	iowrite32(ICC_SEND | ICC_ACK, sc->icc.regs + ICC_REG_STATUS);
+	cancel_work_sync(&sc->icc.event_work);
+}
+
+#ifdef CONFIG_PM
+
+/* The EMC keeps running while the host sleeps and reports the power button
+ * as an ordinary ICC event, so arming the ICC vector as a wakeup source is
+ * all it takes for the button to bring the system out of suspend-to-idle.
+ *
+ * New requests are refused from here on and the ones in flight are given
+ * the usual timeout to complete, so that no reply is still owed to a slot
+ * when the southbridge goes down. */
+void icc_core_suspend(struct abpcie_dev *sc)
+{
+	mutex_lock(&sc->icc.tx_mutex);
+	sc->icc.suspended = true;
+	mutex_unlock(&sc->icc.tx_mutex);
+
+	if (!wait_event_timeout(sc->icc.wq, icc_idle(sc), HZ * ICC_TIMEOUT))
+		sc_err("icc: requests still in flight at suspend\n");
+
+	sc->icc.irq_wake = false;
+	if (device_may_wakeup(&sc->pdev->dev))
+		sc->icc.irq_wake = !enable_irq_wake(sc->icc.irq);
+}
+
+void icc_core_resume(struct abpcie_dev *sc)
+{
+	if (sc->icc.irq_wake)
+		disable_irq_wake(sc->icc.irq);
+	sc->icc.irq_wake = false;
+
+	/* Nothing to do after suspend-to-idle; after S3 the register block
+	 * comes back with the IRQs masked. */
+	if (ioread32(sc->icc.regs + ICC_REG_IRQ_MASK) !=
+	    (ICC_SEND | ICC_ACK)) {
+		iowrite32(ICC_SEND | ICC_ACK, sc->icc.regs + ICC_REG_STATUS);
+		iowrite32(ICC_SEND | ICC_ACK, sc->icc.regs + ICC_REG_IRQ_MASK);
+	}
+	if (!icc_request_buffer_free(sc))
+		sc_err("icc: request buffer is busy after resume: empty=%d full=%d\n",
+		       ioread32(REQUEST + BUF_EMPTY),
+		       ioread32(REQUEST + BUF_FULL));
+
+	/* The event that woke us was replayed with the other device IRQs
+	 * before ->resume; let listeners see it while still suspended. */
+	flush_work(&sc->icc.event_work);
+
+	mutex_lock(&sc->icc.tx_mutex);
+	sc->icc.suspended = false;
+	mutex_unlock(&sc->icc.tx_mutex);
+}
+#endif
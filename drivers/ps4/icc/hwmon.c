@@ -0,0 +1,231 @@
+/*
+ * EMC temperatures and fan, read over ICC
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ * of the License.
+ */
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/mutex.h>
+#include <linux/jiffies.h>
+#include <linux/hwmon.h>
+#include <asm/unaligned.h>
+
+#include "../aeolia.h"
+
+#define apcie_dev		abpcie_dev
+
+/* All of these are not confirmed */
+#define ICC_THERMAL		0x0a
+#define ICC_THERMAL_GET_TEMP	0x00
+#define ICC_THERMAL_GET_FAN	0x01
+#define ICC_THERMAL_GET_THRESH	0x07
+
+/* Temperatures are signed 8.8 fixed point degrees C, after a 16 bit status */
+#define ICC_TEMP_APU		2
+#define ICC_TEMP_SB		4
+
+#define ICC_HWMON_TEMPS		2
+
+/* The EMC samples the sensors about once a second itself */
+#define ICC_HWMON_INTERVAL	1000	/* ms */
+
+struct icc_hwmon {
+	struct device *dev;
+
+	/* Protects the cached readings and update_interval */
+	struct mutex lock;
+	unsigned long last_updated;
+	unsigned int update_interval;
+	bool valid;
+
+	long temp[ICC_HWMON_TEMPS];	/* millidegrees C */
+	long fan;			/* RPM */
+	long thresh;			/* fan servo threshold, millidegrees C */
+};
+
+static const char * const icc_hwmon_temp_label[ICC_HWMON_TEMPS] = {
+	"APU", "Southbridge",
+};
+
+static long icc_temp_to_mdeg(const u8 *p)
+{
+	return ((s16)get_unaligned_le16(p) * 1000L) / 256;
+}
+
+/* Called with hw->lock held. One round trip instead of one per attribute:
+ * the three queries don't depend on each other, so they go out as a batch
+ * and a read of every sensor in sysfs costs the EMC at most one update per
+ * interval. */
+static int icc_hwmon_update(struct icc_hwmon *hw)
+{
+	u8 temp_reply[8], fan_reply[4], thresh_reply[4];
+	struct icc_cmdv cmds[] = {
+		{ ICC_THERMAL, ICC_THERMAL_GET_TEMP, NULL, 0,
+		  temp_reply, sizeof(temp_reply) },
+		{ ICC_THERMAL, ICC_THERMAL_GET_FAN, NULL, 0,
+		  fan_reply, sizeof(fan_reply) },
+		{ ICC_THERMAL, ICC_THERMAL_GET_THRESH, NULL, 0,
+		  thresh_reply, sizeof(thresh_reply) },
+	};
+	int ret;
+
+	if (hw->valid && time_before(jiffies, hw->last_updated +
+				     msecs_to_jiffies(hw->update_interval)))
+		return 0;
+
+	ret = apcie_icc_cmdv(cmds, ARRAY_SIZE(cmds));
+	if (ret < 0)
+		return ret;
+	if (cmds[0].ret < (int)sizeof(temp_reply) ||
+	    cmds[1].ret < (int)sizeof(fan_reply) ||
+	    cmds[2].ret < 3)
+		return -EIO;
+
+	hw->temp[0] = icc_temp_to_mdeg(&temp_reply[ICC_TEMP_APU]);
+	hw->temp[1] = icc_temp_to_mdeg(&temp_reply[ICC_TEMP_SB]);
+	hw->fan = get_unaligned_le16(&fan_reply[2]);
+	hw->thresh = thresh_reply[2] * 1000L;
+	hw->last_updated = jiffies;
+	hw->valid = true;
+	return 0;
+}
+
+static umode_t icc_hwmon_is_visible(const void *data,
+				    enum hwmon_sensor_types type,
+				    u32 attr, int channel)
+{
+	switch (type) {
+	case hwmon_chip:
+		if (attr == hwmon_chip_update_interval)
+			return 0644;
+		break;
+	case hwmon_temp:
+		/* The fan follows the APU temperature only */
+		if (attr == hwmon_temp_max)
+			return channel == 0 ? 0444 : 0;
+		return 0444;
+	case hwmon_fan:
+		return 0444;
+	default:
+		break;
+	}
+	return 0;
+}
+
+static int icc_hwmon_read(struct device *dev, enum hwmon_sensor_types type,
+			  u32 attr, int channel, long *val)
+{
+	struct icc_hwmon *hw = dev_get_drvdata(dev);
+	int ret = 0;
+
+	mutex_lock(&hw->lock);
+	if (type == hwmon_chip) {
+		*val = hw->update_interval;
+		goto out;
+	}
+
+	ret = icc_hwmon_update(hw);
+	if (ret)
+		goto out;
+
+	if (type == hwmon_temp && attr == hwmon_temp_input)
+		*val = hw->temp[channel];
+	else if (type == hwmon_temp && attr == hwmon_temp_max)
+		*val = hw->thresh;
+	else if (type == hwmon_fan && attr == hwmon_fan_input)
+		*val = hw->fan;
+	else
+		ret = -EOPNOTSUPP;
+out:
+	mutex_unlock(&hw->lock);
+	return ret;
+}
+
+static int icc_hwmon_write(struct device *dev, enum hwmon_sensor_types type,
+			   u32 attr, int channel, long val)
+{
+	struct icc_hwmon *hw = dev_get_drvdata(dev);
+
+	if (type != hwmon_chip || attr != hwmon_chip_update_interval)
+		return -EOPNOTSUPP;
+
+	mutex_lock(&hw->lock);
+	hw->update_interval = clamp_val(val, 0, 60 * MSEC_PER_SEC);
+	mutex_unlock(&hw->lock);
+	return 0;
+}
+
+static int icc_hwmon_read_string(struct device *dev,
+				 enum hwmon_sensor_types type, u32 attr,
+				 int channel, const char **str)
+{
+	if (type != hwmon_temp || attr != hwmon_temp_label)
+		return -EOPNOTSUPP;
+	*str = icc_hwmon_temp_label[channel];
+	return 0;
+}
+
+static const struct hwmon_channel_info *icc_hwmon_info[] = {
+	HWMON_CHANNEL_INFO(chip, HWMON_C_UPDATE_INTERVAL),
+	HWMON_CHANNEL_INFO(temp,
+			   HWMON_T_INPUT | HWMON_T_LABEL | HWMON_T_MAX,
+			   HWMON_T_INPUT | HWMON_T_LABEL),
+	HWMON_CHANNEL_INFO(fan, HWMON_F_INPUT),
+	NULL
+};
+
+static const struct hwmon_ops icc_hwmon_ops = {
+	.is_visible = icc_hwmon_is_visible,
+	.read = icc_hwmon_read,
+	.write = icc_hwmon_write,
+	.read_string = icc_hwmon_read_string,
+};
+
+static const struct hwmon_chip_info icc_hwmon_chip_info = {
+	.ops = &icc_hwmon_ops,
+	.info = icc_hwmon_info,
+};
+
+int icc_hwmon_init(struct apcie_dev *sc)
+{
+	struct icc_hwmon *hw;
+
+	if (!IS_REACHABLE(CONFIG_HWMON))
+		return 0;
+
+	hw = kzalloc(sizeof(*hw), GFP_KERNEL);
+	if (!hw)
+		return -ENOMEM;
+
+	mutex_init(&hw->lock);
+	hw->update_interval = ICC_HWMON_INTERVAL;
+	hw->dev = hwmon_device_register_with_info(&sc->pdev->dev, "ps4_emc",
+						  hw, &icc_hwmon_chip_info,
+						  NULL);
+	if (IS_ERR(hw->dev)) {
+		int ret = PTR_ERR(hw->dev);
+
+		sc_err("icc: failed to register hwmon device: %d\n", ret);
+		kfree(hw);
+		return ret;
+	}
+
+	sc->icc.hwmon = hw;
+	return 0;
+}
+
+void icc_hwmon_remove(struct apcie_dev *sc)
+{
+	struct icc_hwmon *hw = sc->icc.hwmon;
+
+	if (!IS_REACHABLE(CONFIG_HWMON) || !hw)
+		return;
+
+	hwmon_device_unregister(hw->dev);
+	kfree(hw);
+	sc->icc.hwmon = NULL;
+}
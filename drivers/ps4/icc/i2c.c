@@ -1,6 +1,9 @@
 #include <linux/serial_8250.h>
 #include <linux/serial_core.h>
 #include <linux/serial_reg.h>
+#include <linux/slab.h>
+
+#include <asm/unaligned.h>
 
 #include "../aeolia.h"
 
@@ -119,14 +122,156 @@ static int icc_i2c_smbus_xfer(struct i2c_adapter *adapter, u16 addr,
 	return 0;
 }
 
+/* Layout of a single-op ICC i2c command, as used by icc_i2c_smbus_xfer():
+ *
+ *   request: code, u16 length, count = 1, then one command
+ *            { major, length, minor, count = 1 } followed by the op
+ *   reply:   status0, status1, then read data at offset 8
+ *
+ * The reply layout for several ops in one command has not been worked out,
+ * so master_xfer sends every op as an ICC command of its own.
+ */
+#define ICC_I2C_HDR_SIZE	4
+#define ICC_I2C_CMD_SIZE	4
+#define ICC_I2C_XFER_SIZE	3
+#define ICC_I2C_READ_OFFSET	8
+
+struct icc_i2c_buf {
+	u8 req[ICC_MAX_PAYLOAD];
+	u8 reply[ICC_MAX_PAYLOAD];
+};
+
+/* An ICC op always carries a register address, so reads have to come as the
+ * usual "write register, repeated start, read" pair. */
+static bool icc_i2c_is_read(struct i2c_msg *msgs, int i, int num)
+{
+	return i + 1 < num && !(msgs[i].flags & I2C_M_RD) &&
+		msgs[i].len == 1 && (msgs[i + 1].flags & I2C_M_RD) &&
+		msgs[i + 1].addr == msgs[i].addr;
+}
+
+static int icc_i2c_check_msgs(struct apcie_dev *sc, struct i2c_msg *msgs,
+			      int num)
+{
+	int i;
+
+	for (i = 0; i < num; i++) {
+		struct i2c_msg *m = &msgs[i];
+
+		if (m->flags & (I2C_M_TEN | I2C_M_RECV_LEN)) {
+			sc_err("icc-i2c: unsupported message flags 0x%x\n",
+			       m->flags);
+			return -EOPNOTSUPP;
+		}
+		if (icc_i2c_is_read(msgs, i, num)) {
+			if (msgs[i + 1].len > ICC_MAX_READ_DATA ||
+			    ICC_I2C_READ_OFFSET + msgs[i + 1].len > ICC_MAX_PAYLOAD)
+				return -E2BIG;
+			i++;
+			continue;
+		}
+		if ((m->flags & I2C_M_RD) || !m->len) {
+			sc_err("icc-i2c: reads need a register address\n");
+			return -EOPNOTSUPP;
+		}
+		if (m->len - 1 > ICC_MAX_WRITE_DATA)
+			return -E2BIG;
+	}
+
+	return 0;
+}
+
+/* Issue msgs[i] (and msgs[i + 1] for a read) as one single-op ICC command. */
+static int icc_i2c_op(struct apcie_dev *sc, struct icc_i2c_buf *b,
+		      struct i2c_msg *msgs, int i, bool read)
+{
+	struct i2c_msg *m = &msgs[i];
+	size_t data_len = read ? 1 : m->len - 1;
+	size_t cmd_len = ICC_I2C_CMD_SIZE + ICC_I2C_XFER_SIZE + data_len;
+	u16 length = ICC_I2C_HDR_SIZE + cmd_len;
+	u8 *cmd = b->req + ICC_I2C_HDR_SIZE;
+	int ret;
+
+	b->req[0] = 4; /* Don't really know what this is */
+	put_unaligned_le16(length, &b->req[1]);
+	b->req[3] = 1;
+
+	cmd[0] = read ? 1 : 2;
+	cmd[1] = cmd_len;
+	cmd[2] = cmd[0];
+	cmd[3] = 1;
+	cmd[4] = read ? msgs[i + 1].len : data_len;
+	cmd[5] = m->addr << 1;
+	cmd[6] = m->buf[0];
+	if (read)
+		cmd[7] = 0; /* unknown */
+	else
+		memcpy(&cmd[7], &m->buf[1], data_len);
+
+	ret = apcie_icc_cmd(0x10, 0x0, b->req, length, b->reply,
+			    sizeof(b->reply));
+	if (ret < 2 || ret > sizeof(b->reply)) {
+		sc_err("icc-i2c: icc command failed: %d\n", ret);
+		return -EIO;
+	}
+	if (b->reply[0] != 0 || b->reply[1] != 0) {
+		sc_err("icc-i2c: i2c command failed: %d, %d\n",
+		       b->reply[0], b->reply[1]);
+		return -EIO;
+	}
+
+	if (read) {
+		if (ret < ICC_I2C_READ_OFFSET + msgs[i + 1].len) {
+			sc_err("icc-i2c: short reply for message %d\n", i);
+			return -EIO;
+		}
+		memcpy(msgs[i + 1].buf, b->reply + ICC_I2C_READ_OFFSET,
+		       msgs[i + 1].len);
+	}
+
+	return 0;
+}
+
+static int icc_i2c_master_xfer(struct i2c_adapter *adapter,
+			       struct i2c_msg *msgs, int num)
+{
+	struct apcie_dev *sc = i2c_get_adapdata(adapter);
+	struct icc_i2c_buf *b;
+	int ret, i;
+
+	ret = icc_i2c_check_msgs(sc, msgs, num);
+	if (ret)
+		return ret;
+
+	b = kmalloc(sizeof(*b), GFP_KERNEL);
+	if (!b)
+		return -ENOMEM;
+
+	for (i = 0; i < num; i++) {
+		bool read = icc_i2c_is_read(msgs, i, num);
+
+		ret = icc_i2c_op(sc, b, msgs, i, read);
+		if (ret)
+			break;
+		if (read)
+			i++;
+	}
+
+	kfree(b);
+	return ret ? ret : num;
+}
+
 u32 icc_i2c_functionality(struct i2c_adapter *adap)
 {
+	/* No I2C_FUNC_I2C: plain reads without a register address are not
+	 * possible over ICC, so master_xfer only takes register accesses. */
 	return I2C_FUNC_SMBUS_BYTE_DATA |
 		I2C_FUNC_SMBUS_WORD_DATA |
 		I2C_FUNC_SMBUS_I2C_BLOCK;
 }
 
 static const struct i2c_algorithm icc_i2c_algo = {
+	.master_xfer  = &icc_i2c_master_xfer,
 	.smbus_xfer   = &icc_i2c_smbus_xfer,
 	.functionality = &icc_i2c_functionality,
 };
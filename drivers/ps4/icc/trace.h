@@ -0,0 +1,85 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM icc
+
+#if !defined(_ICC_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _ICC_TRACE_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(icc_irq,
+	TP_PROTO(u32 status),
+	TP_ARGS(status),
+	TP_STRUCT__entry(
+		__field(u32, status)
+	),
+	TP_fast_assign(
+		__entry->status = status;
+	),
+	TP_printk("status %x", __entry->status)
+);
+
+DECLARE_EVENT_CLASS(icc_message,
+	TP_PROTO(u8 major, u16 minor, u16 cookie, u16 length),
+	TP_ARGS(major, minor, cookie, length),
+	TP_STRUCT__entry(
+		__field(u8, major)
+		__field(u16, minor)
+		__field(u16, cookie)
+		__field(u16, length)
+	),
+	TP_fast_assign(
+		__entry->major = major;
+		__entry->minor = minor;
+		__entry->cookie = cookie;
+		__entry->length = length;
+	),
+	TP_printk("%02x:%04x #%u len %u", __entry->major, __entry->minor,
+		  __entry->cookie, __entry->length)
+);
+
+/* Request written to SPM, doorbell about to be rung */
+DEFINE_EVENT(icc_message, icc_send,
+	TP_PROTO(u8 major, u16 minor, u16 cookie, u16 length),
+	TP_ARGS(major, minor, cookie, length)
+);
+
+/* A reply matched to an outstanding request */
+DEFINE_EVENT(icc_message, icc_reply,
+	TP_PROTO(u8 major, u16 minor, u16 cookie, u16 length),
+	TP_ARGS(major, minor, cookie, length)
+);
+
+/* An unsolicited event from the EMC */
+DEFINE_EVENT(icc_message, icc_event,
+	TP_PROTO(u8 major, u16 minor, u16 cookie, u16 length),
+	TP_ARGS(major, minor, cookie, length)
+);
+
+/* A request finished, by reply, timeout or error */
+TRACE_EVENT(icc_complete,
+	TP_PROTO(u8 major, u16 minor, u16 cookie, int ret),
+	TP_ARGS(major, minor, cookie, ret),
+	TP_STRUCT__entry(
+		__field(u8, major)
+		__field(u16, minor)
+		__field(u16, cookie)
+		__field(int, ret)
+	),
+	TP_fast_assign(
+		__entry->major = major;
+		__entry->minor = minor;
+		__entry->cookie = cookie;
+		__entry->ret = ret;
+	),
+	TP_printk("%02x:%04x #%u ret %d", __entry->major, __entry->minor,
+		  __entry->cookie, __entry->ret)
+);
+
+#endif /* _ICC_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE trace
+#include <trace/define_trace.h>
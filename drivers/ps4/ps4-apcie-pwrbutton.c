@@ -1,15 +1,41 @@
 #include <linux/input.h>
+#include <linux/pm_wakeup.h>
 #include "aeolia.h"
 #include "baikal.h"
 
-void icc_pwrbutton_trigger(struct abpcie_dev *sc, int state)
+#define ICC_EVENT_PWRBUTTON_DOWN	0x8010
+#define ICC_EVENT_PWRBUTTON_UP		0x8011
+
+static void icc_pwrbutton_event(struct icc_event_listener *l, u8 major,
+				u16 minor, const void *data, u16 length)
 {
+	struct abpcie_dev *sc = container_of(l, struct abpcie_dev,
+					     icc.pwrbutton_listener);
+
+	/* A press that woke us from suspend-to-idle only needs to be counted
+	 * as a wakeup event; reporting KEY_POWER as well would have userspace
+	 * turn around and power the machine off. */
+	if (minor == ICC_EVENT_PWRBUTTON_DOWN)
+		pm_wakeup_hard_event(&sc->pdev->dev);
+	if (READ_ONCE(sc->icc.suspended))
+		return;
+
 	if (sc->icc.pwrbutton_dev) {
-		input_report_key(sc->icc.pwrbutton_dev, KEY_POWER, state ? 1 : 0);
+		input_report_key(sc->icc.pwrbutton_dev, KEY_POWER,
+				 minor == ICC_EVENT_PWRBUTTON_DOWN);
 		input_sync(sc->icc.pwrbutton_dev);
 	}
 }
 
+static void icc_pwrbutton_enabled(void *ctx, int ret)
+{
+	struct abpcie_dev *sc = ctx;
+
+	if (ret < 0)
+		sc_info("%s: Failed to enable button notifications (%d)\n",
+			__func__, ret);
+}
+
 int icc_pwrbutton_init(struct abpcie_dev *sc)
 {
 	int ret = 0;
@@ -42,12 +68,19 @@ int icc_pwrbutton_init(struct abpcie_dev *sc)
 	}
 
 	sc->icc.pwrbutton_dev = dev;
+	device_init_wakeup(&sc->pdev->dev, true);
+
+	sc->icc.pwrbutton_listener.major = 8;
+	sc->icc.pwrbutton_listener.minor_first = ICC_EVENT_PWRBUTTON_DOWN;
+	sc->icc.pwrbutton_listener.minor_last = ICC_EVENT_PWRBUTTON_UP;
+	sc->icc.pwrbutton_listener.handler = icc_pwrbutton_event;
+	apcie_icc_register_event(&sc->icc.pwrbutton_listener);
 
 	// enable power button notifications
+	// nothing depends on the reply, so don't hold up the probe for it
 	button = 0x100;
-	ret = bpcie_is_compatible_device(sc->pdev) ?
-			bpcie_icc_cmd(8, 1, &button, sizeof(button), NULL, 0) :
-			apcie_icc_cmd(8, 1, &button, sizeof(button), NULL, 0);
+	ret = apcie_icc_cmd_async(8, 1, &button, sizeof(button), NULL, 0,
+				  icc_pwrbutton_enabled, sc);
 	if (ret < 0) {
 		sc_info("%s: Failed to enable power notifications (%d)\n",
 			__func__, ret);
@@ -55,9 +88,8 @@ int icc_pwrbutton_init(struct abpcie_dev *sc)
 
 	// enable reset button notifications (?)
 	button = 0x102;
-	ret = bpcie_is_compatible_device(sc->pdev) ?
-			bpcie_icc_cmd(8, 1, &button, sizeof(button), NULL, 0) :
-			apcie_icc_cmd(8, 1, &button, sizeof(button), NULL, 0);
+	ret = apcie_icc_cmd_async(8, 1, &button, sizeof(button), NULL, 0,
+				  icc_pwrbutton_enabled, sc);
 	if (ret < 0) {
 		sc_info("%s: Failed to enable reset notifications (%d)\n",
 		        __func__, ret);
@@ -68,7 +100,10 @@ int icc_pwrbutton_init(struct abpcie_dev *sc)
 
 void icc_pwrbutton_remove(struct abpcie_dev *sc)
 {
-	if (sc->icc.pwrbutton_dev)
+	if (sc->icc.pwrbutton_dev) {
+		apcie_icc_unregister_event(&sc->icc.pwrbutton_listener);
+		device_init_wakeup(&sc->pdev->dev, false);
 		input_free_device(sc->icc.pwrbutton_dev);
+	}
 	sc->icc.pwrbutton_dev = NULL;
 }
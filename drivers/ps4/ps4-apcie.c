@@ -8,6 +8,10 @@
 #include <linux/irqchip.h>
 #include <linux/irqdomain.h>
 #include <linux/msi.h>
+#include <linux/slab.h>
+#include <linux/interrupt.h>
+#include <linux/kexec.h>
+#include <linux/sched/isolation.h>
 #include <asm/irqdomain.h>
 #include <asm/irq_remapping.h>
 
@@ -242,6 +246,8 @@ int apcie_assign_irqs(struct pci_dev *dev, int nvec)
 	struct pci_dev *sc_dev;
 	struct apcie_dev *sc;
 	struct irq_alloc_info info;
+	struct irq_affinity affd = {};
+	struct irq_affinity_desc *masks = NULL;
 
 	sc_devfn = (dev->devfn & ~7) | AEOLIA_FUNC_ID_PCIE;
 	sc_dev = pci_get_slot(dev->bus, sc_devfn);
@@ -277,7 +283,16 @@ int apcie_assign_irqs(struct pci_dev *dev, int nvec)
 	}
 #endif
 
-	ret = irq_domain_alloc_irqs(sc->irqdomain, nvec, NUMA_NO_NODE, &info);
+	/* With one vector per subfunction (interrupt remapping), spread them
+	 * over the CPUs as managed IRQs instead of stacking them all on the
+	 * boot CPU. A shared vector keeps the default affinity, and so do all
+	 * vectors with nohz_full, as managed IRQs would land on those CPUs. */
+	if (nvec > 1 && !housekeeping_enabled(HK_FLAG_TICK))
+		masks = irq_create_affinity_masks(nvec, &affd);
+
+	ret = __irq_domain_alloc_irqs(sc->irqdomain, -1, nvec, NUMA_NO_NODE,
+				      &info, false, masks);
+	kfree(masks);
 	if (ret >= 0) {
 		dev->irq = ret;
 		ret = nvec;
@@ -302,6 +317,27 @@ EXPORT_SYMBOL(apcie_free_irqs);
 
 static void apcie_glue_remove(struct apcie_dev *sc);
 
+/* BAR windows of the other functions, as seen from the glue */
+static void apcie_glue_set_regions(struct apcie_dev *sc)
+{
+	glue_set_region(sc, AEOLIA_FUNC_ID_GBE, 0, 0xbfa00000, 0x3fff);
+	glue_set_region(sc, AEOLIA_FUNC_ID_AHCI, 5, 0xbfa04000, 0xfff);
+	glue_set_region(sc, AEOLIA_FUNC_ID_SDHCI, 0, 0xbfa80000, 0xfff);
+	glue_set_region(sc, AEOLIA_FUNC_ID_SDHCI, 1, 0, 0);
+	glue_set_region(sc, AEOLIA_FUNC_ID_DMAC, 0, 0xbfa05000, 0xfff);
+	glue_set_region(sc, AEOLIA_FUNC_ID_DMAC, 1, 0, 0);
+	glue_set_region(sc, AEOLIA_FUNC_ID_DMAC, 2, 0xbfa06000, 0xfff);
+	glue_set_region(sc, AEOLIA_FUNC_ID_DMAC, 3, 0, 0);
+	glue_set_region(sc, AEOLIA_FUNC_ID_MEM, 2, 0xc0000000, 0x3fffffff);
+	glue_set_region(sc, AEOLIA_FUNC_ID_MEM, 3, 0, 0);
+	glue_set_region(sc, AEOLIA_FUNC_ID_XHCI, 0, 0xbf400000, 0x1fffff);
+	glue_set_region(sc, AEOLIA_FUNC_ID_XHCI, 1, 0, 0);
+	glue_set_region(sc, AEOLIA_FUNC_ID_XHCI, 2, 0xbf600000, 0x1fffff);
+	glue_set_region(sc, AEOLIA_FUNC_ID_XHCI, 3, 0, 0);
+	glue_set_region(sc, AEOLIA_FUNC_ID_XHCI, 4, 0xbf800000, 0x1fffff);
+	glue_set_region(sc, AEOLIA_FUNC_ID_XHCI, 5, 0, 0);
+}
+
 static int apcie_glue_init(struct apcie_dev *sc)
 {
 	int i;
@@ -342,22 +378,7 @@ static int apcie_glue_init(struct apcie_dev *sc)
 	for (i = 0; i < 0xfc; i += 4)
 		glue_write32(sc, APCIE_REG_MSI_DATA_LO(i), 0);
 
-	glue_set_region(sc, AEOLIA_FUNC_ID_GBE, 0, 0xbfa00000, 0x3fff);
-	glue_set_region(sc, AEOLIA_FUNC_ID_AHCI, 5, 0xbfa04000, 0xfff);
-	glue_set_region(sc, AEOLIA_FUNC_ID_SDHCI, 0, 0xbfa80000, 0xfff);
-	glue_set_region(sc, AEOLIA_FUNC_ID_SDHCI, 1, 0, 0);
-	glue_set_region(sc, AEOLIA_FUNC_ID_DMAC, 0, 0xbfa05000, 0xfff);
-	glue_set_region(sc, AEOLIA_FUNC_ID_DMAC, 1, 0, 0);
-	glue_set_region(sc, AEOLIA_FUNC_ID_DMAC, 2, 0xbfa06000, 0xfff);
-	glue_set_region(sc, AEOLIA_FUNC_ID_DMAC, 3, 0, 0);
-	glue_set_region(sc, AEOLIA_FUNC_ID_MEM, 2, 0xc0000000, 0x3fffffff);
-	glue_set_region(sc, AEOLIA_FUNC_ID_MEM, 3, 0, 0);
-	glue_set_region(sc, AEOLIA_FUNC_ID_XHCI, 0, 0xbf400000, 0x1fffff);
-	glue_set_region(sc, AEOLIA_FUNC_ID_XHCI, 1, 0, 0);
-	glue_set_region(sc, AEOLIA_FUNC_ID_XHCI, 2, 0xbf600000, 0x1fffff);
-	glue_set_region(sc, AEOLIA_FUNC_ID_XHCI, 3, 0, 0);
-	glue_set_region(sc, AEOLIA_FUNC_ID_XHCI, 4, 0xbf800000, 0x1fffff);
-	glue_set_region(sc, AEOLIA_FUNC_ID_XHCI, 5, 0, 0);
+	apcie_glue_set_regions(sc);
 
 	sc->irqdomain = apcie_create_irq_domain(sc);
 	if (!sc->irqdomain) {
@@ -393,12 +414,44 @@ static void apcie_glue_remove(struct apcie_dev *sc) {
 			   APCIE_RGN_PCIE_BASE, APCIE_RGN_PCIE_SIZE);
 }
 
+/* Nothing of the kexec'd kernel is listening on the vectors the glue
+ * routes to yet; its apcie_glue_init() sets the routing up from scratch. */
+static void apcie_glue_shutdown(struct apcie_dev *sc) {
+	int i;
+
+	for (i = 0; i < AEOLIA_NUM_FUNCS; i++)
+		glue_write32(sc, APCIE_REG_MSI_MASK(i), 0);
+}
+
 #ifdef CONFIG_PM
+/* Everything from APCIE_REG_MSI_CONTROL up to the last DATA_LO slot */
+#define APCIE_MSI_SAVE_REGS	(0x200 / 4)
+
+static u32 apcie_msi_saved[APCIE_MSI_SAVE_REGS];
+
+/* The MSI routing written by apcie_config_msi lives in the glue, not in the
+ * config space of the functions, so the PCI core can't restore it for us. */
 static int apcie_glue_suspend(struct apcie_dev *sc, pm_message_t state) {
+	int i;
+
+	for (i = 0; i < APCIE_MSI_SAVE_REGS; i++)
+		apcie_msi_saved[i] = glue_read32(sc, APCIE_REG_MSI(i << 2));
 	return 0;
 }
 
 static int apcie_glue_resume(struct apcie_dev *sc) {
+	int i;
+
+	/* Still enabled means the glue kept its state (suspend-to-idle) */
+	if (glue_read32(sc, APCIE_REG_MSI_CONTROL) & APCIE_REG_MSI_CONTROL_ENABLE)
+		return 0;
+
+	sc_info("restoring glue state\n");
+	glue_set_region(sc, AEOLIA_FUNC_ID_PCIE, 2, 0xbf018000, 0x7fff);
+	apcie_glue_set_regions(sc);
+	for (i = 1; i < APCIE_MSI_SAVE_REGS; i++)
+		glue_write32(sc, APCIE_REG_MSI(i << 2), apcie_msi_saved[i]);
+	glue_write32(sc, APCIE_REG_MSI_CONTROL, apcie_msi_saved[0]);
 	return 0;
 }
 #endif
@@ -408,6 +461,7 @@ int apcie_uart_init(struct apcie_dev *sc);
 int apcie_icc_init(struct apcie_dev *sc);
 void apcie_uart_remove(struct apcie_dev *sc);
 void apcie_icc_remove(struct apcie_dev *sc);
+void apcie_icc_shutdown(struct apcie_dev *sc);
 #ifdef CONFIG_PM
 void apcie_uart_suspend(struct apcie_dev *sc, pm_message_t state);
 void apcie_icc_suspend(struct apcie_dev *sc, pm_message_t state);
@@ -453,11 +507,11 @@ static int apcie_probe(struct pci_dev *dev, const struct pci_device_id *id) {
 		goto free_bars;
 	}
 
-	if ((ret = apcie_glue_init(sc)) < 0)
+	if ((ret = sc_probe_step(apcie_glue_init(sc))) < 0)
 		goto free_bars;
-	if ((ret = apcie_uart_init(sc)) < 0)
+	if ((ret = sc_probe_step(apcie_uart_init(sc))) < 0)
 		goto remove_glue;
-	if ((ret = apcie_icc_init(sc)) < 0)
+	if ((ret = sc_probe_step(apcie_icc_init(sc))) < 0)
 		goto remove_uart;
 
 	apcie_initialized = true;
@@ -498,6 +552,19 @@ static void apcie_remove(struct pci_dev *dev) {
 	pci_disable_device(dev);
 }
 
+/* On a plain reboot or power off the EMC still has to be reachable for
+ * pm_power_off and friends, so only quiesce when kexec'ing. */
+static void apcie_shutdown(struct pci_dev *dev) {
+	struct apcie_dev *sc;
+	sc = pci_get_drvdata(dev);
+
+	if (!kexec_in_progress)
+		return;
+
+	apcie_icc_shutdown(sc);
+	apcie_glue_shutdown(sc);
+}
+
 #ifdef CONFIG_PM
 static int apcie_suspend(struct pci_dev *dev, pm_message_t state) {
 	struct apcie_dev *sc;
@@ -514,12 +581,46 @@ static int apcie_resume(struct pci_dev *dev) {
 	sc = pci_get_drvdata(dev);
 
 	apcie_icc_resume(sc);
-	apcie_glue_resume(sc);
 	apcie_uart_resume(sc);
 	return 0;
 }
+
+/* Legacy ->resume_early hook; pci_pm_resume_noirq() calls it, so the glue
+ * is back before the ->resume of any of the functions whose MSIs are
+ * routed through it. */
+static int apcie_resume_early(struct pci_dev *dev) {
+	struct apcie_dev *sc;
+	sc = pci_get_drvdata(dev);
+
+	return apcie_glue_resume(sc);
+}
 #endif
 
+/* Every other function of the chip gets its IRQs (and on Aeolia its BAR
+ * windows) from the glue. A device link makes the driver core hold back
+ * their probes until the glue is bound, instead of each driver bouncing
+ * off -EPROBE_DEFER, and keeps them suspended before and resumed after it.
+ * Final fixups run once all functions of the slot have been added. */
+static void apcie_link_glue(struct pci_dev *dev)
+{
+	struct pci_dev *glue;
+
+	if (PCI_FUNC(dev->devfn) == AEOLIA_FUNC_ID_PCIE)
+		return;
+
+	glue = pci_get_slot(dev->bus, PCI_DEVFN(PCI_SLOT(dev->devfn),
+						AEOLIA_FUNC_ID_PCIE));
+	if (!glue)
+		return;
+	if (glue->vendor == PCI_VENDOR_ID_SONY &&
+	    (glue->device == PCI_DEVICE_ID_SONY_AEOLIA_PCIE ||
+	     glue->device == PCI_DEVICE_ID_SONY_BELIZE_PCIE) &&
+	    !device_link_add(&dev->dev, &glue->dev, DL_FLAG_AUTOPROBE_CONSUMER))
+		dev_warn(&dev->dev, "apcie: failed to link to glue\n");
+	pci_dev_put(glue);
+}
+DECLARE_PCI_FIXUP_FINAL(PCI_VENDOR_ID_SONY, PCI_ANY_ID, apcie_link_glue);
+
 static const struct pci_device_id apcie_pci_tbl[] = {
 	{ PCI_DEVICE(PCI_VENDOR_ID_SONY, PCI_DEVICE_ID_SONY_AEOLIA_PCIE), },
 	{ PCI_DEVICE(PCI_VENDOR_ID_SONY, PCI_DEVICE_ID_SONY_BELIZE_PCIE), },
@@ -532,9 +633,14 @@ static struct pci_driver apcie_driver = {
 	.id_table	= apcie_pci_tbl,
 	.probe		= apcie_probe,
 	.remove		= apcie_remove,
+	.shutdown	= apcie_shutdown,
 #ifdef CONFIG_PM
 	.suspend	= apcie_suspend,
+	.resume_early	= apcie_resume_early,
 	.resume		= apcie_resume,
 #endif
+	/* The other functions wait for us through their device links, and
+	 * amdgpu defers on apcie_status(), so nothing needs us synchronously */
+	.driver.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 };
 module_pci_driver(apcie_driver);
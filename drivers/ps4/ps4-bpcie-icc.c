@@ -6,280 +6,18 @@
 #include <linux/pci.h>
 #include <linux/interrupt.h>
 #include <linux/delay.h>
-#include <linux/fs.h>
-#include <linux/uaccess.h>
+#include <linux/async.h>
 #include <asm/ps4.h>
 #include "baikal.h"
 
 #define bpcie_icc_dev abpcie_icc_dev
 
-/* There should normally be only one Baikal device in a system. This allows
- * other kernel code in unrelated subsystems to issue icc requests without
- * having to get a reference to the device. */
-static struct bpcie_dev *icc_sc;
-
-DEFINE_MUTEX(bcpie_icc_mutex);
-/* The ICC message passing interface seems to be potentially designed to
- * support multiple outstanding requests at once, but the original PS4 OS never
- * does this, so we don't either. */
-
-#define REQUEST (sc->icc.spm + BPCIE_SPM_ICC_REQUEST)
-#define REPLY (sc->icc.spm + BPCIE_SPM_ICC_REPLY)
-
 int icc_i2c_init(struct bpcie_dev *sc);
 void icc_i2c_remove(struct bpcie_dev *sc);
 int icc_pwrbutton_init(struct bpcie_dev *sc);
 void icc_pwrbutton_remove(struct bpcie_dev *sc);
-void icc_pwrbutton_trigger(struct bpcie_dev *sc, int state);
-
-static u16 checksum(const void *p, int length)
-{
-	const u8 *pp = p;
-	u16 sum = 0;
-	while (length--)
-		sum += *pp++;
-	return sum;
-}
-
-static void dump_message(struct bpcie_dev *sc, int offset)
-{
-	int len;
-	struct icc_message_hdr hdr;
-	memcpy_fromio(&hdr, sc->icc.spm + offset, ICC_HDR_SIZE);
-
-	sc_err("icc: hdr: [%02x] %02x:%04x unk %x #%d len %d cksum 0x%x\n",
-	       hdr.magic, hdr.major, hdr.minor, hdr.unknown, hdr.cookie,
-	       hdr.length, hdr.checksum);
-	len = min(hdr.length - ICC_HDR_SIZE, ICC_MAX_PAYLOAD);
-	if (len > 0) {
-		sc_err("icc: data:");
-		while (len--)
-			printk(" %02x", ioread8(sc->icc.spm + (offset++) +
-			                         ICC_HDR_SIZE));
-		printk("\n");
-	}
-}
-
-static void handle_event(struct bpcie_dev *sc, struct icc_message_hdr *msg)
-{
-	switch ((msg->major << 16) | msg->minor) {
-		case 0x088010:
-			icc_pwrbutton_trigger(sc, 1);
-			break;
-		case 0x088011:
-			icc_pwrbutton_trigger(sc, 0);
-			break;
-		default:
-			sc_err("icc: event arrived, not yet supported.\n");
-			dump_message(sc, BPCIE_SPM_ICC_REPLY);
-			break;
-	}
-}
-
-static void handle_message(struct bpcie_dev *sc)
-{
-	u32 rep_empty, rep_full;
-	int off, copy_size;
-	struct icc_message_hdr msg;
-
-	rep_empty = ioread32(REPLY + BUF_EMPTY);
-	rep_full = ioread32(REPLY + BUF_FULL);
-
-	if (rep_empty != 0 || rep_full != 1) {
-		sc_err("icc: reply buffer in bad state (%d, %d)\n",
-			rep_empty, rep_full);
-		return;
-	}
-
-	memcpy_fromio(&msg, REPLY, ICC_HDR_SIZE);
-
-	if (msg.minor & ICC_EVENT) {
-		if (msg.magic != ICC_EVENT_MAGIC) {
-			sc_err("icc: event has bad magic\n");
-			dump_message(sc, BPCIE_SPM_ICC_REPLY);
-			return;
-		}
-		handle_event(sc, &msg);
-	} else if (msg.minor & ICC_REPLY) {
-		if (msg.magic != ICC_MAGIC) {
-			sc_err("icc: reply has bad magic\n");
-			dump_message(sc, BPCIE_SPM_ICC_REPLY);
-			return;
-		}
-		spin_lock(&sc->icc.reply_lock);
-		if (!sc->icc.reply_pending) {
-			spin_unlock(&sc->icc.reply_lock);
-			sc_err("icc: unexpected reply\n");
-			dump_message(sc, BPCIE_SPM_ICC_REPLY);
-			return;
-		}
-		if (msg.cookie != sc->icc.request.cookie) {
-			spin_unlock(&sc->icc.reply_lock);
-			sc_err("icc: reply has bad cookie %d\n", msg.cookie);
-			dump_message(sc, BPCIE_SPM_ICC_REPLY);
-			return;
-		}
-		if (msg.length < ICC_HDR_SIZE || msg.length > ICC_MAX_SIZE) {
-			spin_unlock(&sc->icc.reply_lock);
-			sc_err("icc: reply has bad length %d\n", msg.length);
-			dump_message(sc, BPCIE_SPM_ICC_REPLY);
-			return;
-		}
-		off = ICC_HDR_SIZE;
-		copy_size = min(sc->icc.reply_length,
-				(int)(msg.length - off));
-		memcpy_fromio(sc->icc.reply_buffer, REPLY + off, copy_size);
-		off += copy_size;
-		sc->icc.reply_extra_checksum = 0;
-		while (off < msg.length)
-			sc->icc.reply_extra_checksum += ioread8(REPLY + off++);
-		sc->icc.reply_pending = false;
-		sc->icc.reply_length = copy_size;
-		sc->icc.reply = msg;
-		spin_unlock(&sc->icc.reply_lock);
-		wake_up(&sc->icc.wq);
-		//stop_hpet_timers(sc);
-	} else {
-		sc_err("icc: unknown message arrived\n");
-		dump_message(sc, BPCIE_SPM_ICC_REPLY);
-	}
-}
-
-static irqreturn_t icc_interrupt(int irq, void *arg)
-{
-	struct bpcie_dev *sc = arg;
-	u32 status;
-	u32 ret = IRQ_NONE;
-
-	do {
-		status = ioread32(sc->bar2 + BPCIE_REG_ICC_STATUS);
-
-		if (status & BPCIE_ICC_ACK) {
-			iowrite32(BPCIE_ICC_ACK,
-				  sc->bar2 + BPCIE_REG_ICC_STATUS);
-			ret = IRQ_HANDLED;
-		}
-
-		if (status & BPCIE_ICC_SEND) {
-			iowrite32(BPCIE_ICC_SEND,
-				  sc->bar2 + BPCIE_REG_ICC_STATUS);
-			handle_message(sc);
-			iowrite32(0, REPLY + BUF_FULL);
-			iowrite32(1, REPLY + BUF_EMPTY);
-			iowrite32(BPCIE_ICC_ACK,
-				  sc->bar2 + BPCIE_REG_ICC_DOORBELL);
-			ret = IRQ_HANDLED;
-		}
-	} while (status);
-
-	return ret;
-}
-
-static int _bpcie_icc_cmd(struct bpcie_dev *sc, u8 major, u16 minor, const void *data,
-		    u16 length, void *reply, u16 reply_length, bool intr)
-{
-	int ret;
-	u32 req_empty, req_full;
-	u16 rep_checksum;
-
-	if (length > ICC_MAX_PAYLOAD)
-		return -E2BIG;
-
-	sc->icc.request.magic = ICC_MAGIC;
-	sc->icc.request.major = major;
-	sc->icc.request.minor = minor;
-	sc->icc.request.cookie++;
-	sc->icc.request.length = ICC_HDR_SIZE + length;
-	sc->icc.request.checksum = 0;
-	if (sc->icc.request.length < ICC_MIN_SIZE)
-		sc->icc.request.length = ICC_MIN_SIZE;
-
-	sc->icc.request.checksum = checksum(&sc->icc.request, ICC_HDR_SIZE);
-	sc->icc.request.checksum += checksum(data, length);
-	sc->icc.reply_buffer = reply;
-	sc->icc.reply_length = reply_length;
-
-	req_empty = ioread32(REQUEST + BUF_EMPTY);
-	req_full = ioread32(REQUEST + BUF_FULL);
-
-	if (req_empty != 1 || req_full != 0) {
-		sc_err("icc: request buffer is busy: empty=%d full=%d\n",
-		       req_empty, req_full);
-		return -EIO;
-	}
-
-	iowrite32(0, REQUEST + BUF_EMPTY);
-
-	memcpy_toio(REQUEST, &sc->icc.request, ICC_HDR_SIZE);
-	memcpy_toio(REQUEST + ICC_HDR_SIZE, data, length);
-	if (length < ICC_MIN_PAYLOAD)
-		memset_io(REQUEST + ICC_HDR_SIZE + length, 0,
-			  ICC_MIN_PAYLOAD - length);
-
-	iowrite32(1, REQUEST + BUF_FULL);
-
-	spin_lock_irq(&sc->icc.reply_lock);
-	sc->icc.reply_pending = true;
-	spin_unlock_irq(&sc->icc.reply_lock);
-
-	iowrite32(BPCIE_ICC_SEND, sc->bar2 + BPCIE_REG_ICC_DOORBELL);
-
-	if (intr)
-		ret = wait_event_interruptible_timeout(sc->icc.wq,
-				!sc->icc.reply_pending, HZ * ICC_TIMEOUT);
-	else
-		ret = wait_event_timeout(sc->icc.wq,
-				!sc->icc.reply_pending, HZ * ICC_TIMEOUT);
-
-	spin_lock_irq(&sc->icc.reply_lock);
-	sc->icc.reply_buffer = NULL;
-	if (ret < 0 || sc->icc.reply_pending) { /* interrupted or timed out */
-		sc->icc.reply_pending = false;
-		spin_unlock_irq(&sc->icc.reply_lock);
-		sc_err("icc: interrupted or timeout: ret = %d\n", ret);
-		return ret < 0 ? -EINTR : -ETIMEDOUT;
-	}
-	spin_unlock_irq(&sc->icc.reply_lock);
-
-	rep_checksum = sc->icc.reply.checksum;
-	sc->icc.reply.checksum = 0;
-	rep_checksum -= checksum(&sc->icc.reply, ICC_HDR_SIZE);
-	rep_checksum -= checksum(reply, sc->icc.reply_length);
-	rep_checksum -= sc->icc.reply_extra_checksum;
-
-	if (rep_checksum) {
-		sc_err("icc: checksum mismatch (diff: %x)\n", rep_checksum);
-		return -EIO;
-	}
-
-	if (sc->icc.reply.major != major ) {
-		sc_err("icc: major mismatch\n");
-		return -EIO;
-	}
-	if (sc->icc.reply.minor != (minor | ICC_REPLY) ) {
-		sc_err("icc: minor mismatch\n");
-		return -EIO;
-	}
-
-	return sc->icc.reply.length - ICC_HDR_SIZE;
-}
-
-int bpcie_icc_cmd(u8 major, u16 minor, const void *data, u16 length,
-		   void *reply, u16 reply_length)
-{
-	int ret;
-
-	mutex_lock(&bcpie_icc_mutex);
-	if (!icc_sc) {
-		pr_err("icc: not ready\n");
-		return -EAGAIN;
-	}
-	ret = _bpcie_icc_cmd(icc_sc, major, minor, data, length, reply, reply_length,
-		       false);
-	mutex_unlock(&bcpie_icc_mutex);
-	return ret;
-}
-EXPORT_SYMBOL_GPL(bpcie_icc_cmd);
+int icc_hwmon_init(struct bpcie_dev *sc);
+void icc_hwmon_remove(struct bpcie_dev *sc);
 
 static void bpcie_init_usb(struct bpcie_dev *sc, int usb_no) {
 	u32 value_to_write;
@@ -306,7 +44,10 @@ static void bpcie_init_usb(struct bpcie_dev *sc, int usb_no) {
 	//TODO:
 }
 
-static void resetUsbPort(void)
+/* Turned on from an async probe step; see bpcie_icc_init() */
+static async_cookie_t usb_power_cookie;
+
+static void resetUsbPort(void *data, async_cookie_t cookie)
 {
 	u8 off = 0, on = 1;
 	u8 resp[20];
@@ -376,7 +117,6 @@ static void resetBtWlan(void)
 
 static void do_icc_init(void) {
 	u8 svc = 0x10;
-	u8 reply[0x30];
 	static const u8 led_config[] = {
 		3, 1, 0, 0,
 			0x10, 1, /* Blue: on */
@@ -388,22 +128,27 @@ static void do_icc_init(void) {
 				2, 0xff, 5, 1, 0xff,
 				2, 0x00, 5, 1, 0xff,
 	};
-	int ret;
-	// test: get FW version
-	ret = bpcie_icc_cmd(2, 6, NULL, 0, reply, 0x30);
-	printk("ret=%d, reply %02x %02x %02x %02x %02x %02x %02x %02x\n", ret,
-		reply[0], reply[1], reply[2], reply[3],
-		reply[4], reply[5], reply[6], reply[7]);
-	ret = bpcie_icc_cmd(1, 0, &svc, 1, reply, 0x30);
-	printk("ret=%d, reply %02x %02x %02x %02x %02x %02x %02x %02x\n", ret,
-		reply[0], reply[1], reply[2], reply[3],
-		reply[4], reply[5], reply[6], reply[7]);
-
-	/* Set the LED to something nice */
-	ret = bpcie_icc_cmd(9, 0x20, led_config, ARRAY_SIZE(led_config), reply, 0x30);
-	printk("ret=%d, reply %02x %02x %02x %02x %02x %02x %02x %02x\n", ret,
-		reply[0], reply[1], reply[2], reply[3],
-		reply[4], reply[5], reply[6], reply[7]);
+	u8 fw_reply[0x30], svc_reply[0x30], led_reply[0x30];
+	struct icc_cmdv cmds[] = {
+		/* test: get FW version */
+		{ 2, 6, NULL, 0, fw_reply, sizeof(fw_reply) },
+		{ 1, 0, &svc, 1, svc_reply, sizeof(svc_reply) },
+		/* Set the LED to something nice */
+		{ 9, 0x20, led_config, ARRAY_SIZE(led_config),
+		  led_reply, sizeof(led_reply) },
+	};
+	int i;
+
+	/* None of these depend on each other */
+	bpcie_icc_cmdv(cmds, ARRAY_SIZE(cmds));
+	for (i = 0; i < ARRAY_SIZE(cmds); i++) {
+		u8 *reply = cmds[i].reply;
+
+		printk("ret=%d, reply %02x %02x %02x %02x %02x %02x %02x %02x\n",
+			cmds[i].ret,
+			reply[0], reply[1], reply[2], reply[3],
+			reply[4], reply[5], reply[6], reply[7]);
+	}
 }
 
 static void icc_shutdown(void)
@@ -430,58 +175,11 @@ static void icc_reboot(void)
 	WARN_ON(1);
 }
 
-static void *ioctl_tmp_buf = NULL;
-
- static long icc_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
- {
- 	int ret;
- 	void __user *uap = (void __user *)arg;
- 	switch (cmd) {
- 	case ICC_IOCTL_CMD: {
- 		struct icc_cmd cmd;
- 		int reply_len;
- 		ret = copy_from_user(&cmd, uap, sizeof(cmd));
- 		if (ret) {
- 			ret = -EFAULT;
- 			break;
- 		}
- 		ret = copy_from_user(ioctl_tmp_buf, cmd.data, cmd.length);
- 		if (ret) {
- 			ret = -EFAULT;
- 			break;
- 		}
- 		reply_len = bpcie_icc_cmd(cmd.major, cmd.minor, ioctl_tmp_buf,
- 			cmd.length, ioctl_tmp_buf, cmd.reply_length);
- 		if (reply_len < 0) {
- 			ret = reply_len;
- 			break;
- 		}
- 		ret = copy_to_user(cmd.reply, ioctl_tmp_buf, cmd.reply_length);
- 		if (ret) {
- 			ret = -EFAULT;
- 			break;
- 		}
- 		ret = reply_len;
- 		} break;
- 	default:
- 		ret = -ENOENT;
- 		break;
- 	}
- 	return ret;
- }
-
- static const struct file_operations icc_fops = {
- 	.owner = THIS_MODULE,
- 	.unlocked_ioctl = icc_ioctl,
- };
-
-
 int bpcie_icc_init(struct bpcie_dev *sc)
 {
 	int ret;
 	unsigned int mem_devfn = PCI_DEVFN(PCI_SLOT(sc->pdev->devfn), BAIKAL_FUNC_ID_MEM);
 	struct pci_dev *mem_dev;
-	u32 req_empty, req_full;
 
 	/* ICC makes use of a segment of SPM memory, available via a different
 	 * PCI function in Baikal, so we need to get a handle to it. */
@@ -503,8 +201,7 @@ int bpcie_icc_init(struct bpcie_dev *sc)
 	if (!request_mem_region(sc->icc.spm_base, BPCIE_SPM_ICC_SIZE/*pci_resource_len(mem_dev, 5)*/,
 				"spm.icc")) {
 		sc_err("icc: failed to request ICC SPM region\n");
-		ret = -EBUSY;
-		goto release_icc;
+		return -EBUSY;
 	}
 
 	sc->icc.spm = ioremap(sc->icc.spm_base, /*pci_resource_len(mem_dev, 5)*/BPCIE_SPM_ICC_SIZE);
@@ -514,82 +211,44 @@ int bpcie_icc_init(struct bpcie_dev *sc)
 		goto release_spm;
 	}
 
-	spin_lock_init(&sc->icc.reply_lock);
-	init_waitqueue_head(&sc->icc.wq);
-
-	/* Clear flags */
-	iowrite32(BPCIE_ICC_SEND | BPCIE_ICC_ACK,
-		  sc->bar2 + BPCIE_REG_ICC_STATUS);
-
-	ret = request_irq(bpcie_irqnum(sc, BPCIE_SUBFUNC_ICC),
-			  icc_interrupt, IRQF_SHARED, "icc", sc);
-	if (ret) {
-		sc_err("icc: could not request IRQ: %d\n", ret);
+	sc->icc.regs = sc->bar2 + BPCIE_RGN_ICC_BASE;
+	ret = icc_core_init(sc, bpcie_irqnum(sc, BPCIE_SUBFUNC_ICC));
+	if (ret)
 		goto iounmap;
-	}
-
-	req_empty = ioread32(REQUEST + BUF_EMPTY);
-	req_full = ioread32(REQUEST + BUF_FULL);
-
-	if (req_empty != 1 || req_full != 0) {
-		sc_err("icc: request buffer is busy: empty=%d full=%d\n",
-		       req_empty, req_full);
-		ret = -EIO;
-		goto free_irq;
-	}
-
-	mutex_lock(&bcpie_icc_mutex);
-	icc_sc = sc;
-
-	/* Enable IRQs */
-	iowrite32(BPCIE_ICC_SEND | BPCIE_ICC_ACK,
-		  sc->bar2 + BPCIE_REG_ICC_IRQ_MASK);
-	mutex_unlock(&bcpie_icc_mutex);
 
 	ret = icc_i2c_init(sc);
 	if (ret) {
 		sc_err("icc: i2c init failed: %d\n", ret);
-		goto unassign_global;
+		goto remove_core;
 	}
 	resetBtWlan();
-	resetUsbPort();
+	/* Port power only matters once a device is plugged in; xhci-aeolia
+	 * probes in parallel and sees the connect as a hotplug */
+	usb_power_cookie = async_schedule(resetUsbPort, sc);
 
 	ret = icc_pwrbutton_init(sc);
 	/* Not fatal */
 	if (ret)
 		sc_err("icc: pwrbutton init failed: %d\n", ret);
 
+	ret = icc_hwmon_init(sc);
+	/* Not fatal either */
+	if (ret)
+		sc_err("icc: hwmon init failed: %d\n", ret);
+
 	do_icc_init();
 	pm_power_off = &icc_shutdown;
 
-	ioctl_tmp_buf = kzalloc(1 << 16, GFP_KERNEL);
- 	if (!ioctl_tmp_buf) {
- 		sc_err("icc: alloc ioctl_tmp_buf failed\n");
- 		goto done;
- 	}
- 	ret = register_chrdev(ICC_MAJOR, "icc", &icc_fops);
- 	if (ret) {
- 		sc_err("icc: register_chrdev failed: %d\n", ret);
- 		goto done;
- 	}
- done:
+	icc_chrdev_init(sc);
 
 	return 0;
 
-unassign_global:
-	mutex_lock(&bcpie_icc_mutex);
-	iowrite32(0, sc->bar2 + BPCIE_REG_ICC_IRQ_MASK);
-	icc_sc = NULL;
-	mutex_unlock(&bcpie_icc_mutex);
-free_irq:
-	free_irq(bpcie_irqnum(sc, BPCIE_SUBFUNC_ICC), sc);
+remove_core:
+	icc_core_remove(sc, bpcie_irqnum(sc, BPCIE_SUBFUNC_ICC));
 iounmap:
 	iounmap(sc->icc.spm);
 release_spm:
 	release_mem_region(sc->icc.spm_base, BPCIE_SPM_ICC_SIZE);
-release_icc:
-	release_mem_region(pci_resource_start(sc->pdev, 4) +
-			   BPCIE_RGN_ICC_BASE, BPCIE_RGN_ICC_SIZE);
 	return ret;
 }
 
@@ -597,25 +256,30 @@ void bpcie_icc_remove(struct bpcie_dev *sc)
 {
 	sc_err("bpcie_icc_remove: shouldn't normally be called\n");
 	pm_power_off = NULL;
+	async_synchronize_cookie(usb_power_cookie + 1);
+	icc_hwmon_remove(sc);
 	icc_pwrbutton_remove(sc);
 	icc_i2c_remove(sc);
-	mutex_lock(&bcpie_icc_mutex);
-	iowrite32(0, sc->bar2 + BPCIE_REG_ICC_IRQ_MASK);
-	icc_sc = NULL;
-	mutex_unlock(&bcpie_icc_mutex);
-	free_irq(bpcie_irqnum(sc, BPCIE_SUBFUNC_ICC), sc);
+	icc_core_remove(sc, bpcie_irqnum(sc, BPCIE_SUBFUNC_ICC));
 	iounmap(sc->icc.spm);
 	release_mem_region(sc->icc.spm_base, BPCIE_SPM_ICC_SIZE);
-	release_mem_region(pci_resource_start(sc->pdev, 2) +
-			   BPCIE_RGN_ICC_BASE, BPCIE_RGN_ICC_SIZE);
+}
+
+void bpcie_icc_shutdown(struct bpcie_dev *sc)
+{
+	async_synchronize_cookie(usb_power_cookie + 1);
+	icc_core_shutdown(sc);
 }
 
 #ifdef CONFIG_PM
 void bpcie_icc_suspend(struct bpcie_dev *sc, pm_message_t state)
 {
+	async_synchronize_cookie(usb_power_cookie + 1);
+	icc_core_suspend(sc);
 }
 
 void bpcie_icc_resume(struct bpcie_dev *sc)
 {
+	icc_core_resume(sc);
 }
 #endif
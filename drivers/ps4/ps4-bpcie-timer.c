@@ -0,0 +1,82 @@
+/*
+ * Baikal EMC timer clocksource
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ * of the License.
+ */
+
+#include <linux/clocksource.h>
+#include <linux/delay.h>
+#include <linux/math64.h>
+
+#include <asm/ps4.h>
+
+#include "baikal.h"
+
+/* EMC timer block, relative to BAR4 */
+#define BPCIE_EMC_TIMER		(EMC_TIMER_BASE - BCPIE_BAR4_ADDR)
+#define BPCIE_EMC_TIMER_PERIOD	(EMC_TIMER_PERIOD - BCPIE_BAR4_ADDR)
+
+/* Period is in femtoseconds, like the HPET's */
+#define FSEC_PER_SEC		1000000000000000ULL
+
+static void __iomem *emc_timer;
+
+static u64 bpcie_timer_read(struct clocksource *cs)
+{
+	return ioread32(emc_timer + EMC_TIMER_VALUE);
+}
+
+static struct clocksource bpcie_clocksource = {
+	.name	= "ps4-emc",
+	.rating	= 250,
+	.read	= bpcie_timer_read,
+	.mask	= CLOCKSOURCE_MASK(32),
+	.flags	= CLOCK_SOURCE_IS_CONTINUOUS,
+};
+
+/* Frequency of the EMC timer in Hz, or 0 if it is not usable */
+u32 bpcie_timer_freq;
+
+int bpcie_timer_init(struct bpcie_dev *sc)
+{
+	u32 period, t0;
+	u64 freq;
+	int ret;
+
+	emc_timer = sc->bar4 + BPCIE_EMC_TIMER;
+
+	period = ioread32(sc->bar4 + BPCIE_EMC_TIMER_PERIOD);
+	if (!period) {
+		sc_err("emc timer: period not set\n");
+		return -ENODEV;
+	}
+	freq = div_u64((period >> 1) + FSEC_PER_SEC, period);
+
+	/* The EMC starts timer 0 itself; don't register a stopped one */
+	t0 = ioread32(emc_timer + EMC_TIMER_VALUE);
+	udelay(10);
+	if (ioread32(emc_timer + EMC_TIMER_VALUE) == t0) {
+		sc_err("emc timer: not running\n");
+		return -ENODEV;
+	}
+
+	ret = clocksource_register_hz(&bpcie_clocksource, freq);
+	if (ret) {
+		sc_err("emc timer: clocksource registration failed: %d\n", ret);
+		return ret;
+	}
+
+	sc_info("emc timer: %llu Hz\n", freq);
+	bpcie_timer_freq = freq;
+	return 0;
+}
+
+void bpcie_timer_remove(struct bpcie_dev *sc)
+{
+	if (bpcie_timer_freq)
+		clocksource_unregister(&bpcie_clocksource);
+	bpcie_timer_freq = 0;
+}
@@ -8,6 +8,10 @@
 #include <linux/irqchip.h>
 #include <linux/irqdomain.h>
 #include <linux/msi.h>
+#include <linux/debugfs.h>
+#include <linux/sched/clock.h>
+#include <linux/kexec.h>
+#include <linux/sched/isolation.h>
 #include <asm/irqdomain.h>
 #include <asm/irq_remapping.h>
 
@@ -31,6 +35,99 @@ static const int subfuncs_per_func[BAIKAL_NUM_FUNCS] = {
 
 static void bpcie_msi_domain_set_desc(msi_alloc_info_t *arg, struct msi_desc *desc);
 
+/* Subfunction IRQ descriptors per function, filled in by bpcie_msi_init so
+ * that the demux in bpcie_handle_edge_irq doesn't have to look them up. */
+static struct irq_desc *bpcie_demux_desc[BAIKAL_NUM_FUNCS][32];
+
+/* BPCIE_ACK_WRITE selects the vector that BPCIE_ACK_READ returns. There is
+ * only one such register pair for all functions, so the chained handlers of
+ * different functions must not interleave their write/read sequences. */
+static DEFINE_RAW_SPINLOCK(bpcie_ack_lock);
+
+#ifdef CONFIG_DEBUG_FS
+/* Cost of the chained handler per demuxed function, kept per CPU so that
+ * the IRQ path doesn't bounce a shared cache line. local_clock() is a TSC
+ * read here. The demux overhead proper is total_ns - handler_ns. */
+struct bpcie_demux_stats {
+	u64 count;		/* chained interrupts */
+	u64 empty;		/* ... with no subfunction pending */
+	u64 ack_ns;		/* ack register round trip */
+	u64 handler_ns;		/* subfunction handlers */
+	u64 total_ns;		/* whole chained handler */
+};
+
+static DEFINE_PER_CPU(struct bpcie_demux_stats[BAIKAL_NUM_FUNCS],
+		      bpcie_demux_stats);
+static struct dentry *bpcie_debugfs;
+
+static inline u64 bpcie_stats_clock(void)
+{
+	return local_clock();
+}
+
+static void bpcie_stats_account(u32 func, bool empty, u64 t0, u64 t_ack,
+				u64 handler_ns)
+{
+	struct bpcie_demux_stats *st = this_cpu_ptr(&bpcie_demux_stats[func]);
+
+	st->count++;
+	st->empty += empty;
+	st->ack_ns += t_ack - t0;
+	st->handler_ns += handler_ns;
+	st->total_ns += bpcie_stats_clock() - t0;
+}
+
+static int bpcie_demux_show(struct seq_file *m, void *unused)
+{
+	struct bpcie_demux_stats sum;
+	int func, cpu;
+
+	seq_puts(m, "func count empty ack_ns handler_ns total_ns\n");
+	for (func = 0; func < BAIKAL_NUM_FUNCS; func++) {
+		memset(&sum, 0, sizeof(sum));
+		for_each_possible_cpu(cpu) {
+			struct bpcie_demux_stats *st =
+				&per_cpu(bpcie_demux_stats, cpu)[func];
+
+			sum.count += READ_ONCE(st->count);
+			sum.empty += READ_ONCE(st->empty);
+			sum.ack_ns += READ_ONCE(st->ack_ns);
+			sum.handler_ns += READ_ONCE(st->handler_ns);
+			sum.total_ns += READ_ONCE(st->total_ns);
+		}
+		if (!sum.count)
+			continue;
+		seq_printf(m, "%d %llu %llu %llu %llu %llu\n", func, sum.count,
+			   sum.empty, sum.ack_ns, sum.handler_ns, sum.total_ns);
+	}
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(bpcie_demux);
+
+static void bpcie_debugfs_init(void)
+{
+	bpcie_debugfs = debugfs_create_dir("ps4-bpcie", NULL);
+	debugfs_create_file("demux", 0444, bpcie_debugfs, NULL,
+			    &bpcie_demux_fops);
+}
+
+static void bpcie_debugfs_remove(void)
+{
+	debugfs_remove_recursive(bpcie_debugfs);
+	bpcie_debugfs = NULL;
+}
+#else
+static inline u64 bpcie_stats_clock(void)
+{
+	return 0;
+}
+
+static inline void bpcie_stats_account(u32 func, bool empty, u64 t0,
+				       u64 t_ack, u64 handler_ns) {}
+static inline void bpcie_debugfs_init(void) {}
+static inline void bpcie_debugfs_remove(void) {}
+#endif
+
 /*static inline */u32 glue_read32(struct bpcie_dev *sc, u32 offset) {
 	return ioread32(sc->bar2 + offset);
 }
@@ -212,7 +309,6 @@ static void bpcie_handle_edge_irq(struct irq_desc *desc)
 {
 	//return handle_edge_irq(desc);
 	u32 func = (desc->irq_data.hwirq >> 5) & 7;
-	u32 initial_hwirq = desc->irq_data.hwirq & ~0x1fLL;
 	//sc_dbg("bpcie_handle_edge_irq(hwirq=0x%X, irq=0x%X)\n", vector, desc->irq_data.irq);
 	unsigned int vector_to_write;
 	unsigned int mask;
@@ -240,26 +336,31 @@ static void bpcie_handle_edge_irq(struct irq_desc *desc)
 		return;
 	}
 
-	raw_spin_lock(&desc->lock); //TODO: try it
+	u64 t0 = bpcie_stats_clock(), t_ack, handler_ns = 0;
+
+	/* One ack read covers every subfunction of this function that fired */
+	raw_spin_lock(&bpcie_ack_lock);
 	struct bpcie_dev *sc = desc->irq_data.chip_data;
 	glue_write32(sc, BPCIE_ACK_WRITE, vector_to_write);
 	u32 vector_read = glue_read32(sc, BPCIE_ACK_READ);
-	raw_spin_unlock(&desc->lock);
+	raw_spin_unlock(&bpcie_ack_lock);
+	t_ack = bpcie_stats_clock();
 
-	unsigned int subfunc_mask = mask & ~(vector_read >> shift);
+	unsigned long subfunc_mask = mask & ~(vector_read >> shift);
 	//sc_dbg("subfunc_mask=0x%X, vector_read=0x%X\n", subfunc_mask, vector_read);
 	unsigned int i;
-	for (i = 0; i < 32; i++) {
-		if (subfunc_mask & (1 << i)) { //if (test_bit(vector, used_vectors))
-			unsigned int virq = irq_find_mapping(desc->irq_data.domain,
-					initial_hwirq + i);
-			struct irq_desc *new_desc = irq_to_desc(virq);
-			if (new_desc) {
-				//dev_dbg(new_desc->irq_common_data.msi_desc->dev, "handle_edge_irq_int(new hwirq=0x%X, irq=0x%X)\n", new_desc->irq_data.hwirq, new_desc->irq_data.irq);
-				handle_edge_irq(new_desc);
-			}
+	for_each_set_bit(i, &subfunc_mask, 32) {
+		struct irq_desc *new_desc = READ_ONCE(bpcie_demux_desc[func][i]);
+		if (new_desc) {
+			u64 t = bpcie_stats_clock();
+
+			//dev_dbg(new_desc->irq_common_data.msi_desc->dev, "handle_edge_irq_int(new hwirq=0x%X, irq=0x%X)\n", new_desc->irq_data.hwirq, new_desc->irq_data.irq);
+			handle_edge_irq(new_desc);
+			handler_ns += bpcie_stats_clock() - t;
 		}
 	}
+
+	bpcie_stats_account(func, !subfunc_mask, t0, t_ack, handler_ns);
 }
 
 static int bpcie_msi_init(struct irq_domain *domain,
@@ -273,13 +374,20 @@ static int bpcie_msi_init(struct irq_domain *domain,
 	irq_domain_set_info(domain, virq, hwirq, info->chip, info->chip_data,
 			bpcie_handle_edge_irq/*handle_edge_irq*/, NULL, "edge");
 	//bpcie_msi_calc_mask(data);
+	WRITE_ONCE(bpcie_demux_desc[(hwirq >> 5) & 7][get_subfunc(hwirq)],
+		   irq_to_desc(virq));
 	return 0;
 }
 
 static void bpcie_msi_free(struct irq_domain *domain,
 			  struct msi_domain_info *info, unsigned int virq)
 {
+	struct irq_data *data = irq_domain_get_irq_data(domain, virq);
+
 	pr_devel("bpcie_msi_free(%d)\n", virq);
+	if (data)
+		WRITE_ONCE(bpcie_demux_desc[(data->hwirq >> 5) & 7]
+					   [get_subfunc(data->hwirq)], NULL);
 }
 
 static int bpcie_msi_prepare(struct irq_domain *domain, struct device *dev,
@@ -402,8 +510,15 @@ int bpcie_assign_irqs(struct pci_dev *dev, int nvec)
 		//info.msi_hwirq |= 0xff; // Shared IRQ for all subfunctions
 	}
 #endif
+	/*
+	 * Multiple vectors are spread over the CPUs as managed IRQs, except
+	 * with nohz_full, where they keep the (housekeeping) default affinity
+	 */
 	if (dev->msi_enabled)
 		ret = nvec;
+	else if (nvec > 1 && !housekeeping_enabled(HK_FLAG_TICK))
+		ret = pci_alloc_irq_vectors(dev, 1, nvec,
+					    PCI_IRQ_MSI | PCI_IRQ_AFFINITY);
 	else
 		ret = pci_alloc_irq_vectors(dev, 1, nvec, PCI_IRQ_MSI);
 
@@ -489,13 +604,16 @@ static int bpcie_glue_init(struct bpcie_dev *sc)
 		return -EIO;
 	}
 	sc_dbg("dev->irq=%d\n", sc->pdev->irq);
-	
+
+	bpcie_debugfs_init();
 	return 0;
 }
 
 static void bpcie_glue_remove(struct bpcie_dev *sc) {
 	sc_info("bpcie glue remove\n");
 
+	bpcie_debugfs_remove();
+
 	if (sc->nvec > 0) {
 		bpcie_free_irqs(sc->pdev->irq, sc->nvec);
 		sc->nvec = 0;
@@ -511,8 +629,14 @@ static void bpcie_glue_remove(struct bpcie_dev *sc) {
 }
 
 #ifdef CONFIG_PM
+/* Unlike Aeolia, Baikal keeps the MSI address/data and the subfunction
+ * mask in the standard MSI capability of each function, so the config
+ * space snapshot is all the glue state there is. The PCI core restores it
+ * in the noirq phase, before any of the ->resume callbacks that need the
+ * vectors (ICC first of all). The function is left in D0: the EMC side of
+ * the chip has to stay reachable for wakeup events. */
 static int bpcie_glue_suspend(struct bpcie_dev *sc, pm_message_t state) {
-	return 0;
+	return pci_save_state(sc->pdev);
 }
 
 static int bpcie_glue_resume(struct bpcie_dev *sc) {
@@ -523,8 +647,11 @@ static int bpcie_glue_resume(struct bpcie_dev *sc) {
 
 int bpcie_uart_init(struct bpcie_dev *sc);
 int bpcie_icc_init(struct bpcie_dev *sc);
+int bpcie_timer_init(struct bpcie_dev *sc);
 void bpcie_uart_remove(struct bpcie_dev *sc);
 void bpcie_icc_remove(struct bpcie_dev *sc);
+void bpcie_timer_remove(struct bpcie_dev *sc);
+void bpcie_icc_shutdown(struct bpcie_dev *sc);
 #ifdef CONFIG_PM
 void bpcie_uart_suspend(struct bpcie_dev *sc, pm_message_t state);
 void bpcie_icc_suspend(struct bpcie_dev *sc, pm_message_t state);
@@ -570,11 +697,13 @@ static int bpcie_probe(struct pci_dev *dev, const struct pci_device_id *id) {
 		goto free_bars;
 	}
 
-	if ((ret = bpcie_glue_init(sc)) < 0)
+	if ((ret = sc_probe_step(bpcie_glue_init(sc))) < 0)
 		goto free_bars;
-	if ((ret = bpcie_uart_init(sc)) < 0)
+	// not fatal, there are other clocksources
+	sc_probe_step(bpcie_timer_init(sc));
+	if ((ret = sc_probe_step(bpcie_uart_init(sc))) < 0)
 		goto remove_glue;
-	if ((ret = bpcie_icc_init(sc)) < 0)
+	if ((ret = sc_probe_step(bpcie_icc_init(sc))) < 0)
 		goto remove_uart;
 
 	bpcie_initialized = true;
@@ -583,6 +712,7 @@ static int bpcie_probe(struct pci_dev *dev, const struct pci_device_id *id) {
 remove_uart:
 	bpcie_uart_remove(sc);
 remove_glue:
+	bpcie_timer_remove(sc);
 	bpcie_glue_remove(sc);
 free_bars:
 	if (sc->bar0)
@@ -603,6 +733,7 @@ static void bpcie_remove(struct pci_dev *dev) {
 
 	bpcie_icc_remove(sc);
 	bpcie_uart_remove(sc);
+	bpcie_timer_remove(sc);
 	bpcie_glue_remove(sc);
 
 	if (sc->bar0)
@@ -615,6 +746,19 @@ static void bpcie_remove(struct pci_dev *dev) {
 	pci_disable_device(dev);
 }
 
+/* See apcie_shutdown(). The MSI routing lives in the config space of each
+ * function, and the PCI core already clears bus mastering on all of them
+ * for a kexec, so only ICC needs quiescing here. */
+static void bpcie_shutdown(struct pci_dev *dev) {
+	struct bpcie_dev *sc;
+	sc = pci_get_drvdata(dev);
+
+	if (!kexec_in_progress)
+		return;
+
+	bpcie_icc_shutdown(sc);
+}
+
 #ifdef CONFIG_PM
 static int bpcie_suspend(struct pci_dev *dev, pm_message_t state) {
 	struct bpcie_dev *sc;
@@ -630,13 +774,33 @@ static int bpcie_resume(struct pci_dev *dev) {
 	struct bpcie_dev *sc;
 	sc = pci_get_drvdata(dev);
 
-	bpcie_icc_resume(sc);
 	bpcie_glue_resume(sc);
+	bpcie_icc_resume(sc);
 	bpcie_uart_resume(sc);
 	return 0;
 }
 #endif
 
+/* See apcie_link_glue(); on Baikal it is the MSI domains that the other
+ * functions can't probe without. */
+static void bpcie_link_glue(struct pci_dev *dev)
+{
+	struct pci_dev *glue;
+
+	if (PCI_FUNC(dev->devfn) == BAIKAL_FUNC_ID_PCIE)
+		return;
+
+	glue = pci_get_slot(dev->bus, PCI_DEVFN(PCI_SLOT(dev->devfn),
+						BAIKAL_FUNC_ID_PCIE));
+	if (!glue)
+		return;
+	if (bpcie_is_compatible_device(glue) &&
+	    !device_link_add(&dev->dev, &glue->dev, DL_FLAG_AUTOPROBE_CONSUMER))
+		dev_warn(&dev->dev, "bpcie: failed to link to glue\n");
+	pci_dev_put(glue);
+}
+DECLARE_PCI_FIXUP_FINAL(PCI_VENDOR_ID_SONY, PCI_ANY_ID, bpcie_link_glue);
+
 static const struct pci_device_id bpcie_pci_tbl[] = {
 	{ PCI_DEVICE(PCI_VENDOR_ID_SONY, PCI_DEVICE_ID_SONY_BAIKAL_PCIE), },
 	{ }
@@ -648,9 +812,13 @@ static struct pci_driver bpcie_driver = {
 	.id_table	= bpcie_pci_tbl,
 	.probe		= bpcie_probe,
 	.remove		= bpcie_remove,
+	.shutdown	= bpcie_shutdown,
 #ifdef CONFIG_PM
 	.suspend	= bpcie_suspend,
 	.resume		= bpcie_resume,
 #endif
+	/* The other functions wait for us through their device links, and
+	 * amdgpu defers on bpcie_status(), so nothing needs us synchronously */
+	.driver.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 };
 module_pci_driver(bpcie_driver);
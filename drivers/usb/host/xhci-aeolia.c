@@ -25,6 +25,8 @@ static const char hcd_name[] = "xhci_aeolia";
 static struct hc_driver __read_mostly xhci_aeolia_hc_driver;
 
 #define NR_DEVICES 3
+/* On Belize and Baikal the SATA controller takes the place of xHCI 1 */
+#define AHCI_INDEX 1
 
 struct aeolia_xhci {
 	struct ata_host *host;
@@ -32,6 +34,24 @@ struct aeolia_xhci {
 	struct usb_hcd *hcd[NR_DEVICES];
 };
 
+/*
+ * Only interrupter 0 is used: which MSI vector the glue raises for the
+ * other interrupters of a controller is not known, so a secondary event
+ * ring could signal a vector that belongs to another function.
+ */
+static unsigned int imod_interval = 40000;
+module_param(imod_interval, uint, 0444);
+MODULE_PARM_DESC(imod_interval, "Interrupt moderation of the event ring in ns (default 40000)");
+
+/*
+ * Bulk streams let UAS keep several commands in flight instead of falling
+ * back to Bulk-Only Transport.  Left as a switch in case a controller
+ * revision turns out to mishandle stream context arrays.
+ */
+static bool streams = true;
+module_param(streams, bool, 0444);
+MODULE_PARM_DESC(streams, "Offer USB 3 bulk streams to UAS devices (default true)");
+
 static int xhci_aeolia_setup(struct usb_hcd *hcd);
 
 static const struct xhci_driver_overrides xhci_aeolia_overrides __initconst = {
@@ -46,11 +66,19 @@ static void xhci_aeolia_quirks(struct device *dev, struct xhci_hcd *xhci)
 	 * Do not touch DMA mask, we need a custom one
 	 */
 	xhci->quirks |= XHCI_PLAT | XHCI_PLAT_DMA;
+
+	if (!streams)
+		xhci->quirks |= XHCI_BROKEN_STREAMS;
 }
 
 /* called during probe() after chip reset completes */
 static int xhci_aeolia_setup(struct usb_hcd *hcd)
 {
+	struct xhci_hcd *xhci = hcd_to_xhci(hcd);
+
+	/* imod_interval is the interrupt moderation value in nanoseconds. */
+	xhci->imod_interval = imod_interval;
+
 	return xhci_gen_setup(hcd, xhci_aeolia_quirks);
 }
 
@@ -61,7 +89,9 @@ static int xhci_aeolia_probe_one(struct pci_dev *dev, int index)
 	struct hc_driver *driver = &xhci_aeolia_hc_driver;
 	struct usb_hcd *hcd;
 	struct xhci_hcd *xhci;
-	int irq = (axhci->nr_irqs > 1) ? (dev->irq + index) : dev->irq;
+	/* One vector per controller; pci_irq_vector() rather than dev->irq +
+	 * index, the virqs of a managed allocation need not be consecutive. */
+	int irq = pci_irq_vector(dev, (axhci->nr_irqs > 1) ? index : 0);
 
 	// ok...adding this printk appears to have introduced a delay that fixed
 	// bringup of the middle host controller, so w/e for now...
@@ -103,6 +133,15 @@ static int xhci_aeolia_probe_one(struct pci_dev *dev, int index)
 	if (retval)
 		goto put_usb3_hcd;
 
+	/*
+	 * Without this uas refuses the device and usb-storage binds in BOT.
+	 * Set before the USB3 roothub is registered, or a disk present at
+	 * boot is enumerated without it.
+	 */
+	if (!(xhci->quirks & XHCI_BROKEN_STREAMS) &&
+	    HCC_MAX_PSA(xhci->hcc_params) >= 4)
+		xhci->shared_hcd->can_do_streams = 1;
+
 	retval = usb_add_hcd(xhci->shared_hcd, irq, IRQF_SHARED);
 	if (retval)
 		goto dealloc_usb2_hcd;
@@ -250,6 +289,12 @@ static int ahci_init_one(struct pci_dev *pdev)
 		 * encountered.
 		 */
 		pi.flags |= ATA_FLAG_FPDMA_AUX;
+
+		if (((hpriv->cap >> 8) & 0x1f) + 1 < AHCI_MAX_CMDS)
+			dev_warn(&pdev->dev, "only %u command slots, NCQ depth limited\n",
+				 ((hpriv->cap >> 8) & 0x1f) + 1);
+	} else {
+		dev_warn(&pdev->dev, "controller does not advertise NCQ\n");
 	}
 
 	if (hpriv->cap & HOST_CAP_PMP)
@@ -274,7 +319,8 @@ static int ahci_init_one(struct pci_dev *pdev)
 
 	host->private_data = hpriv;
 
-	hpriv->irq = pci_irq_vector(pdev, 1);
+	/* The SATA function has a vector of its own, like the controllers */
+	hpriv->irq = pci_irq_vector(pdev, (axhci->nr_irqs > 1) ? AHCI_INDEX : 0);
 
 	if (!(hpriv->cap & HOST_CAP_SSS) || ahci_ignore_sss)
 		host->flags |= ATA_HOST_PARALLEL_SCAN;
@@ -373,8 +419,10 @@ static int xhci_aeolia_probe(struct pci_dev *dev, const struct pci_device_id *id
 	}
 	pci_set_drvdata(dev, axhci);
 
+	/* Spread the controllers (and SATA on Belize/Baikal) over the CPUs so
+	 * that their event rings can be processed in parallel */
 	axhci->nr_irqs = retval = pci_alloc_irq_vectors(dev, NR_DEVICES, INT_MAX,
-			PCI_IRQ_MSIX | PCI_IRQ_MSI);//apcie_assign_irqs(dev, NR_DEVICES);
+			PCI_IRQ_MSIX | PCI_IRQ_MSI | PCI_IRQ_AFFINITY);//apcie_assign_irqs(dev, NR_DEVICES);
 	if (retval < 0) {
 		goto free_axhci;
 	}
@@ -384,8 +432,11 @@ static int xhci_aeolia_probe(struct pci_dev *dev, const struct pci_device_id *id
 		return -ENODEV;
 	}
 
-	retval = ahci_init_one(dev);
-	dev_dbg(&dev->dev, "ahci_init_one returned %d", retval);
+	/* On Aeolia, BAR 2 belongs to xHCI 1 and SATA is a function of its own */
+	if (dev->device != PCI_DEVICE_ID_SONY_AEOLIA_XHCI) {
+		retval = ahci_init_one(dev);
+		dev_dbg(&dev->dev, "ahci_init_one returned %d", retval);
+	}
 
 	if (!bus_master) {
 		pci_set_master(dev);
@@ -393,7 +444,7 @@ static int xhci_aeolia_probe(struct pci_dev *dev, const struct pci_device_id *id
 	}
 
 	for (idx = 0; idx < NR_DEVICES; idx++) {
- 		if(dev->device != PCI_DEVICE_ID_SONY_AEOLIA_XHCI && idx == 1) {//this is for Belize and Baikal
+ 		if(dev->device != PCI_DEVICE_ID_SONY_AEOLIA_XHCI && idx == AHCI_INDEX) {//this is for Belize and Baikal
  			continue;
  		}
 		retval = xhci_aeolia_probe_one(dev, idx);
@@ -538,11 +589,13 @@ static struct pci_driver xhci_aeolia_driver = {
 	.shutdown = 	usb_hcd_platform_shutdown, */
 	.shutdown = 	usb_hcd_pci_shutdown,
 	.shutdown = 	xhci_hcd_pci_shutdown,
-#ifdef CONFIG_PM_SLEEP
 	.driver = {
-		.pm = &xhci_aeolia_pm_ops
-	},
+		/* Nothing else waits for the three root hubs to come up */
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
+#ifdef CONFIG_PM_SLEEP
+		.pm = &xhci_aeolia_pm_ops,
 #endif
+	},
 };
 
 static int __init xhci_aeolia_init(void)
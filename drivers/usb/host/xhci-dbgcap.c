@@ -870,6 +870,28 @@ static int xhci_do_dbc_init(struct xhci_hcd *xhci)
 	return 0;
 }
 
+/*
+ * ttyDBC is a single tty driver, so only one host controller in the system
+ * can own the debug capability. Owning it by controller also keeps the dbc
+ * attribute usable where several xHCIs share a PCI function and its drvdata
+ * isn't a usb_hcd, as on the PS4 southbridges.
+ */
+static DEFINE_MUTEX(dbc_owner_mutex);
+static struct xhci_hcd *dbc_owner;
+
+static struct xhci_hcd *dbc_owner_of(struct device *dev)
+{
+	struct xhci_hcd		*xhci;
+
+	mutex_lock(&dbc_owner_mutex);
+	xhci = dbc_owner;
+	if (xhci && xhci_to_hcd(xhci)->self.controller != dev)
+		xhci = NULL;
+	mutex_unlock(&dbc_owner_mutex);
+
+	return xhci;
+}
+
 static ssize_t dbc_show(struct device *dev,
 			struct device_attribute *attr,
 			char *buf)
@@ -878,7 +900,9 @@ static ssize_t dbc_show(struct device *dev,
 	struct xhci_dbc		*dbc;
 	struct xhci_hcd		*xhci;
 
-	xhci = hcd_to_xhci(dev_get_drvdata(dev));
+	xhci = dbc_owner_of(dev);
+	if (!xhci)
+		return -ENODEV;
 	dbc = xhci->dbc;
 
 	switch (dbc->state) {
@@ -913,7 +937,9 @@ static ssize_t dbc_store(struct device *dev,
 {
 	struct xhci_hcd		*xhci;
 
-	xhci = hcd_to_xhci(dev_get_drvdata(dev));
+	xhci = dbc_owner_of(dev);
+	if (!xhci)
+		return -ENODEV;
 
 	if (!strncmp(buf, "enable", 6))
 		xhci_dbc_start(xhci);
@@ -932,6 +958,12 @@ int xhci_dbc_init(struct xhci_hcd *xhci)
 	int			ret;
 	struct device		*dev = xhci_to_hcd(xhci)->self.controller;
 
+	mutex_lock(&dbc_owner_mutex);
+	if (dbc_owner) {
+		mutex_unlock(&dbc_owner_mutex);
+		return -EBUSY;
+	}
+
 	ret = xhci_do_dbc_init(xhci);
 	if (ret)
 		goto init_err3;
@@ -940,6 +972,9 @@ int xhci_dbc_init(struct xhci_hcd *xhci)
 	if (ret)
 		goto init_err2;
 
+	dbc_owner = xhci;
+	mutex_unlock(&dbc_owner_mutex);
+
 	ret = device_create_file(dev, &dev_attr_dbc);
 	if (ret)
 		goto init_err1;
@@ -947,10 +982,13 @@ int xhci_dbc_init(struct xhci_hcd *xhci)
 	return 0;
 
 init_err1:
+	mutex_lock(&dbc_owner_mutex);
+	dbc_owner = NULL;
 	xhci_dbc_tty_unregister_driver();
 init_err2:
 	xhci_do_dbc_exit(xhci);
 init_err3:
+	mutex_unlock(&dbc_owner_mutex);
 	return ret;
 }
 
@@ -964,7 +1002,11 @@ void xhci_dbc_exit(struct xhci_hcd *xhci)
 	device_remove_file(dev, &dev_attr_dbc);
 	xhci_dbc_tty_unregister_driver();
 	xhci_dbc_stop(xhci);
+
+	mutex_lock(&dbc_owner_mutex);
+	dbc_owner = NULL;
 	xhci_do_dbc_exit(xhci);
+	mutex_unlock(&dbc_owner_mutex);
 }
 
 #ifdef CONFIG_PM
@@ -110,6 +110,7 @@ struct dbc_ep {
 
 #define DBC_QUEUE_SIZE			16
 #define DBC_WRITE_BUF_SIZE		8192
+#define DBC_CONSOLE_BUF_SIZE		65536
 
 /*
  * Private structure for DbC hardware state:
@@ -126,6 +127,10 @@ struct dbc_port {
 	struct list_head		write_pool;
 	struct kfifo			write_fifo;
 
+	/* console output, filled without port_lock and drained first */
+	struct kfifo			console_fifo;
+	struct irq_work			console_kick;
+
 	bool				registered;
 	struct dbc_ep			*in;
 	struct dbc_ep			*out;
@@ -7,6 +7,8 @@
  * Author: Lu Baolu <baolu.lu@linux.intel.com>
  */
 
+#include <linux/console.h>
+#include <linux/irq_work.h>
 #include <linux/slab.h>
 #include <linux/tty.h>
 #include <linux/tty_flip.h>
@@ -19,6 +21,10 @@ dbc_send_packet(struct dbc_port *port, char *packet, unsigned int size)
 {
 	unsigned int		len;
 
+	len = kfifo_out(&port->console_fifo, packet, size);
+	if (len)
+		return len;
+
 	len = kfifo_len(&port->write_fifo);
 	if (len < size)
 		size = len;
@@ -108,21 +114,18 @@ static void dbc_write_complete(struct xhci_hcd *xhci, struct dbc_request *req)
 	unsigned long		flags;
 	struct xhci_dbc		*dbc = xhci->dbc;
 	struct dbc_port		*port = &dbc->port;
+	int			status = req->status;
 
 	spin_lock_irqsave(&port->port_lock, flags);
 	list_add(&req->list_pool, &port->write_pool);
-	switch (req->status) {
-	case 0:
+	if (!status)
 		dbc_start_tx(port);
-		break;
-	case -ESHUTDOWN:
-		break;
-	default:
-		xhci_warn(xhci, "unexpected write complete status %d\n",
-			  req->status);
-		break;
-	}
 	spin_unlock_irqrestore(&port->port_lock, flags);
+
+	/* Not under port_lock, this may end up in our own console */
+	if (status && status != -ESHUTDOWN)
+		xhci_warn(xhci, "unexpected write complete status %d\n",
+			  status);
 }
 
 static void xhci_dbc_free_req(struct dbc_ep *dep, struct dbc_request *req)
@@ -328,6 +331,49 @@ void xhci_dbc_tty_unregister_driver(void)
 	}
 }
 
+/*
+ * Kernel messages over the DbC, with console=ttyDBC0. The DbC code prints
+ * with dbc->lock and port_lock held, so the console only fills a fifo of
+ * its own, lock free since console writes are serialized, and leaves
+ * starting the transfer to an irq_work.
+ */
+static struct dbc_port *dbc_console_port;
+
+static void dbc_console_write(struct console *co, const char *s,
+			      unsigned int count)
+{
+	struct dbc_port		*port = dbc_console_port;
+
+	kfifo_in(&port->console_fifo, s, count);
+	irq_work_queue(&port->console_kick);
+}
+
+static struct tty_driver *dbc_console_device(struct console *co, int *index)
+{
+	*index = 0;
+	return dbc_tty_driver;
+}
+
+static struct console dbc_console = {
+	.name		= "ttyDBC",
+	.write		= dbc_console_write,
+	.device		= dbc_console_device,
+	.flags		= CON_PRINTBUFFER,
+	.index		= -1,
+};
+
+static void dbc_console_kick(struct irq_work *work)
+{
+	struct dbc_port		*port;
+	unsigned long		flags;
+
+	port = container_of(work, struct dbc_port, console_kick);
+
+	spin_lock_irqsave(&port->port_lock, flags);
+	dbc_start_tx(port);
+	spin_unlock_irqrestore(&port->port_lock, flags);
+}
+
 static void dbc_rx_push(unsigned long _port)
 {
 	struct dbc_request	*req;
@@ -459,6 +505,11 @@ int xhci_dbc_tty_register_device(struct xhci_hcd *xhci)
 	if (ret)
 		goto buf_alloc_fail;
 
+	ret = kfifo_alloc(&port->console_fifo, DBC_CONSOLE_BUF_SIZE,
+			  GFP_KERNEL);
+	if (ret)
+		goto console_alloc_fail;
+
 	ret = xhci_dbc_alloc_requests(port->in, &port->read_pool,
 				      dbc_read_complete);
 	if (ret)
@@ -471,11 +522,18 @@ int xhci_dbc_tty_register_device(struct xhci_hcd *xhci)
 
 	port->registered = true;
 
+	/* Replays the log, which is most of the point on a fresh connect */
+	init_irq_work(&port->console_kick, dbc_console_kick);
+	dbc_console_port = port;
+	register_console(&dbc_console);
+
 	return 0;
 
 request_fail:
 	xhci_dbc_free_requests(port->in, &port->read_pool);
 	xhci_dbc_free_requests(port->out, &port->write_pool);
+	kfifo_free(&port->console_fifo);
+console_alloc_fail:
 	kfifo_free(&port->write_fifo);
 
 buf_alloc_fail:
@@ -494,10 +552,15 @@ void xhci_dbc_tty_unregister_device(struct xhci_hcd *xhci)
 	struct xhci_dbc		*dbc = xhci->dbc;
 	struct dbc_port		*port = &dbc->port;
 
+	/* Waits for any console write in progress */
+	unregister_console(&dbc_console);
+	irq_work_sync(&port->console_kick);
+
 	tty_unregister_device(dbc_tty_driver, 0);
 	xhci_dbc_tty_exit_port(port);
 	port->registered = false;
 
+	kfifo_free(&port->console_fifo);
 	kfifo_free(&port->write_fifo);
 	xhci_dbc_free_requests(get_out_ep(xhci), &port->read_pool);
 	xhci_dbc_free_requests(get_out_ep(xhci), &port->read_queue);
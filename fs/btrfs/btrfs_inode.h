@@ -176,6 +176,15 @@ struct btrfs_inode {
 	 */
 	unsigned defrag_compress;
 
+	/*
+	 * Compression attempts that recently failed to save space, and how
+	 * many more ranges to write uncompressed before trying again. See
+	 * inode_compress_backoff().
+	 */
+	unsigned int compress_misses;
+	unsigned int compress_skip;
+	unsigned long compress_miss_time;
+
 	struct btrfs_delayed_node *delayed_node;
 
 	/* File creation time. */
@@ -107,6 +107,14 @@ enum btrfs_compression_type {
 	BTRFS_COMPRESS_TYPES = 3,
 };
 
+/* Per-extent outcomes reported by trace_btrfs_compress_decision() */
+enum btrfs_compress_decision {
+	BTRFS_COMPRESS_SKIP,	/* backing off after recent misses */
+	BTRFS_COMPRESS_REJECT,	/* heuristic found the data incompressible */
+	BTRFS_COMPRESS_MISS,	/* compressed, but nothing was saved */
+	BTRFS_COMPRESS_HIT,	/* compressed extent queued for write */
+};
+
 struct workspace_manager {
 	const struct btrfs_compress_op *ops;
 	struct list_head idle_ws;
@@ -733,6 +733,8 @@ struct btrfs_fs_info {
 	struct task_struct *transaction_kthread;
 	struct task_struct *cleaner_kthread;
 	u32 thread_pool_size;
+	/* size of the delalloc ranges compressed in parallel */
+	u32 async_chunk_size;
 
 	struct kobject *space_info_kobj;
 
@@ -2721,6 +2721,7 @@ int open_ctree(struct super_block *sb,
 
 	fs_info->thread_pool_size = min_t(unsigned long,
 					  num_online_cpus() + 2, 8);
+	fs_info->async_chunk_size = SZ_512K;
 
 	INIT_LIST_HEAD(&fs_info->ordered_roots);
 	spin_lock_init(&fs_info->ordered_root_lock);
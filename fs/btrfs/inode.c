@@ -411,6 +411,54 @@ static inline bool inode_can_compress(struct inode *inode)
 	return true;
 }
 
+/* Back off for at most 2^6 ranges */
+#define BTRFS_COMPRESS_BACKOFF_MAX	6
+/* Forget old misses, the file contents may have changed since */
+#define BTRFS_COMPRESS_BACKOFF_DECAY	(30 * HZ)
+
+/*
+ * After a range fails to get any smaller, write the next 2^misses ranges
+ * of the inode uncompressed without even sampling them. Compression
+ * workers for one inode run in parallel, so this is kept as a hint only.
+ */
+static bool inode_compress_backoff(struct btrfs_inode *inode)
+{
+	unsigned int skip;
+
+	if (!READ_ONCE(inode->compress_misses))
+		return false;
+
+	if (time_after(jiffies, READ_ONCE(inode->compress_miss_time) +
+				BTRFS_COMPRESS_BACKOFF_DECAY)) {
+		WRITE_ONCE(inode->compress_misses, 0);
+		WRITE_ONCE(inode->compress_skip, 0);
+		return false;
+	}
+
+	skip = READ_ONCE(inode->compress_skip);
+	if (!skip)
+		return false;
+	WRITE_ONCE(inode->compress_skip, skip - 1);
+	return true;
+}
+
+static void inode_compress_miss(struct btrfs_inode *inode)
+{
+	unsigned int misses = READ_ONCE(inode->compress_misses);
+
+	if (misses < BTRFS_COMPRESS_BACKOFF_MAX)
+		misses++;
+	WRITE_ONCE(inode->compress_misses, misses);
+	WRITE_ONCE(inode->compress_skip, 1U << misses);
+	WRITE_ONCE(inode->compress_miss_time, jiffies);
+}
+
+static void inode_compress_hit(struct btrfs_inode *inode)
+{
+	if (READ_ONCE(inode->compress_misses))
+		WRITE_ONCE(inode->compress_misses, 0);
+}
+
 /*
  * Check if the inode needs to be submitted to compression, based on mount
  * options, defragmentation, properties or heuristics.
@@ -418,6 +466,7 @@ static inline bool inode_can_compress(struct inode *inode)
 static inline int inode_need_compress(struct inode *inode, u64 start, u64 end)
 {
 	struct btrfs_fs_info *fs_info = btrfs_sb(inode->i_sb);
+	int ret;
 
 	if (!inode_can_compress(inode)) {
 		WARN(IS_ENABLED(CONFIG_BTRFS_DEBUG),
@@ -436,8 +485,18 @@ static inline int inode_need_compress(struct inode *inode, u64 start, u64 end)
 		return 0;
 	if (btrfs_test_opt(fs_info, COMPRESS) ||
 	    BTRFS_I(inode)->flags & BTRFS_INODE_COMPRESS ||
-	    BTRFS_I(inode)->prop_compress)
-		return btrfs_compress_heuristic(inode, start, end);
+	    BTRFS_I(inode)->prop_compress) {
+		if (inode_compress_backoff(BTRFS_I(inode))) {
+			trace_btrfs_compress_decision(BTRFS_I(inode), start,
+					end - start + 1, BTRFS_COMPRESS_SKIP, 0);
+			return 0;
+		}
+		ret = btrfs_compress_heuristic(inode, start, end);
+		if (!ret)
+			trace_btrfs_compress_decision(BTRFS_I(inode), start,
+					end - start + 1, BTRFS_COMPRESS_REJECT, 0);
+		return ret;
+	}
 	return 0;
 }
 
@@ -673,6 +732,10 @@ static noinline int compress_file_range(struct async_chunk *async_chunk)
 		total_in = ALIGN(total_in, PAGE_SIZE);
 		if (total_compressed + blocksize <= total_in) {
 			compressed_extents++;
+			inode_compress_hit(BTRFS_I(inode));
+			trace_btrfs_compress_decision(BTRFS_I(inode), start,
+					total_in, BTRFS_COMPRESS_HIT,
+					total_compressed);
 
 			/*
 			 * The async work queues will take care of doing actual
@@ -697,6 +760,9 @@ static noinline int compress_file_range(struct async_chunk *async_chunk)
 		 * the compression code ran but failed to make things smaller,
 		 * free any pages it allocated and our page pointer array
 		 */
+		trace_btrfs_compress_decision(BTRFS_I(inode), start,
+				end - start + 1, BTRFS_COMPRESS_MISS,
+				total_compressed);
 		for (i = 0; i < nr_pages; i++) {
 			WARN_ON(pages[i]->mapping);
 			put_page(pages[i]);
@@ -706,11 +772,14 @@ static noinline int compress_file_range(struct async_chunk *async_chunk)
 		total_compressed = 0;
 		nr_pages = 0;
 
-		/* flag the file so we don't compress in the future */
+		/*
+		 * Back off from compressing this file for a while, rather
+		 * than giving up on it for good: a file with an incompressible
+		 * region may still have compressible data elsewhere.
+		 */
 		if (!btrfs_test_opt(fs_info, FORCE_COMPRESS) &&
-		    !(BTRFS_I(inode)->prop_compress)) {
-			BTRFS_I(inode)->flags |= BTRFS_INODE_NOCOMPRESS;
-		}
+		    !(BTRFS_I(inode)->prop_compress))
+			inode_compress_miss(BTRFS_I(inode));
 	}
 cleanup_and_bail_uncompressed:
 	/*
@@ -1240,7 +1309,8 @@ static int cow_file_range_async(struct inode *inode, struct page *locked_page,
 	struct async_chunk *async_chunk;
 	unsigned long nr_pages;
 	u64 cur_end;
-	u64 num_chunks = DIV_ROUND_UP(end - start, SZ_512K);
+	u32 chunk_size = READ_ONCE(fs_info->async_chunk_size);
+	u64 num_chunks = DIV_ROUND_UP(end - start, chunk_size);
 	int i;
 	bool should_compress;
 	unsigned nofs_flag;
@@ -1277,7 +1347,7 @@ static int cow_file_range_async(struct inode *inode, struct page *locked_page,
 
 	for (i = 0; i < num_chunks; i++) {
 		if (should_compress)
-			cur_end = min(end, start + SZ_512K - 1);
+			cur_end = min(end, start + chunk_size - 1);
 		else
 			cur_end = end;
 
@@ -9489,6 +9559,9 @@ struct inode *btrfs_alloc_inode(struct super_block *sb)
 	ei->runtime_flags = 0;
 	ei->prop_compress = BTRFS_COMPRESS_NONE;
 	ei->defrag_compress = BTRFS_COMPRESS_NONE;
+	ei->compress_misses = 0;
+	ei->compress_skip = 0;
+	ei->compress_miss_time = 0;
 
 	ei->delayed_node = NULL;
 
@@ -17,6 +17,7 @@
 #include "volumes.h"
 #include "space-info.h"
 #include "block-group.h"
+#include "compression.h"
 
 struct btrfs_feature_attr {
 	struct kobj_attribute kobj_attr;
@@ -604,6 +605,48 @@ static ssize_t btrfs_metadata_uuid_show(struct kobject *kobj,
 
 BTRFS_ATTR(, metadata_uuid, btrfs_metadata_uuid_show);
 
+static ssize_t btrfs_compress_chunk_size_show(struct kobject *kobj,
+				struct kobj_attribute *a, char *buf)
+{
+	struct btrfs_fs_info *fs_info = to_fs_info(kobj);
+
+	return snprintf(buf, PAGE_SIZE, "%u\n",
+			READ_ONCE(fs_info->async_chunk_size));
+}
+
+/*
+ * Each chunk of a delalloc range is compressed by its own delalloc worker,
+ * one compressed extent (BTRFS_MAX_UNCOMPRESSED) at a time. Smaller chunks
+ * spread a large write over more workers.
+ */
+static ssize_t btrfs_compress_chunk_size_store(struct kobject *kobj,
+				struct kobj_attribute *a,
+				const char *buf, size_t len)
+{
+	struct btrfs_fs_info *fs_info = to_fs_info(kobj);
+	u32 val;
+	int ret;
+
+	if (!fs_info)
+		return -EPERM;
+
+	if (!capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	ret = kstrtou32(buf, 0, &val);
+	if (ret)
+		return ret;
+	if (val < BTRFS_MAX_UNCOMPRESSED || val > SZ_8M ||
+	    !IS_ALIGNED(val, BTRFS_MAX_UNCOMPRESSED))
+		return -EINVAL;
+
+	WRITE_ONCE(fs_info->async_chunk_size, val);
+	return len;
+}
+
+BTRFS_ATTR_RW(, compress_chunk_size, btrfs_compress_chunk_size_show,
+	      btrfs_compress_chunk_size_store);
+
 static const struct attribute *btrfs_attrs[] = {
 	BTRFS_ATTR_PTR(, label),
 	BTRFS_ATTR_PTR(, nodesize),
@@ -611,6 +654,7 @@ static const struct attribute *btrfs_attrs[] = {
 	BTRFS_ATTR_PTR(, clone_alignment),
 	BTRFS_ATTR_PTR(, quota_override),
 	BTRFS_ATTR_PTR(, metadata_uuid),
+	BTRFS_ATTR_PTR(, compress_chunk_size),
 	NULL,
 };
 
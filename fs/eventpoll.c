@@ -1214,6 +1214,7 @@ static int ep_poll_callback(wait_queue_entry_t *wait, unsigned mode, int sync, v
 	__poll_t pollflags = key_to_poll(key);
 	unsigned long flags;
 	int ewake = 0;
+	bool wake = false;
 
 	read_lock_irqsave(&ep->lock, flags);
 
@@ -1247,7 +1248,12 @@ static int ep_poll_callback(wait_queue_entry_t *wait, unsigned mode, int sync, v
 		if (chain_epi_lockless(epi))
 			ep_pm_stay_awake_rcu(epi);
 	} else if (!ep_is_linked(epi)) {
-		/* In the usual case, add event to ready list. */
+		/*
+		 * In the usual case, add event to ready list. The list can
+		 * only grow while we hold the read lock, so whoever finds it
+		 * empty here is the one that has to wake a waiter.
+		 */
+		wake = list_empty(&ep->rdllist);
 		if (list_add_tail_lockless(&epi->rdllink, &ep->rdllist))
 			ep_pm_stay_awake_rcu(epi);
 	}
@@ -1255,6 +1261,12 @@ static int ep_poll_callback(wait_queue_entry_t *wait, unsigned mode, int sync, v
 	/*
 	 * Wake up ( if active ) both the eventpoll wait list and the ->poll()
 	 * wait list.
+	 *
+	 * ep->wq is only woken for the event that makes the ready list
+	 * non-empty. Events arriving after it, e.g. the rest of a NAPI poll
+	 * worth of sockets, are harvested by that same wakeup. Events chained
+	 * on ->ovflist are picked up by ep_scan_ready_list(), which wakes
+	 * again if it leaves anything on the ready list.
 	 */
 	if (waitqueue_active(&ep->wq)) {
 		if ((epi->event.events & EPOLLEXCLUSIVE) &&
@@ -1273,7 +1285,8 @@ static int ep_poll_callback(wait_queue_entry_t *wait, unsigned mode, int sync, v
 				break;
 			}
 		}
-		wake_up(&ep->wq);
+		if (wake)
+			wake_up(&ep->wq);
 	}
 	if (waitqueue_active(&ep->poll_wait))
 		pwake++;
@@ -1949,6 +1962,17 @@ static int ep_poll(struct eventpoll *ep, struct epoll_event __user *events,
 		write_lock_irq(&ep->lock);
 		__remove_wait_queue(&ep->wq, &wait);
 		write_unlock_irq(&ep->lock);
+	} else if (res || !eavail) {
+		/*
+		 * We may have taken the one wakeup ep_poll_callback() sends
+		 * for a batch of events, but are leaving on a signal or a
+		 * timeout. Hand it on so that the events are not stranded
+		 * while other threads sleep on ep->wq.
+		 */
+		write_lock_irq(&ep->lock);
+		if (ep_events_available(ep) && waitqueue_active(&ep->wq))
+			wake_up(&ep->wq);
+		write_unlock_irq(&ep->lock);
 	}
 
 send_events:
@@ -123,7 +123,8 @@
 #define EXT4_HT_MOVE_EXTENTS     9
 #define EXT4_HT_XATTR           10
 #define EXT4_HT_EXT_CONVERT     11
-#define EXT4_HT_MAX             12
+#define EXT4_HT_INODE_TIME      12
+#define EXT4_HT_MAX             13
 
 /**
  *   struct ext4_journal_cb_entry - Base structure for callback information.
@@ -385,7 +386,9 @@ static inline void ext4_update_inode_fsync_trans(handle_t *handle,
 	struct ext4_inode_info *ei = EXT4_I(inode);
 
 	if (ext4_handle_valid(handle) && !is_handle_aborted(handle)) {
-		ei->i_sync_tid = handle->h_transaction->t_tid;
+		/* fsync_lazytime: timestamps go with the periodic commit */
+		if (handle->h_type != EXT4_HT_INODE_TIME || datasync)
+			ei->i_sync_tid = handle->h_transaction->t_tid;
 		if (datasync)
 			ei->i_datasync_tid = handle->h_transaction->t_tid;
 	}
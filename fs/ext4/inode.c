@@ -6186,10 +6186,20 @@ int ext4_mark_inode_dirty(handle_t *handle, struct inode *inode)
 void ext4_dirty_inode(struct inode *inode, int flags)
 {
 	handle_t *handle;
+	int type = EXT4_HT_INODE;
 
 	if (flags == I_DIRTY_TIME)
 		return;
-	handle = ext4_journal_start(inode, EXT4_HT_INODE, 2);
+	/*
+	 * This is generic_update_time(). With fsync_lazytime, fsync()
+	 * doesn't wait for the commit of a timestamp-only change: on slow
+	 * flash that commit costs metadata writes and two cache flushes
+	 * per call. The periodic commit still makes it durable.
+	 */
+	if (flags == (I_DIRTY_TIME | I_DIRTY_SYNC) &&
+	    test_opt(inode->i_sb, FSYNC_LAZYTIME))
+		type = EXT4_HT_INODE_TIME;
+	handle = ext4_journal_start(inode, type, 2);
 	if (IS_ERR(handle))
 		goto out;
 
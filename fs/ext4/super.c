@@ -1475,6 +1475,7 @@ enum {
 	Opt_dioread_nolock, Opt_dioread_lock,
 	Opt_discard, Opt_nodiscard, Opt_init_itable, Opt_noinit_itable,
 	Opt_max_dir_size_kb, Opt_nojournal_checksum, Opt_nombcache,
+	Opt_fsync_lazytime, Opt_nofsync_lazytime,
 };
 
 static const match_table_t tokens = {
@@ -1561,6 +1562,8 @@ static const match_table_t tokens = {
 	{Opt_test_dummy_encryption, "test_dummy_encryption"},
 	{Opt_nombcache, "nombcache"},
 	{Opt_nombcache, "no_mbcache"},	/* for backward compatibility */
+	{Opt_fsync_lazytime, "fsync_lazytime"},
+	{Opt_nofsync_lazytime, "nofsync_lazytime"},
 	{Opt_removed, "check=none"},	/* mount option from ext2/3 */
 	{Opt_removed, "nocheck"},	/* mount option from ext2/3 */
 	{Opt_removed, "reservation"},	/* mount option from ext2/3 */
@@ -1772,6 +1775,8 @@ static const struct mount_opts {
 	{Opt_max_dir_size_kb, 0, MOPT_GTE0},
 	{Opt_test_dummy_encryption, 0, MOPT_GTE0},
 	{Opt_nombcache, EXT4_MOUNT_NO_MBCACHE, MOPT_SET},
+	{Opt_fsync_lazytime, EXT4_MOUNT_FSYNC_LAZYTIME, MOPT_SET},
+	{Opt_nofsync_lazytime, EXT4_MOUNT_FSYNC_LAZYTIME, MOPT_CLEAR},
 	{Opt_err, 0, 0}
 };
 
@@ -1162,6 +1162,29 @@ static bool __need_flush_quota(struct f2fs_sb_info *sbi)
 	return ret;
 }
 
+/*
+ * Write back dirty node pages before blocking operations, so all that is
+ * left for block_operations() to write under f2fs_lock_all() is what got
+ * dirtied in the meantime. WB_SYNC_ALL, since a WB_SYNC_NONE pass skips
+ * and redirties cold dnodes, which are most of them.
+ */
+static void preflush_node_pages(struct f2fs_sb_info *sbi)
+{
+	struct writeback_control wbc = {
+		.sync_mode = WB_SYNC_ALL,
+		.nr_to_write = LONG_MAX,
+		.for_reclaim = 0,
+	};
+	struct blk_plug plug;
+
+	if (!get_pages(sbi, F2FS_DIRTY_NODES))
+		return;
+
+	blk_start_plug(&plug);
+	f2fs_sync_node_pages(sbi, &wbc, false, FS_CP_NODE_IO);
+	blk_finish_plug(&plug);
+}
+
 /*
  * Freeze all the FS-operations for checkpoint.
  */
@@ -1582,6 +1605,8 @@ int f2fs_write_checkpoint(struct f2fs_sb_info *sbi, struct cp_control *cpc)
 		goto out;
 	}
 
+	preflush_node_pages(sbi);
+
 	trace_f2fs_write_checkpoint(sbi->sb, cpc->reason, "start block_ops");
 
 	err = block_operations(sbi);
@@ -87,6 +87,23 @@ static int gc_thread_func(void *data)
 			goto next;
 		}
 
+		/*
+		 * Short of the reserve, don't wait for the device to go idle:
+		 * migrate one victim per pass and let in-flight foreground IO
+		 * stretch the gap between passes, so each step stays small
+		 * next to what the writer itself is issuing.
+		 */
+		gc_th->reserve_gc = gc_reserve_low(sbi);
+		if (gc_th->reserve_gc) {
+			if (is_idle(sbi, GC_TIME) ||
+					wait_ms < gc_th->urgent_sleep_time)
+				wait_ms = gc_th->urgent_sleep_time;
+			else
+				wait_ms = min(wait_ms * 2,
+						gc_th->min_sleep_time);
+			goto do_gc;
+		}
+
 		if (!is_idle(sbi, GC_TIME)) {
 			increase_sleep_time(gc_th, &wait_ms);
 			mutex_unlock(&sbi->gc_mutex);
@@ -133,6 +150,7 @@ int f2fs_start_gc_thread(struct f2fs_sb_info *sbi)
 	gc_th->min_sleep_time = DEF_GC_THREAD_MIN_SLEEP_TIME;
 	gc_th->max_sleep_time = DEF_GC_THREAD_MAX_SLEEP_TIME;
 	gc_th->no_gc_sleep_time = DEF_GC_THREAD_NOGC_SLEEP_TIME;
+	gc_th->reserve_secs = DEF_GC_THREAD_RESERVE_SECS;
 
 	gc_th->gc_wake= 0;
 
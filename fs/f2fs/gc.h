@@ -14,6 +14,7 @@
 #define DEF_GC_THREAD_MIN_SLEEP_TIME	30000	/* milliseconds */
 #define DEF_GC_THREAD_MAX_SLEEP_TIME	60000
 #define DEF_GC_THREAD_NOGC_SLEEP_TIME	300000	/* wait 5 min */
+#define DEF_GC_THREAD_RESERVE_SECS	0	/* no headroom kept by default */
 #define LIMIT_INVALID_BLOCK	40 /* percentage over total user space */
 #define LIMIT_FREE_BLOCK	40 /* percentage over invalid + free space */
 
@@ -32,6 +33,13 @@ struct f2fs_gc_kthread {
 	unsigned int max_sleep_time;
 	unsigned int no_gc_sleep_time;
 
+	/*
+	 * free sections background GC keeps on top of what foreground GC
+	 * needs, migrating ahead of demand so writers don't GC themselves
+	 */
+	unsigned int reserve_secs;
+	bool reserve_gc;		/* already catching up on the reserve */
+
 	/* for changing gc mode */
 	unsigned int gc_wake;
 };
@@ -108,3 +116,16 @@ static inline bool has_enough_invalid_blocks(struct f2fs_sb_info *sbi)
 		return true;
 	return false;
 }
+
+/*
+ * Background GC falls behind the reserve well before f2fs_balance_fs() has to
+ * collect synchronously, so it can catch up at its own pace in the meantime.
+ */
+static inline bool gc_reserve_low(struct f2fs_sb_info *sbi)
+{
+	struct f2fs_gc_kthread *gc_th = sbi->gc_thread;
+
+	if (!gc_th || !gc_th->reserve_secs)
+		return false;
+	return has_not_enough_free_secs(sbi, 0, gc_th->reserve_secs);
+}
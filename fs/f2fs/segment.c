@@ -510,6 +510,11 @@ void f2fs_balance_fs(struct f2fs_sb_info *sbi, bool need)
 	if (has_not_enough_free_secs(sbi, 0, 0)) {
 		mutex_lock(&sbi->gc_mutex);
 		f2fs_gc(sbi, false, false, NULL_SEGNO);
+	} else if (need && gc_reserve_low(sbi) &&
+			!sbi->gc_thread->reserve_gc) {
+		/* kick background GC now rather than at its next timeout */
+		sbi->gc_thread->gc_wake = 1;
+		wake_up_interruptible_all(&sbi->gc_thread->gc_wait_queue_head);
 	}
 }
 
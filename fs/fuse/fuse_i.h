@@ -38,6 +38,9 @@
 /** Maximum of max_pages received in init_out */
 #define FUSE_MAX_MAX_PAGES 256
 
+/** Maximum readahead a mount can ask for, in pages */
+#define FUSE_MAX_READAHEAD_PAGES (16 * FUSE_MAX_MAX_PAGES)
+
 /** Bias for fi->writectr, meaning new writepages must not be sent */
 #define FUSE_NOWRITE INT_MIN
 
@@ -487,6 +490,7 @@ struct fuse_fs_context {
 	bool no_force_umount:1;
 	bool no_mount_options:1;
 	unsigned int max_read;
+	unsigned int max_readahead;
 	unsigned int blksize;
 	const char *subtype;
 
@@ -528,6 +532,9 @@ struct fuse_conn {
 	/** Maximum read size */
 	unsigned max_read;
 
+	/** Readahead offered to the daemon at INIT, 0 for the default */
+	unsigned int max_readahead;
+
 	/** Maximum write size */
 	unsigned max_write;
 
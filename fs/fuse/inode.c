@@ -459,6 +459,7 @@ enum {
 	OPT_DEFAULT_PERMISSIONS,
 	OPT_ALLOW_OTHER,
 	OPT_MAX_READ,
+	OPT_MAX_READAHEAD,
 	OPT_BLKSIZE,
 	OPT_ERR
 };
@@ -472,6 +473,7 @@ static const struct fs_parameter_spec fuse_param_specs[] = {
 	fsparam_flag	("default_permissions",	OPT_DEFAULT_PERMISSIONS),
 	fsparam_flag	("allow_other",		OPT_ALLOW_OTHER),
 	fsparam_u32	("max_read",		OPT_MAX_READ),
+	fsparam_u32	("max_readahead",	OPT_MAX_READAHEAD),
 	fsparam_u32	("blksize",		OPT_BLKSIZE),
 	fsparam_string	("subtype",		OPT_SUBTYPE),
 	{}
@@ -552,6 +554,10 @@ static int fuse_parse_param(struct fs_context *fc, struct fs_parameter *param)
 		ctx->max_read = result.uint_32;
 		break;
 
+	case OPT_MAX_READAHEAD:
+		ctx->max_readahead = result.uint_32;
+		break;
+
 	case OPT_BLKSIZE:
 		if (!ctx->is_bdev)
 			return invalf(fc, "fuse: blksize only supported for fuseblk");
@@ -591,6 +597,8 @@ static int fuse_show_options(struct seq_file *m, struct dentry *root)
 		seq_puts(m, ",allow_other");
 	if (fc->max_read != ~0)
 		seq_printf(m, ",max_read=%u", fc->max_read);
+	if (fc->max_readahead)
+		seq_printf(m, ",max_readahead=%u", fc->max_readahead);
 	if (sb->s_bdev && sb->s_blocksize != FUSE_DEFAULT_BLKSIZE)
 		seq_printf(m, ",blksize=%lu", sb->s_blocksize);
 	return 0;
@@ -1201,6 +1209,19 @@ int fuse_fill_super_common(struct super_block *sb, struct fuse_fs_context *ctx)
 	fc->user_id = ctx->user_id;
 	fc->group_id = ctx->group_id;
 	fc->max_read = max_t(unsigned, 4096, ctx->max_read);
+	/*
+	 * Readahead is offered to the daemon at INIT and can only be lowered
+	 * by it, so a mount that wants bigger windows than the default has
+	 * to ask here.  ondemand_readahead() ramps up to it on sequential
+	 * reads, and readpages splits each window into max_pages requests.
+	 */
+	if (ctx->max_readahead) {
+		sb->s_bdi->ra_pages = clamp_t(unsigned long,
+					      ctx->max_readahead / PAGE_SIZE,
+					      1, FUSE_MAX_READAHEAD_PAGES);
+		fc->max_readahead = min_t(unsigned long, ctx->max_readahead,
+					  FUSE_MAX_READAHEAD_PAGES * PAGE_SIZE);
+	}
 	fc->destroy = ctx->destroy;
 	fc->no_control = ctx->no_control;
 	fc->no_force_umount = ctx->no_force_umount;
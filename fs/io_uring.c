@@ -72,6 +72,9 @@
 #include <linux/hugetlb.h>
 #include <linux/highmem.h>
 #include <linux/fs_struct.h>
+#include <linux/migrate.h>
+#include <linux/dma-mapping.h>
+#include <linux/pagemap.h>
 
 #include <uapi/linux/io_uring.h>
 
@@ -163,6 +166,23 @@ struct io_mapped_ubuf {
 	unsigned int	nr_bvecs;
 };
 
+/*
+ * An SQ poll thread and the rings it serves. Rings set up with
+ * IORING_SETUP_ATTACH_WQ share the thread of the ring passed in wq_fd
+ * instead of starting their own.
+ */
+struct io_sq_data {
+	refcount_t		refs;
+
+	/* protects ctx_list, held by the thread while it runs the rings */
+	struct mutex		lock;
+	struct list_head	ctx_list;
+
+	struct task_struct	*thread;
+	struct wait_queue_head	wait;
+	struct completion	started;
+};
+
 struct async_list {
 	spinlock_t		lock;
 	atomic_t		cnt;
@@ -208,10 +228,12 @@ struct io_ring_ctx {
 
 	/* IO offload */
 	struct workqueue_struct	*sqo_wq[2];
-	struct task_struct	*sqo_thread;	/* if using sq thread polling */
+	struct io_sq_data	*sq_data;	/* if using sq thread polling */
+	struct list_head	sqd_list;
+	unsigned		sq_inflight;
 	struct mm_struct	*sqo_mm;
-	wait_queue_head_t	sqo_wait;
-	struct completion	sqo_thread_started;
+	wait_queue_head_t	*sqo_wait;
+	wait_queue_head_t	__sqo_wait;
 
 	struct {
 		unsigned		cached_cq_tail;
@@ -270,6 +292,11 @@ struct io_ring_ctx {
 
 	struct list_head	task_list;
 	spinlock_t		task_lock;
+
+	/* async buffered reads whose page has been unlocked */
+	spinlock_t		buf_retry_lock;
+	struct list_head	buf_retry_list;
+	struct delayed_work	buf_retry_work;
 };
 
 struct sqe_submit {
@@ -340,11 +367,16 @@ struct io_kiocb {
 	u64			user_data;
 	u32			result;
 	u32			sequence;
+	size_t			buf_done;	/* async buffered read progress */
 	struct files_struct	*files;
 
 	struct fs_struct	*fs;
 
-	struct work_struct	work;
+	union {
+		struct work_struct	work;
+		/* armed async buffered read, see io_read_async_buffered() */
+		struct wait_page_queue	wpq;
+	};
 	struct task_struct	*work_task;
 	struct list_head	task_list;
 };
@@ -352,6 +384,12 @@ struct io_kiocb {
 #define IO_PLUG_THRESHOLD		2
 #define IO_IOPOLL_BATCH			8
 
+/*
+ * How long an unlocked page may wait for its submitter to come back into
+ * io_uring_enter() before the read is retried from the workqueue instead.
+ */
+#define IO_BUF_RETRY_DELAY		1	/* jiffies */
+
 struct io_submit_state {
 	struct blk_plug		plug;
 
@@ -373,6 +411,7 @@ struct io_submit_state {
 };
 
 static void io_sq_wq_submit_work(struct work_struct *work);
+static void io_buf_retry_work(struct work_struct *work);
 static void io_cqring_fill_event(struct io_ring_ctx *ctx, u64 ki_user_data,
 				 long res);
 static void __io_free_req(struct io_kiocb *req);
@@ -417,10 +456,11 @@ static struct io_ring_ctx *io_ring_ctx_alloc(struct io_uring_params *p)
 	}
 
 	ctx->flags = p->flags;
-	init_waitqueue_head(&ctx->sqo_wait);
+	init_waitqueue_head(&ctx->__sqo_wait);
+	ctx->sqo_wait = &ctx->__sqo_wait;
+	INIT_LIST_HEAD(&ctx->sqd_list);
 	init_waitqueue_head(&ctx->cq_wait);
 	init_completion(&ctx->ctx_done);
-	init_completion(&ctx->sqo_thread_started);
 	mutex_init(&ctx->uring_lock);
 	init_waitqueue_head(&ctx->wait);
 	for (i = 0; i < ARRAY_SIZE(ctx->pending_async); i++) {
@@ -435,6 +475,9 @@ static struct io_ring_ctx *io_ring_ctx_alloc(struct io_uring_params *p)
 	INIT_LIST_HEAD(&ctx->timeout_list);
 	INIT_LIST_HEAD(&ctx->task_list);
 	spin_lock_init(&ctx->task_lock);
+	spin_lock_init(&ctx->buf_retry_lock);
+	INIT_LIST_HEAD(&ctx->buf_retry_list);
+	INIT_DELAYED_WORK(&ctx->buf_retry_work, io_buf_retry_work);
 	return ctx;
 }
 
@@ -628,8 +671,8 @@ static void io_cqring_ev_posted(struct io_ring_ctx *ctx)
 {
 	if (waitqueue_active(&ctx->wait))
 		wake_up(&ctx->wait);
-	if (waitqueue_active(&ctx->sqo_wait))
-		wake_up(&ctx->sqo_wait);
+	if (waitqueue_active(ctx->sqo_wait))
+		wake_up(ctx->sqo_wait);
 	if (ctx->cq_ev_fd)
 		eventfd_signal(ctx->cq_ev_fd, 1);
 }
@@ -693,6 +736,7 @@ static struct io_kiocb *io_get_req(struct io_ring_ctx *ctx,
 	/* one is dropped after submission, the other at completion */
 	refcount_set(&req->refs, 2);
 	req->result = 0;
+	req->buf_done = 0;
 	req->fs = NULL;
 	return req;
 out:
@@ -1420,6 +1464,110 @@ static ssize_t loop_rw_iter(int rw, struct file *file, struct kiocb *kiocb,
 	return ret;
 }
 
+static bool io_read_can_async_buffered(struct io_kiocb *req)
+{
+	struct kiocb *kiocb = &req->rw;
+
+	/* RWF_NOWAIT and O_NONBLOCK readers get their -EAGAIN */
+	if (req->flags & REQ_F_NOWAIT)
+		return false;
+	if (kiocb->ki_flags & IOCB_DIRECT)
+		return false;
+	/* the retry runs from io_uring_enter(), which SQPOLL rings skip */
+	if (req->ctx->flags & (IORING_SETUP_SQPOLL | IORING_SETUP_IOPOLL))
+		return false;
+	/* only files whose ->read_iter() honours IOCB_WAITQ */
+	return kiocb->ki_filp->f_mode & FMODE_BUF_RASYNC;
+}
+
+/*
+ * Called from the page waitqueue, usually in interrupt context, once the
+ * page an async buffered read stopped at has been unlocked. Hand the
+ * request back to the ring for a retry.
+ */
+static int io_async_buf_func(struct wait_queue_entry *wait, unsigned mode,
+			     int sync, void *arg)
+{
+	struct wait_page_queue *wpq;
+	struct io_kiocb *req = wait->private;
+	struct wait_page_key *key = arg;
+	struct io_ring_ctx *ctx = req->ctx;
+	unsigned long flags;
+	int ret;
+
+	wpq = container_of(wait, struct wait_page_queue, wait);
+
+	ret = wake_page_match(wpq, key);
+	if (ret != 1)
+		return ret;
+
+	list_del_init(&wait->entry);
+
+	/* the retry drops a submission reference like any other submit */
+	refcount_inc(&req->refs);
+	spin_lock_irqsave(&ctx->buf_retry_lock, flags);
+	list_add_tail(&req->list, &ctx->buf_retry_list);
+	spin_unlock_irqrestore(&ctx->buf_retry_lock, flags);
+
+	wake_up(&ctx->wait);
+	queue_delayed_work(system_wq, &ctx->buf_retry_work, IO_BUF_RETRY_DELAY);
+	return 1;
+}
+
+/*
+ * A buffered read hit a page that isn't uptodate yet. Instead of punting
+ * to a worker that would sleep in lock_page(), keep reading with
+ * IOCB_WAITQ: the page cache then queues io_async_buf_func() on the first
+ * locked page and returns -EIOCBQUEUED, and the read is retried from
+ * where it stopped once that page is unlocked. Returns -EIOCBQUEUED if the
+ * callback was armed, otherwise the result of the read so far.
+ */
+static ssize_t io_read_async_buffered(struct io_kiocb *req,
+				      const struct sqe_submit *s,
+				      struct iov_iter *iter, ssize_t ret)
+{
+	const struct io_uring_sqe *sqe = req->submit.sqe;
+	struct kiocb *kiocb = &req->rw;
+	struct io_uring_sqe *sqe_copy;
+	bool waited = false;
+
+	/*
+	 * The sqe must outlive the ring slot, and must be in place before
+	 * the callback is armed as the retry may run as soon as it is.
+	 */
+	sqe_copy = kmemdup(s->sqe, sizeof(*sqe_copy), GFP_KERNEL);
+	if (!sqe_copy) {
+		if (ret > 0)
+			return req->buf_done + ret;
+		return req->buf_done ? req->buf_done : ret;
+	}
+	req->submit.sqe = sqe_copy;
+
+	kiocb->ki_flags &= ~IOCB_NOWAIT;
+	kiocb->ki_flags |= IOCB_WAITQ;
+	kiocb->ki_waitq = &req->wpq;
+	init_waitqueue_func_entry(&req->wpq.wait, io_async_buf_func);
+	req->wpq.wait.private = req;
+
+	do {
+		if (ret > 0)
+			req->buf_done += ret;
+		else if (ret != -EAGAIN || waited)
+			break;
+		if (!iov_iter_count(iter))
+			break;
+		ret = call_read_iter(kiocb->ki_filp, kiocb, iter);
+		waited = true;
+	} while (ret != -EIOCBQUEUED);
+
+	if (ret == -EIOCBQUEUED)
+		return ret;
+
+	req->submit.sqe = sqe;
+	kfree(sqe_copy);
+	return req->buf_done ? req->buf_done : ret;
+}
+
 static int io_read(struct io_kiocb *req, const struct sqe_submit *s,
 		   bool force_nonblock)
 {
@@ -1451,6 +1599,12 @@ static int io_read(struct io_kiocb *req, const struct sqe_submit *s,
 	if (!ret) {
 		ssize_t ret2;
 
+		/* resuming an async buffered read that made some progress */
+		if (req->buf_done) {
+			iov_iter_advance(&iter, req->buf_done);
+			kiocb->ki_pos += req->buf_done;
+		}
+
 		if (file->f_op->read_iter)
 			ret2 = call_read_iter(file, kiocb, &iter);
 		else if (req->file->f_op->read)
@@ -1458,20 +1612,37 @@ static int io_read(struct io_kiocb *req, const struct sqe_submit *s,
 		else
 			ret2 = -EINVAL;
 
+		if (force_nonblock && io_read_can_async_buffered(req) &&
+		    (req->buf_done || ret2 == -EAGAIN ||
+		     (ret2 > 0 && iov_iter_count(&iter)))) {
+			ret2 = io_read_async_buffered(req, s, &iter, ret2);
+		} else {
+			/* a worker finishing what an async read started */
+			if (req->buf_done)
+				ret2 = ret2 < 0 ? req->buf_done :
+						  ret2 + req->buf_done;
+			/*
+			 * In case of a short read, punt to async. This can
+			 * happen if we have data partially cached.
+			 * Alternatively we can return the short read, in
+			 * which case the application will need to issue
+			 * another SQE and wait for it. That SQE will need
+			 * async punt anyway, so it's more efficient to do it
+			 * here.
+			 */
+			if (force_nonblock && !(req->flags & REQ_F_NOWAIT) &&
+			    (req->flags & REQ_F_ISREG) &&
+			    ret2 > 0 && ret2 < read_size)
+				ret2 = -EAGAIN;
+		}
 		/*
-		 * In case of a short read, punt to async. This can happen
-		 * if we have data partially cached. Alternatively we can
-		 * return the short read, in which case the application will
-		 * need to issue another SQE and wait for it. That SQE will
-		 * need async punt anyway, so it's more efficient to do it
-		 * here.
+		 * Catch -EAGAIN return for forced non-blocking submission.
+		 * -EIOCBQUEUED means io_async_buf_func() will hand the
+		 * request back to us.
 		 */
-		if (force_nonblock && !(req->flags & REQ_F_NOWAIT) &&
-		    (req->flags & REQ_F_ISREG) &&
-		    ret2 > 0 && ret2 < read_size)
-			ret2 = -EAGAIN;
-		/* Catch -EAGAIN return for forced non-blocking submission */
-		if (!force_nonblock || ret2 != -EAGAIN) {
+		if (ret2 == -EIOCBQUEUED) {
+			/* nothing to do until the page is unlocked */
+		} else if (!force_nonblock || ret2 != -EAGAIN) {
 			io_rw_done(kiocb, ret2);
 		} else {
 			/*
@@ -2513,6 +2684,80 @@ static int __io_queue_sqe(struct io_ring_ctx *ctx, struct io_kiocb *req,
 	return ret;
 }
 
+static inline bool io_buf_retry_pending(struct io_ring_ctx *ctx)
+{
+	return !list_empty_careful(&ctx->buf_retry_list) &&
+		current->mm == ctx->sqo_mm;
+}
+
+/*
+ * Retry async buffered reads whose page has been unlocked, from the task
+ * that owns the ring: the page is in the cache now, so this is just the
+ * copy that a worker would otherwise have done.
+ */
+static void io_run_buf_retries(struct io_ring_ctx *ctx)
+{
+	const struct cred *old_cred;
+	LIST_HEAD(list);
+
+	if (!io_buf_retry_pending(ctx))
+		return;
+
+	spin_lock_irq(&ctx->buf_retry_lock);
+	list_splice_init(&ctx->buf_retry_list, &list);
+	spin_unlock_irq(&ctx->buf_retry_lock);
+
+	old_cred = override_creds(ctx->creds);
+	mutex_lock(&ctx->uring_lock);
+	while (!list_empty(&list)) {
+		struct io_kiocb *req;
+		const struct io_uring_sqe *sqe;
+		struct sqe_submit s;
+
+		req = list_first_entry(&list, struct io_kiocb, list);
+		list_del_init(&req->list);
+
+		/* a re-armed or punted retry takes its own copy */
+		sqe = req->submit.sqe;
+		memcpy(&s, &req->submit, sizeof(s));
+		s.has_user = true;
+		__io_queue_sqe(ctx, req, &s);
+		kfree(sqe);
+	}
+	mutex_unlock(&ctx->uring_lock);
+	revert_creds(old_cred);
+}
+
+/*
+ * The ring owner didn't come back in time, retry from the workqueue
+ * like any other punted request.
+ */
+static void io_buf_retry_work(struct work_struct *work)
+{
+	struct io_ring_ctx *ctx = container_of(to_delayed_work(work),
+					       struct io_ring_ctx,
+					       buf_retry_work);
+	LIST_HEAD(list);
+
+	spin_lock_irq(&ctx->buf_retry_lock);
+	list_splice_init(&ctx->buf_retry_list, &list);
+	spin_unlock_irq(&ctx->buf_retry_lock);
+
+	while (!list_empty(&list)) {
+		struct io_kiocb *req;
+		struct async_list *async_list;
+
+		req = list_first_entry(&list, struct io_kiocb, list);
+		list_del_init(&req->list);
+
+		async_list = io_async_list_from_req(ctx, req);
+		if (async_list)
+			atomic_inc(&async_list->cnt);
+		INIT_WORK(&req->work, io_sq_wq_submit_work);
+		io_queue_async_work(ctx, req);
+	}
+}
+
 static int io_queue_sqe(struct io_ring_ctx *ctx, struct io_kiocb *req,
 			struct sqe_submit *s)
 {
@@ -2797,132 +3042,168 @@ static int io_submit_sqes(struct io_ring_ctx *ctx, unsigned int nr,
 	return submitted;
 }
 
+static void io_sq_thread_drop_mm(struct mm_struct **cur_mm)
+{
+	if (*cur_mm) {
+		unuse_mm(*cur_mm);
+		mmput(*cur_mm);
+		*cur_mm = NULL;
+	}
+}
+
+/*
+ * One pass of the SQ thread over @ctx. Returns true if the ring submitted
+ * something or still has polled IO in flight, so the thread should keep
+ * spinning instead of starting its idle period.
+ */
+static bool __io_sq_thread(struct io_ring_ctx *ctx, struct mm_struct **cur_mm)
+{
+	bool mm_fault = false;
+	unsigned int to_submit;
+
+	if (ctx->sq_inflight) {
+		unsigned nr_events = 0;
+
+		if (ctx->flags & IORING_SETUP_IOPOLL) {
+			/*
+			 * inflight is the count of the maximum possible
+			 * entries we submitted, but it can be smaller
+			 * if we dropped some of them. If we don't have
+			 * poll entries available, then we know that we
+			 * have nothing left to poll for. Reset the
+			 * inflight count to zero in that case.
+			 */
+			mutex_lock(&ctx->uring_lock);
+			if (!list_empty(&ctx->poll_list))
+				io_iopoll_getevents(ctx, &nr_events, 0);
+			else
+				ctx->sq_inflight = 0;
+			mutex_unlock(&ctx->uring_lock);
+		} else {
+			/*
+			 * Normal IO, just pretend everything completed.
+			 * We don't have to poll completions for that.
+			 */
+			nr_events = ctx->sq_inflight;
+		}
+
+		ctx->sq_inflight -= nr_events;
+	}
+
+	to_submit = io_sqring_entries(ctx);
+	if (!to_submit)
+		return ctx->sq_inflight != 0;
+
+	/*
+	 * Unless all new commands are FIXED regions, grab mm. Rings sharing
+	 * the thread may belong to different processes, switch if needed.
+	 */
+	if (*cur_mm != ctx->sqo_mm) {
+		io_sq_thread_drop_mm(cur_mm);
+		mm_fault = !mmget_not_zero(ctx->sqo_mm);
+		if (!mm_fault) {
+			use_mm(ctx->sqo_mm);
+			*cur_mm = ctx->sqo_mm;
+		}
+	}
+
+	to_submit = min(to_submit, ctx->sq_entries);
+	ctx->sq_inflight += io_submit_sqes(ctx, to_submit, *cur_mm != NULL,
+					   mm_fault);
+
+	/* Commit SQ ring head once we've consumed all SQEs */
+	io_commit_sqring(ctx);
+	return true;
+}
+
 static int io_sq_thread(void *data)
 {
-	struct io_ring_ctx *ctx = data;
+	struct io_sq_data *sqd = data;
 	struct mm_struct *cur_mm = NULL;
-	const struct cred *old_cred;
+	struct io_ring_ctx *ctx;
 	mm_segment_t old_fs;
 	DEFINE_WAIT(wait);
-	unsigned inflight;
 	unsigned long timeout;
 
-	complete(&ctx->sqo_thread_started);
+	complete(&sqd->started);
 
 	old_fs = get_fs();
 	set_fs(USER_DS);
-	old_cred = override_creds(ctx->creds);
 
-	timeout = inflight = 0;
+	timeout = 0;
 	while (!kthread_should_park()) {
-		bool mm_fault = false;
-		unsigned int to_submit;
+		unsigned long idle = 0;
+		bool busy = false;
 
-		if (inflight) {
-			unsigned nr_events = 0;
+		mutex_lock(&sqd->lock);
+		list_for_each_entry(ctx, &sqd->ctx_list, sqd_list) {
+			const struct cred *old_cred;
 
-			if (ctx->flags & IORING_SETUP_IOPOLL) {
-				/*
-				 * inflight is the count of the maximum possible
-				 * entries we submitted, but it can be smaller
-				 * if we dropped some of them. If we don't have
-				 * poll entries available, then we know that we
-				 * have nothing left to poll for. Reset the
-				 * inflight count to zero in that case.
-				 */
-				mutex_lock(&ctx->uring_lock);
-				if (!list_empty(&ctx->poll_list))
-					io_iopoll_getevents(ctx, &nr_events, 0);
-				else
-					inflight = 0;
-				mutex_unlock(&ctx->uring_lock);
-			} else {
-				/*
-				 * Normal IO, just pretend everything completed.
-				 * We don't have to poll completions for that.
-				 */
-				nr_events = inflight;
-			}
+			old_cred = override_creds(ctx->creds);
+			if (__io_sq_thread(ctx, &cur_mm))
+				busy = true;
+			revert_creds(old_cred);
 
-			inflight -= nr_events;
-			if (!inflight)
-				timeout = jiffies + ctx->sq_thread_idle;
+			idle = max_t(unsigned long, idle, ctx->sq_thread_idle);
 		}
 
-		to_submit = io_sqring_entries(ctx);
-		if (!to_submit) {
-			/*
-			 * Drop cur_mm before scheduling, we can't hold it for
-			 * long periods (or over schedule()). Do this before
-			 * adding ourselves to the waitqueue, as the unuse/drop
-			 * may sleep.
-			 */
-			if (cur_mm) {
-				unuse_mm(cur_mm);
-				mmput(cur_mm);
-				cur_mm = NULL;
-			}
+		if (busy) {
+			mutex_unlock(&sqd->lock);
+			timeout = jiffies + idle;
+			cond_resched();
+			continue;
+		}
 
-			/*
-			 * We're polling. If we're within the defined idle
-			 * period, then let us spin without work before going
-			 * to sleep.
-			 */
-			if (inflight || !time_after(jiffies, timeout)) {
-				cond_resched();
-				continue;
-			}
+		/*
+		 * Drop cur_mm before scheduling, we can't hold it for
+		 * long periods (or over schedule()). Do this before
+		 * adding ourselves to the waitqueue, as the unuse/drop
+		 * may sleep.
+		 */
+		io_sq_thread_drop_mm(&cur_mm);
 
-			prepare_to_wait(&ctx->sqo_wait, &wait,
-						TASK_INTERRUPTIBLE);
+		/*
+		 * We're polling. If we're within the defined idle
+		 * period, then let us spin without work before going
+		 * to sleep.
+		 */
+		if (!time_after(jiffies, timeout)) {
+			mutex_unlock(&sqd->lock);
+			cond_resched();
+			continue;
+		}
 
-			/* Tell userspace we may need a wakeup call */
-			ctx->rings->sq_flags |= IORING_SQ_NEED_WAKEUP;
-			/* make sure to read SQ tail after writing flags */
-			smp_mb();
+		prepare_to_wait(&sqd->wait, &wait, TASK_INTERRUPTIBLE);
 
-			to_submit = io_sqring_entries(ctx);
-			if (!to_submit) {
-				if (kthread_should_park()) {
-					finish_wait(&ctx->sqo_wait, &wait);
-					break;
-				}
-				if (signal_pending(current))
-					flush_signals(current);
-				schedule();
-				finish_wait(&ctx->sqo_wait, &wait);
+		/* Tell userspace we may need a wakeup call */
+		list_for_each_entry(ctx, &sqd->ctx_list, sqd_list)
+			ctx->rings->sq_flags |= IORING_SQ_NEED_WAKEUP;
+		/* make sure to read SQ tail after writing flags */
+		smp_mb();
 
-				ctx->rings->sq_flags &= ~IORING_SQ_NEED_WAKEUP;
-				continue;
+		list_for_each_entry(ctx, &sqd->ctx_list, sqd_list) {
+			if (io_sqring_entries(ctx)) {
+				busy = true;
+				break;
 			}
-			finish_wait(&ctx->sqo_wait, &wait);
-
-			ctx->rings->sq_flags &= ~IORING_SQ_NEED_WAKEUP;
 		}
+		mutex_unlock(&sqd->lock);
 
-		/* Unless all new commands are FIXED regions, grab mm */
-		if (!cur_mm) {
-			mm_fault = !mmget_not_zero(ctx->sqo_mm);
-			if (!mm_fault) {
-				use_mm(ctx->sqo_mm);
-				cur_mm = ctx->sqo_mm;
-			}
+		if (!busy && !kthread_should_park()) {
+			if (signal_pending(current))
+				flush_signals(current);
+			schedule();
 		}
+		finish_wait(&sqd->wait, &wait);
 
-		to_submit = min(to_submit, ctx->sq_entries);
-		inflight += io_submit_sqes(ctx, to_submit, cur_mm != NULL,
-					   mm_fault);
-
-		/* Commit SQ ring head once we've consumed all SQEs */
-		io_commit_sqring(ctx);
+		mutex_lock(&sqd->lock);
+		list_for_each_entry(ctx, &sqd->ctx_list, sqd_list)
+			ctx->rings->sq_flags &= ~IORING_SQ_NEED_WAKEUP;
+		mutex_unlock(&sqd->lock);
 	}
 
 	set_fs(old_fs);
-	if (cur_mm) {
-		unuse_mm(cur_mm);
-		mmput(cur_mm);
-	}
-	revert_creds(old_cred);
+	io_sq_thread_drop_mm(&cur_mm);
 
 	kthread_parkme();
 
@@ -3014,7 +3295,8 @@ static int io_wake_function(struct wait_queue_entry *curr, unsigned int mode,
 	struct io_wait_queue *iowq = container_of(curr, struct io_wait_queue,
 							wq);
 
-	if (!io_should_wake(iowq))
+	if (!io_should_wake(iowq) &&
+	    list_empty_careful(&iowq->ctx->buf_retry_list))
 		return -1;
 
 	return autoremove_wake_function(curr, mode, wake_flags, key);
@@ -3058,10 +3340,15 @@ static int io_cqring_wait(struct io_ring_ctx *ctx, int min_events,
 	ret = 0;
 	iowq.nr_timeouts = atomic_read(&ctx->cq_timeouts);
 	do {
+		io_run_buf_retries(ctx);
 		prepare_to_wait_exclusive(&ctx->wait, &iowq.wq,
 						TASK_INTERRUPTIBLE);
 		if (io_should_wake(&iowq))
 			break;
+		if (io_buf_retry_pending(ctx)) {
+			__set_current_state(TASK_RUNNING);
+			continue;
+		}
 		schedule();
 		if (signal_pending(current)) {
 			ret = -ERESTARTSYS;
@@ -3107,18 +3394,36 @@ static int io_sqe_files_unregister(struct io_ring_ctx *ctx)
 	return 0;
 }
 
-static void io_sq_thread_stop(struct io_ring_ctx *ctx)
+static void io_put_sq_data(struct io_sq_data *sqd)
 {
-	if (ctx->sqo_thread) {
-		wait_for_completion(&ctx->sqo_thread_started);
+	if (!refcount_dec_and_test(&sqd->refs))
+		return;
+
+	if (sqd->thread) {
+		wait_for_completion(&sqd->started);
 		/*
 		 * The park is a bit of a work-around, without it we get
 		 * warning spews on shutdown with SQPOLL set and affinity
 		 * set to a single CPU.
 		 */
-		kthread_park(ctx->sqo_thread);
-		kthread_stop(ctx->sqo_thread);
-		ctx->sqo_thread = NULL;
+		kthread_park(sqd->thread);
+		kthread_stop(sqd->thread);
+	}
+	kfree(sqd);
+}
+
+static void io_sq_thread_stop(struct io_ring_ctx *ctx)
+{
+	struct io_sq_data *sqd = ctx->sq_data;
+
+	if (sqd) {
+		mutex_lock(&sqd->lock);
+		list_del_init(&ctx->sqd_list);
+		mutex_unlock(&sqd->lock);
+
+		ctx->sqo_wait = &ctx->__sqo_wait;
+		ctx->sq_data = NULL;
+		io_put_sq_data(sqd);
 	}
 }
 
@@ -3290,6 +3595,52 @@ static int io_sqe_files_register(struct io_ring_ctx *ctx, void __user *arg,
 	return ret;
 }
 
+static struct io_sq_data *io_attach_sq_data(struct io_uring_params *p)
+{
+	struct io_ring_ctx *ctx_attach;
+	struct io_sq_data *sqd;
+	struct fd f;
+
+	f = fdget(p->wq_fd);
+	if (!f.file)
+		return ERR_PTR(-ENXIO);
+	if (f.file->f_op != &io_uring_fops) {
+		fdput(f);
+		return ERR_PTR(-EINVAL);
+	}
+
+	/* Holding the file keeps the ring, and so its sq_data, alive */
+	ctx_attach = f.file->private_data;
+	sqd = ctx_attach->sq_data;
+	if (!sqd) {
+		fdput(f);
+		return ERR_PTR(-EINVAL);
+	}
+
+	refcount_inc(&sqd->refs);
+	fdput(f);
+	return sqd;
+}
+
+static struct io_sq_data *io_get_sq_data(struct io_uring_params *p)
+{
+	struct io_sq_data *sqd;
+
+	if (p->flags & IORING_SETUP_ATTACH_WQ)
+		return io_attach_sq_data(p);
+
+	sqd = kzalloc(sizeof(*sqd), GFP_KERNEL);
+	if (!sqd)
+		return ERR_PTR(-ENOMEM);
+
+	refcount_set(&sqd->refs, 1);
+	mutex_init(&sqd->lock);
+	INIT_LIST_HEAD(&sqd->ctx_list);
+	init_waitqueue_head(&sqd->wait);
+	init_completion(&sqd->started);
+	return sqd;
+}
+
 static int io_sq_offload_start(struct io_ring_ctx *ctx,
 			       struct io_uring_params *p)
 {
@@ -3299,14 +3650,37 @@ static int io_sq_offload_start(struct io_ring_ctx *ctx,
 	ctx->sqo_mm = current->mm;
 
 	if (ctx->flags & IORING_SETUP_SQPOLL) {
+		struct io_sq_data *sqd;
+
 		ret = -EPERM;
 		if (!capable(CAP_SYS_ADMIN))
 			goto err;
 
+		sqd = io_get_sq_data(p);
+		if (IS_ERR(sqd)) {
+			ret = PTR_ERR(sqd);
+			goto err;
+		}
+		ctx->sq_data = sqd;
+		ctx->sqo_wait = &sqd->wait;
+
 		ctx->sq_thread_idle = msecs_to_jiffies(p->sq_thread_idle);
 		if (!ctx->sq_thread_idle)
 			ctx->sq_thread_idle = HZ;
 
+		mutex_lock(&sqd->lock);
+		list_add_tail(&ctx->sqd_list, &sqd->ctx_list);
+		mutex_unlock(&sqd->lock);
+
+		/*
+		 * An attached ring runs wherever the thread it joined runs,
+		 * SQ_AFF only applies to the ring that starts the thread.
+		 */
+		if (sqd->thread) {
+			wake_up(&sqd->wait);
+			goto alloc_wq;
+		}
+
 		if (p->flags & IORING_SETUP_SQ_AFF) {
 			int cpu = p->sq_thread_cpu;
 
@@ -3316,25 +3690,26 @@ static int io_sq_offload_start(struct io_ring_ctx *ctx,
 			if (!cpu_online(cpu))
 				goto err;
 
-			ctx->sqo_thread = kthread_create_on_cpu(io_sq_thread,
-							ctx, cpu,
+			sqd->thread = kthread_create_on_cpu(io_sq_thread,
+							sqd, cpu,
 							"io_uring-sq");
 		} else {
-			ctx->sqo_thread = kthread_create(io_sq_thread, ctx,
+			sqd->thread = kthread_create(io_sq_thread, sqd,
 							"io_uring-sq");
 		}
-		if (IS_ERR(ctx->sqo_thread)) {
-			ret = PTR_ERR(ctx->sqo_thread);
-			ctx->sqo_thread = NULL;
+		if (IS_ERR(sqd->thread)) {
+			ret = PTR_ERR(sqd->thread);
+			sqd->thread = NULL;
 			goto err;
 		}
-		wake_up_process(ctx->sqo_thread);
-	} else if (p->flags & IORING_SETUP_SQ_AFF) {
-		/* Can't have SQ_AFF without SQPOLL */
+		wake_up_process(sqd->thread);
+	} else if (p->flags & (IORING_SETUP_SQ_AFF | IORING_SETUP_ATTACH_WQ)) {
+		/* Can't have SQ_AFF or ATTACH_WQ without SQPOLL */
 		ret = -EINVAL;
 		goto err;
 	}
 
+alloc_wq:
 	/* Do QD, or 2 * CPUS, whatever is smallest */
 	ctx->sqo_wq[0] = alloc_workqueue("io_ring-wq",
 			WQ_UNBOUND | WQ_FREEZABLE,
@@ -3500,8 +3875,96 @@ static int io_copy_iov(struct io_ring_ctx *ctx, struct iovec *dst,
 	return 0;
 }
 
+/* Allocations above the device's limit before giving up on a page */
+#define IO_DMA_ALLOC_TRIES	8
+
+static struct page *io_new_dma_page(struct page *page, unsigned long dma_pfn)
+{
+	gfp_t gfp_mask = GFP_USER | __GFP_NOWARN;
+	struct page *new = NULL, *rej, *tmp;
+	LIST_HEAD(rejected);
+	int i;
+
+	/* migrate_pages() splits THPs when we can't give it a huge page */
+	if (PageTransHuge(page))
+		return NULL;
+
+	if (IS_ENABLED(CONFIG_ZONE_DMA32) &&
+	    dma_pfn <= PHYS_PFN(DMA_BIT_MASK(32)))
+		gfp_mask |= __GFP_DMA32;
+
+	/*
+	 * There is no zone for limits other than ZONE_DMA and ZONE_DMA32, so
+	 * take pages from the smallest zone that fits until one is low enough.
+	 */
+	for (i = 0; i < IO_DMA_ALLOC_TRIES; i++) {
+		new = alloc_page(gfp_mask);
+		if (!new || page_to_pfn(new) <= dma_pfn)
+			break;
+		list_add(&new->lru, &rejected);
+		new = NULL;
+	}
+
+	list_for_each_entry_safe(rej, tmp, &rejected, lru) {
+		list_del(&rej->lru);
+		__free_page(rej);
+	}
+	return new;
+}
+
+/*
+ * Move pinned pages the target device can't reach into memory below
+ * @dma_pfn, so IO on the registered buffer doesn't bounce through swiotlb
+ * every time. Called with mmap_sem held, like check_and_migrate_cma_pages().
+ * Returns the new number of pinned pages. Pages that can't be moved stay
+ * where they are and keep bouncing.
+ */
+static int io_buffer_migrate_dma(unsigned long ubuf, int nr_pages,
+				 struct page **pages,
+				 struct vm_area_struct **vmas,
+				 unsigned long dma_pfn)
+{
+	LIST_HEAD(migrate_list);
+	bool drained = false;
+	int i;
+
+	for (i = 0; i < nr_pages; i++) {
+		struct page *head = compound_head(pages[i]);
+
+		if (page_to_pfn(pages[i]) <= dma_pfn || PageHuge(head))
+			continue;
+
+		if (!PageLRU(head) && !drained) {
+			lru_add_drain_all();
+			drained = true;
+		}
+		if (isolate_lru_page(head))
+			continue;
+
+		list_add_tail(&head->lru, &migrate_list);
+		mod_node_page_state(page_pgdat(head),
+				    NR_ISOLATED_ANON + page_is_file_cache(head),
+				    hpage_nr_pages(head));
+	}
+
+	if (list_empty(&migrate_list))
+		return nr_pages;
+
+	put_user_pages(pages, nr_pages);
+	if (migrate_pages(&migrate_list, io_new_dma_page, NULL, dma_pfn,
+			  MIGRATE_SYNC, MR_CONTIG_RANGE))
+		putback_movable_pages(&migrate_list);
+
+	return get_user_pages(ubuf, nr_pages, FOLL_WRITE | FOLL_LONGTERM,
+			      pages, vmas);
+}
+
+/*
+ * Buffers registered with a nonzero @dma_pfn get their pages moved below
+ * it when needed, see io_buffer_migrate_dma().
+ */
 static int io_sqe_buffer_register(struct io_ring_ctx *ctx, void __user *arg,
-				  unsigned nr_args)
+				  unsigned nr_args, unsigned long dma_pfn)
 {
 	struct vm_area_struct **vmas = NULL;
 	struct page **pages = NULL;
@@ -3599,6 +4062,12 @@ static int io_sqe_buffer_register(struct io_ring_ctx *ctx, void __user *arg,
 		} else {
 			ret = pret < 0 ? pret : -EFAULT;
 		}
+		if (!ret && dma_pfn) {
+			pret = io_buffer_migrate_dma(ubuf, nr_pages, pages,
+						     vmas, dma_pfn);
+			if (pret != nr_pages)
+				ret = pret < 0 ? pret : -EFAULT;
+		}
 		up_read(&current->mm->mmap_sem);
 		if (ret) {
 			/*
@@ -3642,6 +4111,63 @@ static int io_sqe_buffer_register(struct io_ring_ctx *ctx, void __user *arg,
 	return ret;
 }
 
+/*
+ * Find the highest pfn the controller behind @fd can DMA to. @fd is a block
+ * device or a file on a filesystem that lives on one.
+ */
+static int io_buffer_dma_limit(int fd, unsigned long *dma_pfn)
+{
+	struct block_device *bdev;
+	struct device *dev;
+	struct inode *inode;
+	struct fd f;
+	int ret = -ENODEV;
+
+	f = fdget(fd);
+	if (!f.file)
+		return -EBADF;
+
+	inode = file_inode(f.file);
+	if (S_ISBLK(inode->i_mode))
+		bdev = I_BDEV(f.file->f_mapping->host);
+	else
+		bdev = inode->i_sb->s_bdev;
+	if (!bdev || !bdev->bd_disk)
+		goto out;
+
+	/* The disk itself doesn't do DMA, its controller does */
+	for (dev = disk_to_dev(bdev->bd_disk); dev; dev = dev->parent) {
+		if (dev->dma_mask) {
+			*dma_pfn = PHYS_PFN(dma_get_mask(dev));
+			ret = 0;
+			break;
+		}
+	}
+out:
+	fdput(f);
+	return ret;
+}
+
+static int io_sqe_buffer_register_dma(struct io_ring_ctx *ctx,
+				      void __user *arg)
+{
+	struct io_uring_buffers_dma reg;
+	unsigned long dma_pfn;
+	int ret;
+
+	if (copy_from_user(&reg, arg, sizeof(reg)))
+		return -EFAULT;
+	if (reg.resv[0] || reg.resv[1])
+		return -EINVAL;
+
+	ret = io_buffer_dma_limit(reg.fd, &dma_pfn);
+	if (ret)
+		return ret;
+
+	return io_sqe_buffer_register(ctx, u64_to_user_ptr(reg.iovecs),
+				      reg.nr, dma_pfn);
+}
+
 static int io_eventfd_register(struct io_ring_ctx *ctx, void __user *arg)
 {
 	__s32 __user *fds = arg;
@@ -3676,6 +4202,7 @@ static int io_eventfd_unregister(struct io_ring_ctx *ctx)
 
 static void io_ring_ctx_free(struct io_ring_ctx *ctx)
 {
+	cancel_delayed_work_sync(&ctx->buf_retry_work);
 	io_finish_async(ctx);
 	if (ctx->sqo_mm)
 		mmdrop(ctx->sqo_mm);
@@ -3855,7 +4382,7 @@ SYSCALL_DEFINE6(io_uring_enter, unsigned int, fd, u32, to_submit,
 	ret = 0;
 	if (ctx->flags & IORING_SETUP_SQPOLL) {
 		if (flags & IORING_ENTER_SQ_WAKEUP)
-			wake_up(&ctx->sqo_wait);
+			wake_up(ctx->sqo_wait);
 		submitted = to_submit;
 	} else if (to_submit) {
 		to_submit = min(to_submit, ctx->sq_entries);
@@ -3867,6 +4394,7 @@ SYSCALL_DEFINE6(io_uring_enter, unsigned int, fd, u32, to_submit,
 		if (submitted != to_submit)
 			goto out;
 	}
+	io_run_buf_retries(ctx);
 	if (flags & IORING_ENTER_GETEVENTS) {
 		unsigned nr_events = 0;
 
@@ -4090,7 +4618,7 @@ static long io_uring_setup(u32 entries, struct io_uring_params __user *params)
 	}
 
 	if (p.flags & ~(IORING_SETUP_IOPOLL | IORING_SETUP_SQPOLL |
-			IORING_SETUP_SQ_AFF))
+			IORING_SETUP_SQ_AFF | IORING_SETUP_ATTACH_WQ))
 		return -EINVAL;
 
 	ret = io_uring_create(entries, &p);
@@ -4139,7 +4667,7 @@ static int __io_uring_register(struct io_ring_ctx *ctx, unsigned opcode,
 
 	switch (opcode) {
 	case IORING_REGISTER_BUFFERS:
-		ret = io_sqe_buffer_register(ctx, arg, nr_args);
+		ret = io_sqe_buffer_register(ctx, arg, nr_args, 0);
 		break;
 	case IORING_UNREGISTER_BUFFERS:
 		ret = -EINVAL;
@@ -4168,6 +4696,12 @@ static int __io_uring_register(struct io_ring_ctx *ctx, unsigned opcode,
 			break;
 		ret = io_eventfd_unregister(ctx);
 		break;
+	case IORING_REGISTER_BUFFERS_DMA:
+		ret = -EINVAL;
+		if (nr_args != 1)
+			break;
+		ret = io_sqe_buffer_register_dma(ctx, arg);
+		break;
 	default:
 		ret = -EINVAL;
 		break;
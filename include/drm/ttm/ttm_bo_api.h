@@ -239,6 +239,7 @@ struct ttm_buffer_object {
  * @virtual: The current kernel virtual address.
  * @page: The page when kmap'ing a single page.
  * @bo_kmap_type: Type of bo_kmap.
+ * @num_pages: The number of pages mapped by a transient vm_map_ram.
  *
  * Object describing a kernel mapping. Since a TTM bo may be located
  * in various memory types with various caching policies, the
@@ -255,7 +256,9 @@ struct ttm_bo_kmap_obj {
 		ttm_bo_map_vmap         = 2,
 		ttm_bo_map_kmap         = 3,
 		ttm_bo_map_premapped    = 4 | TTM_BO_MAP_IOMEM_MASK,
+		ttm_bo_map_vm_ram       = 5,
 	} bo_kmap_type;
+	unsigned long num_pages;
 	struct ttm_buffer_object *bo;
 };
 
@@ -700,6 +703,27 @@ static inline void *ttm_kmap_obj_virtual(struct ttm_bo_kmap_obj *map,
 int ttm_bo_kmap(struct ttm_buffer_object *bo, unsigned long start_page,
 		unsigned long num_pages, struct ttm_bo_kmap_obj *map);
 
+/**
+ * ttm_bo_kmap_transient
+ *
+ * @bo: The buffer object.
+ * @start_page: The first page to map.
+ * @num_pages: Number of pages to map.
+ * @map: pointer to a struct ttm_bo_kmap_obj representing the map.
+ *
+ * Like ttm_bo_kmap, but for mappings that are torn down again right away.
+ * Multi-page or non-cached system memory is mapped with vm_map_ram instead
+ * of vmap, which avoids a global TLB flush on unmap. Don't keep these
+ * mappings around, they pin the per-CPU vmap blocks they come from.
+ *
+ * Returns
+ * -ENOMEM: Out of memory.
+ * -EINVAL: Invalid range.
+ */
+int ttm_bo_kmap_transient(struct ttm_buffer_object *bo,
+			  unsigned long start_page, unsigned long num_pages,
+			  struct ttm_bo_kmap_obj *map);
+
 /**
  * ttm_bo_kunmap
  *
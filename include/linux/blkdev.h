@@ -159,14 +159,15 @@ struct request {
 
 	/*
 	 * The hash is used inside the scheduler, and killed once the
-	 * request reaches the dispatch list. The ipi_list is only used
-	 * to queue the request for softirq completion, which is long
-	 * after the request has been unhashed (and even removed from
-	 * the dispatch list).
+	 * request reaches the dispatch list. The ipi_list and ipi_llist
+	 * are only used to queue the request for softirq completion, which
+	 * is long after the request has been unhashed (and even removed
+	 * from the dispatch list).
 	 */
 	union {
 		struct hlist_node hash;	/* merge hash */
 		struct list_head ipi_list;
+		struct llist_node ipi_llist;
 	};
 
 	/*
@@ -14,10 +14,15 @@
  */
 #define FRONTSWAP_PAGES_UNUSED	2
 
+/* Most pages passed to one frontswap_load_batch() call */
+#define FRONTSWAP_LOAD_BATCH	16
+
 struct frontswap_ops {
 	void (*init)(unsigned); /* this swap type was just swapon'ed */
 	int (*store)(unsigned, pgoff_t, struct page *); /* store a page */
 	int (*load)(unsigned, pgoff_t, struct page *); /* load a page */
+	/* optional: load several pages of one swap type, ret[i] as load() */
+	void (*load_batch)(unsigned, pgoff_t *, struct page **, int *, int);
 	void (*invalidate_page)(unsigned, pgoff_t); /* page no longer needed */
 	void (*invalidate_area)(unsigned); /* swap type just swapoff'ed */
 	struct frontswap_ops *next; /* private pointer to next ops */
@@ -34,6 +39,7 @@ extern bool __frontswap_test(struct swap_info_struct *, pgoff_t);
 extern void __frontswap_init(unsigned type, unsigned long *map);
 extern int __frontswap_store(struct page *page);
 extern int __frontswap_load(struct page *page);
+extern void __frontswap_load_batch(struct page **pages, int *ret, int nr);
 extern void __frontswap_invalidate_page(unsigned, pgoff_t);
 extern void __frontswap_invalidate_area(unsigned);
 
@@ -100,6 +106,23 @@ static inline int frontswap_load(struct page *page)
 	return -1;
 }
 
+/*
+ * Like frontswap_load() on each of up to FRONTSWAP_LOAD_BATCH locked swap
+ * cache pages that all belong to the same swap type.
+ */
+static inline void frontswap_load_batch(struct page **pages, int *ret, int nr)
+{
+	int i;
+
+	if (frontswap_enabled()) {
+		__frontswap_load_batch(pages, ret, nr);
+		return;
+	}
+
+	for (i = 0; i < nr; i++)
+		ret[i] = -1;
+}
+
 static inline void frontswap_invalidate_page(unsigned type, pgoff_t offset)
 {
 	if (frontswap_enabled())
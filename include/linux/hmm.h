@@ -350,6 +350,20 @@ struct hmm_mirror_ops {
 	int (*sync_cpu_device_pagetables)(
 		struct hmm_mirror *mirror,
 		const struct mmu_notifier_range *update);
+
+	/* range_busy() - is the device still accessing a range
+	 *
+	 * @mirror: pointer to struct hmm_mirror
+	 * @start: start address of the range
+	 * @end: end address of the range (exclusive)
+	 * Return: true if an invalidation of the range would have to wait
+	 * for the device.
+	 *
+	 * Optional. Called without blocking before khugepaged collapses a
+	 * range, see mmu_notifier_ops.range_busy.
+	 */
+	bool (*range_busy)(struct hmm_mirror *mirror,
+			   unsigned long start, unsigned long end);
 };
 
 /*
@@ -78,6 +78,7 @@ static inline void totalram_pages_set(long val)
 
 extern void * high_memory;
 extern int page_cluster;
+extern int sysctl_lru_refault_balance;
 
 #ifdef CONFIG_SYSCTL
 extern int sysctl_legacy_va_layout;
@@ -2253,6 +2254,9 @@ extern int min_free_kbytes;
 extern int watermark_boost_factor;
 extern int watermark_scale_factor;
 
+/* vmscan.c */
+extern int kswapd_threads;
+
 /* nommu.c */
 extern atomic_long_t mmap_pages_allocated;
 extern int nommu_shrink_inode_mappings(struct inode *, size_t, size_t);
@@ -78,6 +78,7 @@ struct sched_domain {
 	unsigned int busy_factor;	/* less balancing by factor if busy */
 	unsigned int imbalance_pct;	/* No balance until over watermark */
 	unsigned int cache_nice_tries;	/* Leave cache hot tasks for # tries */
+	unsigned int migration_cost;	/* Cache hot window for migrations, ns */
 
 	int nohz_idle;			/* NOHZ IDLE status */
 	int flags;			/* See SD_* */
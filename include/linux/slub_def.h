@@ -36,6 +36,8 @@ enum stat_item {
 	CPU_PARTIAL_FREE,	/* Refill cpu partial on free */
 	CPU_PARTIAL_NODE,	/* Refill cpu partial from node partial */
 	CPU_PARTIAL_DRAIN,	/* Drain cpu partial to node partial */
+	CLUSTER_PARTIAL_PUT,	/* Drain cpu partial to cluster partial */
+	CLUSTER_PARTIAL_ALLOC,	/* Refill cpu partial from cluster partial */
 	NR_SLUB_STAT_ITEMS };
 
 struct kmem_cache_cpu {
@@ -67,6 +69,21 @@ struct kmem_cache_cpu {
 #define slub_percpu_partial_read_once(c)	NULL
 #endif // CONFIG_SLUB_CPU_PARTIAL
 
+#ifdef CONFIG_SLUB_CLUSTER_PARTIAL
+#define SLUB_CLUSTER_BATCHES	2
+
+/*
+ * Frozen cpu partial lists handed back by the CPUs of one cache-sharing
+ * cluster, for any of them to adopt. Only the slot of the cluster's first
+ * CPU is used.
+ */
+struct kmem_cache_cluster {
+	spinlock_t lock;
+	unsigned int nr;
+	struct page *batch[SLUB_CLUSTER_BATCHES];
+};
+#endif
+
 /*
  * Word size structure that can be atomically updated or read and that
  * contains both the order and the number of objects that a slab of the
@@ -81,6 +98,9 @@ struct kmem_cache_order_objects {
  */
 struct kmem_cache {
 	struct kmem_cache_cpu __percpu *cpu_slab;
+#ifdef CONFIG_SLUB_CLUSTER_PARTIAL
+	struct kmem_cache_cluster __percpu *cluster;
+#endif
 	/* Used for retrieving partial slabs, etc. */
 	slab_flags_t flags;
 	unsigned long min_partial;
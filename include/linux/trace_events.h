@@ -341,6 +341,7 @@ enum {
 	EVENT_FILE_FL_TRIGGER_COND_BIT,
 	EVENT_FILE_FL_PID_FILTER_BIT,
 	EVENT_FILE_FL_WAS_ENABLED_BIT,
+	EVENT_FILE_FL_SAMPLED_BIT,
 };
 
 /*
@@ -357,6 +358,7 @@ enum {
  *  TRIGGER_COND  - When set, one or more triggers has an associated filter
  *  PID_FILTER    - When set, the event is filtered based on pid
  *  WAS_ENABLED   - Set when enabled to know to clear trace on module removal
+ *  SAMPLED       - When set, only one in sample_ratio hits per cpu is traced
  */
 enum {
 	EVENT_FILE_FL_ENABLED		= (1 << EVENT_FILE_FL_ENABLED_BIT),
@@ -370,6 +372,7 @@ enum {
 	EVENT_FILE_FL_TRIGGER_COND	= (1 << EVENT_FILE_FL_TRIGGER_COND_BIT),
 	EVENT_FILE_FL_PID_FILTER	= (1 << EVENT_FILE_FL_PID_FILTER_BIT),
 	EVENT_FILE_FL_WAS_ENABLED	= (1 << EVENT_FILE_FL_WAS_ENABLED_BIT),
+	EVENT_FILE_FL_SAMPLED		= (1 << EVENT_FILE_FL_SAMPLED_BIT),
 };
 
 struct trace_event_file {
@@ -400,6 +403,8 @@ struct trace_event_file {
 	unsigned long		flags;
 	atomic_t		sm_ref;	/* soft-mode reference counter */
 	atomic_t		tm_ref;	/* trigger-mode reference counter */
+	unsigned int		sample_ratio;
+	unsigned int __percpu	*sample_count;
 };
 
 #define __TRACE_EVENT_FLAGS(name, value)				\
@@ -447,6 +452,7 @@ event_triggers_post_call(struct trace_event_file *file,
 			 enum event_trigger_type tt);
 
 bool trace_event_ignore_this_pid(struct trace_event_file *trace_file);
+bool trace_event_sample_skip(struct trace_event_file *trace_file);
 
 /**
  * trace_trigger_soft_disabled - do triggers and test if soft disabled
@@ -454,8 +460,8 @@ bool trace_event_ignore_this_pid(struct trace_event_file *trace_file);
  *
  * If any triggers without filters are attached to this event, they
  * will be called here. If the event is soft disabled and has no
- * triggers that require testing the fields, it will return true,
- * otherwise false.
+ * triggers that require testing the fields, or this hit is dropped by
+ * sampling, it will return true, otherwise false.
  */
 static inline bool
 trace_trigger_soft_disabled(struct trace_event_file *file)
@@ -467,9 +473,12 @@ trace_trigger_soft_disabled(struct trace_event_file *file)
 			event_triggers_call(file, NULL, NULL);
 		if (eflags & EVENT_FILE_FL_SOFT_DISABLED)
 			return true;
-		if (eflags & EVENT_FILE_FL_PID_FILTER)
-			return trace_event_ignore_this_pid(file);
+		if (eflags & EVENT_FILE_FL_PID_FILTER &&
+		    trace_event_ignore_this_pid(file))
+			return true;
 	}
+	if (eflags & EVENT_FILE_FL_SAMPLED)
+		return trace_event_sample_skip(file);
 	return false;
 }
 
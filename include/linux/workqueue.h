@@ -129,6 +129,14 @@ struct rcu_work {
 	struct workqueue_struct *wq;
 };
 
+/* affinity scopes of unbound workqueues, see workqueue_attrs->affn_scope */
+enum wq_affn_scope {
+	WQ_AFFN_NUMA,			/* a pool per NUMA node */
+	WQ_AFFN_CACHE,			/* a pool per LLC sharing group */
+
+	WQ_AFFN_NR_SCOPES,
+};
+
 /**
  * struct workqueue_attrs - A struct for workqueue attributes.
  *
@@ -153,6 +161,15 @@ struct workqueue_attrs {
 	 * doesn't participate in pool hash calculations or equality comparisons.
 	 */
 	bool no_numa;
+
+	/**
+	 * @affn_scope: unbound pool affinity scope
+	 *
+	 * Like ``no_numa``, this only modifies how :c:func:`apply_workqueue_attrs`
+	 * maps CPUs to pools. ``WQ_AFFN_CACHE`` creates a pool for each group
+	 * of CPUs sharing the last level cache instead of each NUMA node.
+	 */
+	enum wq_affn_scope affn_scope;
 };
 
 static inline struct delayed_work *to_delayed_work(struct work_struct *work)
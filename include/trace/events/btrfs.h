@@ -37,6 +37,10 @@ TRACE_DEFINE_ENUM(FLUSH_DELALLOC);
 TRACE_DEFINE_ENUM(FLUSH_DELALLOC_WAIT);
 TRACE_DEFINE_ENUM(ALLOC_CHUNK);
 TRACE_DEFINE_ENUM(COMMIT_TRANS);
+TRACE_DEFINE_ENUM(BTRFS_COMPRESS_SKIP);
+TRACE_DEFINE_ENUM(BTRFS_COMPRESS_REJECT);
+TRACE_DEFINE_ENUM(BTRFS_COMPRESS_MISS);
+TRACE_DEFINE_ENUM(BTRFS_COMPRESS_HIT);
 
 #define show_ref_type(type)						\
 	__print_symbolic(type,						\
@@ -647,6 +651,48 @@ TRACE_EVENT(btrfs_writepage_end_io_hook,
 		  __entry->end, __entry->uptodate)
 );
 
+#define show_compress_decision(decision)				\
+	__print_symbolic(decision,					\
+		{ BTRFS_COMPRESS_SKIP,		"SKIP"		},	\
+		{ BTRFS_COMPRESS_REJECT,	"REJECT"	},	\
+		{ BTRFS_COMPRESS_MISS,		"MISS"		},	\
+		{ BTRFS_COMPRESS_HIT,		"HIT"		})
+
+TRACE_EVENT(btrfs_compress_decision,
+
+	TP_PROTO(const struct btrfs_inode *inode, u64 start, u64 len,
+		 int decision, u64 compressed),
+
+	TP_ARGS(inode, start, len, decision, compressed),
+
+	TP_STRUCT__entry_btrfs(
+		__field(	u64,	root_objectid	)
+		__field(	u64,	ino		)
+		__field(	u64,	start		)
+		__field(	u64,	len		)
+		__field(	u64,	compressed	)
+		__field(	int,	decision	)
+		__field(	unsigned int, misses	)
+	),
+
+	TP_fast_assign_btrfs(inode->root->fs_info,
+		__entry->root_objectid	= inode->root->root_key.objectid;
+		__entry->ino		= btrfs_ino(inode);
+		__entry->start		= start;
+		__entry->len		= len;
+		__entry->compressed	= compressed;
+		__entry->decision	= decision;
+		__entry->misses		= inode->compress_misses;
+	),
+
+	TP_printk_btrfs("root=%llu(%s) ino=%llu start=%llu len=%llu "
+		  "decision=%s compressed=%llu misses=%u",
+		  show_root_type(__entry->root_objectid),
+		  __entry->ino, __entry->start, __entry->len,
+		  show_compress_decision(__entry->decision),
+		  __entry->compressed, __entry->misses)
+);
+
 TRACE_EVENT(btrfs_sync_file,
 
 	TP_PROTO(const struct file *file, int datasync),
@@ -198,6 +198,11 @@ union drm_amdgpu_bo_list {
 #define AMDGPU_CTX_OP_FREE_CTX	2
 #define AMDGPU_CTX_OP_QUERY_STATE	3
 #define AMDGPU_CTX_OP_QUERY_STATE2	4
+/*
+ * Specific to the PS4 kernel, numbered well clear of the upstream ops. Other
+ * kernels fail it with -EINVAL, which is how userspace detects support.
+ */
+#define AMDGPU_CTX_OP_GET_SEQNO_PAGE	0x80
 
 /* GPU reset status */
 #define AMDGPU_CTX_NO_RESET		0
@@ -218,6 +223,17 @@ union drm_amdgpu_bo_list {
 #define AMDGPU_CTX_QUERY2_FLAGS_RAS_CE   (1<<3)
 #define AMDGPU_CTX_QUERY2_FLAGS_RAS_UE   (1<<4)
 
+/*
+ * AMDGPU_CTX_OP_GET_SEQNO_PAGE returns a GEM handle to a page holding one
+ * __u64 per (ip, ring) pair of the context. The kernel stores there the
+ * sequence number of the newest completed submission, so a submission whose
+ * AMDGPU_CS handle is seq has finished once the slot reads >= seq. The page
+ * is only a hint for polling; errors must still be checked with
+ * AMDGPU_WAIT_CS and writes from userspace are never trusted by the kernel.
+ */
+#define AMDGPU_CTX_SEQNO_RINGS		4
+#define AMDGPU_CTX_SEQNO_SLOT(ip, ring)	((ip) * AMDGPU_CTX_SEQNO_RINGS + (ring))
+
 /* Context priority level */
 #define AMDGPU_CTX_PRIORITY_UNSET       -2048
 #define AMDGPU_CTX_PRIORITY_VERY_LOW    -1023
@@ -254,6 +270,12 @@ union drm_amdgpu_ctx_out {
 			/** Reset status since the last call of the ioctl. */
 			__u32	reset_status;
 		} state;
+
+		struct {
+			/** GEM handle of the seqno page */
+			__u32	handle;
+			__u32	_pad;
+		} seqno_page;
 };
 
 union drm_amdgpu_ctx {
@@ -539,6 +561,11 @@ struct drm_amdgpu_gem_va {
 #define AMDGPU_CHUNK_ID_SCHEDULED_DEPENDENCIES	0x07
 #define AMDGPU_CHUNK_ID_SYNCOBJ_TIMELINE_WAIT    0x08
 #define AMDGPU_CHUNK_ID_SYNCOBJ_TIMELINE_SIGNAL  0x09
+/*
+ * Specific to the PS4 kernel, numbered well clear of the upstream chunk IDs.
+ * Other kernels fail the submission with -EINVAL.
+ */
+#define AMDGPU_CHUNK_ID_DEADLINE	0x80
 
 struct drm_amdgpu_cs_chunk {
 	__u32		chunk_id;
@@ -615,6 +642,11 @@ struct drm_amdgpu_cs_chunk_fence {
 	__u32 offset;
 };
 
+struct drm_amdgpu_cs_chunk_deadline {
+	/** CLOCK_MONOTONIC time in ns by which the job should complete */
+	__u64 deadline_ns;
+};
+
 struct drm_amdgpu_cs_chunk_sem {
 	__u32 handle;
 };
@@ -21,6 +21,11 @@
 #define FUTEX_WAKE_BITSET	10
 #define FUTEX_WAIT_REQUEUE_PI	11
 #define FUTEX_CMP_REQUEUE_PI	12
+/*
+ * Specific to the PS4 kernel, numbered well clear of the upstream operations
+ * (13 is FUTEX_LOCK_PI2 upstream).
+ */
+#define FUTEX_WAIT_MULTIPLE	31
 
 #define FUTEX_PRIVATE_FLAG	128
 #define FUTEX_CLOCK_REALTIME	256
@@ -40,6 +45,25 @@
 					 FUTEX_PRIVATE_FLAG)
 #define FUTEX_CMP_REQUEUE_PI_PRIVATE	(FUTEX_CMP_REQUEUE_PI | \
 					 FUTEX_PRIVATE_FLAG)
+#define FUTEX_WAIT_MULTIPLE_PRIVATE	(FUTEX_WAIT_MULTIPLE | \
+					 FUTEX_PRIVATE_FLAG)
+
+/*
+ * FUTEX_WAIT_MULTIPLE: uaddr points to an array of val entries of
+ * struct futex_wait_block. The caller sleeps until any of the futexes is
+ * woken, and the index of that entry is returned. If any uaddr does not
+ * hold its val, -EWOULDBLOCK is returned without sleeping. The timeout is
+ * relative, as for FUTEX_WAIT.
+ *
+ * The layout is the same for 32 and 64 bit callers.
+ */
+#define FUTEX_MULTIPLE_MAX_COUNT	128
+
+struct futex_wait_block {
+	__u64 uaddr;
+	__u32 val;
+	__u32 bitset;
+};
 
 /*
  * Support for robust futexes: the kernel cleans up held futexes at
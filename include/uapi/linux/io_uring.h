@@ -50,6 +50,7 @@ struct io_uring_sqe {
 #define IORING_SETUP_IOPOLL	(1U << 0)	/* io_context is polled */
 #define IORING_SETUP_SQPOLL	(1U << 1)	/* SQ poll thread */
 #define IORING_SETUP_SQ_AFF	(1U << 2)	/* sq_thread_cpu is valid */
+#define IORING_SETUP_ATTACH_WQ	(1U << 5)	/* attach to existing sq thread */
 
 #define IORING_OP_NOP		0
 #define IORING_OP_READV		1
@@ -131,7 +132,8 @@ struct io_uring_params {
 	__u32 sq_thread_cpu;
 	__u32 sq_thread_idle;
 	__u32 features;
-	__u32 resv[4];
+	__u32 wq_fd;
+	__u32 resv[3];
 	struct io_sqring_offsets sq_off;
 	struct io_cqring_offsets cq_off;
 };
@@ -151,4 +153,22 @@ struct io_uring_params {
 #define IORING_REGISTER_EVENTFD		4
 #define IORING_UNREGISTER_EVENTFD	5
 
+/*
+ * Specific to the PS4 kernel, numbered well clear of the upstream opcodes
+ * (6 is IORING_REGISTER_FILES_UPDATE upstream).
+ */
+#define IORING_REGISTER_BUFFERS_DMA	128
+
+/*
+ * Argument for IORING_REGISTER_BUFFERS_DMA: register buffers like
+ * IORING_REGISTER_BUFFERS, moving their pages into memory that the
+ * controller behind fd can reach
+ */
+struct io_uring_buffers_dma {
+	__u64 iovecs;		/* pointer to struct iovec array */
+	__u32 nr;		/* number of iovecs */
+	__s32 fd;		/* block device, or file on one */
+	__u64 resv[2];
+};
+
 #endif
@@ -347,6 +347,12 @@ struct kfd_ioctl_acquire_vm_args {
 #define KFD_IOC_ALLOC_MEM_FLAGS_NO_SUBSTITUTE	(1 << 28)
 #define KFD_IOC_ALLOC_MEM_FLAGS_AQL_QUEUE_MEM	(1 << 27)
 #define KFD_IOC_ALLOC_MEM_FLAGS_COHERENT	(1 << 26)
+/*
+ * Specific to the PS4 kernel and kept clear of the bits upstream allocates
+ * from either end. Supported when the GPU topology node reports
+ * "mirror_alloc 1".
+ */
+#define KFD_IOC_ALLOC_MEM_FLAGS_MIRROR		(1 << 16)
 
 /* Allocate memory for later SVM (shared virtual memory) mapping.
  *
@@ -359,6 +365,11 @@ struct kfd_ioctl_acquire_vm_args {
  *               for userptrs this is overloaded to specify the CPU address
  * @gpu_id:      device identifier
  * @flags:       memory type and attributes. See KFD_IOC_ALLOC_MEM_FLAGS above
+ *
+ * A USERPTR allocation with the MIRROR flag must have @va_addr equal to the
+ * CPU address. It is mapped on @gpu_id before the ioctl returns, so GPU code
+ * can dereference CPU pointers into the range as they are. CPU page table
+ * changes are picked up through the usual userptr eviction and restore.
  */
 struct kfd_ioctl_alloc_memory_of_gpu_args {
 	__u64 va_addr;		/* to KFD */
@@ -8,6 +8,12 @@
 #define MFD_CLOEXEC		0x0001U
 #define MFD_ALLOW_SEALING	0x0002U
 #define MFD_HUGETLB		0x0004U
+/*
+ * Back the shmem file with transparent huge pages where possible. This flag
+ * is specific to the PS4 kernel; it sits above the bits upstream uses for
+ * memfd_create(2) flags so it cannot be mistaken for one of them.
+ */
+#define MFD_HUGEPAGE		0x0100U
 
 /*
  * Huge page size encoding when MFD_HUGETLB is specified, and a huge page
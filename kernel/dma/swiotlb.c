@@ -29,6 +29,7 @@
 #include <linux/swiotlb.h>
 #include <linux/pfn.h>
 #include <linux/types.h>
+#include <linux/log2.h>
 #include <linux/ctype.h>
 #include <linux/highmem.h>
 #include <linux/gfp.h>
@@ -69,6 +70,9 @@ enum swiotlb_force swiotlb_force;
  * API.
  */
 phys_addr_t io_tlb_start, io_tlb_end;
+/* For is_swiotlb_buffer() in drivers accounting their bounced traffic */
+EXPORT_SYMBOL_GPL(io_tlb_start);
+EXPORT_SYMBOL_GPL(io_tlb_end);
 
 /*
  * The number of IO TLB blocks (in groups of 64) between io_tlb_start and
@@ -76,17 +80,29 @@ phys_addr_t io_tlb_start, io_tlb_end;
  */
 static unsigned long io_tlb_nslabs;
 
-/*
- * The number of used IO TLB block
- */
-static unsigned long io_tlb_used;
-
 /*
  * This is a free list describing the number of free entries available from
  * each index
  */
 static unsigned int *io_tlb_list;
-static unsigned int io_tlb_index;
+
+/*
+ * The pool is split into up to IO_TLB_MAX_AREAS equally sized areas, each a
+ * multiple of IO_TLB_SEGSIZE slabs and with its own lock, so that devices
+ * bouncing on different CPUs don't all serialize on one spinlock. A mapping
+ * is first tried in the area of the current CPU, then in the others.
+ */
+#define IO_TLB_MAX_AREAS 8
+
+struct io_tlb_area {
+	spinlock_t lock;
+	unsigned int index;	/* next slab to search from */
+	unsigned long used;	/* slabs in use */
+} ____cacheline_aligned_in_smp;
+
+static struct io_tlb_area io_tlb_areas[IO_TLB_MAX_AREAS];
+static unsigned int io_tlb_nareas = 1;
+static unsigned long io_tlb_area_nslabs;
 
 /*
  * Max segment that we can provide which (if pages are contingous) will
@@ -101,12 +117,13 @@ unsigned int max_segment;
 #define INVALID_PHYS_ADDR (~(phys_addr_t)0)
 static phys_addr_t *io_tlb_orig_addr;
 
+static int late_alloc;
+
 /*
- * Protect the above data structures in the map and unmap calls
+ * Bytes copied between original buffers and the bounce buffers, to tell how
+ * much of a device's DMA traffic is paying for a memcpy.
  */
-static DEFINE_SPINLOCK(io_tlb_lock);
-
-static int late_alloc;
+static atomic_long_t io_tlb_bounced_bytes = ATOMIC_LONG_INIT(0);
 
 static int __init
 setup_io_tlb_npages(char *str)
@@ -197,6 +214,34 @@ void __init swiotlb_update_mem_attributes(void)
 	memset(vaddr, 0, bytes);
 }
 
+static unsigned long swiotlb_used(void)
+{
+	unsigned long used = 0;
+	unsigned int i;
+
+	for (i = 0; i < io_tlb_nareas; i++)
+		used += READ_ONCE(io_tlb_areas[i].used);
+	return used;
+}
+
+static void swiotlb_init_areas(unsigned long nslabs)
+{
+	unsigned int i, nareas;
+
+	nareas = min_t(unsigned int, roundup_pow_of_two(num_possible_cpus()),
+		       IO_TLB_MAX_AREAS);
+	while (nareas > 1 && nslabs % (nareas * IO_TLB_SEGSIZE))
+		nareas >>= 1;
+
+	io_tlb_nareas = nareas;
+	io_tlb_area_nslabs = nslabs / nareas;
+	for (i = 0; i < nareas; i++) {
+		spin_lock_init(&io_tlb_areas[i].lock);
+		io_tlb_areas[i].index = i * io_tlb_area_nslabs;
+		io_tlb_areas[i].used = 0;
+	}
+}
+
 int __init swiotlb_init_with_tbl(char *tlb, unsigned long nslabs, int verbose)
 {
 	unsigned long i, bytes;
@@ -229,7 +274,7 @@ int __init swiotlb_init_with_tbl(char *tlb, unsigned long nslabs, int verbose)
 		io_tlb_list[i] = IO_TLB_SEGSIZE - OFFSET(i, IO_TLB_SEGSIZE);
 		io_tlb_orig_addr[i] = INVALID_PHYS_ADDR;
 	}
-	io_tlb_index = 0;
+	swiotlb_init_areas(io_tlb_nslabs);
 	no_iotlb_memory = false;
 
 	if (verbose)
@@ -363,7 +408,7 @@ swiotlb_late_init_with_tbl(char *tlb, unsigned long nslabs)
 		io_tlb_list[i] = IO_TLB_SEGSIZE - OFFSET(i, IO_TLB_SEGSIZE);
 		io_tlb_orig_addr[i] = INVALID_PHYS_ADDR;
 	}
-	io_tlb_index = 0;
+	swiotlb_init_areas(io_tlb_nslabs);
 	no_iotlb_memory = false;
 
 	swiotlb_print_info();
@@ -415,6 +460,8 @@ static void swiotlb_bounce(phys_addr_t orig_addr, phys_addr_t tlb_addr,
 	unsigned long pfn = PFN_DOWN(orig_addr);
 	unsigned char *vaddr = phys_to_virt(tlb_addr);
 
+	atomic_long_add(size, &io_tlb_bounced_bytes);
+
 	if (PageHighMem(pfn_to_page(pfn))) {
 		/* The buffer does not have a mapping.  Map it in and copy */
 		unsigned int offset = orig_addr & ~PAGE_MASK;
@@ -446,6 +493,73 @@ static void swiotlb_bounce(phys_addr_t orig_addr, phys_addr_t tlb_addr,
 	}
 }
 
+/*
+ * Find nslots contiguous free slabs in one area and mark them as used.
+ * Returns the index of the first one, or -1 if the area has no room.
+ */
+static int swiotlb_area_find_slots(struct io_tlb_area *area,
+				   unsigned int nslots, unsigned int stride,
+				   unsigned long offset_slots,
+				   unsigned long max_slots)
+{
+	unsigned int first = (area - io_tlb_areas) * io_tlb_area_nslabs;
+	unsigned int end = first + io_tlb_area_nslabs;
+	unsigned int index, wrap;
+	unsigned long flags;
+	int i, count;
+
+	spin_lock_irqsave(&area->lock, flags);
+
+	if (unlikely(nslots > io_tlb_area_nslabs - area->used))
+		goto not_found;
+
+	index = ALIGN(area->index, stride);
+	if (index >= end)
+		index = first;
+	wrap = index;
+
+	do {
+		while (iommu_is_span_boundary(index, nslots, offset_slots,
+					      max_slots)) {
+			index += stride;
+			if (index >= end)
+				index = first;
+			if (index == wrap)
+				goto not_found;
+		}
+
+		/*
+		 * If we find a slot that indicates we have 'nslots' number of
+		 * contiguous buffers, we allocate the buffers from that slot
+		 * and mark the entries as '0' indicating unavailable.
+		 */
+		if (io_tlb_list[index] >= nslots) {
+			count = 0;
+			for (i = index; i < (int) (index + nslots); i++)
+				io_tlb_list[i] = 0;
+			for (i = index - 1; (OFFSET(i, IO_TLB_SEGSIZE) != IO_TLB_SEGSIZE - 1) && io_tlb_list[i]; i--)
+				io_tlb_list[i] = ++count;
+
+			/*
+			 * Update the indices to avoid searching in the next
+			 * round.
+			 */
+			area->index = ((index + nslots) < end
+				       ? (index + nslots) : first);
+			area->used += nslots;
+			spin_unlock_irqrestore(&area->lock, flags);
+			return index;
+		}
+		index += stride;
+		if (index >= end)
+			index = first;
+	} while (index != wrap);
+
+not_found:
+	spin_unlock_irqrestore(&area->lock, flags);
+	return -1;
+}
+
 phys_addr_t swiotlb_tbl_map_single(struct device *hwdev,
 				   dma_addr_t tbl_dma_addr,
 				   phys_addr_t orig_addr,
@@ -454,14 +568,13 @@ phys_addr_t swiotlb_tbl_map_single(struct device *hwdev,
 				   enum dma_data_direction dir,
 				   unsigned long attrs)
 {
-	unsigned long flags;
+	struct io_tlb_area *area;
 	phys_addr_t tlb_addr;
-	unsigned int nslots, stride, index, wrap;
-	int i;
+	unsigned int nslots, stride, start, n;
+	int i, index;
 	unsigned long mask;
 	unsigned long offset_slots;
 	unsigned long max_slots;
-	unsigned long tmp_io_tlb_used;
 
 	if (no_iotlb_memory)
 		panic("Can not allocate SWIOTLB buffer earlier and can't now provide you with the DMA bounce buffer");
@@ -502,67 +615,23 @@ phys_addr_t swiotlb_tbl_map_single(struct device *hwdev,
 
 	/*
 	 * Find suitable number of IO TLB entries size that will fit this
-	 * request and allocate a buffer from that IO TLB pool.
+	 * request and allocate a buffer from one of the IO TLB areas.
 	 */
-	spin_lock_irqsave(&io_tlb_lock, flags);
-
-	if (unlikely(nslots > io_tlb_nslabs - io_tlb_used))
-		goto not_found;
-
-	index = ALIGN(io_tlb_index, stride);
-	if (index >= io_tlb_nslabs)
-		index = 0;
-	wrap = index;
-
-	do {
-		while (iommu_is_span_boundary(index, nslots, offset_slots,
-					      max_slots)) {
-			index += stride;
-			if (index >= io_tlb_nslabs)
-				index = 0;
-			if (index == wrap)
-				goto not_found;
-		}
-
-		/*
-		 * If we find a slot that indicates we have 'nslots' number of
-		 * contiguous buffers, we allocate the buffers from that slot
-		 * and mark the entries as '0' indicating unavailable.
-		 */
-		if (io_tlb_list[index] >= nslots) {
-			int count = 0;
-
-			for (i = index; i < (int) (index + nslots); i++)
-				io_tlb_list[i] = 0;
-			for (i = index - 1; (OFFSET(i, IO_TLB_SEGSIZE) != IO_TLB_SEGSIZE - 1) && io_tlb_list[i]; i--)
-				io_tlb_list[i] = ++count;
-			tlb_addr = io_tlb_start + (index << IO_TLB_SHIFT);
-
-			/*
-			 * Update the indices to avoid searching in the next
-			 * round.
-			 */
-			io_tlb_index = ((index + nslots) < io_tlb_nslabs
-					? (index + nslots) : 0);
-
+	start = raw_smp_processor_id() & (io_tlb_nareas - 1);
+	for (n = 0; n < io_tlb_nareas; n++) {
+		area = &io_tlb_areas[(start + n) & (io_tlb_nareas - 1)];
+		index = swiotlb_area_find_slots(area, nslots, stride,
+						offset_slots, max_slots);
+		if (index >= 0)
 			goto found;
-		}
-		index += stride;
-		if (index >= io_tlb_nslabs)
-			index = 0;
-	} while (index != wrap);
-
-not_found:
-	tmp_io_tlb_used = io_tlb_used;
+	}
 
-	spin_unlock_irqrestore(&io_tlb_lock, flags);
 	if (!(attrs & DMA_ATTR_NO_WARN) && printk_ratelimit())
 		dev_warn(hwdev, "swiotlb buffer is full (sz: %zd bytes), total %lu (slots), used %lu (slots)\n",
-			 alloc_size, io_tlb_nslabs, tmp_io_tlb_used);
+			 alloc_size, io_tlb_nslabs, swiotlb_used());
 	return (phys_addr_t)DMA_MAPPING_ERROR;
 found:
-	io_tlb_used += nslots;
-	spin_unlock_irqrestore(&io_tlb_lock, flags);
+	tlb_addr = io_tlb_start + ((phys_addr_t)index << IO_TLB_SHIFT);
 
 	/*
 	 * Save away the mapping from the original address to the DMA address.
@@ -593,6 +662,7 @@ void swiotlb_tbl_unmap_single(struct device *hwdev, phys_addr_t tlb_addr,
 	int i, count, nslots = ALIGN(alloc_size, 1 << IO_TLB_SHIFT) >> IO_TLB_SHIFT;
 	int index = (tlb_addr - io_tlb_start) >> IO_TLB_SHIFT;
 	phys_addr_t orig_addr = io_tlb_orig_addr[index];
+	struct io_tlb_area *area = &io_tlb_areas[index / io_tlb_area_nslabs];
 
 	/*
 	 * First, sync the memory before unmapping the entry
@@ -608,7 +678,7 @@ void swiotlb_tbl_unmap_single(struct device *hwdev, phys_addr_t tlb_addr,
 	 * While returning the entries to the free list, we merge the entries
 	 * with slots below and above the pool being returned.
 	 */
-	spin_lock_irqsave(&io_tlb_lock, flags);
+	spin_lock_irqsave(&area->lock, flags);
 	{
 		count = ((index + nslots) < ALIGN(index + 1, IO_TLB_SEGSIZE) ?
 			 io_tlb_list[index + nslots] : 0);
@@ -627,9 +697,9 @@ void swiotlb_tbl_unmap_single(struct device *hwdev, phys_addr_t tlb_addr,
 		for (i = index - 1; (OFFSET(i, IO_TLB_SEGSIZE) != IO_TLB_SEGSIZE -1) && io_tlb_list[i]; i--)
 			io_tlb_list[i] = ++count;
 
-		io_tlb_used -= nslots;
+		area->used -= nslots;
 	}
-	spin_unlock_irqrestore(&io_tlb_lock, flags);
+	spin_unlock_irqrestore(&area->lock, flags);
 }
 
 void swiotlb_tbl_sync_single(struct device *hwdev, phys_addr_t tlb_addr,
@@ -711,13 +781,40 @@ bool is_swiotlb_active(void)
 
 #ifdef CONFIG_DEBUG_FS
 
+static int io_tlb_bounced_get(void *data, u64 *val)
+{
+	*val = atomic_long_read(&io_tlb_bounced_bytes);
+	return 0;
+}
+
+static int io_tlb_bounced_set(void *data, u64 val)
+{
+	atomic_long_set(&io_tlb_bounced_bytes, val);
+	return 0;
+}
+
+static int io_tlb_used_get(void *data, u64 *val)
+{
+	*val = swiotlb_used();
+	return 0;
+}
+
+DEFINE_DEBUGFS_ATTRIBUTE(io_tlb_used_fops, io_tlb_used_get, NULL, "%llu\n");
+
+DEFINE_DEBUGFS_ATTRIBUTE(io_tlb_bounced_fops, io_tlb_bounced_get,
+			 io_tlb_bounced_set, "%llu\n");
+
 static int __init swiotlb_create_debugfs(void)
 {
 	struct dentry *root;
 
 	root = debugfs_create_dir("swiotlb", NULL);
 	debugfs_create_ulong("io_tlb_nslabs", 0400, root, &io_tlb_nslabs);
-	debugfs_create_ulong("io_tlb_used", 0400, root, &io_tlb_used);
+	debugfs_create_file_unsafe("io_tlb_used", 0400, root, NULL,
+				   &io_tlb_used_fops);
+	debugfs_create_u32("io_tlb_nareas", 0400, root, &io_tlb_nareas);
+	debugfs_create_file_unsafe("io_tlb_bounced_bytes", 0600, root, NULL,
+				   &io_tlb_bounced_fops);
 	return 0;
 }
 
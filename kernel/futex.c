@@ -2897,6 +2897,194 @@ static long futex_wait_restart(struct restart_block *restart)
 				restart->futex.val, tp, restart->futex.bitset);
 }
 
+/*
+ * One entry of a FUTEX_WAIT_MULTIPLE vector: the futex_q queued on its
+ * hash bucket, and the user word and value it was queued against.
+ */
+struct futex_vector {
+	struct futex_q q;
+	u32 __user *uaddr;
+	u32 val;
+};
+
+/**
+ * futex_unqueue_multiple() - Remove all the futexes of a vector
+ * @vs:		the vector
+ * @count:	number of entries that were queued
+ *
+ * Drops the key references of all @count entries.
+ *
+ * Return:
+ *  - >=0 - index of the first entry that had already been woken;
+ *  -  -1 - none of the entries had been woken
+ */
+static int futex_unqueue_multiple(struct futex_vector *vs, int count)
+{
+	int ret = -1, i;
+
+	for (i = 0; i < count; i++) {
+		if (!unqueue_me(&vs[i].q) && ret < 0)
+			ret = i;
+	}
+	return ret;
+}
+
+/**
+ * futex_wait_multiple_setup() - Queue on every futex of a vector
+ * @vs:		the vector
+ * @count:	number of entries
+ * @flags:	futex flags (FLAGS_SHARED, etc.)
+ * @woken:	storage for the index of an entry woken during setup
+ *
+ * Like futex_wait_setup(), but every entry is compared and queued in
+ * turn with the task already in TASK_INTERRUPTIBLE, so a wake on an
+ * entry queued early is not lost while the later ones are set up.
+ *
+ * Return:
+ *  -  0 - all entries queued, the task is TASK_INTERRUPTIBLE and holds a
+ *	   key reference per entry
+ *  -  1 - an entry was woken while a later one was found changed; nothing
+ *	   is left queued and @woken holds its index
+ *  - <0 - -EFAULT or -EWOULDBLOCK; nothing is queued
+ */
+static int futex_wait_multiple_setup(struct futex_vector *vs, int count,
+				     unsigned int flags, int *woken)
+{
+	struct futex_hash_bucket *hb;
+	u32 uval;
+	int ret, i, j;
+
+retry:
+	for (i = 0; i < count; i++) {
+		ret = get_futex_key(vs[i].uaddr, flags & FLAGS_SHARED,
+				    &vs[i].q.key, FUTEX_READ);
+		if (unlikely(ret)) {
+			while (--i >= 0)
+				put_futex_key(&vs[i].q.key);
+			return ret;
+		}
+	}
+
+	set_current_state(TASK_INTERRUPTIBLE);
+
+	for (i = 0; i < count; i++) {
+		hb = queue_lock(&vs[i].q);
+
+		ret = get_futex_value_locked(&uval, vs[i].uaddr);
+		if (!ret && uval == vs[i].val) {
+			queue_me(&vs[i].q, hb);
+			continue;
+		}
+		queue_unlock(hb);
+
+		/* Back out: the entries before i are queued, the rest are not */
+		__set_current_state(TASK_RUNNING);
+		*woken = futex_unqueue_multiple(vs, i);
+		for (j = i; j < count; j++)
+			put_futex_key(&vs[j].q.key);
+
+		/* A wake that already happened trumps a later mismatch */
+		if (*woken >= 0)
+			return 1;
+		if (!ret)
+			return -EWOULDBLOCK;
+
+		ret = get_user(uval, vs[i].uaddr);
+		if (ret)
+			return ret;
+		goto retry;
+	}
+
+	return 0;
+}
+
+static int futex_wait_multiple(struct futex_wait_block __user *uwb,
+			       unsigned int flags, u32 count, ktime_t *abs_time)
+{
+	struct hrtimer_sleeper timeout, *to;
+	struct futex_wait_block wb;
+	struct futex_vector *vs;
+	int ret, woken, i;
+
+	if (!count || count > FUTEX_MULTIPLE_MAX_COUNT)
+		return -EINVAL;
+
+	vs = kcalloc(count, sizeof(*vs), GFP_KERNEL);
+	if (!vs)
+		return -ENOMEM;
+
+	for (i = 0; i < count; i++) {
+		if (copy_from_user(&wb, &uwb[i], sizeof(wb))) {
+			ret = -EFAULT;
+			goto out_free;
+		}
+		if (!wb.bitset) {
+			ret = -EINVAL;
+			goto out_free;
+		}
+		vs[i].q = futex_q_init;
+		vs[i].q.bitset = wb.bitset;
+		vs[i].uaddr = u64_to_user_ptr(wb.uaddr);
+		vs[i].val = wb.val;
+	}
+
+	to = futex_setup_timer(abs_time, &timeout, flags,
+			       current->timer_slack_ns);
+retry:
+	ret = futex_wait_multiple_setup(vs, count, flags, &woken);
+	if (ret) {
+		if (ret > 0)
+			ret = woken;
+		goto out;
+	}
+
+	if (to)
+		hrtimer_sleeper_start_expires(to, HRTIMER_MODE_ABS);
+
+	/*
+	 * As in futex_wait_queue_me(), skip schedule() if one of the
+	 * entries has already been woken or the timer has expired.
+	 */
+	for (i = 0; i < count; i++) {
+		if (plist_node_empty(&vs[i].q.list))
+			break;
+	}
+	if (i == count && (!to || to->task))
+		freezable_schedule();
+	__set_current_state(TASK_RUNNING);
+
+	/* futex_unqueue_multiple() drops the key refs */
+	ret = futex_unqueue_multiple(vs, count);
+	if (ret >= 0)
+		goto out;
+
+	ret = -ETIMEDOUT;
+	if (to && !to->task)
+		goto out;
+
+	/*
+	 * We expect signal_pending(current), but we might be the
+	 * victim of a spurious wakeup as well.
+	 */
+	if (!signal_pending(current))
+		goto retry;
+
+	/*
+	 * There is no restart block for a vector; a timed wait returns
+	 * -EINTR rather than restarting with the full relative timeout.
+	 */
+	ret = to ? -EINTR : -ERESTARTSYS;
+
+out:
+	if (to) {
+		hrtimer_cancel(&to->timer);
+		destroy_hrtimer_on_stack(&to->timer);
+	}
+out_free:
+	kfree(vs);
+	return ret;
+}
+
 
 /*
  * Userspace tried a 0 -> TID atomic transition of the futex value
@@ -3882,6 +4070,9 @@ long do_futex(u32 __user *uaddr, int op, u32 val, ktime_t *timeout,
 		/* fall through */
 	case FUTEX_WAIT_BITSET:
 		return futex_wait(uaddr, flags, val, timeout, val3);
+	case FUTEX_WAIT_MULTIPLE:
+		return futex_wait_multiple((void __user *)uaddr, flags, val,
+					   timeout);
 	case FUTEX_WAKE:
 		val3 = FUTEX_BITSET_MATCH_ANY;
 		/* fall through */
@@ -3921,7 +4112,8 @@ SYSCALL_DEFINE6(futex, u32 __user *, uaddr, int, op, u32, val,
 
 	if (utime && (cmd == FUTEX_WAIT || cmd == FUTEX_LOCK_PI ||
 		      cmd == FUTEX_WAIT_BITSET ||
-		      cmd == FUTEX_WAIT_REQUEUE_PI)) {
+		      cmd == FUTEX_WAIT_REQUEUE_PI ||
+		      cmd == FUTEX_WAIT_MULTIPLE)) {
 		if (unlikely(should_fail_futex(!(op & FUTEX_PRIVATE_FLAG))))
 			return -EFAULT;
 		if (get_timespec64(&ts, utime))
@@ -3930,7 +4122,7 @@ SYSCALL_DEFINE6(futex, u32 __user *, uaddr, int, op, u32, val,
 			return -EINVAL;
 
 		t = timespec64_to_ktime(ts);
-		if (cmd == FUTEX_WAIT)
+		if (cmd == FUTEX_WAIT || cmd == FUTEX_WAIT_MULTIPLE)
 			t = ktime_add_safe(ktime_get(), t);
 		tp = &t;
 	}
@@ -4115,14 +4307,15 @@ SYSCALL_DEFINE6(futex_time32, u32 __user *, uaddr, int, op, u32, val,
 
 	if (utime && (cmd == FUTEX_WAIT || cmd == FUTEX_LOCK_PI ||
 		      cmd == FUTEX_WAIT_BITSET ||
-		      cmd == FUTEX_WAIT_REQUEUE_PI)) {
+		      cmd == FUTEX_WAIT_REQUEUE_PI ||
+		      cmd == FUTEX_WAIT_MULTIPLE)) {
 		if (get_old_timespec32(&ts, utime))
 			return -EFAULT;
 		if (!timespec64_valid(&ts))
 			return -EINVAL;
 
 		t = timespec64_to_ktime(ts);
-		if (cmd == FUTEX_WAIT)
+		if (cmd == FUTEX_WAIT || cmd == FUTEX_WAIT_MULTIPLE)
 			t = ktime_add_safe(ktime_get(), t);
 		tp = &t;
 	}
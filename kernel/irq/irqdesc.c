@@ -16,6 +16,7 @@
 #include <linux/bitmap.h>
 #include <linux/irqdomain.h>
 #include <linux/sysfs.h>
+#include <linux/sched/isolation.h>
 
 #include "internals.h"
 
@@ -42,7 +43,17 @@ static void __init init_irq_default_affinity(void)
 {
 	if (!cpumask_available(irq_default_affinity))
 		zalloc_cpumask_var(&irq_default_affinity, GFP_NOWAIT);
-	if (cpumask_empty(irq_default_affinity))
+	if (!cpumask_empty(irq_default_affinity))
+		return;
+
+	/*
+	 * Unless told otherwise with irqaffinity=, keep device interrupts
+	 * off nohz_full CPUs. They would restart the tick on every one.
+	 */
+	if (housekeeping_enabled(HK_FLAG_TICK))
+		cpumask_copy(irq_default_affinity,
+			     housekeeping_cpumask(HK_FLAG_TICK));
+	else
 		cpumask_setall(irq_default_affinity);
 }
 #else
@@ -43,6 +43,7 @@
 #include <linux/rculist.h>
 #include <linux/poll.h>
 #include <linux/irq_work.h>
+#include <linux/kthread.h>
 #include <linux/ctype.h>
 #include <linux/uio.h>
 #include <linux/sched/clock.h>
@@ -1981,6 +1982,25 @@ int vprintk_store(int facility, int level,
 			  dict, dictlen, text, text_len);
 }
 
+/*
+ * With printk.console_async, printk() only stores the record and leaves
+ * the console drivers to the printk kthread, so that a slow serial console
+ * never stalls the caller. Oopses, panics and everything after
+ * SYSTEM_RUNNING still print synchronously.
+ */
+static bool printk_console_async = IS_ENABLED(CONFIG_PRINTK_ASYNC_CONSOLE);
+module_param_named(console_async, printk_console_async, bool, S_IRUGO);
+
+static struct task_struct *printk_kthread __read_mostly;
+static DECLARE_WAIT_QUEUE_HEAD(printk_kthread_wait);
+static bool printk_kthread_pending;
+
+static bool printk_console_offload(void)
+{
+	return READ_ONCE(printk_kthread) && !oops_in_progress &&
+		system_state <= SYSTEM_RUNNING;
+}
+
 asmlinkage int vprintk_emit(int facility, int level,
 			    const char *dict, size_t dictlen,
 			    const char *fmt, va_list args)
@@ -2010,7 +2030,9 @@ asmlinkage int vprintk_emit(int facility, int level,
 	logbuf_unlock_irqrestore(flags);
 
 	/* If called from the scheduler, we can not call up(). */
-	if (!in_sched && pending_output) {
+	if (pending_output && printk_console_offload()) {
+		defer_console_output();
+	} else if (!in_sched && pending_output) {
 		/*
 		 * Disable preemption to avoid being preempted while holding
 		 * console_sem which would prevent anyone from printing to
@@ -2990,9 +3012,13 @@ static void wake_up_klogd_work_func(struct irq_work *irq_work)
 	int pending = __this_cpu_xchg(printk_pending, 0);
 
 	if (pending & PRINTK_PENDING_OUTPUT) {
-		/* If trylock fails, someone else is doing the printing */
-		if (console_trylock())
+		if (printk_console_offload()) {
+			WRITE_ONCE(printk_kthread_pending, true);
+			wake_up_interruptible(&printk_kthread_wait);
+		} else if (console_trylock()) {
+			/* If trylock fails, someone else is doing the printing */
 			console_unlock();
+		}
 	}
 
 	if (pending & PRINTK_PENDING_WAKEUP)
@@ -3028,6 +3054,42 @@ void defer_console_output(void)
 	preempt_enable();
 }
 
+/*
+ * console_lock() lets console_unlock() reschedule between records, so a
+ * long backlog on a slow console costs this thread, not the printk caller.
+ */
+static int printk_kthread_func(void *unused)
+{
+	for (;;) {
+		wait_event_interruptible(printk_kthread_wait,
+					 READ_ONCE(printk_kthread_pending));
+		WRITE_ONCE(printk_kthread_pending, false);
+
+		console_lock();
+		console_unlock();
+	}
+
+	return 0;
+}
+
+static int __init printk_kthread_init(void)
+{
+	struct task_struct *t;
+
+	if (!printk_console_async)
+		return 0;
+
+	t = kthread_run(printk_kthread_func, NULL, "printk");
+	if (IS_ERR(t)) {
+		pr_err("printk: failed to start console thread, printing synchronously\n");
+		return PTR_ERR(t);
+	}
+	WRITE_ONCE(printk_kthread, t);
+
+	return 0;
+}
+late_initcall(printk_kthread_init);
+
 int vprintk_deferred(const char *fmt, va_list args)
 {
 	int r;
@@ -1477,9 +1477,12 @@ static void rcu_cleanup_after_idle(void)
  * comma-separated list of CPUs and/or CPU ranges.  If an invalid list is
  * given, a warning is emitted and all CPUs are offloaded.
  */
+static bool rcu_nocb_is_setup __initdata; /* rcu_nocbs= was given */
+
 static int __init rcu_nocb_setup(char *str)
 {
 	alloc_bootmem_cpumask_var(&rcu_nocb_mask);
+	rcu_nocb_is_setup = true;
 	if (!strcasecmp(str, "all"))
 		cpumask_setall(rcu_nocb_mask);
 	else
@@ -2200,6 +2203,7 @@ void __init rcu_init_nohz(void)
 {
 	int cpu;
 	bool need_rcu_nocb_mask = false;
+	bool offload_all = false;
 	struct rcu_data *rdp;
 
 #if defined(CONFIG_NO_HZ_FULL)
@@ -2207,6 +2211,11 @@ void __init rcu_init_nohz(void)
 		need_rcu_nocb_mask = true;
 #endif /* #if defined(CONFIG_NO_HZ_FULL) */
 
+	if (IS_ENABLED(CONFIG_RCU_NOCB_CPU_DEFAULT_ALL) && !rcu_nocb_is_setup) {
+		need_rcu_nocb_mask = true;
+		offload_all = true;
+	}
+
 	if (!cpumask_available(rcu_nocb_mask) && need_rcu_nocb_mask) {
 		if (!zalloc_cpumask_var(&rcu_nocb_mask, GFP_KERNEL)) {
 			pr_info("rcu_nocb_mask allocation failed, callback offloading disabled.\n");
@@ -2216,6 +2225,9 @@ void __init rcu_init_nohz(void)
 	if (!cpumask_available(rcu_nocb_mask))
 		return;
 
+	if (offload_all)
+		cpumask_setall(rcu_nocb_mask);
+
 #if defined(CONFIG_NO_HZ_FULL)
 	if (tick_nohz_full_running)
 		cpumask_or(rcu_nocb_mask, rcu_nocb_mask, tick_nohz_full_mask);
@@ -2317,7 +2329,11 @@ static void __init rcu_spawn_nocb_kthreads(void)
 		rcu_spawn_cpu_nocb_kthread(cpu);
 }
 
-/* How many CB CPU IDs per GP kthread?  Default of -1 for sqrt(nr_cpu_ids). */
+/*
+ * How many CB CPU IDs per GP kthread?  Default of -1 for sqrt(nr_cpu_ids).
+ * Setting this to the number of CPUs sharing a cache (e.g. 4 for a Jaguar
+ * module) keeps each rcuog kthread's callbacks within one cache domain.
+ */
 static int rcu_nocb_gp_stride = -1;
 module_param(rcu_nocb_gp_stride, int, 0444);
 
@@ -246,7 +246,7 @@ set_table_entry(struct ctl_table *entry,
 static struct ctl_table *
 sd_alloc_ctl_domain_table(struct sched_domain *sd)
 {
-	struct ctl_table *table = sd_alloc_ctl_entry(9);
+	struct ctl_table *table = sd_alloc_ctl_entry(10);
 
 	if (table == NULL)
 		return NULL;
@@ -258,8 +258,9 @@ sd_alloc_ctl_domain_table(struct sched_domain *sd)
 	set_table_entry(&table[4], "cache_nice_tries",	  &sd->cache_nice_tries,    sizeof(int),  0644, proc_dointvec_minmax);
 	set_table_entry(&table[5], "flags",		  &sd->flags,		    sizeof(int),  0444, proc_dointvec_minmax);
 	set_table_entry(&table[6], "max_newidle_lb_cost", &sd->max_newidle_lb_cost, sizeof(long), 0644, proc_doulongvec_minmax);
-	set_table_entry(&table[7], "name",		  sd->name,	       CORENAME_MAX_SIZE, 0444, proc_dostring);
-	/* &table[8] is terminator */
+	set_table_entry(&table[7], "migration_cost",	  &sd->migration_cost,	    sizeof(int),  0644, proc_dointvec_minmax);
+	set_table_entry(&table[8], "name",		  sd->name,	       CORENAME_MAX_SIZE, 0444, proc_dostring);
+	/* &table[9] is terminator */
 
 	return table;
 }
@@ -102,6 +102,15 @@ int __weak arch_asym_cpu_priority(int cpu)
  */
 #define fits_capacity(cap, max)	((cap) * 1280 < (max) * 1024)
 
+/*
+ * Keep CFS tasks on the LLC of the first active CPU for as long as that LLC's
+ * utilization stays below this percentage of its capacity, so that the CPUs
+ * of the other LLCs can sit in their deepest idle state.
+ *
+ * (default: 0, disabled, units: percent)
+ */
+unsigned int sysctl_sched_pack_llc_util __read_mostly;
+
 #endif
 
 #ifdef CONFIG_CFS_BANDWIDTH
@@ -4375,6 +4384,9 @@ void __refill_cfs_bandwidth_runtime(struct cfs_bandwidth *cfs_b)
 {
 	if (cfs_b->quota != RUNTIME_INF)
 		cfs_b->runtime = cfs_b->quota;
+
+	/* whatever the LLC pools hold belongs to the previous period */
+	WRITE_ONCE(cfs_b->gen, cfs_b->gen + 1);
 }
 
 static inline struct cfs_bandwidth *tg_cfs_bandwidth(struct task_group *tg)
@@ -4410,12 +4422,140 @@ static int __assign_cfs_rq_runtime(struct cfs_bandwidth *cfs_b,
 	return cfs_rq->runtime_remaining > 0;
 }
 
+static struct cfs_bandwidth_pool *cfs_rq_pool(struct cfs_bandwidth *cfs_b,
+					      struct cfs_rq *cfs_rq)
+{
+#ifdef CONFIG_SMP
+	return per_cpu_ptr(cfs_b->pool, per_cpu(sd_llc_id, cpu_of(rq_of(cfs_rq))));
+#else
+	return per_cpu_ptr(cfs_b->pool, 0);
+#endif
+}
+
+/*
+ * How much runtime an LLC pool takes from the global runtime at once: a slice
+ * per CPU of the LLC, but no more than a quarter of the quota so that one LLC
+ * can't grab the whole period's runtime.
+ *
+ * requires cfs_b->lock
+ */
+static u64 cfs_pool_chunk(struct cfs_bandwidth *cfs_b, struct cfs_rq *cfs_rq)
+{
+	u64 slice = sched_cfs_bandwidth_slice();
+	u64 chunk = slice;
+
+#ifdef CONFIG_SMP
+	chunk *= per_cpu(sd_llc_size, cpu_of(rq_of(cfs_rq)));
+#endif
+
+	return min(chunk, max(slice, cfs_b->quota >> 2));
+}
+
+/*
+ * Top up cfs_rq from its LLC's pool, refilling the pool from cfs_b when it
+ * runs dry. Returns 0 on failure to allocate runtime.
+ */
+static int pool_assign_cfs_rq_runtime(struct cfs_bandwidth *cfs_b,
+				      struct cfs_rq *cfs_rq, u64 target_runtime)
+{
+	struct cfs_bandwidth_pool *pool = cfs_rq_pool(cfs_b, cfs_rq);
+	u64 min_amount, amount;
+
+	/* note: this is a positive sum as runtime_remaining <= 0 */
+	min_amount = target_runtime - cfs_rq->runtime_remaining;
+
+	raw_spin_lock(&pool->lock);
+	if (pool->gen != READ_ONCE(cfs_b->gen)) {
+		pool->gen = READ_ONCE(cfs_b->gen);
+		pool->runtime = 0;
+	}
+
+	if (pool->runtime < min_amount) {
+		raw_spin_lock(&cfs_b->lock);
+		if (cfs_b->quota != RUNTIME_INF) {
+			start_cfs_bandwidth(cfs_b);
+
+			if (pool->gen != cfs_b->gen) {
+				pool->gen = cfs_b->gen;
+				pool->runtime = 0;
+			}
+
+			amount = max(cfs_pool_chunk(cfs_b, cfs_rq), min_amount);
+			amount = min(cfs_b->runtime, amount);
+			if (amount) {
+				cfs_b->runtime -= amount;
+				cfs_b->idle = 0;
+				pool->runtime += amount;
+			}
+		}
+		raw_spin_unlock(&cfs_b->lock);
+	}
+
+	amount = min(pool->runtime, min_amount);
+	pool->runtime -= amount;
+	raw_spin_unlock(&pool->lock);
+
+	cfs_rq->runtime_remaining += amount;
+
+	return cfs_rq->runtime_remaining > 0;
+}
+
+/*
+ * Whether runtime of the current period is left in the pool of another LLC
+ * than cfs_rq's; a throttle then comes from runtime being stranded there
+ * rather than from the quota being used up. Unlocked, it's only a hint.
+ */
+static bool cfs_pools_stranded(struct cfs_bandwidth *cfs_b,
+			       struct cfs_rq *cfs_rq)
+{
+	struct cfs_bandwidth_pool *own = cfs_rq_pool(cfs_b, cfs_rq);
+	u64 gen = READ_ONCE(cfs_b->gen);
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct cfs_bandwidth_pool *pool = per_cpu_ptr(cfs_b->pool, cpu);
+
+		if (pool != own && READ_ONCE(pool->gen) == gen &&
+		    READ_ONCE(pool->runtime) > 0)
+			return true;
+	}
+
+	return false;
+}
+
+/* Take back the runtime of the current period held by the LLC pools */
+static u64 drain_cfs_pools(struct cfs_bandwidth *cfs_b, u64 gen)
+{
+	unsigned long flags;
+	u64 runtime = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct cfs_bandwidth_pool *pool = per_cpu_ptr(cfs_b->pool, cpu);
+
+		if (!READ_ONCE(pool->runtime))
+			continue;
+
+		raw_spin_lock_irqsave(&pool->lock, flags);
+		if (pool->gen == gen)
+			runtime += pool->runtime;
+		pool->runtime = 0;
+		raw_spin_unlock_irqrestore(&pool->lock, flags);
+	}
+
+	return runtime;
+}
+
 /* returns 0 on failure to allocate runtime */
 static int assign_cfs_rq_runtime(struct cfs_rq *cfs_rq)
 {
 	struct cfs_bandwidth *cfs_b = tg_cfs_bandwidth(cfs_rq->tg);
 	int ret;
 
+	if (cfs_b->pool && READ_ONCE(cfs_b->quota) != RUNTIME_INF)
+		return pool_assign_cfs_rq_runtime(cfs_b, cfs_rq,
+						  sched_cfs_bandwidth_slice());
+
 	raw_spin_lock(&cfs_b->lock);
 	ret = __assign_cfs_rq_runtime(cfs_b, cfs_rq, sched_cfs_bandwidth_slice());
 	raw_spin_unlock(&cfs_b->lock);
@@ -4511,6 +4651,8 @@ static int tg_throttle_down(struct task_group *tg, void *data)
 	return 0;
 }
 
+static void start_cfs_slack_bandwidth(struct cfs_bandwidth *cfs_b);
+
 static bool throttle_cfs_rq(struct cfs_rq *cfs_rq)
 {
 	struct rq *rq = rq_of(cfs_rq);
@@ -4518,6 +4660,11 @@ static bool throttle_cfs_rq(struct cfs_rq *cfs_rq)
 	struct sched_entity *se;
 	long task_delta, idle_task_delta, dequeue = 1;
 
+	/* Bandwidth may have been left in our LLC's pool */
+	if (cfs_b->pool && READ_ONCE(cfs_b->quota) != RUNTIME_INF &&
+	    pool_assign_cfs_rq_runtime(cfs_b, cfs_rq, 1))
+		return false;
+
 	raw_spin_lock(&cfs_b->lock);
 	/* This will start the period timer if necessary */
 	if (__assign_cfs_rq_runtime(cfs_b, cfs_rq, 1)) {
@@ -4533,6 +4680,18 @@ static bool throttle_cfs_rq(struct cfs_rq *cfs_rq)
 	} else {
 		list_add_tail_rcu(&cfs_rq->throttled_list,
 				  &cfs_b->throttled_cfs_rq);
+
+		/*
+		 * Runtime stranded in other LLCs' pools: count the throttle
+		 * as slice starvation and have the slack timer pull the
+		 * runtime back to unthrottle us.
+		 */
+		cfs_rq->throttled_starved = cfs_b->pool &&
+					    cfs_pools_stranded(cfs_b, cfs_rq);
+		if (cfs_rq->throttled_starved) {
+			cfs_b->nr_slice_starved++;
+			start_cfs_slack_bandwidth(cfs_b);
+		}
 	}
 	raw_spin_unlock(&cfs_b->lock);
 
@@ -4590,6 +4749,11 @@ void unthrottle_cfs_rq(struct cfs_rq *cfs_rq)
 
 	raw_spin_lock(&cfs_b->lock);
 	cfs_b->throttled_time += rq_clock(rq) - cfs_rq->throttled_clock;
+	if (cfs_rq->throttled_starved) {
+		cfs_b->slice_starved_time += rq_clock(rq) -
+					     cfs_rq->throttled_clock;
+		cfs_rq->throttled_starved = 0;
+	}
 	list_del_rcu(&cfs_rq->throttled_list);
 	raw_spin_unlock(&cfs_b->lock);
 
@@ -4860,11 +5024,18 @@ static __always_inline void return_cfs_rq_runtime(struct cfs_rq *cfs_rq)
 static void do_sched_cfs_slack_timer(struct cfs_bandwidth *cfs_b)
 {
 	u64 runtime = 0, slice = sched_cfs_bandwidth_slice();
+	u64 gen = READ_ONCE(cfs_b->gen), pooled = 0;
 	unsigned long flags;
 
+	/* pools nest outside cfs_b->lock, empty them first */
+	if (cfs_b->pool)
+		pooled = drain_cfs_pools(cfs_b, gen);
+
 	/* confirm we're still not at a refresh boundary */
 	raw_spin_lock_irqsave(&cfs_b->lock, flags);
 	cfs_b->slack_started = false;
+	if (pooled && cfs_b->gen == gen && cfs_b->quota != RUNTIME_INF)
+		cfs_b->runtime += pooled;
 	if (cfs_b->distribute_running) {
 		raw_spin_unlock_irqrestore(&cfs_b->lock, flags);
 		return;
@@ -5036,6 +5207,20 @@ void init_cfs_bandwidth(struct cfs_bandwidth *cfs_b)
 	cfs_b->slack_started = false;
 }
 
+static int alloc_cfs_bandwidth_pool(struct cfs_bandwidth *cfs_b)
+{
+	int cpu;
+
+	cfs_b->pool = alloc_percpu(struct cfs_bandwidth_pool);
+	if (!cfs_b->pool)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu)
+		raw_spin_lock_init(&per_cpu_ptr(cfs_b->pool, cpu)->lock);
+
+	return 0;
+}
+
 static void init_cfs_rq_runtime(struct cfs_rq *cfs_rq)
 {
 	cfs_rq->runtime_enabled = 0;
@@ -5062,6 +5247,7 @@ static void destroy_cfs_bandwidth(struct cfs_bandwidth *cfs_b)
 
 	hrtimer_cancel(&cfs_b->period_timer);
 	hrtimer_cancel(&cfs_b->slack_timer);
+	free_percpu(cfs_b->pool);
 }
 
 /*
@@ -5160,6 +5346,10 @@ static inline struct cfs_bandwidth *tg_cfs_bandwidth(struct task_group *tg)
 {
 	return NULL;
 }
+static inline int alloc_cfs_bandwidth_pool(struct cfs_bandwidth *cfs_b)
+{
+	return 0;
+}
 static inline void destroy_cfs_bandwidth(struct cfs_bandwidth *cfs_b) {}
 static inline void update_runtime_enabled(struct rq *rq) {}
 static inline void unthrottle_offline_cfs_rqs(struct rq *rq) {}
@@ -6494,6 +6684,84 @@ static int find_energy_efficient_cpu(struct task_struct *p, int prev_cpu)
 	return -1;
 }
 
+/*
+ * The LLC tasks are packed onto, identified by its first CPU, or -1 when
+ * packing is disabled or there is nothing to pack.
+ */
+static int pack_llc_cpu(void)
+{
+	int cpu;
+
+	if (!sysctl_sched_pack_llc_util)
+		return -1;
+
+	cpu = cpumask_first(cpu_active_mask);
+	if (cpu >= nr_cpu_ids)
+		return -1;
+
+	return per_cpu(sd_llc_id, cpu);
+}
+
+/*
+ * Whether the packing LLC has room for @util more utilization. Called with
+ * rcu_read_lock() held.
+ */
+static bool pack_llc_fits(int pack_cpu, struct task_struct *p,
+			  unsigned long util)
+{
+	struct sched_domain *sd = rcu_dereference(per_cpu(sd_llc, pack_cpu));
+	unsigned long cap = 0;
+	int cpu;
+
+	if (!sd || !sd->parent)
+		return false;
+
+	for_each_cpu(cpu, sched_domain_span(sd)) {
+		util += p ? cpu_util_without(cpu, p) : cpu_util(cpu);
+		cap += capacity_orig_of(cpu);
+	}
+
+	return util * 100 < cap * sysctl_sched_pack_llc_util;
+}
+
+/*
+ * Place @p in the packing LLC if the task fits there, preferring an idle CPU
+ * next to @prev_cpu or @this_cpu. Returns -1 when the task should be placed
+ * the usual way.
+ */
+static int select_pack_cpu(struct task_struct *p, int prev_cpu, int this_cpu)
+{
+	struct sched_domain *sd;
+	int pack_cpu = pack_llc_cpu();
+	int target = -1;
+
+	if (pack_cpu < 0)
+		return -1;
+
+	rcu_read_lock();
+	sd = rcu_dereference(per_cpu(sd_llc, pack_cpu));
+	if (!sd || !pack_llc_fits(pack_cpu, p, task_util_est(p)))
+		goto unlock;
+
+	if (cpus_share_cache(prev_cpu, pack_cpu) &&
+	    cpumask_test_cpu(prev_cpu, p->cpus_ptr))
+		target = prev_cpu;
+	else if (cpus_share_cache(this_cpu, pack_cpu) &&
+		 cpumask_test_cpu(this_cpu, p->cpus_ptr))
+		target = this_cpu;
+	else
+		target = cpumask_any_and(sched_domain_span(sd), p->cpus_ptr);
+
+	if (target >= nr_cpu_ids)
+		target = -1;
+	else
+		target = select_idle_sibling(p, prev_cpu, target);
+unlock:
+	rcu_read_unlock();
+
+	return target;
+}
+
 /*
  * select_task_rq_fair: Select target runqueue for the waking task in domains
  * that have the 'sd_flag' flag set. In practice, this is SD_BALANCE_WAKE,
@@ -6515,6 +6783,14 @@ select_task_rq_fair(struct task_struct *p, int prev_cpu, int sd_flag, int wake_f
 	int want_affine = 0;
 	int sync = (wake_flags & WF_SYNC) && !(current->flags & PF_EXITING);
 
+	new_cpu = select_pack_cpu(p, prev_cpu, cpu);
+	if (new_cpu >= 0) {
+		if (sd_flag & SD_BALANCE_WAKE)
+			record_wakee(p);
+		return new_cpu;
+	}
+	new_cpu = prev_cpu;
+
 	if (sd_flag & SD_BALANCE_WAKE) {
 		record_wakee(p);
 
@@ -6561,6 +6837,19 @@ select_task_rq_fair(struct task_struct *p, int prev_cpu, int sd_flag, int wake_f
 
 		new_cpu = select_idle_sibling(p, prev_cpu, new_cpu);
 
+		/*
+		 * Nothing idle next to prev_cpu; before stacking the task
+		 * there, try an idle CPU sharing the waker's cache.
+		 */
+		if (sched_feat(SIS_WAKER_LLC) && want_affine &&
+		    !cpus_share_cache(cpu, new_cpu) &&
+		    !available_idle_cpu(new_cpu) && !sched_idle_cpu(new_cpu)) {
+			int i = select_idle_sibling(p, new_cpu, cpu);
+
+			if (available_idle_cpu(i) || sched_idle_cpu(i))
+				new_cpu = i;
+		}
+
 		if (want_affine)
 			current->recent_used_cpu = cpu;
 	}
@@ -7217,7 +7506,7 @@ static int task_hot(struct task_struct *p, struct lb_env *env)
 
 	delta = rq_clock_task(env->src_rq) - p->se.exec_start;
 
-	return delta < (s64)sysctl_sched_migration_cost;
+	return delta < (s64)env->sd->migration_cost;
 }
 
 #ifdef CONFIG_NUMA_BALANCING
@@ -8605,6 +8894,20 @@ static struct sched_group *find_busiest_group(struct lb_env *env)
 	local = &sds.local_stat;
 	busiest = &sds.busiest_stat;
 
+	/*
+	 * While tasks are packed, CPUs outside the packing LLC don't pull
+	 * unless the packing LLC has run out of room or tasks are stuck.
+	 */
+	if (env->sd->child &&
+	    env->sd->child == rcu_dereference(per_cpu(sd_llc, env->dst_cpu))) {
+		int pack_cpu = pack_llc_cpu();
+
+		if (pack_cpu >= 0 && !cpus_share_cache(env->dst_cpu, pack_cpu) &&
+		    sds.busiest && busiest->group_type == group_other &&
+		    pack_llc_fits(pack_cpu, NULL, 0))
+			goto out_balanced;
+	}
+
 	/* ASYM feature bypasses nice load balance check */
 	if (check_asym_packing(env, &sds))
 		return sds.busiest;
@@ -10355,6 +10658,8 @@ int alloc_fair_sched_group(struct task_group *tg, struct task_group *parent)
 	tg->shares = NICE_0_LOAD;
 
 	init_cfs_bandwidth(tg_cfs_bandwidth(tg));
+	if (alloc_cfs_bandwidth_pool(tg_cfs_bandwidth(tg)))
+		goto err;
 
 	for_each_possible_cpu(i) {
 		cfs_rq = kzalloc_node(sizeof(struct cfs_rq),
@@ -85,6 +85,11 @@ SCHED_FEAT(WA_IDLE, true)
 SCHED_FEAT(WA_WEIGHT, true)
 SCHED_FEAT(WA_BIAS, true)
 
+/*
+ * Look for an idle CPU in the waker's LLC when the wakee's LLC is busy.
+ */
+SCHED_FEAT(SIS_WAKER_LLC, true)
+
 /*
  * UtilEstimation. Use estimated CPU utilization.
  */
@@ -157,6 +157,20 @@ static int __init setup_psi(char *str)
 }
 __setup("psi=", setup_psi);
 
+/*
+ * Only cgroups up to this level below the root are tracked; tasks in deeper
+ * cgroups are accounted to their ancestor at that level. Every task state
+ * change walks all tracked levels, so this bounds the cost of deep
+ * hierarchies when only the upper levels are watched. The pressure files
+ * of deeper cgroups report -EOPNOTSUPP.
+ */
+static int psi_cgroup_depth __read_mostly = INT_MAX;
+static int __init setup_psi_cgroup_depth(char *str)
+{
+	return kstrtoint(str, 0, &psi_cgroup_depth) == 0;
+}
+__setup("psi_cgroup_depth=", setup_psi_cgroup_depth);
+
 /* Running averages - we need to be higher-res than loadavg */
 #define PSI_FREQ	(2*HZ+1)	/* 2 sec intervals */
 #define EXP_10s		1677		/* 1/exp(2s/10s) as fixed-point */
@@ -623,13 +637,11 @@ static void psi_poll_work(struct kthread_work *work)
 	mutex_unlock(&group->trigger_lock);
 }
 
-static void record_times(struct psi_group_cpu *groupc, int cpu,
+static void record_times(struct psi_group_cpu *groupc, u64 now,
 			 bool memstall_tick)
 {
 	u32 delta;
-	u64 now;
 
-	now = cpu_clock(cpu);
 	delta = now - groupc->state_start;
 	groupc->state_start = now;
 
@@ -670,7 +682,7 @@ static void record_times(struct psi_group_cpu *groupc, int cpu,
 }
 
 static u32 psi_group_change(struct psi_group *group, int cpu,
-			    unsigned int clear, unsigned int set)
+			    unsigned int clear, unsigned int set, u64 now)
 {
 	struct psi_group_cpu *groupc;
 	unsigned int t, m;
@@ -680,17 +692,10 @@ static u32 psi_group_change(struct psi_group *group, int cpu,
 	groupc = per_cpu_ptr(group->pcpu, cpu);
 
 	/*
-	 * First we assess the aggregate resource states this CPU's
-	 * tasks have been in since the last change, and account any
-	 * SOME and FULL time these may have resulted in.
-	 *
-	 * Then we update the task counts according to the state
-	 * change requested through the @clear and @set bits.
+	 * First we update the task counts according to the state
+	 * change requested through the @clear and @set bits. The
+	 * counts are only used here, under the runqueue lock.
 	 */
-	write_seqcount_begin(&groupc->seq);
-
-	record_times(groupc, cpu, false);
-
 	for (t = 0, m = clear; m; m &= ~(1 << t), t++) {
 		if (!(m & (1 << t)))
 			continue;
@@ -713,6 +718,26 @@ static u32 psi_group_change(struct psi_group *group, int cpu,
 		if (test_state(groupc->tasks, s))
 			state_mask |= (1 << s);
 	}
+
+	/*
+	 * Most changes, e.g. a third task becoming runnable, leave the
+	 * aggregate states alone. The time in those states keeps
+	 * running from state_start and readers add it in themselves,
+	 * so there is nothing to record yet. Do it anyway once in a
+	 * while, as the deltas are only 32 bits.
+	 */
+	if (state_mask == groupc->state_mask &&
+	    now - groupc->state_start < NSEC_PER_SEC)
+		return state_mask;
+
+	/*
+	 * Otherwise assess the aggregate resource states this CPU's
+	 * tasks have been in since the last change, and account any
+	 * SOME and FULL time these may have resulted in.
+	 */
+	write_seqcount_begin(&groupc->seq);
+
+	record_times(groupc, now, false);
 	groupc->state_mask = state_mask;
 
 	write_seqcount_end(&groupc->seq);
@@ -725,9 +750,11 @@ static struct psi_group *iterate_groups(struct task_struct *task, void **iter)
 #ifdef CONFIG_CGROUPS
 	struct cgroup *cgroup = NULL;
 
-	if (!*iter)
+	if (!*iter) {
 		cgroup = task->cgroups->dfl_cgrp;
-	else if (*iter == &psi_system)
+		if (unlikely(cgroup->level > psi_cgroup_depth))
+			cgroup = cgroup_ancestor(cgroup, psi_cgroup_depth);
+	} else if (*iter == &psi_system)
 		return NULL;
 	else
 		cgroup = cgroup_parent(*iter);
@@ -750,6 +777,7 @@ void psi_task_change(struct task_struct *task, int clear, int set)
 	struct psi_group *group;
 	bool wake_clock = true;
 	void *iter = NULL;
+	u64 now;
 
 	if (!task->pid)
 		return;
@@ -777,8 +805,11 @@ void psi_task_change(struct task_struct *task, int clear, int set)
 		     wq_worker_last_func(task) == psi_avgs_work))
 		wake_clock = false;
 
+	/* One clock read serves all levels of the hierarchy */
+	now = cpu_clock(cpu);
+
 	while ((group = iterate_groups(task, &iter))) {
-		u32 state_mask = psi_group_change(group, cpu, clear, set);
+		u32 state_mask = psi_group_change(group, cpu, clear, set, now);
 
 		if (state_mask & group->poll_states)
 			psi_schedule_poll_work(group, 1);
@@ -792,13 +823,14 @@ void psi_memstall_tick(struct task_struct *task, int cpu)
 {
 	struct psi_group *group;
 	void *iter = NULL;
+	u64 now = cpu_clock(cpu);
 
 	while ((group = iterate_groups(task, &iter))) {
 		struct psi_group_cpu *groupc;
 
 		groupc = per_cpu_ptr(group->pcpu, cpu);
 		write_seqcount_begin(&groupc->seq);
-		record_times(groupc, cpu, true);
+		record_times(groupc, now, true);
 		write_seqcount_end(&groupc->seq);
 	}
 }
@@ -869,6 +901,10 @@ int psi_cgroup_alloc(struct cgroup *cgroup)
 	if (static_branch_likely(&psi_disabled))
 		return 0;
 
+	/* Not tracked, tasks are accounted to an ancestor */
+	if (cgroup->level > psi_cgroup_depth)
+		return 0;
+
 	cgroup->psi.pcpu = alloc_percpu(struct psi_group_cpu);
 	if (!cgroup->psi.pcpu)
 		return -ENOMEM;
@@ -878,7 +914,7 @@ int psi_cgroup_alloc(struct cgroup *cgroup)
 
 void psi_cgroup_free(struct cgroup *cgroup)
 {
-	if (static_branch_likely(&psi_disabled))
+	if (static_branch_likely(&psi_disabled) || !cgroup->psi.pcpu)
 		return;
 
 	cancel_delayed_work_sync(&cgroup->psi.avgs_work);
@@ -942,7 +978,7 @@ int psi_show(struct seq_file *m, struct psi_group *group, enum psi_res res)
 	int full;
 	u64 now;
 
-	if (static_branch_likely(&psi_disabled))
+	if (static_branch_likely(&psi_disabled) || !group->pcpu)
 		return -EOPNOTSUPP;
 
 	/* Update averages before reporting them */
@@ -1012,7 +1048,7 @@ struct psi_trigger *psi_trigger_create(struct psi_group *group,
 	u32 threshold_us;
 	u32 window_us;
 
-	if (static_branch_likely(&psi_disabled))
+	if (static_branch_likely(&psi_disabled) || !group->pcpu)
 		return ERR_PTR(-EOPNOTSUPP);
 
 	if (sscanf(buf, "some %u %u", &threshold_us, &window_us) == 2)
@@ -330,13 +330,28 @@ struct rt_rq;
 
 extern struct list_head task_groups;
 
+#ifdef CONFIG_CFS_BANDWIDTH
+/*
+ * Runtime shared by the cfs_rqs of one LLC, refilled from the group's global
+ * runtime in chunks of several slices so that cfs_bandwidth::lock is only
+ * taken once per chunk.
+ */
+struct cfs_bandwidth_pool {
+	raw_spinlock_t		lock;
+	u64			runtime;
+	u64			gen;	/* cfs_bandwidth::gen of the runtime */
+};
+#endif
+
 struct cfs_bandwidth {
 #ifdef CONFIG_CFS_BANDWIDTH
 	raw_spinlock_t		lock;
 	ktime_t			period;
 	u64			quota;
 	u64			runtime;
+	u64			gen;	/* bumped on every refill */
 	s64			hierarchical_quota;
+	struct cfs_bandwidth_pool __percpu *pool; /* indexed by sd_llc_id */
 
 	u8			idle;
 	u8			period_active;
@@ -350,6 +365,9 @@ struct cfs_bandwidth {
 	int			nr_periods;
 	int			nr_throttled;
 	u64			throttled_time;
+	/* Throttled while other LLCs' pools still held runtime */
+	int			nr_slice_starved;
+	u64			slice_starved_time;
 #endif
 };
 
@@ -573,6 +591,7 @@ struct cfs_rq {
 	u64			throttled_clock_pelt;
 	u64			throttled_clock_pelt_time;
 	int			throttled;
+	int			throttled_starved;
 	int			throttle_count;
 	struct list_head	throttled_list;
 #endif /* CONFIG_CFS_BANDWIDTH */
@@ -1311,6 +1311,9 @@ int __read_mostly		node_reclaim_distance = RECLAIM_DISTANCE;
 	 SD_ASYM_PACKING	|	\
 	 SD_SHARE_POWERDOMAIN)
 
+/* Scales sysctl_sched_migration_cost for domains spanning several LLCs */
+#define SD_CROSS_LLC_MIGRATION_FACTOR	4
+
 static struct sched_domain *
 sd_init(struct sched_domain_topology_level *tl,
 	const struct cpumask *cpu_map,
@@ -1414,6 +1417,14 @@ sd_init(struct sched_domain_topology_level *tl,
 		sd->cache_nice_tries = 1;
 	}
 
+	/*
+	 * Migrating across LLCs has to refill the whole cache on the
+	 * destination, so tasks stay cache hot for longer there.
+	 */
+	sd->migration_cost = sysctl_sched_migration_cost;
+	if (!(sd->flags & (SD_SHARE_CPUCAPACITY | SD_SHARE_PKG_RESOURCES)))
+		sd->migration_cost *= SD_CROSS_LLC_MIGRATION_FACTOR;
+
 	/*
 	 * For all levels sharing cache; connect a sched_domain_shared
 	 * instance.
@@ -244,6 +244,23 @@ bool trace_event_ignore_this_pid(struct trace_event_file *trace_file)
 }
 EXPORT_SYMBOL_GPL(trace_event_ignore_this_pid);
 
+/*
+ * Called with preemption disabled from the tracepoint, before anything is
+ * reserved in the ring buffer, so dropped hits cost only a per-cpu increment.
+ */
+bool trace_event_sample_skip(struct trace_event_file *trace_file)
+{
+	unsigned int ratio = READ_ONCE(trace_file->sample_ratio);
+	unsigned int __percpu *count;
+
+	count = smp_load_acquire(&trace_file->sample_count);
+	if (ratio <= 1 || !count)
+		return false;
+
+	return this_cpu_inc_return(*count) % ratio != 0;
+}
+EXPORT_SYMBOL_GPL(trace_event_sample_skip);
+
 void *trace_event_buffer_reserve(struct trace_event_buffer *fbuffer,
 				 struct trace_event_file *trace_file,
 				 unsigned long len)
@@ -723,6 +740,7 @@ static void remove_event_file_dir(struct trace_event_file *file)
 	list_del(&file->list);
 	remove_subsystem(file->system);
 	free_event_filter(file->filter);
+	free_percpu(file->sample_count);
 	kmem_cache_free(file_cachep, file);
 }
 
@@ -1091,6 +1109,79 @@ event_enable_write(struct file *filp, const char __user *ubuf, size_t cnt,
 	return ret ? ret : cnt;
 }
 
+static ssize_t
+event_sample_read(struct file *filp, char __user *ubuf, size_t cnt,
+		  loff_t *ppos)
+{
+	struct trace_event_file *file;
+	unsigned int ratio = 0;
+	char buf[16];
+	int len;
+
+	mutex_lock(&event_mutex);
+	file = event_file_data(filp);
+	if (likely(file))
+		ratio = file->sample_ratio;
+	mutex_unlock(&event_mutex);
+
+	if (!file)
+		return -ENODEV;
+
+	len = snprintf(buf, sizeof(buf), "%u\n", ratio);
+
+	return simple_read_from_buffer(ubuf, cnt, ppos, buf, len);
+}
+
+/*
+ * Writing N makes the event record only one in N hits on each cpu,
+ * 0 or 1 records every hit again.
+ */
+static ssize_t
+event_sample_write(struct file *filp, const char __user *ubuf, size_t cnt,
+		   loff_t *ppos)
+{
+	struct trace_event_file *file;
+	unsigned int __percpu *count;
+	unsigned int val;
+	int ret;
+
+	ret = kstrtouint_from_user(ubuf, cnt, 10, &val);
+	if (ret)
+		return ret;
+
+	ret = -ENODEV;
+	mutex_lock(&event_mutex);
+	file = event_file_data(filp);
+	if (!file)
+		goto out;
+
+	ret = 0;
+	if (val <= 1) {
+		clear_bit(EVENT_FILE_FL_SAMPLED_BIT, &file->flags);
+		file->sample_ratio = val;
+		goto out;
+	}
+
+	if (!file->sample_count) {
+		count = alloc_percpu(unsigned int);
+		if (!count) {
+			ret = -ENOMEM;
+			goto out;
+		}
+		smp_store_release(&file->sample_count, count);
+	}
+	WRITE_ONCE(file->sample_ratio, val);
+	set_bit(EVENT_FILE_FL_SAMPLED_BIT, &file->flags);
+out:
+	mutex_unlock(&event_mutex);
+	if (ret)
+		return ret;
+
+	*ppos += cnt;
+
+	return cnt;
+}
+
 static ssize_t
 system_enable_read(struct file *filp, char __user *ubuf, size_t cnt,
 		   loff_t *ppos)
@@ -1711,6 +1802,13 @@ static const struct file_operations ftrace_enable_fops = {
 	.llseek = default_llseek,
 };
 
+static const struct file_operations ftrace_event_sample_fops = {
+	.open = tracing_open_generic,
+	.read = event_sample_read,
+	.write = event_sample_write,
+	.llseek = default_llseek,
+};
+
 static const struct file_operations ftrace_event_format_fops = {
 	.open = trace_format_open,
 	.read = seq_read,
@@ -2012,6 +2110,9 @@ event_create_dir(struct dentry *parent, struct trace_event_file *file)
 
 		trace_create_file("trigger", 0644, file->dir, file,
 				  &event_trigger_fops);
+
+		trace_create_file("sample", 0644, file->dir, file,
+				  &ftrace_event_sample_fops);
 	}
 
 #ifdef CONFIG_HIST_TRIGGERS
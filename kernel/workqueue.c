@@ -49,6 +49,7 @@
 #include <linux/moduleparam.h>
 #include <linux/uaccess.h>
 #include <linux/sched/isolation.h>
+#include <linux/sched/topology.h>
 #include <linux/nmi.h>
 #include <linux/kvm_para.h>
 
@@ -277,7 +278,7 @@ struct workqueue_struct {
 	/* hot fields used during command issue, aligned to cacheline */
 	unsigned int		flags ____cacheline_aligned; /* WQ: WQ_* flags */
 	struct pool_workqueue __percpu *cpu_pwqs; /* I: per-cpu pwqs */
-	struct pool_workqueue __rcu *numa_pwq_tbl[]; /* PWR: unbound pwqs indexed by node */
+	struct pool_workqueue __rcu *numa_pwq_tbl[]; /* PWR: unbound pwqs indexed by node or LLC pod */
 };
 
 static struct kmem_cache *pwq_cache;
@@ -292,6 +293,9 @@ module_param_named(disable_numa, wq_disable_numa, bool, 0444);
 static bool wq_power_efficient = IS_ENABLED(CONFIG_WQ_POWER_EFFICIENT_DEFAULT);
 module_param_named(power_efficient, wq_power_efficient, bool, 0444);
 
+static bool wq_cache_affinity_dfl;
+module_param_named(default_cache_affinity, wq_cache_affinity_dfl, bool, 0444);
+
 static bool wq_online;			/* can kworkers be created yet? */
 
 static bool wq_numa_enabled;		/* unbound NUMA affinity enabled */
@@ -299,6 +303,10 @@ static bool wq_numa_enabled;		/* unbound NUMA affinity enabled */
 /* buf for wq_update_unbound_numa_attrs(), protected by CPU hotplug exclusion */
 static struct workqueue_attrs *wq_update_unbound_numa_attrs_buf;
 
+static bool wq_cache_pods_ready;	/* LLC pods have been built */
+static int *wq_cache_pod;		/* first CPU of each CPU's LLC pod */
+static cpumask_var_t *wq_cache_pod_cpus; /* possible CPUs of each LLC pod */
+
 static DEFINE_MUTEX(wq_pool_mutex);	/* protects pools and workqueues list */
 static DEFINE_MUTEX(wq_pool_attach_mutex); /* protects worker attach/detach */
 static DEFINE_SPINLOCK(wq_mayday_lock);	/* protects wq->maydays list */
@@ -579,6 +587,49 @@ static struct pool_workqueue *unbound_pwq_by_node(struct workqueue_struct *wq,
 	return rcu_dereference_raw(wq->numa_pwq_tbl[node]);
 }
 
+/* should @attrs use LLC pods, and are they available yet? */
+static bool wq_cache_scoped(const struct workqueue_attrs *attrs)
+{
+	return attrs->affn_scope == WQ_AFFN_CACHE && wq_cache_pods_ready;
+}
+
+/* numa_pwq_tbl[] is indexed by node for NUMA scope and by CPU for LLC pods */
+static int wq_nr_pod_slots(void)
+{
+	return max_t(int, nr_node_ids, nr_cpu_ids);
+}
+
+/* is @slot a pod under the affinity scope of @attrs? */
+static bool wq_pod_slot_valid(const struct workqueue_attrs *attrs, int slot)
+{
+	if (wq_cache_scoped(attrs))
+		return slot < nr_cpu_ids && cpu_possible(slot) &&
+		       wq_cache_pod[slot] == slot;
+
+	return slot < nr_node_ids && node_possible(slot);
+}
+
+/**
+ * unbound_pwq_by_cpu - return the unbound pool_workqueue serving a CPU
+ * @wq: the target workqueue
+ * @cpu: the CPU the work item is issued on
+ *
+ * Same locking rules as unbound_pwq_by_node().  The affinity scope can
+ * change under us, but every slot of @wq->numa_pwq_tbl[] always points to
+ * a valid pwq, so racing with a scope change at worst picks a pwq which
+ * isn't local to @cpu.
+ *
+ * Return: The unbound pool_workqueue for @cpu.
+ */
+static struct pool_workqueue *unbound_pwq_by_cpu(struct workqueue_struct *wq,
+						 int cpu)
+{
+	if (wq_cache_scoped(wq->unbound_attrs))
+		return rcu_dereference_raw(wq->numa_pwq_tbl[wq_cache_pod[cpu]]);
+
+	return unbound_pwq_by_node(wq, cpu_to_node(cpu));
+}
+
 static unsigned int work_color_to_flags(int color)
 {
 	return color << WORK_STRUCT_COLOR_SHIFT;
@@ -1432,7 +1483,7 @@ static void __queue_work(int cpu, struct workqueue_struct *wq,
 	if (wq->flags & WQ_UNBOUND) {
 		if (req_cpu == WORK_CPU_UNBOUND)
 			cpu = wq_select_unbound_cpu(raw_smp_processor_id());
-		pwq = unbound_pwq_by_node(wq, cpu_to_node(cpu));
+		pwq = unbound_pwq_by_cpu(wq, cpu);
 	} else {
 		if (req_cpu == WORK_CPU_UNBOUND)
 			cpu = raw_smp_processor_id();
@@ -3387,10 +3438,12 @@ static void copy_workqueue_attrs(struct workqueue_attrs *to,
 	cpumask_copy(to->cpumask, from->cpumask);
 	/*
 	 * Unlike hash and equality test, this function doesn't ignore
-	 * ->no_numa as it is used for both pool and wq attrs.  Instead,
-	 * get_unbound_pool() explicitly clears ->no_numa after copying.
+	 * ->no_numa and ->affn_scope as they are used for both pool and wq
+	 * attrs.  Instead, get_unbound_pool() explicitly clears them after
+	 * copying.
 	 */
 	to->no_numa = from->no_numa;
+	to->affn_scope = from->affn_scope;
 }
 
 /* hash value of the content of @attr */
@@ -3631,10 +3684,11 @@ static struct worker_pool *get_unbound_pool(const struct workqueue_attrs *attrs)
 	pool->node = target_node;
 
 	/*
-	 * no_numa isn't a worker_pool attribute, always clear it.  See
-	 * 'struct workqueue_attrs' comments for detail.
+	 * no_numa and affn_scope aren't worker_pool attributes, always
+	 * clear them.  See 'struct workqueue_attrs' comments for detail.
 	 */
 	pool->attrs->no_numa = false;
+	pool->attrs->affn_scope = WQ_AFFN_NUMA;
 
 	if (worker_pool_assign_id(pool) < 0)
 		goto fail;
@@ -3819,43 +3873,53 @@ static struct pool_workqueue *alloc_unbound_pwq(struct workqueue_struct *wq,
 }
 
 /**
- * wq_calc_node_cpumask - calculate a wq_attrs' cpumask for the specified node
+ * wq_calc_pod_cpumask - calculate a wq_attrs' cpumask for the specified pod
  * @attrs: the wq_attrs of the default pwq of the target workqueue
- * @node: the target NUMA node
+ * @cache: whether @pod is an LLC pod rather than a NUMA node
+ * @pod: the target NUMA node or LLC pod
  * @cpu_going_down: if >= 0, the CPU to consider as offline
  * @cpumask: outarg, the resulting cpumask
  *
- * Calculate the cpumask a workqueue with @attrs should use on @node.  If
+ * Calculate the cpumask a workqueue with @attrs should use on @pod.  If
  * @cpu_going_down is >= 0, that cpu is considered offline during
  * calculation.  The result is stored in @cpumask.
  *
- * If NUMA affinity is not enabled, @attrs->cpumask is always used.  If
- * enabled and @node has online CPUs requested by @attrs, the returned
- * cpumask is the intersection of the possible CPUs of @node and
+ * If neither NUMA nor LLC affinity is enabled, @attrs->cpumask is always
+ * used.  If enabled and @pod has online CPUs requested by @attrs, the
+ * returned cpumask is the intersection of the possible CPUs of @pod and
  * @attrs->cpumask.
  *
- * The caller is responsible for ensuring that the cpumask of @node stays
+ * The caller is responsible for ensuring that the cpumask of @pod stays
  * stable.
  *
  * Return: %true if the resulting @cpumask is different from @attrs->cpumask,
  * %false if equal.
  */
-static bool wq_calc_node_cpumask(const struct workqueue_attrs *attrs, int node,
-				 int cpu_going_down, cpumask_t *cpumask)
+static bool wq_calc_pod_cpumask(const struct workqueue_attrs *attrs, bool cache,
+				int pod, int cpu_going_down, cpumask_t *cpumask)
 {
-	if (!wq_numa_enabled || attrs->no_numa)
-		goto use_dfl;
+	const struct cpumask *pod_cpus;
+
+	if (cache) {
+		pod_cpus = wq_cache_pod_cpus[pod];
+		cpumask_and(cpumask, pod_cpus, cpu_online_mask);
+	} else {
+		if (!wq_numa_enabled || attrs->no_numa)
+			goto use_dfl;
+		pod_cpus = wq_numa_possible_cpumask[pod];
+		cpumask_copy(cpumask, cpumask_of_node(pod));
+	}
 
-	/* does @node have any online CPUs @attrs wants? */
-	cpumask_and(cpumask, cpumask_of_node(node), attrs->cpumask);
+	/* does @pod have any online CPUs @attrs wants? */
+	cpumask_and(cpumask, cpumask, attrs->cpumask);
 	if (cpu_going_down >= 0)
 		cpumask_clear_cpu(cpu_going_down, cpumask);
 
 	if (cpumask_empty(cpumask))
 		goto use_dfl;
 
-	/* yeap, return possible CPUs in @node that @attrs wants */
-	cpumask_and(cpumask, attrs->cpumask, wq_numa_possible_cpumask[node]);
+	/* yeap, return possible CPUs in @pod that @attrs wants */
+	cpumask_and(cpumask, attrs->cpumask, pod_cpus);
 
 	if (cpumask_empty(cpumask)) {
 		pr_warn_once("WARNING: workqueue cpumask: online intersect > "
@@ -3870,9 +3934,9 @@ static bool wq_calc_node_cpumask(const struct workqueue_attrs *attrs, int node,
 	return false;
 }
 
-/* install @pwq into @wq's numa_pwq_tbl[] for @node and return the old pwq */
+/* install @pwq into @wq's numa_pwq_tbl[] for @pod and return the old pwq */
 static struct pool_workqueue *numa_pwq_tbl_install(struct workqueue_struct *wq,
-						   int node,
+						   int pod,
 						   struct pool_workqueue *pwq)
 {
 	struct pool_workqueue *old_pwq;
@@ -3883,8 +3947,8 @@ static struct pool_workqueue *numa_pwq_tbl_install(struct workqueue_struct *wq,
 	/* link_pwq() can handle duplicate calls */
 	link_pwq(pwq);
 
-	old_pwq = rcu_access_pointer(wq->numa_pwq_tbl[node]);
-	rcu_assign_pointer(wq->numa_pwq_tbl[node], pwq);
+	old_pwq = rcu_access_pointer(wq->numa_pwq_tbl[pod]);
+	rcu_assign_pointer(wq->numa_pwq_tbl[pod], pwq);
 	return old_pwq;
 }
 
@@ -3901,10 +3965,10 @@ struct apply_wqattrs_ctx {
 static void apply_wqattrs_cleanup(struct apply_wqattrs_ctx *ctx)
 {
 	if (ctx) {
-		int node;
+		int slot;
 
-		for_each_node(node)
-			put_pwq_unlocked(ctx->pwq_tbl[node]);
+		for (slot = 0; slot < wq_nr_pod_slots(); slot++)
+			put_pwq_unlocked(ctx->pwq_tbl[slot]);
 		put_pwq_unlocked(ctx->dfl_pwq);
 
 		free_workqueue_attrs(ctx->attrs);
@@ -3920,11 +3984,12 @@ apply_wqattrs_prepare(struct workqueue_struct *wq,
 {
 	struct apply_wqattrs_ctx *ctx;
 	struct workqueue_attrs *new_attrs, *tmp_attrs;
-	int node;
+	bool cache = wq_cache_scoped(attrs);
+	int slot;
 
 	lockdep_assert_held(&wq_pool_mutex);
 
-	ctx = kzalloc(struct_size(ctx, pwq_tbl, nr_node_ids), GFP_KERNEL);
+	ctx = kzalloc(struct_size(ctx, pwq_tbl, wq_nr_pod_slots()), GFP_KERNEL);
 
 	new_attrs = alloc_workqueue_attrs();
 	tmp_attrs = alloc_workqueue_attrs();
@@ -3957,14 +4022,21 @@ apply_wqattrs_prepare(struct workqueue_struct *wq,
 	if (!ctx->dfl_pwq)
 		goto out_free;
 
-	for_each_node(node) {
-		if (wq_calc_node_cpumask(new_attrs, node, -1, tmp_attrs->cpumask)) {
-			ctx->pwq_tbl[node] = alloc_unbound_pwq(wq, tmp_attrs);
-			if (!ctx->pwq_tbl[node])
+	/*
+	 * Slots which aren't pods under the current scope point to the
+	 * default pwq, so that unbound_pwq_by_cpu() never sees a NULL slot
+	 * while racing against a scope change.
+	 */
+	for (slot = 0; slot < wq_nr_pod_slots(); slot++) {
+		if (wq_pod_slot_valid(new_attrs, slot) &&
+		    wq_calc_pod_cpumask(new_attrs, cache, slot, -1,
+					tmp_attrs->cpumask)) {
+			ctx->pwq_tbl[slot] = alloc_unbound_pwq(wq, tmp_attrs);
+			if (!ctx->pwq_tbl[slot])
 				goto out_free;
 		} else {
 			ctx->dfl_pwq->refcnt++;
-			ctx->pwq_tbl[node] = ctx->dfl_pwq;
+			ctx->pwq_tbl[slot] = ctx->dfl_pwq;
 		}
 	}
 
@@ -3987,7 +4059,7 @@ apply_wqattrs_prepare(struct workqueue_struct *wq,
 /* set attrs and install prepared pwqs, @ctx points to old pwqs on return */
 static void apply_wqattrs_commit(struct apply_wqattrs_ctx *ctx)
 {
-	int node;
+	int slot;
 
 	/* all pwqs have been created successfully, let's install'em */
 	mutex_lock(&ctx->wq->mutex);
@@ -3995,9 +4067,9 @@ static void apply_wqattrs_commit(struct apply_wqattrs_ctx *ctx)
 	copy_workqueue_attrs(ctx->wq->unbound_attrs, ctx->attrs);
 
 	/* save the previous pwq and install the new one */
-	for_each_node(node)
-		ctx->pwq_tbl[node] = numa_pwq_tbl_install(ctx->wq, node,
-							  ctx->pwq_tbl[node]);
+	for (slot = 0; slot < wq_nr_pod_slots(); slot++)
+		ctx->pwq_tbl[slot] = numa_pwq_tbl_install(ctx->wq, slot,
+							  ctx->pwq_tbl[slot]);
 
 	/* @dfl_pwq might not have been used, ensure it's linked */
 	link_pwq(ctx->dfl_pwq);
@@ -4055,9 +4127,11 @@ static int apply_workqueue_attrs_locked(struct workqueue_struct *wq,
  * Apply @attrs to an unbound workqueue @wq.  Unless disabled, on NUMA
  * machines, this function maps a separate pwq to each NUMA node with
  * possibles CPUs in @attrs->cpumask so that work items are affine to the
- * NUMA node it was issued on.  Older pwqs are released as in-flight work
- * items finish.  Note that a work item which repeatedly requeues itself
- * back-to-back will stay on its current pwq.
+ * NUMA node it was issued on.  With @attrs->affn_scope set to
+ * %WQ_AFFN_CACHE, the same is done for each group of CPUs sharing the last
+ * level cache, on NUMA and non-NUMA machines alike.  Older pwqs are
+ * released as in-flight work items finish.  Note that a work item which
+ * repeatedly requeues itself back-to-back will stay on its current pwq.
  *
  * Performs GFP_KERNEL allocations.
  *
@@ -4104,18 +4178,24 @@ int apply_workqueue_attrs(struct workqueue_struct *wq,
 static void wq_update_unbound_numa(struct workqueue_struct *wq, int cpu,
 				   bool online)
 {
-	int node = cpu_to_node(cpu);
+	int pod;
 	int cpu_off = online ? -1 : cpu;
 	struct pool_workqueue *old_pwq = NULL, *pwq;
 	struct workqueue_attrs *target_attrs;
 	cpumask_t *cpumask;
+	bool cache;
 
 	lockdep_assert_held(&wq_pool_mutex);
 
-	if (!wq_numa_enabled || !(wq->flags & WQ_UNBOUND) ||
-	    wq->unbound_attrs->no_numa)
+	if (!(wq->flags & WQ_UNBOUND))
+		return;
+
+	cache = wq_cache_scoped(wq->unbound_attrs);
+	if (!cache && (!wq_numa_enabled || wq->unbound_attrs->no_numa))
 		return;
 
+	pod = cache ? wq_cache_pod[cpu] : cpu_to_node(cpu);
+
 	/*
 	 * We don't wanna alloc/free wq_attrs for each wq for each CPU.
 	 * Let's use a preallocated one.  The following buf is protected by
@@ -4125,7 +4205,7 @@ static void wq_update_unbound_numa(struct workqueue_struct *wq, int cpu,
 	cpumask = target_attrs->cpumask;
 
 	copy_workqueue_attrs(target_attrs, wq->unbound_attrs);
-	pwq = unbound_pwq_by_node(wq, node);
+	pwq = unbound_pwq_by_cpu(wq, cpu);
 
 	/*
 	 * Let's determine what needs to be done.  If the target cpumask is
@@ -4133,7 +4213,8 @@ static void wq_update_unbound_numa(struct workqueue_struct *wq, int cpu,
 	 * and create a new one if they don't match.  If the target cpumask
 	 * equals the default pwq's, the default pwq should be used.
 	 */
-	if (wq_calc_node_cpumask(wq->dfl_pwq->pool->attrs, node, cpu_off, cpumask)) {
+	if (wq_calc_pod_cpumask(wq->dfl_pwq->pool->attrs, cache, pod, cpu_off,
+				cpumask)) {
 		if (cpumask_equal(cpumask, pwq->pool->attrs->cpumask))
 			return;
 	} else {
@@ -4150,7 +4231,7 @@ static void wq_update_unbound_numa(struct workqueue_struct *wq, int cpu,
 
 	/* Install the new pwq. */
 	mutex_lock(&wq->mutex);
-	old_pwq = numa_pwq_tbl_install(wq, node, pwq);
+	old_pwq = numa_pwq_tbl_install(wq, pod, pwq);
 	goto out_unlock;
 
 use_dfl_pwq:
@@ -4158,7 +4239,7 @@ static void wq_update_unbound_numa(struct workqueue_struct *wq, int cpu,
 	spin_lock_irq(&wq->dfl_pwq->pool->lock);
 	get_pwq(wq->dfl_pwq);
 	spin_unlock_irq(&wq->dfl_pwq->pool->lock);
-	old_pwq = numa_pwq_tbl_install(wq, node, wq->dfl_pwq);
+	old_pwq = numa_pwq_tbl_install(wq, pod, wq->dfl_pwq);
 out_unlock:
 	mutex_unlock(&wq->mutex);
 	put_pwq_unlocked(old_pwq);
@@ -4273,7 +4354,7 @@ struct workqueue_struct *alloc_workqueue(const char *fmt,
 
 	/* allocate wq and format name */
 	if (flags & WQ_UNBOUND)
-		tbl_size = nr_node_ids * sizeof(wq->numa_pwq_tbl[0]);
+		tbl_size = wq_nr_pod_slots() * sizeof(wq->numa_pwq_tbl[0]);
 
 	wq = kzalloc(sizeof(*wq) + tbl_size, GFP_KERNEL);
 	if (!wq)
@@ -4354,7 +4435,7 @@ EXPORT_SYMBOL_GPL(alloc_workqueue);
 void destroy_workqueue(struct workqueue_struct *wq)
 {
 	struct pool_workqueue *pwq;
-	int node;
+	int slot;
 
 	/*
 	 * Remove it from sysfs first so that sanity check failure doesn't
@@ -4423,9 +4504,9 @@ void destroy_workqueue(struct workqueue_struct *wq)
 		 * access numa_pwq_tbl[] and dfl_pwq to put the base refs.
 		 * @wq will be freed when the last pwq is released.
 		 */
-		for_each_node(node) {
-			pwq = rcu_access_pointer(wq->numa_pwq_tbl[node]);
-			RCU_INIT_POINTER(wq->numa_pwq_tbl[node], NULL);
+		for (slot = 0; slot < wq_nr_pod_slots(); slot++) {
+			pwq = rcu_access_pointer(wq->numa_pwq_tbl[slot]);
+			RCU_INIT_POINTER(wq->numa_pwq_tbl[slot], NULL);
 			put_pwq_unlocked(pwq);
 		}
 
@@ -4535,7 +4616,7 @@ bool workqueue_congested(int cpu, struct workqueue_struct *wq)
 	if (!(wq->flags & WQ_UNBOUND))
 		pwq = per_cpu_ptr(wq->cpu_pwqs, cpu);
 	else
-		pwq = unbound_pwq_by_node(wq, cpu_to_node(cpu));
+		pwq = unbound_pwq_by_cpu(wq, cpu);
 
 	ret = !list_empty(&pwq->delayed_works);
 	preempt_enable();
@@ -5358,10 +5439,11 @@ int workqueue_set_unbound_cpumask(cpumask_var_t cpumask)
  *
  * Unbound workqueues have the following extra attributes.
  *
- *  pool_ids	RO int	: the associated pool IDs for each node
+ *  pool_ids	RO int	: the associated pool IDs for each node or LLC pod
  *  nice	RW int	: nice value of the workers
  *  cpumask	RW mask	: bitmask of allowed CPUs for the workers
  *  numa	RW bool	: whether enable NUMA affinity
+ *  affinity_scope RW str : "numa" or "cache", pool per node or per LLC pod
  */
 struct wq_device {
 	struct workqueue_struct		*wq;
@@ -5419,14 +5501,16 @@ static ssize_t wq_pool_ids_show(struct device *dev,
 {
 	struct workqueue_struct *wq = dev_to_wq(dev);
 	const char *delim = "";
-	int node, written = 0;
+	int slot, written = 0;
 
 	get_online_cpus();
 	rcu_read_lock();
-	for_each_node(node) {
+	for (slot = 0; slot < wq_nr_pod_slots(); slot++) {
+		if (!wq_pod_slot_valid(wq->unbound_attrs, slot))
+			continue;
 		written += scnprintf(buf + written, PAGE_SIZE - written,
-				     "%s%d:%d", delim, node,
-				     unbound_pwq_by_node(wq, node)->pool->id);
+				     "%s%d:%d", delim, slot,
+				     unbound_pwq_by_node(wq, slot)->pool->id);
 		delim = " ";
 	}
 	written += scnprintf(buf + written, PAGE_SIZE - written, "\n");
@@ -5565,11 +5649,58 @@ static ssize_t wq_numa_store(struct device *dev, struct device_attribute *attr,
 	return ret ?: count;
 }
 
+static const char * const wq_affn_names[WQ_AFFN_NR_SCOPES] = {
+	[WQ_AFFN_NUMA]	= "numa",
+	[WQ_AFFN_CACHE]	= "cache",
+};
+
+static ssize_t wq_affn_scope_show(struct device *dev,
+				  struct device_attribute *attr, char *buf)
+{
+	struct workqueue_struct *wq = dev_to_wq(dev);
+	int written;
+
+	mutex_lock(&wq->mutex);
+	written = scnprintf(buf, PAGE_SIZE, "%s\n",
+			    wq_affn_names[wq->unbound_attrs->affn_scope]);
+	mutex_unlock(&wq->mutex);
+
+	return written;
+}
+
+static ssize_t wq_affn_scope_store(struct device *dev,
+				   struct device_attribute *attr,
+				   const char *buf, size_t count)
+{
+	struct workqueue_struct *wq = dev_to_wq(dev);
+	struct workqueue_attrs *attrs;
+	int scope, ret = -ENOMEM;
+
+	scope = sysfs_match_string(wq_affn_names, buf);
+	if (scope < 0)
+		return scope;
+
+	apply_wqattrs_lock();
+
+	attrs = wq_sysfs_prep_attrs(wq);
+	if (!attrs)
+		goto out_unlock;
+
+	attrs->affn_scope = scope;
+	ret = apply_workqueue_attrs_locked(wq, attrs);
+
+out_unlock:
+	apply_wqattrs_unlock();
+	free_workqueue_attrs(attrs);
+	return ret ?: count;
+}
+
 static struct device_attribute wq_sysfs_unbound_attrs[] = {
 	__ATTR(pool_ids, 0444, wq_pool_ids_show, NULL),
 	__ATTR(nice, 0644, wq_nice_show, wq_nice_store),
 	__ATTR(cpumask, 0644, wq_cpumask_show, wq_cpumask_store),
 	__ATTR(numa, 0644, wq_numa_show, wq_numa_store),
+	__ATTR(affinity_scope, 0644, wq_affn_scope_show, wq_affn_scope_store),
 	__ATTR_NULL,
 };
 
@@ -5916,6 +6047,70 @@ static void __init wq_numa_init(void)
 	wq_numa_enabled = true;
 }
 
+/*
+ * LLC pods need the scheduler's cache topology, which isn't available
+ * until the secondary CPUs are up and sched domains are built, well after
+ * workqueue_init().  Until then, workqueues asking for LLC affinity use
+ * NUMA affinity and get switched over here.
+ */
+static int __init wq_cache_pods_init(void)
+{
+	struct workqueue_struct *wq;
+	int cpu, pre;
+
+	if (!wq_update_unbound_numa_attrs_buf) {
+		wq_update_unbound_numa_attrs_buf = alloc_workqueue_attrs();
+		BUG_ON(!wq_update_unbound_numa_attrs_buf);
+	}
+
+	wq_cache_pod = kcalloc(nr_cpu_ids, sizeof(wq_cache_pod[0]), GFP_KERNEL);
+	wq_cache_pod_cpus = kcalloc(nr_cpu_ids, sizeof(wq_cache_pod_cpus[0]),
+				    GFP_KERNEL);
+	BUG_ON(!wq_cache_pod || !wq_cache_pod_cpus);
+
+	/*
+	 * Each CPU joins the pod of the first CPU it shares the LLC with.
+	 * CPUs which aren't online yet have no cache topology and stay in
+	 * a pod of their own.
+	 */
+	for_each_possible_cpu(cpu) {
+		BUG_ON(!zalloc_cpumask_var(&wq_cache_pod_cpus[cpu], GFP_KERNEL));
+		wq_cache_pod[cpu] = cpu;
+
+		if (!cpu_online(cpu))
+			continue;
+
+		for_each_online_cpu(pre) {
+			if (pre >= cpu)
+				break;
+			if (cpus_share_cache(cpu, pre)) {
+				wq_cache_pod[cpu] = wq_cache_pod[pre];
+				break;
+			}
+		}
+	}
+
+	for_each_possible_cpu(cpu)
+		cpumask_set_cpu(cpu, wq_cache_pod_cpus[wq_cache_pod[cpu]]);
+
+	apply_wqattrs_lock();
+	wq_cache_pods_ready = true;
+
+	list_for_each_entry(wq, &workqueues, list) {
+		if (!(wq->flags & WQ_UNBOUND) ||
+		    wq->unbound_attrs->affn_scope != WQ_AFFN_CACHE)
+			continue;
+		WARN(apply_workqueue_attrs_locked(wq, wq->unbound_attrs),
+		     "workqueue: failed to apply LLC affinity to %s\n",
+		     wq->name);
+	}
+
+	apply_wqattrs_unlock();
+
+	return 0;
+}
+core_initcall(wq_cache_pods_init);
+
 /**
  * workqueue_init_early - early init for workqueue subsystem
  *
@@ -5964,6 +6159,8 @@ int __init workqueue_init_early(void)
 
 		BUG_ON(!(attrs = alloc_workqueue_attrs()));
 		attrs->nice = std_nice[i];
+		if (wq_cache_affinity_dfl)
+			attrs->affn_scope = WQ_AFFN_CACHE;
 		unbound_std_wq_attrs[i] = attrs;
 
 		/*
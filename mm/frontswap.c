@@ -324,6 +324,71 @@ int __frontswap_load(struct page *page)
 }
 EXPORT_SYMBOL(__frontswap_load);
 
+/*
+ * Batched __frontswap_load(), for swap readahead: a backend implementing
+ * load_batch can look up and release all the pages under one acquisition
+ * of its locks instead of one per page. ret[i] is set to what
+ * __frontswap_load(pages[i]) would have returned.
+ */
+void __frontswap_load_batch(struct page **pages, int *ret, int nr)
+{
+	swp_entry_t entry = { .val = page_private(pages[0]), };
+	int type = swp_type(entry);
+	struct swap_info_struct *sis = swap_info[type];
+	pgoff_t offsets[FRONTSWAP_LOAD_BATCH], todo_offsets[FRONTSWAP_LOAD_BATCH];
+	struct page *todo[FRONTSWAP_LOAD_BATCH];
+	int todo_ret[FRONTSWAP_LOAD_BATCH], idx[FRONTSWAP_LOAD_BATCH];
+	struct frontswap_ops *ops;
+	int i, n;
+
+	VM_BUG_ON(!frontswap_ops);
+	VM_BUG_ON(nr > FRONTSWAP_LOAD_BATCH);
+	VM_BUG_ON(sis == NULL);
+
+	for (i = 0; i < nr; i++) {
+		entry.val = page_private(pages[i]);
+		VM_BUG_ON(!PageLocked(pages[i]));
+		VM_BUG_ON(swp_type(entry) != type);
+		offsets[i] = swp_offset(entry);
+		ret[i] = -1;
+	}
+
+	/* Try loading from each implementation, until one succeeds. */
+	for_each_frontswap_ops(ops) {
+		n = 0;
+		for (i = 0; i < nr; i++) {
+			if (!ret[i] || !__frontswap_test(sis, offsets[i]))
+				continue;
+			idx[n] = i;
+			todo[n] = pages[i];
+			todo_offsets[n] = offsets[i];
+			n++;
+		}
+		if (!n)
+			break;
+
+		if (ops->load_batch)
+			ops->load_batch(type, todo_offsets, todo, todo_ret, n);
+		else
+			for (i = 0; i < n; i++)
+				todo_ret[i] = ops->load(type, todo_offsets[i],
+							todo[i]);
+		for (i = 0; i < n; i++)
+			ret[idx[i]] = todo_ret[i];
+	}
+
+	for (i = 0; i < nr; i++) {
+		if (ret[i])
+			continue;
+		inc_frontswap_loads();
+		if (frontswap_tmem_exclusive_gets_enabled) {
+			SetPageDirty(pages[i]);
+			__frontswap_clear(sis, offsets[i]);
+		}
+	}
+}
+EXPORT_SYMBOL(__frontswap_load_batch);
+
 /*
  * Invalidate any data from frontswap associated with the specified swaptype
  * and offset so that a subsequent "get" will fail.
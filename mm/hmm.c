@@ -148,10 +148,34 @@ static void hmm_invalidate_range_end(struct mmu_notifier *mn,
 	notifiers_decrement(hmm);
 }
 
+static int hmm_range_busy(struct mmu_notifier *mn, struct mm_struct *mm,
+			  unsigned long start, unsigned long end)
+{
+	struct hmm *hmm = container_of(mn, struct hmm, mmu_notifier);
+	struct hmm_mirror *mirror;
+	int busy = 0;
+
+	/* Mirrors coming or going, let the invalidation sort it out */
+	if (!down_read_trylock(&hmm->mirrors_sem))
+		return 0;
+
+	list_for_each_entry(mirror, &hmm->mirrors, list) {
+		if (mirror->ops->range_busy &&
+		    mirror->ops->range_busy(mirror, start, end)) {
+			busy = 1;
+			break;
+		}
+	}
+	up_read(&hmm->mirrors_sem);
+
+	return busy;
+}
+
 static const struct mmu_notifier_ops hmm_mmu_notifier_ops = {
 	.release		= hmm_release,
 	.invalidate_range_start	= hmm_invalidate_range_start,
 	.invalidate_range_end	= hmm_invalidate_range_end,
+	.range_busy		= hmm_range_busy,
 	.alloc_notifier		= hmm_alloc_notifier,
 	.free_notifier		= hmm_free_notifier,
 };
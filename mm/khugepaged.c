@@ -49,6 +49,7 @@ enum scan_result {
 	SCAN_EXCEED_SWAP_PTE,
 	SCAN_TRUNCATED,
 	SCAN_PAGE_HAS_PRIVATE,
+	SCAN_DEVICE_BUSY,
 };
 
 #define CREATE_TRACE_POINTS
@@ -1241,6 +1242,16 @@ static int khugepaged_scan_pmd(struct mm_struct *mm,
 	}
 out_unmap:
 	pte_unmap_unlock(pte, ptl);
+	/*
+	 * Pages that a GPU is working on right now would make the
+	 * invalidation in collapse_huge_page() wait for it with the
+	 * mmap_sem held for write. Come back on the next pass instead.
+	 */
+	if (ret && mmu_notifier_range_busy(mm, address,
+					   address + HPAGE_PMD_SIZE)) {
+		result = SCAN_DEVICE_BUSY;
+		ret = 0;
+	}
 	if (ret) {
 		node = khugepaged_find_target_node();
 		/* collapse_huge_page will return with the mmap_sem released */
@@ -272,6 +272,9 @@ static unsigned int ksm_thread_pages_to_scan = 100;
 /* Milliseconds ksmd should sleep between batches */
 static unsigned int ksm_thread_sleep_millisecs = 20;
 
+/* Scale the batch with memory pressure, up to this many times pages_to_scan */
+static unsigned int ksm_auto_tune_max_boost;
+
 /* Checksum of an empty (zeroed) page */
 static unsigned int zero_checksum __read_mostly;
 
@@ -1919,6 +1922,11 @@ static struct stable_node *stable_tree_insert(struct page *kpage)
  *
  * This function does both searching and inserting, because they share
  * the same walking algorithm in an rbtree.
+ *
+ * The tree is ordered by checksum first and page contents second, so
+ * most nodes are passed over on their cached checksum alone, without
+ * looking up and comparing the page behind them.  A node's oldchecksum
+ * does not change while it sits in the unstable tree.
  */
 static
 struct rmap_item *unstable_tree_search_insert(struct rmap_item *rmap_item,
@@ -1941,6 +1949,17 @@ struct rmap_item *unstable_tree_search_insert(struct rmap_item *rmap_item,
 
 		cond_resched();
 		tree_rmap_item = rb_entry(*new, struct rmap_item, node);
+
+		/* Fast reject: pages with different checksums differ */
+		if (rmap_item->oldchecksum != tree_rmap_item->oldchecksum) {
+			parent = *new;
+			if (rmap_item->oldchecksum < tree_rmap_item->oldchecksum)
+				new = &parent->rb_left;
+			else
+				new = &parent->rb_right;
+			continue;
+		}
+
 		tree_page = get_mergeable_page(tree_rmap_item);
 		if (!tree_page)
 			return NULL;
@@ -2381,6 +2400,33 @@ static struct rmap_item *scan_get_next_rmap_item(struct page **page)
 	return NULL;
 }
 
+/*
+ * ksm_scan_batch - number of pages ksmd should scan in its next batch.
+ *
+ * With auto_tune_max_boost set, the batch grows linearly from
+ * pages_to_scan once available memory drops below half of RAM, up to
+ * max_boost times pages_to_scan when nothing is left: dedup matters most
+ * when the machine is about to reclaim.
+ */
+static unsigned int ksm_scan_batch(void)
+{
+	unsigned int pages = READ_ONCE(ksm_thread_pages_to_scan);
+	unsigned int boost = READ_ONCE(ksm_auto_tune_max_boost);
+	unsigned long half, avail;
+	u64 extra;
+
+	if (boost <= 1)
+		return pages;
+
+	half = totalram_pages() / 2;
+	avail = si_mem_available();
+	if (!half || avail >= half)
+		return pages;
+
+	extra = div64_u64((u64)pages * (boost - 1) * (half - avail), half);
+	return min_t(u64, (u64)pages + extra, UINT_MAX);
+}
+
 /**
  * ksm_do_scan  - the ksm scanner main worker function.
  * @scan_npages:  number of pages we want to scan before we return.
@@ -2416,7 +2462,7 @@ static int ksm_scan_thread(void *nothing)
 		mutex_lock(&ksm_thread_mutex);
 		wait_while_offlining();
 		if (ksmd_should_run())
-			ksm_do_scan(ksm_thread_pages_to_scan);
+			ksm_do_scan(ksm_scan_batch());
 		mutex_unlock(&ksm_thread_mutex);
 
 		try_to_freeze();
@@ -2898,6 +2944,29 @@ static ssize_t pages_to_scan_store(struct kobject *kobj,
 }
 KSM_ATTR(pages_to_scan);
 
+static ssize_t auto_tune_max_boost_show(struct kobject *kobj,
+					struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_auto_tune_max_boost);
+}
+
+static ssize_t auto_tune_max_boost_store(struct kobject *kobj,
+					 struct kobj_attribute *attr,
+					 const char *buf, size_t count)
+{
+	unsigned int boost;
+	int err;
+
+	err = kstrtouint(buf, 10, &boost);
+	if (err || boost > 64)
+		return -EINVAL;
+
+	ksm_auto_tune_max_boost = boost;
+
+	return count;
+}
+KSM_ATTR(auto_tune_max_boost);
+
 static ssize_t run_show(struct kobject *kobj, struct kobj_attribute *attr,
 			char *buf)
 {
@@ -3155,6 +3224,7 @@ KSM_ATTR_RO(full_scans);
 static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
+	&auto_tune_max_boost_attr.attr,
 	&run_attr.attr,
 	&pages_shared_attr.attr,
 	&pages_sharing_attr.attr,
@@ -261,7 +261,8 @@ long memfd_fcntl(struct file *file, unsigned int cmd, unsigned long arg)
 #define MFD_NAME_PREFIX_LEN (sizeof(MFD_NAME_PREFIX) - 1)
 #define MFD_NAME_MAX_LEN (NAME_MAX - MFD_NAME_PREFIX_LEN)
 
-#define MFD_ALL_FLAGS (MFD_CLOEXEC | MFD_ALLOW_SEALING | MFD_HUGETLB)
+#define MFD_ALL_FLAGS (MFD_CLOEXEC | MFD_ALLOW_SEALING | MFD_HUGETLB | \
+		       MFD_HUGEPAGE)
 
 SYSCALL_DEFINE2(memfd_create,
 		const char __user *, uname,
@@ -281,6 +282,9 @@ SYSCALL_DEFINE2(memfd_create,
 		if (flags & ~(unsigned int)(MFD_ALL_FLAGS |
 				(MFD_HUGE_MASK << MFD_HUGE_SHIFT)))
 			return -EINVAL;
+		/* hugetlbfs pages are huge already */
+		if (flags & MFD_HUGEPAGE)
+			return -EINVAL;
 	}
 
 	/* length includes terminating zero */
@@ -325,6 +329,12 @@ SYSCALL_DEFINE2(memfd_create,
 		error = PTR_ERR(file);
 		goto err_fd;
 	}
+	/*
+	 * Ask shmem for huge pages regardless of the shm_mnt huge= policy;
+	 * it falls back to small pages when a huge one can't be allocated.
+	 */
+	if (flags & MFD_HUGEPAGE)
+		SHMEM_I(file_inode(file))->flags |= VM_HUGEPAGE;
 	file->f_mode |= FMODE_LSEEK | FMODE_PREAD | FMODE_PWRITE;
 	file->f_flags |= O_LARGEFILE;
 
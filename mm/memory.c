@@ -3060,6 +3060,12 @@ vm_fault_t do_swap_page(struct vm_fault *vmf)
 		activate_page(page);
 	}
 
+	/*
+	 * Without shadow entries for anon there is no refault distance,
+	 * but anything coming back from swap was evicted once already.
+	 */
+	lru_note_refault(mem_cgroup_lruvec(page_pgdat(page), memcg), 0, 1);
+
 	swap_free(entry);
 	if (mem_cgroup_swap_full(page) ||
 	    (vma->vm_flags & VM_LOCKED) || PageMlocked(page))
@@ -145,6 +145,26 @@ int __mmu_notifier_test_young(struct mm_struct *mm,
 	return young;
 }
 
+int __mmu_notifier_range_busy(struct mm_struct *mm,
+			      unsigned long start,
+			      unsigned long end)
+{
+	struct mmu_notifier *mn;
+	int busy = 0, id;
+
+	id = srcu_read_lock(&srcu);
+	hlist_for_each_entry_rcu(mn, &mm->mmu_notifier_mm->list, hlist) {
+		if (mn->ops->range_busy) {
+			busy = mn->ops->range_busy(mn, mm, start, end);
+			if (busy)
+				break;
+		}
+	}
+	srcu_read_unlock(&srcu, id);
+
+	return busy;
+}
+
 void __mmu_notifier_change_pte(struct mm_struct *mm, unsigned long address,
 			       pte_t pte)
 {
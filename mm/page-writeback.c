@@ -713,6 +713,24 @@ int bdi_set_max_ratio(struct backing_dev_info *bdi, unsigned max_ratio)
 }
 EXPORT_SYMBOL(bdi_set_max_ratio);
 
+/*
+ * With a strict limit a bdi is throttled against its own share of the dirty
+ * threshold, which follows its measured writeout rate, even while the global
+ * dirty count is below the freerun ceiling.  That keeps a slow device from
+ * filling the dirty pool that writers to faster devices share with it.
+ */
+int bdi_set_strict_limit(struct backing_dev_info *bdi, bool strict_limit)
+{
+	spin_lock_bh(&bdi_lock);
+	if (strict_limit)
+		bdi->capabilities |= BDI_CAP_STRICTLIMIT;
+	else
+		bdi->capabilities &= ~BDI_CAP_STRICTLIMIT;
+	spin_unlock_bh(&bdi_lock);
+
+	return 0;
+}
+
 static unsigned long dirty_freerun_ceiling(unsigned long thresh,
 					   unsigned long bg_thresh)
 {
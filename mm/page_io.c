@@ -293,7 +293,8 @@ int __swap_writepage(struct page *page, struct writeback_control *wbc,
 	return ret;
 }
 
-int swap_readpage(struct page *page, bool synchronous)
+/* Read a page that frontswap didn't have from the swap device */
+static int __swap_readpage(struct page *page, bool synchronous)
 {
 	struct bio *bio;
 	int ret = 0;
@@ -301,15 +302,6 @@ int swap_readpage(struct page *page, bool synchronous)
 	blk_qc_t qc;
 	struct gendisk *disk;
 
-	VM_BUG_ON_PAGE(!PageSwapCache(page) && !synchronous, page);
-	VM_BUG_ON_PAGE(!PageLocked(page), page);
-	VM_BUG_ON_PAGE(PageUptodate(page), page);
-	if (frontswap_load(page) == 0) {
-		SetPageUptodate(page);
-		unlock_page(page);
-		goto out;
-	}
-
 	if (sis->flags & SWP_FS) {
 		struct file *swap_file = sis->swap_file;
 		struct address_space *mapping = swap_file->f_mapping;
@@ -362,6 +354,47 @@ int swap_readpage(struct page *page, bool synchronous)
 	return ret;
 }
 
+int swap_readpage(struct page *page, bool synchronous)
+{
+	VM_BUG_ON_PAGE(!PageSwapCache(page) && !synchronous, page);
+	VM_BUG_ON_PAGE(!PageLocked(page), page);
+	VM_BUG_ON_PAGE(PageUptodate(page), page);
+	if (frontswap_load(page) == 0) {
+		SetPageUptodate(page);
+		unlock_page(page);
+		return 0;
+	}
+
+	return __swap_readpage(page, synchronous);
+}
+
+/*
+ * swap_readpage(page, false) on each of up to FRONTSWAP_LOAD_BATCH swap
+ * cache pages of the same swap type, with a single frontswap call for all
+ * of them. Used by swap readahead.
+ */
+void swap_readpage_batch(struct page **pages, int nr)
+{
+	int ret[FRONTSWAP_LOAD_BATCH];
+	int i;
+
+	for (i = 0; i < nr; i++) {
+		VM_BUG_ON_PAGE(!PageSwapCache(pages[i]), pages[i]);
+		VM_BUG_ON_PAGE(!PageLocked(pages[i]), pages[i]);
+		VM_BUG_ON_PAGE(PageUptodate(pages[i]), pages[i]);
+	}
+
+	frontswap_load_batch(pages, ret, nr);
+	for (i = 0; i < nr; i++) {
+		if (ret[i] == 0) {
+			SetPageUptodate(pages[i]);
+			unlock_page(pages[i]);
+		} else {
+			__swap_readpage(pages[i], false);
+		}
+	}
+}
+
 int swap_set_page_dirty(struct page *page)
 {
 	struct swap_info_struct *sis = page_swap_info(page);
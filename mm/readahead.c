@@ -381,7 +381,7 @@ static int try_context_readahead(struct address_space *mapping,
 static unsigned long
 ondemand_readahead(struct address_space *mapping,
 		   struct file_ra_state *ra, struct file *filp,
-		   bool hit_readahead_marker, pgoff_t offset,
+		   bool hit_readahead_marker, bool stalled, pgoff_t offset,
 		   unsigned long req_size)
 {
 	struct backing_dev_info *bdi = inode_to_bdi(mapping->host);
@@ -409,7 +409,10 @@ ondemand_readahead(struct address_space *mapping,
 	if ((offset == (ra->start + ra->size - ra->async_size) ||
 	     offset == (ra->start + ra->size))) {
 		ra->start += ra->size;
-		ra->size = get_next_ra_size(ra, max_pages);
+		if (stalled)
+			ra->size = max_pages;
+		else
+			ra->size = get_next_ra_size(ra, max_pages);
 		ra->async_size = ra->size;
 		goto readit;
 	}
@@ -524,7 +527,7 @@ void page_cache_sync_readahead(struct address_space *mapping,
 	}
 
 	/* do read-ahead */
-	ondemand_readahead(mapping, ra, filp, false, offset, req_size);
+	ondemand_readahead(mapping, ra, filp, false, false, offset, req_size);
 }
 EXPORT_SYMBOL_GPL(page_cache_sync_readahead);
 
@@ -549,6 +552,8 @@ page_cache_async_readahead(struct address_space *mapping,
 			   struct page *page, pgoff_t offset,
 			   unsigned long req_size)
 {
+	bool stalled;
+
 	/* no read-ahead */
 	if (!ra->ra_pages)
 		return;
@@ -570,8 +575,17 @@ page_cache_async_readahead(struct address_space *mapping,
 	if (blk_cgroup_congested())
 		return;
 
+	/*
+	 * If the marked page is still under read, the reader has caught up
+	 * with the previous window and is about to wait on the device. On
+	 * high latency devices the ramp then never keeps enough in flight,
+	 * so optionally go straight to the full window.
+	 */
+	stalled = inode_to_bdi(mapping->host)->ra_stall_ramp &&
+		  !PageUptodate(page);
+
 	/* do read-ahead */
-	ondemand_readahead(mapping, ra, filp, true, offset, req_size);
+	ondemand_readahead(mapping, ra, filp, true, stalled, offset, req_size);
 }
 EXPORT_SYMBOL_GPL(page_cache_async_readahead);
 
@@ -605,6 +605,13 @@ static inline bool is_huge_enabled(struct shmem_sb_info *sbinfo)
 	return false;
 }
 
+/* Huge pages requested for this inode alone, see MFD_HUGEPAGE */
+static inline bool is_inode_huge(struct shmem_inode_info *info)
+{
+	return IS_ENABLED(CONFIG_TRANSPARENT_HUGE_PAGECACHE) &&
+	       (info->flags & VM_HUGEPAGE) && shmem_huge != SHMEM_HUGE_DENY;
+}
+
 /*
  * Like add_to_page_cache_locked, but error if expected item has gone.
  */
@@ -1013,7 +1020,7 @@ static int shmem_getattr(const struct path *path, struct kstat *stat,
 	}
 	generic_fillattr(inode, stat);
 
-	if (is_huge_enabled(sb_info))
+	if (is_huge_enabled(sb_info) || is_inode_huge(info))
 		stat->blksize = HPAGE_PMD_SIZE;
 
 	return 0;
@@ -1814,7 +1821,7 @@ static int shmem_getpage_gfp(struct inode *inode, pgoff_t index,
 		goto alloc_nohuge;
 	if (shmem_huge == SHMEM_HUGE_DENY || sgp_huge == SGP_NOHUGE)
 		goto alloc_nohuge;
-	if (shmem_huge == SHMEM_HUGE_FORCE)
+	if (shmem_huge == SHMEM_HUGE_FORCE || is_inode_huge(info))
 		goto alloc_huge;
 	switch (sbinfo->huge) {
 		loff_t i_size;
@@ -2122,6 +2129,8 @@ unsigned long shmem_get_unmapped_area(struct file *file,
 
 		if (file) {
 			VM_BUG_ON(file->f_op != &shmem_file_operations);
+			if (is_inode_huge(SHMEM_I(file_inode(file))))
+				goto align;
 			sb = file_inode(file)->i_sb;
 		} else {
 			/*
@@ -2136,6 +2145,7 @@ unsigned long shmem_get_unmapped_area(struct file *file,
 			return addr;
 	}
 
+align:
 	offset = (pgoff << PAGE_SHIFT) & (HPAGE_PMD_SIZE-1);
 	if (offset && offset + len < 2 * HPAGE_PMD_SIZE)
 		return addr;
@@ -4002,6 +4012,8 @@ bool shmem_huge_enabled(struct vm_area_struct *vma)
 		return true;
 	if (shmem_huge == SHMEM_HUGE_DENY)
 		return false;
+	if (is_inode_huge(SHMEM_I(inode)))
+		return true;
 	switch (sbinfo->huge) {
 		case SHMEM_HUGE_NEVER:
 			return false;
@@ -2224,18 +2224,17 @@ static void deactivate_slab(struct kmem_cache *s, struct page *page,
  * for the cpu using c (or some other guarantee must be there
  * to guarantee no concurrent accesses).
  */
-static void unfreeze_partials(struct kmem_cache *s,
-		struct kmem_cache_cpu *c)
+static void __unfreeze_partials(struct kmem_cache *s, struct page *partial)
 {
 #ifdef CONFIG_SLUB_CPU_PARTIAL
 	struct kmem_cache_node *n = NULL, *n2 = NULL;
 	struct page *page, *discard_page = NULL;
 
-	while ((page = c->partial)) {
+	while ((page = partial)) {
 		struct page new;
 		struct page old;
 
-		c->partial = page->next;
+		partial = page->next;
 
 		n2 = get_node(s, page_to_nid(page));
 		if (n != n2) {
@@ -2285,6 +2284,139 @@ static void unfreeze_partials(struct kmem_cache *s,
 #endif	/* CONFIG_SLUB_CPU_PARTIAL */
 }
 
+static void unfreeze_partials(struct kmem_cache *s,
+		struct kmem_cache_cpu *c)
+{
+#ifdef CONFIG_SLUB_CPU_PARTIAL
+	struct page *partial = c->partial;
+
+	if (partial) {
+		c->partial = NULL;
+		__unfreeze_partials(s, partial);
+	}
+#endif	/* CONFIG_SLUB_CPU_PARTIAL */
+}
+
+#ifdef CONFIG_SLUB_CLUSTER_PARTIAL
+/*
+ * A cpu partial list that overflows goes to the cluster first, still
+ * frozen, so a sibling sharing the L2 picks up its cache-warm objects
+ * instead of the slabs going back to the node for all CPUs to fight over.
+ */
+static struct kmem_cache_cluster *cluster_of(struct kmem_cache *s, int cpu)
+{
+	unsigned int first = cpumask_first(cpu_coregroup_mask(cpu));
+
+	/* No topology yet this early in boot */
+	if (first >= nr_cpu_ids)
+		return NULL;
+	return per_cpu_ptr(s->cluster, first);
+}
+
+/* Called with interrupts disabled */
+static bool put_cluster_partial(struct kmem_cache *s, struct kmem_cache_cpu *c)
+{
+	struct kmem_cache_cluster *cl = cluster_of(s, smp_processor_id());
+	bool done = false;
+
+	if (!cl || !c->partial)
+		return false;
+
+	spin_lock(&cl->lock);
+	if (cl->nr < SLUB_CLUSTER_BATCHES) {
+		cl->batch[cl->nr++] = c->partial;
+		c->partial = NULL;
+		done = true;
+	}
+	spin_unlock(&cl->lock);
+
+	if (done)
+		stat(s, CLUSTER_PARTIAL_PUT);
+	return done;
+}
+
+/* Called with interrupts disabled, with no cpu partial list */
+static bool get_cluster_partial(struct kmem_cache *s, struct kmem_cache_cpu *c)
+{
+	struct kmem_cache_cluster *cl = cluster_of(s, smp_processor_id());
+
+	if (!cl || !READ_ONCE(cl->nr))
+		return false;
+
+	spin_lock(&cl->lock);
+	if (cl->nr)
+		c->partial = cl->batch[--cl->nr];
+	spin_unlock(&cl->lock);
+
+	if (!c->partial)
+		return false;
+	stat(s, CLUSTER_PARTIAL_ALLOC);
+	return true;
+}
+
+static void flush_cluster_partial(struct kmem_cache *s, int cpu)
+{
+	struct kmem_cache_cluster *cl = per_cpu_ptr(s->cluster, cpu);
+	struct page *batch[SLUB_CLUSTER_BATCHES];
+	unsigned long flags;
+	unsigned int i, nr;
+
+	if (!READ_ONCE(cl->nr))
+		return;
+
+	spin_lock_irqsave(&cl->lock, flags);
+	nr = cl->nr;
+	memcpy(batch, cl->batch, nr * sizeof(batch[0]));
+	cl->nr = 0;
+	spin_unlock(&cl->lock);
+
+	for (i = 0; i < nr; i++)
+		__unfreeze_partials(s, batch[i]);
+	local_irq_restore(flags);
+}
+
+static void flush_cluster_partials(struct kmem_cache *s)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		flush_cluster_partial(s, cpu);
+}
+
+static int alloc_kmem_cache_cluster(struct kmem_cache *s)
+{
+	int cpu;
+
+	s->cluster = alloc_percpu(struct kmem_cache_cluster);
+	if (!s->cluster)
+		return 0;
+
+	for_each_possible_cpu(cpu)
+		spin_lock_init(&per_cpu_ptr(s->cluster, cpu)->lock);
+	return 1;
+}
+#else
+static inline bool put_cluster_partial(struct kmem_cache *s,
+				       struct kmem_cache_cpu *c)
+{
+	return false;
+}
+
+static inline bool get_cluster_partial(struct kmem_cache *s,
+				       struct kmem_cache_cpu *c)
+{
+	return false;
+}
+
+static inline void flush_cluster_partial(struct kmem_cache *s, int cpu) { }
+static inline void flush_cluster_partials(struct kmem_cache *s) { }
+
+static inline int alloc_kmem_cache_cluster(struct kmem_cache *s)
+{
+	return 1;
+}
+#endif	/* CONFIG_SLUB_CLUSTER_PARTIAL */
+
 /*
  * Put a page that was just frozen (in __slab_free|get_partial_node) into a
  * partial page slot if available.
@@ -2312,10 +2444,14 @@ static void put_cpu_partial(struct kmem_cache *s, struct page *page, int drain)
 				unsigned long flags;
 				/*
 				 * partial array is full. Move the existing
-				 * set to the per node partial list.
+				 * set to the cluster, or failing that the per
+				 * node partial list.
 				 */
 				local_irq_save(flags);
-				unfreeze_partials(s, this_cpu_ptr(s->cpu_slab));
+				if (!put_cluster_partial(s,
+						this_cpu_ptr(s->cpu_slab)))
+					unfreeze_partials(s,
+						this_cpu_ptr(s->cpu_slab));
 				local_irq_restore(flags);
 				oldpage = NULL;
 				pobjects = 0;
@@ -2383,6 +2519,7 @@ static bool has_cpu_slab(int cpu, void *info)
 static void flush_all(struct kmem_cache *s)
 {
 	on_each_cpu_cond(has_cpu_slab, flush_cpu_slab, s, 1, GFP_ATOMIC);
+	flush_cluster_partials(s);
 }
 
 /*
@@ -2399,6 +2536,8 @@ static int slub_cpu_dead(unsigned int cpu)
 		local_irq_save(flags);
 		__flush_cpu_slab(s, cpu);
 		local_irq_restore(flags);
+		/* The cluster's first CPU may be the one going away */
+		flush_cluster_partial(s, cpu);
 	}
 	mutex_unlock(&slab_mutex);
 	return 0;
@@ -2658,6 +2797,9 @@ static void *___slab_alloc(struct kmem_cache *s, gfp_t gfpflags, int node,
 		goto redo;
 	}
 
+	if (get_cluster_partial(s, c))
+		goto new_slab;
+
 	freelist = new_slab_objects(s, gfpflags, node, &c);
 
 	if (unlikely(!freelist)) {
@@ -3479,6 +3621,9 @@ void __kmem_cache_release(struct kmem_cache *s)
 {
 	cache_random_seq_destroy(s);
 	free_percpu(s->cpu_slab);
+#ifdef CONFIG_SLUB_CLUSTER_PARTIAL
+	free_percpu(s->cluster);
+#endif
 	free_kmem_cache_nodes(s);
 }
 
@@ -3731,7 +3876,7 @@ static int kmem_cache_open(struct kmem_cache *s, slab_flags_t flags)
 	if (!init_kmem_cache_nodes(s))
 		goto error;
 
-	if (alloc_kmem_cache_cpus(s))
+	if (alloc_kmem_cache_cpus(s) && alloc_kmem_cache_cluster(s))
 		return 0;
 
 error:
@@ -5488,6 +5633,8 @@ STAT_ATTR(CPU_PARTIAL_ALLOC, cpu_partial_alloc);
 STAT_ATTR(CPU_PARTIAL_FREE, cpu_partial_free);
 STAT_ATTR(CPU_PARTIAL_NODE, cpu_partial_node);
 STAT_ATTR(CPU_PARTIAL_DRAIN, cpu_partial_drain);
+STAT_ATTR(CLUSTER_PARTIAL_PUT, cluster_partial_put);
+STAT_ATTR(CLUSTER_PARTIAL_ALLOC, cluster_partial_alloc);
 #endif	/* CONFIG_SLUB_STATS */
 
 static struct attribute *slab_attrs[] = {
@@ -5554,6 +5701,8 @@ static struct attribute *slab_attrs[] = {
 	&cpu_partial_free_attr.attr,
 	&cpu_partial_node_attr.attr,
 	&cpu_partial_drain_attr.attr,
+	&cluster_partial_put_attr.attr,
+	&cluster_partial_alloc_attr.attr,
 #endif
 #ifdef CONFIG_FAILSLAB
 	&failslab_attr.attr,
@@ -44,6 +44,9 @@
 /* How many pages do we try to swap or page in/out together? */
 int page_cluster;
 
+/* Weigh the anon/file scan balance by refaults, see lru_note_refault() */
+int sysctl_lru_refault_balance;
+
 static DEFINE_PER_CPU(struct pagevec, lru_add_pvec);
 static DEFINE_PER_CPU(struct pagevec, lru_rotate_pvecs);
 static DEFINE_PER_CPU(struct pagevec, lru_deactivate_file_pvecs);
@@ -290,6 +293,27 @@ static void __activate_page(struct page *page, struct lruvec *lruvec,
 	}
 }
 
+/**
+ * lru_note_refault - a reclaimed page was needed again
+ * @lruvec: lruvec the page was evicted from
+ * @file: whether the page is file backed
+ * @nr_pages: number of pages
+ *
+ * Feeds get_scan_count() when vm.lru_refault_balance is set, see there.
+ */
+void lru_note_refault(struct lruvec *lruvec, int file, int nr_pages)
+{
+	struct pglist_data *pgdat = lruvec_pgdat(lruvec);
+	unsigned long flags;
+
+	if (!sysctl_lru_refault_balance)
+		return;
+
+	spin_lock_irqsave(&pgdat->lru_lock, flags);
+	lruvec->reclaim_stat.recent_refaulted[file] += nr_pages;
+	spin_unlock_irqrestore(&pgdat->lru_lock, flags);
+}
+
 #ifdef CONFIG_SMP
 static void activate_page_drain(int cpu)
 {
@@ -21,6 +21,7 @@
 #include <linux/vmalloc.h>
 #include <linux/swap_slots.h>
 #include <linux/huge_mm.h>
+#include <linux/frontswap.h>
 
 #include <asm/pgtable.h>
 #include "internal.h"
@@ -521,6 +522,64 @@ static unsigned long swapin_nr_pages(unsigned long offset)
 	return pages;
 }
 
+/*
+ * Readahead collects the pages it allocates and reads them in batches, so
+ * that frontswap can serve a whole batch at once. The pages stay locked and
+ * referenced until the batch is flushed.
+ */
+struct swap_ra_batch {
+	struct page *pages[FRONTSWAP_LOAD_BATCH];
+	int nr;
+};
+
+static void swap_ra_batch_flush(struct swap_ra_batch *batch)
+{
+	int i;
+
+	if (!batch->nr)
+		return;
+
+	swap_readpage_batch(batch->pages, batch->nr);
+	for (i = 0; i < batch->nr; i++)
+		put_page(batch->pages[i]);
+	batch->nr = 0;
+}
+
+static void swap_ra_batch_add(struct swap_ra_batch *batch, struct page *page)
+{
+	/* a batch only ever covers one swap type */
+	if (batch->nr && page_swap_info(batch->pages[0]) != page_swap_info(page))
+		swap_ra_batch_flush(batch);
+
+	batch->pages[batch->nr++] = page;
+	if (batch->nr == FRONTSWAP_LOAD_BATCH)
+		swap_ra_batch_flush(batch);
+}
+
+/*
+ * Entries held by frontswap cost no IO on the fault that needs them, so
+ * reading them ahead only decompresses pages that may never be touched.
+ * Leave them for first touch; as they never become readahead hits, the
+ * window shrinks on its own when most of a region lives in frontswap.
+ */
+static bool swap_ra_skip(swp_entry_t entry)
+{
+	struct swap_info_struct *si;
+	bool skip;
+
+	if (!frontswap_enabled())
+		return false;
+
+	/* Nothing worth reading ahead from a device being swapped off */
+	si = get_swap_device(entry);
+	if (!si)
+		return true;
+	skip = frontswap_test(si, swp_offset(entry));
+	put_swap_device(si);
+
+	return skip;
+}
+
 /**
  * swap_cluster_readahead - swap in pages in hope we need them soon
  * @entry: swap entry of this memory
@@ -549,6 +608,7 @@ struct page *swap_cluster_readahead(swp_entry_t entry, gfp_t gfp_mask,
 	unsigned long mask;
 	struct swap_info_struct *si = swp_swap_info(entry);
 	struct blk_plug plug;
+	struct swap_ra_batch batch = { .nr = 0, };
 	bool do_poll = true, page_allocated;
 	struct vm_area_struct *vma = vmf->vma;
 	unsigned long addr = vmf->address;
@@ -575,6 +635,9 @@ struct page *swap_cluster_readahead(swp_entry_t entry, gfp_t gfp_mask,
 
 	blk_start_plug(&plug);
 	for (offset = start_offset; offset <= end_offset ; offset++) {
+		if (offset != entry_offset &&
+		    swap_ra_skip(swp_entry(swp_type(entry), offset)))
+			continue;
 		/* Ok, do the async read-ahead now */
 		page = __read_swap_cache_async(
 			swp_entry(swp_type(entry), offset),
@@ -582,14 +645,16 @@ struct page *swap_cluster_readahead(swp_entry_t entry, gfp_t gfp_mask,
 		if (!page)
 			continue;
 		if (page_allocated) {
-			swap_readpage(page, false);
 			if (offset != entry_offset) {
 				SetPageReadahead(page);
 				count_vm_event(SWAP_RA);
 			}
+			swap_ra_batch_add(&batch, page);
+			continue;
 		}
 		put_page(page);
 	}
+	swap_ra_batch_flush(&batch);
 	blk_finish_plug(&plug);
 
 	lru_add_drain();	/* Push any new pages onto the LRU now */
@@ -733,6 +798,7 @@ static struct page *swap_vma_readahead(swp_entry_t fentry, gfp_t gfp_mask,
 	unsigned int i;
 	bool page_allocated;
 	struct vma_swap_readahead ra_info = {0,};
+	struct swap_ra_batch batch = { .nr = 0, };
 
 	swap_ra_info(vmf, &ra_info);
 	if (ra_info.win == 1)
@@ -749,19 +815,23 @@ static struct page *swap_vma_readahead(swp_entry_t fentry, gfp_t gfp_mask,
 		entry = pte_to_swp_entry(pentry);
 		if (unlikely(non_swap_entry(entry)))
 			continue;
+		if (i != ra_info.offset && swap_ra_skip(entry))
+			continue;
 		page = __read_swap_cache_async(entry, gfp_mask, vma,
 					       vmf->address, &page_allocated);
 		if (!page)
 			continue;
 		if (page_allocated) {
-			swap_readpage(page, false);
 			if (i != ra_info.offset) {
 				SetPageReadahead(page);
 				count_vm_event(SWAP_RA);
 			}
+			swap_ra_batch_add(&batch, page);
+			continue;
 		}
 		put_page(page);
 	}
+	swap_ra_batch_flush(&batch);
 	blk_finish_plug(&plug);
 	lru_add_drain();
 skip:
@@ -1211,14 +1211,25 @@ static void unmap_vmap_area(struct vmap_area *va)
  * a less aggressive log scale. It will still be an improvement over the old
  * code, and it will be simple to change the scale factor if we find that it
  * becomes a problem on bigger systems.
+ *
+ * Small systems do scale linearly: every purge IPIs all online CPUs, so
+ * up to LAZY_MAX_LINEAR_CPUS the threshold grows with the CPU count and
+ * only continues on the log scale from there.
  */
+#define LAZY_MAX_LINEAR_CPUS	16
+
 static unsigned long lazy_max_pages(void)
 {
-	unsigned int log;
+	unsigned int cpus = num_online_cpus();
+	unsigned int scale;
 
-	log = fls(num_online_cpus());
+	if (cpus <= LAZY_MAX_LINEAR_CPUS)
+		scale = cpus;
+	else
+		scale = LAZY_MAX_LINEAR_CPUS + fls(cpus) -
+			fls(LAZY_MAX_LINEAR_CPUS);
 
-	return log * (32UL * 1024 * 1024 / PAGE_SIZE);
+	return scale * (32UL * 1024 * 1024 / PAGE_SIZE);
 }
 
 static atomic_long_t vmap_lazy_nr = ATOMIC_LONG_INIT(0);
@@ -1387,7 +1398,7 @@ static struct vmap_area *find_vmap_area(unsigned long addr)
 #endif
 
 #define VMALLOC_PAGES		(VMALLOC_SPACE / PAGE_SIZE)
-#define VMAP_MAX_ALLOC		BITS_PER_LONG	/* 256K with 4K pages */
+#define VMAP_MAX_ALLOC		(BITS_PER_LONG * 4)	/* 1M with 4K pages */
 #define VMAP_BBMAP_BITS_MAX	1024	/* 4MB with 4K pages */
 #define VMAP_BBMAP_BITS_MIN	(VMAP_MAX_ALLOC*2)
 #define VMAP_MIN(x, y)		((x) < (y) ? (x) : (y)) /* can't use min() */
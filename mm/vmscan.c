@@ -2005,6 +2005,7 @@ shrink_inactive_list(unsigned long nr_to_scan, struct lruvec *lruvec,
 	__count_memcg_events(lruvec_memcg(lruvec), item, nr_reclaimed);
 	reclaim_stat->recent_rotated[0] += stat.nr_activate[0];
 	reclaim_stat->recent_rotated[1] += stat.nr_activate[1];
+	reclaim_stat->recent_evicted[file] += nr_reclaimed;
 
 	move_pages_to_lru(lruvec, &page_list);
 
@@ -2441,6 +2442,16 @@ static void get_scan_count(struct lruvec *lruvec, struct mem_cgroup *memcg,
 		reclaim_stat->recent_rotated[1] /= 2;
 	}
 
+	if (unlikely(reclaim_stat->recent_evicted[0] > anon / 4)) {
+		reclaim_stat->recent_evicted[0] /= 2;
+		reclaim_stat->recent_refaulted[0] /= 2;
+	}
+
+	if (unlikely(reclaim_stat->recent_evicted[1] > file / 4)) {
+		reclaim_stat->recent_evicted[1] /= 2;
+		reclaim_stat->recent_refaulted[1] /= 2;
+	}
+
 	/*
 	 * The amount of pressure on anon vs file pages is inversely
 	 * proportional to the fraction of recently scanned pages on
@@ -2451,6 +2462,23 @@ static void get_scan_count(struct lruvec *lruvec, struct mem_cgroup *memcg,
 
 	fp = file_prio * (reclaim_stat->recent_scanned[1] + 1);
 	fp /= reclaim_stat->recent_rotated[1] + 1;
+
+	/*
+	 * Rotations only see references made while a page is still on
+	 * the LRU. A big file scan touches every page of the cache once
+	 * or twice and then never again, which looks like rotation but
+	 * never comes back after eviction, while hot anon pages that got
+	 * swapped out fault straight back in. When asked to, balance on
+	 * what reclaim actually got wrong: the type whose evictions turn
+	 * into refaults is the one to leave alone.
+	 */
+	if (sysctl_lru_refault_balance) {
+		ap = anon_prio * (reclaim_stat->recent_evicted[0] + 1);
+		ap /= reclaim_stat->recent_refaulted[0] + 1;
+
+		fp = file_prio * (reclaim_stat->recent_evicted[1] + 1);
+		fp /= reclaim_stat->recent_refaulted[1] + 1;
+	}
 	spin_unlock_irq(&pgdat->lru_lock);
 
 	fraction[0] = ap;
@@ -3583,6 +3611,16 @@ static bool kswapd_shrink_node(pg_data_t *pgdat,
 	return sc->nr_scanned >= sc->nr_to_reclaim;
 }
 
+/*
+ * Of the kswapd workers of a node, only the first one takes the requested
+ * order and classzone_idx off the node and counts failed passes; the others
+ * just add scanning to the same pass.
+ */
+static bool kswapd_is_primary(pg_data_t *pgdat)
+{
+	return current == pgdat->kswapd[0];
+}
+
 /*
  * For kswapd, balance_pgdat() will reclaim pages across a node from zones
  * that are eligible for use by the caller until at least one zone is
@@ -3764,7 +3802,8 @@ static int balance_pgdat(pg_data_t *pgdat, int order, int classzone_idx)
 			sc.priority--;
 	} while (sc.priority >= 1);
 
-	if (!sc.nr_reclaimed)
+	/* One count per pass over the node, whatever the number of workers */
+	if (!sc.nr_reclaimed && kswapd_is_primary(pgdat))
 		pgdat->kswapd_failures++;
 
 out:
@@ -3941,8 +3980,11 @@ static int kswapd(void *p)
 	tsk->flags |= PF_MEMALLOC | PF_SWAPWRITE | PF_KSWAPD;
 	set_freezable();
 
-	WRITE_ONCE(pgdat->kswapd_order, 0);
-	WRITE_ONCE(pgdat->kswapd_classzone_idx, MAX_NR_ZONES);
+	/* A worker started later must not drop a request still pending */
+	if (kswapd_is_primary(pgdat)) {
+		WRITE_ONCE(pgdat->kswapd_order, 0);
+		WRITE_ONCE(pgdat->kswapd_classzone_idx, MAX_NR_ZONES);
+	}
 	for ( ; ; ) {
 		bool ret;
 
@@ -3956,8 +3998,10 @@ static int kswapd(void *p)
 		/* Read the new order and classzone_idx */
 		alloc_order = reclaim_order = READ_ONCE(pgdat->kswapd_order);
 		classzone_idx = kswapd_classzone_idx(pgdat, classzone_idx);
-		WRITE_ONCE(pgdat->kswapd_order, 0);
-		WRITE_ONCE(pgdat->kswapd_classzone_idx, MAX_NR_ZONES);
+		if (kswapd_is_primary(pgdat)) {
+			WRITE_ONCE(pgdat->kswapd_order, 0);
+			WRITE_ONCE(pgdat->kswapd_classzone_idx, MAX_NR_ZONES);
+		}
 
 		ret = try_to_freeze();
 		if (kthread_should_stop())
@@ -4095,13 +4139,69 @@ static int kswapd_cpu_online(unsigned int cpu)
 
 		mask = cpumask_of_node(pgdat->node_id);
 
-		if (cpumask_any_and(cpu_online_mask, mask) < nr_cpu_ids)
+		if (cpumask_any_and(cpu_online_mask, mask) < nr_cpu_ids) {
+			int i;
+
 			/* One of our CPUs online: restore mask */
-			set_cpus_allowed_ptr(pgdat->kswapd, mask);
+			for (i = 0; i < MAX_KSWAPD_THREADS; i++)
+				if (pgdat->kswapd[i])
+					set_cpus_allowed_ptr(pgdat->kswapd[i],
+							     mask);
+		}
 	}
 	return 0;
 }
 
+/*
+ * Number of kswapd workers per node. They all sleep on pgdat->kswapd_wait and
+ * are woken together, then run balance_pgdat() side by side: each isolates
+ * its own SWAP_CLUSTER_MAX batches off the LRU under the lru_lock, so between
+ * them they split the scanning of the node instead of leaving it to a single
+ * CPU while allocators fall into direct reclaim. More than one only pays off
+ * when there are idle CPUs to run them on, so the default stays at one.
+ */
+int kswapd_threads = 1;
+
+static int __init kswapd_threads_setup(char *str)
+{
+	int threads;
+
+	if (kstrtoint(str, 0, &threads) || threads < 1)
+		return 0;
+	kswapd_threads = min(threads, MAX_KSWAPD_THREADS);
+	return 1;
+}
+__setup("kswapd_threads=", kswapd_threads_setup);
+
+static int kswapd_run_one(pg_data_t *pgdat, int i)
+{
+	struct task_struct *tsk;
+
+	if (pgdat->kswapd[i])
+		return 0;
+
+	/* Published before it runs, for kswapd_is_primary() */
+	if (i == 0)
+		tsk = kthread_create(kswapd, pgdat, "kswapd%d", pgdat->node_id);
+	else
+		tsk = kthread_create(kswapd, pgdat, "kswapd%d:%d",
+				     pgdat->node_id, i);
+	if (IS_ERR(tsk))
+		return PTR_ERR(tsk);
+
+	pgdat->kswapd[i] = tsk;
+	wake_up_process(tsk);
+	return 0;
+}
+
+static void kswapd_stop_one(pg_data_t *pgdat, int i)
+{
+	if (pgdat->kswapd[i]) {
+		kthread_stop(pgdat->kswapd[i]);
+		pgdat->kswapd[i] = NULL;
+	}
+}
+
 /*
  * This kswapd start function will be called by init and node-hot-add.
  * On node-hot-add, kswapd will moved to proper cpus if cpus are hot-added.
@@ -4109,20 +4209,25 @@ static int kswapd_cpu_online(unsigned int cpu)
 int kswapd_run(int nid)
 {
 	pg_data_t *pgdat = NODE_DATA(nid);
-	int ret = 0;
-
-	if (pgdat->kswapd)
-		return 0;
+	int i, ret;
 
-	pgdat->kswapd = kthread_run(kswapd, pgdat, "kswapd%d", nid);
-	if (IS_ERR(pgdat->kswapd)) {
+	ret = kswapd_run_one(pgdat, 0);
+	if (ret) {
 		/* failure at boot is fatal */
 		BUG_ON(system_state < SYSTEM_RUNNING);
 		pr_err("Failed to start kswapd on node %d\n", nid);
-		ret = PTR_ERR(pgdat->kswapd);
-		pgdat->kswapd = NULL;
+		return ret;
 	}
-	return ret;
+
+	/* The extra workers are only a speedup, the node can do without */
+	for (i = 1; i < kswapd_threads; i++) {
+		if (kswapd_run_one(pgdat, i)) {
+			pr_warn("Failed to start kswapd worker %d on node %d\n",
+				i, nid);
+			break;
+		}
+	}
+	return 0;
 }
 
 /*
@@ -4131,12 +4236,47 @@ int kswapd_run(int nid)
  */
 void kswapd_stop(int nid)
 {
-	struct task_struct *kswapd = NODE_DATA(nid)->kswapd;
+	pg_data_t *pgdat = NODE_DATA(nid);
+	int i;
+
+	for (i = MAX_KSWAPD_THREADS - 1; i >= 0; i--)
+		kswapd_stop_one(pgdat, i);
+}
 
-	if (kswapd) {
-		kthread_stop(kswapd);
-		NODE_DATA(nid)->kswapd = NULL;
+static DEFINE_MUTEX(kswapd_threads_mutex);
+
+int kswapd_threads_sysctl_handler(struct ctl_table *table, int write,
+	void __user *buffer, size_t *length, loff_t *ppos)
+{
+	int nid, i, rc;
+
+	mutex_lock(&kswapd_threads_mutex);
+	rc = proc_dointvec_minmax(table, write, buffer, length, ppos);
+	if (rc || !write)
+		goto out;
+
+	mem_hotplug_begin();
+	for_each_node_state(nid, N_MEMORY) {
+		pg_data_t *pgdat = NODE_DATA(nid);
+
+		/* Worker 0 belongs to kswapd_run()/kswapd_stop() */
+		if (!pgdat->kswapd[0])
+			continue;
+
+		for (i = MAX_KSWAPD_THREADS - 1; i >= kswapd_threads; i--)
+			kswapd_stop_one(pgdat, i);
+		for (i = 1; i < kswapd_threads; i++) {
+			if (kswapd_run_one(pgdat, i)) {
+				pr_warn("Failed to start kswapd worker %d on node %d\n",
+					i, nid);
+				break;
+			}
+		}
 	}
+	mem_hotplug_done();
+out:
+	mutex_unlock(&kswapd_threads_mutex);
+	return rc;
 }
 
 static int __init kswapd_init(void)
@@ -315,6 +315,7 @@ void workingset_refault(struct page *page, void *shadow)
 	SetPageActive(page);
 	atomic_long_inc(&lruvec->inactive_age);
 	inc_lruvec_state(lruvec, WORKINGSET_ACTIVATE);
+	lru_note_refault(lruvec, 1, 1);
 
 	/* Page was active prior to eviction */
 	if (workingset) {
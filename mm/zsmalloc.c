@@ -211,6 +211,12 @@ struct size_class {
 
 	unsigned int index;
 	struct zs_size_stat stats;
+
+	/* Per-CPU cache of freed objects, see zs_obj_cache_get() */
+	struct zs_obj_cache __percpu *obj_cache;
+	unsigned int obj_cache_max;
+	/* zs_compact() is working on this class, protected by lock */
+	bool compacting;
 };
 
 /* huge object: pages_per_zspage == 1 && maxobj_per_zspage == 1 */
@@ -581,7 +587,8 @@ static void __exit zs_stat_exit(void)
 	debugfs_remove_recursive(zs_stat_root);
 }
 
-static unsigned long zs_can_compact(struct size_class *class);
+static unsigned long zs_can_compact(struct size_class *class,
+				    unsigned long obj_cached);
 
 static int zs_stats_size_show(struct seq_file *s, void *v)
 {
@@ -611,7 +618,7 @@ static int zs_stats_size_show(struct seq_file *s, void *v)
 		class_almost_empty = zs_stat_get(class, CLASS_ALMOST_EMPTY);
 		obj_allocated = zs_stat_get(class, OBJ_ALLOCATED);
 		obj_used = zs_stat_get(class, OBJ_USED);
-		freeable = zs_can_compact(class);
+		freeable = zs_can_compact(class, 0);
 		spin_unlock(&class->lock);
 
 		objs_per_zspage = class->objs_per_zspage;
@@ -1399,6 +1406,66 @@ static unsigned long obj_malloc(struct size_class *class,
 	return obj;
 }
 
+/*
+ * A freed object is parked, handle and all, in a small per-CPU cache of its
+ * class, and the next allocation of that class on the CPU takes it back
+ * without going through class->lock. With many CPUs storing to and freeing
+ * from the same pool, that lock is otherwise taken twice per object. Cached
+ * objects still count as used; zs_compact() and zs_destroy_pool() hand them
+ * back to their zspages. Each cache holds at most a page worth of objects.
+ */
+#define ZS_OBJ_CACHE_SIZE	16
+
+struct zs_obj_cache {
+	spinlock_t lock;
+	unsigned int nr;
+	unsigned long handles[ZS_OBJ_CACHE_SIZE];
+};
+
+static unsigned long zs_obj_cache_get(struct size_class *class)
+{
+	struct zs_obj_cache *cache = raw_cpu_ptr(class->obj_cache);
+	unsigned long handle = 0;
+
+	spin_lock(&cache->lock);
+	if (cache->nr)
+		handle = cache->handles[--cache->nr];
+	spin_unlock(&cache->lock);
+
+	return handle;
+}
+
+static bool zs_obj_cache_put(struct zs_pool *pool, unsigned long handle)
+{
+	struct zs_obj_cache *cache;
+	struct size_class *class;
+	struct zspage *zspage;
+	struct page *f_page;
+	unsigned int f_objidx;
+	enum fullness_group fullness;
+	int class_idx;
+	bool cached = false;
+
+	pin_tag(handle);
+	obj_to_location(handle_to_obj(handle), &f_page, &f_objidx);
+	zspage = get_zspage(f_page);
+	migrate_read_lock(zspage);
+	get_zspage_mapping(zspage, &class_idx, &fullness);
+	migrate_read_unlock(zspage);
+	unpin_tag(handle);
+
+	class = pool->size_class[class_idx];
+	cache = raw_cpu_ptr(class->obj_cache);
+
+	spin_lock(&cache->lock);
+	if (cache->nr < class->obj_cache_max) {
+		cache->handles[cache->nr++] = handle;
+		cached = true;
+	}
+	spin_unlock(&cache->lock);
+
+	return cached;
+}
 
 /**
  * zs_malloc - Allocate block of given size from pool.
@@ -1420,14 +1487,18 @@ unsigned long zs_malloc(struct zs_pool *pool, size_t size, gfp_t gfp)
 	if (unlikely(!size || size > ZS_MAX_ALLOC_SIZE))
 		return 0;
 
-	handle = cache_alloc_handle(pool, gfp);
-	if (!handle)
-		return 0;
-
 	/* extra space in chunk to keep the handle */
 	size += ZS_HANDLE_SIZE;
 	class = pool->size_class[get_size_class_index(size)];
 
+	handle = zs_obj_cache_get(class);
+	if (handle)
+		return handle;
+
+	handle = cache_alloc_handle(pool, gfp);
+	if (!handle)
+		return 0;
+
 	spin_lock(&class->lock);
 	zspage = find_get_zspage(class);
 	if (likely(zspage)) {
@@ -1491,7 +1562,7 @@ static void obj_free(struct size_class *class, unsigned long obj)
 	zs_stat_dec(class, OBJ_USED, 1);
 }
 
-void zs_free(struct zs_pool *pool, unsigned long handle)
+static void __zs_free(struct zs_pool *pool, unsigned long handle)
 {
 	struct zspage *zspage;
 	struct page *f_page;
@@ -1502,9 +1573,6 @@ void zs_free(struct zs_pool *pool, unsigned long handle)
 	enum fullness_group fullness;
 	bool isolated;
 
-	if (unlikely(!handle))
-		return;
-
 	pin_tag(handle);
 	obj = handle_to_obj(handle);
 	obj_to_location(obj, &f_page, &f_objidx);
@@ -1534,8 +1602,49 @@ void zs_free(struct zs_pool *pool, unsigned long handle)
 	unpin_tag(handle);
 	cache_free_handle(pool, handle);
 }
+
+void zs_free(struct zs_pool *pool, unsigned long handle)
+{
+	if (unlikely(!handle))
+		return;
+
+	if (!zs_obj_cache_put(pool, handle))
+		__zs_free(pool, handle);
+}
 EXPORT_SYMBOL_GPL(zs_free);
 
+static void zs_obj_cache_drain(struct zs_pool *pool, struct size_class *class)
+{
+	unsigned long handles[ZS_OBJ_CACHE_SIZE];
+	unsigned int i, nr;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct zs_obj_cache *cache = per_cpu_ptr(class->obj_cache, cpu);
+
+		spin_lock(&cache->lock);
+		nr = cache->nr;
+		memcpy(handles, cache->handles, nr * sizeof(handles[0]));
+		cache->nr = 0;
+		spin_unlock(&cache->lock);
+
+		for (i = 0; i < nr; i++)
+			__zs_free(pool, handles[i]);
+	}
+}
+
+/* Racy, for the shrinker's estimate only */
+static unsigned long zs_obj_cache_count(struct size_class *class)
+{
+	unsigned long nr = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		nr += READ_ONCE(per_cpu_ptr(class->obj_cache, cpu)->nr);
+
+	return nr;
+}
+
 static void zs_object_copy(struct size_class *class, unsigned long dst,
 				unsigned long src)
 {
@@ -1644,8 +1753,17 @@ struct zs_compact_control {
 	 /* Starting object index within @s_page which used for live object
 	  * in the subpage. */
 	int obj_idx;
+	/* Objects left to migrate before class->lock is dropped */
+	int nr_budget;
 };
 
+/*
+ * Compaction moves at most this many objects between dropping class->lock,
+ * so that zs_malloc() and zs_free() on the class are not held off for the
+ * time it takes to empty a whole zspage.
+ */
+#define ZS_COMPACT_BATCH	32
+
 static int migrate_zspage(struct zs_pool *pool, struct size_class *class,
 				struct zs_compact_control *cc)
 {
@@ -1657,6 +1775,11 @@ static int migrate_zspage(struct zs_pool *pool, struct size_class *class,
 	int ret = 0;
 
 	while (1) {
+		if (!cc->nr_budget) {
+			ret = -EAGAIN;
+			break;
+		}
+
 		handle = find_alloced_obj(class, s_page, &obj_idx);
 		if (!handle) {
 			s_page = get_next_page(s_page);
@@ -1687,6 +1810,7 @@ static int migrate_zspage(struct zs_pool *pool, struct size_class *class,
 		record_obj(handle, free_obj);
 		unpin_tag(handle);
 		obj_free(class, used_obj);
+		cc->nr_budget--;
 	}
 
 	/* Remember last position in this iteration */
@@ -1708,16 +1832,26 @@ static struct zspage *isolate_zspage(struct size_class *class, bool source)
 	}
 
 	for (i = 0; i < 2; i++) {
-		zspage = list_first_entry_or_null(&class->fullness_list[fg[i]],
-							struct zspage, list);
-		if (zspage) {
-			VM_BUG_ON(is_zspage_isolated(zspage));
-			remove_zspage(class, zspage, fg[i]);
-			return zspage;
-		}
+		struct list_head *head = &class->fullness_list[fg[i]];
+
+		if (list_empty(head))
+			continue;
+
+		/*
+		 * Lists are kept roughly in order of decreasing use: empty
+		 * the least used zspage into the most used one.
+		 */
+		if (source)
+			zspage = list_last_entry(head, struct zspage, list);
+		else
+			zspage = list_first_entry(head, struct zspage, list);
+
+		VM_BUG_ON(is_zspage_isolated(zspage));
+		remove_zspage(class, zspage, fg[i]);
+		return zspage;
 	}
 
-	return zspage;
+	return NULL;
 }
 
 /*
@@ -2229,14 +2363,17 @@ static void SetZsPageMovable(struct zs_pool *pool, struct zspage *zspage)
 /*
  *
  * Based on the number of unused allocated objects calculate
- * and return the number of pages that we can free.
+ * and return the number of pages that we can free. @obj_cached
+ * objects counted as used are about to be freed as well.
  */
-static unsigned long zs_can_compact(struct size_class *class)
+static unsigned long zs_can_compact(struct size_class *class,
+				    unsigned long obj_cached)
 {
 	unsigned long obj_wasted;
 	unsigned long obj_allocated = zs_stat_get(class, OBJ_ALLOCATED);
 	unsigned long obj_used = zs_stat_get(class, OBJ_USED);
 
+	obj_used -= min(obj_used, obj_cached);
 	if (obj_allocated <= obj_used)
 		return 0;
 
@@ -2255,21 +2392,41 @@ static unsigned long __zs_compact(struct zs_pool *pool,
 	unsigned long pages_freed = 0;
 
 	spin_lock(&class->lock);
+	/* Concurrent callers leave the class to whoever got there first */
+	if (class->compacting) {
+		spin_unlock(&class->lock);
+		return 0;
+	}
+	class->compacting = true;
+
 	while ((src_zspage = isolate_zspage(class, true))) {
 
-		if (!zs_can_compact(class))
+		if (!zs_can_compact(class, 0))
 			break;
 
 		cc.obj_idx = 0;
 		cc.s_page = get_first_page(src_zspage);
+		cc.nr_budget = ZS_COMPACT_BATCH;
 
 		while ((dst_zspage = isolate_zspage(class, false))) {
+			/*
+			 * The source is usually picked again after the lock
+			 * is dropped, so never move objects to a zspage that
+			 * is less used: they would only come back.
+			 */
+			if (get_zspage_inuse(dst_zspage) <
+			    get_zspage_inuse(src_zspage)) {
+				putback_zspage(class, dst_zspage);
+				dst_zspage = NULL;
+				break;
+			}
+
 			cc.d_page = get_first_page(dst_zspage);
 			/*
 			 * If there is no more space in dst_page, resched
 			 * and see if anyone had allocated another zspage.
 			 */
-			if (!migrate_zspage(pool, class, &cc))
+			if (migrate_zspage(pool, class, &cc) != -ENOMEM)
 				break;
 
 			putback_zspage(class, dst_zspage);
@@ -2292,6 +2449,7 @@ static unsigned long __zs_compact(struct zs_pool *pool,
 	if (src_zspage)
 		putback_zspage(class, src_zspage);
 
+	class->compacting = false;
 	spin_unlock(&class->lock);
 
 	return pages_freed;
@@ -2309,6 +2467,7 @@ unsigned long zs_compact(struct zs_pool *pool)
 			continue;
 		if (class->index != i)
 			continue;
+		zs_obj_cache_drain(pool, class);
 		pages_freed += __zs_compact(pool, class);
 	}
 	atomic_long_add(pages_freed, &pool->stats.pages_compacted);
@@ -2356,7 +2515,13 @@ static unsigned long zs_shrinker_count(struct shrinker *shrinker,
 		if (class->index != i)
 			continue;
 
-		pages_to_free += zs_can_compact(class);
+		/*
+		 * zs_compact() drains the per-CPU caches first, so what
+		 * they hold counts as free here; otherwise a class whose
+		 * free objects all sit in the caches is never compacted.
+		 */
+		pages_to_free += zs_can_compact(class,
+						zs_obj_cache_count(class));
 	}
 
 	return pages_to_free;
@@ -2389,7 +2554,7 @@ static int zs_register_shrinker(struct zs_pool *pool)
  */
 struct zs_pool *zs_create_pool(const char *name)
 {
-	int i;
+	int i, cpu;
 	struct zs_pool *pool;
 	struct size_class *prev_class = NULL;
 
@@ -2474,6 +2639,14 @@ struct zs_pool *zs_create_pool(const char *name)
 		class->objs_per_zspage = objs_per_zspage;
 		spin_lock_init(&class->lock);
 		pool->size_class[i] = class;
+
+		class->obj_cache = alloc_percpu(struct zs_obj_cache);
+		if (!class->obj_cache)
+			goto err;
+		for_each_possible_cpu(cpu)
+			spin_lock_init(&per_cpu_ptr(class->obj_cache, cpu)->lock);
+		class->obj_cache_max = min_t(unsigned int, ZS_OBJ_CACHE_SIZE,
+					     PAGE_SIZE / size);
 		for (fullness = ZS_EMPTY; fullness < NR_ZS_FULLNESS;
 							fullness++)
 			INIT_LIST_HEAD(&class->fullness_list[fullness]);
@@ -2507,6 +2680,13 @@ void zs_destroy_pool(struct zs_pool *pool)
 {
 	int i;
 
+	for (i = 0; i < ZS_SIZE_CLASSES; i++) {
+		struct size_class *class = pool->size_class[i];
+
+		if (class && class->index == i && class->obj_cache)
+			zs_obj_cache_drain(pool, class);
+	}
+
 	zs_unregister_shrinker(pool);
 	zs_unregister_migration(pool);
 	zs_pool_stat_destroy(pool);
@@ -2527,6 +2707,7 @@ void zs_destroy_pool(struct zs_pool *pool)
 					class->size, fg);
 			}
 		}
+		free_percpu(class->obj_cache);
 		kfree(class);
 	}
 
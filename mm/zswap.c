@@ -52,6 +52,8 @@ static atomic_t zswap_same_filled_pages = ATOMIC_INIT(0);
 
 /* Pool limit was hit (see zswap_max_pool_percent) */
 static u64 zswap_pool_limit_hit;
+/* The pool is above zswap_accept_thr_percent after hitting the limit */
+static bool zswap_pool_reached_full;
 /* Pages written back when pool limit was reached */
 static u64 zswap_written_back_pages;
 /* Store failed due to a reclaim failure after pool limit was reached */
@@ -82,7 +84,7 @@ static struct kernel_param_ops zswap_enabled_param_ops = {
 module_param_cb(enabled, &zswap_enabled_param_ops, &zswap_enabled, 0644);
 
 /* Crypto compressor to use */
-#define ZSWAP_COMPRESSOR_DEFAULT "lzo"
+#define ZSWAP_COMPRESSOR_DEFAULT CONFIG_ZSWAP_COMPRESSOR_DEFAULT
 static char *zswap_compressor = ZSWAP_COMPRESSOR_DEFAULT;
 static int zswap_compressor_param_set(const char *,
 				      const struct kernel_param *);
@@ -109,6 +111,11 @@ module_param_cb(zpool, &zswap_zpool_param_ops, &zswap_zpool_type, 0644);
 static unsigned int zswap_max_pool_percent = 20;
 module_param_named(max_pool_percent, zswap_max_pool_percent, uint, 0644);
 
+/* The threshold for accepting new pages after the max_pool_percent was hit */
+static unsigned int zswap_accept_thr_percent = 90; /* of max pool size */
+module_param_named(accept_threshold_percent, zswap_accept_thr_percent,
+		   uint, 0644);
+
 /* Enable/disable handling same-value filled pages (enabled by default) */
 static bool zswap_same_filled_pages_enabled = true;
 module_param_named(same_filled_pages_enabled, zswap_same_filled_pages_enabled,
@@ -124,6 +131,7 @@ struct zswap_pool {
 	struct kref kref;
 	struct list_head list;
 	struct work_struct work;
+	struct work_struct shrink_work;
 	struct hlist_node node;
 	char tfm_name[CRYPTO_MAX_ALG_NAME];
 };
@@ -192,6 +200,8 @@ static bool zswap_init_failed;
 /* init completed, but couldn't create the initial pool */
 static bool zswap_has_pool;
 
+static struct workqueue_struct *shrink_wq;
+
 /*********************************
 * helpers and fwd declarations
 **********************************/
@@ -201,6 +211,7 @@ static bool zswap_has_pool;
 		 zpool_get_type((p)->zpool))
 
 static int zswap_writeback_entry(struct zpool *pool, unsigned long handle);
+static void shrink_worker(struct work_struct *w);
 static int zswap_pool_get(struct zswap_pool *pool);
 static void zswap_pool_put(struct zswap_pool *pool);
 
@@ -214,6 +225,13 @@ static bool zswap_is_full(void)
 			DIV_ROUND_UP(zswap_pool_total_size, PAGE_SIZE);
 }
 
+static bool zswap_can_accept(void)
+{
+	return totalram_pages() * zswap_accept_thr_percent / 100 *
+				zswap_max_pool_percent / 100 >
+			DIV_ROUND_UP(zswap_pool_total_size, PAGE_SIZE);
+}
+
 static void zswap_update_total_size(void)
 {
 	struct zswap_pool *pool;
@@ -551,6 +569,7 @@ static struct zswap_pool *zswap_pool_create(char *type, char *compressor)
 	 */
 	kref_init(&pool->kref);
 	INIT_LIST_HEAD(&pool->list);
+	INIT_WORK(&pool->shrink_work, shrink_worker);
 
 	zswap_pool_debug("created", pool);
 
@@ -942,20 +961,22 @@ static int zswap_writeback_entry(struct zpool *pool, unsigned long handle)
 	return ret;
 }
 
-static int zswap_shrink(void)
+/*
+ * Writeback runs from a workqueue rather than from the store that found the
+ * pool full, so the task in reclaim doesn't also pay for decompressing and
+ * writing out the oldest entry. The store itself is rejected, and stores
+ * keep being rejected until the pool has drained to accept_threshold_percent
+ * of its limit, so that the pool isn't refilled page by page right at the
+ * limit.
+ */
+static void shrink_worker(struct work_struct *w)
 {
-	struct zswap_pool *pool;
-	int ret;
-
-	pool = zswap_pool_last_get();
-	if (!pool)
-		return -ENOENT;
-
-	ret = zpool_shrink(pool->zpool, 1, NULL);
+	struct zswap_pool *pool = container_of(w, typeof(*pool),
+						shrink_work);
 
+	if (zpool_shrink(pool->zpool, 1, NULL))
+		zswap_reject_reclaim_fail++;
 	zswap_pool_put(pool);
-
-	return ret;
 }
 
 static int zswap_is_page_same_filled(void *ptr, unsigned long *value)
@@ -990,6 +1011,7 @@ static int zswap_frontswap_store(unsigned type, pgoff_t offset,
 	struct zswap_tree *tree = zswap_trees[type];
 	struct zswap_entry *entry, *dupentry;
 	struct crypto_comp *tfm;
+	struct zswap_pool *pool;
 	int ret;
 	unsigned int hlen, dlen = PAGE_SIZE;
 	unsigned long handle, value;
@@ -1012,20 +1034,16 @@ static int zswap_frontswap_store(unsigned type, pgoff_t offset,
 	/* reclaim space if needed */
 	if (zswap_is_full()) {
 		zswap_pool_limit_hit++;
-		if (zswap_shrink()) {
-			zswap_reject_reclaim_fail++;
-			ret = -ENOMEM;
-			goto reject;
-		}
+		zswap_pool_reached_full = true;
+		goto shrink;
+	}
 
-		/* A second zswap_is_full() check after
-		 * zswap_shrink() to make sure it's now
-		 * under the max_pool_percent
-		 */
-		if (zswap_is_full()) {
+	if (zswap_pool_reached_full) {
+		if (!zswap_can_accept()) {
 			ret = -ENOMEM;
 			goto reject;
-		}
+		} else
+			zswap_pool_reached_full = false;
 	}
 
 	/* allocate entry */
@@ -1120,37 +1138,29 @@ static int zswap_frontswap_store(unsigned type, pgoff_t offset,
 	zswap_entry_cache_free(entry);
 reject:
 	return ret;
+
+shrink:
+	pool = zswap_pool_last_get();
+	/* the work item holds the reference while it is queued */
+	if (pool && !queue_work(shrink_wq, &pool->shrink_work))
+		zswap_pool_put(pool);
+	ret = -ENOMEM;
+	goto reject;
 }
 
-/*
- * returns 0 if the page was successfully decompressed
- * return -1 on entry not found or error
-*/
-static int zswap_frontswap_load(unsigned type, pgoff_t offset,
-				struct page *page)
+/* Fill page from an entry the caller holds a reference to */
+static void zswap_load_entry(struct zswap_entry *entry, struct page *page)
 {
-	struct zswap_tree *tree = zswap_trees[type];
-	struct zswap_entry *entry;
 	struct crypto_comp *tfm;
 	u8 *src, *dst;
 	unsigned int dlen;
 	int ret;
 
-	/* find */
-	spin_lock(&tree->lock);
-	entry = zswap_entry_find_get(&tree->rbroot, offset);
-	if (!entry) {
-		/* entry was written back */
-		spin_unlock(&tree->lock);
-		return -1;
-	}
-	spin_unlock(&tree->lock);
-
 	if (!entry->length) {
 		dst = kmap_atomic(page);
 		zswap_fill_page(dst, entry->value);
 		kunmap_atomic(dst);
-		goto freeentry;
+		return;
 	}
 
 	/* decompress */
@@ -1165,8 +1175,30 @@ static int zswap_frontswap_load(unsigned type, pgoff_t offset,
 	kunmap_atomic(dst);
 	zpool_unmap_handle(entry->pool->zpool, entry->handle);
 	BUG_ON(ret);
+}
+
+/*
+ * returns 0 if the page was successfully decompressed
+ * return -1 on entry not found or error
+*/
+static int zswap_frontswap_load(unsigned type, pgoff_t offset,
+				struct page *page)
+{
+	struct zswap_tree *tree = zswap_trees[type];
+	struct zswap_entry *entry;
+
+	/* find */
+	spin_lock(&tree->lock);
+	entry = zswap_entry_find_get(&tree->rbroot, offset);
+	if (!entry) {
+		/* entry was written back */
+		spin_unlock(&tree->lock);
+		return -1;
+	}
+	spin_unlock(&tree->lock);
+
+	zswap_load_entry(entry, page);
 
-freeentry:
 	spin_lock(&tree->lock);
 	zswap_entry_put(tree, entry);
 	spin_unlock(&tree->lock);
@@ -1174,6 +1206,39 @@ static int zswap_frontswap_load(unsigned type, pgoff_t offset,
 	return 0;
 }
 
+/*
+ * Same as zswap_frontswap_load() for each page, but the tree lock is taken
+ * once to look all the entries up and once to drop them, instead of twice
+ * per page. That lock is what faulting CPUs bounce on under swap pressure,
+ * far more than the decompression itself.
+ */
+static void zswap_frontswap_load_batch(unsigned type, pgoff_t *offsets,
+				       struct page **pages, int *ret, int nr)
+{
+	struct zswap_tree *tree = zswap_trees[type];
+	struct zswap_entry *entries[FRONTSWAP_LOAD_BATCH];
+	int i;
+
+	/* find */
+	spin_lock(&tree->lock);
+	for (i = 0; i < nr; i++)
+		entries[i] = zswap_entry_find_get(&tree->rbroot, offsets[i]);
+	spin_unlock(&tree->lock);
+
+	for (i = 0; i < nr; i++) {
+		/* entry was written back */
+		ret[i] = entries[i] ? 0 : -1;
+		if (entries[i])
+			zswap_load_entry(entries[i], pages[i]);
+	}
+
+	spin_lock(&tree->lock);
+	for (i = 0; i < nr; i++)
+		if (entries[i])
+			zswap_entry_put(tree, entries[i]);
+	spin_unlock(&tree->lock);
+}
+
 /* frees an entry in zswap */
 static void zswap_frontswap_invalidate_page(unsigned type, pgoff_t offset)
 {
@@ -1235,6 +1300,7 @@ static void zswap_frontswap_init(unsigned type)
 static struct frontswap_ops zswap_frontswap_ops = {
 	.store = zswap_frontswap_store,
 	.load = zswap_frontswap_load,
+	.load_batch = zswap_frontswap_load_batch,
 	.invalidate_page = zswap_frontswap_invalidate_page,
 	.invalidate_area = zswap_frontswap_invalidate_area,
 	.init = zswap_frontswap_init
@@ -1332,11 +1398,18 @@ static int __init init_zswap(void)
 		zswap_enabled = false;
 	}
 
+	shrink_wq = create_workqueue("zswap-shrink");
+	if (!shrink_wq)
+		goto fallback_fail;
+
 	frontswap_register_ops(&zswap_frontswap_ops);
 	if (zswap_debugfs_init())
 		pr_warn("debugfs initialization failed\n");
 	return 0;
 
+fallback_fail:
+	if (pool)
+		zswap_pool_destroy(pool);
 hp_fail:
 	cpuhp_remove_state(CPUHP_MM_ZSWP_MEM_PREPARE);
 dstmem_fail:
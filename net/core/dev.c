@@ -3906,6 +3906,99 @@ EXPORT_SYMBOL(rps_needed);
 struct static_key_false rfs_needed __read_mostly;
 EXPORT_SYMBOL(rfs_needed);
 
+/*
+ * Cluster RPS: single-queue NICs with no rps_cpus/rps_flow_cnt configured
+ * spread flows over the CPUs sharing a cache with the receiving CPU, which
+ * is the one the NIC interrupt is routed to. On Jaguar that is the 4-core
+ * module and its L2, so the skb stays in cache and the far module doesn't
+ * pay for the other side's traffic.
+ *
+ * With rps_cluster_flow_bytes set, a flow is only steered away once it has
+ * moved that many bytes without going idle; short request/response flows
+ * are cheaper to process in place than to IPI for.
+ */
+int rps_cluster __read_mostly;
+EXPORT_SYMBOL(rps_cluster);
+unsigned int rps_cluster_flow_bytes __read_mostly;
+EXPORT_SYMBOL(rps_cluster_flow_bytes);
+
+#define RPS_CLUSTER_FLOWS	256
+#define RPS_CLUSTER_IDLE	(HZ / 50)
+
+struct rps_cluster_flow {
+	u32		hash;
+	u32		bytes;
+	unsigned long	last;
+};
+
+static DEFINE_PER_CPU(struct rps_cluster_flow [RPS_CLUSTER_FLOWS],
+		      rps_cluster_flows);
+
+static bool rps_cluster_flow_small(int cpu, struct sk_buff *skb, u32 hash)
+{
+	unsigned int thresh = READ_ONCE(rps_cluster_flow_bytes);
+	struct rps_cluster_flow *f;
+
+	if (!thresh)
+		return false;
+
+	/* Only ever touched from this CPU's receive path; a racing
+	 * migration at worst mis-counts one packet. */
+	f = &per_cpu(rps_cluster_flows, cpu)[hash % RPS_CLUSTER_FLOWS];
+	if (f->hash != hash ||
+	    time_after(jiffies, f->last + RPS_CLUSTER_IDLE)) {
+		/* An idle flow has drained from any remote backlog, so it
+		 * can come back local without reordering. */
+		f->hash = hash;
+		f->bytes = 0;
+	}
+	f->last = jiffies;
+	if (f->bytes >= thresh)
+		return false;
+	f->bytes += skb->len;
+	return f->bytes < thresh;
+}
+
+static const struct cpumask *rps_cluster_mask(int cpu)
+{
+#ifdef CONFIG_SCHED_MC
+	return cpu_coregroup_mask(cpu);
+#else
+	return cpumask_of(cpu);
+#endif
+}
+
+static int get_rps_cluster_cpu(struct net_device *dev, struct sk_buff *skb)
+{
+	const struct cpumask *mask;
+	int cpu = raw_smp_processor_id();
+	unsigned int idx;
+	u32 hash;
+	int tcpu;
+
+	if (!dev->irq || dev->real_num_rx_queues != 1)
+		return -1;
+
+	mask = rps_cluster_mask(cpu);
+	if (cpumask_weight(mask) < 2)
+		return -1;
+
+	skb_reset_network_header(skb);
+	hash = skb_get_hash(skb);
+	if (!hash || rps_cluster_flow_small(cpu, skb, hash))
+		return -1;
+
+	idx = reciprocal_scale(hash, cpumask_weight(mask));
+	for_each_cpu(tcpu, mask)
+		if (!idx--)
+			break;
+
+	/* Our own share of the flows needn't bounce through the backlog */
+	if (tcpu == cpu || tcpu >= nr_cpu_ids || !cpu_online(tcpu))
+		return -1;
+	return tcpu;
+}
+
 static struct rps_dev_flow *
 set_rps_cpu(struct net_device *dev, struct sk_buff *skb,
 	    struct rps_dev_flow *rflow, u16 next_cpu)
@@ -3984,8 +4077,11 @@ static int get_rps_cpu(struct net_device *dev, struct sk_buff *skb,
 
 	flow_table = rcu_dereference(rxqueue->rps_flow_table);
 	map = rcu_dereference(rxqueue->rps_map);
-	if (!flow_table && !map)
+	if (!flow_table && !map) {
+		if (READ_ONCE(rps_cluster))
+			cpu = get_rps_cluster_cpu(dev, skb);
 		goto done;
+	}
 
 	skb_reset_network_header(skb);
 	hash = skb_get_hash(skb);
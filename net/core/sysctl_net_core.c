@@ -109,6 +109,26 @@ static int rps_sock_flow_sysctl(struct ctl_table *table, int write,
 
 	return ret;
 }
+
+static int rps_cluster_sysctl(struct ctl_table *table, int write,
+			      void __user *buffer, size_t *lenp, loff_t *ppos)
+{
+	static DEFINE_MUTEX(rps_cluster_mutex);
+	int orig, ret;
+
+	mutex_lock(&rps_cluster_mutex);
+	orig = rps_cluster;
+	ret = proc_dointvec_minmax(table, write, buffer, lenp, ppos);
+	if (!ret && write && rps_cluster != orig) {
+		if (rps_cluster)
+			static_branch_inc(&rps_needed);
+		else
+			static_branch_dec(&rps_needed);
+	}
+	mutex_unlock(&rps_cluster_mutex);
+
+	return ret;
+}
 #endif /* CONFIG_RPS */
 
 #ifdef CONFIG_NET_FLOW_LIMIT
@@ -474,6 +494,22 @@ static struct ctl_table net_core_table[] = {
 		.mode		= 0644,
 		.proc_handler	= rps_sock_flow_sysctl
 	},
+	{
+		.procname	= "rps_cluster",
+		.data		= &rps_cluster,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= rps_cluster_sysctl,
+		.extra1		= SYSCTL_ZERO,
+		.extra2		= SYSCTL_ONE
+	},
+	{
+		.procname	= "rps_cluster_flow_bytes",
+		.data		= &rps_cluster_flow_bytes,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= proc_douintvec
+	},
 #endif
 #ifdef CONFIG_NET_FLOW_LIMIT
 	{
@@ -0,0 +1,69 @@
+#!/bin/sh
+# SPDX-License-Identifier: GPL-2.0
+#
+# Run iopath.fio against null_blk devices configured to isolate one layer
+# of the IO path at a time: blk-mq alone, each IO scheduler, and 31-bit
+# swiotlb bouncing. Compare the usr/sys columns between runs; the device
+# itself costs nothing.
+#
+# Usage: nullb-bench.sh [engine...]	(default: libaio io_uring)
+
+set -e
+
+CFS=/sys/kernel/config/nullb
+HERE=$(dirname "$0")
+OUT=${OUT:-nullb-bench.$(date +%Y%m%d-%H%M%S)}
+ENGINES=${*:-"libaio io_uring"}
+
+if [ ! -d $CFS ]; then
+	modprobe null_blk nr_devices=0
+	mount | grep -q configfs || mount -t configfs none /sys/kernel/config
+fi
+
+# nullb_up NAME [attr=value...]
+nullb_up()
+{
+	name=$1
+	shift
+	mkdir $CFS/$name
+	echo 2 > $CFS/$name/queue_mode
+	echo 0 > $CFS/$name/irqmode
+	echo 1 > $CFS/$name/submit_queues
+	echo 4096 > $CFS/$name/blocksize
+	echo 4096 > $CFS/$name/size
+	for kv in "$@"; do
+		echo ${kv#*=} > $CFS/$name/${kv%%=*}
+	done
+	echo 1 > $CFS/$name/power
+	echo /dev/nullb$(cat $CFS/$name/index)
+}
+
+nullb_down()
+{
+	echo 0 > $CFS/$1/power
+	rmdir $CFS/$1
+}
+
+# run TAG DEV SCHED
+run()
+{
+	echo $3 > /sys/block/${2#/dev/}/queue/scheduler
+	for e in $ENGINES; do
+		echo "== $1 sched=$3 engine=$e"
+		DEV=$2 IOENGINE=$e fio --output=$OUT/$1-$3-$e.txt \
+			"$HERE/iopath.fio"
+		grep -E "^ +(read|write)|cpu " $OUT/$1-$3-$e.txt
+	done
+}
+
+mkdir -p $OUT
+
+dev=$(nullb_up bench_base)
+for s in none mq-deadline kyber bfq; do
+	grep -qw $s /sys/block/${dev#/dev/}/queue/scheduler && run base $dev $s
+done
+nullb_down bench_base
+
+dev=$(nullb_up bench_bounce bounce=1)
+run bounce $dev none
+nullb_down bench_bounce
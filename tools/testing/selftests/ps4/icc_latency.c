@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * ICC round-trip latency: issue a firmware version query to the EMC
+ * through /dev/icc and time each reply.
+ *
+ * Usage: icc_latency [-n iterations] [-d device]
+ *
+ * Prints one "ps4.icc.<metric> <value>" line per metric, times in us.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../kselftest.h"
+
+/* Mirrors struct icc_cmd in drivers/ps4/aeolia-baikal.h */
+struct icc_cmd {
+	uint8_t major;
+	uint16_t minor;
+	void *data;
+	uint16_t length;
+	void *reply;
+	uint16_t reply_length;
+};
+
+#define ICC_MAJOR	'I'
+#define ICC_IOCTL_CMD	_IOWR(ICC_MAJOR, 1, struct icc_cmd)
+
+/* Side-effect free: the EMC firmware version */
+#define ICC_CMD_FW_VERSION_MAJOR	2
+#define ICC_CMD_FW_VERSION_MINOR	6
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static double pct(const uint64_t *v, int n, double p)
+{
+	return v[(int)((n - 1) * p / 100.0)] / 1000.0;
+}
+
+int main(int argc, char **argv)
+{
+	const char *dev = "/dev/icc";
+	uint8_t reply[0x30];
+	struct icc_cmd cmd;
+	uint64_t *lat, t0, sum = 0;
+	int iters = 1000, errors = 0;
+	int fd, opt, i;
+
+	while ((opt = getopt(argc, argv, "n:d:")) != -1) {
+		switch (opt) {
+		case 'n':
+			iters = atoi(optarg);
+			break;
+		case 'd':
+			dev = optarg;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n iterations] [-d device]\n",
+				argv[0]);
+			return KSFT_FAIL;
+		}
+	}
+	if (iters <= 0)
+		return KSFT_FAIL;
+
+	fd = open(dev, O_RDWR);
+	if (fd < 0) {
+		fprintf(stderr, "# %s: %s\n", dev, strerror(errno));
+		return KSFT_SKIP;
+	}
+
+	lat = calloc(iters, sizeof(*lat));
+	if (!lat)
+		return KSFT_FAIL;
+
+	for (i = 0; i < iters; i++) {
+		memset(&cmd, 0, sizeof(cmd));
+		cmd.major = ICC_CMD_FW_VERSION_MAJOR;
+		cmd.minor = ICC_CMD_FW_VERSION_MINOR;
+		cmd.reply = reply;
+		cmd.reply_length = sizeof(reply);
+
+		t0 = now_ns();
+		if (ioctl(fd, ICC_IOCTL_CMD, &cmd) < 0) {
+			errors++;
+			i--;
+			if (errors > iters / 10) {
+				fprintf(stderr, "# ICC_IOCTL_CMD: %s\n",
+					strerror(errno));
+				return KSFT_FAIL;
+			}
+			continue;
+		}
+		lat[i] = now_ns() - t0;
+		sum += lat[i];
+	}
+	close(fd);
+
+	qsort(lat, iters, sizeof(*lat), cmp_u64);
+	printf("ps4.icc.iterations %d\n", iters);
+	printf("ps4.icc.errors %d\n", errors);
+	printf("ps4.icc.rtt_us.min %.1f\n", lat[0] / 1000.0);
+	printf("ps4.icc.rtt_us.avg %.1f\n", sum / 1000.0 / iters);
+	printf("ps4.icc.rtt_us.p50 %.1f\n", pct(lat, iters, 50));
+	printf("ps4.icc.rtt_us.p90 %.1f\n", pct(lat, iters, 90));
+	printf("ps4.icc.rtt_us.p99 %.1f\n", pct(lat, iters, 99));
+	printf("ps4.icc.rtt_us.max %.1f\n", lat[iters - 1] / 1000.0);
+
+	free(lat);
+	return KSFT_PASS;
+}
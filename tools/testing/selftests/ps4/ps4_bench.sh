@@ -0,0 +1,202 @@
+#!/bin/sh
+# SPDX-License-Identifier: GPL-2.0
+#
+# Microbenchmarks for the PS4 specific paths. Every result is printed as one
+# "ps4.<bench>.<metric> <value>" line so that runs can be diffed or fed to a
+# regression gate; everything else goes out as "#" comments.
+#
+#   icc     ICC round-trip latency (icc_latency)
+#   demux   Baikal chained MSI demux cost, /sys/kernel/debug/ps4-bpcie/demux
+#   bounce  swiotlb bounce ratio for reads from $BLOCKDEV (AHCI or USB disk)
+#   net     sky2 packets per second on $NETDEV, pktgen if $PKTGEN_DST is set
+#   modeset ps4_bridge modeset time over $MODESET_CYCLES fbdev blank cycles
+#
+# Usage: ps4_bench.sh [bench...]	(default: all of the above)
+#
+# Environment: ICC_ITERS (1000), BLOCKDEV, BOUNCE_MB (256), NETDEV (first
+# sky2 interface), DURATION (10 s), PKTGEN_DST (destination MAC address,
+# passive sampling without it), MODESET_CYCLES (5).
+
+ksft_skip=4
+
+HERE=$(dirname "$0")
+DEBUGFS=/sys/kernel/debug
+ICC_ITERS=${ICC_ITERS:-1000}
+BOUNCE_MB=${BOUNCE_MB:-256}
+DURATION=${DURATION:-10}
+MODESET_CYCLES=${MODESET_CYCLES:-5}
+BENCHES=${*:-"icc demux bounce net modeset"}
+ret=0
+
+if [ $(id -u) -ne 0 ]; then
+	echo "# must be run as root"
+	exit $ksft_skip
+fi
+
+if [ ! -d /sys/bus/pci/drivers/aeolia_pcie ] &&
+   [ ! -d /sys/bus/pci/drivers/baikal_pcie ]; then
+	echo "# not a PS4 (no Aeolia/Baikal southbridge driver)"
+	exit $ksft_skip
+fi
+
+mount | grep -q " $DEBUGFS " || mount -t debugfs none $DEBUGFS
+
+if [ -d /sys/bus/pci/drivers/baikal_pcie ]; then
+	echo "ps4.southbridge baikal"
+else
+	echo "ps4.southbridge aeolia"
+fi
+
+# result BENCH METRIC VALUE
+result()
+{
+	echo "ps4.$1.$2 $3"
+}
+
+skip()
+{
+	echo "# $1: skipped, $2"
+}
+
+now_us()
+{
+	echo $(($(date +%s%N) / 1000))
+}
+
+bench_icc()
+{
+	# register_chrdev() doesn't create a node
+	if [ ! -c /dev/icc ]; then
+		major=$(awk '$2 == "icc" { print $1 }' /proc/devices)
+		[ -n "$major" ] || { skip icc "no icc character device"; return; }
+		mknod /dev/icc c $major 0
+	fi
+	"$HERE"/icc_latency -n $ICC_ITERS || ret=1
+}
+
+bench_demux()
+{
+	f=$DEBUGFS/ps4-bpcie/demux
+	[ -r $f ] || { skip demux "no $f (Aeolia has no chained demux)"; return; }
+
+	tmp=$(mktemp)
+	cat $f > $tmp
+	sleep $DURATION
+	# Per function: interrupts/s, ns per ack and ns of demux overhead
+	cat $f | awk -v d=$DURATION 'NR == FNR { if (FNR > 1) {
+			c[$1] = $2; e[$1] = $3; a[$1] = $4; h[$1] = $5; t[$1] = $6 }
+			next }
+		FNR > 1 {
+			n = $2 - c[$1]
+			if (n <= 0)
+				next
+			f = "ps4.demux.func" $1
+			printf "%s.irq_per_s %.1f\n", f, n / d
+			printf "%s.empty %d\n", f, $3 - e[$1]
+			printf "%s.ack_ns %.1f\n", f, ($4 - a[$1]) / n
+			printf "%s.overhead_ns %.1f\n", f,
+				(($6 - t[$1]) - ($5 - h[$1])) / n
+		}' $tmp -
+	rm -f $tmp
+}
+
+bench_bounce()
+{
+	[ -n "$BLOCKDEV" ] || { skip bounce "set BLOCKDEV"; return; }
+	f=$DEBUGFS/swiotlb/io_tlb_bounced_bytes
+	[ -w $f ] || { skip bounce "no $f"; return; }
+	[ -b "$BLOCKDEV" ] || { skip bounce "$BLOCKDEV is not a block device"; return; }
+
+	stat=/sys/class/block/${BLOCKDEV#/dev/}/stat
+	echo 0 > $f
+	before=$(awk '{ print $3 }' $stat)
+	t0=$(now_us)
+	dd if=$BLOCKDEV of=/dev/null bs=1M count=$BOUNCE_MB iflag=direct \
+		2> /dev/null || { echo "# bounce: dd failed"; ret=1; return; }
+	t1=$(now_us)
+	after=$(awk '{ print $3 }' $stat)
+	bounced=$(cat $f)
+	io=$(((after - before) * 512))
+
+	result bounce io_bytes $io
+	result bounce bounced_bytes $bounced
+	[ $io -gt 0 ] && result bounce ratio \
+		$(awk -v b=$bounced -v i=$io 'BEGIN { printf "%.3f", b / i }')
+	result bounce mb_per_s \
+		$(awk -v i=$io -v t=$((t1 - t0)) 'BEGIN { printf "%.1f", i / t }')
+}
+
+net_counter()
+{
+	cat /sys/class/net/$NETDEV/statistics/$1
+}
+
+bench_net()
+{
+	if [ -z "$NETDEV" ]; then
+		for d in /sys/class/net/*; do
+			drv=$(readlink $d/device/driver 2> /dev/null)
+			[ "${drv##*/}" = sky2 ] && NETDEV=${d##*/} && break
+		done
+	fi
+	[ -n "$NETDEV" ] || { skip net "no sky2 interface"; return; }
+
+	if [ -n "$PKTGEN_DST" ]; then
+		modprobe pktgen 2> /dev/null
+		pg=/proc/net/pktgen
+		[ -d $pg ] || { skip net "no pktgen"; return; }
+		echo "rem_device_all" > $pg/kpktgend_0
+		echo "add_device $NETDEV" > $pg/kpktgend_0
+		echo "count 0" > $pg/$NETDEV
+		echo "pkt_size 60" > $pg/$NETDEV
+		echo "dst_mac $PKTGEN_DST" > $pg/$NETDEV
+		echo "start" > $pg/pgctrl &
+		pgpid=$!
+	fi
+
+	rx=$(net_counter rx_packets)
+	tx=$(net_counter tx_packets)
+	sleep $DURATION
+	rx=$(($(net_counter rx_packets) - rx))
+	tx=$(($(net_counter tx_packets) - tx))
+
+	if [ -n "$pgpid" ]; then
+		echo "stop" > $pg/pgctrl
+		wait $pgpid
+		echo "rem_device_all" > $pg/kpktgend_0
+	fi
+
+	result net.$NETDEV rx_pps $((rx / DURATION))
+	result net.$NETDEV tx_pps $((tx / DURATION))
+}
+
+bench_modeset()
+{
+	f=$(ls $DEBUGFS/dri/*/ps4_bridge_modeset 2> /dev/null | head -n 1)
+	[ -n "$f" ] || { skip modeset "no ps4_bridge_modeset in debugfs"; return; }
+	fb=/sys/class/graphics/fb0/blank
+	[ -w $fb ] || { skip modeset "no fbdev to cycle"; return; }
+
+	n0=$(awk '$1 == "modesets" { print $2 }' $f)
+	t0=$(awk '$1 == "total_us" { print $2 }' $f)
+	i=0
+	while [ $i -lt $MODESET_CYCLES ]; do
+		echo 4 > $fb
+		echo 0 > $fb
+		i=$((i + 1))
+	done
+	n=$(($(awk '$1 == "modesets" { print $2 }' $f) - n0))
+	t=$(($(awk '$1 == "total_us" { print $2 }' $f) - t0))
+
+	[ $n -gt 0 ] || { echo "# modeset: no modeset seen, is a DRM master active?"; return; }
+	result modeset count $n
+	result modeset avg_us $((t / n))
+	result modeset max_us $(awk '$1 == "max_us" { print $2 }' $f)
+}
+
+for b in $BENCHES; do
+	echo "# $b"
+	bench_$b
+done
+
+exit $ret